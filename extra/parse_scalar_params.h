@@ -22,6 +22,7 @@ DTYPE Expon_krnl_param[1]     = {0.5};
 DTYPE Matern32_krnl_param[1]  = {1.0};
 DTYPE Matern52_krnl_param[1]  = {1.0};
 DTYPE Quadratic_krnl_param[2] = {1.0, -0.5};
+DTYPE ND_krnl_param[2];  // For pt_dim > 3: {l, pt_dim}
 
 static double pseudo_randn()
 {
@@ -289,4 +290,45 @@ void parse_scalar_params(int argc, char **argv)
             }
         }
     }
+
+    // Higher dimensions: only Gaussian and Matern kernels are available
+    if (test_params.pt_dim > 3)
+    {
+        ND_krnl_param[1] = (DTYPE) test_params.pt_dim;
+        switch (test_params.kernel_id)
+        {
+            case 1: 
+            {
+                ND_krnl_param[0] = Gaussian_krnl_param[0];
+                test_params.krnl_eval       = Gaussian_ND_eval_intrin_t; 
+                test_params.krnl_bimv       = Gaussian_ND_krnl_bimv_intrin_t; 
+                test_params.krnl_bimv_flops = Gaussian_ND_krnl_bimv_flop(test_params.pt_dim);
+                test_params.krnl_param      = (void*) &ND_krnl_param[0];
+                break;
+            }
+            case 3: 
+            {
+                ND_krnl_param[0] = Matern32_krnl_param[0];
+                test_params.krnl_eval       = Matern32_ND_eval_intrin_t; 
+                test_params.krnl_bimv       = Matern32_ND_krnl_bimv_intrin_t; 
+                test_params.krnl_bimv_flops = Matern32_ND_krnl_bimv_flop(test_params.pt_dim);
+                test_params.krnl_param      = (void*) &ND_krnl_param[0];
+                break;
+            }
+            case 4: 
+            {
+                ND_krnl_param[0] = Matern52_krnl_param[0];
+                test_params.krnl_eval       = Matern52_ND_eval_intrin_t; 
+                test_params.krnl_bimv       = Matern52_ND_krnl_bimv_intrin_t; 
+                test_params.krnl_bimv_flops = Matern52_ND_krnl_bimv_flop(test_params.pt_dim);
+                test_params.krnl_param      = (void*) &ND_krnl_param[0];
+                break;
+            }
+            default:
+            {
+                printf("Only Gaussian (1), 3/2 Matern (3), and 5/2 Matern (4) kernels support pt_dim > 3\n");
+                exit(1);
+            }
+        }
+    }
 }
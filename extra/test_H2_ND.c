@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "direct_nbody.h"
+
+/*
+ *  Test H2 matrices of the generic-dimension kernels in H2Pack_ND_kernels.h for 
+ *  point dimensions 4 to 8. For each dimension, random points are partitioned by 
+ *  the binary kd-tree, the H2 matrix is built with the sample point method in JIT 
+ *  mode, and H2P_matvec() is compared with direct_nbody() on n_check rows. The 
+ *  relative error should be at most ND_RELERR_FACTOR * rel_tol. The number of 
+ *  admissible pairs and the size of the U, B, and D matrices relative to the dense 
+ *  kernel matrix (about 0.5 if nothing is compressed, only half of the symmetric 
+ *  near-field blocks are stored) are also reported. With uniform random points, 
+ *  the Gaussian kernel, and rel_tol = 1e-6, the relative error is 3e-7 to 5e-7 for 
+ *  4D and at rounding error level for 5D to 8D. Only 4D is compressed at these sizes: 
+ *    4D: size ratio 0.43 for n_point = 20000, 0.31 for n_point = 40000; 
+ *    5D: admissible pairs for n_point >= 20000, but the calibrated sample points 
+ *        include all points of the nodes, size ratio 0.52 for n_point <= 40000; 
+ *    6D to 8D: no admissible pairs for n_point = 20000. 
+ *  
+ *  Example run: 
+ *  ./test_H2_ND.exe 20000 1e-6 1 4 8
+ *  Input: 
+ *      20000 --> number of points, random in a box with side length 20000^(1/pt_dim)
+ *      1e-6  --> relative tolerance of H2 construction
+ *      1     --> kernel: 1 Gaussian (l = 0.5), 3 Matern 3/2 (l = 1), 4 Matern 5/2 (l = 1)
+ *      4, 8  --> minimal and maximal point dimensions to test
+ */
+
+#define ND_RELERR_FACTOR 10.0
+
+static int test_ND(const int pt_dim, const int n_point, DTYPE rel_tol, const int kernel_id)
+{
+    DTYPE krnl_param[2] = {0.5, (DTYPE) pt_dim};
+    kernel_eval_fptr krnl_eval = Gaussian_ND_eval_intrin_t;
+    kernel_bimv_fptr krnl_bimv = Gaussian_ND_krnl_bimv_intrin_t;
+    int krnl_bimv_flops = Gaussian_ND_krnl_bimv_flop(pt_dim);
+    if (kernel_id == 3)
+    {
+        krnl_param[0]   = 1.0;
+        krnl_eval       = Matern32_ND_eval_intrin_t;
+        krnl_bimv       = Matern32_ND_krnl_bimv_intrin_t;
+        krnl_bimv_flops = Matern32_ND_krnl_bimv_flop(pt_dim);
+    }
+    if (kernel_id == 4)
+    {
+        krnl_param[0]   = 1.0;
+        krnl_eval       = Matern52_ND_eval_intrin_t;
+        krnl_bimv       = Matern52_ND_krnl_bimv_intrin_t;
+        krnl_bimv_flops = Matern52_ND_krnl_bimv_flop(pt_dim);
+    }
+
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * pt_dim, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / (DTYPE) pt_dim);
+    for (int i = 0; i < n_point * pt_dim; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    double st, et;
+    H2Pack_p h2pack;
+    H2P_dense_mat_p *sample_pt;
+    H2P_init(&h2pack, pt_dim, 1, QR_REL_NRM, &rel_tol);
+    H2P_calc_enclosing_box(pt_dim, n_point, coord, NULL, &h2pack->root_enbox);
+    H2P_partition_points(h2pack, n_point, coord, 0, 0);
+    st = get_wtime_sec();
+    H2P_select_sample_point(h2pack, krnl_param, krnl_eval, 0.7, &sample_pt);
+    H2P_build_with_sample_point(h2pack, sample_pt, 1, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+    et = get_wtime_sec();
+
+    // Compare with direct_nbody() on the first n_check rows
+    int n_check = (n_point < 2000) ? n_point : 2000;
+    DTYPE *x  = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    DTYPE *y0 = (DTYPE*) malloc(sizeof(DTYPE) * n_check);
+    DTYPE *y1 = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    assert(x != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < n_point; i++) x[i] = (DTYPE) drand48() - 0.5;
+    direct_nbody(
+        krnl_param, krnl_eval, pt_dim, 1, 
+        coord, n_point, n_point, x, 
+        coord, n_point, n_check, y0
+    );
+    H2P_matvec(h2pack, x, y1);
+    DTYPE y0_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n_check; i++)
+    {
+        DTYPE diff = y1[i] - y0[i];
+        y0_norm  += y0[i] * y0[i];
+        err_norm += diff * diff;
+    }
+    DTYPE relerr = DSQRT(err_norm) / DSQRT(y0_norm);
+
+    size_t *mat_size = h2pack->mat_size;
+    double UBD_size  = (double) (mat_size[U_SIZE_IDX] + mat_size[B_SIZE_IDX] + mat_size[D_SIZE_IDX]);
+    double dense_size = (double) n_point * (double) n_point;
+    int fail = !(relerr <= ND_RELERR_FACTOR * rel_tol);
+    printf(
+        "pt_dim = %d: %d levels, %5d admissible pairs, U + B + D size / dense size = %.3f, "
+        "build %.2lf (s), relerr = %.3e %s\n", pt_dim, h2pack->max_level + 1, h2pack->n_r_adm_pair, 
+        UBD_size / dense_size, et - st, relerr, fail ? "FAILED" : ""
+    );
+
+    for (int i = 0; i < h2pack->n_node; i++) H2P_dense_mat_destroy(&sample_pt[i]);
+    free(sample_pt);
+    free(x);
+    free(y0);
+    free(y1);
+    free_aligned(coord);
+    H2P_destroy(&h2pack);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point   = (argc >= 2) ? atoi(argv[1]) : 20000;
+    DTYPE rel_tol   = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-6;
+    int   kernel_id = (argc >= 4) ? atoi(argv[3]) : 1;
+    int   min_dim   = (argc >= 5) ? atoi(argv[4]) : 4;
+    int   max_dim   = (argc >= 6) ? atoi(argv[5]) : 8;
+    if (kernel_id != 1 && kernel_id != 3 && kernel_id != 4)
+    {
+        printf("Only Gaussian (1), 3/2 Matern (3), and 5/2 Matern (4) kernels support pt_dim > 3\n");
+        return 1;
+    }
+    if (min_dim < 4) min_dim = 4;
+    if (max_dim > 8) max_dim = 8;
+    printf("n_point = %d, rel_tol = %.2e, kernel_id = %d, pt_dim = %d to %d\n", n_point, rel_tol, kernel_id, min_dim, max_dim);
+
+    srand48(time(NULL));
+    int n_fail = 0;
+    for (int pt_dim = min_dim; pt_dim <= max_dim; pt_dim++)
+        n_fail += test_ND(pt_dim, n_point, rel_tol, kernel_id);
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test H2P_HSS_ULV_store_to_file() and H2P_HSS_ULV_read_from_file() on a 3D 
+ *  Gaussian kernel HSS matrix with a diagonal shift. 
+ *    1. For the ULV LU factorization, the ULV Cholesky factorization, and the 
+ *       Cholesky factorization with float factors, store the factorization, free 
+ *       it, reload it, and solve again. The solution and the log-determinant 
+ *       should be the same as before storing. 
+ *    2. Reading should fail and leave the H2Pack structure unchanged for a HSS 
+ *       matrix with a different partitioning tree, a truncated file, and a file 
+ *       whose DTYPE size field does not match this build. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_ULV_file.exe 8000 1e-8 1e-2 H2P_ULV_test.bin
+ *  Input: 
+ *      8000  --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-8  --> relative tolerance of HSS construction
+ *      1e-2  --> diagonal shift of K
+ *      H2P_ULV_test.bin --> binary file name, the file and a modified copy 
+ *                           (file name + ".bad") are removed after the test
+ */
+
+#define DTYPE_FIELD_OFFSET 12   // 8-byte magic + version, then the sizeof(DTYPE) field
+
+static DTYPE krnl_param[1] = {0.5};
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+static H2Pack_p build_HSS(const int n_point, DTYPE *coord, DTYPE rel_tol, const int max_leaf_points)
+{
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    H2P_init(&hssmat, 3, 1, QR_REL_NRM, &rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, n_point, coord, max_leaf_points, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        hssmat, pp, 0, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+    return hssmat;
+}
+
+static void ULV_solve(H2Pack_p hssmat, const DTYPE *b, DTYPE *x)
+{
+    if (hssmat->ULV_p != NULL) H2P_HSS_ULV_LU_solve(hssmat, 3, b, x);
+    else H2P_HSS_ULV_Cholesky_solve(hssmat, 3, b, x);
+}
+
+// Copy the first n_byte bytes of src_fname to dst_fname, and overwrite a 32-bit 
+// integer at byte offset int_offset with int_val if int_offset >= 0
+static void copy_file_prefix(const char *src_fname, const char *dst_fname, const long n_byte, const long int_offset, const int32_t int_val)
+{
+    FILE *src = fopen(src_fname, "rb");
+    FILE *dst = fopen(dst_fname, "wb");
+    assert(src != NULL && dst != NULL);
+    char *buf = (char*) malloc(n_byte);
+    assert(buf != NULL);
+    size_t n_read = fread(buf, 1, n_byte, src);
+    if (int_offset >= 0) memcpy(buf + int_offset, &int_val, sizeof(int32_t));
+    fwrite(buf, 1, n_read, dst);
+    free(buf);
+    fclose(src);
+    fclose(dst);
+}
+
+static long file_size(const char *fname)
+{
+    FILE *fp = fopen(fname, "rb");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+// Store, free, reload, and solve with the current factorization of hssmat, then 
+// check the rejection paths with the reloaded factorization in hssmat
+static int test_round_trip(H2Pack_p hssmat, H2Pack_p hssmat2, const char *name, const char *fname, const DTYPE *b)
+{
+    const int n = hssmat->krnl_mat_size;
+    DTYPE *x0 = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *x1 = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    assert(x0 != NULL && x1 != NULL);
+    printf("\n%s\n", name);
+
+    int n_fail = 0;
+    ULV_solve(hssmat, b, x0);
+    DTYPE logdet0 = hssmat->HSS_logdet;
+    size_t ULV_size0 = hssmat->mat_size[ULV_Q_SIZE_IDX] + hssmat->mat_size[ULV_L_SIZE_IDX];
+    H2P_HSS_ULV_store_to_file(hssmat, fname);
+    H2P_HSS_ULV_free(hssmat);
+    int ret = H2P_HSS_ULV_read_from_file(hssmat, fname);
+    size_t ULV_size1 = hssmat->mat_size[ULV_Q_SIZE_IDX] + hssmat->mat_size[ULV_L_SIZE_IDX];
+    if (ret != 0 || hssmat->ULV_idx == NULL)
+    {
+        printf("  Reading the stored factorization failed FAILED\n");
+        free(x0);
+        free(x1);
+        return n_fail + 1;
+    }
+    ULV_solve(hssmat, b, x1);
+    DTYPE relerr = calc_relerr(n, x0, x1);
+    int fail = (relerr != 0.0) || (hssmat->HSS_logdet != logdet0) || (ULV_size1 != ULV_size0);
+    printf(
+        "  File size %ld bytes, reloaded solve relerr = %.3e, logdet %.10e --> %.10e, ULV Q + L size %zu --> %zu %s\n", 
+        file_size(fname), relerr, logdet0, hssmat->HSS_logdet, ULV_size0, ULV_size1, fail ? "FAILED" : ""
+    );
+    n_fail += fail;
+
+    // Rejection paths, hssmat should keep the reloaded factorization
+    char bad_fname[1024];
+    snprintf(bad_fname, sizeof(bad_fname), "%s.bad", fname);
+    long fsize = file_size(fname);
+    int ret_tree = H2P_HSS_ULV_read_from_file(hssmat2, fname);
+    int tree_fail = (ret_tree != -1) || (hssmat2->ULV_idx != NULL);
+    copy_file_prefix(fname, bad_fname, fsize - 8, -1, 0);
+    int ret_trunc = H2P_HSS_ULV_read_from_file(hssmat, bad_fname);
+    copy_file_prefix(fname, bad_fname, fsize / 2, -1, 0);
+    int ret_trunc2 = H2P_HSS_ULV_read_from_file(hssmat, bad_fname);
+    copy_file_prefix(fname, bad_fname, fsize, DTYPE_FIELD_OFFSET, (int32_t) (sizeof(DTYPE) == 8 ? 4 : 8));
+    int ret_dtype = H2P_HSS_ULV_read_from_file(hssmat, bad_fname);
+    remove(bad_fname);
+    ULV_solve(hssmat, b, x1);
+    int unchanged_fail = (calc_relerr(n, x0, x1) != 0.0) || (hssmat->HSS_logdet != logdet0);
+    printf(
+        "  Rejected: different tree %s, truncated file %s %s, DTYPE mismatch %s; factorization unchanged %s\n", 
+        tree_fail ? "FAILED" : "yes", (ret_trunc == -1) ? "yes" : "FAILED", (ret_trunc2 == -1) ? "yes" : "FAILED",
+        (ret_dtype == -1) ? "yes" : "FAILED", unchanged_fail ? "FAILED" : "yes"
+    );
+    n_fail += tree_fail + (ret_trunc != -1) + (ret_trunc2 != -1) + (ret_dtype != -1) + unchanged_fail;
+
+    free(x0);
+    free(x1);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    DTYPE shift   = (argc >= 4) ? (DTYPE) atof(argv[3]) : 1e-2;
+    const char *fname = (argc >= 5) ? argv[4] : "H2P_ULV_test.bin";
+    printf("n_point = %d, rel_tol = %.2e, shift = %.2e, binary file = %s\n", n_point, rel_tol, shift, fname);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    DTYPE *b     = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    assert(coord != NULL && b != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+    for (int i = 0; i < n_point; i++) b[i] = (DTYPE) drand48() - 0.5;
+
+    // hssmat2 has the same points but a different partitioning tree
+    H2Pack_p hssmat  = build_HSS(n_point, coord, rel_tol, 0);
+    H2Pack_p hssmat2 = build_HSS(n_point, coord, rel_tol, hssmat->max_leaf_points / 2);
+
+    int n_fail = 0;
+    H2P_HSS_ULV_LU_factorize(hssmat, shift);
+    n_fail += test_round_trip(hssmat, hssmat2, "ULV LU factorization", fname, b);
+    H2P_HSS_ULV_Cholesky_factorize(hssmat, shift);
+    n_fail += test_round_trip(hssmat, hssmat2, "ULV Cholesky factorization", fname, b);
+    H2P_HSS_ULV_to_float(hssmat);
+    n_fail += test_round_trip(hssmat, hssmat2, "ULV Cholesky factorization, float factors", fname, b);
+    remove(fname);
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    H2P_destroy(&hssmat);
+    H2P_destroy(&hssmat2);
+    free_aligned(coord);
+    free(b);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test H2P_HSS_ULV_to_float() and H2P_HSS_ULV_solve_refine() on a 3D Gaussian 
+ *  kernel k(x, y) = exp(-l * |x-y|^2) with a diagonal shift. For the ULV LU and 
+ *  Cholesky factorizations: 
+ *    1. After H2P_HSS_ULV_to_float(), the ULV Q and L sizes in h2pack->mat_size 
+ *       should be halved and the ULV solve with float factors should match the 
+ *       solve with DTYPE factors to about single precision (relative error 
+ *       <= FP32_RELTOL); 
+ *    2. H2P_HSS_ULV_solve_refine() with the float factors and H2P_matvec() of the 
+ *       same HSS matrix for residuals should reach a relative residual <= REFINE_RELTOL 
+ *       within REFINE_MAX_ITER steps, and its solution should match the solve with 
+ *       DTYPE factors. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_ULV_float.exe 8000 1e-10 1e-2
+ *  Input: 
+ *      8000  --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-10 --> relative tolerance of HSS construction
+ *      1e-2  --> diagonal shift of K
+ */
+
+#define FP32_RELTOL     1e-3
+#define REFINE_RELTOL   1e-12
+#define REFINE_MAX_ITER 4
+
+static DTYPE krnl_param[1] = {0.5};
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+static void ULV_factorize(H2Pack_p hssmat, const int is_LU, const DTYPE shift)
+{
+    if (is_LU) H2P_HSS_ULV_LU_factorize(hssmat, shift);
+    else H2P_HSS_ULV_Cholesky_factorize(hssmat, shift);
+}
+
+static void ULV_solve(H2Pack_p hssmat, const int is_LU, const DTYPE *b, DTYPE *x)
+{
+    if (is_LU) H2P_HSS_ULV_LU_solve(hssmat, 3, b, x);
+    else H2P_HSS_ULV_Cholesky_solve(hssmat, 3, b, x);
+}
+
+static int test_float_ULV(H2Pack_p hssmat, const int is_LU, const DTYPE shift)
+{
+    const char *name = is_LU ? "LU" : "Cholesky";
+    const int n = hssmat->krnl_mat_size;
+    DTYPE *b  = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *x0 = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *x1 = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    assert(b != NULL && x0 != NULL && x1 != NULL);
+    for (int i = 0; i < n; i++) b[i] = (DTYPE) drand48() - 0.5;
+    printf("\nULV %s factorization\n", name);
+
+    // 1. Reference solution with DTYPE factors
+    int n_fail = 0;
+    ULV_factorize(hssmat, is_LU, shift);
+    ULV_solve(hssmat, is_LU, b, x0);
+    size_t Q_size0 = hssmat->mat_size[ULV_Q_SIZE_IDX];
+    size_t L_size0 = hssmat->mat_size[ULV_L_SIZE_IDX];
+    DTYPE relres = 0.0;
+    int n_iter = H2P_HSS_ULV_solve_refine(hssmat, hssmat, shift, REFINE_MAX_ITER, REFINE_RELTOL, b, x1, &relres);
+    printf("  DTYPE factors: refinement steps = %d, relres = %.3e\n", n_iter, relres);
+    if (!(n_iter >= 0 && n_iter <= 1 && relres <= REFINE_RELTOL)) n_fail++;
+
+    // 2. Float factors
+    double st = get_wtime_sec();
+    H2P_HSS_ULV_to_float(hssmat);
+    double et = get_wtime_sec();
+    size_t Q_size1 = hssmat->mat_size[ULV_Q_SIZE_IDX];
+    size_t L_size1 = hssmat->mat_size[ULV_L_SIZE_IDX];
+    double size_ratio = (double) sizeof(float) / (double) sizeof(DTYPE);
+    int size_fail = (Q_size1 != (size_t) ((double) Q_size0 * size_ratio)) || 
+                    (L_size1 != (size_t) ((double) L_size0 * size_ratio));
+    printf(
+        "  H2P_HSS_ULV_to_float used %.3lf (s), ULV Q + L size %zu --> %zu %s\n", 
+        et - st, Q_size0 + L_size0, Q_size1 + L_size1, size_fail ? "FAILED" : ""
+    );
+    n_fail += size_fail;
+    ULV_solve(hssmat, is_LU, b, x1);
+    DTYPE fp32_relerr = calc_relerr(n, x0, x1);
+    printf("  Float factors solve relerr = %.3e %s\n", fp32_relerr, (fp32_relerr <= FP32_RELTOL) ? "" : "FAILED");
+    if (!(fp32_relerr <= FP32_RELTOL)) n_fail++;
+
+    // 3. Iterative refinement with float factors
+    st = get_wtime_sec();
+    n_iter = H2P_HSS_ULV_solve_refine(hssmat, hssmat, shift, REFINE_MAX_ITER, REFINE_RELTOL, b, x1, &relres);
+    et = get_wtime_sec();
+    DTYPE refine_relerr = calc_relerr(n, x0, x1);
+    int refine_fail = !(n_iter >= 0 && relres <= REFINE_RELTOL && refine_relerr <= 1e3 * REFINE_RELTOL);
+    printf(
+        "  Float factors + refinement used %.3lf (s): steps = %d, relres = %.3e, relerr = %.3e %s\n", 
+        et - st, n_iter, relres, refine_relerr, refine_fail ? "FAILED" : ""
+    );
+    n_fail += refine_fail;
+
+    free(b);
+    free(x0);
+    free(x1);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-10;
+    DTYPE shift   = (argc >= 4) ? (DTYPE) atof(argv[3]) : 1e-2;
+    printf("n_point = %d, rel_tol = %.2e, shift = %.2e\n", n_point, rel_tol, shift);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    H2P_init(&hssmat, 3, 1, QR_REL_NRM, &rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        hssmat, pp, 0, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+
+    int n_fail = 0;
+    n_fail += test_float_ULV(hssmat, 1, shift);
+    n_fail += test_float_ULV(hssmat, 0, shift);
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    H2P_destroy(&hssmat);
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test H2P_HSS_ULV_LU_matsolve() and H2P_HSS_ULV_Cholesky_matsolve() on a 3D 
+ *  Gaussian kernel HSS matrix with a diagonal shift. For op = 1, 2, 3 and for 
+ *  row-major and column-major right-hand sides (with leading dimensions larger 
+ *  than the matrix sizes), the multiple right-hand side solves should match 
+ *  H2P_HSS_ULV_LU_solve() and H2P_HSS_ULV_Cholesky_solve() applied to each column. 
+ *  The time of one matsolve and n_vec single-vector solves are also reported. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_ULV_matsolve.exe 8000 1e-8 1e-2 16
+ *  Input: 
+ *      8000 --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-8 --> relative tolerance of HSS construction
+ *      1e-2 --> diagonal shift of K
+ *      16   --> number of right-hand side vectors
+ */
+
+#define SAME_RELTOL 1e-12
+
+static DTYPE krnl_param[1] = {0.5};
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+static int test_matsolve(H2Pack_p hssmat, const int is_LU, const int n_vec)
+{
+    const int n = hssmat->krnl_mat_size;
+    const int ld_col = n + 3, ld_row = n_vec + 3;
+    size_t buf_size = (size_t) ld_col * (size_t) n_vec;
+    if ((size_t) n * (size_t) ld_row > buf_size) buf_size = (size_t) n * (size_t) ld_row;
+    DTYPE *B  = (DTYPE*) malloc(sizeof(DTYPE) * n * n_vec);
+    DTYPE *X0 = (DTYPE*) malloc(sizeof(DTYPE) * n * n_vec);
+    DTYPE *X1 = (DTYPE*) malloc(sizeof(DTYPE) * n * n_vec);
+    DTYPE *mat_b = (DTYPE*) malloc(sizeof(DTYPE) * buf_size);
+    DTYPE *mat_x = (DTYPE*) malloc(sizeof(DTYPE) * buf_size);
+    assert(B != NULL && X0 != NULL && X1 != NULL && mat_b != NULL && mat_x != NULL);
+    // B and X0, X1 store each vector contiguously
+    for (int i = 0; i < n * n_vec; i++) B[i] = (DTYPE) drand48() - 0.5;
+    printf("\nULV %s factorization, n_vec = %d\n", is_LU ? "LU" : "Cholesky", n_vec);
+
+    int n_fail = 0;
+    for (int op = 1; op <= 3; op++)
+    {
+        // Reference: single right-hand side solves
+        double st = get_wtime_sec();
+        for (int j = 0; j < n_vec; j++)
+        {
+            if (is_LU) H2P_HSS_ULV_LU_solve(hssmat, op, B + j * n, X0 + j * n);
+            else H2P_HSS_ULV_Cholesky_solve(hssmat, op, B + j * n, X0 + j * n);
+        }
+        double et = get_wtime_sec();
+        double ut_solve = et - st;
+
+        for (int row_major = 0; row_major <= 1; row_major++)
+        {
+            CBLAS_LAYOUT layout = row_major ? CblasRowMajor : CblasColMajor;
+            int ld = row_major ? ld_row : ld_col;
+            for (size_t i = 0; i < buf_size; i++) mat_x[i] = 0.0;
+            for (int j = 0; j < n_vec; j++)
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    if (row_major) mat_b[i * ld + j] = B[j * n + i];
+                    else mat_b[j * ld + i] = B[j * n + i];
+                }
+            }
+            st = get_wtime_sec();
+            if (is_LU) H2P_HSS_ULV_LU_matsolve(hssmat, op, layout, n_vec, mat_b, ld, mat_x, ld);
+            else H2P_HSS_ULV_Cholesky_matsolve(hssmat, op, layout, n_vec, mat_b, ld, mat_x, ld);
+            et = get_wtime_sec();
+            for (int j = 0; j < n_vec; j++)
+            {
+                for (int i = 0; i < n; i++)
+                    X1[j * n + i] = row_major ? mat_x[i * ld + j] : mat_x[j * ld + i];
+            }
+            DTYPE relerr = calc_relerr(n * n_vec, X0, X1);
+            int fail = !(relerr <= SAME_RELTOL);
+            printf(
+                "  op = %d, %s: matsolve %.3lf (s), %d solves %.3lf (s), relerr = %.3e %s\n", 
+                op, row_major ? "row-major" : "col-major", et - st, n_vec, ut_solve, relerr, fail ? "FAILED" : ""
+            );
+            n_fail += fail;
+        }
+    }
+
+    free(B);
+    free(X0);
+    free(X1);
+    free(mat_b);
+    free(mat_x);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    DTYPE shift   = (argc >= 4) ? (DTYPE) atof(argv[3]) : 1e-2;
+    int   n_vec   = (argc >= 5) ? atoi(argv[4]) : 16;
+    printf("n_point = %d, rel_tol = %.2e, shift = %.2e, n_vec = %d\n", n_point, rel_tol, shift, n_vec);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    H2P_init(&hssmat, 3, 1, QR_REL_NRM, &rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        hssmat, pp, 0, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+
+    int n_fail = 0;
+    H2P_HSS_ULV_LU_factorize(hssmat, shift);
+    n_fail += test_matsolve(hssmat, 1, n_vec);
+    n_fail += test_matsolve(hssmat, 1, 1);
+    H2P_HSS_ULV_Cholesky_factorize(hssmat, shift);
+    n_fail += test_matsolve(hssmat, 0, n_vec);
+    n_fail += test_matsolve(hssmat, 0, 1);
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    H2P_destroy(&hssmat);
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "parse_scalar_params.h"
+
+/*
+ *  Test multi-shift HSS ULV Cholesky factorization and log-determinants against 
+ *  the single-shift H2P_HSS_ULV_Cholesky_factorize() on the same HSS matrix. Both 
+ *  paths factorize the same matrix, so the results should only differ by rounding 
+ *  errors. If the matrix is small, log(det(A + k * I)) of the dense kernel matrix 
+ *  is also computed to check the HSS approximation. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_ULV_mshift.exe 3 2000 1e-8 0 1 pp.bin none 1e-2 5
+ *  Input: 
+ *      First 7 parameters --> the same as other test programs (parse_scalar_params.h), 
+ *                             use a coordinate file name without .csv or .bin to use random points, 
+ *                             the kernel should be SPD (e.g., Gaussian or Matern)
+ *      1e-2 --> smallest diagonal shift
+ *      5    --> number of diagonal shifts, shifts[i] = 1e-2 * 10^i
+ */
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+// log(det(K + shift * I)) of the dense kernel matrix K, NAN if not SPD
+static DTYPE dense_logdet(const DTYPE shift)
+{
+    const int n = test_params.n_point;
+    DTYPE *K = (DTYPE*) malloc(sizeof(DTYPE) * n * n);
+    assert(K != NULL);
+    test_params.krnl_eval(
+        test_params.coord, n, n, test_params.coord, n, n, 
+        test_params.krnl_param, K, n
+    );
+    for (int i = 0; i < n; i++) K[i * n + i] += shift;
+    int info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', n, K, n);
+    DTYPE logdet = NAN;
+    if (info == 0)
+    {
+        logdet = 0.0;
+        for (int i = 0; i < n; i++) logdet += 2.0 * DLOG(K[i * n + i]);
+    }
+    free(K);
+    return logdet;
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+    
+    parse_scalar_params(argc, argv);
+    DTYPE shift0 = (argc >= 9)  ? (DTYPE) atof(argv[8]) : 1e-2;
+    int n_shift  = (argc >= 10) ? atoi(argv[9]) : 5;
+    DTYPE *shifts  = (DTYPE*) malloc(sizeof(DTYPE) * n_shift);
+    DTYPE *logdets = (DTYPE*) malloc(sizeof(DTYPE) * n_shift);
+    assert(shifts != NULL && logdets != NULL);
+    for (int i = 0; i < n_shift; i++) shifts[i] = shift0 * DPOW(10.0, (DTYPE) i);
+    printf("Number of diagonal shifts = %d, smallest shift = %.2e\n", n_shift, shift0);
+
+    double st, et;
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    
+    // 1. HSS matrix from the kernel function
+    H2P_init(&hssmat, test_params.pt_dim, test_params.krnl_dim, QR_REL_NRM, &test_params.rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(test_params.pt_dim, test_params.n_point, test_params.coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, test_params.n_point, test_params.coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, test_params.krnl_param, test_params.krnl_eval, NULL, &pp);
+    H2P_build(
+        hssmat, pp, test_params.BD_JIT, test_params.krnl_param, 
+        test_params.krnl_eval, test_params.krnl_bimv, test_params.krnl_bimv_flops
+    );
+
+    // 2. Multi-shift log-determinants
+    H2P_HSS_ULV_mshift_p mshift;
+    st = get_wtime_sec();
+    H2P_HSS_ULV_mshift_init(hssmat, &mshift);
+    et = get_wtime_sec();
+    printf("H2P_HSS_ULV_mshift_init   used %.3lf (s)\n", et - st);
+    st = get_wtime_sec();
+    H2P_HSS_ULV_mshift_logdet(hssmat, mshift, n_shift, shifts, logdets);
+    et = get_wtime_sec();
+    printf("H2P_HSS_ULV_mshift_logdet used %.3lf (s) for %d shifts\n", et - st, n_shift);
+
+    DTYPE *x0, *x1, *x2, *y0;
+    x0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    x1 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    x2 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    y0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    assert(x0 != NULL && x1 != NULL && x2 != NULL && y0 != NULL);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) 
+        x0[i] = (DTYPE) drand48() - 0.5;
+    H2P_matvec(hssmat, x0, y0);
+
+    // 3. Compare each shift with the single-shift ULV Cholesky factorization
+    int n_fail = 0;
+    for (int i = 0; i < n_shift; i++)
+    {
+        DTYPE shift = shifts[i];
+        for (int j = 0; j < test_params.krnl_mat_size; j++) y0[j] += shift * x0[j];
+        printf("\nShift = %.2e\n", shift);
+
+        st = get_wtime_sec();
+        H2P_HSS_ULV_Cholesky_factorize(hssmat, shift);
+        et = get_wtime_sec();
+        int   is_SPD1  = hssmat->is_HSS_SPD;
+        DTYPE logdet1  = hssmat->HSS_logdet;
+        if (is_SPD1) H2P_HSS_ULV_Cholesky_solve(hssmat, 3, y0, x1);
+        printf("H2P_HSS_ULV_Cholesky_factorize        used %.3lf (s), SPD = %d\n", et - st, is_SPD1);
+
+        st = get_wtime_sec();
+        H2P_HSS_ULV_mshift_Cholesky_factorize(hssmat, mshift, shift);
+        et = get_wtime_sec();
+        int   is_SPD2  = hssmat->is_HSS_SPD;
+        DTYPE logdet2  = hssmat->HSS_logdet;
+        if (is_SPD2) H2P_HSS_ULV_Cholesky_solve(hssmat, 3, y0, x2);
+        printf("H2P_HSS_ULV_mshift_Cholesky_factorize used %.3lf (s), SPD = %d\n", et - st, is_SPD2);
+
+        if (is_SPD1 != is_SPD2 || is_SPD1 != !isnan(logdets[i]))
+        {
+            printf("Single-shift and multi-shift disagree on SPD\n");
+            n_fail++;
+        }
+        if (is_SPD1 && is_SPD2)
+        {
+            DTYPE err1 = DABS(logdets[i] - logdet1) / DABS(logdet1);
+            DTYPE err2 = DABS(logdet2    - logdet1) / DABS(logdet1);
+            DTYPE err3 = calc_relerr(test_params.krnl_mat_size, x1, x2);
+            printf("logdet: single-shift = %.15e, mshift_logdet = %.15e\n", logdet1, logdets[i]);
+            printf("mshift_logdet             vs. single-shift logdet relerr = %e\n", err1);
+            printf("mshift_Cholesky_factorize vs. single-shift logdet relerr = %e\n", err2);
+            printf("mshift_Cholesky_factorize vs. single-shift solve  relerr = %e\n", err3);
+            printf("mshift_Cholesky_factorize solve vs. exact x       relerr = %e\n", calc_relerr(test_params.krnl_mat_size, x0, x2));
+            if (!(err1 <= 1e-12 && err2 <= 1e-12 && err3 <= 1e-8)) n_fail++;
+        }
+        if (test_params.n_point <= 4000)
+        {
+            DTYPE logdet0 = dense_logdet(shift);
+            printf("Dense kernel matrix logdet = %.15e, HSS approximation relerr = %e\n", logdet0, DABS(logdets[i] - logdet0) / DABS(logdet0));
+        }
+
+        for (int j = 0; j < test_params.krnl_mat_size; j++) y0[j] -= shift * x0[j];
+    }
+    printf("\n%s: %d shift(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free(x0);
+    free(x1);
+    free(x2);
+    free(y0);
+    free(shifts);
+    free(logdets);
+    free_aligned(test_params.coord);
+    H2P_HSS_ULV_mshift_destroy(&mshift);
+    H2P_destroy(&hssmat);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test the stochastic trace estimators H2P_HSS_ULV_trace_Kinv_dK() on a 3D Gaussian 
+ *  kernel k(x, y) = exp(-l * |x-y|^2) and its derivative w.r.t. l. The estimates of 
+ *  tr(K^{-1} * dK/dl) and tr(K^{-1}) are compared with the exact traces of the same 
+ *  HSS / H2 operators, computed with n ULV solves and n dK/dl matvecs, and they should 
+ *  be within a few reported standard errors. The estimates should not depend on the 
+ *  probe block size. If the matrix is small, the exact traces of the dense kernel 
+ *  matrices are also computed to check the HSS approximation. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_ULV_trace.exe 2000 1e-8 1e-2 120 32
+ *  Input: 
+ *      2000 --> number of points, random in a cubic box with side length 2000^(1/3)
+ *      1e-8 --> relative tolerance of HSS construction
+ *      1e-2 --> diagonal shift of K
+ *      120  --> number of probe vectors
+ *      32   --> probe block size
+ */
+
+#define N_METHOD 2
+
+static DTYPE krnl_param[1] = {0.5};
+
+// Exact tr(K^{-1} * dK/dl) and tr(K^{-1}) of the HSS ULV factorization and the 
+// derivative kernel H2 / HSS matrix, blk_size unit vectors at a time
+static void exact_HSS_trace(H2Pack_p hssmat, H2P_dkrnl_p dkrnl, const int blk_size, DTYPE *tr_dK, DTYPE *tr_inv)
+{
+    const int n = hssmat->krnl_mat_size;
+    DTYPE *E  = (DTYPE*) malloc(sizeof(DTYPE) * n * blk_size);
+    DTYPE *dE = (DTYPE*) malloc(sizeof(DTYPE) * n * blk_size);
+    DTYPE *X  = (DTYPE*) malloc(sizeof(DTYPE) * n * blk_size);
+    assert(E != NULL && dE != NULL && X != NULL);
+    *tr_dK  = 0.0;
+    *tr_inv = 0.0;
+    for (int s = 0; s < n; s += blk_size)
+    {
+        int nb = (s + blk_size <= n) ? blk_size : (n - s);
+        memset(E, 0, sizeof(DTYPE) * n * nb);
+        for (int j = 0; j < nb; j++) E[j * n + s + j] = 1.0;
+        H2P_matmul_dkrnl(hssmat, dkrnl, 0, CblasColMajor, nb, E, n, dE, n);
+        H2P_HSS_ULV_Cholesky_matsolve(hssmat, 3, CblasColMajor, nb, dE, n, X, n);
+        for (int j = 0; j < nb; j++) *tr_dK += X[j * n + s + j];
+        H2P_HSS_ULV_Cholesky_matsolve(hssmat, 3, CblasColMajor, nb, E, n, X, n);
+        for (int j = 0; j < nb; j++) *tr_inv += X[j * n + s + j];
+    }
+    free(E);
+    free(dE);
+    free(X);
+}
+
+// Exact tr((K + shift * I)^{-1} * dK/dl) and tr((K + shift * I)^{-1}) of the dense kernel matrices
+static void exact_dense_trace(const int n, DTYPE *coord, const DTYPE shift, DTYPE *tr_dK, DTYPE *tr_inv)
+{
+    DTYPE *K  = (DTYPE*) malloc(sizeof(DTYPE) * n * n);
+    DTYPE *dK = (DTYPE*) malloc(sizeof(DTYPE) * n * n);
+    assert(K != NULL && dK != NULL);
+    Gaussian_3D_eval_intrin_t   (coord, n, n, coord, n, n, krnl_param, K,  n);
+    Gaussian_dl_3D_eval_intrin_t(coord, n, n, coord, n, n, krnl_param, dK, n);
+    for (int i = 0; i < n; i++) K[i * n + i] += shift;
+    int info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', n, K, n);
+    assert(info == 0);
+    LAPACK_POTRS(LAPACK_ROW_MAJOR, 'L', n, n, K, n, dK, n);
+    *tr_dK = 0.0;
+    for (int i = 0; i < n; i++) *tr_dK += dK[i * n + i];
+    memset(dK, 0, sizeof(DTYPE) * n * n);
+    for (int i = 0; i < n; i++) dK[i * n + i] = 1.0;
+    LAPACK_POTRS(LAPACK_ROW_MAJOR, 'L', n, n, K, n, dK, n);
+    *tr_inv = 0.0;
+    for (int i = 0; i < n; i++) *tr_inv += dK[i * n + i];
+    free(K);
+    free(dK);
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point  = (argc >= 2) ? atoi(argv[1]) : 2000;
+    DTYPE rel_tol  = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    DTYPE shift    = (argc >= 4) ? (DTYPE) atof(argv[3]) : 1e-2;
+    int   n_probe  = (argc >= 5) ? atoi(argv[4]) : 120;
+    int   blk_size = (argc >= 6) ? atoi(argv[5]) : 32;
+    printf("n_point = %d, rel_tol = %.2e, shift = %.2e, n_probe = %d, blk_size = %d\n", n_point, rel_tol, shift, n_probe, blk_size);
+
+    // 1. Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    // 2. HSS matrix of K, its ULV Cholesky factorization, and dK/dl
+    double st, et;
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    H2P_init(&hssmat, 3, 1, QR_REL_NRM, &rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        hssmat, pp, 0, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+    H2P_HSS_ULV_Cholesky_factorize(hssmat, shift);
+    if (!hssmat->is_HSS_SPD)
+    {
+        printf("HSS matrix with shift %.2e is not SPD, try a larger shift\n", shift);
+        return 1;
+    }
+
+    void *dkrnl_param[1] = {krnl_param};
+    kernel_eval_fptr dkrnl_eval[1] = {Gaussian_dl_3D_eval_intrin_t};
+    kernel_bimv_fptr dkrnl_bimv[1] = {Gaussian_dl_3D_krnl_bimv_intrin_t};
+    int dkrnl_bimv_flops[1] = {Gaussian_dl_3D_krnl_bimv_flop};
+    H2P_dkrnl_p dkrnl;
+    H2P_dkrnl_build(hssmat, 1, dkrnl_param, dkrnl_eval, dkrnl_bimv, dkrnl_bimv_flops, &dkrnl);
+
+    // 3. Exact traces of the same operators
+    DTYPE tr_dK0, tr_inv0;
+    st = get_wtime_sec();
+    exact_HSS_trace(hssmat, dkrnl, 200, &tr_dK0, &tr_inv0);
+    et = get_wtime_sec();
+    printf("Exact HSS traces used %.3lf (s): tr(K^{-1} * dK/dl) = %.10e, tr(K^{-1}) = %.10e\n", et - st, tr_dK0, tr_inv0);
+    if (n_point <= 4000)
+    {
+        DTYPE tr_dK1, tr_inv1;
+        exact_dense_trace(n_point, coord, shift, &tr_dK1, &tr_inv1);
+        printf("Dense kernel matrix traces         : tr(K^{-1} * dK/dl) = %.10e, tr(K^{-1}) = %.10e\n", tr_dK1, tr_inv1);
+        printf("HSS vs. dense relerr: tr(K^{-1} * dK/dl) %.3e, tr(K^{-1}) %.3e\n", 
+                DABS(tr_dK0 - tr_dK1) / DABS(tr_dK1), DABS(tr_inv0 - tr_inv1) / DABS(tr_inv1));
+    }
+
+    // 4. Stochastic estimates, with blocked probes and with all probes in one block
+    const char *method_name[N_METHOD] = {"Hutchinson", "Hutch++"};
+    const unsigned long long seed = 19241;
+    int n_fail = 0;
+    for (int method = 0; method < N_METHOD; method++)
+    {
+        DTYPE tr_dK[2], tr_dK_err[2], tr_inv[2], tr_inv_err[2];
+        for (int i = 0; i < 2; i++)
+        {
+            int bs = (i == 0) ? blk_size : n_probe;
+            st = get_wtime_sec();
+            int ret1 = H2P_HSS_ULV_trace_Kinv_dK(hssmat, dkrnl, method, n_probe, bs, seed, &tr_dK[i], &tr_dK_err[i]);
+            int ret2 = H2P_HSS_ULV_trace_Kinv_dK(hssmat, NULL,  method, n_probe, bs, seed, &tr_inv[i], &tr_inv_err[i]);
+            et = get_wtime_sec();
+            if (ret1 != 0 || ret2 != 0) 
+            {
+                printf("%-10s blk_size = %3d failed\n", method_name[method], bs);
+                n_fail++;
+                continue;
+            }
+            printf(
+                "%-10s blk_size = %3d used %.3lf (s): tr(K^{-1} * dK/dl) = %.10e +- %.2e, tr(K^{-1}) = %.10e +- %.2e\n", 
+                method_name[method], bs, et - st, tr_dK[i], tr_dK_err[i], tr_inv[i], tr_inv_err[i]
+            );
+        }
+        // Within 4 standard errors of the exact traces, the bound is loose enough 
+        // that a correct estimator fails with probability < 1e-4
+        DTYPE z_dK  = DABS(tr_dK[0]  - tr_dK0)  / tr_dK_err[0];
+        DTYPE z_inv = DABS(tr_inv[0] - tr_inv0) / tr_inv_err[0];
+        DTYPE blk_diff = DABS(tr_dK[0] - tr_dK[1]) / DABS(tr_dK[1]) + DABS(tr_inv[0] - tr_inv[1]) / DABS(tr_inv[1]);
+        printf(
+            "%-10s |estimate - exact| / standard error: tr(K^{-1} * dK/dl) %.2f, tr(K^{-1}) %.2f; blk_size relerr %.2e\n", 
+            method_name[method], z_dK, z_inv, blk_diff
+        );
+        if (!(z_dK <= 4.0 && z_inv <= 4.0 && blk_diff <= 1e-10)) n_fail++;
+    }
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    H2P_dkrnl_destroy(&dkrnl);
+    H2P_destroy(&hssmat);
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
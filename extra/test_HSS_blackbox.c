@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "parse_scalar_params.h"
+
+/*
+ *  Test black-box HSS construction using an H2 matrix as the operator, compared with 
+ *  the HSS matrix constructed by H2P_build() directly from the kernel function. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_blackbox.exe 2 10000 1e-8 1 1 pp.bin none 300 1e-2
+ *  Input: 
+ *      First 7 parameters --> the same as other test programs (parse_scalar_params.h), 
+ *                             use a coordinate file name without .csv or .bin to use random points
+ *      300  --> maximum rank of the black-box HSS matrix
+ *      1e-2 --> diagonal shift
+ */
+
+static void H2_op_matmul(
+    void *op_param, const int n_vec, const DTYPE *mat_x, const int ldx, 
+    DTYPE *mat_y, const int ldy
+)
+{
+    H2P_matmul((H2Pack_p) op_param, CblasColMajor, n_vec, mat_x, ldx, mat_y, ldy);
+}
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+    
+    parse_scalar_params(argc, argv);
+    int max_rank = (argc >= 9)  ? atoi(argv[8]) : 200;
+    DTYPE shift  = (argc >= 10) ? (DTYPE) atof(argv[9]) : 1e-2;
+    printf("Black-box HSS max rank = %d, diagonal shift = %.2e\n", max_rank, shift);
+
+    double st, et;
+    H2Pack_p h2mat, hssmat, bbhss;
+    H2P_dense_mat_p *pp;
+    
+    // 1. H2 matrix as the operator
+    H2P_init(&h2mat, test_params.pt_dim, test_params.krnl_dim, QR_REL_NRM, &test_params.rel_tol);
+    H2P_calc_enclosing_box(test_params.pt_dim, test_params.n_point, test_params.coord, NULL, &h2mat->root_enbox);
+    H2P_partition_points(h2mat, test_params.n_point, test_params.coord, 0, 0);
+    H2P_HSS_calc_adm_inadm_pairs(h2mat);
+    H2P_generate_proxy_point_ID_file(h2mat, test_params.krnl_param, test_params.krnl_eval, NULL, &pp);
+    H2P_build(
+        h2mat, pp, test_params.BD_JIT, test_params.krnl_param, 
+        test_params.krnl_eval, test_params.krnl_bimv, test_params.krnl_bimv_flops
+    );
+
+    // 2. HSS matrix from the kernel function
+    H2P_init(&hssmat, test_params.pt_dim, test_params.krnl_dim, QR_REL_NRM, &test_params.rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(test_params.pt_dim, test_params.n_point, test_params.coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, test_params.n_point, test_params.coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, test_params.krnl_param, test_params.krnl_eval, NULL, &pp);
+    H2P_build(
+        hssmat, pp, 0, test_params.krnl_param, 
+        test_params.krnl_eval, test_params.krnl_bimv, test_params.krnl_bimv_flops
+    );
+
+    // 3. Black-box HSS matrix from H2 matmul
+    st = get_wtime_sec();
+    H2P_HSS_blackbox_build(h2mat, H2_op_matmul, h2mat, max_rank, test_params.rel_tol, shift, &bbhss);
+    et = get_wtime_sec();
+    printf("H2P_HSS_blackbox_build used %.3lf (s)\n", et - st);
+
+    DTYPE *x0, *x1, *y0, *y1;
+    x0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    x1 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    y0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    y1 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    assert(x0 != NULL && x1 != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) 
+        x0[i] = (DTYPE) drand48() - 0.5;
+
+    // 4. Matvec accuracy, y0 = (A_{H2} + shift * I) * x0 is the reference
+    H2P_matvec(h2mat, x0, y0);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) y0[i] += shift * x0[i];
+    H2P_matvec(hssmat, x0, y1);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) y1[i] += shift * x0[i];
+    printf("H2P_build HSS      matvec relerr = %e\n", calc_relerr(test_params.krnl_mat_size, y0, y1));
+    H2P_matvec(bbhss, x0, y1);
+    printf("Black-box HSS      matvec relerr = %e\n", calc_relerr(test_params.krnl_mat_size, y0, y1));
+
+    // 5. ULV LU solve, the black-box HSS matrix may be not SPD, so the 
+    //    ULV Cholesky factorization is only tried
+    H2P_HSS_ULV_LU_factorize(hssmat, shift);
+    H2P_HSS_ULV_LU_solve(hssmat, 3, y0, x1);
+    printf("H2P_build HSS      ULV LU solve relerr = %e\n", calc_relerr(test_params.krnl_mat_size, x0, x1));
+    H2P_HSS_ULV_LU_factorize(bbhss, 0.0);
+    H2P_HSS_ULV_LU_solve(bbhss, 3, y0, x1);
+    printf("Black-box HSS      ULV LU solve relerr = %e\n", calc_relerr(test_params.krnl_mat_size, x0, x1));
+    H2P_HSS_ULV_Cholesky_factorize(bbhss, 0.0);
+    if (bbhss->is_HSS_SPD)
+    {
+        H2P_HSS_ULV_Cholesky_solve(bbhss, 3, y0, x1);
+        printf("Black-box HSS      ULV Cholesky solve relerr = %e\n", calc_relerr(test_params.krnl_mat_size, x0, x1));
+    } else {
+        printf("Black-box HSS      ULV Cholesky factorization failed, use ULV LU instead\n");
+    }
+
+    H2P_print_statistic(bbhss);
+
+    free(x0);
+    free(x1);
+    free(y0);
+    free(y1);
+    free_aligned(test_params.coord);
+    H2P_destroy(&h2mat);
+    H2P_destroy(&hssmat);
+    H2P_destroy(&bbhss);
+    return 0;
+}
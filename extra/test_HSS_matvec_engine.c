@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test the sibling-only HSS matvec engine (H2P_HSS_matvec() and H2P_HSS_matmul()) 
+ *  against the generic H2 matvec / matmul path over HSS_r_adm_pairs, which is used 
+ *  when h2pack->HSS_mv_mode == -1. The 3D Coulomb kernel (krnl_dim = 1) and the 3D 
+ *  Stokes kernel (krnl_dim = 3) HSS matrices are tested with: 
+ *    1. H2P_matvec(); 
+ *    2. H2P_matmul() with n_vec = 1 and n_vec > 1, in row-major and column-major 
+ *       layouts with leading dimensions larger than the matrix sizes. 
+ *  The results of both paths should match up to rounding errors. The average time 
+ *  of each path and the memory of their intermediate results (engine: HSS_mv_buf; 
+ *  generic: y0, y1 of all nodes and the thread-local output vectors) are reported. 
+ *  
+ *  Example run: 
+ *  ./test_HSS_matvec_engine.exe 8000 1e-8 16
+ *  Input: 
+ *      8000 --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-8 --> relative tolerance of HSS construction
+ *      16   --> number of vectors in H2P_matmul()
+ */
+
+#define SAME_RELTOL 1e-12
+#define N_REPEAT    5
+
+static DTYPE Stokes_param[2] = {1.0, 0.1};
+
+static DTYPE calc_relerr(const size_t n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+// Memory (MB) of the intermediate results of the HSS matvec engine
+static double engine_buf_MB(H2Pack_p hssmat)
+{
+    if (hssmat->HSS_mv_buf == NULL) return 0.0;
+    double buf_size = 2.0 * (double) hssmat->HSS_mv_spos[hssmat->n_node] * (double) hssmat->HSS_mv_nvec;
+    return buf_size * (double) sizeof(DTYPE) / 1048576.0;
+}
+
+// Memory (MB) of the intermediate results of the generic H2 matvec
+static double generic_buf_MB(H2Pack_p hssmat)
+{
+    double buf_size = 0.0;
+    if (hssmat->y0 != NULL && hssmat->y1 != NULL)
+    {
+        for (int i = 0; i < hssmat->n_node; i++)
+            buf_size += (double) hssmat->y0[i]->size + (double) hssmat->y1[i]->size;
+    }
+    for (int i = 0; i < hssmat->n_thread; i++)
+        if (hssmat->tb[i]->y != NULL) buf_size += (double) hssmat->krnl_mat_size;
+    return buf_size * (double) sizeof(DTYPE) / 1048576.0;
+}
+
+// Run H2P_matmul() (n_vec > 0) or H2P_matvec() (n_vec == 0) N_REPEAT times with the 
+// HSS matvec engine (HSS_mv_mode == 1) or the generic path (HSS_mv_mode == -1), 
+// return the average time
+static double run_matmul(
+    H2Pack_p hssmat, const int mv_mode, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+)
+{
+    hssmat->HSS_mv_mode = mv_mode;
+    if (n_vec == 0) H2P_matvec(hssmat, mat_x, mat_y);
+    else H2P_matmul(hssmat, layout, n_vec, mat_x, ldx, mat_y, ldy);
+    double st = get_wtime_sec();
+    for (int i = 0; i < N_REPEAT; i++)
+    {
+        if (n_vec == 0) H2P_matvec(hssmat, mat_x, mat_y);
+        else H2P_matmul(hssmat, layout, n_vec, mat_x, ldx, mat_y, ldy);
+    }
+    double et = get_wtime_sec();
+    hssmat->HSS_mv_mode = 1;
+    return (et - st) / (double) N_REPEAT;
+}
+
+static int test_kernel(
+    const int n_point, DTYPE rel_tol, const int max_n_vec, const DTYPE *coord, const int krnl_dim, 
+    void *krnl_param, kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flop
+)
+{
+    H2Pack_p hssmat;
+    H2P_dense_mat_p *pp;
+    H2P_init(&hssmat, 3, krnl_dim, QR_REL_NRM, &rel_tol);
+    H2P_run_HSS(hssmat);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &hssmat->root_enbox);
+    H2P_partition_points(hssmat, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(hssmat, krnl_param, krnl_eval, NULL, &pp);
+    H2P_build(hssmat, pp, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flop);
+    printf("\nkrnl_dim = %d, HSS matrix size = %d\n", krnl_dim, hssmat->krnl_mat_size);
+    if (H2P_HSS_matvec_init(hssmat) != 1)
+    {
+        printf("HSS matvec engine cannot be used, FAILED\n");
+        H2P_destroy(&hssmat);
+        return 1;
+    }
+
+    const int n = hssmat->krnl_mat_size;
+    const int ld_col = n + 3, ld_row = max_n_vec + 3;
+    size_t buf_size = (size_t) ld_col * (size_t) max_n_vec;
+    if ((size_t) n * (size_t) ld_row > buf_size) buf_size = (size_t) n * (size_t) ld_row;
+    DTYPE *X  = (DTYPE*) malloc(sizeof(DTYPE) * n * max_n_vec);
+    DTYPE *Y0 = (DTYPE*) malloc(sizeof(DTYPE) * n * max_n_vec);
+    DTYPE *Y1 = (DTYPE*) malloc(sizeof(DTYPE) * n * max_n_vec);
+    DTYPE *mat_x = (DTYPE*) malloc(sizeof(DTYPE) * buf_size);
+    DTYPE *mat_y = (DTYPE*) malloc(sizeof(DTYPE) * buf_size);
+    assert(X != NULL && Y0 != NULL && Y1 != NULL && mat_x != NULL && mat_y != NULL);
+    // X, Y0, and Y1 store each vector contiguously
+    for (int i = 0; i < n * max_n_vec; i++) X[i] = (DTYPE) drand48() - 0.5;
+
+    int n_fail = 0;
+    // case 0: H2P_matvec(); case 1, 2: H2P_matmul() col-major and row-major, n_vec = 1;
+    // case 3, 4: H2P_matmul() col-major and row-major, n_vec = max_n_vec
+    for (int i_case = 0; i_case <= 4; i_case++)
+    {
+        int row_major = (i_case == 2 || i_case == 4);
+        int n_vec     = (i_case == 0) ? 0 : ((i_case <= 2) ? 1 : max_n_vec);
+        int n_vec1    = (n_vec == 0) ? 1 : n_vec;
+        int ld        = row_major ? ld_row : ld_col;
+        CBLAS_LAYOUT layout = row_major ? CblasRowMajor : CblasColMajor;
+        for (int j = 0; j < n_vec1; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (row_major) mat_x[i * ld + j] = X[j * n + i];
+                else mat_x[j * ld + i] = X[j * n + i];
+            }
+        }
+
+        double ut[2], buf_MB[2];
+        for (int i_path = 0; i_path <= 1; i_path++)
+        {
+            DTYPE *Y = (i_path == 0) ? Y0 : Y1;
+            for (size_t i = 0; i < buf_size; i++) mat_y[i] = 0.0;
+            ut[i_path] = run_matmul(hssmat, (i_path == 0) ? 1 : -1, layout, n_vec, mat_x, ld, mat_y, ld);
+            buf_MB[i_path] = (i_path == 0) ? engine_buf_MB(hssmat) : generic_buf_MB(hssmat);
+            for (int j = 0; j < n_vec1; j++)
+            {
+                for (int i = 0; i < n; i++)
+                    Y[j * n + i] = row_major ? mat_y[i * ld + j] : mat_y[j * ld + i];
+            }
+        }
+        DTYPE relerr = calc_relerr((size_t) n * n_vec1, Y1, Y0);
+        int fail = !(relerr <= SAME_RELTOL);
+        printf(
+            "  %s n_vec = %2d, %s: engine %.4lf (s) %.2lf (MB), generic %.4lf (s) %.2lf (MB), relerr = %.3e %s\n", 
+            (n_vec == 0) ? "matvec," : "matmul,", n_vec1, (n_vec == 0) ? "vector   " : (row_major ? "row-major" : "col-major"), 
+            ut[0], buf_MB[0], ut[1], buf_MB[1], relerr, fail ? "FAILED" : ""
+        );
+        n_fail += fail;
+    }
+
+    free(X);
+    free(Y0);
+    free(Y1);
+    free(mat_x);
+    free(mat_y);
+    H2P_destroy(&hssmat);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    int   n_vec   = (argc >= 4) ? atoi(argv[3]) : 16;
+    if (n_vec < 2) n_vec = 2;
+    printf("n_point = %d, rel_tol = %.2e, n_vec = %d, %d repeats\n", n_point, rel_tol, n_vec, N_REPEAT);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    int n_fail = 0;
+    n_fail += test_kernel(
+        n_point, rel_tol, n_vec, coord, 1, NULL, 
+        Coulomb_3D_eval_intrin_t, Coulomb_3D_krnl_bimv_intrin_t, Coulomb_3D_krnl_bimv_flop
+    );
+    n_fail += test_kernel(
+        n_point, rel_tol, n_vec, coord, 3, (void *) &Stokes_param[0], 
+        Stokes_eval_std, Stokes_krnl_bimv_intrin_t, Stokes_krnl_bimv_flop
+    );
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "parse_scalar_params.h"
+
+/*
+ *  Test SPDHSS-H2 construction (default and streaming) and ULV Cholesky factorization.
+ *  Exactly zero far-field blocks (Gaussian kernel values underflow between 
+ *  distant boxes) must not give empty H2 U bases, which SPDHSS cannot handle.
+ *  The test fails if: 
+ *    1. any H2 node has an empty U basis; 
+ *    2. a SPDHSS matrix is not SPD, or its ULV Cholesky solve relerr > SOLVE_RELTOL; 
+ *    3. a SPDHSS matvec relerr vs. the shifted H2 matvec > SPDHSS_RELTOL, the SPDHSS 
+ *       error is dominated by max_rank and is 4e-2 for the example run; 
+ *    4. the streaming construction is more than 2x less accurate than the default one. 
+ *  
+ *  Example run: 
+ *  ./test_SPDHSS_H2.exe 2 50000 1e-6 1 1 pp.bin none 100 1e-2
+ *  Example run where the streaming construction reduces the peak working array size
+ *  (753 MB --> 495 MB, see H2P_SPDHSS_H2_build_stream() in H2Pack_SPDHSS_H2.h): 
+ *  ./test_SPDHSS_H2.exe 2 20000 1e-6 1 1 pp.bin none 500 1e-2
+ *  Input: 
+ *      First 7 parameters --> the same as other test programs (parse_scalar_params.h), 
+ *                             use a coordinate file name without .csv or .bin to use random points
+ *      100  --> maximum rank of the SPDHSS matrix
+ *      1e-2 --> diagonal shift
+ */
+
+#define SOLVE_RELTOL  1e-8
+#define SPDHSS_RELTOL 1e-1
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+    
+    parse_scalar_params(argc, argv);
+    int max_rank = (argc >= 9)  ? atoi(argv[8]) : 100;
+    DTYPE shift  = (argc >= 10) ? (DTYPE) atof(argv[9]) : 1e-2;
+    DTYPE hss_tol = 1e-6;
+    printf("SPDHSS max rank = %d, reltol = %.2e, diagonal shift = %.2e\n", max_rank, hss_tol, shift);
+
+    double st, et;
+    H2Pack_p h2mat, hssmat;
+    
+    H2P_init(&h2mat, test_params.pt_dim, test_params.krnl_dim, QR_REL_NRM, &test_params.rel_tol);
+    H2P_calc_enclosing_box(test_params.pt_dim, test_params.n_point, test_params.coord, NULL, &h2mat->root_enbox);
+    H2P_partition_points(h2mat, test_params.n_point, test_params.coord, 0, 0);
+    H2P_HSS_calc_adm_inadm_pairs(h2mat);
+
+    H2P_dense_mat_p *pp;
+    H2P_generate_proxy_point_ID_file(h2mat, test_params.krnl_param, test_params.krnl_eval, NULL, &pp);
+    H2P_build(
+        h2mat, pp, test_params.BD_JIT, test_params.krnl_param, 
+        test_params.krnl_eval, test_params.krnl_bimv, test_params.krnl_bimv_flops
+    );
+
+    int n_empty_U = 0;
+    for (int i = 0; i < h2mat->n_node; i++)
+        if (h2mat->U[i]->nrow > 0 && h2mat->U[i]->ncol == 0) n_empty_U++;
+    printf("H2 matrix has %d nodes with empty U basis (should be 0)\n", n_empty_U);
+    int n_fail = (n_empty_U > 0);
+
+    DTYPE *x0, *x1, *y0, *y1;
+    x0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    x1 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    y0 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    y1 = (DTYPE*) malloc(sizeof(DTYPE) * test_params.krnl_mat_size);
+    assert(x0 != NULL && x1 != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) 
+        x0[i] = (DTYPE) drand48() - 0.5;
+    H2P_matvec(h2mat, x0, y0);
+    for (int i = 0; i < test_params.krnl_mat_size; i++) y0[i] += shift * x0[i];
+
+    // Default and streaming constructions should give SPDHSS matrices of the same accuracy
+    DTYPE spdhss_relerr[2];
+    for (int stream = 0; stream <= 1; stream++)
+    {
+        printf("\n");
+        st = get_wtime_sec();
+        if (stream == 0) H2P_SPDHSS_H2_build(max_rank, hss_tol, shift, h2mat, &hssmat);
+        else H2P_SPDHSS_H2_build_stream(max_rank, hss_tol, shift, h2mat, &hssmat);
+        et = get_wtime_sec();
+        printf(
+            "%s used %.3lf (s), peak working array size = %.2lf MB\n", 
+            (stream == 0) ? "H2P_SPDHSS_H2_build" : "H2P_SPDHSS_H2_build_stream", 
+            et - st, hssmat->mat_size[SPDHSS_PEAK_SIZE_IDX] * sizeof(DTYPE) / 1048576.0
+        );
+
+        // SPDHSS matvec vs. H2 matvec + shift
+        H2P_matvec(hssmat, x0, y1);
+        DTYPE ref_norm = 0.0, err_norm = 0.0;
+        for (int i = 0; i < test_params.krnl_mat_size; i++)
+        {
+            DTYPE diff = y1[i] - y0[i];
+            ref_norm += y0[i] * y0[i];
+            err_norm += diff * diff;
+        }
+        ref_norm = DSQRT(ref_norm);
+        err_norm = DSQRT(err_norm);
+        spdhss_relerr[stream] = err_norm / ref_norm;
+        printf("||y_{SPDHSS} - (y_{H2} + shift * x)||_2 / ||y_{H2} + shift * x||_2 = %e\n", spdhss_relerr[stream]);
+        if (!(spdhss_relerr[stream] <= SPDHSS_RELTOL)) n_fail++;
+
+        // SPDHSS ULV Cholesky factorization and solve
+        H2P_HSS_ULV_Cholesky_factorize(hssmat, 0.0);
+        if (hssmat->is_HSS_SPD == 0)
+        {
+            printf("SPDHSS matrix is not SPD\n");
+            n_fail++;
+            H2P_destroy(&hssmat);
+            continue;
+        }
+        H2P_HSS_ULV_Cholesky_solve(hssmat, 3, y1, x1);
+        ref_norm = 0.0; 
+        err_norm = 0.0;
+        for (int i = 0; i < test_params.krnl_mat_size; i++)
+        {
+            DTYPE diff = x1[i] - x0[i];
+            ref_norm += x0[i] * x0[i];
+            err_norm += diff * diff;
+        }
+        ref_norm = DSQRT(ref_norm);
+        err_norm = DSQRT(err_norm);
+        printf("H2P_HSS_ULV_Cholesky_solve relerr = %e\n", err_norm / ref_norm);
+        if (!(err_norm / ref_norm <= SOLVE_RELTOL)) n_fail++;
+
+        H2P_print_statistic(hssmat);
+        H2P_destroy(&hssmat);
+    }  // End of stream loop
+    if (!(spdhss_relerr[1] <= 2.0 * spdhss_relerr[0]))
+    {
+        printf("Streaming SPDHSS relerr %e > 2 * default SPDHSS relerr %e\n", spdhss_relerr[1], spdhss_relerr[0]);
+        n_fail++;
+    }
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free(x0);
+    free(x1);
+    free(y0);
+    free(y1);
+    free_aligned(test_params.coord);
+    H2P_destroy(&h2mat);
+    return (n_fail == 0) ? 0 : 1;
+}
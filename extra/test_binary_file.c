@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test the single-file binary H2 format on a 3D Coulomb kernel H2 matrix built in 
+ *  AOT and JIT modes. Each matrix is stored with H2P_store_to_binary_file() and loaded 
+ *  back with H2P_read_from_binary_file() (AOT and JIT), H2P_load_mmap(), and 
+ *  H2P_load_out_of_core() with a small and a large streaming buffer. Loaded 
+ *  matrices use the stored U, B, and D matrices (or evaluate the same B and D blocks 
+ *  in JIT mode), so their matvec results should match the in-memory matvec up to 
+ *  rounding errors. Then one byte of the B matrices in the file is flipped: 
+ *  H2P_verify_binary_file() and H2P_read_from_binary_file() in AOT mode should 
+ *  reject the file, H2P_read_from_binary_file() in JIT mode does not read B and D 
+ *  and should still load the file and give the same matvec result. 
+ *  Finally the matrix is stored with H2P_store_to_compressed_binary_file() with the 
+ *  default error bound 0.01 * rel_tol, the matvec results of the loaded matrices 
+ *  should be within 0.1 * rel_tol of the in-memory matvec (see the notes of 
+ *  H2P_store_to_compressed_binary_file()), and the out-of-core loader should 
+ *  reject the compressed file. 
+ *  The same store and load checks (except compression and corruption) are run on 
+ *  a 3D RPY kernel H2 matrix with random radii (extended coordinates) and on a 
+ *  periodic RPY Ewald H2 matrix with n / 10 and n / 20 points. Their kernel parameters 
+ *  are stored with H2P_set_krnl_param_bytes() and the loaders are given NULL 
+ *  krnl_param. Periodic matrices are loaded for H2P_matvec_periodic(), and the 
+ *  out-of-core loader should reject them. 
+ *  Each matrix is also stored to a POSIX shared memory object with H2P_store_to_shm() 
+ *  and attached with H2P_attach_shm(). The H2 matrices are attached twice at the same 
+ *  time, as two processes would do. After H2P_unlink_shm(), an attached matrix should 
+ *  still give the same matvec result and H2P_attach_shm() should fail. 
+ *  
+ *  Example run: 
+ *  ./test_binary_file.exe 20000 1e-8 H2P_test.bin
+ *  Input: 
+ *      20000 --> number of points, random in a cubic box with side length 20000^(1/3)
+ *      1e-8  --> relative tolerance of H2 construction
+ *      H2P_test.bin --> binary file name, the file is removed after the test
+ *  The shared memory object is named "/H2P_test_<pid>" and is unlinked after the test. 
+ */
+
+// Matvec results of loaded matrices should match the in-memory matvec up to rounding errors
+#define EXACT_RELTOL 1e-14
+// Matvec results of loaded compressed matrices should be within this factor times rel_tol
+#define QUANT_RELTOL_FACTOR 0.1
+
+static DTYPE calc_relerr(const int len, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE x0_2norm = 0.0, err_2norm = 0.0;
+    for (int i = 0; i < len; i++)
+    {
+        DTYPE diff = x0[i] - x1[i];
+        x0_2norm  += x0[i] * x0[i];
+        err_2norm += diff  * diff;
+    }
+    return DSQRT(err_2norm / x0_2norm);
+}
+
+// Binary file header and section table entry, same as H2P_bin_header and 
+// H2P_bin_section in H2Pack_file_IO.c
+struct bin_header
+{
+    char     magic[8];
+    uint32_t version, endian_tag, dtype_size, n_section;
+    uint64_t sec_table_offset, file_size, reserved[3];
+};
+struct bin_section
+{
+    uint32_t id, elem_size;
+    uint64_t offset, nbytes, checksum;
+    uint32_t encoding, enc_nbits;
+    uint64_t raw_nbytes;
+};
+#define BIN_SEC_B_DATA  10  // H2P_BIN_SEC_B_DATA in H2Pack_file_IO.c
+
+// Flip one byte in the middle of a section of a binary file
+// Input parameters:
+//   fname  : Binary file name
+//   sec_id : Section ID
+// Output parameter:
+//   <return> : 0 if a byte is flipped, -1 if the section is not found or empty
+static int corrupt_section_byte(const char *fname, const uint32_t sec_id)
+{
+    FILE *fp = fopen(fname, "r+b");
+    if (fp == NULL) return -1;
+    struct bin_header  header;
+    struct bin_section sec;
+    int ret = -1;
+    if (fread(&header, sizeof(header), 1, fp) == 1)
+    {
+        for (uint32_t i = 0; i < header.n_section; i++)
+        {
+            fseek(fp, (long) (header.sec_table_offset + sizeof(sec) * i), SEEK_SET);
+            if (fread(&sec, sizeof(sec), 1, fp) != 1) break;
+            if (sec.id != sec_id || sec.nbytes == 0) continue;
+            long pos = (long) (sec.offset + sec.nbytes / 2);
+            unsigned char byte;
+            fseek(fp, pos, SEEK_SET);
+            if (fread(&byte, 1, 1, fp) != 1) break;
+            byte ^= 0x5A;
+            fseek(fp, pos, SEEK_SET);
+            if (fwrite(&byte, 1, 1, fp) == 1) ret = 0;
+            break;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+// Check the return value and the matvec result of a loaded matrix, the loaded matrix is destroyed
+// Input parameters:
+//   name   : Name of the loading method
+//   ret    : Return value of the loading function
+//   h2load : Loaded H2Pack structure
+//   x      : Input vector
+//   y_ref  : In-memory matvec result
+//   y      : Work buffer of the same size as y_ref
+//   reltol : Max allowed relative error of the matvec result
+// Output parameter:
+//   <return> : 0 if passed, 1 if failed
+static int check_loaded_matvec(
+    const char *name, const int ret, H2Pack_p h2load, const DTYPE *x, 
+    const DTYPE *y_ref, DTYPE *y, const DTYPE reltol
+)
+{
+    if (ret != 0 || h2load == NULL)
+    {
+        printf("  %-28s: load failed (return %d)\n", name, ret);
+        return 1;
+    }
+    if (h2load->is_RPY_Ewald) H2P_matvec_periodic(h2load, x, y);
+    else H2P_matvec(h2load, x, y);
+    DTYPE relerr = calc_relerr(h2load->krnl_mat_size, y_ref, y);
+    int fail = !(relerr <= reltol);
+    printf("  %-28s: matvec relerr = %e %s\n", name, relerr, fail ? "FAILED" : "");
+    H2P_destroy(&h2load);
+    return fail;
+}
+
+// Store and load an RPY kernel H2 matrix (is_periodic == 0) or a periodic 
+// RPY Ewald H2 matrix (is_periodic == 1), return the number of failed checks
+static int test_RPY(const int n_point, DTYPE rel_tol, const char *fname, const char *shm_name, const int is_periodic, const DTYPE *x, DTYPE *y0, DTYPE *y1)
+{
+    // 1. Random points and radii, the periodic unit cell is [0, L]^3
+    DTYPE L = 2.0 * DPOW((DTYPE) n_point, 1.0 / 3.0), max_radius = 0.5;
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 4, 64);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * L;
+    for (int i = 0; i < n_point; i++) coord[3 * n_point + i] = max_radius * (0.5 + 0.5 * (DTYPE) drand48());
+    DTYPE unit_cell[6] = {0.0, 0.0, 0.0, L, L, L};
+
+    // 2. RPY and RPY Ewald kernel parameters, eta = 1 / (6 * pi) gives a unit prefactor
+    DTYPE krnl_param[1] = {1.0 / (6.0 * M_PI)};
+    DTYPE pkrnl_param[8] = {L, DSQRT(M_PI) / L, 2, 2, 0, 0, 0, 0};
+    DTYPE *ewald_workbuf = NULL;
+    if (is_periodic)
+    {
+        RPY_Ewald_init_workbuf(L, pkrnl_param[1], 2, 2, &ewald_workbuf);
+        memcpy(pkrnl_param + 4, &ewald_workbuf, sizeof(DTYPE*));
+    }
+
+    // 3. Build the H2 matrix and compute the reference matvec result
+    H2Pack_p h2pack, h2load;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2pack, 3, 3, QR_REL_NRM, &rel_tol);
+    int num_pp_dim = ceil(-log10(rel_tol));
+    if (num_pp_dim < 4 ) num_pp_dim = 4;
+    if (num_pp_dim > 10) num_pp_dim = 10;
+    if (is_periodic)
+    {
+        H2P_run_RPY_Ewald(h2pack);
+        H2P_partition_points_periodic(h2pack, n_point, coord, 0, 0, unit_cell);
+    } else {
+        // The size of each leaf box should be >= 2 * max(radii)
+        H2P_run_RPY(h2pack);
+        H2P_calc_enclosing_box(3, n_point, coord, NULL, &h2pack->root_enbox);
+        H2P_partition_points(h2pack, n_point, coord, 0, 4.0 * max_radius);
+    }
+    // The periodic partition does not compute root_enbox, use the unit cell instead
+    DTYPE pp_box_size = is_periodic ? unit_cell[3] : h2pack->root_enbox[3];
+    H2P_generate_proxy_point_surface(
+        3, 4, 6 * num_pp_dim * num_pp_dim, h2pack->max_level, 
+        h2pack->min_adm_level, pp_box_size, &pp
+    );
+    H2P_set_krnl_param_bytes(h2pack, sizeof(krnl_param));
+    if (is_periodic)
+    {
+        H2P_build_periodic(
+            h2pack, pp, 0, krnl_param, RPY_eval_std, pkrnl_param, 
+            RPY_Ewald_eval_std, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop
+        );
+        H2P_matvec_periodic(h2pack, x, y0);
+    } else {
+        H2P_build(h2pack, pp, 0, krnl_param, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+        H2P_matvec(h2pack, x, y0);
+    }
+    printf("\n%s H2 matrix with %d points built in AOT mode\n", is_periodic ? "Periodic RPY Ewald" : "RPY", n_point);
+    H2P_store_to_binary_file(h2pack, fname);
+
+    // 4. Load with different methods and the stored kernel parameters
+    int ret, n_fail = 0;
+    if (is_periodic)
+    {
+        ret = H2P_read_periodic_from_binary_file(&h2load, fname, 0, NULL, RPY_eval_std, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop);
+        n_fail += check_loaded_matvec("read periodic, AOT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_read_periodic_from_binary_file(&h2load, fname, 1, NULL, RPY_eval_std, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop);
+        n_fail += check_loaded_matvec("read periodic, JIT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    }
+    ret = H2P_read_from_binary_file(&h2load, fname, 0, NULL, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+    n_fail += check_loaded_matvec("read, AOT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    ret = H2P_read_from_binary_file(&h2load, fname, 1, NULL, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+    n_fail += check_loaded_matvec("read, JIT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    ret = H2P_load_mmap(&h2load, fname, 0, NULL, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+    n_fail += check_loaded_matvec("mmap, AOT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    H2P_store_to_shm(h2pack, shm_name);
+    ret = H2P_attach_shm(&h2load, shm_name, 0, NULL, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+    n_fail += check_loaded_matvec("shm, attach", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    H2P_unlink_shm(shm_name);
+    ret = H2P_load_out_of_core(&h2load, fname, (size_t) 1 << 20, NULL, RPY_eval_std, RPY_krnl_bimv_intrin_t, RPY_krnl_bimv_flop);
+    if (is_periodic)
+    {
+        printf("  %-28s: return %d %s\n", "out-of-core, periodic", ret, (ret == -1 && h2load == NULL) ? "" : "FAILED");
+        n_fail += (ret != -1 || h2load != NULL);
+        if (h2load != NULL) H2P_destroy(&h2load);
+    } else {
+        n_fail += check_loaded_matvec("out-of-core, 1 MB buffer", ret, h2load, x, y0, y1, EXACT_RELTOL);
+    }
+
+    H2P_destroy(&h2pack);
+    free(ewald_workbuf);
+    free_aligned(coord);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    // Fixed seed, the compressed matvec errors depend on the points
+    srand48(20000);
+
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 20000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    const char *fname = (argc >= 4) ? argv[3] : "H2P_test.bin";
+    char shm_name[64];
+    sprintf(shm_name, "/H2P_test_%d", (int) getpid());
+    printf("n_point = %d, rel_tol = %.2e, binary file = %s\n", n_point, rel_tol, fname);
+
+    // Coulomb kernel has no parameter
+    void *krnl_param = NULL;
+    kernel_eval_fptr krnl_eval = Coulomb_3D_eval_intrin_t;
+    kernel_bimv_fptr krnl_bimv = Coulomb_3D_krnl_bimv_intrin_t;
+    int krnl_bimv_flops = Coulomb_3D_krnl_bimv_flop;
+
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    DTYPE *x     = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    DTYPE *y0    = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    DTYPE *y1    = (DTYPE*) malloc(sizeof(DTYPE) * n_point);
+    assert(coord != NULL && x != NULL && y0 != NULL && y1 != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+    for (int i = 0; i < n_point; i++) x[i] = (DTYPE) drand48() - 0.5;
+
+    int n_fail = 0;
+    H2P_dense_mat_p *pp = NULL;
+    for (int BD_JIT = 0; BD_JIT <= 1; BD_JIT++)
+    {
+        // 1. Build the H2 matrix and compute the reference matvec result
+        double st, et;
+        H2Pack_p h2pack, h2load;
+        H2P_init(&h2pack, 3, 1, QR_REL_NRM, &rel_tol);
+        H2P_calc_enclosing_box(3, n_point, coord, NULL, &h2pack->root_enbox);
+        H2P_partition_points(h2pack, n_point, coord, 0, 0);
+        if (pp == NULL) H2P_generate_proxy_point_ID_file(h2pack, krnl_param, krnl_eval, NULL, &pp);
+        H2P_build(h2pack, pp, BD_JIT, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        H2P_matvec(h2pack, x, y0);
+        printf("\nH2 matrix built in %s mode\n", BD_JIT ? "JIT" : "AOT");
+
+        // 2. Store to a binary file
+        st = get_wtime_sec();
+        H2P_store_to_binary_file(h2pack, fname);
+        et = get_wtime_sec();
+        struct stat fstat;
+        size_t fsize = (stat(fname, &fstat) == 0) ? (size_t) fstat.st_size : 0;
+        printf("  H2P_store_to_binary_file used %.3lf (s), file size %.2lf MB\n", et - st, (double) fsize / 1048576.0);
+
+        // 3. Load with different methods
+        int ret;
+        ret = H2P_read_from_binary_file(&h2load, fname, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("read, AOT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_read_from_binary_file(&h2load, fname, 1, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("read, JIT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_load_mmap(&h2load, fname, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("mmap, AOT", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        // A 1 MB budget streams B and D in many chunks, a 256 MB budget in a few chunks
+        ret = H2P_load_out_of_core(&h2load, fname, (size_t) 1 << 20, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("out-of-core, 1 MB buffer", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_load_out_of_core(&h2load, fname, (size_t) 256 << 20, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("out-of-core, 256 MB buffer", ret, h2load, x, y0, y1, EXACT_RELTOL);
+
+        // 4. Shared memory object, h2shm stays attached while the second attachment is 
+        //    checked and after the name is unlinked
+        H2Pack_p h2shm;
+        st = get_wtime_sec();
+        H2P_store_to_shm(h2pack, shm_name);
+        et = get_wtime_sec();
+        printf("  H2P_store_to_shm used %.3lf (s)\n", et - st);
+        int ret_shm = H2P_attach_shm(&h2shm, shm_name, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        ret = H2P_attach_shm(&h2load, shm_name, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("shm, second attach", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_unlink_shm(shm_name);
+        printf("  %-28s: return %d %s\n", "shm, unlink", ret, (ret == 0) ? "" : "FAILED");
+        n_fail += (ret != 0);
+        ret = H2P_attach_shm(&h2load, shm_name, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        printf("  %-28s: return %d %s\n", "shm, attach after unlink", ret, (ret == -1 && h2load == NULL) ? "" : "FAILED");
+        n_fail += (ret != -1 || h2load != NULL);
+        if (h2load != NULL) H2P_destroy(&h2load);
+        n_fail += check_loaded_matvec("shm, first attach", ret_shm, h2shm, x, y0, y1, EXACT_RELTOL);
+        ret = H2P_unlink_shm(shm_name);
+        printf("  %-28s: return %d %s\n", "shm, unlink twice", ret, (ret == -1) ? "" : "FAILED");
+        n_fail += (ret != -1);
+
+        // 5. Checksums of an intact and a corrupted file
+        ret = H2P_verify_binary_file(fname);
+        printf("  %-28s: return %d %s\n", "verify, intact file", ret, (ret == 0) ? "" : "FAILED");
+        n_fail += (ret != 0);
+        if (corrupt_section_byte(fname, BIN_SEC_B_DATA) != 0)
+        {
+            printf("  Cannot find the B matrices in %s, FAILED\n", fname);
+            n_fail++;
+        } else {
+            ret = H2P_verify_binary_file(fname);
+            printf("  %-28s: return %d %s\n", "verify, corrupted B", ret, (ret == -1) ? "" : "FAILED");
+            n_fail += (ret != -1);
+            ret = H2P_read_from_binary_file(&h2load, fname, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+            printf("  %-28s: return %d %s\n", "read, AOT, corrupted B", ret, (ret == -1 && h2load == NULL) ? "" : "FAILED");
+            n_fail += (ret != -1 || h2load != NULL);
+            if (h2load != NULL) H2P_destroy(&h2load);
+            ret = H2P_read_from_binary_file(&h2load, fname, 1, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+            n_fail += check_loaded_matvec("read, JIT, corrupted B", ret, h2load, x, y0, y1, EXACT_RELTOL);
+        }
+
+        // 6. Compressed binary file with the default error bound
+        st = get_wtime_sec();
+        H2P_store_to_compressed_binary_file(h2pack, fname, 0.0);
+        et = get_wtime_sec();
+        size_t fsize_c = (stat(fname, &fstat) == 0) ? (size_t) fstat.st_size : 0;
+        printf(
+            "  H2P_store_to_compressed_binary_file used %.3lf (s), file size %.2lf MB (%.1lf%%)\n", 
+            et - st, (double) fsize_c / 1048576.0, 100.0 * (double) fsize_c / (double) fsize
+        );
+        DTYPE quant_tol = QUANT_RELTOL_FACTOR * rel_tol;
+        ret = H2P_verify_binary_file(fname);
+        printf("  %-28s: return %d %s\n", "verify, compressed", ret, (ret == 0) ? "" : "FAILED");
+        n_fail += (ret != 0);
+        ret = H2P_read_from_binary_file(&h2load, fname, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("read, AOT, compressed", ret, h2load, x, y0, y1, quant_tol);
+        ret = H2P_load_mmap(&h2load, fname, 0, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        n_fail += check_loaded_matvec("mmap, AOT, compressed", ret, h2load, x, y0, y1, quant_tol);
+        ret = H2P_load_out_of_core(&h2load, fname, (size_t) 1 << 20, krnl_param, krnl_eval, krnl_bimv, krnl_bimv_flops);
+        printf("  %-28s: return %d %s\n", "out-of-core, compressed", ret, (ret == -1 && h2load == NULL) ? "" : "FAILED");
+        n_fail += (ret != -1 || h2load != NULL);
+        if (h2load != NULL) H2P_destroy(&h2load);
+
+        H2P_destroy(&h2pack);
+    }
+    n_fail += test_RPY(n_point / 10, rel_tol, fname, shm_name, 0, x, y0, y1);
+    // A periodic RPY Ewald H2 matrix in AOT mode needs much more memory, use fewer points
+    n_fail += test_RPY(n_point / 20, rel_tol, fname, shm_name, 1, x, y0, y1);
+    remove(fname);
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free(x);
+    free(y0);
+    free(y1);
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "direct_nbody.h"
+
+/*
+ *  Test H2P_matvec_dkrnl() and H2P_matmul_dkrnl() on a 3D Gaussian kernel 
+ *  k(x, y) = exp(-l * |x-y|^2) and its derivative w.r.t. l, for a H2 matrix in 
+ *  AOT and JIT mode and a HSS matrix. For each matrix: 
+ *    1. K * x from H2P_matvec_dkrnl() should be the same as H2P_matvec(); 
+ *    2. dK/dl * x and dK/dl * X should match the dense dK/dl * x and dK/dl * X 
+ *       computed with direct_nbody(), see the accuracy note in H2Pack_matvec_dkrnl.h; 
+ *    3. The kernel functions and B & D matrices of the H2Pack structure should 
+ *       not be changed, and a caller using a matvec workspace of the H2Pack structure 
+ *       concurrently with H2P_matvec_dkrnl() should still get K * x. 
+ *  
+ *  Example run: 
+ *  ./test_dkrnl.exe 8000 1e-8 4
+ *  Input: 
+ *      8000 --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-8 --> relative tolerance of H2 / HSS construction
+ *      4    --> number of vectors in H2P_matmul_dkrnl()
+ */
+
+// dK/dl * x uses the U bases and skeleton points selected for K, its error is 
+// about 3e-4 for the HSS matrix with rel_tol = 1e-8
+#define SAME_RELTOL  1e-12
+#define DKRNL_RELTOL 1e-2
+
+static DTYPE krnl_param[1] = {0.5};
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+static int check_relerr(const char *name, const int n, const DTYPE *y_ref, const DTYPE *y, const DTYPE reltol)
+{
+    DTYPE relerr = calc_relerr(n, y_ref, y);
+    int fail = !(relerr <= reltol);
+    printf("  %-44s: relerr = %e %s\n", name, relerr, fail ? "FAILED" : "");
+    return fail;
+}
+
+static int test_dkrnl(
+    const int n_point, DTYPE *coord, DTYPE rel_tol, const int is_HSS, 
+    const int BD_JIT, const int n_vec, const char *name
+)
+{
+    printf("\n%s\n", name);
+    H2Pack_p h2pack;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2pack, 3, 1, QR_REL_NRM, &rel_tol);
+    if (is_HSS) H2P_run_HSS(h2pack);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &h2pack->root_enbox);
+    H2P_partition_points(h2pack, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(h2pack, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        h2pack, pp, BD_JIT, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+
+    void *dkrnl_param[1] = {krnl_param};
+    kernel_eval_fptr dkrnl_eval[1] = {Gaussian_dl_3D_eval_intrin_t};
+    kernel_bimv_fptr dkrnl_bimv[1] = {Gaussian_dl_3D_krnl_bimv_intrin_t};
+    int dkrnl_bimv_flops[1] = {Gaussian_dl_3D_krnl_bimv_flop};
+    H2P_dkrnl_p dkrnl;
+    H2P_dkrnl_build(h2pack, 1, dkrnl_param, dkrnl_eval, dkrnl_bimv, dkrnl_bimv_flops, &dkrnl);
+    kernel_eval_fptr krnl_eval0 = h2pack->krnl_eval;
+    void  *krnl_param0 = h2pack->krnl_param;
+    DTYPE *B_data0 = h2pack->B_data, *D_data0 = h2pack->D_data;
+
+    const int n = h2pack->krnl_mat_size;
+    size_t mat_size = (size_t) n * (size_t) n_vec;
+    DTYPE *x     = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_mv  = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *y     = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *dy    = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *dY    = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *dY0   = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_ws  = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    assert(x != NULL && y_mv != NULL && y != NULL && dy != NULL);
+    assert(dY != NULL && dY0 != NULL && y_ws != NULL);
+    for (size_t i = 0; i < mat_size; i++) x[i] = (DTYPE) drand48() - 0.5;
+
+    // 1. Dense dK/dl * X, coord is in the original point order
+    for (int j = 0; j < n_vec; j++)
+    {
+        direct_nbody(
+            krnl_param, Gaussian_dl_3D_eval_intrin_t, 3, 1, 
+            coord, n_point, n_point, x + j * n, 
+            coord, n_point, n_point, dY0 + j * n
+        );
+    }
+
+    // 2. K * x and dK/dl * x, dK/dl * X
+    int n_fail = 0;
+    H2P_matvec(h2pack, x, y_mv);
+    H2P_matvec_dkrnl(h2pack, dkrnl, x, y, dy, n);
+    n_fail += check_relerr("H2P_matvec_dkrnl K * x vs. H2P_matvec", n, y_mv, y, SAME_RELTOL);
+    n_fail += check_relerr("H2P_matvec_dkrnl dK/dl * x vs. dense", n, dY0, dy, DKRNL_RELTOL);
+    H2P_matmul_dkrnl(h2pack, dkrnl, 0, CblasColMajor, n_vec, x, n, dY, n);
+    n_fail += check_relerr("H2P_matmul_dkrnl dK/dl * X vs. dense", (int) mat_size, dY0, dY, DKRNL_RELTOL);
+    n_fail += check_relerr("H2P_matmul_dkrnl vs. H2P_matvec_dkrnl", n, dy, dY, SAME_RELTOL);
+
+    // 3. h2pack still holds the original kernel, also for a concurrent workspace caller
+    if (h2pack->krnl_eval != krnl_eval0 || h2pack->krnl_param != krnl_param0 || 
+        h2pack->B_data != B_data0 || h2pack->D_data != D_data0)
+    {
+        printf("  Kernel or B & D matrices of h2pack changed FAILED\n");
+        n_fail++;
+    }
+    H2P_matvec(h2pack, x, y);
+    n_fail += check_relerr("H2P_matvec after derivative kernels", n, y_mv, y, SAME_RELTOL);
+    const int n_rep = 3;
+    DTYPE ws_relerr = 0.0;
+    #pragma omp parallel num_threads(2)
+    {
+        if (omp_get_thread_num() == 0)
+        {
+            for (int k = 0; k < n_rep; k++) 
+                H2P_matmul_dkrnl(h2pack, dkrnl, 0, CblasColMajor, n_vec, x, n, dY, n);
+        } else {
+            for (int k = 0; k < n_rep; k++)
+            {
+                H2P_matvec_ws_p ws;
+                H2P_matvec_ws_init(&ws, h2pack, 1);
+                H2P_matvec_with_ws(ws, x, y_ws);
+                H2P_matvec_ws_destroy(&ws);
+                DTYPE relerr = calc_relerr(n, y_mv, y_ws);
+                if (relerr > ws_relerr) ws_relerr = relerr;
+            }
+        }
+    }
+    printf("  %-44s: relerr = %e %s\n", "workspace matvec during H2P_matmul_dkrnl", ws_relerr, (ws_relerr <= SAME_RELTOL) ? "" : "FAILED");
+    if (!(ws_relerr <= SAME_RELTOL)) n_fail++;
+    n_fail += check_relerr("concurrent H2P_matmul_dkrnl vs. dense", (int) mat_size, dY0, dY, DKRNL_RELTOL);
+
+    free(x);
+    free(y_mv);
+    free(y);
+    free(dy);
+    free(dY);
+    free(dY0);
+    free(y_ws);
+    H2P_dkrnl_destroy(&dkrnl);
+    H2P_destroy(&h2pack);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    int   n_vec   = (argc >= 4) ? atoi(argv[3]) : 4;
+    printf("n_point = %d, rel_tol = %.2e, n_vec = %d\n", n_point, rel_tol, n_vec);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    DTYPE prefac = DPOW((DTYPE) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = (DTYPE) drand48() * prefac;
+
+    int n_fail = 0;
+    n_fail += test_dkrnl(n_point, coord, rel_tol, 0, 0, n_vec, "H2 matrix, AOT mode");
+    n_fail += test_dkrnl(n_point, coord, rel_tol, 0, 1, n_vec, "H2 matrix, JIT mode");
+    n_fail += test_dkrnl(n_point, coord, rel_tol, 1, 0, n_vec, "HSS matrix, AOT mode");
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free_aligned(coord);
+    return (n_fail == 0) ? 0 : 1;
+}
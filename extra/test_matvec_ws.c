@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "parse_scalar_params.h"
+
+/*
+ *  Test matvec workspaces (H2Pack_matvec_ws.h) on a H2 matrix, a HSS matrix, and a 
+ *  periodic RPY Ewald H2 matrix. For each matrix: 
+ *    1. H2P_matvec_with_ws() and H2P_matmul_with_ws() (or their periodic versions) 
+ *       should give the same results as H2P_matvec() and H2P_matmul() on the shared 
+ *       H2Pack structure; 
+ *    2. n_caller callers in an OpenMP parallel region, each with its own workspace, 
+ *       multiply different vectors with the shared H2Pack structure at the same time 
+ *       and should also give the same results; 
+ *    3. Multiplications with workspaces should not change the matvec counter of the 
+ *       shared H2Pack structure, each workspace counts its own multiplications. 
+ *  Workspaces may use a different number of threads from the shared H2Pack structure, 
+ *  so results are compared with a tolerance for different summation orders. 
+ *  
+ *  Example run: 
+ *  ./test_matvec_ws.exe 3 20000 1e-8 1 0 pp.bin none 4
+ *  Input: 
+ *      First 7 parameters --> the same as other test programs (parse_scalar_params.h), 
+ *                             use a coordinate file name without .csv or .bin to use random points
+ *      4 --> number of concurrent callers
+ */
+
+#define WS_RELTOL 1e-12
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+static int check_relerr(const char *name, const int n, const DTYPE *y_ref, const DTYPE *y)
+{
+    DTYPE relerr = calc_relerr(n, y_ref, y);
+    int fail = !(relerr <= WS_RELTOL);
+    printf("  %-38s: relerr = %e %s\n", name, relerr, fail ? "FAILED" : "");
+    return fail;
+}
+
+static void ws_matvec(H2P_matvec_ws_p ws, const int is_periodic, const DTYPE *x, DTYPE *y)
+{
+    if (is_periodic) H2P_matvec_periodic_with_ws(ws, x, y);
+    else H2P_matvec_with_ws(ws, x, y);
+}
+
+static void ws_matmul(H2P_matvec_ws_p ws, const int is_periodic, const int n_vec, const DTYPE *x, DTYPE *y)
+{
+    int n = ws->h2pack->krnl_mat_size;
+    if (is_periodic) H2P_matmul_periodic_with_ws(ws, CblasColMajor, n_vec, x, n, y, n);
+    else H2P_matmul_with_ws(ws, CblasColMajor, n_vec, x, n, y, n);
+}
+
+// Compare multiplications with workspaces against multiplications with the shared H2Pack structure
+static int test_ws(H2Pack_p h2pack, const char *name, const int is_periodic, const int n_caller)
+{
+    const int n = h2pack->krnl_mat_size, n_vec = n_caller;
+    size_t mat_size = (size_t) n * (size_t) n_vec;
+    DTYPE *x     = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_mv  = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_mm  = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y1    = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_cmv = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y_cmm = (DTYPE*) malloc(sizeof(DTYPE) * mat_size * n_caller);
+    assert(x != NULL && y_mv != NULL && y_mm != NULL && y1 != NULL);
+    assert(y_cmv != NULL && y_cmm != NULL);
+    for (size_t i = 0; i < mat_size; i++) x[i] = (DTYPE) drand48() - 0.5;
+    printf("\n%s, krnl_mat_size = %d, %d concurrent caller(s)\n", name, n, n_caller);
+
+    // 1. Reference results with the shared H2Pack structure
+    for (int i = 0; i < n_vec; i++)
+    {
+        if (is_periodic) H2P_matvec_periodic(h2pack, x + i * n, y_mv + i * n);
+        else H2P_matvec(h2pack, x + i * n, y_mv + i * n);
+    }
+    if (is_periodic) H2P_matmul_periodic(h2pack, CblasColMajor, n_vec, x, n, y_mm, n);
+    else H2P_matmul(h2pack, CblasColMajor, n_vec, x, n, y_mm, n);
+    int n_matvec0 = h2pack->n_matvec;
+
+    // 2. One workspace with the same number of threads as the shared H2Pack structure
+    int n_fail = 0;
+    H2P_matvec_ws_p ws;
+    H2P_matvec_ws_init(&ws, h2pack, 0);
+    ws_matvec(ws, is_periodic, x, y1);
+    n_fail += check_relerr("matvec with workspace", n, y_mv, y1);
+    ws_matmul(ws, is_periodic, n_vec, x, y1);
+    n_fail += check_relerr("matmul with workspace", (int) mat_size, y_mm, y1);
+    if (ws->exec.n_matvec != 1 + n_vec)
+    {
+        printf("  Workspace n_matvec = %d, expected %d FAILED\n", ws->exec.n_matvec, 1 + n_vec);
+        n_fail++;
+    }
+    H2P_matvec_ws_destroy(&ws);
+
+    // 3. Concurrent callers, each with its own single-thread workspace, caller i 
+    //    multiplies the i-th vector, then all vectors, several times
+    const int n_rep = 3;
+    H2P_matvec_ws_p *ws_list = (H2P_matvec_ws_p*) malloc(sizeof(H2P_matvec_ws_p) * n_caller);
+    assert(ws_list != NULL);
+    for (int i = 0; i < n_caller; i++) H2P_matvec_ws_init(&ws_list[i], h2pack, 1);
+    double st = get_wtime_sec();
+    #pragma omp parallel num_threads(n_caller)
+    {
+        int tid = omp_get_thread_num();
+        for (int i = tid; i < n_caller; i += omp_get_num_threads())
+        {
+            for (int k = 0; k < n_rep; k++)
+            {
+                ws_matvec(ws_list[i], is_periodic, x + i * n, y_cmv + i * n);
+                ws_matmul(ws_list[i], is_periodic, n_vec, x, y_cmm + i * mat_size);
+            }
+        }
+    }
+    double et = get_wtime_sec();
+    printf("  %d concurrent caller(s) used %.3lf (s)\n", n_caller, et - st);
+    n_fail += check_relerr("concurrent matvec with workspaces", (int) mat_size, y_mv, y_cmv);
+    for (int i = 0; i < n_caller; i++)
+    {
+        char ws_name[64];
+        sprintf(ws_name, "concurrent matmul, caller %d", i);
+        n_fail += check_relerr(ws_name, (int) mat_size, y_mm, y_cmm + i * mat_size);
+        if (ws_list[i]->exec.n_matvec != n_rep * (1 + n_vec))
+        {
+            printf("  Caller %d workspace n_matvec = %d, expected %d FAILED\n", i, ws_list[i]->exec.n_matvec, n_rep * (1 + n_vec));
+            n_fail++;
+        }
+        H2P_matvec_ws_destroy(&ws_list[i]);
+    }
+    free(ws_list);
+
+    // 4. The shared H2Pack structure should not be changed
+    if (h2pack->n_matvec != n_matvec0)
+    {
+        printf("  Shared H2Pack n_matvec changed from %d to %d FAILED\n", n_matvec0, h2pack->n_matvec);
+        n_fail++;
+    }
+    if (is_periodic) H2P_matvec_periodic(h2pack, x, y1);
+    else H2P_matvec(h2pack, x, y1);
+    n_fail += check_relerr("shared H2Pack matvec after workspaces", n, y_mv, y1);
+
+    free(x);
+    free(y_mv);
+    free(y_mm);
+    free(y1);
+    free(y_cmv);
+    free(y_cmm);
+    return n_fail;
+}
+
+// Periodic RPY Ewald H2 matrix in JIT mode with random points in [0, L]^3
+static int test_periodic_ws(const int n_point, DTYPE rel_tol, const int n_caller)
+{
+    DTYPE L = 2.0 * DPOW((DTYPE) n_point, 1.0 / 3.0), radius = 0.5;
+    DTYPE *coord = (DTYPE*) malloc(sizeof(DTYPE) * n_point * 4);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = L * (DTYPE) drand48();
+    for (int i = 0; i < n_point; i++) coord[3 * n_point + i] = radius;
+    DTYPE unit_cell[6] = {0.0, 0.0, 0.0, L, L, L};
+
+    DTYPE krnl_param[1] = {1.0 / (6.0 * M_PI)};
+    DTYPE pkrnl_param[8] = {L, DSQRT(M_PI) / L, 2, 2, 0, 0, 0, 0};
+    DTYPE *ewald_workbuf;
+    RPY_Ewald_init_workbuf(L, pkrnl_param[1], 2, 2, &ewald_workbuf);
+    memcpy(pkrnl_param + 4, &ewald_workbuf, sizeof(DTYPE*));
+
+    H2Pack_p h2pack;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2pack, 3, 3, QR_REL_NRM, &rel_tol);
+    H2P_run_RPY_Ewald(h2pack);
+    H2P_partition_points_periodic(h2pack, n_point, coord, 0, 0, unit_cell);
+    int num_pp_dim = ceil(-log10(rel_tol));
+    if (num_pp_dim < 4 ) num_pp_dim = 4;
+    if (num_pp_dim > 10) num_pp_dim = 10;
+    H2P_generate_proxy_point_surface(
+        3, 4, 6 * num_pp_dim * num_pp_dim, h2pack->max_level, 
+        h2pack->min_adm_level, unit_cell[3], &pp
+    );
+    H2P_build_periodic(
+        h2pack, pp, 1, krnl_param, RPY_eval_std, 
+        pkrnl_param, RPY_Ewald_eval_std, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop
+    );
+
+    int n_fail = test_ws(h2pack, "Periodic RPY Ewald H2 matrix", 1, n_caller);
+
+    H2P_destroy(&h2pack);
+    free(ewald_workbuf);
+    free(coord);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+    
+    parse_scalar_params(argc, argv);
+    int n_caller = (argc >= 9) ? atoi(argv[8]) : 4;
+    if (n_caller < 1) n_caller = 1;
+
+    int n_fail = 0;
+    H2P_dense_mat_p *pp;
+    for (int is_HSS = 0; is_HSS <= 1; is_HSS++)
+    {
+        H2Pack_p h2pack;
+        H2P_init(&h2pack, test_params.pt_dim, test_params.krnl_dim, QR_REL_NRM, &test_params.rel_tol);
+        if (is_HSS) H2P_run_HSS(h2pack);
+        H2P_calc_enclosing_box(test_params.pt_dim, test_params.n_point, test_params.coord, NULL, &h2pack->root_enbox);
+        H2P_partition_points(h2pack, test_params.n_point, test_params.coord, 0, 0);
+        H2P_generate_proxy_point_ID_file(h2pack, test_params.krnl_param, test_params.krnl_eval, NULL, &pp);
+        H2P_build(
+            h2pack, pp, test_params.BD_JIT, test_params.krnl_param, 
+            test_params.krnl_eval, test_params.krnl_bimv, test_params.krnl_bimv_flops
+        );
+        n_fail += test_ws(h2pack, is_HSS ? "HSS matrix" : "H2 matrix", 0, n_caller);
+        H2P_destroy(&h2pack);
+    }
+    if (test_params.pt_dim == 3)
+        n_fail += test_periodic_ws(test_params.n_point / 10, test_params.rel_tol, n_caller);
+
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+    free_aligned(test_params.coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Mixed precision example: a double precision solver calls the single precision H2 
+ *  matvec (H2P_s_matvec) in the same program. The single precision H2 matrix is built 
+ *  and used in test_mixed_precision.fp32.c, which common.make compiles with 
+ *  -DDTYPE_SIZE=4 and links into this program. 
+ *  (K + shift * I) * x = b, K a 3D Gaussian kernel matrix, is solved by iterative 
+ *  refinement: the residual is computed with the double precision H2 matvec, and each 
+ *  correction is solved by CG with the single precision H2 matvec to a relative 
+ *  residual INNER_RELTOL. The test fails if: 
+ *    1. the single precision matvec relerr vs. the double precision matvec > FP32_RELTOL; 
+ *    2. the relative residual of the refined solution > SOLVE_RELTOL after MAX_REFINE steps. 
+ *  
+ *  Example run: 
+ *  ./test_mixed_precision.exe 8000 1e-2
+ *  Input: 
+ *      8000 --> number of points, random in a cubic box with side length 8000^(1/3)
+ *      1e-2 --> diagonal shift of K
+ */
+
+#define FP64_H2_RELTOL 1e-10
+#define FP32_H2_RELTOL 1e-5
+#define FP32_RELTOL    1e-4
+#define INNER_RELTOL   1e-4
+#define INNER_MAX_ITER 500
+#define MAX_REFINE     10
+#define SOLVE_RELTOL   1e-10
+
+// Implemented in test_mixed_precision.fp32.c
+void  *fp32_H2_build(const int n_point, const double *coord, const double l, const double reltol);
+void   fp32_H2_matvec(void *h2_, const double *x, double *y);
+double fp32_H2_UBD_MB(void *h2_);
+void   fp32_H2_destroy(void *h2_);
+
+static double vec_norm(const int n, const double *x)
+{
+    double res = 0.0;
+    for (int i = 0; i < n; i++) res += x[i] * x[i];
+    return sqrt(res);
+}
+
+// Solve (K_{fp32} + shift * I) * x = b with CG, return the number of iterations
+static int fp32_H2_CG(
+    void *h2_s, const int n, const double shift, const double *b, 
+    double *x, double *r, double *p, double *Ap
+)
+{
+    double b_norm = vec_norm(n, b);
+    memset(x, 0, sizeof(double) * n);
+    memcpy(r, b, sizeof(double) * n);
+    memcpy(p, b, sizeof(double) * n);
+    double rr = b_norm * b_norm;
+    int iter = 0;
+    while (iter < INNER_MAX_ITER && sqrt(rr) > INNER_RELTOL * b_norm)
+    {
+        fp32_H2_matvec(h2_s, p, Ap);
+        double pAp = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            Ap[i] += shift * p[i];
+            pAp   += p[i] * Ap[i];
+        }
+        double alpha = rr / pAp, rr1 = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            rr1  += r[i] * r[i];
+        }
+        double beta = rr1 / rr;
+        for (int i = 0; i < n; i++) p[i] = r[i] + beta * p[i];
+        rr = rr1;
+        iter++;
+    }
+    return iter;
+}
+
+int main(int argc, char **argv)
+{
+    int    n_point = (argc >= 2) ? atoi(argv[1]) : 8000;
+    double shift   = (argc >= 3) ? atof(argv[2]) : 1e-2;
+    double l       = 0.5;
+    printf("n_point = %d, shift = %.2e, fp64 / fp32 H2 reltol = %.2e / %.2e\n", n_point, shift, FP64_H2_RELTOL, FP32_H2_RELTOL);
+
+    // Random points in a cubic box, same density as other test programs
+    srand48(time(NULL));
+    double *coord = (double*) malloc_aligned(sizeof(double) * n_point * 3, 64);
+    assert(coord != NULL);
+    double prefac = pow((double) n_point, 1.0 / 3.0);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = drand48() * prefac;
+
+    // 1. Double and single precision H2 matrices of the same kernel matrix
+    double krnl_param[1] = {l}, reltol = FP64_H2_RELTOL;
+    H2Pack_p h2_d;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2_d, 3, 1, QR_REL_NRM, &reltol);
+    H2P_calc_enclosing_box(3, n_point, coord, NULL, &h2_d->root_enbox);
+    H2P_partition_points(h2_d, n_point, coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(h2_d, krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        h2_d, pp, 0, krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+    void *h2_s = fp32_H2_build(n_point, coord, l, FP32_H2_RELTOL);
+    size_t *mat_size = h2_d->mat_size;
+    double UBD_MB = (double) (mat_size[U_SIZE_IDX] + mat_size[B_SIZE_IDX] + mat_size[D_SIZE_IDX]) * sizeof(double) / 1048576.0;
+    printf("U + B + D size: fp64 H2 %.2lf MB, fp32 H2 %.2lf MB\n", UBD_MB, fp32_H2_UBD_MB(h2_s));
+
+    int n = n_point, n_fail = 0;
+    double *b  = (double*) malloc(sizeof(double) * n);
+    double *x  = (double*) malloc(sizeof(double) * n);
+    double *r  = (double*) malloc(sizeof(double) * n);
+    double *d  = (double*) malloc(sizeof(double) * n);
+    double *w0 = (double*) malloc(sizeof(double) * n);
+    double *w1 = (double*) malloc(sizeof(double) * n);
+    double *w2 = (double*) malloc(sizeof(double) * n);
+    assert(b != NULL && x != NULL && r != NULL && d != NULL && w0 != NULL && w1 != NULL && w2 != NULL);
+    for (int i = 0; i < n; i++) b[i] = drand48() - 0.5;
+
+    // 2. Single precision matvec vs. double precision matvec
+    H2P_matvec(h2_d, b, w0);
+    fp32_H2_matvec(h2_s, b, w1);
+    for (int i = 0; i < n; i++) w1[i] -= w0[i];
+    double fp32_relerr = vec_norm(n, w1) / vec_norm(n, w0);
+    printf("fp32 H2 matvec vs. fp64 H2 matvec relerr = %.3e\n", fp32_relerr);
+    if (!(fp32_relerr <= FP32_RELTOL)) n_fail++;
+
+    // 3. Iterative refinement, r = b - (K_{fp64} + shift * I) * x, (K_{fp32} + shift * I) * d = r
+    double b_norm = vec_norm(n, b), relres = 1.0;
+    double st = get_wtime_sec();
+    memset(x, 0, sizeof(double) * n);
+    memcpy(r, b, sizeof(double) * n);
+    for (int k = 1; k <= MAX_REFINE; k++)
+    {
+        int n_iter = fp32_H2_CG(h2_s, n, shift, r, d, w0, w1, w2);
+        for (int i = 0; i < n; i++) x[i] += d[i];
+        H2P_matvec(h2_d, x, r);
+        for (int i = 0; i < n; i++) r[i] = b[i] - r[i] - shift * x[i];
+        relres = vec_norm(n, r) / b_norm;
+        printf("Refinement step %2d: %3d fp32 CG iterations, ||b - A * x||_2 / ||b||_2 = %.3e\n", k, n_iter, relres);
+        if (relres <= SOLVE_RELTOL) break;
+    }
+    double et = get_wtime_sec();
+    printf("Iterative refinement used %.3lf (s)\n", et - st);
+    if (!(relres <= SOLVE_RELTOL)) n_fail++;
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free(b);
+    free(x);
+    free(r);
+    free(d);
+    free(w0);
+    free(w1);
+    free(w2);
+    free_aligned(coord);
+    fp32_H2_destroy(h2_s);
+    H2P_destroy(&h2_d);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Single precision part of test_mixed_precision.exe. common.make compiles *.fp32.c 
+ *  files with -DDTYPE_SIZE=4, so DTYPE is float and the H2Pack functions called in 
+ *  this file are the single precision versions (H2P_matvec is H2P_s_matvec, see 
+ *  H2Pack_float_symbols.h). The double precision caller only sees the fp32_H2_* 
+ *  functions below, which take and return double precision arrays. 
+ */
+
+struct fp32_H2
+{
+    H2Pack_p h2pack;
+    float    *coord;
+    float    *x;
+    float    *y;
+    float    krnl_param[1];
+};
+
+// Build a single precision 3D Gaussian kernel H2 matrix 
+// Input parameters:
+//   n_point : Number of points
+//   coord   : Size n_point * 3, point coordinates, each column is a point
+//   l       : Gaussian kernel parameter, K(x, y) = exp(-l * |x - y|^2)
+//   reltol  : Relative tolerance of H2 construction
+// Output parameter:
+//   <return> : Pointer to the single precision H2 matrix
+void *fp32_H2_build(const int n_point, const double *coord, const double l, const double reltol)
+{
+    struct fp32_H2 *h2 = (struct fp32_H2 *) malloc(sizeof(struct fp32_H2));
+    assert(h2 != NULL);
+    h2->coord = (float *) malloc_aligned(sizeof(float) * n_point * 3, 64);
+    h2->x     = (float *) malloc(sizeof(float) * n_point);
+    h2->y     = (float *) malloc(sizeof(float) * n_point);
+    assert(h2->coord != NULL && h2->x != NULL && h2->y != NULL);
+    for (int i = 0; i < n_point * 3; i++) h2->coord[i] = (float) coord[i];
+    h2->krnl_param[0] = (float) l;
+
+    float reltol_s = (float) reltol;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2->h2pack, 3, 1, QR_REL_NRM, &reltol_s);
+    H2P_calc_enclosing_box(3, n_point, h2->coord, NULL, &h2->h2pack->root_enbox);
+    H2P_partition_points(h2->h2pack, n_point, h2->coord, 0, 0);
+    H2P_generate_proxy_point_ID_file(h2->h2pack, h2->krnl_param, Gaussian_3D_eval_intrin_t, NULL, &pp);
+    H2P_build(
+        h2->h2pack, pp, 0, h2->krnl_param, Gaussian_3D_eval_intrin_t, 
+        Gaussian_3D_krnl_bimv_intrin_t, Gaussian_3D_krnl_bimv_flop
+    );
+    return (void *) h2;
+}
+
+// Single precision H2 matvec y := K * x with double precision input and output
+void fp32_H2_matvec(void *h2_, const double *x, double *y)
+{
+    struct fp32_H2 *h2 = (struct fp32_H2 *) h2_;
+    int n = h2->h2pack->krnl_mat_size;
+    for (int i = 0; i < n; i++) h2->x[i] = (float) x[i];
+    H2P_matvec(h2->h2pack, h2->x, h2->y);
+    for (int i = 0; i < n; i++) y[i] = (double) h2->y[i];
+}
+
+// Size (MB) of the U, B, and D matrices of the single precision H2 matrix
+double fp32_H2_UBD_MB(void *h2_)
+{
+    struct fp32_H2 *h2 = (struct fp32_H2 *) h2_;
+    size_t *mat_size = h2->h2pack->mat_size;
+    double UBD_size  = (double) (mat_size[U_SIZE_IDX] + mat_size[B_SIZE_IDX] + mat_size[D_SIZE_IDX]);
+    return UBD_size * (double) sizeof(float) / 1048576.0;
+}
+
+void fp32_H2_destroy(void *h2_)
+{
+    struct fp32_H2 *h2 = (struct fp32_H2 *) h2_;
+    H2P_destroy(&h2->h2pack);
+    free_aligned(h2->coord);
+    free(h2->x);
+    free(h2->y);
+    free(h2);
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test periodic H2 matvec and matmul with AOT B & D blocks against JIT B & D 
+ *  evaluation (with and without krnl_mv) on the RPY Ewald summation kernel. 
+ *  The three H2 matrices share the same points and proxy points, so the results 
+ *  should only differ by rounding errors. 
+ *  
+ *  Example run: 
+ *  ./test_periodic_AOT.exe 1500 1e-8 2 1
+ *  Input: 
+ *      1500 --> number of points, random in a cubic unit cell
+ *      1e-8 --> relative tolerance of H2 construction
+ *      2    --> number of real-space and reciprocal-space lattices in each 
+ *               direction of the Ewald summation
+ *      1    --> if the non-uniform point distribution (more points near the 
+ *               corner of the unit cell) is used, it gives leaf nodes at different levels
+ */
+
+static DTYPE calc_relerr(const int len, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE x0_2norm = 0.0, err_2norm = 0.0;
+    for (int i = 0; i < len; i++)
+    {
+        DTYPE diff = x0[i] - x1[i];
+        x0_2norm  += x0[i] * x0[i];
+        err_2norm += diff  * diff;
+    }
+    return DSQRT(err_2norm / x0_2norm);
+}
+
+static H2Pack_p build_periodic_H2(
+    const int n_point, DTYPE *coord, DTYPE *unit_cell, DTYPE rel_tol, H2P_dense_mat_p **pp_, 
+    const int BD_JIT, DTYPE *krnl_param, DTYPE *pkrnl_param, kernel_mv_fptr krnl_mv
+)
+{
+    H2Pack_p h2pack;
+    H2P_init(&h2pack, 3, 3, QR_REL_NRM, &rel_tol);
+    H2P_run_RPY_Ewald(h2pack);
+    H2P_partition_points_periodic(h2pack, n_point, coord, 0, 0, unit_cell);
+    if (*pp_ == NULL)
+    {
+        int num_pp_dim = ceil(-log10(rel_tol));
+        if (num_pp_dim < 4 ) num_pp_dim = 4;
+        if (num_pp_dim > 10) num_pp_dim = 10;
+        H2P_generate_proxy_point_surface(
+            3, 4, 6 * num_pp_dim * num_pp_dim, h2pack->max_level, 
+            h2pack->min_adm_level, unit_cell[3], pp_
+        );
+    }
+    double st = get_wtime_sec();
+    H2P_build_periodic(
+        h2pack, *pp_, BD_JIT, krnl_param, RPY_eval_std, 
+        pkrnl_param, RPY_Ewald_eval_std, krnl_mv, RPY_krnl_mv_flop
+    );
+    double et = get_wtime_sec();
+    printf("H2P_build_periodic (BD_JIT = %d, krnl_mv %s) used %.3lf (s)\n", BD_JIT, (krnl_mv == NULL) ? "no" : "yes", et - st);
+    return h2pack;
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 1500;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    int   n_ewald = (argc >= 4) ? atoi(argv[3]) : 2;
+    int   non_uni = (argc >= 5) ? atoi(argv[4]) : 1;
+    printf("n_point = %d, rel_tol = %.2e, Ewald lattices = %d, non-uniform = %d\n", n_point, rel_tol, n_ewald, non_uni);
+
+    // 1. Random points and radii in the unit cell [0, L]^3
+    DTYPE L = 2.0 * DPOW((DTYPE) n_point, 1.0 / 3.0), radius = 0.5;
+    DTYPE *coord = (DTYPE*) malloc(sizeof(DTYPE) * n_point * 4);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++)
+    {
+        DTYPE u = (DTYPE) drand48();
+        coord[i] = L * ((non_uni) ? u * u * u : u);
+    }
+    for (int i = 0; i < n_point; i++) coord[3 * n_point + i] = radius;
+    DTYPE unit_cell[6] = {0.0, 0.0, 0.0, L, L, L};
+
+    // 2. RPY and RPY Ewald kernel parameters, eta = 1 / (6 * pi) gives a unit prefactor
+    DTYPE krnl_param[1] = {1.0 / (6.0 * M_PI)};
+    DTYPE pkrnl_param[8] = {L, DSQRT(M_PI) / L, (DTYPE) n_ewald, (DTYPE) n_ewald, 0, 0, 0, 0};
+    DTYPE *ewald_workbuf;
+    RPY_Ewald_init_workbuf(L, pkrnl_param[1], n_ewald, n_ewald, &ewald_workbuf);
+    memcpy(pkrnl_param + 4, &ewald_workbuf, sizeof(DTYPE*));
+
+    // 3. Build the same periodic H2 matrix with AOT and JIT B & D
+    H2P_dense_mat_p *pp = NULL;
+    H2Pack_p h2_aot  = build_periodic_H2(n_point, coord, unit_cell, rel_tol, &pp, 0, krnl_param, pkrnl_param, NULL);
+    H2Pack_p h2_jit  = build_periodic_H2(n_point, coord, unit_cell, rel_tol, &pp, 1, krnl_param, pkrnl_param, NULL);
+    H2Pack_p h2_jmv  = build_periodic_H2(n_point, coord, unit_cell, rel_tol, &pp, 1, krnl_param, pkrnl_param, RPY_krnl_mv_intrin_t);
+    int n_mixed_pair = 0, n_self_pair = 0;
+    for (int i = 0; i < h2_aot->n_r_adm_pair; i++)
+    {
+        int node0 = h2_aot->r_adm_pairs[2 * i];
+        int node1 = h2_aot->r_adm_pairs[2 * i + 1];
+        if (h2_aot->node_level[node0] != h2_aot->node_level[node1]) n_mixed_pair++;
+    }
+    for (int i = 0; i < h2_aot->n_r_inadm_pair; i++)
+        if (h2_aot->r_inadm_pairs[2 * i] == h2_aot->r_inadm_pairs[2 * i + 1]) n_self_pair++;
+    printf(
+        "%d admissible pairs (%d between different levels), %d inadmissible pairs (%d with periodic images of the same node)\n", 
+        h2_aot->n_r_adm_pair, n_mixed_pair, h2_aot->n_r_inadm_pair, n_self_pair
+    );
+
+    // 4. Compare matvec and matmul results
+    int krnl_mat_size = h2_aot->krnl_mat_size;
+    int n_vec = 8, mat_size = krnl_mat_size * n_vec;
+    DTYPE *x  = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y0 = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y1 = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    DTYPE *y2 = (DTYPE*) malloc(sizeof(DTYPE) * mat_size);
+    assert(x != NULL && y0 != NULL && y1 != NULL && y2 != NULL);
+    for (int i = 0; i < mat_size; i++) x[i] = (DTYPE) drand48() - 0.5;
+
+    H2P_matvec_periodic(h2_aot, x, y0);
+    H2P_matvec_periodic(h2_jit, x, y1);
+    H2P_matvec_periodic(h2_jmv, x, y2);
+    printf("Matvec relerr: AOT vs. JIT = %e, AOT vs. JIT with krnl_mv = %e\n", calc_relerr(krnl_mat_size, y1, y0), calc_relerr(krnl_mat_size, y2, y0));
+    if (n_point <= 4000)
+    {
+        // Direct Ewald summation, x and y are in the original point ordering
+        DTYPE *Ewald_mat = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * krnl_mat_size);
+        assert(Ewald_mat != NULL);
+        RPY_Ewald_eval_std(coord, n_point, n_point, coord, n_point, n_point, pkrnl_param, Ewald_mat, krnl_mat_size);
+        CBLAS_GEMV(CblasRowMajor, CblasNoTrans, krnl_mat_size, krnl_mat_size, 1.0, Ewald_mat, krnl_mat_size, x, 1, 0.0, y1, 1);
+        printf("Matvec relerr: AOT vs. direct Ewald summation = %e\n", calc_relerr(krnl_mat_size, y1, y0));
+        free(Ewald_mat);
+    }
+
+    for (int layout = 0; layout < 2; layout++)
+    {
+        CBLAS_LAYOUT mm_layout = (layout == 0) ? CblasRowMajor : CblasColMajor;
+        int ld = (layout == 0) ? n_vec : krnl_mat_size;
+        H2P_matmul_periodic(h2_aot, mm_layout, n_vec, x, ld, y0, ld);
+        H2P_matmul_periodic(h2_jit, mm_layout, n_vec, x, ld, y1, ld);
+        H2P_matmul_periodic(h2_jmv, mm_layout, n_vec, x, ld, y2, ld);
+        printf(
+            "%s matmul relerr: AOT vs. JIT = %e, AOT vs. JIT with krnl_mv = %e\n", (layout == 0) ? "Row-major" : "Col-major", 
+            calc_relerr(mat_size, y1, y0), calc_relerr(mat_size, y2, y0)
+        );
+    }
+
+    H2P_print_statistic(h2_aot);
+
+    free(x);
+    free(y0);
+    free(y1);
+    free(y2);
+    free(coord);
+    free(ewald_workbuf);
+    H2P_destroy(&h2_aot);
+    H2P_destroy(&h2_jit);
+    H2P_destroy(&h2_jmv);
+    return 0;
+}
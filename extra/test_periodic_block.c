@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+#include "H2Pack_utils.h"
+
+/*
+ *  Test the periodic block of the root node built by H2P_build_periodic() on the RPY 
+ *  Ewald summation kernel. H2P_build_periodic_block() splits the rows of the block 
+ *  over threads, each thread evaluates all shifted lattice blocks of its rows. 
+ *  1. The stored block should match the dense block rebuilt serially from its 
+ *     definition pkernel(J, J) - sum_{lattice} kernel(J, J + shift) on the skeleton 
+ *     points J of the root node. 
+ *  2. Swapping the rebuilt block into the same H2 matrix should not change the 
+ *     matvec and matmul results beyond rounding errors. If n_point <= 4000, the 
+ *     matvec error against direct Ewald summation is also printed for reference. 
+ *  
+ *  Example run: 
+ *  ./test_periodic_block.exe 2000 1e-8 2
+ *  Input: 
+ *      2000 --> number of points, random in a cubic unit cell
+ *      1e-8 --> relative tolerance of H2 construction
+ *      2    --> number of real-space and reciprocal-space lattices in each 
+ *               direction of the Ewald summation
+ */
+
+static DTYPE calc_relerr(const int len, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE x0_2norm = 0.0, err_2norm = 0.0;
+    for (int i = 0; i < len; i++)
+    {
+        DTYPE diff = x0[i] - x1[i];
+        x0_2norm  += x0[i] * x0[i];
+        err_2norm += diff  * diff;
+    }
+    return DSQRT(err_2norm / x0_2norm);
+}
+
+// Dense periodic block of the root node, O = pkernel(J, J) - sum_{lattice} kernel(J, J + shift)
+static DTYPE *dense_periodic_block(H2Pack_p h2pack)
+{
+    int   pt_dim   = h2pack->pt_dim;
+    int   xpt_dim  = h2pack->xpt_dim;
+    int   root_idx = h2pack->root_idx;
+    DTYPE *width   = h2pack->enbox + (root_idx * (2 * pt_dim) + pt_dim);
+    H2P_dense_mat_p J_coord = h2pack->J_coord[root_idx];
+    int n_root = J_coord->ncol;
+    int n = n_root * h2pack->krnl_dim;
+
+    DTYPE *per_blk = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n * n, 64);
+    DTYPE *tmp     = (DTYPE*) malloc(sizeof(DTYPE) * n * n);
+    DTYPE *coord_s = (DTYPE*) malloc(sizeof(DTYPE) * xpt_dim * n_root);
+    assert(per_blk != NULL && tmp != NULL && coord_s != NULL);
+    h2pack->pkrnl_eval(
+        J_coord->data, J_coord->ld, n_root, J_coord->data, J_coord->ld, n_root, 
+        h2pack->pkrnl_param, per_blk, n
+    );
+    for (int l = 0; l < h2pack->n_lattice; l++)
+    {
+        DTYPE *lattice_l = h2pack->per_lattices + l * pt_dim;
+        for (int j = 0; j < xpt_dim; j++)
+        {
+            DTYPE shift = (j < pt_dim) ? (width[j] * lattice_l[j]) : 0.0;
+            for (int i = 0; i < n_root; i++)
+                coord_s[j * n_root + i] = J_coord->data[j * J_coord->ld + i] + shift;
+        }
+        h2pack->krnl_eval(
+            J_coord->data, J_coord->ld, n_root, coord_s, n_root, n_root, 
+            h2pack->krnl_param, tmp, n
+        );
+        for (int i = 0; i < n * n; i++) per_blk[i] -= tmp[i];
+    }
+    free(tmp);
+    free(coord_s);
+    return per_blk;
+}
+
+// Swap per_blk_{0,1} into h2pack and compare the periodic matvec and matmul 
+// results, the stored periodic block of h2pack is restored
+static void compare_matvec_matmul(
+    H2Pack_p h2pack, DTYPE *per_blk0, DTYPE *per_blk1, const int n_vec, 
+    const DTYPE *x, DTYPE *y0, DTYPE *y1, DTYPE *mv_relerr, DTYPE *mm_relerr
+)
+{
+    DTYPE *per_blk = h2pack->per_blk;
+    int   krnl_mat_size = h2pack->krnl_mat_size;
+    h2pack->per_blk = per_blk0;
+    H2P_matvec_periodic(h2pack, x, y0);
+    h2pack->per_blk = per_blk1;
+    H2P_matvec_periodic(h2pack, x, y1);
+    *mv_relerr = calc_relerr(krnl_mat_size, y0, y1);
+    H2P_matmul_periodic(h2pack, CblasRowMajor, n_vec, x, n_vec, y1, n_vec);
+    h2pack->per_blk = per_blk0;
+    H2P_matmul_periodic(h2pack, CblasRowMajor, n_vec, x, n_vec, y0, n_vec);
+    *mm_relerr = calc_relerr(krnl_mat_size * n_vec, y0, y1);
+    h2pack->per_blk = per_blk;
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 2000;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    int   n_ewald = (argc >= 4) ? atoi(argv[3]) : 2;
+    printf("n_point = %d, rel_tol = %.2e, Ewald lattices = %d\n", n_point, rel_tol, n_ewald);
+
+    // 1. Random points and radii in the unit cell [0, L]^3
+    DTYPE L = 2.0 * DPOW((DTYPE) n_point, 1.0 / 3.0), radius = 0.5;
+    DTYPE *coord = (DTYPE*) malloc(sizeof(DTYPE) * n_point * 4);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = L * (DTYPE) drand48();
+    for (int i = 0; i < n_point; i++) coord[3 * n_point + i] = radius;
+    DTYPE unit_cell[6] = {0.0, 0.0, 0.0, L, L, L};
+
+    // 2. RPY and RPY Ewald kernel parameters, eta = 1 / (6 * pi) gives a unit prefactor
+    DTYPE krnl_param[1] = {1.0 / (6.0 * M_PI)};
+    DTYPE pkrnl_param[8] = {L, DSQRT(M_PI) / L, (DTYPE) n_ewald, (DTYPE) n_ewald, 0, 0, 0, 0};
+    DTYPE *ewald_workbuf;
+    RPY_Ewald_init_workbuf(L, pkrnl_param[1], n_ewald, n_ewald, &ewald_workbuf);
+    memcpy(pkrnl_param + 4, &ewald_workbuf, sizeof(DTYPE*));
+
+    // 3. Periodic H2 matrix
+    H2Pack_p h2pack;
+    H2P_dense_mat_p *pp;
+    H2P_init(&h2pack, 3, 3, QR_REL_NRM, &rel_tol);
+    H2P_run_RPY_Ewald(h2pack);
+    H2P_partition_points_periodic(h2pack, n_point, coord, 0, 0, unit_cell);
+    int num_pp_dim = ceil(-log10(rel_tol));
+    if (num_pp_dim < 4 ) num_pp_dim = 4;
+    if (num_pp_dim > 10) num_pp_dim = 10;
+    H2P_generate_proxy_point_surface(
+        3, 4, 6 * num_pp_dim * num_pp_dim, h2pack->max_level, 
+        h2pack->min_adm_level, unit_cell[3], &pp
+    );
+    double st = get_wtime_sec();
+    H2P_build_periodic(
+        h2pack, pp, 1, krnl_param, RPY_eval_std, 
+        pkrnl_param, RPY_Ewald_eval_std, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop
+    );
+    double et = get_wtime_sec();
+    printf("H2P_build_periodic used %.3lf (s)\n", et - st);
+
+    int root_idx = h2pack->root_idx;
+    int n = h2pack->J[root_idx]->length * h2pack->krnl_dim;
+    DTYPE *per_blk_s = h2pack->per_blk;
+    DTYPE *per_blk_d = dense_periodic_block(h2pack);
+    printf("Periodic block size = %d, %d thread(s)\n", n, h2pack->n_thread);
+    int n_fail = 0;
+
+    // 4. Compare the stored block with the rebuilt block
+    DTYPE blk_relerr = calc_relerr(n * n, per_blk_d, per_blk_s);
+    printf("Stored periodic block vs. rebuilt periodic block relerr = %e\n", blk_relerr);
+    if (!(blk_relerr <= 1e-12)) n_fail++;
+
+    // 5. Full matvec and matmul with the stored block and with the rebuilt block
+    int n_vec = 8, krnl_mat_size = h2pack->krnl_mat_size;
+    DTYPE *x  = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * n_vec);
+    DTYPE *y0 = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * n_vec);
+    DTYPE *y1 = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * n_vec);
+    assert(x != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < krnl_mat_size * n_vec; i++) x[i] = (DTYPE) drand48() - 0.5;
+    DTYPE mv_relerr, mm_relerr;
+    compare_matvec_matmul(h2pack, per_blk_d, per_blk_s, n_vec, x, y0, y1, &mv_relerr, &mm_relerr);
+    printf("Stored vs. rebuilt periodic block: matvec relerr = %e, matmul relerr = %e\n", mv_relerr, mm_relerr);
+    if (!(mv_relerr <= 1e-12 && mm_relerr <= 1e-12)) n_fail++;
+    if (n_point <= 4000)
+    {
+        DTYPE *Ewald_mat = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * krnl_mat_size);
+        assert(Ewald_mat != NULL);
+        RPY_Ewald_eval_std(coord, n_point, n_point, coord, n_point, n_point, pkrnl_param, Ewald_mat, krnl_mat_size);
+        CBLAS_GEMV(CblasRowMajor, CblasNoTrans, krnl_mat_size, krnl_mat_size, 1.0, Ewald_mat, krnl_mat_size, x, 1, 0.0, y0, 1);
+        H2P_matvec_periodic(h2pack, x, y1);
+        DTYPE H2_relerr = calc_relerr(krnl_mat_size, y0, y1);
+        printf("Matvec relerr vs. direct Ewald summation = %e\n", H2_relerr);
+        free(Ewald_mat);
+    }
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free(x);
+    free(y0);
+    free(y1);
+    free(coord);
+    free(ewald_workbuf);
+    free_aligned(per_blk_d);
+    H2P_destroy(&h2pack);
+    return (n_fail == 0) ? 0 : 1;
+}
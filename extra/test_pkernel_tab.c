@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+/*
+ *  Test the tabulated periodic kernel correction (H2P_pkernel_tab) on the RPY 
+ *  Ewald summation kernel: 
+ *  (1) the measured interpolation error on random point pairs should not be 
+ *      larger than tab->max_relerr reported by H2P_pkernel_tab_init();
+ *  (2) periodic H2 matvec using the table should match periodic H2 matvec 
+ *      using the exact Ewald summation up to the table tolerance;
+ *  (3) if the table tolerance cannot be reached, H2P_pkernel_tab_init() returns 
+ *      NULL and the exact Ewald summation is used.
+ *  
+ *  Example run: 
+ *  ./test_pkernel_tab.exe 1500 1e-8 1e-6 2
+ *  Input: 
+ *      1500 --> number of points, random in a cubic unit cell
+ *      1e-8 --> relative tolerance of H2 construction
+ *      1e-6 --> relative tolerance of the periodic kernel table, use 1e-15 to 
+ *               test the fallback when the table cannot reach the tolerance
+ *      2    --> number of real-space and reciprocal-space lattices in each 
+ *               direction of the Ewald summation
+ */
+
+static DTYPE calc_relerr(const int len, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE x0_2norm = 0.0, err_2norm = 0.0;
+    for (int i = 0; i < len; i++)
+    {
+        DTYPE diff = x0[i] - x1[i];
+        x0_2norm  += x0[i] * x0[i];
+        err_2norm += diff  * diff;
+    }
+    return DSQRT(err_2norm / x0_2norm);
+}
+
+static H2Pack_p build_periodic_H2(
+    const int n_point, DTYPE *coord, DTYPE *unit_cell, DTYPE rel_tol, H2P_dense_mat_p **pp_, 
+    DTYPE *krnl_param, void *pkrnl_param, kernel_eval_fptr pkrnl_eval
+)
+{
+    H2Pack_p h2pack;
+    H2P_init(&h2pack, 3, 3, QR_REL_NRM, &rel_tol);
+    H2P_run_RPY_Ewald(h2pack);
+    H2P_partition_points_periodic(h2pack, n_point, coord, 0, 0, unit_cell);
+    if (*pp_ == NULL)
+    {
+        int num_pp_dim = ceil(-log10(rel_tol));
+        if (num_pp_dim < 4 ) num_pp_dim = 4;
+        if (num_pp_dim > 10) num_pp_dim = 10;
+        H2P_generate_proxy_point_surface(
+            3, 4, 6 * num_pp_dim * num_pp_dim, h2pack->max_level, 
+            h2pack->min_adm_level, unit_cell[3], pp_
+        );
+    }
+    double st = get_wtime_sec();
+    H2P_build_periodic(
+        h2pack, *pp_, 1, krnl_param, RPY_eval_std, 
+        pkrnl_param, pkrnl_eval, RPY_krnl_mv_intrin_t, RPY_krnl_mv_flop
+    );
+    double et = get_wtime_sec();
+    printf(
+        "H2P_build_periodic with %s used %.3lf (s), periodic block built in %.3lf (s)\n", 
+        (pkrnl_eval == H2P_pkernel_tab_eval) ? "periodic kernel table" : "Ewald summation", 
+        et - st, h2pack->timers[B_BUILD_TIMER_IDX]
+    );
+    return h2pack;
+}
+
+int main(int argc, char **argv)
+{
+    srand48(time(NULL));
+
+    int   n_point = (argc >= 2) ? atoi(argv[1]) : 1500;
+    DTYPE rel_tol = (argc >= 3) ? (DTYPE) atof(argv[2]) : 1e-8;
+    DTYPE tab_tol = (argc >= 4) ? (DTYPE) atof(argv[3]) : rel_tol;
+    int   n_ewald = (argc >= 5) ? atoi(argv[4]) : 2;
+    printf("n_point = %d, H2 reltol = %.2e, table reltol = %.2e, Ewald lattices = %d\n", n_point, rel_tol, tab_tol, n_ewald);
+
+    // 1. Random points in the unit cell [0, L]^3, all points have the same radius
+    DTYPE L = 2.0 * DPOW((DTYPE) n_point, 1.0 / 3.0), radius = 0.5;
+    DTYPE *coord = (DTYPE*) malloc(sizeof(DTYPE) * n_point * 4);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = L * (DTYPE) drand48();
+    for (int i = 0; i < n_point; i++) coord[3 * n_point + i] = radius;
+    DTYPE unit_cell[6] = {0.0, 0.0, 0.0, L, L, L};
+
+    DTYPE krnl_param[1] = {1.0 / (6.0 * M_PI)};
+    DTYPE pkrnl_param[8] = {L, DSQRT(M_PI) / L, (DTYPE) n_ewald, (DTYPE) n_ewald, 0, 0, 0, 0};
+    DTYPE *ewald_workbuf;
+    RPY_Ewald_init_workbuf(L, pkrnl_param[1], n_ewald, n_ewald, &ewald_workbuf);
+    memcpy(pkrnl_param + 4, &ewald_workbuf, sizeof(DTYPE*));
+
+    // 2. Build the table and check its error on random point pairs
+    H2P_pkernel_tab_p tab = NULL;
+    DTYPE cell_width[3] = {L, L, L};
+    double st = get_wtime_sec();
+    H2P_pkernel_tab_init(
+        3, 4, 3, cell_width, &radius, krnl_param, RPY_eval_std, 
+        pkrnl_param, RPY_Ewald_eval_std, tab_tol, &tab
+    );
+    double et = get_wtime_sec();
+    if (tab == NULL)
+    {
+        printf("H2P_pkernel_tab_init used %.3lf (s) and failed, use Ewald summation only\n", et - st);
+    } else {
+        printf(
+            "H2P_pkernel_tab_init used %.3lf (s), n_cheb = %d, n_box = %d, %.2lf MB, max_relerr = %.3e\n", 
+            et - st, tab->n_cheb, tab->n_box, (double) tab->mem_size * sizeof(DTYPE) / 1048576.0, tab->max_relerr
+        );
+        int n_check = 200, check_size = n_check * 3;
+        DTYPE *check_coord = (DTYPE*) malloc(sizeof(DTYPE) * n_check * 4);
+        DTYPE *mat_tab  = (DTYPE*) malloc(sizeof(DTYPE) * check_size * check_size);
+        DTYPE *mat_ref  = (DTYPE*) malloc(sizeof(DTYPE) * check_size * check_size);
+        DTYPE *mat_corr = (DTYPE*) malloc(sizeof(DTYPE) * check_size * check_size);
+        assert(check_coord != NULL && mat_tab != NULL && mat_ref != NULL && mat_corr != NULL);
+        for (int i = 0; i < n_check * 3; i++) check_coord[i] = L * (DTYPE) drand48();
+        for (int i = 0; i < n_check; i++) check_coord[3 * n_check + i] = radius;
+        H2P_pkernel_tab_eval(check_coord, n_check, n_check, check_coord, n_check, n_check, tab, mat_tab, check_size);
+        RPY_Ewald_eval_std(check_coord, n_check, n_check, check_coord, n_check, n_check, pkrnl_param, mat_ref, check_size);
+        H2P_pkernel_tab_eval_corr(tab, check_coord, n_check, n_check, check_coord, n_check, n_check, mat_corr, check_size);
+        DTYPE max_err = 0.0, max_corr = 0.0;
+        for (int i = 0; i < check_size * check_size; i++)
+        {
+            max_err  = MAX(max_err,  DABS(mat_tab[i] - mat_ref[i]));
+            max_corr = MAX(max_corr, DABS(mat_corr[i]));
+        }
+        printf(
+            "Random point pairs: max |error| / max |correction| = %.3e (reported %.3e), kernel matrix relerr = %.3e\n", 
+            max_err / max_corr, tab->max_relerr, calc_relerr(check_size * check_size, mat_ref, mat_tab)
+        );
+        free(check_coord);
+        free(mat_tab);
+        free(mat_ref);
+        free(mat_corr);
+    }
+
+    // 3. Compare periodic H2 matvec using the table and the Ewald summation
+    H2P_dense_mat_p *pp = NULL;
+    H2Pack_p h2_ewald = build_periodic_H2(n_point, coord, unit_cell, rel_tol, &pp, krnl_param, pkrnl_param, RPY_Ewald_eval_std);
+    int krnl_mat_size = h2_ewald->krnl_mat_size;
+    DTYPE *x  = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+    DTYPE *y0 = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+    DTYPE *y1 = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+    assert(x != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < krnl_mat_size; i++) x[i] = (DTYPE) drand48() - 0.5;
+    H2P_matvec_periodic(h2_ewald, x, y0);
+    if (tab != NULL)
+    {
+        H2Pack_p h2_tab = build_periodic_H2(n_point, coord, unit_cell, rel_tol, &pp, krnl_param, tab, H2P_pkernel_tab_eval);
+        H2P_matvec_periodic(h2_tab, x, y1);
+        printf("Matvec relerr: periodic kernel table vs. Ewald summation = %e\n", calc_relerr(krnl_mat_size, y0, y1));
+        H2P_destroy(&h2_tab);
+    }
+    if (n_point <= 4000)
+    {
+        DTYPE *Ewald_mat = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size * krnl_mat_size);
+        assert(Ewald_mat != NULL);
+        RPY_Ewald_eval_std(coord, n_point, n_point, coord, n_point, n_point, pkrnl_param, Ewald_mat, krnl_mat_size);
+        CBLAS_GEMV(CblasRowMajor, CblasNoTrans, krnl_mat_size, krnl_mat_size, 1.0, Ewald_mat, krnl_mat_size, x, 1, 0.0, y1, 1);
+        printf("Matvec relerr: Ewald summation H2 vs. direct Ewald summation = %e\n", calc_relerr(krnl_mat_size, y1, y0));
+        free(Ewald_mat);
+    }
+
+    free(x);
+    free(y0);
+    free(y1);
+    free(coord);
+    free(ewald_workbuf);
+    H2P_pkernel_tab_destroy(&tab);
+    H2P_destroy(&h2_ewald);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <omp.h>
+
+#include "H2Pack.h"
+#include "H2Pack_kernels.h"
+
+#include "direct_nbody.h"
+
+/*
+ *  Test rectangular H2 matrices (H2Pack_rect.h) with the 3D Coulomb kernel. 
+ *  H2P_rect_matvec() is compared with direct_nbody() for: 
+ *    1. fewer row points than column points, in the same cubic box; 
+ *    2. more row points than column points, in the same cubic box; 
+ *    3. row points and column points in two disjoint boxes; 
+ *  each in AOT and JIT mode. The relative error should be <= RECT_RELERR_FACTOR * rel_tol. 
+ *  
+ *  Example run: 
+ *  ./test_rect.exe 8000 20000 1e-8
+ *  Input: 
+ *      8000  --> number of points in the smaller point set
+ *      20000 --> number of points in the larger point set
+ *      1e-8  --> relative tolerance of H2 construction
+ */
+
+#define RECT_RELERR_FACTOR 10.0
+
+static DTYPE calc_relerr(const int n, const DTYPE *x0, const DTYPE *x1)
+{
+    DTYPE ref_norm = 0.0, err_norm = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        DTYPE diff = x1[i] - x0[i];
+        ref_norm += x0[i] * x0[i];
+        err_norm += diff * diff;
+    }
+    return DSQRT(err_norm) / DSQRT(ref_norm);
+}
+
+// Random points in the box [shift, shift + L] x [0, L] x [0, L]
+static DTYPE *random_points(const int n_point, const DTYPE L, const DTYPE shift)
+{
+    DTYPE *coord = (DTYPE*) malloc_aligned(sizeof(DTYPE) * n_point * 3, 64);
+    assert(coord != NULL);
+    for (int i = 0; i < n_point * 3; i++) coord[i] = L * (DTYPE) drand48();
+    for (int i = 0; i < n_point; i++) coord[i] += shift;
+    return coord;
+}
+
+static int test_rect(
+    const int n_row, DTYPE *row_coord, const int n_col, DTYPE *col_coord, 
+    DTYPE rel_tol, const char *name
+)
+{
+    DTYPE *x  = (DTYPE*) malloc(sizeof(DTYPE) * n_col);
+    DTYPE *y0 = (DTYPE*) malloc(sizeof(DTYPE) * n_row);
+    DTYPE *y1 = (DTYPE*) malloc(sizeof(DTYPE) * n_row);
+    assert(x != NULL && y0 != NULL && y1 != NULL);
+    for (int i = 0; i < n_col; i++) x[i] = (DTYPE) drand48() - 0.5;
+    direct_nbody(
+        NULL, Coulomb_3D_eval_intrin_t, 3, 1, 
+        col_coord, n_col, n_col, x, 
+        row_coord, n_row, n_row, y0
+    );
+
+    int n_fail = 0;
+    printf("\n%s, n_row = %d, n_col = %d\n", name, n_row, n_col);
+    for (int BD_JIT = 0; BD_JIT <= 1; BD_JIT++)
+    {
+        H2P_rect_p rect;
+        H2P_dense_mat_p *pp;
+        double st = get_wtime_sec();
+        H2P_rect_init(&rect, 3, 1, QR_REL_NRM, &rel_tol);
+        H2P_rect_partition_points(rect, n_row, row_coord, n_col, col_coord, 0, 0);
+        H2P_rect_generate_proxy_point_ID_file(rect, NULL, Coulomb_3D_eval_intrin_t, NULL, &pp);
+        H2P_rect_build(rect, pp, BD_JIT, NULL, Coulomb_3D_eval_intrin_t);
+        double et = get_wtime_sec();
+        double ut_build = et - st;
+        st = get_wtime_sec();
+        H2P_rect_matvec(rect, x, y1);
+        et = get_wtime_sec();
+        DTYPE relerr = calc_relerr(n_row, y0, y1);
+        int fail = !(relerr <= RECT_RELERR_FACTOR * rel_tol);
+        printf(
+            "  %s: %4d admissible pairs, %5d inadmissible pairs, build %.3lf (s), matvec %.3lf (s), relerr = %.3e %s\n", 
+            BD_JIT ? "JIT" : "AOT", rect->n_r_adm_pair, rect->n_r_inadm_pair, ut_build, et - st, relerr, fail ? "FAILED" : ""
+        );
+        n_fail += fail;
+        H2P_rect_destroy(&rect);
+    }
+
+    free(x);
+    free(y0);
+    free(y1);
+    return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+    int   n_small = (argc >= 2) ? atoi(argv[1]) : 8000;
+    int   n_large = (argc >= 3) ? atoi(argv[2]) : 20000;
+    DTYPE rel_tol = (argc >= 4) ? (DTYPE) atof(argv[3]) : 1e-8;
+    printf("n_small = %d, n_large = %d, rel_tol = %.2e\n", n_small, n_large, rel_tol);
+
+    // Same point density as other test programs for the larger point set
+    srand48(time(NULL));
+    DTYPE L = DPOW((DTYPE) n_large, 1.0 / 3.0);
+    DTYPE *small_coord = random_points(n_small, L, 0.0);
+    DTYPE *large_coord = random_points(n_large, L, 0.0);
+    DTYPE *far_coord   = random_points(n_large, L, 1.5 * L);
+
+    int n_fail = 0;
+    n_fail += test_rect(n_small, small_coord, n_large, large_coord, rel_tol, "Same box, n_row < n_col");
+    n_fail += test_rect(n_large, large_coord, n_small, small_coord, rel_tol, "Same box, n_row > n_col");
+    n_fail += test_rect(n_small, small_coord, n_large, far_coord,   rel_tol, "Disjoint boxes");
+    printf("\n%s: %d check(s) failed\n", (n_fail == 0) ? "PASSED" : "FAILED", n_fail);
+
+    free_aligned(small_coord);
+    free_aligned(large_coord);
+    free_aligned(far_coord);
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -9,7 +9,7 @@ extra_cflags += ["-g", "-std=gnu99", "-O3"]
 extra_cflags += ["-DUSE_MKL", "-qopenmp", "-xHost", "-mkl"]
 
 LIB = [H2PACK_DIR+"/lib/libH2Pack.a"]
-extra_lflags = LIB + ["-g", "-O3", "-qopenmp", "-L${MKLROOT}/lib/intel64", "-mkl_rt", "-lpthread"]
+extra_lflags = LIB + ["-g", "-O3", "-qopenmp", "-L${MKLROOT}/lib/intel64", "-mkl_rt", "-lpthread", "-lrt"]
 
 def main():
     setup(name="pyh2pack",
@@ -31,9 +31,21 @@
 // H2Pack H2/HSS fast matrix-vector multiplication
 #include "H2Pack_matvec.h"
 
+// H2Pack tabulated periodic system kernel correction
+#include "H2Pack_pkernel_tab.h"
+
 // H2Pack H2 fast matrix-vector multiplication for periodic system
 #include "H2Pack_matvec_periodic.h"
 
+// H2Pack H2/HSS fast matrix-vector multiplication for derivative kernels
+#include "H2Pack_matvec_dkrnl.h"
+
+// H2Pack per-caller matvec workspace for concurrent multiplications
+#include "H2Pack_matvec_ws.h"
+
+// H2Pack rectangular H2 matrix with two point sets
+#include "H2Pack_rect.h"
+
 // H2Pack H2/HSS fast matrix-matrix multiplication
 #include "H2Pack_matmul.h"
 
@@ -43,6 +55,18 @@
 // H2Pack HSS ULV decomposition and solve
 #include "H2Pack_HSS_ULV.h"
 
+// H2Pack HSS ULV Cholesky decomposition for multiple shifts
+#include "H2Pack_HSS_ULV_mshift.h"
+
+// H2Pack stochastic trace estimator using HSS ULV factorization
+#include "H2Pack_HSS_ULV_trace.h"
+
+// H2Pack black-box HSS construction from operator matmul
+#include "H2Pack_HSS_blackbox.h"
+
+// H2Pack HSS matvec & matmul with sibling couplings
+#include "H2Pack_HSS_matvec.h"
+
 // H2Pack SPDHSS H2 build
 #include "H2Pack_SPDHSS_H2.h"
 
@@ -38,7 +38,7 @@ extern "C" {
 // ====================   Laplace Kernel   ==================== //
 // ============================================================ //
 
-const  int  Laplace_2D_krnl_bimv_flop = 11;
+#define Laplace_2D_krnl_bimv_flop 11
 
 static void Laplace_2D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -136,7 +136,7 @@ static void Laplace_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ====================   Gaussian Kernel   =================== //
 // ============================================================ //
 
-const  int  Gaussian_2D_krnl_bimv_flop = 11;
+#define Gaussian_2D_krnl_bimv_flop 11
 
 static void Gaussian_2D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -230,7 +230,7 @@ static void Gaussian_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ==================   Exponential Kernel   ================== //
 // ============================================================ //
 
-const  int  Expon_2D_krnl_bimv_flop = 12;
+#define Expon_2D_krnl_bimv_flop 12
 
 static void Expon_2D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -327,7 +327,7 @@ static void Expon_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Matern 3/2 Kernel   ================== //
 // ============================================================ //
 
-const  int  Matern32_2D_krnl_bimv_flop = 14;
+#define Matern32_2D_krnl_bimv_flop 14
 
 #define NSQRT3 -1.7320508075688772
 
@@ -433,7 +433,7 @@ static void Matern32_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Matern 5/2 Kernel   ================== //
 // ============================================================ //
 
-const  int  Matern52_2D_krnl_bimv_flop = 17;
+#define Matern52_2D_krnl_bimv_flop 17
 
 #define NSQRT5 -2.2360679774997896
 #define _1o3    0.3333333333333333
@@ -554,7 +554,7 @@ static void Matern52_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Quadratic Kernel   =================== //
 // ============================================================ //
 
-const  int  Quadratic_2D_krnl_bimv_flop = 12;
+#define Quadratic_2D_krnl_bimv_flop 12
 
 static void Quadratic_2D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -655,6 +655,504 @@ static void Quadratic_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
     }
 }
 
+// ============================================================ //
+// =================   Gaussian Kernel d/dl   ================= //
+// ============================================================ //
+
+// k(x, y) = exp(-l * |x-y|^2), dk/dl = -|x-y|^2 * exp(-l * |x-y|^2)
+
+#define Gaussian_dl_2D_krnl_bimv_flop 13
+
+static void Gaussian_dl_2D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE r2 = dx * dx + dy * dy;
+                mat_irow[j] = -r2 * exp(neg_l * r2);
+            }
+        }
+    }
+}
+
+static void Gaussian_dl_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ===============   Exponential Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = exp(-l * |x-y|), dk/dl = -|x-y| * exp(-l * |x-y|)
+
+#define Expon_dl_2D_krnl_bimv_flop 14
+
+static void Expon_dl_2D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_sqrt_t(r20);
+            r21 = vec_sqrt_t(r21);
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE r2 = dx * dx + dy * dy;
+                DTYPE r = sqrt(r2);
+                mat_irow[j] = -r * exp(neg_l * r);
+            }
+        }
+    }
+}
+
+static void Expon_dl_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            r20 = vec_sqrt_t(r20);
+            r21 = vec_sqrt_t(r21);
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ================   Matern 3/2 Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = (1 + l*k) * exp(-l*k), k = sqrt(3) * |x-y|,
+// dk/dl = -3 * l * |x-y|^2 * exp(-l*k)
+
+#define Matern32_dl_2D_krnl_bimv_flop 15
+
+static void Matern32_dl_2D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const DTYPE n3l = -3.0 * param_[0];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t n3l_v = vec_set1_t(n3l);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r20)));
+            t1 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r21)));
+            r20 = vec_mul_t(vec_mul_t(n3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n3l_v, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE r2 = dx * dx + dy * dy;
+                mat_irow[j] = n3l * r2 * exp(nsqrt3_l * sqrt(r2));
+            }
+        }
+    }
+}
+
+static void Matern32_dl_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const DTYPE n3l = -3.0 * param_[0];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t n3l_v = vec_set1_t(n3l);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r20)));
+            t1 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r21)));
+            r20 = vec_mul_t(vec_mul_t(n3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n3l_v, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ================   Matern 5/2 Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = (1 + l*k + l^2*k^2/3) * exp(-l*k), k = sqrt(5) * |x-y|,
+// dk/dl = -5/3 * l * |x-y|^2 * (1 + l*k) * exp(-l*k)
+
+#define Matern52_dl_2D_krnl_bimv_flop 18
+
+static void Matern52_dl_2D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const DTYPE n5o3l = -5.0 * _1o3 * param_[0];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t n5o3l_v = vec_set1_t(n5o3l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            t1 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            t0 = vec_mul_t(vec_sub_t(v_1, t0), vec_exp_t(t0));
+            t1 = vec_mul_t(vec_sub_t(v_1, t1), vec_exp_t(t1));
+            r20 = vec_mul_t(vec_mul_t(n5o3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n5o3l_v, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE r2 = dx * dx + dy * dy;
+                DTYPE lk = nsqrt5_l * sqrt(r2);
+                mat_irow[j] = n5o3l * r2 * (1.0 - lk) * exp(lk);
+            }
+        }
+    }
+}
+
+static void Matern52_dl_2D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_2D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const DTYPE n5o3l = -5.0 * _1o3 * param_[0];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t n5o3l_v = vec_set1_t(n5o3l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            t1 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            t0 = vec_mul_t(vec_sub_t(v_1, t0), vec_exp_t(t0));
+            t1 = vec_mul_t(vec_sub_t(v_1, t1), vec_exp_t(t1));
+            r20 = vec_mul_t(vec_mul_t(n5o3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n5o3l_v, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
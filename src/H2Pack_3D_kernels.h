@@ -47,44 +47,70 @@ extern "C" {
 // ====================   Coulomb Kernel   ==================== //
 // ============================================================ //
 
-const  int  Coulomb_3D_krnl_bimv_flop = 14;
+#define Coulomb_3D_krnl_bimv_flop 14
 
 static void Coulomb_3D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
     EXTRACT_3D_COORD();
     const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
     const vec_t frsqrt_pf = vec_frsqrt_pf_t();
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
+            vec_t d0, d1, jv, r20, r21;
             
-            vec_t r2 = vec_mul_t(dx, dx);
-            r2 = vec_fmadd_t(dy, dy, r2);
-            r2 = vec_fmadd_t(dz, dz, r2);
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_mul_t(frsqrt_pf, vec_frsqrt_t(r20));
+            r21 = vec_mul_t(frsqrt_pf, vec_frsqrt_t(r21));
             
-            vec_t rinv = vec_mul_t(frsqrt_pf, vec_frsqrt_t(r2));
-            vec_storeu_t(mat_irow + j, rinv);
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx = x0_i - x1[j];
-            DTYPE dy = y0_i - y1[j];
-            DTYPE dz = z0_i - z1[j];
-            DTYPE r2 = dx * dx + dy * dy + dz * dz;
-            mat_irow[j] = (r2 == 0.0) ? 0.0 : (1.0 / DSQRT(r2));
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                mat_irow[j] = (r2 == 0.0) ? 0.0 : (1.0 / DSQRT(r2));
+            }
         }
     }
 }
@@ -149,7 +175,7 @@ static void Coulomb_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ====================   Gaussian Kernel   =================== //
 // ============================================================ //
 
-const  int  Gaussian_3D_krnl_bimv_flop = 14;
+#define Gaussian_3D_krnl_bimv_flop 14
 
 static void Gaussian_3D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -158,38 +184,63 @@ static void Gaussian_3D_eval_intrin_t(KRNL_EVAL_PARAM)
     const DTYPE *param_ = (DTYPE*) param;
     const DTYPE neg_l = -param_[0];
     const vec_t neg_l_v = vec_set1_t(neg_l);
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
+            vec_t d0, d1, jv, r20, r21;
             
-            vec_t r2 = vec_mul_t(dx, dx);
-            r2 = vec_fmadd_t(dy, dy, r2);
-            r2 = vec_fmadd_t(dz, dz, r2);
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
             
-            r2 = vec_exp_t(vec_mul_t(neg_l_v, r2));
+            r20 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            r21 = vec_exp_t(vec_mul_t(neg_l_v, r21));
             
-            vec_storeu_t(mat_irow + j, r2);
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx = x0_i - x1[j];
-            DTYPE dy = y0_i - y1[j];
-            DTYPE dz = z0_i - z1[j];
-            DTYPE r2 = dx * dx + dy * dy + dz * dz;
-            mat_irow[j] = exp(neg_l * r2);
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                mat_irow[j] = exp(neg_l * r2);
+            }
         }
     }
 }
@@ -256,7 +307,7 @@ static void Gaussian_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ==================   Exponential Kernel   ================== //
 // ============================================================ //
 
-const  int  Expon_3D_krnl_bimv_flop = 15;
+#define Expon_3D_krnl_bimv_flop 15
 
 static void Expon_3D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -265,39 +316,65 @@ static void Expon_3D_eval_intrin_t(KRNL_EVAL_PARAM)
     const DTYPE *param_ = (DTYPE*) param;
     const DTYPE neg_l = -param_[0];
     const vec_t neg_l_v = vec_set1_t(neg_l);
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
+            vec_t d0, d1, jv, r20, r21;
             
-            vec_t r2 = vec_mul_t(dx, dx);
-            r2 = vec_fmadd_t(dy, dy, r2);
-            r2 = vec_fmadd_t(dz, dz, r2);
-
-            r2 = vec_mul_t(neg_l_v, vec_sqrt_t(r2));
-            r2 = vec_exp_t(r2);
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_mul_t(neg_l_v, vec_sqrt_t(r20));
+            r21 = vec_mul_t(neg_l_v, vec_sqrt_t(r21));
+            r20 = vec_exp_t(r20);
+            r21 = vec_exp_t(r21);
             
-            vec_storeu_t(mat_irow + j, r2);
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx = x0_i - x1[j];
-            DTYPE dy = y0_i - y1[j];
-            DTYPE dz = z0_i - z1[j];
-            DTYPE r2 = dx * dx + dy * dy + dz * dz;
-            mat_irow[j] = exp(neg_l * sqrt(r2));
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                mat_irow[j] = exp(neg_l * sqrt(r2));
+            }
         }
     }
 }
@@ -366,7 +443,7 @@ static void Expon_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Matern 3/2 Kernel   ================== //
 // ============================================================ //
 
-const  int  Matern32_3D_krnl_bimv_flop = 17;
+#define Matern32_3D_krnl_bimv_flop 17
 
 #define NSQRT3 -1.7320508075688772
 
@@ -378,41 +455,67 @@ static void Matern32_3D_eval_intrin_t(KRNL_EVAL_PARAM)
     const DTYPE nsqrt3_l = NSQRT3 * param_[0];
     const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
     const vec_t v_1 = vec_set1_t(1.0);
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
-            
-            vec_t r = vec_mul_t(dx, dx);
-            r = vec_fmadd_t(dy, dy, r);
-            r = vec_fmadd_t(dz, dz, r);
-            r = vec_sqrt_t(r);
-            r = vec_mul_t(r, nsqrt3_l_v);
-            r = vec_mul_t(vec_sub_t(v_1, r), vec_exp_t(r));
-            
-            vec_storeu_t(mat_irow + j, r);
+            vec_t d0, d1, jv, r20, r21;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_mul_t(vec_sqrt_t(r20), nsqrt3_l_v);
+            r21 = vec_mul_t(vec_sqrt_t(r21), nsqrt3_l_v);
+            r20 = vec_mul_t(vec_sub_t(v_1, r20), vec_exp_t(r20));
+            r21 = vec_mul_t(vec_sub_t(v_1, r21), vec_exp_t(r21));
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx = x0_i - x1[j];
-            DTYPE dy = y0_i - y1[j];
-            DTYPE dz = z0_i - z1[j];
-            DTYPE r  = sqrt(dx * dx + dy * dy + dz * dz);
-            r = r * nsqrt3_l;
-            r = (1.0 - r) * exp(r);
-            mat_irow[j] = r;
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r  = sqrt(dx * dx + dy * dy + dz * dz);
+                r = r * nsqrt3_l;
+                r = (1.0 - r) * exp(r);
+                mat_irow[j] = r;
+            }
         }
     }
 }
@@ -485,7 +588,7 @@ static void Matern32_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Matern 5/2 Kernel   ================== //
 // ============================================================ //
 
-const  int  Matern52_3D_krnl_bimv_flop = 20;
+#define Matern52_3D_krnl_bimv_flop 20
 
 #define NSQRT5 -2.2360679774997896
 #define _1o3    0.3333333333333333
@@ -499,45 +602,67 @@ static void Matern52_3D_eval_intrin_t(KRNL_EVAL_PARAM)
     const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
     const vec_t v_1   = vec_set1_t(1.0);
     const vec_t v_1o3 = vec_set1_t(_1o3);
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
-            
-            vec_t r = vec_mul_t(dx, dx);
-            r = vec_fmadd_t(dy, dy, r);
-            r = vec_fmadd_t(dz, dz, r);
-            r = vec_sqrt_t(r);
-
-            vec_t lk  = vec_mul_t(nsqrt5_l_v, r);
-            vec_t val = vec_sub_t(v_1, lk);
-            vec_t lk2 = vec_mul_t(lk, lk);
-            val = vec_fmadd_t(v_1o3, lk2, val);
-            val = vec_mul_t(val, vec_exp_t(lk));
-            
-            vec_storeu_t(mat_irow + j, val);
+            vec_t d0, d1, jv, r20, r21;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            r21 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            r20 = vec_mul_t(vec_fmadd_t(v_1o3, vec_mul_t(r20, r20), vec_sub_t(v_1, r20)), vec_exp_t(r20));
+            r21 = vec_mul_t(vec_fmadd_t(v_1o3, vec_mul_t(r21, r21), vec_sub_t(v_1, r21)), vec_exp_t(r21));
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx  = x0_i - x1[j];
-            DTYPE dy  = y0_i - y1[j];
-            DTYPE dz  = z0_i - z1[j];
-            DTYPE r   = sqrt(dx * dx + dy * dy + dz * dz);
-            DTYPE lk  = nsqrt5_l * r;
-            DTYPE val = (1.0 - lk + _1o3 * lk * lk) * exp(lk);
-            mat_irow[j] = val;
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx  = x0_i - x1[j];
+                DTYPE dy  = y0_i - y1[j];
+                DTYPE dz  = z0_i - z1[j];
+                DTYPE r   = sqrt(dx * dx + dy * dy + dz * dz);
+                DTYPE lk  = nsqrt5_l * r;
+                DTYPE val = (1.0 - lk + _1o3 * lk * lk) * exp(lk);
+                mat_irow[j] = val;
+            }
         }
     }
 }
@@ -618,7 +743,7 @@ static void Matern52_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ===================   Quadratic Kernel   =================== //
 // ============================================================ //
 
-const  int  Quadratic_3D_krnl_bimv_flop = 15;
+#define Quadratic_3D_krnl_bimv_flop 15
 
 static void Quadratic_3D_eval_intrin_t(KRNL_EVAL_PARAM)
 {
@@ -630,42 +755,68 @@ static void Quadratic_3D_eval_intrin_t(KRNL_EVAL_PARAM)
     const vec_t vec_c = vec_set1_t(c);
     const vec_t vec_a = vec_set1_t(a);
     const vec_t vec_1 = vec_set1_t(1.0);
-    for (int i = 0; i < n0; i++)
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
     {
-        DTYPE *mat_irow = mat + i * ldm;
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
         
-        vec_t x0_iv = vec_bcast_t(x0 + i);
-        vec_t y0_iv = vec_bcast_t(y0 + i);
-        vec_t z0_iv = vec_bcast_t(z0 + i);
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
         for (int j = 0; j < n1_vec; j += SIMD_LEN)
         {
-            vec_t dx = vec_sub_t(x0_iv, vec_loadu_t(x1 + j));
-            vec_t dy = vec_sub_t(y0_iv, vec_loadu_t(y1 + j));
-            vec_t dz = vec_sub_t(z0_iv, vec_loadu_t(z1 + j));
+            vec_t d0, d1, jv, r20, r21;
             
-            vec_t r2 = vec_mul_t(dx, dx);
-            r2 = vec_fmadd_t(dy, dy, r2);
-            r2 = vec_fmadd_t(dz, dz, r2);
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
             
-            r2 = vec_fmadd_t(r2, vec_c, vec_1);
-            r2 = vec_pow_t(r2, vec_a);
+            r20 = vec_fmadd_t(r20, vec_c, vec_1);
+            r21 = vec_fmadd_t(r21, vec_c, vec_1);
+            r20 = vec_pow_t(r20, vec_a);
+            r21 = vec_pow_t(r21, vec_a);
             
-            vec_storeu_t(mat_irow + j, r2);
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
         }
         
-        const DTYPE x0_i = x0[i];
-        const DTYPE y0_i = y0[i];
-        const DTYPE z0_i = z0[i];
-        for (int j = n1_vec; j < n1; j++)
+        for (int ii = i; ii <= i1; ii++)
         {
-            DTYPE dx = x0_i - x1[j];
-            DTYPE dy = y0_i - y1[j];
-            DTYPE dz = z0_i - z1[j];
-            DTYPE r2 = dx * dx + dy * dy + dz * dz;
-
-            r2 = 1.0 + c * r2;
-            r2 = DPOW(r2, a);
-            mat_irow[j] = r2;
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+
+                r2 = 1.0 + c * r2;
+                r2 = DPOW(r2, a);
+                mat_irow[j] = r2;
+            }
         }
     }
 }
@@ -732,6 +883,576 @@ static void Quadratic_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
     }
 }
 
+// ============================================================ //
+// =================   Gaussian Kernel d/dl   ================= //
+// ============================================================ //
+
+// k(x, y) = exp(-l * |x-y|^2), dk/dl = -|x-y|^2 * exp(-l * |x-y|^2)
+
+#define Gaussian_dl_3D_krnl_bimv_flop 16
+
+static void Gaussian_dl_3D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                mat_irow[j] = -r2 * exp(neg_l * r2);
+            }
+        }
+    }
+}
+
+static void Gaussian_dl_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_load_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ===============   Exponential Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = exp(-l * |x-y|), dk/dl = -|x-y| * exp(-l * |x-y|)
+
+#define Expon_dl_3D_krnl_bimv_flop 17
+
+static void Expon_dl_3D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            r20 = vec_sqrt_t(r20);
+            r21 = vec_sqrt_t(r21);
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                DTYPE r = sqrt(r2);
+                mat_irow[j] = -r * exp(neg_l * r);
+            }
+        }
+    }
+}
+
+static void Expon_dl_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l = -param_[0];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    const vec_t v_n1 = vec_set1_t(-1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_load_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            r20 = vec_sqrt_t(r20);
+            r21 = vec_sqrt_t(r21);
+            t0 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            t1 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            r20 = vec_mul_t(vec_mul_t(v_n1, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(v_n1, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ================   Matern 3/2 Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = (1 + l*k) * exp(-l*k), k = sqrt(3) * |x-y|,
+// dk/dl = -3 * l * |x-y|^2 * exp(-l*k)
+
+#define Matern32_dl_3D_krnl_bimv_flop 18
+
+static void Matern32_dl_3D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const DTYPE n3l = -3.0 * param_[0];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t n3l_v = vec_set1_t(n3l);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r20)));
+            t1 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r21)));
+            r20 = vec_mul_t(vec_mul_t(n3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n3l_v, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                mat_irow[j] = n3l * r2 * exp(nsqrt3_l * sqrt(r2));
+            }
+        }
+    }
+}
+
+static void Matern32_dl_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const DTYPE n3l = -3.0 * param_[0];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t n3l_v = vec_set1_t(n3l);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_load_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r20)));
+            t1 = vec_exp_t(vec_mul_t(nsqrt3_l_v, vec_sqrt_t(r21)));
+            r20 = vec_mul_t(vec_mul_t(n3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n3l_v, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ================   Matern 5/2 Kernel d/dl   ================ //
+// ============================================================ //
+
+// k(x, y) = (1 + l*k + l^2*k^2/3) * exp(-l*k), k = sqrt(5) * |x-y|,
+// dk/dl = -5/3 * l * |x-y|^2 * (1 + l*k) * exp(-l*k)
+
+#define Matern52_dl_3D_krnl_bimv_flop 21
+
+static void Matern52_dl_3D_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const DTYPE n5o3l = -5.0 * _1o3 * param_[0];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t n5o3l_v = vec_set1_t(n5o3l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i1);
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_loadu_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_loadu_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_loadu_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            t0 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            t1 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            t0 = vec_mul_t(vec_sub_t(v_1, t0), vec_exp_t(t0));
+            t1 = vec_mul_t(vec_sub_t(v_1, t1), vec_exp_t(t1));
+            r20 = vec_mul_t(vec_mul_t(n5o3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n5o3l_v, r21), t1);
+            
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+        
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            const DTYPE x0_i = x0[ii];
+            const DTYPE y0_i = y0[ii];
+            const DTYPE z0_i = z0[ii];
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE dx = x0_i - x1[j];
+                DTYPE dy = y0_i - y1[j];
+                DTYPE dz = z0_i - z1[j];
+                DTYPE r2 = dx * dx + dy * dy + dz * dz;
+                DTYPE lk = nsqrt5_l * sqrt(r2);
+                mat_irow[j] = n5o3l * r2 * (1.0 - lk) * exp(lk);
+            }
+        }
+    }
+}
+
+static void Matern52_dl_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    EXTRACT_3D_COORD();
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const DTYPE n5o3l = -5.0 * _1o3 * param_[0];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t n5o3l_v = vec_set1_t(n5o3l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x0_i0v = vec_bcast_t(x0 + i);
+        const vec_t y0_i0v = vec_bcast_t(y0 + i);
+        const vec_t z0_i0v = vec_bcast_t(z0 + i);
+        const vec_t x0_i1v = vec_bcast_t(x0 + i + 1);
+        const vec_t y0_i1v = vec_bcast_t(y0 + i + 1);
+        const vec_t z0_i1v = vec_bcast_t(z0 + i + 1);
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, jv, r20, r21, t0, t1;
+            
+            jv  = vec_load_t(x1 + j);
+            d0  = vec_sub_t(x0_i0v, jv);
+            d1  = vec_sub_t(x0_i1v, jv);
+            r20 = vec_mul_t(d0, d0);
+            r21 = vec_mul_t(d1, d1);
+            
+            jv  = vec_load_t(y1 + j);
+            d0  = vec_sub_t(y0_i0v, jv);
+            d1  = vec_sub_t(y0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            jv  = vec_load_t(z1 + j);
+            d0  = vec_sub_t(z0_i0v, jv);
+            d1  = vec_sub_t(z0_i1v, jv);
+            r20 = vec_fmadd_t(d0, d0, r20);
+            r21 = vec_fmadd_t(d1, d1, r21);
+            
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+            
+            t0 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            t1 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            t0 = vec_mul_t(vec_sub_t(v_1, t0), vec_exp_t(t0));
+            t1 = vec_mul_t(vec_sub_t(v_1, t1), vec_exp_t(t1));
+            r20 = vec_mul_t(vec_mul_t(n5o3l_v, r20), t0);
+            r21 = vec_mul_t(vec_mul_t(n5o3l_v, r21), t1);
+            
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+            
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
 // ============================================================ //
 // =====================   Stokes Kernel   ==================== //
 // ============================================================ //
@@ -743,7 +1464,7 @@ static void Quadratic_3D_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
     const DTYPE C   = 1.0 / (6.0 * M_PI * a * eta); \
     const DTYPE Ca3o4 = C * a * 0.75;               
 
-const  int  Stokes_krnl_bimv_flop = 48;
+#define Stokes_krnl_bimv_flop 48
 
 static void Stokes_eval_std(KRNL_EVAL_PARAM)
 {
@@ -872,8 +1593,8 @@ static void Stokes_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
 // ======================   RPY Kernel   ====================== //
 // ============================================================ //
 
-const  int  RPY_krnl_bimv_flop = 82;
-const  int  RPY_krnl_mv_flop   = 70;
+#define RPY_krnl_bimv_flop 82
+#define RPY_krnl_mv_flop   70
 
 static void RPY_eval_std(KRNL_EVAL_PARAM)
 {
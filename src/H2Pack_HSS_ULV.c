@@ -11,6 +11,546 @@
 #include "H2Pack_aux_structs.h"
 #include "H2Pack_utils.h"
 #include "H2Pack_matvec.h"
+#include "H2Pack_matmul.h"
+#include "DAG_task_queue.h"
+
+// Float build of the ULV node solve functions below, used to apply the ULV
+// factors stored in float after H2P_HSS_ULV_to_float()
+void H2P_s_HSS_ULV_LU_fwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const float *Q, const float *L, const int *p, float *b0
+);
+void H2P_s_HSS_ULV_LU_bwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const float *Q, const float *L, float *b0
+);
+void H2P_s_HSS_ULV_Cholesky_fwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const float *Q, const float *L, float *b0
+);
+void H2P_s_HSS_ULV_Cholesky_bwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const float *Q, const float *L, float *b0
+);
+
+// Gather rows of a row-major right-hand side matrix to a node's work buffer
+// Input parameters:
+//   n_vec : Number of right-hand side vectors
+//   idx   : Indices of the rows to gather
+//   pmt_x : Row-major matrix, leading dimension n_vec
+//   fp32  : If the work buffer should be stored in float
+// Output parameter:
+//   b0 : Size idx->length * n_vec, row-major, gathered rows
+static void H2P_HSS_ULV_gather_rows(
+    const int n_vec, H2P_int_vec_p idx, const DTYPE *pmt_x, const int fp32, void *b0
+)
+{
+    if (fp32)
+    {
+        float *b0_f = (float*) b0;
+        for (int k = 0; k < idx->length; k++)
+        {
+            const DTYPE *x_k = pmt_x + idx->data[k] * n_vec;
+            float *b0_k = b0_f + k * n_vec;
+            for (int l = 0; l < n_vec; l++) b0_k[l] = (float) x_k[l];
+        }
+    } else {
+        size_t row_msize = sizeof(DTYPE) * n_vec;
+        DTYPE *b0_d = (DTYPE*) b0;
+        for (int k = 0; k < idx->length; k++)
+            memcpy(b0_d + k * n_vec, pmt_x + idx->data[k] * n_vec, row_msize);
+    }
+}
+
+// Scatter a node's work buffer to rows of a row-major solution matrix
+// Input parameters:
+//   n_vec : Number of right-hand side vectors
+//   idx   : Indices of the rows to scatter to
+//   b0    : Size idx->length * n_vec, row-major, rows to scatter
+//   fp32  : If the work buffer is stored in float
+// Output parameter:
+//   pmt_x : Row-major matrix, leading dimension n_vec
+static void H2P_HSS_ULV_scatter_rows(
+    const int n_vec, H2P_int_vec_p idx, const void *b0, const int fp32, DTYPE *pmt_x
+)
+{
+    if (fp32)
+    {
+        const float *b0_f = (const float*) b0;
+        for (int k = 0; k < idx->length; k++)
+        {
+            DTYPE *x_k = pmt_x + idx->data[k] * n_vec;
+            const float *b0_k = b0_f + k * n_vec;
+            for (int l = 0; l < n_vec; l++) x_k[l] = (DTYPE) b0_k[l];
+        }
+    } else {
+        size_t row_msize = sizeof(DTYPE) * n_vec;
+        const DTYPE *b0_d = (const DTYPE*) b0;
+        for (int k = 0; k < idx->length; k++)
+            memcpy(pmt_x + idx->data[k] * n_vec, b0_d + k * n_vec, row_msize);
+    }
+}
+
+// Atomically read the nonsingular / is_SPD flag, which DAG tasks running on 
+// other threads may set to 0 at the same time
+static inline int H2P_HSS_ULV_flag_read(int *flag)
+{
+    int val;
+    #pragma omp atomic read
+    val = *flag;
+    return val;
+}
+
+// Nodes whose diagonal block in the ULV factorization is at most this size are 
+// factorized as single-thread DAG tasks even if their level has fewer than 
+// n_thread nodes. Multithreaded BLAS & LAPACK give little speedup on such small 
+// blocks, while running them one by one serializes the whole level.
+#define HSS_ULV_DAG_MAX_BLK_SIZE 512
+
+// Construct the DAG_task_queue for HSS ULV factorization. Each node depends
+// on its children. Nodes on levels above the first level that has at least 
+// n_thread nodes or only has diagonal blocks of size <= HSS_ULV_DAG_MAX_BLK_SIZE 
+// are not in the DAG, they are factorized after all DAG tasks.
+// Input parameter:
+//   h2pack : H2Pack structure with constructed HSS representation
+// Output parameters:
+//   *dag_min_level_ : Minimum level of nodes in the DAG
+//   *tq_            : DAG_task_queue of nodes on levels >= *dag_min_level_
+static void H2P_HSS_ULV_build_task_queue(H2Pack_p h2pack, int *dag_min_level_, DAG_task_queue_p *tq_)
+{
+    int n_node        = h2pack->n_node;
+    int n_thread      = h2pack->n_thread;
+    int max_level     = h2pack->max_level;
+    int *parent       = h2pack->parent;
+    int *node_level   = h2pack->node_level;
+    int *level_n_node = h2pack->level_n_node;
+    int *n_child      = h2pack->n_child;
+    int *children     = h2pack->children;
+    int *mat_cluster  = h2pack->mat_cluster;
+    H2P_dense_mat_p *U = h2pack->U;
+
+    // Size of the largest diagonal block factorized on each level: a leaf node 
+    // factorizes its D block, a non-leaf node factorizes a block whose size is 
+    // the sum of the ranks of its children
+    int *level_blk_size = (int*) malloc(sizeof(int) * (max_level + 1));
+    ASSERT_PRINTF(level_blk_size != NULL, "Failed to allocate working buffer for DAG task queue construction\n");
+    memset(level_blk_size, 0, sizeof(int) * (max_level + 1));
+    for (int node = 0; node < n_node; node++)
+    {
+        int blk_size = 0;
+        if (n_child[node] == 0) blk_size = mat_cluster[2 * node + 1] - mat_cluster[2 * node] + 1;
+        for (int k = 0; k < n_child[node]; k++)
+            blk_size += U[children[node * h2pack->max_child + k]]->ncol;
+        int level = node_level[node];
+        if (blk_size > level_blk_size[level]) level_blk_size[level] = blk_size;
+    }
+    int dag_min_level = 0;
+    while (dag_min_level <= max_level && level_n_node[dag_min_level] < n_thread && 
+           level_blk_size[dag_min_level] > HSS_ULV_DAG_MAX_BLK_SIZE) dag_min_level++;
+    free(level_blk_size);
+
+    int *DAG_src_ptr = (int*) malloc(sizeof(int) * (n_node + 1));
+    int *DAG_dst_idx = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(
+        DAG_src_ptr != NULL && DAG_dst_idx != NULL, 
+        "Failed to allocate working buffer for DAG task queue construction\n"
+    );
+    int num_dep = 0;
+    for (int node = 0; node < n_node; node++)
+    {
+        DAG_src_ptr[node] = num_dep;
+        int level = node_level[node];
+        // Nodes above dag_min_level are not DAG tasks, mark them as skipped
+        if (level < dag_min_level) DAG_dst_idx[num_dep++] = node;
+        if (level > dag_min_level) DAG_dst_idx[num_dep++] = parent[node];
+    }
+    DAG_src_ptr[n_node] = num_dep;
+    DAG_task_queue_init(n_node, num_dep, DAG_src_ptr, DAG_dst_idx, tq_);
+    free(DAG_src_ptr);
+    free(DAG_dst_idx);
+    *dag_min_level_ = dag_min_level;
+}
+
+// Factorize a node in the HSS ULV LU factorization, all its children should
+// have been factorized
+// Input parameters:
+//   h2pack      : H2Pack structure with constructed HSS representation
+//   node        : Target node
+//   shift       : Shift coefficient k to make (A + k * I) non-singular
+//   tb          : Thread buffer of the calling thread
+//   U_mid       : Size n_node, compressed projection matrices of factorized nodes
+//   D_mid       : Size n_node, compressed diagonal blocks of factorized nodes
+// Output parameters:
+//   U_mid, D_mid : U_mid[node] and D_mid[node] are computed, those of node's children are freed
+//   ULV_*        : ULV_Ls[node], ULV_idx[node], ULV_p[node], ULV_Q[node], and ULV_L[node] are computed
+//   HSS_logdet   : log(abs(det(diagonal block of node))) is accumulated
+//   nonsingular  : Set to 0 if the node's diagonal block is singular, the node is skipped if it is 0
+static void H2P_HSS_ULV_LU_factorize_node(
+    H2Pack_p h2pack, const int node, const DTYPE shift, H2P_thread_buf_p tb,
+    H2P_dense_mat_p *U_mid, H2P_dense_mat_p *D_mid, int *ULV_Ls, H2P_int_vec_p *ULV_idx,
+    H2P_int_vec_p *ULV_p, H2P_dense_mat_p *ULV_Q, H2P_dense_mat_p *ULV_L, 
+    DTYPE *HSS_logdet, int *nonsingular
+)
+{
+    if (!H2P_HSS_ULV_flag_read(nonsingular)) return;
+
+    int max_child       = h2pack->max_child;
+    int level           = h2pack->node_level[node];
+    int *children       = h2pack->children;
+    int *n_child        = h2pack->n_child;
+    int *mat_cluster    = h2pack->mat_cluster;
+    H2P_dense_mat_p *U  = h2pack->U;
+    H2P_int_vec_p   tmpidx = tb->idx0;
+    H2P_dense_mat_p tmpU   = tb->mat0;
+    H2P_dense_mat_p tmpD   = tb->mat1;
+    H2P_dense_mat_p tmpB   = tb->mat2;
+    H2P_dense_mat_p tmpM   = tb->mat0;
+
+    int node_n_child = n_child[node];
+    int *node_children = children + node * max_child;
+    // 1. Construct tmpU and tmpD for factorization
+    int U_nrow, U_ncol, U_diff;
+    if (node_n_child == 0)
+    {
+        // Leaf node, use the original U and D
+        H2P_dense_mat_resize(tmpU, U[node]->nrow, U[node]->ncol);
+        copy_matrix_block(sizeof(DTYPE), U[node]->nrow, U[node]->ncol, U[node]->data, U[node]->ld, tmpU->data, tmpU->ld);
+        H2P_get_Dij_block(h2pack, node, node, tmpD);
+        for (int k = 0; k < tmpD->nrow; k++)
+            tmpD->data[k * tmpD->ld + k] += shift;
+    } else {
+        // Non-leaf node, assemble tmpU and tmpD from mid_U and mid_D
+        // (1) Accumulate the dimension of each compressed child's diagonal block
+        H2P_int_vec_set_capacity(tmpidx, node_n_child + 1);
+        int *offset = tmpidx->data;
+        offset[0] = 0;
+        U_nrow = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            offset[k + 1] = offset[k] + D_mid[child_k]->nrow;
+            U_nrow += D_mid[child_k]->nrow;
+        }
+        // (2) Build the compressed diagonal block
+        // Build tmpD, we need tmpB and tmpM (same buffer as tmpU, so we build tmpU later)
+        H2P_dense_mat_resize(tmpD, U_nrow, U_nrow);
+        memset(tmpD->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            // idx_k = offset(k) : offset(k+1)-1;
+            int idx_k_s = offset[k];
+            int idx_k_len = offset[k + 1] - idx_k_s;
+            // Diagonal blocks
+            // tmpD(idx_k, idx_k) = D_mid{child_k};
+            copy_matrix_block(
+                sizeof(DTYPE), D_mid[child_k]->nrow, D_mid[child_k]->ncol, D_mid[child_k]->data, 
+                D_mid[child_k]->ld, tmpD->data + idx_k_s * (tmpD->ld + 1), tmpD->ld
+            );
+            // Off-diagonal blocks
+            for (int l = k + 1; l < node_n_child; l++)
+            {
+                int child_l = node_children[l];
+                // idx_l = offset(l) : offset(l+1)-1;
+                int idx_l_s = offset[l];
+                int idx_l_len = offset[l + 1] - idx_l_s;
+                // B_idx = B_pair2idx(child_k, child_l);
+                H2P_get_Bij_block(h2pack, child_k, child_l, tmpB);
+                // tmpD(idx_k, idx_l) = U_mid{child_k} * B{B_idx} * U_mid{child_l}';
+                H2P_dense_mat_resize(tmpM, tmpB->nrow, U_mid[child_l]->nrow);
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasTrans, tmpM->nrow, tmpM->ncol, tmpB->ncol,
+                    1.0, tmpB->data, tmpB->ld, U_mid[child_l]->data, U_mid[child_l]->ld, 
+                    0.0, tmpM->data, tmpM->ld
+                );
+                DTYPE *tmpD_kl = tmpD->data + idx_k_s * tmpD->ld + idx_l_s;
+                DTYPE *tmpD_lk = tmpD->data + idx_l_s * tmpD->ld + idx_k_s;
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasNoTrans, U_mid[child_k]->nrow, tmpM->ncol, tmpM->nrow,
+                    1.0, U_mid[child_k]->data, U_mid[child_k]->ld, tmpM->data, tmpM->ld, 
+                    0.0, tmpD_kl, tmpD->ld
+                );
+                // tmpD(idx_l, idx_k) = tmpD(idx_k, idx_l)';
+                H2P_transpose_dmat(1, idx_k_len, idx_l_len, tmpD_kl, tmpD->ld, tmpD_lk, tmpD->ld);
+            }
+        }  // End of k loop
+        // Build tmpU, now tmpM is no long used
+        H2P_dense_mat_resize(tmpU, U_nrow, U_nrow);
+        memset(tmpU->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            // idx_k = offset(k) : offset(k+1)-1;
+            int idx_k_s = offset[k];
+            // Diagonal blocks
+            // tmpU(idx_k, idx_k) = U_mid{child_k};
+            copy_matrix_block(
+                sizeof(DTYPE), U_mid[child_k]->nrow, U_mid[child_k]->ncol, U_mid[child_k]->data, 
+                U_mid[child_k]->ld, tmpU->data + idx_k_s * (tmpU->ld + 1), tmpU->ld
+            );
+        }  // End of k loop
+        // if (level > 1), tmpU = tmpU * U{node}; end
+        // tmpU (tmpM, mat0) and tmpD (mat1) are used, use tmpB (mat2) as buffer
+        if (level > 0)
+        {
+            H2P_dense_mat_resize(tmpB, tmpU->nrow, U[node]->ncol);
+            CBLAS_GEMM(
+                CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpB->nrow, tmpB->ncol, tmpU->ncol,
+                1.0, tmpU->data, tmpU->ld, U[node]->data, U[node]->ld, 0.0, tmpB->data, tmpB->ld
+            );
+            H2P_dense_mat_resize(tmpU, tmpB->nrow, tmpB->ncol);
+            copy_matrix_block(sizeof(DTYPE), tmpB->nrow, tmpB->ncol, tmpB->data, tmpB->ld, tmpU->data, tmpU->ld);
+        }
+    }  // End of "if (node_n_child == 0)"
+    U_nrow = tmpU->nrow;
+    U_ncol = tmpU->ncol;
+    U_diff = U_nrow - U_ncol;
+    ASSERT_PRINTF(U_nrow >= U_ncol, "tmpU has more columns (%d) than rows (%d)!\n", U_ncol, U_nrow);
+
+    // 2. LU factorization
+    // size(tmpU) = [U_nrow, U_ncol]
+    // size(tmpD) = [U_nrow, U_nrow]
+    // U_nrow >= U_ncol always holds
+    int info;
+    if (level > 0)
+    {
+        H2P_dense_mat_init(&ULV_Q[node], U_nrow + 1, U_ncol);
+        H2P_dense_mat_init(&U_mid[node], U_ncol, U_ncol);
+        // [Q{node}, R] = qr(tmpU);
+        copy_matrix_block(sizeof(DTYPE), U_nrow, U_ncol, tmpU->data, tmpU->ld, ULV_Q[node]->data, ULV_Q[node]->ld);
+        DTYPE *A   = ULV_Q[node]->data;
+        DTYPE *tau = ULV_Q[node]->data + U_nrow * U_ncol;
+        info = LAPACK_GEQRF(LAPACK_ROW_MAJOR, U_nrow, U_ncol, A, U_ncol, tau);
+        // U_mid{node} = R(1 : U_ncol, :);
+        for (int k = 0; k < U_ncol; k++)
+        {
+            DTYPE *A_k = A + k * U_ncol;
+            DTYPE *R_k = U_mid[node]->data + k * U_ncol;
+            if (k > 0) memset(R_k, 0, sizeof(DTYPE) * k);
+            memcpy(R_k + k, A_k + k, sizeof(DTYPE) * (U_ncol - k));
+        }
+        ULV_Ls[node] = U_ncol;
+        // tmpD = Q{node}' * tmpD * Q{node};
+        info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
+        info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'R', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
+        // tmpD11 = tmpD(1 : U_ncol, 1 : U_ncol);
+        // tmpD12 = tmpD(1 : U_ncol, (U_ncol+1) : end);
+        // tmpD21 = tmpD((U_ncol+1) : end, 1 : U_ncol);
+        // tmpD22 = tmpD((U_ncol+1) : end, (U_ncol+1) : end);
+        DTYPE *tmpD11 = tmpD->data;
+        DTYPE *tmpD12 = tmpD->data + U_ncol;
+        DTYPE *tmpD21 = tmpD->data + U_ncol * U_nrow;
+        DTYPE *tmpD22 = tmpD->data + U_ncol * (U_nrow + 1);
+        H2P_int_vec_init(&ULV_p[node], U_diff * 2);
+        ULV_p[node]->length = U_diff;
+        if (U_diff > 0)
+        {
+            // [tmpLL, tmpLU, Lp{node}] = lu(tmpD22, 'vector');
+            // tmpL = tmpLL + tmpLU - eye(U_diff);
+            // Here tmpL is stored in tmpD22
+            int *perm = ULV_p[node]->data;
+            int *ipiv = ULV_p[node]->data + U_diff;
+            info = LAPACK_GETRF(LAPACK_ROW_MAJOR, U_diff, U_diff, tmpD22, U_nrow, ipiv);
+            // logdet = logdet + sum(log(abs(diag(tmpLU)))), the product of the 
+            // diagonal entries may overflow or underflow
+            DTYPE node_logdet = 0.0;
+            for (int k = 0; k < U_diff; k++) node_logdet += DLOG(DABS(tmpD22[k * U_nrow + k]));
+            #pragma omp atomic update
+            *HSS_logdet += node_logdet;
+            // Convert ipiv to real permutation vector
+            for (int k = 0; k < U_diff; k++) perm[k] = k;
+            for (int k = 0; k < U_diff; k++)
+            {
+                int piv = ipiv[k] - 1;
+                int p0  = perm[k];
+                int p1  = perm[piv];
+                perm[piv] = p0;
+                perm[k]   = p1;
+            }
+            if (info != 0)
+            {
+                #pragma omp atomic write
+                *nonsingular = 0;
+                ERROR_PRINTF("Node %d getrf() returned %d, target matrix with shifting %.2lf is singular\n", node, info, shift);
+            }
+            // LD21 = tmpLL \ tmpD21(Lp{node}, :);
+            // Here tmpD21(Lp{node}, :) and LD21 is stored in tmpD21
+            H2P_dense_mat_resize(tmpM, U_diff, U_ncol);
+            copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpD21, U_nrow, tmpM->data, tmpM->ld);
+            H2P_dense_mat_permute_rows(tmpM, ULV_p[node]->data);
+            copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpM->data, tmpM->ld, tmpD21, U_nrow);
+            CBLAS_TRSM(
+                CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+                U_diff, U_ncol, 1.0, tmpD22, U_nrow, tmpD21, U_nrow
+            );
+            // DU12 = tmpD12 / tmpLU;  % == tmpD12 * inv(tmpLU)
+            // Here DU12 is stored in tmpD12
+            CBLAS_TRSM(
+                CblasRowMajor, CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit, 
+                U_ncol, U_diff, 1.0, tmpD22, U_nrow, tmpD12, U_nrow
+            );
+        }  // End of "if (U_diff > 0)"
+        // L{node} = [eye(U_ncol), DU12; LD21, tmpL];
+        H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
+        for (int k = 0; k < U_ncol; k++)
+        {
+            DTYPE *L_k = ULV_L[node]->data + k * U_nrow;
+            memset(L_k, 0, sizeof(DTYPE) * U_nrow);
+            L_k[k] = 1.0;
+        }
+        if (U_diff > 0)
+        {
+            DTYPE *L12 = ULV_L[node]->data + U_ncol;
+            DTYPE *L21 = ULV_L[node]->data + U_ncol * U_nrow;
+            DTYPE *L22 = ULV_L[node]->data + U_ncol * (U_nrow + 1);
+            copy_matrix_block(sizeof(DTYPE), U_ncol, U_diff, tmpD12, U_nrow, L12, U_nrow);
+            copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpD21, U_nrow, L21, U_nrow);
+            copy_matrix_block(sizeof(DTYPE), U_diff, U_diff, tmpD22, U_nrow, L22, U_nrow);
+        }
+        // D_mid{node} = tmpD11 - DU12 * LD21;
+        H2P_dense_mat_init(&D_mid[node], U_ncol, U_ncol);
+        copy_matrix_block(sizeof(DTYPE), U_ncol, U_ncol, tmpD11, U_nrow, D_mid[node]->data, U_ncol);
+        if (U_diff > 0)
+        {
+            CBLAS_GEMM(
+                CblasRowMajor, CblasNoTrans, CblasNoTrans, U_ncol, U_ncol, U_diff,
+                -1.0, tmpD12, U_nrow, tmpD21, U_nrow, 1.0, D_mid[node]->data, U_ncol
+            );
+        }
+    } else {  // Else of "if (level > 0)"
+        // Q{node} = eye(size(tmpD)); 
+        // We don't actually need Q{node} when node == root, just make a placeholder here
+        H2P_dense_mat_init(&ULV_Q[node], 1, 1);
+        H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
+        ULV_Ls[node] = 0;
+        // [tmpLL, tmpLU, Lp{node}] = lu(tmpD, 'vector');
+        // L{node} = tmpLL + tmpLU - eye(size(tmpD));
+        copy_matrix_block(sizeof(DTYPE), U_nrow, U_nrow, tmpD->data, U_nrow, ULV_L[node]->data, U_nrow);
+        H2P_int_vec_init(&ULV_p[node], U_nrow * 2);
+        ULV_p[node]->length = U_nrow;
+        int *perm = ULV_p[node]->data;
+        int *ipiv = ULV_p[node]->data + U_nrow;
+        info = LAPACK_GETRF(LAPACK_ROW_MAJOR, U_nrow, U_nrow, ULV_L[node]->data, U_nrow, ipiv);
+        // logdet = logdet + sum(log(abs(diag(tmpLU))))
+        DTYPE node_logdet = 0.0;
+        for (int k = 0; k < U_nrow; k++) node_logdet += DLOG(DABS(ULV_L[node]->data[k * U_nrow + k]));
+        #pragma omp atomic update
+        *HSS_logdet += node_logdet;
+        // Convert ipiv to real permutation vector
+        for (int k = 0; k < U_nrow; k++) perm[k] = k;
+        for (int k = 0; k < U_nrow; k++)
+        {
+            int piv = ipiv[k] - 1;
+            int p0  = perm[k];
+            int p1  = perm[piv];
+            perm[piv] = p0;
+            perm[k]   = p1;
+        }
+        if (info != 0)
+        {
+            #pragma omp atomic write
+            *nonsingular = 0;
+            ERROR_PRINTF("Node %d getrf() returned %d, target matrix with shifting %.2lf is singular\n", node, info, shift);
+        }
+    }  // End of "if (level > 0)"
+
+    // 3. Construct ULV_idx{node}, row indices where ULV_Q{node} and ULV_L{node} are applied to
+    if (!H2P_HSS_ULV_flag_read(nonsingular)) return;
+    if (node_n_child == 0)
+    {
+        int cluster_s   = mat_cluster[2 * node];
+        int cluster_e   = mat_cluster[2 * node + 1];
+        int cluster_len = cluster_e - cluster_s + 1;
+        H2P_int_vec_init(&ULV_idx[node], cluster_len);
+        for (int k = 0; k < cluster_len; k++)
+            ULV_idx[node]->data[k] = cluster_s + k;
+        ULV_idx[node]->length = cluster_len;
+        ASSERT_PRINTF(
+            ULV_idx[node]->length == ULV_L[node]->nrow, 
+            "Node %d ULV_idx length %d mismatch ULV_L size %d", 
+            node, ULV_idx[node]->length, ULV_L[node]->nrow
+        );
+    } else {
+        int idx_size = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            idx_size += D_mid[child_k]->nrow;
+        }
+        H2P_int_vec_init(&ULV_idx[node], idx_size);
+        idx_size = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            for (int l = 0; l < D_mid[child_k]->nrow; l++)
+                ULV_idx[node]->data[idx_size + l] = ULV_idx[child_k]->data[l];
+            idx_size += D_mid[child_k]->nrow;
+        }
+        ULV_idx[node]->length = idx_size;
+        ASSERT_PRINTF(
+            ULV_idx[node]->length == ULV_L[node]->nrow, 
+            "Node %d ULV_idx length %d mismatch ULV_L size %d", 
+            node, ULV_idx[node]->length, ULV_L[node]->nrow
+        );
+    }  // End of "if (node_n_child == 0)"
+
+    // 4. Free U_mid{child_k} and D_mid{child_k} since we no longer need them
+    if (node_n_child > 0)
+    {
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            H2P_dense_mat_destroy(&U_mid[child_k]);
+            H2P_dense_mat_destroy(&D_mid[child_k]);
+        }
+    }
+}
+
+// Release the ULV factorization stored in a H2Pack structure
+void H2P_HSS_ULV_free(H2Pack_p h2pack)
+{
+    int n_node = h2pack->n_node;
+    if (h2pack->ULV_idx != NULL)
+    {
+        for (int i = 0; i < n_node; i++)
+            H2P_int_vec_destroy(&h2pack->ULV_idx[i]);
+    }
+    if (h2pack->ULV_p != NULL)
+    {
+        for (int i = 0; i < n_node; i++)
+            H2P_int_vec_destroy(&h2pack->ULV_p[i]);
+    }
+    if (h2pack->ULV_Q != NULL)
+    {
+        for (int i = 0; i < n_node; i++)
+        {
+            H2P_dense_mat_destroy(&h2pack->ULV_Q[i]);
+            H2P_dense_mat_destroy(&h2pack->ULV_L[i]);
+        }
+    }
+    if (h2pack->ULV_Q_fp32 != NULL)
+    {
+        for (int i = 0; i < n_node; i++)
+        {
+            free_aligned(h2pack->ULV_Q_fp32[i]);
+            free_aligned(h2pack->ULV_L_fp32[i]);
+        }
+    }
+    free(h2pack->ULV_Ls);
+    free(h2pack->ULV_idx);
+    free(h2pack->ULV_p);
+    free(h2pack->ULV_Q);
+    free(h2pack->ULV_L);
+    free(h2pack->ULV_Q_fp32);
+    free(h2pack->ULV_L_fp32);
+    h2pack->ULV_Ls     = NULL;
+    h2pack->ULV_idx    = NULL;
+    h2pack->ULV_p      = NULL;
+    h2pack->ULV_Q      = NULL;
+    h2pack->ULV_L      = NULL;
+    h2pack->ULV_Q_fp32 = NULL;
+    h2pack->ULV_L_fp32 = NULL;
+}
 
 // Construct the LU Cholesky factorization for a HSS matrix
 void H2P_HSS_ULV_LU_factorize(H2Pack_p h2pack, const DTYPE shift)
@@ -21,17 +561,13 @@ void H2P_HSS_ULV_LU_factorize(H2Pack_p h2pack, const DTYPE shift)
         return;
     }
 
+    H2P_HSS_ULV_free(h2pack);
+
     int n_node          = h2pack->n_node;
     int n_thread        = h2pack->n_thread;
     int n_leaf_node     = h2pack->n_leaf_node;
-    int max_child       = h2pack->max_child;
-    int max_level       = h2pack->max_level;
-    int *children       = h2pack->children;
-    int *n_child        = h2pack->n_child;
     int *level_n_node   = h2pack->level_n_node;
     int *level_nodes    = h2pack->level_nodes;
-    int *mat_cluster    = h2pack->mat_cluster;
-    H2P_dense_mat_p *U  = h2pack->U;
     H2P_thread_buf_p *thread_buf = h2pack->tb;
 
     double st = get_wtime_sec();
@@ -67,325 +603,44 @@ void H2P_HSS_ULV_LU_factorize(H2Pack_p h2pack, const DTYPE shift)
 
     DTYPE HSS_logdet = 0.0;
 
-    // Level by level factorization
+    // 1. Factorize the lower levels with DAG scheduling, a node is factorized
+    //    as soon as all its children are factorized
     int nonsingular = 1;
-    for (int i = max_level; i >= 0; i--)
+    int dag_min_level;
+    DAG_task_queue_p ULV_tq = NULL;
+    H2P_HSS_ULV_build_task_queue(h2pack, &dag_min_level, &ULV_tq);
+    BLAS_SET_NUM_THREADS(1);
+    #pragma omp parallel num_threads(n_thread)
     {
-        int *level_i_nodes = level_nodes + i * n_leaf_node;
-        int level_i_n_node = level_n_node[i];
-        int n_thread_i = MIN(level_i_n_node, n_thread);
-        if (!nonsingular) break;
-        #pragma omp parallel num_threads(n_thread_i)
+        int tid = omp_get_thread_num();
+        int node = DAG_task_queue_get_task(ULV_tq);
+        while (node != -1)
         {
-            int tid = omp_get_thread_num();
-            H2P_int_vec_p   tmpidx = thread_buf[tid]->idx0;
-            H2P_dense_mat_p tmpU   = thread_buf[tid]->mat0;
-            H2P_dense_mat_p tmpD   = thread_buf[tid]->mat1;
-            H2P_dense_mat_p tmpB   = thread_buf[tid]->mat2;
-            H2P_dense_mat_p tmpM   = thread_buf[tid]->mat0;
-
-            #pragma omp for schedule(dynamic)
-            for (int j = 0; j < level_i_n_node; j++)
-            {
-                if (!nonsingular) continue;
-                int node = level_i_nodes[j];
-                int node_n_child = n_child[node];
-                int *node_children = children + node * max_child;
-                // 1. Construct tmpU and tmpD for factorization
-                int U_nrow, U_ncol, U_diff;
-                if (node_n_child == 0)
-                {
-                    // Leaf node, use the original U and D
-                    H2P_dense_mat_resize(tmpU, U[node]->nrow, U[node]->ncol);
-                    copy_matrix_block(sizeof(DTYPE), U[node]->nrow, U[node]->ncol, U[node]->data, U[node]->ld, tmpU->data, tmpU->ld);
-                    H2P_get_Dij_block(h2pack, node, node, tmpD);
-                    for (int k = 0; k < tmpD->nrow; k++)
-                        tmpD->data[k * tmpD->ld + k] += shift;
-                } else {
-                    // Non-leaf node, assemble tmpU and tmpD from mid_U and mid_D
-                    // (1) Accumulate the dimension of each compressed child's diagonal block
-                    H2P_int_vec_set_capacity(tmpidx, node_n_child + 1);
-                    int *offset = tmpidx->data;
-                    offset[0] = 0;
-                    U_nrow = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        offset[k + 1] = offset[k] + D_mid[child_k]->nrow;
-                        U_nrow += D_mid[child_k]->nrow;
-                    }
-                    // (2) Build the compressed diagonal block
-                    // Build tmpD, we need tmpB and tmpM (same buffer as tmpU, so we build tmpU later)
-                    H2P_dense_mat_resize(tmpD, U_nrow, U_nrow);
-                    memset(tmpD->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        // idx_k = offset(k) : offset(k+1)-1;
-                        int idx_k_s = offset[k];
-                        int idx_k_len = offset[k + 1] - idx_k_s;
-                        // Diagonal blocks
-                        // tmpD(idx_k, idx_k) = D_mid{child_k};
-                        copy_matrix_block(
-                            sizeof(DTYPE), D_mid[child_k]->nrow, D_mid[child_k]->ncol, D_mid[child_k]->data, 
-                            D_mid[child_k]->ld, tmpD->data + idx_k_s * (tmpD->ld + 1), tmpD->ld
-                        );
-                        // Off-diagonal blocks
-                        for (int l = k + 1; l < node_n_child; l++)
-                        {
-                            int child_l = node_children[l];
-                            // idx_l = offset(l) : offset(l+1)-1;
-                            int idx_l_s = offset[l];
-                            int idx_l_len = offset[l + 1] - idx_l_s;
-                            // B_idx = B_pair2idx(child_k, child_l);
-                            H2P_get_Bij_block(h2pack, child_k, child_l, tmpB);
-                            // tmpD(idx_k, idx_l) = U_mid{child_k} * B{B_idx} * U_mid{child_l}';
-                            H2P_dense_mat_resize(tmpM, tmpB->nrow, U_mid[child_l]->nrow);
-                            CBLAS_GEMM(
-                                CblasRowMajor, CblasNoTrans, CblasTrans, tmpM->nrow, tmpM->ncol, tmpB->ncol,
-                                1.0, tmpB->data, tmpB->ld, U_mid[child_l]->data, U_mid[child_l]->ld, 
-                                0.0, tmpM->data, tmpM->ld
-                            );
-                            DTYPE *tmpD_kl = tmpD->data + idx_k_s * tmpD->ld + idx_l_s;
-                            DTYPE *tmpD_lk = tmpD->data + idx_l_s * tmpD->ld + idx_k_s;
-                            CBLAS_GEMM(
-                                CblasRowMajor, CblasNoTrans, CblasNoTrans, U_mid[child_k]->nrow, tmpM->ncol, tmpM->nrow,
-                                1.0, U_mid[child_k]->data, U_mid[child_k]->ld, tmpM->data, tmpM->ld, 
-                                0.0, tmpD_kl, tmpD->ld
-                            );
-                            // tmpD(idx_l, idx_k) = tmpD(idx_k, idx_l)';
-                            H2P_transpose_dmat(1, idx_k_len, idx_l_len, tmpD_kl, tmpD->ld, tmpD_lk, tmpD->ld);
-                        }
-                    }  // End of k loop
-                    // Build tmpU, now tmpM is no long used
-                    H2P_dense_mat_resize(tmpU, U_nrow, U_nrow);
-                    memset(tmpU->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        // idx_k = offset(k) : offset(k+1)-1;
-                        int idx_k_s = offset[k];
-                        // Diagonal blocks
-                        // tmpU(idx_k, idx_k) = U_mid{child_k};
-                        copy_matrix_block(
-                            sizeof(DTYPE), U_mid[child_k]->nrow, U_mid[child_k]->ncol, U_mid[child_k]->data, 
-                            U_mid[child_k]->ld, tmpU->data + idx_k_s * (tmpU->ld + 1), tmpU->ld
-                        );
-                    }  // End of k loop
-                    // if (level > 1), tmpU = tmpU * U{node}; end
-                    // tmpU (tmpM, mat0) and tmpD (mat1) are used, use tmpB (mat2) as buffer
-                    if (i > 0)
-                    {
-                        H2P_dense_mat_resize(tmpB, tmpU->nrow, U[node]->ncol);
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpB->nrow, tmpB->ncol, tmpU->ncol,
-                            1.0, tmpU->data, tmpU->ld, U[node]->data, U[node]->ld, 0.0, tmpB->data, tmpB->ld
-                        );
-                        H2P_dense_mat_resize(tmpU, tmpB->nrow, tmpB->ncol);
-                        copy_matrix_block(sizeof(DTYPE), tmpB->nrow, tmpB->ncol, tmpB->data, tmpB->ld, tmpU->data, tmpU->ld);
-                    }
-                }  // End of "if (node_n_child == 0)"
-                U_nrow = tmpU->nrow;
-                U_ncol = tmpU->ncol;
-                U_diff = U_nrow - U_ncol;
-                ASSERT_PRINTF(U_nrow >= U_ncol, "tmpU has more columns (%d) than rows (%d)!\n", U_ncol, U_nrow);
-
-                // 2. LU factorization
-                // size(tmpU) = [U_nrow, U_ncol]
-                // size(tmpD) = [U_nrow, U_nrow]
-                // U_nrow >= U_ncol always holds
-                int info;
-                if (i > 0)
-                {
-                    H2P_dense_mat_init(&ULV_Q[node], U_nrow + 1, U_ncol);
-                    H2P_dense_mat_init(&U_mid[node], U_ncol, U_ncol);
-                    // [Q{node}, R] = qr(tmpU);
-                    copy_matrix_block(sizeof(DTYPE), U_nrow, U_ncol, tmpU->data, tmpU->ld, ULV_Q[node]->data, ULV_Q[node]->ld);
-                    DTYPE *A   = ULV_Q[node]->data;
-                    DTYPE *tau = ULV_Q[node]->data + U_nrow * U_ncol;
-                    info = LAPACK_GEQRF(LAPACK_ROW_MAJOR, U_nrow, U_ncol, A, U_ncol, tau);
-                    // U_mid{node} = R(1 : U_ncol, :);
-                    for (int k = 0; k < U_ncol; k++)
-                    {
-                        DTYPE *A_k = A + k * U_ncol;
-                        DTYPE *R_k = U_mid[node]->data + k * U_ncol;
-                        if (k > 0) memset(R_k, 0, sizeof(DTYPE) * k);
-                        memcpy(R_k + k, A_k + k, sizeof(DTYPE) * (U_ncol - k));
-                    }
-                    ULV_Ls[node] = U_ncol;
-                    // tmpD = Q{node}' * tmpD * Q{node};
-                    info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
-                    info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'R', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
-                    // tmpD11 = tmpD(1 : U_ncol, 1 : U_ncol);
-                    // tmpD12 = tmpD(1 : U_ncol, (U_ncol+1) : end);
-                    // tmpD21 = tmpD((U_ncol+1) : end, 1 : U_ncol);
-                    // tmpD22 = tmpD((U_ncol+1) : end, (U_ncol+1) : end);
-                    DTYPE *tmpD11 = tmpD->data;
-                    DTYPE *tmpD12 = tmpD->data + U_ncol;
-                    DTYPE *tmpD21 = tmpD->data + U_ncol * U_nrow;
-                    DTYPE *tmpD22 = tmpD->data + U_ncol * (U_nrow + 1);
-                    H2P_int_vec_init(&ULV_p[node], U_diff * 2);
-                    ULV_p[node]->length = U_diff;
-                    if (U_diff > 0)
-                    {
-                        // [tmpLL, tmpLU, Lp{node}] = lu(tmpD22, 'vector');
-                        // tmpL = tmpLL + tmpLU - eye(U_diff);
-                        // Here tmpL is stored in tmpD22
-                        int *perm = ULV_p[node]->data;
-                        int *ipiv = ULV_p[node]->data + U_diff;
-                        info = LAPACK_GETRF(LAPACK_ROW_MAJOR, U_diff, U_diff, tmpD22, U_nrow, ipiv);
-                        // logdet = logdet + log(abs(prod(diag(tmpLU))));
-                        DTYPE prod = 1.0;
-                        for (int k = 0; k < U_diff; k++) prod *= tmpD22[k * U_nrow + k];
-                        #pragma omp atomic update
-                        HSS_logdet += DLOG(DABS(prod));
-                        // Convert ipiv to real permutation vector
-                        for (int k = 0; k < U_diff; k++) perm[k] = k;
-                        for (int k = 0; k < U_diff; k++)
-                        {
-                            int piv = ipiv[k] - 1;
-                            int p0  = perm[k];
-                            int p1  = perm[piv];
-                            perm[piv] = p0;
-                            perm[k]   = p1;
-                        }
-                        if (info != 0)
-                        {
-                            nonsingular = 0;
-                            ERROR_PRINTF("Node %d getrf() returned %d, target matrix with shifting %.2lf is singular\n", node, info, shift);
-                        }
-                        // LD21 = tmpLL \ tmpD21(Lp{node}, :);
-                        // Here tmpD21(Lp{node}, :) and LD21 is stored in tmpD21
-                        H2P_dense_mat_resize(tmpM, U_diff, U_ncol);
-                        copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpD21, U_nrow, tmpM->data, tmpM->ld);
-                        H2P_dense_mat_permute_rows(tmpM, ULV_p[node]->data);
-                        copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpM->data, tmpM->ld, tmpD21, U_nrow);
-                        CBLAS_TRSM(
-                            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
-                            U_diff, U_ncol, 1.0, tmpD22, U_nrow, tmpD21, U_nrow
-                        );
-                        // DU12 = tmpD12 / tmpLU;  % == tmpD12 * inv(tmpLU)
-                        // Here DU12 is stored in tmpD12
-                        CBLAS_TRSM(
-                            CblasRowMajor, CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit, 
-                            U_ncol, U_diff, 1.0, tmpD22, U_nrow, tmpD12, U_nrow
-                        );
-                    }  // End of "if (U_diff > 0)"
-                    // L{node} = [eye(U_ncol), DU12; LD21, tmpL];
-                    H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
-                    for (int k = 0; k < U_ncol; k++)
-                    {
-                        DTYPE *L_k = ULV_L[node]->data + k * U_nrow;
-                        memset(L_k, 0, sizeof(DTYPE) * U_nrow);
-                        L_k[k] = 1.0;
-                    }
-                    if (U_diff > 0)
-                    {
-                        DTYPE *L12 = ULV_L[node]->data + U_ncol;
-                        DTYPE *L21 = ULV_L[node]->data + U_ncol * U_nrow;
-                        DTYPE *L22 = ULV_L[node]->data + U_ncol * (U_nrow + 1);
-                        copy_matrix_block(sizeof(DTYPE), U_ncol, U_diff, tmpD12, U_nrow, L12, U_nrow);
-                        copy_matrix_block(sizeof(DTYPE), U_diff, U_ncol, tmpD21, U_nrow, L21, U_nrow);
-                        copy_matrix_block(sizeof(DTYPE), U_diff, U_diff, tmpD22, U_nrow, L22, U_nrow);
-                    }
-                    // D_mid{node} = tmpD11 - DU12 * LD21;
-                    H2P_dense_mat_init(&D_mid[node], U_ncol, U_ncol);
-                    copy_matrix_block(sizeof(DTYPE), U_ncol, U_ncol, tmpD11, U_nrow, D_mid[node]->data, U_ncol);
-                    if (U_diff > 0)
-                    {
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasNoTrans, CblasNoTrans, U_ncol, U_ncol, U_diff,
-                            -1.0, tmpD12, U_nrow, tmpD21, U_nrow, 1.0, D_mid[node]->data, U_ncol
-                        );
-                    }
-                } else {  // Else of "if (i > 0)"
-                    // Q{node} = eye(size(tmpD)); 
-                    // We don't actually need Q{node} when node == root, just make a placeholder here
-                    H2P_dense_mat_init(&ULV_Q[node], 1, 1);
-                    H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
-                    ULV_Ls[node] = 0;
-                    // [tmpLL, tmpLU, Lp{node}] = lu(tmpD, 'vector');
-                    // L{node} = tmpLL + tmpLU - eye(size(tmpD));
-                    copy_matrix_block(sizeof(DTYPE), U_nrow, U_nrow, tmpD->data, U_nrow, ULV_L[node]->data, U_nrow);
-                    H2P_int_vec_init(&ULV_p[node], U_nrow * 2);
-                    ULV_p[node]->length = U_nrow;
-                    int *perm = ULV_p[node]->data;
-                    int *ipiv = ULV_p[node]->data + U_nrow;
-                    info = LAPACK_GETRF(LAPACK_ROW_MAJOR, U_nrow, U_nrow, ULV_L[node]->data, U_nrow, ipiv);
-                    // logdet = logdet + log(abs(prod(diag(tmpLU))));
-                    DTYPE prod = 1.0;
-                    for (int k = 0; k < U_nrow; k++) prod *= ULV_L[node]->data[k * U_nrow + k];
-                    #pragma omp atomic update
-                    HSS_logdet += DLOG(DABS(prod));
-                    // Convert ipiv to real permutation vector
-                    for (int k = 0; k < U_nrow; k++) perm[k] = k;
-                    for (int k = 0; k < U_nrow; k++)
-                    {
-                        int piv = ipiv[k] - 1;
-                        int p0  = perm[k];
-                        int p1  = perm[piv];
-                        perm[piv] = p0;
-                        perm[k]   = p1;
-                    }
-                    if (info != 0)
-                    {
-                        nonsingular = 0;
-                        ERROR_PRINTF("Node %d getrf() returned %d, target matrix with shifting %.2lf is singular\n", node, info, shift);
-                    }
-                }  // End of "if (i > 0)"
+            H2P_HSS_ULV_LU_factorize_node(
+                h2pack, node, shift, thread_buf[tid], U_mid, D_mid, ULV_Ls, 
+                ULV_idx, ULV_p, ULV_Q, ULV_L, &HSS_logdet, &nonsingular
+            );
+            DAG_task_queue_finish_task(ULV_tq, node);
+            node = DAG_task_queue_get_task(ULV_tq);
+        }
+    }  // End of "#pragma omp parallel"
+    DAG_task_queue_destroy(&ULV_tq);
 
-                // 3. Construct ULV_idx{node}, row indices where ULV_Q{node} and ULV_L{node} are applied to
-                if (!nonsingular) continue;
-                if (node_n_child == 0)
-                {
-                    int cluster_s   = mat_cluster[2 * node];
-                    int cluster_e   = mat_cluster[2 * node + 1];
-                    int cluster_len = cluster_e - cluster_s + 1;
-                    H2P_int_vec_init(&ULV_idx[node], cluster_len);
-                    for (int k = 0; k < cluster_len; k++)
-                        ULV_idx[node]->data[k] = cluster_s + k;
-                    ULV_idx[node]->length = cluster_len;
-                    ASSERT_PRINTF(
-                        ULV_idx[node]->length == ULV_L[node]->nrow, 
-                        "Node %d ULV_idx length %d mismatch ULV_L size %d", 
-                        node, ULV_idx[node]->length, ULV_L[node]->nrow
-                    );
-                } else {
-                    int idx_size = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        idx_size += D_mid[child_k]->nrow;
-                    }
-                    H2P_int_vec_init(&ULV_idx[node], idx_size);
-                    idx_size = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        for (int l = 0; l < D_mid[child_k]->nrow; l++)
-                            ULV_idx[node]->data[idx_size + l] = ULV_idx[child_k]->data[l];
-                        idx_size += D_mid[child_k]->nrow;
-                    }
-                    ULV_idx[node]->length = idx_size;
-                    ASSERT_PRINTF(
-                        ULV_idx[node]->length == ULV_L[node]->nrow, 
-                        "Node %d ULV_idx length %d mismatch ULV_L size %d", 
-                        node, ULV_idx[node]->length, ULV_L[node]->nrow
-                    );
-                }  // End of "if (node_n_child == 0)"
-
-                // 4. Free U_mid{child_k} and D_mid{child_k} since we no longer need them
-                if (node_n_child > 0)
-                {
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        H2P_dense_mat_destroy(&U_mid[child_k]);
-                        H2P_dense_mat_destroy(&D_mid[child_k]);
-                    }
-                }
-            }  // End of j loop
-        }  // End of "#pragma omp parallel"
+    // 2. Levels above dag_min_level have fewer nodes than threads and diagonal blocks 
+    //    larger than HSS_ULV_DAG_MAX_BLK_SIZE, factorize these nodes one by one with 
+    //    multithreaded BLAS & LAPACK
+    BLAS_SET_NUM_THREADS(n_thread);
+    for (int i = dag_min_level - 1; i >= 0; i--)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        for (int j = 0; j < level_n_node[i]; j++)
+        {
+            int node = level_i_nodes[j];
+            H2P_HSS_ULV_LU_factorize_node(
+                h2pack, node, shift, thread_buf[0], U_mid, D_mid, ULV_Ls, 
+                ULV_idx, ULV_p, ULV_Q, ULV_L, &HSS_logdet, &nonsingular
+            );
+        }
     }  // End of i loop
 
     // Free intermediate matrices and set the output matrices
@@ -425,43 +680,129 @@ void H2P_HSS_ULV_LU_factorize(H2Pack_p h2pack, const DTYPE shift)
     }
 }
 
-// Solve the linear system A_{HSS} * x = b using the HSS ULV LU factorization
-void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x)
+// Apply the ULV LU factors of a node to its rows of the right-hand side matrix 
+// in the up sweep, i.e., solve with L_{HSS}
+// Input parameters:
+//   I_size : Size of the identity block of the node's ULV_L, == ULV_Ls[node]
+//   L_size : Size of the LU factor block of the node's ULV_L
+//   has_Q  : If the node's ULV_Q should be applied, == 0 for the root node
+//   n_vec  : Number of right-hand side vectors
+//   Q      : ULV_Q[node]->data, Householder vectors and tau
+//   L      : Size (I_size + L_size)^2, ULV_L[node]->data
+//   p      : Size L_size, ULV_p[node]->data
+//   b0     : Size (I_size + 2 * L_size) * n_vec, row-major, the first I_size + L_size 
+//            rows are the node's rows of the right-hand side, the rest is work space
+// Output parameter:
+//   b0 : The first I_size + L_size rows are the node's rows of the solution
+void H2P_HSS_ULV_LU_fwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const DTYPE *Q, const DTYPE *L, const int *p, DTYPE *b0
+)
 {
-    if (!h2pack->is_HSS)
-    {
-        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
-        return;
-    }
-    if (h2pack->ULV_idx == NULL)
+    int    L_nrow    = I_size + L_size;
+    size_t row_msize = sizeof(DTYPE) * n_vec;
+    // b0 = Q{node}' * x(idx, :);
+    // If node is the root node, Q{node} = I, b0 = x(idx, :)
+    if (has_Q)
     {
-        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() first!\n");
-        return;
+        const DTYPE *tau = Q + L_nrow * I_size;
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', L_nrow, n_vec, I_size, Q, I_size, tau, b0, n_vec);
     }
-    if (op < 1 || op > 3) 
+    // b1 = b0(1 : I_size, :);
+    // b2 = b0(I_size+1 : end, :);
+    // b2 = b2(Lp{node}, :);
+    DTYPE *b1  = b0;
+    DTYPE *b2  = b0 + I_size * n_vec;
+    DTYPE *b2p = b0 + L_nrow * n_vec;
+    memcpy(b2p, b2, row_msize * L_size);
+    for (int k = 0; k < L_size; k++) 
+        memcpy(b2 + k * n_vec, b2p + p[k] * n_vec, row_msize);
+    // DU12 = L{node}(1 : I_size, I_size+1 : end);
+    // L0 = L{node}(I_size+1 : end, I_size+1 : end);
+    // L0 = tril(L0, -1) + eye(size(L0));
+    const DTYPE *DU12 = L + I_size;
+    const DTYPE *L0   = L + I_size * (L_nrow + 1);
+    // x2 = L0 \ b2;
+    DTYPE *x2 = b2;
+    CBLAS_TRSM(
+        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+        L_size, n_vec, 1.0, L0, L_nrow, b2, n_vec
+    );
+    // x1 = b1 - DU12 * x2;
+    DTYPE *x1 = b1;
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, I_size, n_vec, L_size,
+        -1.0, DU12, L_nrow, x2, n_vec, 1.0, x1, n_vec
+    );
+}
+
+// Apply the ULV LU factors of a node to its rows of the right-hand side matrix 
+// in the down sweep, i.e., solve with U_{HSS}
+// Input parameters:
+//   I_size, L_size, has_Q, n_vec, Q, L : See H2P_HSS_ULV_LU_fwd_node()
+//   b0 : Size (I_size + L_size) * n_vec, row-major, the node's rows of the right-hand side
+// Output parameter:
+//   b0 : The node's rows of the solution
+void H2P_HSS_ULV_LU_bwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const DTYPE *Q, const DTYPE *L, DTYPE *b0
+)
+{
+    int L_nrow = I_size + L_size;
+    // b1 = b0(1 : I_size, :);
+    // b2 = b0(I_size+1 : end, :);
+    DTYPE *b1 = b0;
+    DTYPE *b2 = b0 + I_size * n_vec;
+    // LD21 = L{node}(I_size+1 : end, 1 : I_size);
+    // U0 = L{node}(I_size+1 : end, I_size+1 : end);
+    // U0 = triu(U0);
+    const DTYPE *LD21 = L + I_size * L_nrow;
+    const DTYPE *U0   = L + I_size * (L_nrow + 1);
+    // b2 = b2 - LD21 * b1;
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, L_size, n_vec, I_size,
+        -1.0, LD21, L_nrow, b1, n_vec, 1.0, b2, n_vec
+    );
+    // b2 = U0 \ b2;
+    CBLAS_TRSM(
+        CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+        L_size, n_vec, 1.0, U0, L_nrow, b2, n_vec
+    );
+    // x(idx, :) = Q{node} * [b1; b2];
+    // If node is the root node, Q{node} = I, x(idx, :) = [b1; b2]
+    if (has_Q)
     {
-        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
-        return;
+        const DTYPE *tau = Q + L_nrow * I_size;
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'N', L_nrow, n_vec, I_size, Q, I_size, tau, b0, n_vec);
     }
+}
 
+// Solve A_{HSS} * X = B with HSS ULV LU factorization in the sorted point ordering
+// Input parameters:
+//   h2pack : H2Pack structure with ULV LU factorization
+//   op     : Operation type, 1, 2, or 3, see H2P_HSS_ULV_LU_solve()
+//   n_vec  : Number of right-hand side vectors
+//   pmt_x  : Size h2pack->krnl_mat_size * n_vec, row-major right-hand side matrix B 
+//            with permuted rows, leading dimension n_vec
+// Output parameter:
+//   pmt_x  : Solution matrix X with permuted rows
+static void H2P_HSS_ULV_LU_solve_pmt(H2Pack_p h2pack, const int op, const int n_vec, DTYPE *pmt_x)
+{
     int n_leaf_node   = h2pack->n_leaf_node;
     int max_level     = h2pack->max_level;
     int n_thread      = h2pack->n_thread;
     int *level_n_node = h2pack->level_n_node;
     int *level_nodes  = h2pack->level_nodes;
     int *ULV_Ls       = h2pack->ULV_Ls;
+    float **ULV_Q_fp32 = h2pack->ULV_Q_fp32;
+    float **ULV_L_fp32 = h2pack->ULV_L_fp32;
     H2P_int_vec_p    *ULV_idx = h2pack->ULV_idx;
     H2P_int_vec_p    *ULV_p   = h2pack->ULV_p;
     H2P_dense_mat_p  *ULV_Q   = h2pack->ULV_Q;
     H2P_dense_mat_p  *ULV_L   = h2pack->ULV_L;
     H2P_thread_buf_p *thread_buf = h2pack->tb;
+    int fp32 = (ULV_Q_fp32 != NULL);
 
-    double st = get_wtime_sec();
-
-    DTYPE *pmt_x = h2pack->pmt_x;
-    H2P_permute_vector_forward(h2pack, b, pmt_x);
-    // memcpy(x, b, sizeof(DTYPE) * h2pack->krnl_mat_size);
-    
     int solve_U = op & 1;
     if (solve_U)
     {
@@ -480,51 +821,26 @@ void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *
                 for (int j = 0; j < level_i_n_node; j++)
                 {
                     int node = level_i_nodes[j];
-                    H2P_int_vec_p   idx = ULV_idx[node];
-                    H2P_int_vec_p   p   = ULV_p[node];
-                    H2P_dense_mat_p Q   = ULV_Q[node];
-                    H2P_dense_mat_p L   = ULV_L[node];
+                    H2P_int_vec_p idx = ULV_idx[node];
+                    H2P_int_vec_p p   = ULV_p[node];
                     int I_size = ULV_Ls[node];
-                    int L_size = L->nrow - I_size;
+                    int L_size = ULV_L[node]->nrow - I_size;
                     ASSERT_PRINTF(L_size == p->length, "Node %d: L_size %d != p_size %d\n", node, L_size, p->length);
-                    // b0 = Q{node}' * x(idx);
-                    H2P_dense_mat_resize(x0, idx->length + L_size, 1);
-                    for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-                    DTYPE *b0  = x0->data;
-                    // If i == 0 (root node), Q{node} = I, b0 = x(idx)
-                    if (i > 0)
+                    H2P_dense_mat_resize(x0, idx->length + L_size, n_vec);
+                    H2P_HSS_ULV_gather_rows(n_vec, idx, pmt_x, fp32, x0->data);
+                    if (fp32)
                     {
-                        DTYPE *A   = Q->data;
-                        DTYPE *tau = Q->data + (Q->nrow - 1) * Q->ncol;
-                        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', L->nrow, 1, Q->ncol, A, Q->ncol, tau, x0->data, 1);
+                        H2P_s_HSS_ULV_LU_fwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q_fp32[node], 
+                            ULV_L_fp32[node], p->data, (float*) x0->data
+                        );
+                    } else {
+                        H2P_HSS_ULV_LU_fwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q[node]->data, 
+                            ULV_L[node]->data, p->data, x0->data
+                        );
                     }
-                    // b1 = b0(1 : I_size);
-                    // b2 = b0(I_size+1 : end);
-                    // b2 = b2(Lp{node});
-                    DTYPE *b1  = b0;
-                    DTYPE *b2  = b0 + I_size;
-                    DTYPE *b2p = b0 + I_size + L_size;
-                    memcpy(b2p, b2, sizeof(DTYPE) * L_size);
-                    for (int k = 0; k < L_size; k++) b2[k] = b2p[p->data[k]];
-                    // DU12 = L{node}(1 : I_size, I_size+1 : end);
-                    // L0 = L{node}(I_size+1 : end, I_size+1 : end);
-                    // L0 = tril(L0, -1) + eye(size(L0));
-                    DTYPE *DU12 = L->data + I_size;
-                    DTYPE *L0   = L->data + I_size * (L->ld + 1);
-                    // x2 = L0 \ b2;
-                    DTYPE *x2 = b2;
-                    CBLAS_TRSM(
-                        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
-                        L_size, 1, 1.0, L0, L->ld, b2, 1
-                    );
-                    // x1 = b1 - DU12 * x2;
-                    DTYPE *x1 = b1;
-                    CBLAS_GEMV(
-                        CblasRowMajor, CblasNoTrans, I_size, L_size, 
-                        -1.0, DU12, L->ld, x2, 1, 1.0, x1, 1
-                    );
-                    // x(idx) = [x1; x2];
-                    for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
+                    H2P_HSS_ULV_scatter_rows(n_vec, idx, x0->data, fp32, pmt_x);
                 }  // End of j loop
             }  // End of "#pragma omp parallel"
         }  // End of i loop 
@@ -548,48 +864,54 @@ void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *
                 for (int j = 0; j < level_i_n_node; j++)
                 {
                     int node = level_i_nodes[j];
-                    H2P_int_vec_p   idx = ULV_idx[node];
-                    H2P_dense_mat_p Q   = ULV_Q[node];
-                    H2P_dense_mat_p L   = ULV_L[node];
+                    H2P_int_vec_p idx = ULV_idx[node];
                     int I_size = ULV_Ls[node];
-                    int L_size = L->nrow - I_size;
-                    // b0 = x(idx);
-                    // b1 = b0(1 : I_size);
-                    // b2 = b0(I_size+1 : end);
-                    H2P_dense_mat_resize(x0, idx->length, 1);
-                    for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-                    DTYPE *b0 = x0->data;
-                    DTYPE *b1 = b0;
-                    DTYPE *b2 = b0 + I_size;
-                    // LD21 = L{node}(I_size+1 : end, 1 : I_size);
-                    // U0 = L{node}(I_size+1 : end, I_size+1 : end);
-                    // U0 = triu(U0);
-                    DTYPE *LD21 = L->data + I_size * L->ld;
-                    DTYPE *U0   = L->data + I_size * (L->ld + 1);
-                    // b2 = b2 - LD21 * b1;
-                    CBLAS_GEMV(
-                        CblasRowMajor, CblasNoTrans, L_size, I_size, 
-                        -1.0, LD21, L->ld, b1, 1, 1.0, b2, 1
-                    );
-                    // b2 = U0 \ b2;
-                    CBLAS_TRSM(
-                        CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
-                        L_size, 1, 1.0, U0, L->ld, b2, 1
-                    );
-                    // x(idx) = Q{node} * [b1; b2];
-                    // If i == 0 (root node), Q{node} = I, x(idx) = [b1; b2]
-                    if (i > 0)
+                    int L_size = ULV_L[node]->nrow - I_size;
+                    H2P_dense_mat_resize(x0, idx->length, n_vec);
+                    H2P_HSS_ULV_gather_rows(n_vec, idx, pmt_x, fp32, x0->data);
+                    if (fp32)
                     {
-                        DTYPE *A   = Q->data;
-                        DTYPE *tau = Q->data + (Q->nrow - 1) * Q->ncol;
-                        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'N', L->nrow, 1, Q->ncol, A, Q->ncol, tau, x0->data, 1);
+                        H2P_s_HSS_ULV_LU_bwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q_fp32[node], 
+                            ULV_L_fp32[node], (float*) x0->data
+                        );
+                    } else {
+                        H2P_HSS_ULV_LU_bwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q[node]->data, 
+                            ULV_L[node]->data, x0->data
+                        );
                     }
-                    for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
+                    H2P_HSS_ULV_scatter_rows(n_vec, idx, x0->data, fp32, pmt_x);
                 }  // End of j loop
             }  // End of "#pragma omp parallel"
         }  // End of i loop 
     }  // End of "if (solve_L)"
+}
+
+// Solve the linear system A_{HSS} * x = b using the HSS ULV LU factorization
+void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x)
+{
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return;
+    }
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() first!\n");
+        return;
+    }
+    if (op < 1 || op > 3) 
+    {
+        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
+        return;
+    }
+
+    double st = get_wtime_sec();
 
+    DTYPE *pmt_x = h2pack->pmt_x;
+    H2P_permute_vector_forward(h2pack, b, pmt_x);
+    H2P_HSS_ULV_LU_solve_pmt(h2pack, op, 1, pmt_x);
     H2P_permute_vector_backward(h2pack, pmt_x, x);
 
     double et = get_wtime_sec();
@@ -597,6 +919,311 @@ void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *
     h2pack->timers[ULV_SLV_TIMER_IDX] += et - st;
 }
 
+// Factorize a node in the HSS ULV Cholesky factorization, all its children 
+// should have been factorized
+// Input parameters:
+//   h2pack      : H2Pack structure with constructed HSS representation
+//   node        : Target node
+//   shift       : Shift coefficient k to make (A + k * I) S.P.D.
+//   tb          : Thread buffer of the calling thread
+//   U_mid       : Size n_node, compressed projection matrices of factorized nodes
+//   D_mid       : Size n_node, compressed diagonal blocks of factorized nodes
+// Output parameters:
+//   U_mid, D_mid : U_mid[node] and D_mid[node] are computed, those of node's children are freed
+//   ULV_*        : ULV_Ls[node], ULV_idx[node], ULV_Q[node], and ULV_L[node] are computed
+//   HSS_logdet   : log(det(diagonal block of node)) is accumulated
+//   is_SPD       : Set to 0 if the node's diagonal block is not SPD, the node is skipped if it is 0
+static void H2P_HSS_ULV_Cholesky_factorize_node(
+    H2Pack_p h2pack, const int node, const DTYPE shift, H2P_thread_buf_p tb,
+    H2P_dense_mat_p *U_mid, H2P_dense_mat_p *D_mid, int *ULV_Ls, H2P_int_vec_p *ULV_idx,
+    H2P_dense_mat_p *ULV_Q, H2P_dense_mat_p *ULV_L, DTYPE *HSS_logdet, int *is_SPD
+)
+{
+    if (!H2P_HSS_ULV_flag_read(is_SPD)) return;
+
+    int max_child       = h2pack->max_child;
+    int level           = h2pack->node_level[node];
+    int *children       = h2pack->children;
+    int *n_child        = h2pack->n_child;
+    int *mat_cluster    = h2pack->mat_cluster;
+    H2P_dense_mat_p *U  = h2pack->U;
+    H2P_int_vec_p   tmpidx = tb->idx0;
+    H2P_dense_mat_p tmpU   = tb->mat0;
+    H2P_dense_mat_p tmpD   = tb->mat1;
+    H2P_dense_mat_p tmpB   = tb->mat2;
+    H2P_dense_mat_p tmpM   = tb->mat0;
+
+    int node_n_child = n_child[node];
+    int *node_children = children + node * max_child;
+    // 1. Construct tmpU and tmpD for factorization
+    int U_nrow, U_ncol, U_diff;
+    if (node_n_child == 0)
+    {
+        // Leaf node, use the original U and D
+        H2P_dense_mat_resize(tmpU, U[node]->nrow, U[node]->ncol);
+        copy_matrix_block(sizeof(DTYPE), U[node]->nrow, U[node]->ncol, U[node]->data, U[node]->ld, tmpU->data, tmpU->ld);
+        H2P_get_Dij_block(h2pack, node, node, tmpD);
+        for (int k = 0; k < tmpD->nrow; k++)
+            tmpD->data[k * tmpD->ld + k] += shift;
+    } else {
+        // Non-leaf node, assemble tmpU and tmpD from mid_U and mid_D
+        // (1) Accumulate the dimension of each compressed child's diagonal block
+        H2P_int_vec_set_capacity(tmpidx, node_n_child + 1);
+        int *offset = tmpidx->data;
+        offset[0] = 0;
+        U_nrow = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            offset[k + 1] = offset[k] + D_mid[child_k]->nrow;
+            U_nrow += D_mid[child_k]->nrow;
+        }
+        // (2) Build the compressed diagonal block
+        // Build tmpD, we need tmpB and tmpM (same buffer as tmpU, so we build tmpU later)
+        H2P_dense_mat_resize(tmpD, U_nrow, U_nrow);
+        memset(tmpD->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            // idx_k = offset(k) : offset(k+1)-1;
+            int idx_k_s = offset[k];
+            int idx_k_len = offset[k + 1] - idx_k_s;
+            // Diagonal blocks
+            // tmpD(idx_k, idx_k) = D_mid{child_k};
+            copy_matrix_block(
+                sizeof(DTYPE), D_mid[child_k]->nrow, D_mid[child_k]->ncol, D_mid[child_k]->data, 
+                D_mid[child_k]->ld, tmpD->data + idx_k_s * (tmpD->ld + 1), tmpD->ld
+            );
+            // Off-diagonal blocks
+            for (int l = k + 1; l < node_n_child; l++)
+            {
+                int child_l = node_children[l];
+                // idx_l = offset(l) : offset(l+1)-1;
+                int idx_l_s = offset[l];
+                int idx_l_len = offset[l + 1] - idx_l_s;
+                // B_idx = B_pair2idx(child_k, child_l);
+                H2P_get_Bij_block(h2pack, child_k, child_l, tmpB);
+                // tmpD(idx_k, idx_l) = U_mid{child_k} * B{B_idx} * U_mid{child_l}';
+                H2P_dense_mat_resize(tmpM, tmpB->nrow, U_mid[child_l]->nrow);
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasTrans, tmpM->nrow, tmpM->ncol, tmpB->ncol,
+                    1.0, tmpB->data, tmpB->ld, U_mid[child_l]->data, U_mid[child_l]->ld, 
+                    0.0, tmpM->data, tmpM->ld
+                );
+                DTYPE *tmpD_kl = tmpD->data + idx_k_s * tmpD->ld + idx_l_s;
+                DTYPE *tmpD_lk = tmpD->data + idx_l_s * tmpD->ld + idx_k_s;
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasNoTrans, U_mid[child_k]->nrow, tmpM->ncol, tmpM->nrow,
+                    1.0, U_mid[child_k]->data, U_mid[child_k]->ld, tmpM->data, tmpM->ld, 
+                    0.0, tmpD_kl, tmpD->ld
+                );
+                // tmpD(idx_l, idx_k) = tmpD(idx_k, idx_l)';
+                H2P_transpose_dmat(1, idx_k_len, idx_l_len, tmpD_kl, tmpD->ld, tmpD_lk, tmpD->ld);
+            }
+        }  // End of k loop
+        // Build tmpU, now tmpM is no long used
+        H2P_dense_mat_resize(tmpU, U_nrow, U_nrow);
+        memset(tmpU->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            // idx_k = offset(k) : offset(k+1)-1;
+            int idx_k_s = offset[k];
+            // Diagonal blocks
+            // tmpU(idx_k, idx_k) = U_mid{child_k};
+            copy_matrix_block(
+                sizeof(DTYPE), U_mid[child_k]->nrow, U_mid[child_k]->ncol, U_mid[child_k]->data, 
+                U_mid[child_k]->ld, tmpU->data + idx_k_s * (tmpU->ld + 1), tmpU->ld
+            );
+        }  // End of k loop
+        // if (level > 1), tmpU = tmpU * U{node}; end
+        // tmpU (tmpM, mat0) and tmpD (mat1) are used, use tmpB (mat2) as buffer
+        if (level > 0)
+        {
+            H2P_dense_mat_resize(tmpB, tmpU->nrow, U[node]->ncol);
+            CBLAS_GEMM(
+                CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpB->nrow, tmpB->ncol, tmpU->ncol,
+                1.0, tmpU->data, tmpU->ld, U[node]->data, U[node]->ld, 0.0, tmpB->data, tmpB->ld
+            );
+            H2P_dense_mat_resize(tmpU, tmpB->nrow, tmpB->ncol);
+            copy_matrix_block(sizeof(DTYPE), tmpB->nrow, tmpB->ncol, tmpB->data, tmpB->ld, tmpU->data, tmpU->ld);
+        }
+    }  // End of "if (node_n_child == 0)"
+    U_nrow = tmpU->nrow;
+    U_ncol = tmpU->ncol;
+    U_diff = U_nrow - U_ncol;
+    ASSERT_PRINTF(U_nrow >= U_ncol, "tmpU has more columns (%d) than rows (%d)!\n", U_ncol, U_nrow);
+
+    // 2. Cholesky factorization
+    // size(tmpU) = [U_nrow, U_ncol]
+    // size(tmpD) = [U_nrow, U_nrow]
+    // U_nrow >= U_ncol always holds
+    int info;
+    if (level > 0)
+    {
+        H2P_dense_mat_init(&ULV_Q[node], U_nrow + 1, U_ncol);
+        H2P_dense_mat_init(&U_mid[node], U_ncol, U_ncol);
+        // [Q{node}, R] = qr(tmpU);
+        copy_matrix_block(sizeof(DTYPE), U_nrow, U_ncol, tmpU->data, tmpU->ld, ULV_Q[node]->data, ULV_Q[node]->ld);
+        DTYPE *A   = ULV_Q[node]->data;
+        DTYPE *tau = ULV_Q[node]->data + U_nrow * U_ncol;
+        info = LAPACK_GEQRF(LAPACK_ROW_MAJOR, U_nrow, U_ncol, A, U_ncol, tau);
+        // U_mid{node} = R(1 : U_ncol, :);
+        for (int k = 0; k < U_ncol; k++)
+        {
+            DTYPE *A_k = A + k * U_ncol;
+            DTYPE *R_k = U_mid[node]->data + k * U_ncol;
+            if (k > 0) memset(R_k, 0, sizeof(DTYPE) * k);
+            memcpy(R_k + k, A_k + k, sizeof(DTYPE) * (U_ncol - k));
+        }
+        ULV_Ls[node] = U_ncol;
+        // tmpD = Q{node}' * tmpD * Q{node};
+        info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
+        info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'R', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
+        // tmpD11 = tmpD(1 : U_ncol, 1 : U_ncol);
+        // tmpD21 = tmpD((U_ncol+1) : end, 1 : U_ncol);
+        // tmpD22 = tmpD((U_ncol+1) : end, (U_ncol+1) : end);
+        DTYPE *tmpD11 = tmpD->data;
+        DTYPE *tmpD21 = tmpD->data + U_ncol * U_nrow;
+        DTYPE *tmpD22 = tmpD->data + U_ncol * (U_nrow + 1);
+        if (U_diff > 0)
+        {
+            // [tmpL, chol_flag] = chol(tmpD22, 'lower');
+            // Here tmpL is stored in tmpD22
+            info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', U_diff, tmpD22, U_nrow);
+            for (int k = 0; k < U_diff - 1; k++)
+            {
+                DTYPE *tmpL_kk1 = tmpD22 + k * U_nrow + (k + 1);
+                int n_zero_row = U_diff - 1 - k;
+                memset(tmpL_kk1, 0, sizeof(DTYPE) * n_zero_row);
+            }
+            if (info != 0)
+            {
+                #pragma omp atomic write
+                *is_SPD = 0;
+                ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
+            }
+            // logdet = logdet + 2 * sum(log(abs(diag(tmpL)))), the product of the 
+            // diagonal entries may overflow or underflow
+            DTYPE node_logdet = 0.0;
+            for (int k = 0; k < U_diff; k++) node_logdet += DLOG(DABS(tmpD22[k * U_nrow + k]));
+            #pragma omp atomic update
+            *HSS_logdet += 2.0 * node_logdet;
+            // LD21 = tmpL \ tmpD21;
+            // Here LD21 is stored in tmpD21
+            CBLAS_TRSM(
+                CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+                U_diff, U_ncol, 1.0, tmpD22, U_nrow, tmpD21, U_nrow
+            );
+        }
+        // L{node} = [eye(U_ncol), LD21'; zeros(U_diff, U_ncol), tmpL];
+        H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
+        for (int k = 0; k < U_ncol; k++)
+        {
+            DTYPE *L_k = ULV_L[node]->data + k * U_nrow;
+            memset(L_k, 0, sizeof(DTYPE) * U_nrow);
+            L_k[k] = 1.0;
+        }
+        if (U_diff > 0)
+        {
+            DTYPE *L12 = ULV_L[node]->data + U_ncol;
+            DTYPE *L21 = ULV_L[node]->data + U_ncol * U_nrow;
+            DTYPE *L22 = ULV_L[node]->data + U_ncol * (U_nrow + 1);
+            H2P_transpose_dmat(1, U_diff, U_ncol, tmpD21, U_nrow, L12, U_nrow);
+            for (int k = 0; k < U_diff; k++)
+                memset(L21 + k * U_nrow, 0, sizeof(DTYPE) * U_ncol);
+            copy_matrix_block(sizeof(DTYPE), U_diff, U_diff, tmpD22, U_nrow, L22, U_nrow);
+        }
+        // D_mid{node} = tmpD11 - LD21' * LD21;
+        H2P_dense_mat_init(&D_mid[node], U_ncol, U_ncol);
+        copy_matrix_block(sizeof(DTYPE), U_ncol, U_ncol, tmpD11, U_nrow, D_mid[node]->data, U_ncol);
+        if (U_diff > 0)
+        {
+            CBLAS_GEMM(
+                CblasRowMajor, CblasTrans, CblasNoTrans, U_ncol, U_ncol, U_diff,
+                -1.0, tmpD21, U_nrow, tmpD21, U_nrow, 1.0, D_mid[node]->data, U_ncol
+            );
+        }
+    } else {  // Else of "if (level > 0)"
+        // Q{node} = eye(size(tmpD)); 
+        // We don't actually need Q{node} when node == root, just make a placeholder here
+        H2P_dense_mat_init(&ULV_Q[node], 1, 1);
+        H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
+        ULV_Ls[node] = 0;
+        // [L{node}, chol_flag] = chol(tmpD, 'lower');
+        copy_matrix_block(sizeof(DTYPE), U_nrow, U_nrow, tmpD->data, U_nrow, ULV_L[node]->data, U_nrow);
+        info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', U_nrow, ULV_L[node]->data, U_nrow);
+        for (int k = 0; k < U_nrow; k++)
+        {
+            DTYPE *L_kk1 = ULV_L[node]->data + k * U_nrow + (k + 1);
+            int n_zero_row = U_nrow - 1 - k;
+            memset(L_kk1, 0, sizeof(DTYPE) * n_zero_row);
+        }
+        if (info != 0)
+        {
+            #pragma omp atomic write
+            *is_SPD = 0;
+            ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
+        }
+        // logdet = logdet + 2 * sum(log(abs(diag(tmpL))))
+        DTYPE node_logdet = 0.0;
+        for (int k = 0; k < U_nrow; k++) node_logdet += DLOG(DABS(ULV_L[node]->data[k * U_nrow + k]));
+        #pragma omp atomic update
+        *HSS_logdet += 2.0 * node_logdet;
+    }  // End of "if (level > 0)"
+
+    // 3. Construct ULV_idx{node}, row indices where ULV_Q{node} and ULV_L{node} are applied to
+    if (!H2P_HSS_ULV_flag_read(is_SPD)) return;
+    if (node_n_child == 0)
+    {
+        int cluster_s   = mat_cluster[2 * node];
+        int cluster_e   = mat_cluster[2 * node + 1];
+        int cluster_len = cluster_e - cluster_s + 1;
+        H2P_int_vec_init(&ULV_idx[node], cluster_len);
+        for (int k = 0; k < cluster_len; k++)
+            ULV_idx[node]->data[k] = cluster_s + k;
+        ULV_idx[node]->length = cluster_len;
+        ASSERT_PRINTF(
+            ULV_idx[node]->length == ULV_L[node]->nrow, 
+            "Node %d ULV_idx length %d mismatch ULV_L size %d", 
+            node, ULV_idx[node]->length, ULV_L[node]->nrow
+        );
+    } else {
+        int idx_size = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            idx_size += D_mid[child_k]->nrow;
+        }
+        H2P_int_vec_init(&ULV_idx[node], idx_size);
+        idx_size = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            for (int l = 0; l < D_mid[child_k]->nrow; l++)
+                ULV_idx[node]->data[idx_size + l] = ULV_idx[child_k]->data[l];
+            idx_size += D_mid[child_k]->nrow;
+        }
+        ULV_idx[node]->length = idx_size;
+        ASSERT_PRINTF(
+            ULV_idx[node]->length == ULV_L[node]->nrow, 
+            "Node %d ULV_idx length %d mismatch ULV_L size %d", 
+            node, ULV_idx[node]->length, ULV_L[node]->nrow
+        );
+    }  // End of "if (node_n_child == 0)"
+
+    // 4. Free U_mid{child_k} and D_mid{child_k} since we no longer need them
+    if (node_n_child > 0)
+    {
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            H2P_dense_mat_destroy(&U_mid[child_k]);
+            H2P_dense_mat_destroy(&D_mid[child_k]);
+        }
+    }
+}
+
 // Construct the ULV Cholesky factorization for a HSS matrix
 void H2P_HSS_ULV_Cholesky_factorize(H2Pack_p h2pack, const DTYPE shift)
 {
@@ -606,17 +1233,13 @@ void H2P_HSS_ULV_Cholesky_factorize(H2Pack_p h2pack, const DTYPE shift)
         return;
     }
 
+    H2P_HSS_ULV_free(h2pack);
+
     int n_node          = h2pack->n_node;
     int n_thread        = h2pack->n_thread;
     int n_leaf_node     = h2pack->n_leaf_node;
-    int max_child       = h2pack->max_child;
-    int max_level       = h2pack->max_level;
-    int *children       = h2pack->children;
-    int *n_child        = h2pack->n_child;
     int *level_n_node   = h2pack->level_n_node;
     int *level_nodes    = h2pack->level_nodes;
-    int *mat_cluster    = h2pack->mat_cluster;
-    H2P_dense_mat_p *U  = h2pack->U;
     H2P_thread_buf_p *thread_buf = h2pack->tb;
 
     double st = get_wtime_sec();
@@ -650,296 +1273,44 @@ void H2P_HSS_ULV_Cholesky_factorize(H2Pack_p h2pack, const DTYPE shift)
 
     DTYPE HSS_logdet = 0.0;
 
-    // Level by level factorization
+    // 1. Factorize the lower levels with DAG scheduling, a node is factorized
+    //    as soon as all its children are factorized
     int is_SPD = 1;
-    for (int i = max_level; i >= 0; i--)
+    int dag_min_level;
+    DAG_task_queue_p ULV_tq = NULL;
+    H2P_HSS_ULV_build_task_queue(h2pack, &dag_min_level, &ULV_tq);
+    BLAS_SET_NUM_THREADS(1);
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        int node = DAG_task_queue_get_task(ULV_tq);
+        while (node != -1)
+        {
+            H2P_HSS_ULV_Cholesky_factorize_node(
+                h2pack, node, shift, thread_buf[tid], U_mid, D_mid, ULV_Ls, 
+                ULV_idx, ULV_Q, ULV_L, &HSS_logdet, &is_SPD
+            );
+            DAG_task_queue_finish_task(ULV_tq, node);
+            node = DAG_task_queue_get_task(ULV_tq);
+        }
+    }  // End of "#pragma omp parallel"
+    DAG_task_queue_destroy(&ULV_tq);
+
+    // 2. Levels above dag_min_level have fewer nodes than threads and diagonal blocks 
+    //    larger than HSS_ULV_DAG_MAX_BLK_SIZE, factorize these nodes one by one with 
+    //    multithreaded BLAS & LAPACK
+    BLAS_SET_NUM_THREADS(n_thread);
+    for (int i = dag_min_level - 1; i >= 0; i--)
     {
         int *level_i_nodes = level_nodes + i * n_leaf_node;
-        int level_i_n_node = level_n_node[i];
-        int n_thread_i = MIN(level_i_n_node, n_thread);
-        if (!is_SPD) break;
-        #pragma omp parallel num_threads(n_thread_i)
+        for (int j = 0; j < level_n_node[i]; j++)
         {
-            int tid = omp_get_thread_num();
-            H2P_int_vec_p   tmpidx = thread_buf[tid]->idx0;
-            H2P_dense_mat_p tmpU   = thread_buf[tid]->mat0;
-            H2P_dense_mat_p tmpD   = thread_buf[tid]->mat1;
-            H2P_dense_mat_p tmpB   = thread_buf[tid]->mat2;
-            H2P_dense_mat_p tmpM   = thread_buf[tid]->mat0;
-
-            #pragma omp for schedule(dynamic)
-            for (int j = 0; j < level_i_n_node; j++)
-            {
-                if (!is_SPD) continue;
-                int node = level_i_nodes[j];
-                int node_n_child = n_child[node];
-                int *node_children = children + node * max_child;
-                // 1. Construct tmpU and tmpD for factorization
-                int U_nrow, U_ncol, U_diff;
-                if (node_n_child == 0)
-                {
-                    // Leaf node, use the original U and D
-                    H2P_dense_mat_resize(tmpU, U[node]->nrow, U[node]->ncol);
-                    copy_matrix_block(sizeof(DTYPE), U[node]->nrow, U[node]->ncol, U[node]->data, U[node]->ld, tmpU->data, tmpU->ld);
-                    H2P_get_Dij_block(h2pack, node, node, tmpD);
-                    for (int k = 0; k < tmpD->nrow; k++)
-                        tmpD->data[k * tmpD->ld + k] += shift;
-                } else {
-                    // Non-leaf node, assemble tmpU and tmpD from mid_U and mid_D
-                    // (1) Accumulate the dimension of each compressed child's diagonal block
-                    H2P_int_vec_set_capacity(tmpidx, node_n_child + 1);
-                    int *offset = tmpidx->data;
-                    offset[0] = 0;
-                    U_nrow = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        offset[k + 1] = offset[k] + D_mid[child_k]->nrow;
-                        U_nrow += D_mid[child_k]->nrow;
-                    }
-                    // (2) Build the compressed diagonal block
-                    // Build tmpD, we need tmpB and tmpM (same buffer as tmpU, so we build tmpU later)
-                    H2P_dense_mat_resize(tmpD, U_nrow, U_nrow);
-                    memset(tmpD->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        // idx_k = offset(k) : offset(k+1)-1;
-                        int idx_k_s = offset[k];
-                        int idx_k_len = offset[k + 1] - idx_k_s;
-                        // Diagonal blocks
-                        // tmpD(idx_k, idx_k) = D_mid{child_k};
-                        copy_matrix_block(
-                            sizeof(DTYPE), D_mid[child_k]->nrow, D_mid[child_k]->ncol, D_mid[child_k]->data, 
-                            D_mid[child_k]->ld, tmpD->data + idx_k_s * (tmpD->ld + 1), tmpD->ld
-                        );
-                        // Off-diagonal blocks
-                        for (int l = k + 1; l < node_n_child; l++)
-                        {
-                            int child_l = node_children[l];
-                            // idx_l = offset(l) : offset(l+1)-1;
-                            int idx_l_s = offset[l];
-                            int idx_l_len = offset[l + 1] - idx_l_s;
-                            // B_idx = B_pair2idx(child_k, child_l);
-                            H2P_get_Bij_block(h2pack, child_k, child_l, tmpB);
-                            // tmpD(idx_k, idx_l) = U_mid{child_k} * B{B_idx} * U_mid{child_l}';
-                            H2P_dense_mat_resize(tmpM, tmpB->nrow, U_mid[child_l]->nrow);
-                            CBLAS_GEMM(
-                                CblasRowMajor, CblasNoTrans, CblasTrans, tmpM->nrow, tmpM->ncol, tmpB->ncol,
-                                1.0, tmpB->data, tmpB->ld, U_mid[child_l]->data, U_mid[child_l]->ld, 
-                                0.0, tmpM->data, tmpM->ld
-                            );
-                            DTYPE *tmpD_kl = tmpD->data + idx_k_s * tmpD->ld + idx_l_s;
-                            DTYPE *tmpD_lk = tmpD->data + idx_l_s * tmpD->ld + idx_k_s;
-                            CBLAS_GEMM(
-                                CblasRowMajor, CblasNoTrans, CblasNoTrans, U_mid[child_k]->nrow, tmpM->ncol, tmpM->nrow,
-                                1.0, U_mid[child_k]->data, U_mid[child_k]->ld, tmpM->data, tmpM->ld, 
-                                0.0, tmpD_kl, tmpD->ld
-                            );
-                            // tmpD(idx_l, idx_k) = tmpD(idx_k, idx_l)';
-                            H2P_transpose_dmat(1, idx_k_len, idx_l_len, tmpD_kl, tmpD->ld, tmpD_lk, tmpD->ld);
-                        }
-                    }  // End of k loop
-                    // Build tmpU, now tmpM is no long used
-                    H2P_dense_mat_resize(tmpU, U_nrow, U_nrow);
-                    memset(tmpU->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        // idx_k = offset(k) : offset(k+1)-1;
-                        int idx_k_s = offset[k];
-                        // Diagonal blocks
-                        // tmpU(idx_k, idx_k) = U_mid{child_k};
-                        copy_matrix_block(
-                            sizeof(DTYPE), U_mid[child_k]->nrow, U_mid[child_k]->ncol, U_mid[child_k]->data, 
-                            U_mid[child_k]->ld, tmpU->data + idx_k_s * (tmpU->ld + 1), tmpU->ld
-                        );
-                    }  // End of k loop
-                    // if (level > 1), tmpU = tmpU * U{node}; end
-                    // tmpU (tmpM, mat0) and tmpD (mat1) are used, use tmpB (mat2) as buffer
-                    if (i > 0)
-                    {
-                        H2P_dense_mat_resize(tmpB, tmpU->nrow, U[node]->ncol);
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpB->nrow, tmpB->ncol, tmpU->ncol,
-                            1.0, tmpU->data, tmpU->ld, U[node]->data, U[node]->ld, 0.0, tmpB->data, tmpB->ld
-                        );
-                        H2P_dense_mat_resize(tmpU, tmpB->nrow, tmpB->ncol);
-                        copy_matrix_block(sizeof(DTYPE), tmpB->nrow, tmpB->ncol, tmpB->data, tmpB->ld, tmpU->data, tmpU->ld);
-                    }
-                }  // End of "if (node_n_child == 0)"
-                U_nrow = tmpU->nrow;
-                U_ncol = tmpU->ncol;
-                U_diff = U_nrow - U_ncol;
-                ASSERT_PRINTF(U_nrow >= U_ncol, "tmpU has more columns (%d) than rows (%d)!\n", U_ncol, U_nrow);
-
-                // 2. Cholesky factorization
-                // size(tmpU) = [U_nrow, U_ncol]
-                // size(tmpD) = [U_nrow, U_nrow]
-                // U_nrow >= U_ncol always holds
-                int info;
-                if (i > 0)
-                {
-                    H2P_dense_mat_init(&ULV_Q[node], U_nrow + 1, U_ncol);
-                    H2P_dense_mat_init(&U_mid[node], U_ncol, U_ncol);
-                    // [Q{node}, R] = qr(tmpU);
-                    copy_matrix_block(sizeof(DTYPE), U_nrow, U_ncol, tmpU->data, tmpU->ld, ULV_Q[node]->data, ULV_Q[node]->ld);
-                    DTYPE *A   = ULV_Q[node]->data;
-                    DTYPE *tau = ULV_Q[node]->data + U_nrow * U_ncol;
-                    info = LAPACK_GEQRF(LAPACK_ROW_MAJOR, U_nrow, U_ncol, A, U_ncol, tau);
-                    // U_mid{node} = R(1 : U_ncol, :);
-                    for (int k = 0; k < U_ncol; k++)
-                    {
-                        DTYPE *A_k = A + k * U_ncol;
-                        DTYPE *R_k = U_mid[node]->data + k * U_ncol;
-                        if (k > 0) memset(R_k, 0, sizeof(DTYPE) * k);
-                        memcpy(R_k + k, A_k + k, sizeof(DTYPE) * (U_ncol - k));
-                    }
-                    ULV_Ls[node] = U_ncol;
-                    // tmpD = Q{node}' * tmpD * Q{node};
-                    info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
-                    info = LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'R', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, tmpD->data, U_nrow);
-                    // tmpD11 = tmpD(1 : U_ncol, 1 : U_ncol);
-                    // tmpD21 = tmpD((U_ncol+1) : end, 1 : U_ncol);
-                    // tmpD22 = tmpD((U_ncol+1) : end, (U_ncol+1) : end);
-                    DTYPE *tmpD11 = tmpD->data;
-                    DTYPE *tmpD21 = tmpD->data + U_ncol * U_nrow;
-                    DTYPE *tmpD22 = tmpD->data + U_ncol * (U_nrow + 1);
-                    if (U_diff > 0)
-                    {
-                        // [tmpL, chol_flag] = chol(tmpD22, 'lower');
-                        // Here tmpL is stored in tmpD22
-                        info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', U_diff, tmpD22, U_nrow);
-                        for (int k = 0; k < U_diff - 1; k++)
-                        {
-                            DTYPE *tmpL_kk1 = tmpD22 + k * U_nrow + (k + 1);
-                            int n_zero_row = U_diff - 1 - k;
-                            memset(tmpL_kk1, 0, sizeof(DTYPE) * n_zero_row);
-                        }
-                        if (info != 0)
-                        {
-                            is_SPD = 0;
-                            ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
-                        }
-                        // logdet = logdet + 2 * log(abs(prod(diag(tmpL))));
-                        DTYPE prod = 1.0;
-                        for (int k = 0; k < U_diff; k++) prod *= tmpD22[k * U_nrow + k];
-                        #pragma omp atomic update
-                        HSS_logdet += 2.0 * DLOG(DABS(prod));
-                        // LD21 = tmpL \ tmpD21;
-                        // Here LD21 is stored in tmpD21
-                        CBLAS_TRSM(
-                            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
-                            U_diff, U_ncol, 1.0, tmpD22, U_nrow, tmpD21, U_nrow
-                        );
-                    }
-                    // L{node} = [eye(U_ncol), LD21'; zeros(U_diff, U_ncol), tmpL];
-                    H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
-                    for (int k = 0; k < U_ncol; k++)
-                    {
-                        DTYPE *L_k = ULV_L[node]->data + k * U_nrow;
-                        memset(L_k, 0, sizeof(DTYPE) * U_nrow);
-                        L_k[k] = 1.0;
-                    }
-                    if (U_diff > 0)
-                    {
-                        DTYPE *L12 = ULV_L[node]->data + U_ncol;
-                        DTYPE *L21 = ULV_L[node]->data + U_ncol * U_nrow;
-                        DTYPE *L22 = ULV_L[node]->data + U_ncol * (U_nrow + 1);
-                        H2P_transpose_dmat(1, U_diff, U_ncol, tmpD21, U_nrow, L12, U_nrow);
-                        for (int k = 0; k < U_diff; k++)
-                            memset(L21 + k * U_nrow, 0, sizeof(DTYPE) * U_ncol);
-                        copy_matrix_block(sizeof(DTYPE), U_diff, U_diff, tmpD22, U_nrow, L22, U_nrow);
-                    }
-                    // D_mid{node} = tmpD11 - LD21' * LD21;
-                    H2P_dense_mat_init(&D_mid[node], U_ncol, U_ncol);
-                    copy_matrix_block(sizeof(DTYPE), U_ncol, U_ncol, tmpD11, U_nrow, D_mid[node]->data, U_ncol);
-                    if (U_diff > 0)
-                    {
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasTrans, CblasNoTrans, U_ncol, U_ncol, U_diff,
-                            -1.0, tmpD21, U_nrow, tmpD21, U_nrow, 1.0, D_mid[node]->data, U_ncol
-                        );
-                    }
-                } else {  // Else of "if (i > 0)"
-                    // Q{node} = eye(size(tmpD)); 
-                    // We don't actually need Q{node} when node == root, just make a placeholder here
-                    H2P_dense_mat_init(&ULV_Q[node], 1, 1);
-                    H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
-                    ULV_Ls[node] = 0;
-                    // [L{node}, chol_flag] = chol(tmpD, 'lower');
-                    copy_matrix_block(sizeof(DTYPE), U_nrow, U_nrow, tmpD->data, U_nrow, ULV_L[node]->data, U_nrow);
-                    info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', U_nrow, ULV_L[node]->data, U_nrow);
-                    for (int k = 0; k < U_nrow; k++)
-                    {
-                        DTYPE *L_kk1 = ULV_L[node]->data + k * U_nrow + (k + 1);
-                        int n_zero_row = U_nrow - 1 - k;
-                        memset(L_kk1, 0, sizeof(DTYPE) * n_zero_row);
-                    }
-                    if (info != 0)
-                    {
-                        is_SPD = 0;
-                        ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
-                    }
-                    // logdet = logdet + 2 * log(abs(prod(diag(tmpL))));
-                    DTYPE prod = 1.0;
-                    for (int k = 0; k < U_nrow; k++) prod *= ULV_L[node]->data[k * U_nrow + k];
-                    #pragma omp atomic update
-                    HSS_logdet += 2.0 * DLOG(DABS(prod));
-                }  // End of "if (i > 0)"
-
-                // 3. Construct ULV_idx{node}, row indices where ULV_Q{node} and ULV_L{node} are applied to
-                if (!is_SPD) continue;
-                if (node_n_child == 0)
-                {
-                    int cluster_s   = mat_cluster[2 * node];
-                    int cluster_e   = mat_cluster[2 * node + 1];
-                    int cluster_len = cluster_e - cluster_s + 1;
-                    H2P_int_vec_init(&ULV_idx[node], cluster_len);
-                    for (int k = 0; k < cluster_len; k++)
-                        ULV_idx[node]->data[k] = cluster_s + k;
-                    ULV_idx[node]->length = cluster_len;
-                    ASSERT_PRINTF(
-                        ULV_idx[node]->length == ULV_L[node]->nrow, 
-                        "Node %d ULV_idx length %d mismatch ULV_L size %d", 
-                        node, ULV_idx[node]->length, ULV_L[node]->nrow
-                    );
-                } else {
-                    int idx_size = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        idx_size += D_mid[child_k]->nrow;
-                    }
-                    H2P_int_vec_init(&ULV_idx[node], idx_size);
-                    idx_size = 0;
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        for (int l = 0; l < D_mid[child_k]->nrow; l++)
-                            ULV_idx[node]->data[idx_size + l] = ULV_idx[child_k]->data[l];
-                        idx_size += D_mid[child_k]->nrow;
-                    }
-                    ULV_idx[node]->length = idx_size;
-                    ASSERT_PRINTF(
-                        ULV_idx[node]->length == ULV_L[node]->nrow, 
-                        "Node %d ULV_idx length %d mismatch ULV_L size %d", 
-                        node, ULV_idx[node]->length, ULV_L[node]->nrow
-                    );
-                }  // End of "if (node_n_child == 0)"
-
-                // 4. Free U_mid{child_k} and D_mid{child_k} since we no longer need them
-                if (node_n_child > 0)
-                {
-                    for (int k = 0; k < node_n_child; k++)
-                    {
-                        int child_k = node_children[k];
-                        H2P_dense_mat_destroy(&U_mid[child_k]);
-                        H2P_dense_mat_destroy(&D_mid[child_k]);
-                    }
-                }
-            }  // End of j loop
-        }  // End of "#pragma omp parallel"
+            int node = level_i_nodes[j];
+            H2P_HSS_ULV_Cholesky_factorize_node(
+                h2pack, node, shift, thread_buf[0], U_mid, D_mid, ULV_Ls, 
+                ULV_idx, ULV_Q, ULV_L, &HSS_logdet, &is_SPD
+            );
+        }
     }  // End of i loop
 
     // Free intermediate matrices and set the output matrices
@@ -977,47 +1348,122 @@ void H2P_HSS_ULV_Cholesky_factorize(H2Pack_p h2pack, const DTYPE shift)
     }
 }
 
-// Solve the linear system A_{HSS} * x = b using the HSS ULV Cholesky factorization
-void H2P_HSS_ULV_Cholesky_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x)
+// Apply the ULV Cholesky factors of a node to its rows of the right-hand side 
+// matrix in the up sweep, i.e., solve with L_{HSS}^T
+// Input parameters:
+//   I_size : Size of the identity block of the node's ULV_L, == ULV_Ls[node]
+//   L_size : Size of the Cholesky factor block of the node's ULV_L
+//   has_Q  : If the node's ULV_Q should be applied, == 0 for the root node
+//   n_vec  : Number of right-hand side vectors
+//   Q      : ULV_Q[node]->data, Householder vectors and tau
+//   L      : Size (I_size + L_size)^2, ULV_L[node]->data
+//   b0     : Size (I_size + L_size) * n_vec, row-major, the node's rows of the right-hand side
+// Output parameter:
+//   b0 : The node's rows of the solution
+void H2P_HSS_ULV_Cholesky_fwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const DTYPE *Q, const DTYPE *L, DTYPE *b0
+)
 {
-    if (!h2pack->is_HSS)
-    {
-        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
-        return;
-    }
-    if (h2pack->ULV_idx == NULL)
+    int L_nrow = I_size + L_size;
+    // b0 = Q{node}' * x(idx, :);
+    // If node is the root node, Q{node} = I, b0 = x(idx, :)
+    if (has_Q)
     {
-        ERROR_PRINTF("Need to call H2P_HSS_ULV_Cholesky_factorize() first!\n");
-        return;
+        const DTYPE *tau = Q + L_nrow * I_size;
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', L_nrow, n_vec, I_size, Q, I_size, tau, b0, n_vec);
     }
-    if (op < 1 || op > 3) 
+    // b1 = b0(1 : I_size, :);
+    // b2 = b0(I_size+1 : end, :);
+    DTYPE *b1 = b0;
+    DTYPE *b2 = b0 + I_size * n_vec;
+    // L12 = L{node}(1 : I_size, I_size+1 : end);
+    // L22 = L{node}(I_size+1 : end, I_size+1 : end);
+    const DTYPE *L12 = L + I_size;
+    const DTYPE *L22 = L + I_size * (L_nrow + 1);
+    // x2 = L22 \ b2;
+    DTYPE *x2 = b2;
+    CBLAS_TRSM(
+        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+        L_size, n_vec, 1.0, L22, L_nrow, b2, n_vec
+    );
+    // x1 = b1 - L12 * x2;
+    DTYPE *x1 = b1;
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, I_size, n_vec, L_size,
+        -1.0, L12, L_nrow, x2, n_vec, 1.0, x1, n_vec
+    );
+}
+
+// Apply the ULV Cholesky factors of a node to its rows of the right-hand side 
+// matrix in the down sweep, i.e., solve with L_{HSS}
+// Input parameters:
+//   I_size, L_size, has_Q, n_vec, Q, L, b0 : See H2P_HSS_ULV_Cholesky_fwd_node()
+// Output parameter:
+//   b0 : The node's rows of the solution
+void H2P_HSS_ULV_Cholesky_bwd_node(
+    const int I_size, const int L_size, const int has_Q, const int n_vec,
+    const DTYPE *Q, const DTYPE *L, DTYPE *b0
+)
+{
+    int L_nrow = I_size + L_size;
+    // b1 = b0(1 : I_size, :);
+    // b2 = b0(I_size+1 : end, :);
+    DTYPE *b1 = b0;
+    DTYPE *b2 = b0 + I_size * n_vec;
+    // L12 = L{node}(1 : I_size, I_size+1 : end);
+    // L22 = L{node}(I_size+1 : end, I_size+1 : end);
+    const DTYPE *L12 = L + I_size;
+    const DTYPE *L22 = L + I_size * (L_nrow + 1);
+    // b2 = b2 - L12' * b1;
+    CBLAS_GEMM(
+        CblasRowMajor, CblasTrans, CblasNoTrans, L_size, n_vec, I_size,
+        -1.0, L12, L_nrow, b1, n_vec, 1.0, b2, n_vec
+    );
+    // b2 = L22' \ b2;
+    CBLAS_TRSM(
+        CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit,
+        L_size, n_vec, 1.0, L22, L_nrow, b2, n_vec
+    );
+    // x(idx, :) = Q{node} * [b1; b2];
+    // If node is the root node, Q{node} = I, x(idx, :) = [b1; b2]
+    if (has_Q)
     {
-        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
-        return;
+        const DTYPE *tau = Q + L_nrow * I_size;
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'N', L_nrow, n_vec, I_size, Q, I_size, tau, b0, n_vec);
     }
+}
 
+// Solve A_{HSS} * X = B with HSS ULV Cholesky factorization in the sorted point ordering
+// Input parameters:
+//   h2pack : H2Pack structure with ULV Cholesky factorization
+//   op     : Operation type, 1, 2, or 3, see H2P_HSS_ULV_Cholesky_solve()
+//   n_vec  : Number of right-hand side vectors
+//   pmt_x  : Size h2pack->krnl_mat_size * n_vec, row-major right-hand side matrix B 
+//            with permuted rows, leading dimension n_vec
+// Output parameter:
+//   pmt_x  : Solution matrix X with permuted rows
+static void H2P_HSS_ULV_Cholesky_solve_pmt(H2Pack_p h2pack, const int op, const int n_vec, DTYPE *pmt_x)
+{
     int n_leaf_node   = h2pack->n_leaf_node;
     int max_level     = h2pack->max_level;
     int n_thread      = h2pack->n_thread;
     int *level_n_node = h2pack->level_n_node;
     int *level_nodes  = h2pack->level_nodes;
     int *ULV_Ls       = h2pack->ULV_Ls;
+    float **ULV_Q_fp32 = h2pack->ULV_Q_fp32;
+    float **ULV_L_fp32 = h2pack->ULV_L_fp32;
     H2P_int_vec_p    *ULV_idx = h2pack->ULV_idx;
     H2P_dense_mat_p  *ULV_Q   = h2pack->ULV_Q;
     H2P_dense_mat_p  *ULV_L   = h2pack->ULV_L;
     H2P_thread_buf_p *thread_buf = h2pack->tb;
-
-    double st = get_wtime_sec();
-
-    DTYPE *pmt_x = h2pack->pmt_x;
-    H2P_permute_vector_forward(h2pack, b, pmt_x);
-    //memcpy(x, b, sizeof(DTYPE) * h2pack->krnl_mat_size);
+    int fp32 = (ULV_Q_fp32 != NULL);
 
     int solve_LT = op & 1;
     if (solve_LT)
     {
         // Level by level up sweep
-        for (int i = max_level; i > 0; i--)
+        for (int i = max_level; i >= 0; i--)
         {
             int *level_i_nodes = level_nodes + i * n_leaf_node;
             int level_i_n_node = level_n_node[i];
@@ -1031,76 +1477,34 @@ void H2P_HSS_ULV_Cholesky_solve(H2Pack_p h2pack, const int op, const DTYPE *b, D
                 for (int j = 0; j < level_i_n_node; j++)
                 {
                     int node = level_i_nodes[j];
-                    H2P_int_vec_p   idx = ULV_idx[node];
-                    H2P_dense_mat_p Q   = ULV_Q[node];
-                    H2P_dense_mat_p L   = ULV_L[node];
+                    H2P_int_vec_p idx = ULV_idx[node];
                     int I_size = ULV_Ls[node];
-                    int L_size = L->nrow - I_size;
-                    // b0 = Q{node}' * x(idx);
-                    H2P_dense_mat_resize(x0, idx->length, 1);
-                    for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-                    DTYPE *b0  = x0->data;
-                    DTYPE *A   = Q->data;
-                    DTYPE *tau = Q->data + (Q->nrow - 1) * Q->ncol;
-                    LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', L->nrow, 1, Q->ncol, A, Q->ncol, tau, x0->data, 1);
-                    // b1 = b0(1 : I_size);
-                    // b2 = b0(I_size+1 : end);
-                    DTYPE *b1 = b0;
-                    DTYPE *b2 = b0 + I_size;
-                    // L12 = L{node}(1 : I_size, I_size+1 : end);
-                    // L22 = L{node}(I_size+1 : end, I_size+1 : end);
-                    DTYPE *L12 = L->data + I_size;
-                    DTYPE *L22 = L->data + I_size * (L->ld + 1);
-                    // x2 = L22 \ b2;
-                    DTYPE *x2 = b2;
-                    CBLAS_TRSM(
-                        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
-                        L_size, 1, 1.0, L22, L->ld, b2, 1
-                    );
-                    // x1 = b1 - L12 * x2;
-                    DTYPE *x1 = b1;
-                    CBLAS_GEMV(
-                        CblasRowMajor, CblasNoTrans, I_size, L_size, 
-                        -1.0, L12, L->ld, x2, 1, 1.0, x1, 1
-                    );
-                    // x(idx) = [x1; x2];
-                    for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
+                    int L_size = ULV_L[node]->nrow - I_size;
+                    H2P_dense_mat_resize(x0, idx->length, n_vec);
+                    H2P_HSS_ULV_gather_rows(n_vec, idx, pmt_x, fp32, x0->data);
+                    if (fp32)
+                    {
+                        H2P_s_HSS_ULV_Cholesky_fwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q_fp32[node], 
+                            ULV_L_fp32[node], (float*) x0->data
+                        );
+                    } else {
+                        H2P_HSS_ULV_Cholesky_fwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q[node]->data, 
+                            ULV_L[node]->data, x0->data
+                        );
+                    }
+                    H2P_HSS_ULV_scatter_rows(n_vec, idx, x0->data, fp32, pmt_x);
                 }  // End of j loop
             }  // End of "#pragma omp parallel"
         }  // End of i loop 
-
-        // Root node, x(idx) = L{node} \ x(idx);
-        int node = level_nodes[0];
-        H2P_int_vec_p   idx = ULV_idx[node];
-        H2P_dense_mat_p L   = ULV_L[node];
-        H2P_dense_mat_p x0  = thread_buf[0]->mat0;
-        H2P_dense_mat_resize(x0, idx->length, 1);
-        for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-        CBLAS_TRSM(
-            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
-            L->nrow, 1, 1.0, L->data, L->ld, x0->data, 1
-        );
-        for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
     }  // End of "if (solve_LT)"
 
     int solve_L = op & 2;
     if (solve_L)
     {
-        // Root node, x(idx) = L{node}' \ x(idx);
-        int node = level_nodes[0];
-        H2P_int_vec_p   idx = ULV_idx[node];
-        H2P_dense_mat_p L   = ULV_L[node];
-        H2P_dense_mat_p x0  = thread_buf[0]->mat0;
-        H2P_dense_mat_resize(x0, idx->length, 1);
-        for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-        CBLAS_TRSM(
-            CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit,
-            L->nrow, 1, 1.0, L->data, L->ld, x0->data, 1
-        );
-        for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
-
         // Level by level down sweep
-        for (int i = 1; i <= max_level; i++)
+        for (int i = 0; i <= max_level; i++)
         {
             int *level_i_nodes = level_nodes + i * n_leaf_node;
             int level_i_n_node = level_n_node[i];
@@ -1114,46 +1518,274 @@ void H2P_HSS_ULV_Cholesky_solve(H2Pack_p h2pack, const int op, const DTYPE *b, D
                 for (int j = 0; j < level_i_n_node; j++)
                 {
                     int node = level_i_nodes[j];
-                    H2P_int_vec_p   idx = ULV_idx[node];
-                    H2P_dense_mat_p Q   = ULV_Q[node];
-                    H2P_dense_mat_p L   = ULV_L[node];
+                    H2P_int_vec_p idx = ULV_idx[node];
                     int I_size = ULV_Ls[node];
-                    int L_size = L->nrow - I_size;
-                    // b0 = x(idx);
-                    // b1 = b0(1 : I_size);
-                    // b2 = b0(I_size+1 : end);
-                    H2P_dense_mat_resize(x0, idx->length, 1);
-                    for (int k = 0; k < idx->length; k++) x0->data[k] = pmt_x[idx->data[k]];
-                    DTYPE *b0 = x0->data;
-                    DTYPE *b1 = b0;
-                    DTYPE *b2 = b0 + I_size;
-                    // L12 = L{node}(1 : I_size, I_size+1 : end);
-                    // L22 = L{node}(I_size+1 : end, I_size+1 : end);
-                    DTYPE *L12 = L->data + I_size;
-                    DTYPE *L22 = L->data + I_size * (L->ld + 1);
-                    // b2 = b2 - L12' * b1;
-                    CBLAS_GEMV(
-                        CblasRowMajor, CblasTrans, I_size, L_size,
-                        -1.0, L12, L->ld, b1, 1, 1.0, b2, 1
-                    );
-                    // b2 = L22' \ b2;
-                    CBLAS_TRSM(
-                        CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit,
-                        L_size, 1, 1.0, L22, L->ld, b2, 1
-                    );
-                    // x(idx) = Q{node} * [b1; b2];
-                    DTYPE *A   = Q->data;
-                    DTYPE *tau = Q->data + (Q->nrow - 1) * Q->ncol;
-                    LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'N', L->nrow, 1, Q->ncol, A, Q->ncol, tau, x0->data, 1);
-                    for (int k = 0; k < idx->length; k++) pmt_x[idx->data[k]] = x0->data[k];
+                    int L_size = ULV_L[node]->nrow - I_size;
+                    H2P_dense_mat_resize(x0, idx->length, n_vec);
+                    H2P_HSS_ULV_gather_rows(n_vec, idx, pmt_x, fp32, x0->data);
+                    if (fp32)
+                    {
+                        H2P_s_HSS_ULV_Cholesky_bwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q_fp32[node], 
+                            ULV_L_fp32[node], (float*) x0->data
+                        );
+                    } else {
+                        H2P_HSS_ULV_Cholesky_bwd_node(
+                            I_size, L_size, i > 0, n_vec, ULV_Q[node]->data, 
+                            ULV_L[node]->data, x0->data
+                        );
+                    }
+                    H2P_HSS_ULV_scatter_rows(n_vec, idx, x0->data, fp32, pmt_x);
                 }  // End of j loop
             }  // End of "#pragma omp parallel"
         }  // End of i loop 
     }  // End of "if (solve_L)"
+}
+
+// Solve the linear system A_{HSS} * x = b using the HSS ULV Cholesky factorization
+void H2P_HSS_ULV_Cholesky_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x)
+{
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return;
+    }
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return;
+    }
+    if (op < 1 || op > 3) 
+    {
+        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
+        return;
+    }
+
+    double st = get_wtime_sec();
 
+    DTYPE *pmt_x = h2pack->pmt_x;
+    H2P_permute_vector_forward(h2pack, b, pmt_x);
+    H2P_HSS_ULV_Cholesky_solve_pmt(h2pack, op, 1, pmt_x);
     H2P_permute_vector_backward(h2pack, pmt_x, x);
 
     double et = get_wtime_sec();
     h2pack->n_ULV_solve++;
     h2pack->timers[ULV_SLV_TIMER_IDX] += et - st;
 }
+
+// Solve A_{HSS} * X = B with multiple right-hand sides using the HSS ULV LU 
+// (is_LU == 1) or Cholesky (is_LU == 0) factorization, see H2P_HSS_ULV_LU_matsolve()
+static void H2P_HSS_ULV_matsolve(
+    H2Pack_p h2pack, const int is_LU, const int op, const CBLAS_LAYOUT layout, 
+    const int n_vec, const DTYPE *mat_b, const int ldb, DTYPE *mat_x, const int ldx
+)
+{
+    int krnl_mat_size = h2pack->krnl_mat_size;
+    int mm_max_n_vec  = h2pack->mm_max_n_vec;
+    int n_thread      = h2pack->n_thread;
+
+    double st = get_wtime_sec();
+
+    size_t pmt_xy_size = (size_t) krnl_mat_size * (size_t) mm_max_n_vec;
+    free(h2pack->pmt_x);
+    free(h2pack->pmt_y);
+    h2pack->pmt_x = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    h2pack->pmt_y = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    ASSERT_PRINTF(
+        h2pack->pmt_x != NULL && h2pack->pmt_y != NULL,
+        "Failed to allocate working arrays of size %zu for ULV solve\n", 2 * pmt_xy_size
+    );
+    DTYPE *pmt_x = h2pack->pmt_x;
+    DTYPE *pmt_y = h2pack->pmt_y;
+
+    int b_col_stride = (layout == CblasRowMajor) ? 1 : ldb;
+    int x_col_stride = (layout == CblasRowMajor) ? 1 : ldx;
+    for (int i_vec = 0; i_vec < n_vec; i_vec += mm_max_n_vec)
+    {
+        int curr_n_vec = (i_vec + mm_max_n_vec <= n_vec) ? mm_max_n_vec : (n_vec - i_vec);
+        const DTYPE *curr_mat_b = mat_b + i_vec * b_col_stride;
+        DTYPE *curr_mat_x = mat_x + i_vec * x_col_stride;
+
+        // 1. Forward permute the right-hand side block, the ULV sweeps work on a row-major block
+        if (layout == CblasRowMajor)
+        {
+            H2P_permute_matrix_row_forward(h2pack, layout, curr_n_vec, curr_mat_b, ldb, pmt_x, curr_n_vec);
+        } else {
+            H2P_permute_matrix_row_forward(h2pack, layout, curr_n_vec, curr_mat_b, ldb, pmt_y, krnl_mat_size);
+            H2P_transpose_dmat(n_thread, curr_n_vec, krnl_mat_size, pmt_y, krnl_mat_size, pmt_x, curr_n_vec);
+        }
+
+        // 2. Apply each node's ULV_Q and ULV_L to all right-hand sides in one tree traversal
+        if (is_LU) H2P_HSS_ULV_LU_solve_pmt(h2pack, op, curr_n_vec, pmt_x);
+        else H2P_HSS_ULV_Cholesky_solve_pmt(h2pack, op, curr_n_vec, pmt_x);
+
+        // 3. Backward permute the solution block
+        if (layout == CblasRowMajor)
+        {
+            H2P_permute_matrix_row_backward(h2pack, layout, curr_n_vec, pmt_x, curr_n_vec, curr_mat_x, ldx);
+        } else {
+            H2P_transpose_dmat(n_thread, krnl_mat_size, curr_n_vec, pmt_x, curr_n_vec, pmt_y, krnl_mat_size);
+            H2P_permute_matrix_row_backward(h2pack, layout, curr_n_vec, pmt_y, krnl_mat_size, curr_mat_x, ldx);
+        }
+    }  // End of i_vec loop
+
+    double et = get_wtime_sec();
+    h2pack->n_ULV_solve += n_vec;
+    h2pack->timers[ULV_SLV_TIMER_IDX] += et - st;
+}
+
+// Solve the linear system A_{HSS} * X = B with multiple right-hand sides 
+// using the HSS ULV LU factorization
+void H2P_HSS_ULV_LU_matsolve(
+    H2Pack_p h2pack, const int op, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_b, const int ldb, DTYPE *mat_x, const int ldx
+)
+{
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return;
+    }
+    if (h2pack->ULV_idx == NULL || h2pack->ULV_p == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() first!\n");
+        return;
+    }
+    if (op < 1 || op > 3) 
+    {
+        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
+        return;
+    }
+    H2P_HSS_ULV_matsolve(h2pack, 1, op, layout, n_vec, mat_b, ldb, mat_x, ldx);
+}
+
+// Solve the linear system A_{HSS} * X = B with multiple right-hand sides 
+// using the HSS ULV Cholesky factorization
+void H2P_HSS_ULV_Cholesky_matsolve(
+    H2Pack_p h2pack, const int op, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_b, const int ldb, DTYPE *mat_x, const int ldx
+)
+{
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return;
+    }
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return;
+    }
+    if (op < 1 || op > 3) 
+    {
+        ERROR_PRINTF("Invalid operation type %d, should be 1, 2, or 3\n", op);
+        return;
+    }
+    H2P_HSS_ULV_matsolve(h2pack, 0, op, layout, n_vec, mat_b, ldb, mat_x, ldx);
+}
+
+// Convert the HSS ULV factors to float to halve their memory footprint
+void H2P_HSS_ULV_to_float(H2Pack_p h2pack)
+{
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() or H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return;
+    }
+    if (h2pack->ULV_Q_fp32 != NULL) return;
+
+    int n_node = h2pack->n_node;
+    H2P_dense_mat_p *ULV_Q = h2pack->ULV_Q;
+    H2P_dense_mat_p *ULV_L = h2pack->ULV_L;
+    float **ULV_Q_fp32 = (float**) malloc(sizeof(float*) * n_node);
+    float **ULV_L_fp32 = (float**) malloc(sizeof(float*) * n_node);
+    ASSERT_PRINTF(
+        ULV_Q_fp32 != NULL && ULV_L_fp32 != NULL, 
+        "Failed to allocate float ULV factor arrays\n"
+    );
+
+    #pragma omp parallel for num_threads(h2pack->n_thread) schedule(dynamic)
+    for (int node = 0; node < n_node; node++)
+    {
+        H2P_dense_mat_p Q = ULV_Q[node];
+        H2P_dense_mat_p L = ULV_L[node];
+        size_t Q_size = (size_t) Q->nrow * (size_t) Q->ncol;
+        size_t L_size = (size_t) L->nrow * (size_t) L->ld;
+        float *Q_fp32 = (float*) malloc_aligned(sizeof(float) * MAX(Q_size, 1), 64);
+        float *L_fp32 = (float*) malloc_aligned(sizeof(float) * MAX(L_size, 1), 64);
+        ASSERT_PRINTF(
+            Q_fp32 != NULL && L_fp32 != NULL, 
+            "Failed to allocate float ULV factors of node %d\n", node
+        );
+        for (size_t k = 0; k < Q_size; k++) Q_fp32[k] = (float) Q->data[k];
+        for (size_t k = 0; k < L_size; k++) L_fp32[k] = (float) L->data[k];
+        // Keep the sizes of ULV_Q[node] and ULV_L[node], only release the data
+        free_aligned(Q->data);
+        free_aligned(L->data);
+        Q->data = NULL;
+        L->data = NULL;
+        ULV_Q_fp32[node] = Q_fp32;
+        ULV_L_fp32[node] = L_fp32;
+    }
+    h2pack->ULV_Q_fp32 = ULV_Q_fp32;
+    h2pack->ULV_L_fp32 = ULV_L_fp32;
+
+    double size_ratio = (double) sizeof(float) / (double) sizeof(DTYPE);
+    h2pack->mat_size[ULV_Q_SIZE_IDX] = (size_t) ((double) h2pack->mat_size[ULV_Q_SIZE_IDX] * size_ratio);
+    h2pack->mat_size[ULV_L_SIZE_IDX] = (size_t) ((double) h2pack->mat_size[ULV_L_SIZE_IDX] * size_ratio);
+}
+
+// Solve (A + shift * I) * x = b with the HSS ULV factorization as a 
+// preconditioner and iterative refinement
+int H2P_HSS_ULV_solve_refine(
+    H2Pack_p hssmat, H2Pack_p Amat, const DTYPE shift, const int max_iter, 
+    const DTYPE rel_tol, const DTYPE *b, DTYPE *x, DTYPE *relres_
+)
+{
+    if (hssmat->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() or H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return -1;
+    }
+    if (Amat->krnl_mat_size != hssmat->krnl_mat_size)
+    {
+        ERROR_PRINTF("Amat size %d != hssmat size %d\n", Amat->krnl_mat_size, hssmat->krnl_mat_size);
+        return -1;
+    }
+
+    int   n     = hssmat->krnl_mat_size;
+    int   is_LU = (hssmat->ULV_p != NULL);
+    DTYPE *r    = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    DTYPE *dx   = (DTYPE*) malloc(sizeof(DTYPE) * n);
+    ASSERT_PRINTF(r != NULL && dx != NULL, "Failed to allocate iterative refinement buffers\n");
+
+    DTYPE b_2norm = CBLAS_NRM2(n, b, 1);
+    if (b_2norm == 0.0) b_2norm = 1.0;
+
+    // x = (A_{HSS} + shift * I) \ b;
+    if (is_LU) H2P_HSS_ULV_LU_solve(hssmat, 3, b, x);
+    else H2P_HSS_ULV_Cholesky_solve(hssmat, 3, b, x);
+
+    int iter = 0;
+    DTYPE relres = 1.0;
+    while (1)
+    {
+        // r = b - (A + shift * I) * x;
+        H2P_matvec(Amat, x, r);
+        #pragma omp simd
+        for (int i = 0; i < n; i++) r[i] = b[i] - r[i] - shift * x[i];
+        relres = CBLAS_NRM2(n, r, 1) / b_2norm;
+        if (relres <= rel_tol || iter >= max_iter) break;
+        // x = x + (A_{HSS} + shift * I) \ r;
+        if (is_LU) H2P_HSS_ULV_LU_solve(hssmat, 3, r, dx);
+        else H2P_HSS_ULV_Cholesky_solve(hssmat, 3, r, dx);
+        #pragma omp simd
+        for (int i = 0; i < n; i++) x[i] += dx[i];
+        iter++;
+    }
+
+    if (relres_ != NULL) *relres_ = relres;
+    free(r);
+    free(dx);
+    return iter;
+}
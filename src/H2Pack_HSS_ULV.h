@@ -29,6 +29,28 @@ void H2P_HSS_ULV_LU_factorize(H2Pack_p h2pack, const DTYPE shift);
 //       If op == 3, x satisfies A_{HSS} * x = b.
 void H2P_HSS_ULV_LU_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x);
 
+// Solve the linear system A_{HSS} * X = B with multiple right-hand sides using 
+// the HSS ULV LU factorization. All right-hand sides are solved in one traversal 
+// of the HSS tree with BLAS-3 operations.
+// Input parameters:
+//   h2pack : H2Pack structure with ULV LU factorization
+//   op     : Operation type, 1, 2, or 3, see H2P_HSS_ULV_LU_solve()
+//   layout : CblasRowMajor/CblasColMajor if mat_b & mat_x are stored in row/column-major style
+//   n_vec  : Number of right-hand side vectors
+//   mat_b  : Size >= h2pack->krnl_mat_size * ldb if layout == CblasRowMajor, 
+//            size >=                 n_vec * ldb if layout == CblasColMajor, 
+//            right-hand side matrix, the leading h2pack->krnl_mat_size-by-n_vec 
+//            part of mat_b will be used
+//   ldb    : Leading dimension of mat_b, must >= n_vec if layout == CblasRowMajor,
+//            must >= h2pack->krnl_mat_size if layout == CblasColMajor
+//   ldx    : Leading dimension of mat_x, the same requirement of ldb
+// Output parameter:
+//   mat_x : Size is the same as mat_b, solution matrix
+void H2P_HSS_ULV_LU_matsolve(
+    H2Pack_p h2pack, const int op, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_b, const int ldb, DTYPE *mat_x, const int ldx
+);
+
 // Construct the ULV Cholesky factorization for a HSS matrix
 // Input parameters:
 //   h2pack : H2Pack structure with constructed HSS representation
@@ -50,6 +72,54 @@ void H2P_HSS_ULV_Cholesky_factorize(H2Pack_p h2pack, const DTYPE shift);
 //       If op == 3, x satisfies A_{HSS}   * x = b.
 void H2P_HSS_ULV_Cholesky_solve(H2Pack_p h2pack, const int op, const DTYPE *b, DTYPE *x);
 
+// Solve the linear system A_{HSS} * X = B with multiple right-hand sides using 
+// the HSS ULV Cholesky factorization, see H2P_HSS_ULV_LU_matsolve() for parameters 
+// and H2P_HSS_ULV_Cholesky_solve() for op
+void H2P_HSS_ULV_Cholesky_matsolve(
+    H2Pack_p h2pack, const int op, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_b, const int ldb, DTYPE *mat_x, const int ldx
+);
+
+// Release the HSS ULV factorization stored in a H2Pack structure. 
+// H2P_HSS_ULV_LU_factorize() and H2P_HSS_ULV_Cholesky_factorize() call it 
+// before computing a new factorization.
+// Input parameter:
+//   h2pack : H2Pack structure
+// Output parameter:
+//   h2pack : H2Pack structure without ULV factorization
+void H2P_HSS_ULV_free(H2Pack_p h2pack);
+
+// Convert the HSS ULV LU or Cholesky factors to float. The ULV solve functions 
+// apply float factors to float copies of the right-hand side and return DTYPE 
+// solutions. Use H2P_HSS_ULV_solve_refine() to recover DTYPE accuracy.
+// Input parameter:
+//   h2pack : H2Pack structure with ULV LU or Cholesky factorization
+// Output parameter:
+//   h2pack : H2Pack structure with ULV factors stored in h2pack->ULV_Q_fp32 and 
+//            h2pack->ULV_L_fp32, h2pack->ULV_Q[i]->data and h2pack->ULV_L[i]->data 
+//            are released
+void H2P_HSS_ULV_to_float(H2Pack_p h2pack);
+
+// Solve the linear system (A + shift * I) * x = b with iterative refinement, 
+// using the HSS ULV factorization as the inner solver
+// Input parameters:
+//   hssmat   : H2Pack structure with ULV LU or Cholesky factorization of an HSS 
+//              approximation of (A + shift * I), factors can be stored in float
+//   Amat     : H2Pack structure of A used for computing residuals, can be hssmat 
+//              or a more accurate H2 matrix of the same kernel and points
+//   shift    : Diagonal shift of A
+//   max_iter : Maximum number of refinement steps
+//   rel_tol  : Stop when ||b - (A + shift * I) * x||_2 <= rel_tol * ||b||_2
+//   b        : Size >= hssmat->krnl_mat_size, right-hand side vector
+// Output parameters:
+//   x       : Size >= hssmat->krnl_mat_size, solution vector
+//   relres_ : Final relative residual 2-norm, can be NULL
+//   <return>: Number of refinement steps performed, -1 if input is invalid
+int H2P_HSS_ULV_solve_refine(
+    H2Pack_p hssmat, H2Pack_p Amat, const DTYPE shift, const int max_iter, 
+    const DTYPE rel_tol, const DTYPE *b, DTYPE *x, DTYPE *relres_
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "utils.h"
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_utils.h"
+#include "H2Pack_HSS_ULV.h"
+#include "H2Pack_HSS_ULV_mshift.h"
+
+// Compute the shift-independent parts of a node in the HSS ULV Cholesky
+// factorization, all its children should have been processed
+// Input parameters:
+//   h2pack : H2Pack structure with constructed HSS representation
+//   node   : Target node
+//   tb     : Thread buffer of the calling thread
+//   R      : Size n_node, R factors of the QR of processed nodes' compressed U
+// Output parameters:
+//   R        : R[node] is computed, those of node's children are freed
+//   ULV_Ls, ULV_idx, ULV_Q : ULV_Ls[node], ULV_idx[node], and ULV_Q[node] are computed
+//   D0       : D0[node] is computed. For a leaf node, D0 = Q{node}' * D{node} * Q{node}.
+//              For a non-leaf node, D0 = Q{node}' * C * Q{node}, where C is the
+//              compressed off-diagonal coupling blocks of its children (Q{root} = I).
+//   Qx       : Qx[node] = Q{node} is computed if node is a non-leaf non-root node
+static void H2P_HSS_ULV_mshift_init_node(
+    H2Pack_p h2pack, const int node, H2P_thread_buf_p tb, H2P_dense_mat_p *R, int *ULV_Ls, 
+    H2P_int_vec_p *ULV_idx, H2P_dense_mat_p *ULV_Q, H2P_dense_mat_p *D0, H2P_dense_mat_p *Qx
+)
+{
+    int max_child       = h2pack->max_child;
+    int level           = h2pack->node_level[node];
+    int *children       = h2pack->children;
+    int *n_child        = h2pack->n_child;
+    int *mat_cluster    = h2pack->mat_cluster;
+    H2P_dense_mat_p *U  = h2pack->U;
+    H2P_dense_mat_p tmpU = tb->mat0;
+    H2P_dense_mat_p tmpB = tb->mat1;
+    H2P_dense_mat_p tmpM = tb->mat2;
+
+    int node_n_child = n_child[node];
+    int *node_children = children + node * max_child;
+    // 1. Construct tmpU, D0 before transformation, and ULV_idx{node}
+    if (node_n_child == 0)
+    {
+        // Leaf node, use the original U and D
+        H2P_dense_mat_resize(tmpU, U[node]->nrow, U[node]->ncol);
+        copy_matrix_block(sizeof(DTYPE), U[node]->nrow, U[node]->ncol, U[node]->data, U[node]->ld, tmpU->data, tmpU->ld);
+        H2P_dense_mat_init(&D0[node], U[node]->nrow, U[node]->nrow);
+        H2P_get_Dij_block(h2pack, node, node, D0[node]);
+        int cluster_s   = mat_cluster[2 * node];
+        int cluster_len = mat_cluster[2 * node + 1] - cluster_s + 1;
+        H2P_int_vec_init(&ULV_idx[node], cluster_len);
+        for (int k = 0; k < cluster_len; k++)
+            ULV_idx[node]->data[k] = cluster_s + k;
+        ULV_idx[node]->length = cluster_len;
+    } else {
+        // Non-leaf node, each child is compressed to R{child_k} of size ULV_Ls{child_k}
+        int U_nrow = 0;
+        for (int k = 0; k < node_n_child; k++) U_nrow += ULV_Ls[node_children[k]];
+        // C(idx_k, idx_l) = R{child_k} * B{child_k, child_l} * R{child_l}';
+        H2P_dense_mat_init(&D0[node], U_nrow, U_nrow);
+        H2P_dense_mat_p C = D0[node];
+        memset(C->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        H2P_dense_mat_resize(tmpU, U_nrow, U_nrow);
+        memset(tmpU->data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        H2P_int_vec_init(&ULV_idx[node], U_nrow);
+        int idx_k_s = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k   = node_children[k];
+            int idx_k_len = ULV_Ls[child_k];
+            int idx_l_s   = idx_k_s + idx_k_len;
+            for (int l = k + 1; l < node_n_child; l++)
+            {
+                int child_l   = node_children[l];
+                int idx_l_len = ULV_Ls[child_l];
+                H2P_get_Bij_block(h2pack, child_k, child_l, tmpB);
+                H2P_dense_mat_resize(tmpM, tmpB->nrow, R[child_l]->nrow);
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasTrans, tmpM->nrow, tmpM->ncol, tmpB->ncol,
+                    1.0, tmpB->data, tmpB->ld, R[child_l]->data, R[child_l]->ld,
+                    0.0, tmpM->data, tmpM->ld
+                );
+                DTYPE *C_kl = C->data + idx_k_s * C->ld + idx_l_s;
+                DTYPE *C_lk = C->data + idx_l_s * C->ld + idx_k_s;
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasNoTrans, idx_k_len, tmpM->ncol, tmpM->nrow,
+                    1.0, R[child_k]->data, R[child_k]->ld, tmpM->data, tmpM->ld,
+                    0.0, C_kl, C->ld
+                );
+                H2P_transpose_dmat(1, idx_k_len, idx_l_len, C_kl, C->ld, C_lk, C->ld);
+                idx_l_s += idx_l_len;
+            }
+            // tmpU(idx_k, idx_k) = R{child_k};
+            copy_matrix_block(
+                sizeof(DTYPE), idx_k_len, idx_k_len, R[child_k]->data, R[child_k]->ld,
+                tmpU->data + idx_k_s * (tmpU->ld + 1), tmpU->ld
+            );
+            memcpy(ULV_idx[node]->data + idx_k_s, ULV_idx[child_k]->data, sizeof(int) * idx_k_len);
+            idx_k_s += idx_k_len;
+        }  // End of k loop
+        ULV_idx[node]->length = U_nrow;
+        // if (level > 0), tmpU = tmpU * U{node}; end
+        if (level > 0)
+        {
+            H2P_dense_mat_resize(tmpB, tmpU->nrow, U[node]->ncol);
+            CBLAS_GEMM(
+                CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpB->nrow, tmpB->ncol, tmpU->ncol,
+                1.0, tmpU->data, tmpU->ld, U[node]->data, U[node]->ld, 0.0, tmpB->data, tmpB->ld
+            );
+            H2P_dense_mat_copy(tmpB, tmpU);
+        }
+        for (int k = 0; k < node_n_child; k++)
+            H2P_dense_mat_destroy(&R[node_children[k]]);
+    }  // End of "if (node_n_child == 0)"
+
+    // 2. [Q{node}, R{node}] = qr(tmpU); D0 = Q{node}' * D0 * Q{node};
+    if (level > 0)
+    {
+        int U_nrow = tmpU->nrow;
+        int U_ncol = tmpU->ncol;
+        ASSERT_PRINTF(U_nrow >= U_ncol, "tmpU has more columns (%d) than rows (%d)!\n", U_ncol, U_nrow);
+        H2P_dense_mat_init(&ULV_Q[node], U_nrow + 1, U_ncol);
+        H2P_dense_mat_init(&R[node], U_ncol, U_ncol);
+        copy_matrix_block(sizeof(DTYPE), U_nrow, U_ncol, tmpU->data, tmpU->ld, ULV_Q[node]->data, ULV_Q[node]->ld);
+        DTYPE *A   = ULV_Q[node]->data;
+        DTYPE *tau = ULV_Q[node]->data + U_nrow * U_ncol;
+        LAPACK_GEQRF(LAPACK_ROW_MAJOR, U_nrow, U_ncol, A, U_ncol, tau);
+        for (int k = 0; k < U_ncol; k++)
+        {
+            DTYPE *A_k = A + k * U_ncol;
+            DTYPE *R_k = R[node]->data + k * U_ncol;
+            if (k > 0) memset(R_k, 0, sizeof(DTYPE) * k);
+            memcpy(R_k + k, A_k + k, sizeof(DTYPE) * (U_ncol - k));
+        }
+        ULV_Ls[node] = U_ncol;
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'T', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, D0[node]->data, U_nrow);
+        LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'R', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, D0[node]->data, U_nrow);
+        // Q{node}' * blkdiag(D_mid{children}) * Q{node} is computed with GEMM 
+        // in each shift, which is much faster than two ORMQR on a full matrix
+        if (node_n_child > 0)
+        {
+            H2P_dense_mat_init(&Qx[node], U_nrow, U_nrow);
+            DTYPE *Qx_data = Qx[node]->data;
+            memset(Qx_data, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+            for (int k = 0; k < U_nrow; k++) Qx_data[k * U_nrow + k] = 1.0;
+            LAPACK_ORMQR(LAPACK_ROW_MAJOR, 'L', 'N', U_nrow, U_nrow, U_ncol, A, U_ncol, tau, Qx_data, U_nrow);
+        }
+    } else {
+        // Q{root} = I, just make a placeholder here
+        H2P_dense_mat_init(&ULV_Q[node], 1, 1);
+        ULV_Ls[node] = 0;
+    }
+}
+
+// Precompute the shift-independent parts of the HSS ULV Cholesky factorization
+void H2P_HSS_ULV_mshift_init(H2Pack_p h2pack, H2P_HSS_ULV_mshift_p *mshift_)
+{
+    *mshift_ = NULL;
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return;
+    }
+
+    int n_node        = h2pack->n_node;
+    int n_thread      = h2pack->n_thread;
+    int n_leaf_node   = h2pack->n_leaf_node;
+    int max_level     = h2pack->max_level;
+    int *level_n_node = h2pack->level_n_node;
+    int *level_nodes  = h2pack->level_nodes;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    H2P_HSS_ULV_mshift_p mshift = (H2P_HSS_ULV_mshift_p) malloc(sizeof(H2P_HSS_ULV_mshift_s));
+    ASSERT_PRINTF(mshift != NULL, "Failed to allocate H2P_HSS_ULV_mshift structure\n");
+    mshift->n_node  = n_node;
+    mshift->ULV_Ls  = (int*)             malloc(sizeof(int) * n_node);
+    mshift->ULV_idx = (H2P_int_vec_p*)   calloc(n_node, sizeof(H2P_int_vec_p));
+    mshift->ULV_Q   = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    mshift->D0      = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    mshift->Qx      = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    H2P_dense_mat_p *R = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    ASSERT_PRINTF(
+        mshift->ULV_Ls != NULL && mshift->ULV_idx != NULL && mshift->ULV_Q != NULL &&
+        mshift->D0 != NULL && mshift->Qx != NULL && R != NULL, "Failed to allocate HSS ULV multi-shift arrays\n"
+    );
+
+    // Bottom-up level by level, nodes on the same level are independent
+    for (int i = max_level; i >= 0; i--)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int level_i_n_node = level_n_node[i];
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+        #pragma omp parallel num_threads(n_thread_i)
+        {
+            int tid = omp_get_thread_num();
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < level_i_n_node; j++)
+            {
+                int node = level_i_nodes[j];
+                H2P_HSS_ULV_mshift_init_node(
+                    h2pack, node, thread_buf[tid], R, mshift->ULV_Ls,
+                    mshift->ULV_idx, mshift->ULV_Q, mshift->D0, mshift->Qx
+                );
+            }
+        }
+    }
+
+    mshift->mem_size = 0;
+    for (int i = 0; i < n_node; i++)
+    {
+        H2P_dense_mat_destroy(&R[i]);
+        mshift->mem_size += mshift->ULV_Q[i]->nrow * mshift->ULV_Q[i]->ncol;
+        mshift->mem_size += mshift->D0[i]->nrow * mshift->D0[i]->ncol;
+        if (mshift->Qx[i] != NULL) mshift->mem_size += mshift->Qx[i]->nrow * mshift->Qx[i]->ncol;
+    }
+    free(R);
+    *mshift_ = mshift;
+}
+
+// Destroy a H2P_HSS_ULV_mshift structure
+void H2P_HSS_ULV_mshift_destroy(H2P_HSS_ULV_mshift_p *mshift_)
+{
+    H2P_HSS_ULV_mshift_p mshift = *mshift_;
+    if (mshift == NULL) return;
+    for (int i = 0; i < mshift->n_node; i++)
+    {
+        H2P_int_vec_destroy(&mshift->ULV_idx[i]);
+        H2P_dense_mat_destroy(&mshift->ULV_Q[i]);
+        H2P_dense_mat_destroy(&mshift->D0[i]);
+        H2P_dense_mat_destroy(&mshift->Qx[i]);
+    }
+    free(mshift->ULV_Ls);
+    free(mshift->ULV_idx);
+    free(mshift->ULV_Q);
+    free(mshift->D0);
+    free(mshift->Qx);
+    free(mshift);
+    *mshift_ = NULL;
+}
+
+// Factorize a node in the HSS ULV Cholesky factorization of (A + shift * I)
+// using the precomputed shift-independent parts, all its children should have
+// been factorized
+// Input parameters:
+//   h2pack : H2Pack structure with constructed HSS representation
+//   mshift : H2P_HSS_ULV_mshift structure constructed with h2pack
+//   node   : Target node
+//   shift  : Shift coefficient
+//   tmpD   : Work matrix
+//   tmpT   : Work matrix
+//   D_mid  : Size n_node, lower triangles of compressed diagonal blocks of factorized nodes
+// Output parameters:
+//   D_mid  : D_mid[node] is computed, those of node's children are overwritten and freed
+//   ULV_L  : ULV_L[node] is computed, can be NULL if ULV_L is not needed
+//   logdet : log(det(diagonal block of node)) is accumulated
+//   is_SPD : Set to 0 if the node's diagonal block is not SPD, the node is skipped if it is 0
+static void H2P_HSS_ULV_mshift_node(
+    H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const int node, const DTYPE shift,
+    H2P_dense_mat_p tmpD, H2P_dense_mat_p tmpT, H2P_dense_mat_p *D_mid, H2P_dense_mat_p *ULV_L,
+    DTYPE *logdet, int *is_SPD
+)
+{
+    if (!(*is_SPD)) return;
+
+    int level          = h2pack->node_level[node];
+    int node_n_child   = h2pack->n_child[node];
+    int *node_children = h2pack->children + node * h2pack->max_child;
+    H2P_dense_mat_p D0 = mshift->D0[node];
+    H2P_dense_mat_p Qx = mshift->Qx[node];
+    int U_nrow = D0->nrow;
+    int U_ncol = mshift->ULV_Ls[node];
+    int U_diff = U_nrow - U_ncol;
+
+    // 1. Leaf node:     tmpD = D0{node} + shift * I
+    //    Non-leaf node: tmpD = D0{node} + Q{node}' * blkdiag(D_mid{children}) * Q{node}
+    //    Only the lower triangle of tmpD and D_mid is referenced and updated
+    H2P_dense_mat_resize(tmpD, U_nrow, U_nrow);
+    if (node_n_child == 0)
+    {
+        memcpy(tmpD->data, D0->data, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < U_nrow; k++)
+            tmpD->data[k * U_nrow + k] += shift;
+    } else {
+        memcpy(tmpD->data, D0->data, sizeof(DTYPE) * U_nrow * U_nrow);
+        int idx_k_s = 0;
+        for (int k = 0; k < node_n_child; k++)
+        {
+            int child_k = node_children[k];
+            H2P_dense_mat_p D_mid_k = D_mid[child_k];
+            int idx_k_len = D_mid_k->nrow;
+            if (level > 0 && idx_k_len > 0)
+            {
+                // D_mid{child_k} = G * G', it is SPD if (A + shift * I) is SPD
+                // W = G' * Q{node}(idx_k, :);
+                // tmpD += W' * W;
+                int info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', idx_k_len, D_mid_k->data, D_mid_k->ld);
+                if (info != 0)
+                {
+                    *is_SPD = 0;
+                    return;
+                }
+                H2P_dense_mat_resize(tmpT, idx_k_len, U_nrow);
+                copy_matrix_block(sizeof(DTYPE), idx_k_len, U_nrow, Qx->data + idx_k_s * U_nrow, U_nrow, tmpT->data, tmpT->ld);
+                CBLAS_TRMM(
+                    CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit,
+                    idx_k_len, U_nrow, 1.0, D_mid_k->data, D_mid_k->ld, tmpT->data, tmpT->ld
+                );
+                CBLAS_SYRK(
+                    CblasRowMajor, CblasLower, CblasTrans, U_nrow, idx_k_len,
+                    1.0, tmpT->data, tmpT->ld, 1.0, tmpD->data, U_nrow
+                );
+            }
+            if (level == 0)
+            {
+                // Q{root} = I, tmpD(idx_k, idx_k) += D_mid{child_k};
+                for (int l = 0; l < idx_k_len; l++)
+                {
+                    DTYPE *tmpD_l = tmpD->data + (idx_k_s + l) * U_nrow + idx_k_s;
+                    DTYPE *D_mid_l = D_mid_k->data + l * D_mid_k->ld;
+                    for (int m = 0; m <= l; m++) tmpD_l[m] += D_mid_l[m];
+                }
+            }
+            idx_k_s += idx_k_len;
+            H2P_dense_mat_destroy(&D_mid[child_k]);
+        }
+    }
+
+    // 2. Cholesky factorization of the trailing block, see H2P_HSS_ULV_Cholesky_factorize()
+    // The root node has no identity block (U_ncol == 0), so the whole tmpD is factorized
+    DTYPE *tmpD11 = tmpD->data;
+    DTYPE *tmpD21 = tmpD->data + U_ncol * U_nrow;
+    DTYPE *tmpD22 = tmpD->data + U_ncol * (U_nrow + 1);
+    if (U_diff > 0)
+    {
+        // [tmpL, chol_flag] = chol(tmpD22, 'lower');
+        int info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', U_diff, tmpD22, U_nrow);
+        if (info != 0)
+        {
+            *is_SPD = 0;
+            return;
+        }
+        // logdet = logdet + 2 * sum(log(diag(tmpL)));
+        DTYPE node_logdet = 0.0;
+        for (int k = 0; k < U_diff; k++) node_logdet += DLOG(tmpD22[k * U_nrow + k]);
+        #pragma omp atomic update
+        *logdet += 2.0 * node_logdet;
+        // LD21 = tmpL \ tmpD21;
+        if (U_ncol > 0)
+        {
+            CBLAS_TRSM(
+                CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+                U_diff, U_ncol, 1.0, tmpD22, U_nrow, tmpD21, U_nrow
+            );
+        }
+    }
+
+    // 3. L{node} = [eye(U_ncol), LD21'; zeros(U_diff, U_ncol), tmpL];
+    if (ULV_L != NULL)
+    {
+        H2P_dense_mat_init(&ULV_L[node], U_nrow, U_nrow);
+        DTYPE *L = ULV_L[node]->data;
+        memset(L, 0, sizeof(DTYPE) * U_nrow * U_nrow);
+        for (int k = 0; k < U_ncol; k++) L[k * U_nrow + k] = 1.0;
+        if (U_diff > 0)
+        {
+            DTYPE *L12 = L + U_ncol;
+            DTYPE *L22 = L + U_ncol * (U_nrow + 1);
+            H2P_transpose_dmat(1, U_diff, U_ncol, tmpD21, U_nrow, L12, U_nrow);
+            for (int k = 0; k < U_diff; k++)
+                memcpy(L22 + k * U_nrow, tmpD22 + k * U_nrow, sizeof(DTYPE) * (k + 1));
+        }
+    }
+
+    // 4. D_mid{node} = tmpD11 - LD21' * LD21;
+    if (level > 0)
+    {
+        H2P_dense_mat_init(&D_mid[node], U_ncol, U_ncol);
+        copy_matrix_block(sizeof(DTYPE), U_ncol, U_ncol, tmpD11, U_nrow, D_mid[node]->data, U_ncol);
+        if (U_diff > 0)
+        {
+            CBLAS_SYRK(
+                CblasRowMajor, CblasLower, CblasTrans, U_ncol, U_diff,
+                -1.0, tmpD21, U_nrow, 1.0, D_mid[node]->data, U_ncol
+            );
+        }
+    }
+}
+
+// Factorize all nodes of (A + shift * I) level by level, return if the matrix is SPD
+// Input parameters:
+//   h2pack   : H2Pack structure with constructed HSS representation
+//   mshift   : H2P_HSS_ULV_mshift structure constructed with h2pack
+//   shift    : Shift coefficient
+//   n_thread : Number of threads to use
+// Output parameters:
+//   ULV_L    : Size n_node, ULV_L[node] of all nodes, can be NULL if ULV_L is not needed
+//   logdet_  : log(det(A + shift * I))
+//   <return> : 1 if (A + shift * I) is SPD, otherwise 0
+static int H2P_HSS_ULV_mshift_sweep(
+    H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const DTYPE shift,
+    const int n_thread, H2P_dense_mat_p *ULV_L, DTYPE *logdet_
+)
+{
+    int n_node        = h2pack->n_node;
+    int n_leaf_node   = h2pack->n_leaf_node;
+    int max_level     = h2pack->max_level;
+    int *level_n_node = h2pack->level_n_node;
+    int *level_nodes  = h2pack->level_nodes;
+
+    H2P_dense_mat_p *D_mid = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    ASSERT_PRINTF(D_mid != NULL, "Failed to allocate work matrices for HSS ULV multi-shift factorization\n");
+    DTYPE logdet = 0.0;
+    int is_SPD = 1;
+    for (int i = max_level; i >= 0; i--)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int level_i_n_node = level_n_node[i];
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+        #pragma omp parallel num_threads(n_thread_i)
+        {
+            H2P_dense_mat_p tmpD, tmpT;
+            H2P_dense_mat_init(&tmpD, 256, 256);
+            H2P_dense_mat_init(&tmpT, 256, 256);
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < level_i_n_node; j++)
+            {
+                int node = level_i_nodes[j];
+                H2P_HSS_ULV_mshift_node(h2pack, mshift, node, shift, tmpD, tmpT, D_mid, ULV_L, &logdet, &is_SPD);
+            }
+            H2P_dense_mat_destroy(&tmpD);
+            H2P_dense_mat_destroy(&tmpT);
+        }
+        if (!is_SPD) break;
+    }
+    for (int i = 0; i < n_node; i++) H2P_dense_mat_destroy(&D_mid[i]);
+    free(D_mid);
+    *logdet_ = logdet;
+    return is_SPD;
+}
+
+// Compute log(det(A_{HSS} + k * I)) for multiple shifts k
+void H2P_HSS_ULV_mshift_logdet(
+    H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const int n_shift,
+    const DTYPE *shifts, DTYPE *logdets
+)
+{
+    if (mshift == NULL || mshift->n_node != h2pack->n_node)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_mshift_init() with this H2Pack structure first!\n");
+        return;
+    }
+    int n_thread = h2pack->n_thread;
+    if (n_shift >= n_thread)
+    {
+        // Each thread handles different shifts, all nodes of a shift use one thread
+        BLAS_SET_NUM_THREADS(1);
+        #pragma omp parallel for num_threads(n_thread) schedule(dynamic)
+        for (int i = 0; i < n_shift; i++)
+        {
+            DTYPE logdet;
+            int is_SPD = H2P_HSS_ULV_mshift_sweep(h2pack, mshift, shifts[i], 1, NULL, &logdet);
+            logdets[i] = is_SPD ? logdet : NAN;
+        }
+        BLAS_SET_NUM_THREADS(n_thread);
+    } else {
+        for (int i = 0; i < n_shift; i++)
+        {
+            DTYPE logdet;
+            int is_SPD = H2P_HSS_ULV_mshift_sweep(h2pack, mshift, shifts[i], n_thread, NULL, &logdet);
+            logdets[i] = is_SPD ? logdet : NAN;
+        }
+    }
+}
+
+// Construct the ULV Cholesky factorization of (A_{HSS} + k * I) using
+// the precomputed shift-independent parts
+void H2P_HSS_ULV_mshift_Cholesky_factorize(H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const DTYPE shift)
+{
+    if (mshift == NULL || mshift->n_node != h2pack->n_node)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_mshift_init() with this H2Pack structure first!\n");
+        return;
+    }
+
+    int n_node = h2pack->n_node;
+    double st = get_wtime_sec();
+
+    H2P_HSS_ULV_free(h2pack);
+    H2P_dense_mat_p *ULV_L = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    ASSERT_PRINTF(ULV_L != NULL, "Failed to allocate matrices for HSS ULV Cholesky factorization\n");
+    DTYPE HSS_logdet;
+    int is_SPD = H2P_HSS_ULV_mshift_sweep(h2pack, mshift, shift, h2pack->n_thread, ULV_L, &HSS_logdet);
+    h2pack->is_HSS_SPD = is_SPD;
+    if (!is_SPD)
+    {
+        ERROR_PRINTF("Target matrix with shifting %.2lf is not SPD\n", shift);
+        for (int i = 0; i < n_node; i++) H2P_dense_mat_destroy(&ULV_L[i]);
+        free(ULV_L);
+        return;
+    }
+
+    // ULV_Ls, ULV_idx, and ULV_Q are shift-independent, copy them from mshift
+    int *ULV_Ls = (int*) malloc(sizeof(int) * n_node);
+    H2P_int_vec_p   *ULV_idx = (H2P_int_vec_p*)   malloc(sizeof(H2P_int_vec_p)   * n_node);
+    H2P_dense_mat_p *ULV_Q   = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    ASSERT_PRINTF(
+        ULV_Ls != NULL && ULV_idx != NULL && ULV_Q != NULL,
+        "Failed to allocate matrices for HSS ULV Cholesky factorization\n"
+    );
+    memcpy(ULV_Ls, mshift->ULV_Ls, sizeof(int) * n_node);
+    size_t ULV_Q_size = 0, ULV_L_size = 0, ULV_I_size = n_node;
+    for (int i = 0; i < n_node; i++)
+    {
+        H2P_int_vec_p   src_idx = mshift->ULV_idx[i];
+        H2P_dense_mat_p src_Q   = mshift->ULV_Q[i];
+        H2P_int_vec_init(&ULV_idx[i], src_idx->length);
+        memcpy(ULV_idx[i]->data, src_idx->data, sizeof(int) * src_idx->length);
+        ULV_idx[i]->length = src_idx->length;
+        H2P_dense_mat_init(&ULV_Q[i], src_Q->nrow, src_Q->ncol);
+        H2P_dense_mat_copy(src_Q, ULV_Q[i]);
+        ULV_Q_size += ULV_Q[i]->nrow * ULV_Q[i]->ncol;
+        ULV_L_size += ULV_L[i]->nrow * ULV_L[i]->ncol;
+        ULV_I_size += ULV_idx[i]->length;
+    }
+    h2pack->ULV_Ls  = ULV_Ls;
+    h2pack->ULV_idx = ULV_idx;
+    h2pack->ULV_Q   = ULV_Q;
+    h2pack->ULV_L   = ULV_L;
+    h2pack->HSS_logdet = HSS_logdet;
+    h2pack->mat_size[ULV_Q_SIZE_IDX] = ULV_Q_size;
+    h2pack->mat_size[ULV_L_SIZE_IDX] = ULV_L_size;
+    h2pack->mat_size[ULV_I_SIZE_IDX] = ULV_I_size;
+
+    double et = get_wtime_sec();
+    h2pack->timers[ULV_FCT_TIMER_IDX] = et - st;
+}
@@ -0,0 +1,70 @@
+#ifndef __H2PACK_HSS_ULV_MSHIFT_H__
+#define __H2PACK_HSS_ULV_MSHIFT_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Shift-independent parts of the HSS ULV Cholesky factorization of (A + k * I).
+// The orthogonal transforms ULV_Q only depend on the HSS bases U, and so do
+// the index arrays and the compressed off-diagonal couplings between siblings.
+// Computing them once leaves only the diagonal block updates and the small
+// Cholesky factorizations for each shift k.
+struct H2P_HSS_ULV_mshift
+{
+    int    n_node;              // Number of nodes in the HSS partitioning tree
+    int    *ULV_Ls;             // Size n_node, same as h2pack->ULV_Ls
+    H2P_int_vec_p   *ULV_idx;   // Size n_node, same as h2pack->ULV_idx
+    H2P_dense_mat_p *ULV_Q;     // Size n_node, same as h2pack->ULV_Q
+    H2P_dense_mat_p *D0;        // Size n_node, shift-independent part of Q{node}' * tmpD{node} * Q{node}
+    H2P_dense_mat_p *Qx;        // Size n_node, explicit Q{node} of non-leaf non-root nodes, NULL for other nodes
+    size_t mem_size;            // Total size (in DTYPE) of ULV_Q, D0, and Qx
+};
+typedef struct H2P_HSS_ULV_mshift  H2P_HSS_ULV_mshift_s;
+typedef struct H2P_HSS_ULV_mshift* H2P_HSS_ULV_mshift_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Precompute the shift-independent parts of the HSS ULV Cholesky factorization
+// Input parameter:
+//   h2pack : H2Pack structure with constructed HSS representation
+// Output parameter:
+//   mshift_ : Constructed H2P_HSS_ULV_mshift structure
+void H2P_HSS_ULV_mshift_init(H2Pack_p h2pack, H2P_HSS_ULV_mshift_p *mshift_);
+
+// Destroy a H2P_HSS_ULV_mshift structure
+// Input parameter:
+//   mshift_ : Pointer to a H2P_HSS_ULV_mshift structure to be destroyed
+void H2P_HSS_ULV_mshift_destroy(H2P_HSS_ULV_mshift_p *mshift_);
+
+// Compute log(det(A_{HSS} + k * I)) for multiple shifts k without storing
+// the ULV factors. Shifts are processed in parallel if there are enough of them.
+// Input parameters:
+//   h2pack  : H2Pack structure with constructed HSS representation
+//   mshift  : H2P_HSS_ULV_mshift structure constructed with h2pack
+//   n_shift : Number of shifts
+//   shifts  : Size n_shift, shift coefficients
+// Output parameter:
+//   logdets : Size n_shift, log(det(A_{HSS} + shifts[i] * I)), NAN if
+//             (A_{HSS} + shifts[i] * I) is not S.P.D.
+void H2P_HSS_ULV_mshift_logdet(
+    H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const int n_shift,
+    const DTYPE *shifts, DTYPE *logdets
+);
+
+// Construct the ULV Cholesky factorization of (A_{HSS} + k * I) using the
+// precomputed shift-independent parts, same as H2P_HSS_ULV_Cholesky_factorize()
+// Input parameters:
+//   h2pack : H2Pack structure with constructed HSS representation
+//   mshift : H2P_HSS_ULV_mshift structure constructed with h2pack
+//   shift  : Shift coefficient k to make (A + k * I) S.P.D.
+// Output parameter:
+//   h2pack : H2Pack structure with ULV Cholesky factorization
+void H2P_HSS_ULV_mshift_Cholesky_factorize(H2Pack_p h2pack, H2P_HSS_ULV_mshift_p mshift, const DTYPE shift);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_matmul.h"
+#include "H2Pack_matvec_dkrnl.h"
+#include "H2Pack_HSS_ULV.h"
+#include "H2Pack_HSS_ULV_trace.h"
+#include "H2Pack_utils.h"
+#include "utils.h"
+
+// Generate column-major Gaussian probe vectors, the j-th column uses random stream (seed + j)
+static void H2P_trace_gen_probe(
+    const int n_thread, const int n, const int n_vec, 
+    const unsigned long long seed, DTYPE *Z
+)
+{
+    #pragma omp parallel for num_threads(n_thread) schedule(static)
+    for (int j = 0; j < n_vec; j++)
+        H2P_gen_normal_distribution_stream(seed + j, 0.0, 1.0, n, Z + (size_t) j * (size_t) n);
+}
+
+// Column-wise dot products of two column-major matrices
+static void H2P_trace_col_dot(
+    const int n_thread, const int n, const int n_vec, 
+    const DTYPE *X, const DTYPE *Y, double *dots
+)
+{
+    #pragma omp parallel for num_threads(n_thread) schedule(static)
+    for (int j = 0; j < n_vec; j++)
+    {
+        const DTYPE *X_j = X + (size_t) j * (size_t) n;
+        const DTYPE *Y_j = Y + (size_t) j * (size_t) n;
+        double dot = 0.0;
+        for (int i = 0; i < n; i++) dot += (double) X_j[i] * (double) Y_j[i];
+        dots[j] = dot;
+    }
+}
+
+// Y := dK/dp_k * X, X and Y are n-by-n_vec column-major matrices
+static void H2P_trace_dK_matmul(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, 
+    const int n_vec, const DTYPE *X, DTYPE *Y
+)
+{
+    int n = h2pack->krnl_mat_size;
+    if (dkrnl == NULL) memcpy(Y, X, sizeof(DTYPE) * (size_t) n * (size_t) n_vec);
+    else H2P_matmul_dkrnl(h2pack, dkrnl, k, CblasColMajor, n_vec, X, n, Y, n);
+}
+
+// X := op(K)^{-1} * B using the HSS ULV factorization, B and X are n-by-n_vec column-major matrices
+static void H2P_trace_ULV_matsolve(H2Pack_p h2pack, const int op, const int n_vec, const DTYPE *B, DTYPE *X)
+{
+    int n = h2pack->krnl_mat_size;
+    if (h2pack->ULV_p != NULL) H2P_HSS_ULV_LU_matsolve(h2pack, op, CblasColMajor, n_vec, B, n, X, n);
+    else H2P_HSS_ULV_Cholesky_matsolve(h2pack, op, CblasColMajor, n_vec, B, n, X, n);
+}
+
+// Y := L^{-1} * dK/dp_k * R^{-1} * X in blocks of blk_size columns, where K = L * R, 
+// K^{-1} * b is computed by ULV solve with op == 1 (L^{-1} * b) and then op == 2 (R^{-1} * b).
+// tr(L^{-1} * dK/dp_k * R^{-1}) == tr(K^{-1} * dK/dp_k), and R == L^T for Cholesky 
+// factorization, so L^{-1} * dK/dp_k * R^{-1} is symmetric.
+static void H2P_trace_split_op(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, const int n_vec, const int blk_size, 
+    const DTYPE *X, DTYPE *Y, DTYPE *T0, DTYPE *T1
+)
+{
+    int n = h2pack->krnl_mat_size;
+    for (int col_s = 0; col_s < n_vec; col_s += blk_size)
+    {
+        int    blk_n_vec = MIN(blk_size, n_vec - col_s);
+        size_t offset    = (size_t) col_s * (size_t) n;
+        H2P_trace_ULV_matsolve(h2pack, 2, blk_n_vec, X + offset, T0);
+        H2P_trace_dK_matmul(h2pack, dkrnl, k, blk_n_vec, T0, T1);
+        H2P_trace_ULV_matsolve(h2pack, 1, blk_n_vec, T1, Y + offset);
+    }
+}
+
+// Sample mean and standard error of the mean
+static void H2P_trace_mean_stderr(const int n, const double sum, const double sum2, DTYPE *mean, DTYPE *err)
+{
+    double mean_ = sum / (double) n;
+    double var   = (n > 1) ? (sum2 - (double) n * mean_ * mean_) / (double) (n - 1) : 0.0;
+    if (var < 0.0) var = 0.0;
+    *mean = (DTYPE) mean_;
+    *err  = (DTYPE) sqrt(var / (double) n);
+}
+
+// Hutchinson estimator: tr(K^{-1} * dK) ~= mean((K^{-1} * z_i)^T * (dK * z_i))
+static void H2P_trace_Hutchinson(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int n_out, const int n_probe, 
+    const int blk_size, const unsigned long long seed, DTYPE *trace, DTYPE *trace_err
+)
+{
+    int    n        = h2pack->krnl_mat_size;
+    int    n_thread = h2pack->n_thread;
+    size_t blk_msize = (size_t) n * (size_t) blk_size;
+    DTYPE  *Z    = (DTYPE*)  malloc(sizeof(DTYPE)  * blk_msize);
+    DTYPE  *W    = (DTYPE*)  malloc(sizeof(DTYPE)  * blk_msize);
+    DTYPE  *Y    = (DTYPE*)  malloc(sizeof(DTYPE)  * blk_msize);
+    double *dots = (double*) malloc(sizeof(double) * blk_size);
+    double *sum  = (double*) malloc(sizeof(double) * n_out * 2);
+    ASSERT_PRINTF(
+        Z != NULL && W != NULL && Y != NULL && dots != NULL && sum != NULL,
+        "Failed to allocate trace estimator buffers of size %zu\n", 3 * blk_msize
+    );
+    double *sum2 = sum + n_out;
+    memset(sum, 0, sizeof(double) * n_out * 2);
+
+    for (int col_s = 0; col_s < n_probe; col_s += blk_size)
+    {
+        int blk_n_vec = MIN(blk_size, n_probe - col_s);
+        H2P_trace_gen_probe(n_thread, n, blk_n_vec, seed + col_s, Z);
+        // K is symmetric, z_i^T * K^{-1} * dK * z_i == (K^{-1} * z_i)^T * (dK * z_i), 
+        // so one blocked solve is shared by all derivative kernels
+        H2P_trace_ULV_matsolve(h2pack, 3, blk_n_vec, Z, W);
+        for (int k = 0; k < n_out; k++)
+        {
+            H2P_trace_dK_matmul(h2pack, dkrnl, k, blk_n_vec, Z, Y);
+            H2P_trace_col_dot(n_thread, n, blk_n_vec, W, Y, dots);
+            for (int j = 0; j < blk_n_vec; j++)
+            {
+                sum[k]  += dots[j];
+                sum2[k] += dots[j] * dots[j];
+            }
+        }
+    }
+    for (int k = 0; k < n_out; k++)
+        H2P_trace_mean_stderr(n_probe, sum[k], sum2[k], trace + k, trace_err + k);
+
+    free(Z);
+    free(W);
+    free(Y);
+    free(dots);
+    free(sum);
+}
+
+// Hutch++ estimator (Meyer, Musco, Musco, Woodruff, 2021) applied to A = L^{-1} * dK * R^{-1}:
+// Q = orth(A * S), tr(A) ~= tr(Q^T * A * Q) + mean(g_i^T * A * g_i), g_i = (I - Q * Q^T) * z_i
+static void H2P_trace_HutchPP(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int n_out, const int n_probe, 
+    const int blk_size, const unsigned long long seed, DTYPE *trace, DTYPE *trace_err
+)
+{
+    int    n        = h2pack->krnl_mat_size;
+    int    n_thread = h2pack->n_thread;
+    int    n_sk     = MIN(n_probe / 3, n);
+    int    n_hut    = n_probe - 2 * n_sk;
+    int    n_P      = n_sk + n_hut;
+    size_t blk_msize = (size_t) n * (size_t) blk_size;
+    size_t P_msize   = (size_t) n * (size_t) n_P;
+    // S = [sketching vectors, Hutchinson probe vectors], P = [Q, (I - Q * Q^T) * G], AP = A * P
+    DTYPE  *S    = (DTYPE*)  malloc(sizeof(DTYPE)  * P_msize);
+    DTYPE  *P    = (DTYPE*)  malloc(sizeof(DTYPE)  * P_msize);
+    DTYPE  *AP   = (DTYPE*)  malloc(sizeof(DTYPE)  * P_msize);
+    DTYPE  *T0   = (DTYPE*)  malloc(sizeof(DTYPE)  * blk_msize);
+    DTYPE  *T1   = (DTYPE*)  malloc(sizeof(DTYPE)  * blk_msize);
+    DTYPE  *QtG  = (DTYPE*)  malloc(sizeof(DTYPE)  * (n_sk * n_hut + n_sk));
+    double *dots = (double*) malloc(sizeof(double) * n_P);
+    ASSERT_PRINTF(
+        S != NULL && P != NULL && AP != NULL && T0 != NULL && T1 != NULL && QtG != NULL && dots != NULL,
+        "Failed to allocate trace estimator buffers of size %zu\n", 3 * P_msize + 2 * blk_msize
+    );
+    DTYPE *tau = QtG + n_sk * n_hut;
+    DTYPE *Q   = P;
+    DTYPE *G   = S + (size_t) n * (size_t) n_sk;
+    DTYPE *Gp  = P + (size_t) n * (size_t) n_sk;
+
+    H2P_trace_gen_probe(n_thread, n, n_P, seed, S);
+    for (int k = 0; k < n_out; k++)
+    {
+        // 1. Q = orth(A * S(:, 1 : n_sk))
+        H2P_trace_split_op(h2pack, dkrnl, k, n_sk, blk_size, S, Q, T0, T1);
+        LAPACK_GEQRF(LAPACK_COL_MAJOR, n, n_sk, Q, n, tau);
+        LAPACK_ORGQR(LAPACK_COL_MAJOR, n, n_sk, n_sk, Q, n, tau);
+
+        // 2. Gp = (I - Q * Q^T) * G
+        memcpy(Gp, G, sizeof(DTYPE) * (size_t) n * (size_t) n_hut);
+        CBLAS_GEMM(
+            CblasColMajor, CblasTrans, CblasNoTrans, n_sk, n_hut, n, 
+            1.0, Q, n, G, n, 0.0, QtG, n_sk
+        );
+        CBLAS_GEMM(
+            CblasColMajor, CblasNoTrans, CblasNoTrans, n, n_hut, n_sk, 
+            -1.0, Q, n, QtG, n_sk, 1.0, Gp, n
+        );
+
+        // 3. tr(A) ~= tr(Q^T * A * Q) + mean(diag(Gp^T * A * Gp))
+        H2P_trace_split_op(h2pack, dkrnl, k, n_P, blk_size, P, AP, T0, T1);
+        H2P_trace_col_dot(n_thread, n, n_P, P, AP, dots);
+        double tr_Q = 0.0, sum = 0.0, sum2 = 0.0;
+        for (int j = 0; j < n_sk; j++) tr_Q += dots[j];
+        for (int j = n_sk; j < n_P; j++)
+        {
+            sum  += dots[j];
+            sum2 += dots[j] * dots[j];
+        }
+        H2P_trace_mean_stderr(n_hut, sum, sum2, trace + k, trace_err + k);
+        trace[k] += (DTYPE) tr_Q;
+    }
+
+    free(S);
+    free(P);
+    free(AP);
+    free(T0);
+    free(T1);
+    free(QtG);
+    free(dots);
+}
+
+// Estimate tr(K^{-1} * dK/dp_k) for each derivative kernel with a stochastic trace estimator
+int H2P_HSS_ULV_trace_Kinv_dK(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int method, const int n_probe, 
+    const int blk_size, const unsigned long long seed, DTYPE *trace, DTYPE *trace_err
+)
+{
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() or H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return -1;
+    }
+    if (method != H2P_TRACE_HUTCHINSON && method != H2P_TRACE_HUTCHPP)
+    {
+        ERROR_PRINTF("Invalid trace estimator method %d\n", method);
+        return -1;
+    }
+    if (n_probe < 1 || (method == H2P_TRACE_HUTCHPP && n_probe < 3))
+    {
+        ERROR_PRINTF("Invalid number of probe vectors %d\n", n_probe);
+        return -1;
+    }
+
+    int n_out  = (dkrnl == NULL) ? 1 : dkrnl->n_dkrnl;
+    int blk_n  = (blk_size <= 0) ? n_probe : MIN(blk_size, n_probe);
+    DTYPE *err = trace_err;
+    if (err == NULL) 
+    {
+        err = (DTYPE*) malloc(sizeof(DTYPE) * n_out);
+        ASSERT_PRINTF(err != NULL, "Failed to allocate array of size %d\n", n_out);
+    }
+
+    if (method == H2P_TRACE_HUTCHINSON)
+        H2P_trace_Hutchinson(h2pack, dkrnl, n_out, n_probe, blk_n, seed, trace, err);
+    else
+        H2P_trace_HutchPP(h2pack, dkrnl, n_out, n_probe, blk_n, seed, trace, err);
+
+    if (trace_err == NULL) free(err);
+    return 0;
+}
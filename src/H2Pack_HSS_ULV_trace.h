@@ -0,0 +1,50 @@
+#ifndef __H2PACK_HSS_ULV_TRACE_H__
+#define __H2PACK_HSS_ULV_TRACE_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_matvec_dkrnl.h"
+
+#define H2P_TRACE_HUTCHINSON    0   // Hutchinson estimator, one ULV solve shared by all derivative kernels
+#define H2P_TRACE_HUTCHPP       1   // Hutch++ estimator, low-rank deflation + Hutchinson on the remainder
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Estimate tr(K^{-1} * dK/dp_k) for each derivative kernel with a stochastic 
+// trace estimator, where K is the HSS matrix with ULV factorization (including 
+// the factorization shift). tr(K^{-1} * dK/dp_k) is the derivative of log(det(K)) 
+// w.r.t. the k-th kernel parameter. 
+// Gaussian probe vectors are processed in blocks of blk_size columns with one 
+// blocked ULV solve and one blocked derivative kernel matmul per block. The i-th 
+// probe vector is generated from random stream (seed + i), so the results do not 
+// depend on blk_size or the number of threads (up to floating-point rounding).
+// Input parameters:
+//   h2pack    : H2Pack structure with ULV LU or Cholesky factorization of a symmetric HSS matrix
+//   dkrnl     : H2P_dkrnl structure constructed by H2P_dkrnl_build() with h2pack. If 
+//               dkrnl == NULL, estimate tr(K^{-1}), i.e., dK/dp = I for a diagonal shift
+//   method    : H2P_TRACE_HUTCHINSON or H2P_TRACE_HUTCHPP
+//   n_probe   : Number of probe vectors multiplied with each dK/dp_k, >= 3 for H2P_TRACE_HUTCHPP
+//   blk_size  : Maximum number of probe vectors in a blocked solve / matmul, <= 0 means n_probe
+//   seed      : Random stream seed
+// Output parameters:
+//   trace     : Size max(1, dkrnl->n_dkrnl), estimated tr(K^{-1} * dK/dp_k)
+//   trace_err : Size max(1, dkrnl->n_dkrnl), estimated standard error of trace, can be NULL
+//   <return>  : 0 if succeeded, -1 if input is invalid
+// Note:
+//   H2P_TRACE_HUTCHINSON needs 1 blocked solve for all kernels and 1 blocked matmul 
+//   per kernel for each probe block. H2P_TRACE_HUTCHPP uses the splitting K = L * R
+//   of the ULV factorization and tr(L^{-1} * dK/dp_k * R^{-1}) and needs 2 blocked solves and 1 blocked matmul 
+//   for each kernel and probe block, but it converges much faster when dK/dp_k has 
+//   a fast decaying spectrum.
+int H2P_HSS_ULV_trace_Kinv_dK(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int method, const int n_probe, 
+    const int blk_size, const unsigned long long seed, DTYPE *trace, DTYPE *trace_err
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
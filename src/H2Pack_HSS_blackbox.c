@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_partition.h"
+#include "H2Pack_SPDHSS_H2.h"
+#include "H2Pack_HSS_blackbox.h"
+#include "H2Pack_utils.h"
+#include "utils.h"
+
+// Compress the sampled block row of a node and peel off its diagonal block
+// Input parameters:
+//   n_vec    : Number of sampling vectors
+//   max_rank : Maximum rank of the HSS matrix
+//   reltol   : Relative tolerance in column-pivoted QR
+//   is_root  : If the node is the root node
+//   Om       : Size nrow * n_vec, (reduced) sampling matrix of the node
+//   Y        : Size nrow * n_vec, (reduced) sampling results of the node, Y = A_{node, :} * Om_{all}
+//   QT, Z    : Work matrices
+//   jpvt     : Work integer vector
+// Output parameters:
+//   Y      : Overwritten
+//   U_     : Size nrow * rank, orthonormal basis of the node, not constructed for the root node
+//   D_     : Size nrow * nrow, A_{node, node} - U * U^T * A_{node, node} * U * U^T, 
+//            A_{node, node} for the root node
+//   Om_hat : Size rank * n_vec, U^T * Om, not constructed for the root node
+//   Y_hat  : Size rank * n_vec, U^T * (Y - D * Om), not constructed for the root node
+static void H2P_HSS_blackbox_compress_node(
+    const int n_vec, const int max_rank, const DTYPE reltol, const int is_root, 
+    H2P_dense_mat_p Om, H2P_dense_mat_p Y, H2P_dense_mat_p QT, H2P_dense_mat_p Z, 
+    H2P_int_vec_p jpvt, H2P_dense_mat_p *U_, H2P_dense_mat_p *D_, 
+    H2P_dense_mat_p *Om_hat_, H2P_dense_mat_p *Y_hat_
+)
+{
+    const int nrow = Om->nrow;
+    ASSERT_PRINTF(
+        n_vec >= nrow + (is_root ? 0 : 1), 
+        "Number of sampling vectors (%d) is not enough for a node with %d rows\n", n_vec, nrow
+    );
+
+    // 1. Om^T = Q1 * R1, Om^{+} = Q1 * R1^{-T}
+    H2P_dense_mat_resize(QT, n_vec + 1, nrow);
+    DTYPE *tau = QT->data + n_vec * nrow;
+    QT->nrow = n_vec;
+    H2P_transpose_dmat(1, nrow, n_vec, Om->data, Om->ld, QT->data, QT->ld);
+    LAPACK_GEQRF(LAPACK_ROW_MAJOR, n_vec, nrow, QT->data, QT->ld, tau);
+    H2P_dense_mat_p D, X;
+    H2P_dense_mat_init(&D, nrow, nrow);
+    H2P_dense_mat_init(&X, nrow, nrow);
+    H2P_dense_mat_p R1 = D;
+    copy_matrix_block(sizeof(DTYPE), nrow, nrow, QT->data, QT->ld, R1->data, R1->ld);
+    LAPACK_ORGQR(LAPACK_ROW_MAJOR, n_vec, nrow, nrow, QT->data, QT->ld, tau);
+
+    // 2. X = Y * Q1, Z = Y - X * Q1^T = Y * (I - Q1 * Q1^T). The column space of 
+    //    Z is the column space of A_{node, others} since Om * (I - Q1 * Q1^T) = 0
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, nrow, nrow, n_vec,
+        1.0, Y->data, Y->ld, QT->data, QT->ld, 0.0, X->data, X->ld
+    );
+    if (!is_root)
+    {
+        H2P_dense_mat_resize(Z, nrow + 1, n_vec);
+        Z->nrow = nrow;
+        copy_matrix_block(sizeof(DTYPE), nrow, n_vec, Y->data, Y->ld, Z->data, Z->ld);
+        CBLAS_GEMM(
+            CblasRowMajor, CblasNoTrans, CblasTrans, nrow, n_vec, nrow,
+            -1.0, X->data, X->ld, QT->data, QT->ld, 1.0, Z->data, Z->ld
+        );
+    }
+
+    // 3. X = Y * Om^{+} = A_{node, node} + U * M for some M
+    CBLAS_TRSM(
+        CblasRowMajor, CblasRight, CblasUpper, CblasTrans, CblasNonUnit,
+        nrow, nrow, 1.0, R1->data, R1->ld, X->data, X->ld
+    );
+
+    if (is_root)
+    {
+        for (int i = 0; i < nrow; i++)
+        {
+            for (int j = 0; j < nrow; j++)
+                D->data[i * nrow + j] = 0.5 * (X->data[i * nrow + j] + X->data[j * nrow + i]);
+        }
+        H2P_dense_mat_destroy(&X);
+        *U_ = NULL;
+        *D_ = D;
+        *Om_hat_ = NULL;
+        *Y_hat_  = NULL;
+        return;
+    }
+
+    // 4. U = orth(Z) with column-pivoted QR
+    DTYPE *tau_Z = Z->data + nrow * n_vec;
+    H2P_int_vec_set_capacity(jpvt, n_vec);
+    memset(jpvt->data, 0, sizeof(int) * n_vec);
+    LAPACK_GEQPF(LAPACK_ROW_MAJOR, nrow, n_vec, Z->data, Z->ld, jpvt->data, tau_Z);
+    int rank = MIN(nrow, max_rank);
+    DTYPE stop_diag = DABS(Z->data[0]) * reltol;
+    for (int k = 1; k < rank; k++)
+    {
+        if (DABS(Z->data[k * Z->ld + k]) < stop_diag)
+        {
+            rank = k;
+            break;
+        }
+    }
+    LAPACK_ORGQR(LAPACK_ROW_MAJOR, nrow, rank, rank, Z->data, Z->ld, tau_Z);
+    H2P_dense_mat_p U;
+    H2P_dense_mat_init(&U, nrow, rank);
+    copy_matrix_block(sizeof(DTYPE), nrow, rank, Z->data, Z->ld, U->data, U->ld);
+
+    // 5. T = (I - U * U^T) * X = (I - U * U^T) * A_{node, node}, 
+    //    D = T + U * U^T * T^T = A_{node, node} - U * U^T * A_{node, node} * U * U^T
+    H2P_dense_mat_p UtX = QT;
+    H2P_dense_mat_resize(UtX, rank, nrow);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasTrans, CblasNoTrans, rank, nrow, nrow,
+        1.0, U->data, U->ld, X->data, X->ld, 0.0, UtX->data, UtX->ld
+    );
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, nrow, nrow, rank,
+        -1.0, U->data, U->ld, UtX->data, UtX->ld, 1.0, X->data, X->ld
+    );
+    H2P_dense_mat_p TU = QT;
+    H2P_dense_mat_resize(TU, nrow, rank);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, nrow, rank, nrow,
+        1.0, X->data, X->ld, U->data, U->ld, 0.0, TU->data, TU->ld
+    );
+    copy_matrix_block(sizeof(DTYPE), nrow, nrow, X->data, X->ld, D->data, D->ld);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasTrans, nrow, nrow, rank,
+        1.0, U->data, U->ld, TU->data, TU->ld, 1.0, D->data, D->ld
+    );
+    for (int i = 0; i < nrow; i++)
+    {
+        for (int j = i + 1; j < nrow; j++)
+        {
+            DTYPE Dij = 0.5 * (D->data[i * nrow + j] + D->data[j * nrow + i]);
+            D->data[i * nrow + j] = Dij;
+            D->data[j * nrow + i] = Dij;
+        }
+    }
+    H2P_dense_mat_destroy(&X);
+
+    // 6. Om_hat = U^T * Om, Y_hat = U^T * (Y - D * Om) = (U^T * A_{node, node} * U) * Om_hat 
+    //    + U^T * A_{node, others} * Om_{others} are the samples of the reduced matrix
+    H2P_dense_mat_p Om_hat, Y_hat;
+    H2P_dense_mat_init(&Om_hat, rank, n_vec);
+    H2P_dense_mat_init(&Y_hat,  rank, n_vec);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, nrow, n_vec, nrow,
+        -1.0, D->data, D->ld, Om->data, Om->ld, 1.0, Y->data, Y->ld
+    );
+    CBLAS_GEMM(
+        CblasRowMajor, CblasTrans, CblasNoTrans, rank, n_vec, nrow,
+        1.0, U->data, U->ld, Om->data, Om->ld, 0.0, Om_hat->data, Om_hat->ld
+    );
+    CBLAS_GEMM(
+        CblasRowMajor, CblasTrans, CblasNoTrans, rank, n_vec, nrow,
+        1.0, U->data, U->ld, Y->data, Y->ld, 0.0, Y_hat->data, Y_hat->ld
+    );
+    *U_ = U;
+    *D_ = D;
+    *Om_hat_ = Om_hat;
+    *Y_hat_  = Y_hat;
+}
+
+// Construct an HSS matrix from a symmetric operator available through matmul
+void H2P_HSS_blackbox_build(
+    H2Pack_p tree, op_matmul_fptr op_matmul, void *op_param, const int max_rank, 
+    const DTYPE reltol, const DTYPE shift, H2Pack_p *hssmat_
+)
+{
+    *hssmat_ = NULL;
+    if (tree == NULL || tree->n_node == 0 || tree->mat_cluster == NULL)
+    {
+        ERROR_PRINTF("Input tree is not partitioned\n");
+        return;
+    }
+    if (tree->is_H2ERI || tree->per_lattices != NULL)
+    {
+        ERROR_PRINTF("Cannot construct black-box HSS for H2ERI or periodic system\n");
+        return;
+    }
+    if (op_matmul == NULL || max_rank < 1)
+    {
+        ERROR_PRINTF("Invalid operator matmul function or max_rank (%d)\n", max_rank);
+        return;
+    }
+
+    // 1. Prepare HSS admissible pairs, permutation indices, and admissible pair 
+    //    counts if the tree does not have them
+    int n_node        = tree->n_node;
+    int n_thread      = tree->n_thread;
+    int n_leaf_node   = tree->n_leaf_node;
+    int max_child     = tree->max_child;
+    int max_level     = tree->max_level;
+    int root_idx      = tree->root_idx;
+    int krnl_mat_size = tree->krnl_mat_size;
+    int *parent       = tree->parent;
+    int *children     = tree->children;
+    int *n_child      = tree->n_child;
+    int *mat_cluster  = tree->mat_cluster;
+    int *level_n_node = tree->level_n_node;
+    int *level_nodes  = tree->level_nodes;
+    int *node_height  = tree->node_height;
+    int *leaf_nodes   = tree->height_nodes;
+    if (tree->HSS_r_adm_pairs == NULL) H2P_HSS_calc_adm_inadm_pairs(tree);
+    if (tree->fwd_pmt_idx == NULL)
+    {
+        int n_point  = tree->n_point;
+        int krnl_dim = tree->krnl_dim;
+        int *coord_idx   = tree->coord_idx;
+        int *fwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+        int *bwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+        ASSERT_PRINTF(fwd_pmt_idx != NULL && bwd_pmt_idx != NULL, "Failed to allocate permutation index arrays\n");
+        for (int i = 0; i < n_point; i++)
+        {
+            for (int j = 0; j < krnl_dim; j++)
+            {
+                fwd_pmt_idx[i * krnl_dim + j] = coord_idx[i] * krnl_dim + j;
+                bwd_pmt_idx[coord_idx[i] * krnl_dim + j] = i * krnl_dim + j;
+            }
+        }
+        tree->fwd_pmt_idx = fwd_pmt_idx;
+        tree->bwd_pmt_idx = bwd_pmt_idx;
+    }
+    int HSS_n_r_adm_pair = tree->HSS_n_r_adm_pair;
+    int *HSS_r_adm_pairs = tree->HSS_r_adm_pairs;
+    for (int i = 0; i < HSS_n_r_adm_pair; i++)
+    {
+        int node0 = HSS_r_adm_pairs[2 * i];
+        int node1 = HSS_r_adm_pairs[2 * i + 1];
+        if (parent[node0] != parent[node1])
+        {
+            ERROR_PRINTF("HSS admissible pair (%d, %d) are not sibling nodes\n", node0, node1);
+            return;
+        }
+    }
+    if (tree->node_n_r_adm == NULL)
+    {
+        tree->node_n_r_adm = (int*) malloc(sizeof(int) * n_node);
+        ASSERT_PRINTF(
+            tree->node_n_r_adm != NULL, 
+            "Failed to allocate array of size %d for counting node admissible pairs\n", n_node
+        );
+        memset(tree->node_n_r_adm, 0, sizeof(int) * n_node);
+        for (int i = 0; i < HSS_n_r_adm_pair; i++)
+        {
+            tree->node_n_r_adm[HSS_r_adm_pairs[2 * i]]++;
+            tree->node_n_r_adm[HSS_r_adm_pairs[2 * i + 1]]++;
+        }
+    }
+
+    double st, et, build_U_t = 0.0, build_B_t = 0.0, build_D_t = 0.0;
+
+    // 2. Multiply the operator with Gaussian random vectors. The null space of 
+    //    the sampling matrix of each non-root node should have at least 
+    //    (node rank + oversampling) columns
+    st = get_wtime_sec();
+    int n_vec = 0;
+    for (int node = 0; node < n_node; node++)
+    {
+        int node_size = mat_cluster[2 * node + 1] - mat_cluster[2 * node] + 1;
+        int nrow = (n_child[node] == 0) ? node_size : MIN(node_size, n_child[node] * max_rank);
+        int node_n_vec = (node == root_idx) ? nrow : nrow + MIN(nrow, max_rank) + 10;
+        n_vec = MAX(n_vec, node_n_vec);
+    }
+    size_t mat_msize = sizeof(DTYPE) * (size_t) krnl_mat_size * (size_t) n_vec;
+    DTYPE *Om_all = (DTYPE*) malloc(mat_msize);
+    DTYPE *Y_all  = (DTYPE*) malloc(mat_msize);
+    DTYPE *op_x   = (DTYPE*) malloc(mat_msize);
+    ASSERT_PRINTF(
+        Om_all != NULL && Y_all != NULL && op_x != NULL,
+        "Failed to allocate sampling matrices of size %d * %d\n", krnl_mat_size, n_vec
+    );
+    H2P_gen_normal_distribution(0.0, 1.0, (size_t) krnl_mat_size * (size_t) n_vec, Om_all);
+    // Om_all and Y_all are row-major and use the sorted point ordering,
+    // op_matmul() uses column-major matrices in the original point ordering
+    int *fwd_pmt_idx = tree->fwd_pmt_idx;
+    #pragma omp parallel for num_threads(n_thread) schedule(static)
+    for (int j = 0; j < n_vec; j++)
+    {
+        DTYPE *op_x_j = op_x + (size_t) j * (size_t) krnl_mat_size;
+        for (int i = 0; i < krnl_mat_size; i++)
+            op_x_j[fwd_pmt_idx[i]] = Om_all[(size_t) i * (size_t) n_vec + j];
+    }
+    op_matmul(op_param, n_vec, op_x, krnl_mat_size, Y_all, krnl_mat_size);
+    memcpy(op_x, Y_all, mat_msize);
+    #pragma omp parallel for num_threads(n_thread) schedule(static)
+    for (int i = 0; i < krnl_mat_size; i++)
+    {
+        DTYPE *Y_i = Y_all + (size_t) i * (size_t) n_vec;
+        for (int j = 0; j < n_vec; j++)
+            Y_i[j] = op_x[(size_t) j * (size_t) krnl_mat_size + fwd_pmt_idx[i]];
+    }
+    free(op_x);
+    et = get_wtime_sec();
+    build_U_t += et - st;
+
+    // 3. Compress nodes from the leaf nodes to the root node. The sampling matrix
+    //    and results of a non-leaf node are the reduced ones of its children
+    st = get_wtime_sec();
+    BLAS_SET_NUM_THREADS(1);
+    H2P_dense_mat_p *HSS_U  = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    H2P_dense_mat_p *F      = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    H2P_dense_mat_p *Om_hat = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    H2P_dense_mat_p *Y_hat  = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    int *blk_off = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(
+        HSS_U != NULL && F != NULL && Om_hat != NULL && Y_hat != NULL && blk_off != NULL,
+        "Failed to allocate %d working arrays for black-box HSS construction\n", 4 * n_node
+    );
+    for (int i = 0; i < n_node; i++)
+    {
+        HSS_U[i]  = NULL;
+        F[i]      = NULL;
+        Om_hat[i] = NULL;
+        Y_hat[i]  = NULL;
+        blk_off[i] = 0;
+    }
+    int root_height = node_height[root_idx];
+    for (int h = 0; h <= root_height; h++)
+    {
+        int height_h_n_node = tree->height_n_node[h];
+        int *height_h_nodes = tree->height_nodes + h * n_leaf_node;
+        int n_thread_h = MIN(height_h_n_node, n_thread);
+        #pragma omp parallel num_threads(n_thread_h)
+        {
+            H2P_dense_mat_p Om, Y, QT, Z;
+            H2P_int_vec_p jpvt;
+            H2P_dense_mat_init(&Om, 64, 64);
+            H2P_dense_mat_init(&Y,  64, 64);
+            H2P_dense_mat_init(&QT, 64, 64);
+            H2P_dense_mat_init(&Z,  64, 64);
+            H2P_int_vec_init(&jpvt, n_vec);
+
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < height_h_n_node; j++)
+            {
+                int node = height_h_nodes[j];
+                int n_child_node = n_child[node];
+                if (n_child_node == 0)
+                {
+                    int s_row = mat_cluster[2 * node];
+                    int nrow  = mat_cluster[2 * node + 1] - s_row + 1;
+                    H2P_dense_mat_resize(Om, nrow, n_vec);
+                    H2P_dense_mat_resize(Y,  nrow, n_vec);
+                    copy_matrix_block(sizeof(DTYPE), nrow, n_vec, Om_all + (size_t) s_row * (size_t) n_vec, n_vec, Om->data, Om->ld);
+                    copy_matrix_block(sizeof(DTYPE), nrow, n_vec, Y_all  + (size_t) s_row * (size_t) n_vec, n_vec, Y->data,  Y->ld);
+                } else {
+                    int *node_children = children + node * max_child;
+                    int nrow = 0;
+                    for (int k = 0; k < n_child_node; k++)
+                    {
+                        int child_k = node_children[k];
+                        blk_off[child_k] = nrow;
+                        nrow += Om_hat[child_k]->nrow;
+                    }
+                    H2P_dense_mat_resize(Om, nrow, n_vec);
+                    H2P_dense_mat_resize(Y,  nrow, n_vec);
+                    for (int k = 0; k < n_child_node; k++)
+                    {
+                        int child_k = node_children[k];
+                        int k_nrow  = Om_hat[child_k]->nrow;
+                        copy_matrix_block(sizeof(DTYPE), k_nrow, n_vec, Om_hat[child_k]->data, n_vec, Om->data + blk_off[child_k] * n_vec, n_vec);
+                        copy_matrix_block(sizeof(DTYPE), k_nrow, n_vec, Y_hat[child_k]->data,  n_vec, Y->data  + blk_off[child_k] * n_vec, n_vec);
+                        H2P_dense_mat_destroy(&Om_hat[child_k]);
+                        H2P_dense_mat_destroy(&Y_hat[child_k]);
+                    }
+                }  // End of "if (n_child_node == 0)"
+                H2P_HSS_blackbox_compress_node(
+                    n_vec, max_rank, reltol, node == root_idx, Om, Y, QT, Z, jpvt, 
+                    &HSS_U[node], &F[node], &Om_hat[node], &Y_hat[node]
+                );
+            }  // End of j loop
+
+            H2P_dense_mat_destroy(&Om);
+            H2P_dense_mat_destroy(&Y);
+            H2P_dense_mat_destroy(&QT);
+            H2P_dense_mat_destroy(&Z);
+            H2P_int_vec_destroy(&jpvt);
+        }  // End of "#pragma omp parallel"
+    }  // End of h loop
+    free(Om_all);
+    free(Y_all);
+    free(Om_hat);
+    free(Y_hat);
+    et = get_wtime_sec();
+    build_U_t += et - st;
+
+    // 4. Push the diagonal blocks of the reduced matrices down to the children:
+    //    F{node} = D{node} + U{node} * F{parent}(node, node) * U{node}^T
+    st = get_wtime_sec();
+    for (int i = 1; i <= max_level; i++)
+    {
+        int level_i_n_node = level_n_node[i];
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+        #pragma omp parallel num_threads(n_thread_i)
+        {
+            H2P_dense_mat_p UE;
+            H2P_dense_mat_init(&UE, 64, 64);
+
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < level_i_n_node; j++)
+            {
+                int node = level_i_nodes[j];
+                H2P_dense_mat_p U_node = HSS_U[node];
+                H2P_dense_mat_p F_pnt  = F[parent[node]];
+                DTYPE *E = F_pnt->data + blk_off[node] * F_pnt->ld + blk_off[node];
+                H2P_dense_mat_resize(UE, U_node->nrow, U_node->ncol);
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasNoTrans, U_node->nrow, U_node->ncol, U_node->ncol,
+                    1.0, U_node->data, U_node->ld, E, F_pnt->ld, 0.0, UE->data, UE->ld
+                );
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasNoTrans, CblasTrans, U_node->nrow, U_node->nrow, U_node->ncol,
+                    1.0, UE->data, UE->ld, U_node->data, U_node->ld, 1.0, F[node]->data, F[node]->ld
+                );
+            }  // End of j loop
+
+            H2P_dense_mat_destroy(&UE);
+        }  // End of "#pragma omp parallel"
+    }  // End of i loop
+    BLAS_SET_NUM_THREADS(n_thread);
+
+    // 5. Extract the B matrices of sibling pairs from the parent's F matrix
+    H2P_dense_mat_p *HSS_B = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * HSS_n_r_adm_pair);
+    int *HSS_B_pair_i     = (int*) malloc(sizeof(int) * HSS_n_r_adm_pair);
+    int *HSS_B_pair_j     = (int*) malloc(sizeof(int) * HSS_n_r_adm_pair);
+    int *HSS_B_pair_v     = (int*) malloc(sizeof(int) * HSS_n_r_adm_pair);
+    int *HSS_B_p2i_rowptr = (int*) malloc(sizeof(int) * (n_node + 1));
+    int *HSS_B_p2i_colidx = (int*) malloc(sizeof(int) * HSS_n_r_adm_pair);
+    int *HSS_B_p2i_val    = (int*) malloc(sizeof(int) * HSS_n_r_adm_pair);
+    ASSERT_PRINTF(HSS_B != NULL, "Failed to allocate %d HSS B matrices\n", HSS_n_r_adm_pair);
+    ASSERT_PRINTF(
+        HSS_B_pair_i != NULL && HSS_B_pair_j != NULL && HSS_B_pair_v != NULL,
+        "Failed to allocate work arrays for indexing HSS Bij pairs\n"
+    );
+    ASSERT_PRINTF(
+        HSS_B_p2i_rowptr != NULL && HSS_B_p2i_colidx != NULL && HSS_B_p2i_val != NULL,
+        "Failed to allocate arrays for indexing HSS Bij pairs\n"
+    );
+    #pragma omp parallel for num_threads(n_thread) schedule(dynamic)
+    for (int i = 0; i < HSS_n_r_adm_pair; i++)
+    {
+        int node0 = HSS_r_adm_pairs[2 * i];
+        int node1 = HSS_r_adm_pairs[2 * i + 1];
+        H2P_dense_mat_p F_pnt = F[parent[node0]];
+        int B_nrow = HSS_U[node0]->ncol;
+        int B_ncol = HSS_U[node1]->ncol;
+        H2P_dense_mat_init(&HSS_B[i], B_nrow, B_ncol);
+        DTYPE *F_blk = F_pnt->data + blk_off[node0] * F_pnt->ld + blk_off[node1];
+        copy_matrix_block(sizeof(DTYPE), B_nrow, B_ncol, F_blk, F_pnt->ld, HSS_B[i]->data, HSS_B[i]->ld);
+        HSS_B_pair_i[i] = node0;
+        HSS_B_pair_j[i] = node1;
+        HSS_B_pair_v[i] = i + 1;
+    }
+    H2P_int_COO_to_CSR(
+        n_node, HSS_n_r_adm_pair, HSS_B_pair_i, HSS_B_pair_j, HSS_B_pair_v,
+        HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val
+    );
+    free(HSS_B_pair_i);
+    free(HSS_B_pair_j);
+    free(HSS_B_pair_v);
+    et = get_wtime_sec();
+    build_B_t += et - st;
+
+    // 6. The F matrices of the leaf nodes are the D matrices
+    st = get_wtime_sec();
+    H2P_dense_mat_p *HSS_D = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_leaf_node);
+    int *HSS_D_pair2idx = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(HSS_D != NULL && HSS_D_pair2idx != NULL, "Failed to allocate %d HSS D matrices\n", n_leaf_node);
+    memset(HSS_D_pair2idx, 0, sizeof(int) * n_node);
+    for (int i = 0; i < n_leaf_node; i++)
+    {
+        int node = leaf_nodes[i];
+        HSS_D_pair2idx[node] = i;
+        HSS_D[i] = F[node];
+        F[node]  = NULL;
+        for (int k = 0; k < HSS_D[i]->nrow; k++)
+            HSS_D[i]->data[k * HSS_D[i]->ld + k] += shift;
+    }
+    et = get_wtime_sec();
+    build_D_t += et - st;
+
+    // 7. Wrap the new HSS matrix
+    H2P_SPDHSS_H2_wrap_new_HSS(
+        tree, HSS_U, HSS_B, HSS_D, HSS_B_p2i_rowptr, HSS_B_p2i_colidx,
+        HSS_B_p2i_val, HSS_D_pair2idx, hssmat_
+    );
+    (*hssmat_)->n_UJ = n_node;
+    (*hssmat_)->timers[U_BUILD_TIMER_IDX] = build_U_t;
+    (*hssmat_)->timers[B_BUILD_TIMER_IDX] = build_B_t;
+    (*hssmat_)->timers[D_BUILD_TIMER_IDX] = build_D_t;
+
+    // 8. Delete intermediate arrays and matrices
+    for (int i = 0; i < n_node; i++)
+        H2P_dense_mat_destroy(&F[i]);
+    for (int i = 0; i < HSS_n_r_adm_pair; i++)
+        H2P_dense_mat_destroy(&HSS_B[i]);
+    for (int i = 0; i < n_leaf_node; i++)
+        H2P_dense_mat_destroy(&HSS_D[i]);
+    free(F);
+    free(HSS_B);
+    free(HSS_D);
+    free(blk_off);
+    free(HSS_D_pair2idx);
+    free(HSS_B_p2i_rowptr);
+    free(HSS_B_p2i_colidx);
+    free(HSS_B_p2i_val);
+}
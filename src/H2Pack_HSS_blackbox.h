@@ -0,0 +1,62 @@
+#ifndef __H2PACK_HSS_BLACKBOX_H__
+#define __H2PACK_HSS_BLACKBOX_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Operator matrix-matrix multiplication function pointer, mat_y := A * mat_x
+// Input parameters:
+//   op_param : Pointer to operator parameters
+//   n_vec    : Number of column vectors in mat_x
+//   mat_x    : Size >= ldx * n_vec, column-major input dense matrix, each column 
+//              is a vector of size krnl_mat_size in the original point ordering
+//   ldx      : Leading dimension of mat_x, >= krnl_mat_size
+//   ldy      : Leading dimension of mat_y, >= krnl_mat_size
+// Output parameter:
+//   mat_y : Size >= ldy * n_vec, column-major output dense matrix, mat_y := A * mat_x
+typedef void (*op_matmul_fptr) (
+    void *op_param, const int n_vec, const DTYPE *mat_x, const int ldx, 
+    DTYPE *mat_y, const int ldy
+);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Construct an HSS matrix from a symmetric operator A that is only available 
+// through matrix-matrix multiplications, e.g., a sum of H2 matrices plus a sparse 
+// matrix. A single block of Gaussian random vectors is multiplied by A, then the 
+// HSS bases and the B and D matrices are extracted from the samples level by level 
+// from the leaf nodes to the root node using the null space of the sampling matrix 
+// of each node (Levitt & Martinsson, black-box HBS compression). The number of 
+// sampling vectors is about (max_child + 1) * max_rank or max_leaf_points * krnl_dim 
+// plus max_rank, whichever is larger.
+// Input parameters:
+//   tree      : H2Pack structure after H2P_partition_points(), its point partitioning 
+//               and HSS admissible pairs are used. HSS admissible pairs, permutation 
+//               indices, and admissible pair counts are computed in tree if not available
+//   op_matmul : Operator matrix-matrix multiplication function
+//   op_param  : Pointer to operator parameters, passed to op_matmul
+//   max_rank  : Maximum rank of the HSS matrix
+//   reltol    : Relative tolerance in column-pivoted QR
+//   shift     : Diagonal shifting
+// Output parameter:
+//   *hssmat_ : The constructed HSS matrix, A_{HSS} ~= A + shift * I, it can be used 
+//              in H2P_matvec(), H2P_matmul(), and H2P_HSS_ULV_*() functions
+// Note: 
+//   A_{HSS} is NOT guaranteed to be SPD even if A + shift * I is SPD. The low-rank
+//   truncation errors are not controlled by shift, and A_{HSS} becomes indefinite 
+//   once they exceed the smallest eigenvalue of A + shift * I. This happens when 
+//   max_rank caps the ranks, e.g., for a large number of points. Use H2P_HSS_ULV_LU_*() 
+//   functions to factorize A_{HSS}, or increase max_rank before using the Cholesky 
+//   ULV. H2P_SPDHSS_H2_build() keeps the SPD property if A is an H2 matrix.
+void H2P_HSS_blackbox_build(
+    H2Pack_p tree, op_matmul_fptr op_matmul, void *op_param, const int max_rank, 
+    const DTYPE reltol, const DTYPE shift, H2Pack_p *hssmat_
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
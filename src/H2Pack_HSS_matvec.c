@@ -0,0 +1,508 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_matvec.h"
+#include "H2Pack_matmul.h"
+#include "H2Pack_HSS_matvec.h"
+#include "H2Pack_utils.h"
+#include "utils.h"
+
+// Check if an HSS representation only has sibling couplings and prepare the
+// metadata and buffer for H2P_HSS_matvec() and H2P_HSS_matmul()
+int H2P_HSS_matvec_init(H2Pack_p h2pack)
+{
+    if (h2pack->HSS_mv_mode != 0) return (h2pack->HSS_mv_mode == 1);
+    h2pack->HSS_mv_mode = -1;
+    if (h2pack->is_HSS != 1 || h2pack->BD_JIT != 0) return 0;
+    if (h2pack->U == NULL || h2pack->B_data == NULL || h2pack->D_data == NULL) return 0;
+    if (h2pack->n_UJ < h2pack->n_node || h2pack->HSS_n_r_inadm_pair != 0) return 0;
+    if (h2pack->n_D != h2pack->n_leaf_node) return 0;
+
+    int n_node        = h2pack->n_node;
+    int root_idx      = h2pack->root_idx;
+    int max_child     = h2pack->max_child;
+    int max_level     = h2pack->max_level;
+    int n_leaf_node   = h2pack->n_leaf_node;
+    int n_pair        = h2pack->HSS_n_r_adm_pair;
+    int *parent       = h2pack->parent;
+    int *children     = h2pack->children;
+    int *n_child      = h2pack->n_child;
+    int *level_nodes  = h2pack->level_nodes;
+    int *level_n_node = h2pack->level_n_node;
+    int *mat_cluster  = h2pack->mat_cluster;
+    int *adm_pairs    = h2pack->HSS_r_adm_pairs;
+    H2P_dense_mat_p *U = h2pack->U;
+
+    int *spos     = (int*) malloc(sizeof(int) * (n_node + 1));
+    int *D_idx    = (int*) malloc(sizeof(int) * n_node);
+    int *pair_ptr = (int*) malloc(sizeof(int) * (n_node + 1));
+    int *pairs    = (int*) malloc(sizeof(int) * (3 * n_pair + 1));
+    ASSERT_PRINTF(
+        spos != NULL && D_idx != NULL && pair_ptr != NULL && pairs != NULL,
+        "Failed to allocate HSS matvec metadata arrays for %d nodes and %d pairs\n", n_node, n_pair
+    );
+
+    // 1. Check U sizes, find the diagonal D matrix of each leaf node
+    int is_valid = 1;
+    for (int node = 0; node < n_node; node++)
+    {
+        D_idx[node] = -1;
+        H2P_dense_mat_p U_node = U[node];
+        if (node == root_idx) continue;
+        if (n_child[node] == 0)
+        {
+            int nrow = mat_cluster[2 * node + 1] - mat_cluster[2 * node] + 1;
+            if (U_node->ncol > 0 && U_node->nrow != nrow) is_valid = 0;
+            int D_idx_ = H2P_get_int_CSR_elem(
+                h2pack->D_p2i_rowptr, h2pack->D_p2i_colidx, h2pack->D_p2i_val, node, node
+            );
+            if (D_idx_ <= 0) is_valid = 0;
+            else D_idx[node] = D_idx_ - 1;
+        } else {
+            int sum_child_rank = 0;
+            int *node_children = children + node * max_child;
+            for (int k = 0; k < n_child[node]; k++) sum_child_rank += U[node_children[k]]->ncol;
+            if (U_node->ncol > 0 && U_node->nrow != sum_child_rank) is_valid = 0;
+        }
+    }
+    if (n_child[root_idx] == 0)
+    {
+        int D_idx_ = H2P_get_int_CSR_elem(
+            h2pack->D_p2i_rowptr, h2pack->D_p2i_colidx, h2pack->D_p2i_val, root_idx, root_idx
+        );
+        if (D_idx_ <= 0) is_valid = 0;
+        else D_idx[root_idx] = D_idx_ - 1;
+    }
+
+    // 2. Group the sibling pairs by their parent node, B{n0, n1} is stored as
+    //    B_data + B_ptr[B_idx] with size U{n0}->ncol * U{n1}->ncol
+    memset(pair_ptr, 0, sizeof(int) * (n_node + 1));
+    for (int i = 0; i < n_pair; i++)
+    {
+        int node0 = adm_pairs[2 * i];
+        int node1 = adm_pairs[2 * i + 1];
+        if (node0 == root_idx || node1 == root_idx || parent[node0] != parent[node1])
+        {
+            is_valid = 0;
+            break;
+        }
+        pair_ptr[parent[node0] + 1]++;
+    }
+    for (int i = 0; i < n_node; i++) pair_ptr[i + 1] += pair_ptr[i];
+    for (int i = 0; i < n_pair && is_valid; i++)
+    {
+        int node0 = adm_pairs[2 * i];
+        int node1 = adm_pairs[2 * i + 1];
+        int B_idx = H2P_get_int_CSR_elem(
+            h2pack->B_p2i_rowptr, h2pack->B_p2i_colidx, h2pack->B_p2i_val, node0, node1
+        );
+        if (B_idx == 0)
+        {
+            is_valid = 0;
+            break;
+        }
+        if (B_idx < 0)
+        {
+            int tmp = node0;
+            node0  = node1;
+            node1  = tmp;
+            B_idx  = -B_idx;
+        }
+        B_idx--;
+        if (h2pack->B_nrow[B_idx] != U[node0]->ncol || h2pack->B_ncol[B_idx] != U[node1]->ncol) is_valid = 0;
+        int *pair_k = pairs + 3 * pair_ptr[parent[node0]];
+        pair_k[0] = node0;
+        pair_k[1] = node1;
+        pair_k[2] = B_idx;
+        pair_ptr[parent[node0]]++;
+    }
+    for (int i = n_node; i > 0; i--) pair_ptr[i] = pair_ptr[i - 1];
+    pair_ptr[0] = 0;
+
+    // 3. Each level's y0 and y1 are stored contiguously, and each node's
+    //    children are stored contiguously and in the same order as U{node}
+    spos[root_idx] = 0;
+    int total_rank = 0;
+    for (int i = 1; i <= max_level; i++)
+    {
+        int *level_i1_nodes = level_nodes + (i - 1) * n_leaf_node;
+        for (int j = 0; j < level_n_node[i - 1]; j++)
+        {
+            int node = level_i1_nodes[j];
+            int *node_children = children + node * max_child;
+            for (int k = 0; k < n_child[node]; k++)
+            {
+                int child_k = node_children[k];
+                spos[child_k] = total_rank;
+                total_rank += U[child_k]->ncol;
+            }
+        }
+    }
+    spos[n_node] = total_rank;
+
+    if (is_valid == 0)
+    {
+        free(spos);
+        free(D_idx);
+        free(pair_ptr);
+        free(pairs);
+        return 0;
+    }
+    h2pack->HSS_mv_spos     = spos;
+    h2pack->HSS_mv_D_idx    = D_idx;
+    h2pack->HSS_mv_pair_ptr = pair_ptr;
+    h2pack->HSS_mv_pairs    = pairs;
+    h2pack->HSS_mv_mode     = 1;
+    return 1;
+}
+
+// Make sure the y0 and y1 buffer can hold n_vec vectors
+static void H2P_HSS_matvec_alloc_buf(H2Pack_p h2pack, const int n_vec)
+{
+    if (h2pack->HSS_mv_nvec >= n_vec) return;
+    size_t buf_size = (size_t) h2pack->HSS_mv_spos[h2pack->n_node] * (size_t) n_vec * 2;
+    free_aligned(h2pack->HSS_mv_buf);
+    h2pack->HSS_mv_buf = (DTYPE*) malloc_aligned(sizeof(DTYPE) * (buf_size + 1), 64);
+    ASSERT_PRINTF(h2pack->HSS_mv_buf != NULL, "Failed to allocate HSS matvec buffer of size %zu\n", buf_size);
+    h2pack->HSS_mv_nvec = n_vec;
+}
+
+// Calculate Y := op(A) * X + beta * Y, X and Y are row-major matrices with n_vec columns
+static void H2P_HSS_mv_gemm(
+    const CBLAS_TRANSPOSE A_trans, const int m, const int n_vec, const int k,
+    const DTYPE *A, const int lda, const DTYPE *X, const int ldx,
+    const DTYPE beta, DTYPE *Y, const int ldy
+)
+{
+    if (m == 0 || n_vec == 0) return;
+    if (k == 0)
+    {
+        if (beta == 0.0)
+        {
+            for (int i = 0; i < m; i++) memset(Y + i * ldy, 0, sizeof(DTYPE) * n_vec);
+        }
+        return;
+    }
+    if (n_vec == 1)
+    {
+        int A_nrow = (A_trans == CblasNoTrans) ? m : k;
+        int A_ncol = (A_trans == CblasNoTrans) ? k : m;
+        CBLAS_GEMV(CblasRowMajor, A_trans, A_nrow, A_ncol, 1.0, A, lda, X, ldx, beta, Y, ldy);
+    } else {
+        CBLAS_GEMM(CblasRowMajor, A_trans, CblasNoTrans, m, n_vec, k, 1.0, A, lda, X, ldx, beta, Y, ldy);
+    }
+}
+
+// Calculate the output of a leaf node, y_i := U_i * y1_i + D_i * x_i
+static void H2P_HSS_mv_leaf_output(
+    H2Pack_p h2pack, const int node, const int n_vec, const DTYPE *y1_node,
+    const DTYPE *mat_x, const int ldx, const int x_row_stride, const CBLAS_TRANSPOSE x_trans,
+    DTYPE *mat_y, const int ldy, const int y_row_stride
+)
+{
+    int s_row = h2pack->mat_cluster[2 * node];
+    int e_row = h2pack->mat_cluster[2 * node + 1];
+    int nrow  = e_row - s_row + 1;
+    int D_idx = h2pack->HSS_mv_D_idx[node];
+    int rank  = (node == h2pack->root_idx) ? 0 : h2pack->U[node]->ncol;
+    const DTYPE *mat_x_blk = mat_x + s_row * x_row_stride;
+    DTYPE *mat_y_blk = mat_y + s_row * y_row_stride;
+    DTYPE *D_data = h2pack->D_data + h2pack->D_ptr[D_idx];
+    H2P_dense_mat_p U_node = h2pack->U[node];
+
+    // y1 and U{node} are always stored in row-major style, x and y are
+    // stored in column-major style if x_trans == CblasTrans
+    if (x_trans == CblasNoTrans)
+    {
+        H2P_HSS_mv_gemm(
+            CblasNoTrans, nrow, n_vec, rank, U_node->data, U_node->ld,
+            y1_node, n_vec, 0.0, mat_y_blk, ldy
+        );
+        DTYPE beta = (rank > 0) ? 1.0 : 0.0;
+        H2P_HSS_mv_gemm(
+            CblasNoTrans, nrow, n_vec, nrow, D_data, nrow,
+            mat_x_blk, ldx, beta, mat_y_blk, ldy
+        );
+    } else {
+        DTYPE beta = 0.0;
+        if (rank > 0)
+        {
+            CBLAS_GEMM(
+                CblasRowMajor, CblasTrans, CblasTrans, n_vec, nrow, rank,
+                1.0, y1_node, n_vec, U_node->data, U_node->ld, 0.0, mat_y_blk, ldy
+            );
+            beta = 1.0;
+        }
+        CBLAS_GEMM(
+            CblasRowMajor, CblasNoTrans, CblasTrans, n_vec, nrow, nrow,
+            1.0, mat_x_blk, ldx, D_data, nrow, beta, mat_y_blk, ldy
+        );
+    }
+}
+
+// HSS matvec / matmul on permuted input and output, see H2P_matmul_fwd_transform()
+// for the definitions of ldx, x_row_stride, and x_trans. mat_y uses the same
+// layout as mat_x.
+static void H2P_HSS_matmul_pmt(
+    H2Pack_p h2pack, const int n_vec,
+    const DTYPE *mat_x, const int ldx, const int x_row_stride, const CBLAS_TRANSPOSE x_trans,
+    DTYPE *mat_y, const int ldy, const int y_row_stride
+)
+{
+    int    n_thread      = h2pack->n_thread;
+    int    n_node        = h2pack->n_node;
+    int    root_idx      = h2pack->root_idx;
+    int    max_child     = h2pack->max_child;
+    int    max_level     = h2pack->max_level;
+    int    n_leaf_node   = h2pack->n_leaf_node;
+    int    *children     = h2pack->children;
+    int    *n_child      = h2pack->n_child;
+    int    *level_nodes  = h2pack->level_nodes;
+    int    *level_n_node = h2pack->level_n_node;
+    int    *mat_cluster  = h2pack->mat_cluster;
+    int    *spos         = h2pack->HSS_mv_spos;
+    int    *pair_ptr     = h2pack->HSS_mv_pair_ptr;
+    int    *pairs        = h2pack->HSS_mv_pairs;
+    double *timers       = h2pack->timers;
+    H2P_dense_mat_p *U   = h2pack->U;
+    double st, et;
+
+    H2P_HSS_matvec_alloc_buf(h2pack, n_vec);
+    DTYPE *y0 = h2pack->HSS_mv_buf;
+    DTYPE *y1 = h2pack->HSS_mv_buf + (size_t) spos[n_node] * (size_t) n_vec;
+
+    if (n_child[root_idx] == 0)
+    {
+        st = get_wtime_sec();
+        H2P_HSS_mv_leaf_output(
+            h2pack, root_idx, n_vec, NULL,
+            mat_x, ldx, x_row_stride, x_trans, mat_y, ldy, y_row_stride
+        );
+        et = get_wtime_sec();
+        timers[MV_DEN_TIMER_IDX] += et - st;
+        return;
+    }
+
+    // 1. Upward sweep, y0{i} := U{i}^T * x{i} for a leaf node, or
+    //    y0{i} := U{i}^T * [y0{children of i}] for a non-leaf node
+    st = get_wtime_sec();
+    for (int i = max_level; i >= 1; i--)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int level_i_n_node = level_n_node[i];
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+        #pragma omp parallel for num_threads(n_thread_i) schedule(dynamic)
+        for (int j = 0; j < level_i_n_node; j++)
+        {
+            int node = level_i_nodes[j];
+            H2P_dense_mat_p U_node = U[node];
+            if (U_node->ncol == 0) continue;
+            DTYPE *y0_node = y0 + (size_t) spos[node] * (size_t) n_vec;
+            if (n_child[node] == 0)
+            {
+                int s_row = mat_cluster[2 * node];
+                int e_row = mat_cluster[2 * node + 1];
+                int nrow  = e_row - s_row + 1;
+                const DTYPE *mat_x_blk = mat_x + s_row * x_row_stride;
+                if (x_trans == CblasNoTrans)
+                {
+                    H2P_HSS_mv_gemm(
+                        CblasTrans, U_node->ncol, n_vec, nrow, U_node->data, U_node->ld,
+                        mat_x_blk, ldx, 0.0, y0_node, n_vec
+                    );
+                } else {
+                    CBLAS_GEMM(
+                        CblasRowMajor, CblasTrans, CblasTrans, U_node->ncol, n_vec, nrow,
+                        1.0, U_node->data, U_node->ld, mat_x_blk, ldx, 0.0, y0_node, n_vec
+                    );
+                }
+            } else {
+                int child_0 = children[node * max_child];
+                DTYPE *y0_child = y0 + (size_t) spos[child_0] * (size_t) n_vec;
+                H2P_HSS_mv_gemm(
+                    CblasTrans, U_node->ncol, n_vec, U_node->nrow, U_node->data, U_node->ld,
+                    y0_child, n_vec, 0.0, y0_node, n_vec
+                );
+            }
+        }  // End of j loop
+    }  // End of i loop
+    et = get_wtime_sec();
+    timers[MV_FWD_TIMER_IDX] += et - st;
+
+    // 2. Downward sweep, for each non-leaf node p and its children c:
+    //    y1{c} := U{p} * y1{p} (telescoping), y1{c0} += B{c0, c1} * y0{c1},
+    //    y1{c1} += B{c0, c1}^T * y0{c0}, and y{c} := U{c} * y1{c} + D{c} * x{c}
+    //    if c is a leaf node. Each node's y1 is only updated by its parent's task.
+    st = get_wtime_sec();
+    for (int i = 0; i < max_level; i++)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int level_i_n_node = level_n_node[i];
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+        #pragma omp parallel for num_threads(n_thread_i) schedule(dynamic)
+        for (int j = 0; j < level_i_n_node; j++)
+        {
+            int node = level_i_nodes[j];
+            int n_child_node = n_child[node];
+            if (n_child_node == 0) continue;
+            int *node_children = children + node * max_child;
+            int child_0 = node_children[0];
+            int child_e = node_children[n_child_node - 1];
+            int sum_child_rank = spos[child_e] + U[child_e]->ncol - spos[child_0];
+            DTYPE *y1_child = y1 + (size_t) spos[child_0] * (size_t) n_vec;
+
+            // (1) Pass the parent's y1 to its children
+            H2P_dense_mat_p U_node = U[node];
+            int rank = (node == root_idx) ? 0 : U_node->ncol;
+            DTYPE *y1_node = y1 + (size_t) spos[node] * (size_t) n_vec;
+            H2P_HSS_mv_gemm(
+                CblasNoTrans, sum_child_rank, n_vec, rank, U_node->data, U_node->ld,
+                y1_node, n_vec, 0.0, y1_child, n_vec
+            );
+
+            // (2) Sibling couplings
+            for (int k = pair_ptr[node]; k < pair_ptr[node + 1]; k++)
+            {
+                int node0 = pairs[3 * k];
+                int node1 = pairs[3 * k + 1];
+                int B_idx = pairs[3 * k + 2];
+                int rank0 = U[node0]->ncol;
+                int rank1 = U[node1]->ncol;
+                if (rank0 == 0 || rank1 == 0) continue;
+                DTYPE *B_data = h2pack->B_data + h2pack->B_ptr[B_idx];
+                DTYPE *y0_0 = y0 + (size_t) spos[node0] * (size_t) n_vec;
+                DTYPE *y0_1 = y0 + (size_t) spos[node1] * (size_t) n_vec;
+                DTYPE *y1_0 = y1 + (size_t) spos[node0] * (size_t) n_vec;
+                DTYPE *y1_1 = y1 + (size_t) spos[node1] * (size_t) n_vec;
+                H2P_HSS_mv_gemm(CblasNoTrans, rank0, n_vec, rank1, B_data, rank1, y0_1, n_vec, 1.0, y1_0, n_vec);
+                H2P_HSS_mv_gemm(CblasTrans,   rank1, n_vec, rank0, B_data, rank1, y0_0, n_vec, 1.0, y1_1, n_vec);
+            }
+
+            // (3) Leaf children output
+            for (int k = 0; k < n_child_node; k++)
+            {
+                int child_k = node_children[k];
+                if (n_child[child_k] > 0) continue;
+                DTYPE *y1_k = y1 + (size_t) spos[child_k] * (size_t) n_vec;
+                H2P_HSS_mv_leaf_output(
+                    h2pack, child_k, n_vec, y1_k,
+                    mat_x, ldx, x_row_stride, x_trans, mat_y, ldy, y_row_stride
+                );
+            }
+        }  // End of j loop
+    }  // End of i loop
+    et = get_wtime_sec();
+    timers[MV_BWD_TIMER_IDX] += et - st;
+}
+
+// HSS representation multiplies a column vector
+void H2P_HSS_matvec(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
+{
+    double st, et;
+    int    krnl_mat_size = h2pack->krnl_mat_size;
+    DTYPE  *pmt_x        = h2pack->pmt_x;
+    DTYPE  *pmt_y        = h2pack->pmt_y;
+    double *timers       = h2pack->timers;
+    size_t *mat_size     = h2pack->mat_size;
+
+    // 1. Forward permute the input vector
+    st = get_wtime_sec();
+    H2P_permute_vector_forward(h2pack, x, pmt_x);
+    et = get_wtime_sec();
+    timers[MV_VOP_TIMER_IDX] += et - st;
+    mat_size[MV_VOP_SIZE_IDX] += 2 * krnl_mat_size;
+
+    // 2. Telescoping HSS product, each element of pmt_y is written exactly once
+    H2P_HSS_matmul_pmt(
+        h2pack, 1, pmt_x, 1, 1, CblasNoTrans,
+        pmt_y, 1, 1
+    );
+
+    // 3. Backward permute the output vector
+    st = get_wtime_sec();
+    H2P_permute_vector_backward(h2pack, pmt_y, y);
+    et = get_wtime_sec();
+    timers[MV_VOP_TIMER_IDX] += et - st;
+    mat_size[MV_VOP_SIZE_IDX] += 2 * krnl_mat_size;
+
+    h2pack->n_matvec++;
+}
+
+// HSS representation multiplies a dense general matrix
+void H2P_HSS_matmul(
+    H2Pack_p h2pack, const CBLAS_LAYOUT layout, const int n_vec,
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+)
+{
+    double st, et;
+    int    krnl_mat_size = h2pack->krnl_mat_size;
+    int    mm_max_n_vec  = h2pack->mm_max_n_vec;
+    double *timers       = h2pack->timers;
+    size_t *mat_size     = h2pack->mat_size;
+
+    size_t pmt_xy_size = (size_t) krnl_mat_size * (size_t) mm_max_n_vec;
+    free(h2pack->pmt_x);
+    free(h2pack->pmt_y);
+    h2pack->pmt_x = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    h2pack->pmt_y = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    ASSERT_PRINTF(
+        h2pack->pmt_x != NULL && h2pack->pmt_y != NULL,
+        "Failed to allocate working arrays of size %zu for matmul\n", 2 * pmt_xy_size
+    );
+    DTYPE *pmt_x = h2pack->pmt_x;
+    DTYPE *pmt_y = h2pack->pmt_y;
+
+    int x_col_stride, y_col_stride, pmt_row_stride, ld_pmt;
+    CBLAS_TRANSPOSE xy_trans;
+    if (layout == CblasRowMajor)
+    {
+        x_col_stride   = 1;
+        y_col_stride   = 1;
+        ld_pmt         = mm_max_n_vec;
+        pmt_row_stride = ld_pmt;
+        xy_trans       = CblasNoTrans;
+    } else {
+        x_col_stride   = ldx;
+        y_col_stride   = ldy;
+        ld_pmt         = krnl_mat_size;
+        pmt_row_stride = 1;
+        xy_trans       = CblasTrans;
+    }
+
+    for (int i_vec = 0; i_vec < n_vec; i_vec += mm_max_n_vec)
+    {
+        int curr_n_vec = (i_vec + mm_max_n_vec <= n_vec) ? mm_max_n_vec : (n_vec - i_vec);
+        const DTYPE *curr_mat_x = mat_x + i_vec * x_col_stride;
+        DTYPE *curr_mat_y = mat_y + i_vec * y_col_stride;
+
+        // 1. Forward permute input matrix block
+        st = get_wtime_sec();
+        H2P_permute_matrix_row_forward(h2pack, layout, curr_n_vec, curr_mat_x, ldx, pmt_x, ld_pmt);
+        et = get_wtime_sec();
+        timers[MV_VOP_TIMER_IDX] += et - st;
+        mat_size[MV_VOP_SIZE_IDX] += 2 * krnl_mat_size * curr_n_vec;
+
+        // 2. Telescoping HSS product, no need to reset the output matrix
+        H2P_HSS_matmul_pmt(
+            h2pack, curr_n_vec,
+            pmt_x, ld_pmt, pmt_row_stride, xy_trans,
+            pmt_y, ld_pmt, pmt_row_stride
+        );
+
+        // 3. Backward permute the output matrix
+        st = get_wtime_sec();
+        H2P_permute_matrix_row_backward(h2pack, layout, curr_n_vec, pmt_y, ld_pmt, curr_mat_y, ldy);
+        et = get_wtime_sec();
+        timers[MV_VOP_TIMER_IDX] += et - st;
+        mat_size[MV_VOP_SIZE_IDX] += 2 * krnl_mat_size * curr_n_vec;
+    }  // End of i_vec loop
+
+    h2pack->n_matvec += n_vec;
+}
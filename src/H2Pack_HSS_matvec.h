@@ -0,0 +1,55 @@
+#ifndef __H2PACK_HSS_MATVEC_H__
+#define __H2PACK_HSS_MATVEC_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Check if an HSS representation only has sibling couplings and prepare the
+// metadata and buffer for H2P_HSS_matvec() and H2P_HSS_matmul()
+// Input parameter:
+//   h2pack : H2Pack structure with HSS representation matrices
+// Output parameters:
+//   h2pack : H2Pack structure with HSS matvec metadata
+//   <ret>  : 1 if the HSS matvec engine can be used, otherwise 0. The result
+//            is cached in h2pack->HSS_mv_mode, only the first call does the check
+// Notes:
+//   1. The HSS matvec engine requires h2pack->BD_JIT == 0, each B matrix couples
+//      two sibling nodes, and each leaf node only has a diagonal D matrix. 
+//      Otherwise, including all HSS matrices built with BD_JIT == 1, H2P_matvec()
+//      and H2P_matmul() use the generic H2 matvec / matmul with HSS_r_adm_pairs.
+//   2. This function writes the shared HSS_mv_* metadata on the first call and is 
+//      not thread-safe. H2P_matvec_ws_init() calls it before copying h2pack, so 
+//      multiplications with workspaces never call it again.
+int H2P_HSS_matvec_init(H2Pack_p h2pack);
+
+// HSS representation multiplies a column vector using a telescoping product
+// over the sibling couplings. Each node's U^T * x and B * U^T * x results
+// are stored in one contiguous buffer, no thread-local output vector is used.
+// This function is called by H2P_matvec() automatically when
+// H2P_HSS_matvec_init() returns 1.
+// Input parameters:
+//   h2pack : H2Pack structure with HSS representation matrices
+//   x      : Input dense vector
+// Output parameter:
+//   y : Output dense vector
+void H2P_HSS_matvec(H2Pack_p h2pack, const DTYPE *x, DTYPE *y);
+
+// HSS representation multiplies a dense general matrix, see H2P_HSS_matvec().
+// This function is called by H2P_matmul() automatically when
+// H2P_HSS_matvec_init() returns 1.
+// Input parameters: the same as H2P_matmul()
+// Output parameter: the same as H2P_matmul()
+void H2P_HSS_matmul(
+    H2Pack_p h2pack, const CBLAS_LAYOUT layout, const int n_vec,
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
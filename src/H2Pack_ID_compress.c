@@ -107,6 +107,15 @@ void H2P_partial_pivot_QR(
             rank = i;
             break;
         }
+        // norm_p == 0 happens when the remaining columns are exactly zero, e.g., 
+        // kernel values underflow. Stop to avoid 1/0. If A is all zero, keep one 
+        // column with R11 = 1 so the ID still gives a nonempty and exact basis.
+        if (norm_p == 0.0)
+        {
+            if (i == 0) R[0] = 1.0;
+            rank = MAX(i, 1);
+            break;
+        }
         
         // 2. Swap the column
         if (i != pivot)
@@ -262,6 +271,14 @@ void H2P_partial_pivot_QR_kdim(
             rank = i * kdim;
             break;
         }
+        // Same as H2P_partial_pivot_QR(): keep one column block for a zero matrix
+        if (norm_p == 0.0)
+        {
+            if (i == 0)
+                for (int k = 0; k < kdim; k++) R[k * ldR + k] = 1.0;
+            rank = MAX(i, 1) * kdim;
+            break;
+        }
         
         // 2. Swap the column
         if (i != pivot)
@@ -0,0 +1,343 @@
+#ifndef __H2PACK_ND_KERNELS_H__
+#define __H2PACK_ND_KERNELS_H__
+
+#include <math.h>
+
+#include "H2Pack_config.h"
+#include "ASTER/include/aster.h"
+
+#ifndef KRNL_EVAL_PARAM
+#define KRNL_EVAL_PARAM \
+    const DTYPE *coord0, const int ld0, const int n0, \
+    const DTYPE *coord1, const int ld1, const int n1, \
+    const void *param, DTYPE * __restrict mat, const int ldm
+#endif
+
+#ifndef KRNL_BIMV_PARAM
+#define KRNL_BIMV_PARAM \
+    const DTYPE *coord0, const int ld0, const int n0,            \
+    const DTYPE *coord1, const int ld1, const int n1,            \
+    const void *param, const DTYPE *x_in_0, const DTYPE *x_in_1, \
+    DTYPE * __restrict x_out_0, DTYPE * __restrict x_out_1
+#endif
+
+// Kernels in this file work for any point dimension. The point dimension is
+// not passed to a kernel function, so all kernels here use the parameter array
+//   param[0] = l, param[1] = (DTYPE) pt_dim
+// where l has the same meaning as in the 2D / 3D kernels.
+
+// When counting bimv flops, report effective flops (1 / sqrt(x) == 2 flops)
+// instead of achieved flops (1 / sqrt(x) == 1 + NEWTON_ITER * 4 flops)
+
+#define NSQRT3 -1.7320508075688772
+#define NSQRT5 -2.2360679774997896
+#define _1o3    0.3333333333333333
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Squared distances between two points coord0(:, i0), coord0(:, i1)
+// and SIMD_LEN points coord1(:, j : j+SIMD_LEN-1)
+static inline void ND_strip_r2_2rows(
+    const int pt_dim, const DTYPE *coord0, const int ld0, const int i0, const int i1,
+    const DTYPE *coord1, const int ld1, const int j, vec_t *r20_, vec_t *r21_
+)
+{
+    vec_t d0, d1, jv, r20, r21;
+    jv  = vec_loadu_t(coord1 + j);
+    d0  = vec_sub_t(vec_bcast_t(coord0 + i0), jv);
+    d1  = vec_sub_t(vec_bcast_t(coord0 + i1), jv);
+    r20 = vec_mul_t(d0, d0);
+    r21 = vec_mul_t(d1, d1);
+    for (int k = 1; k < pt_dim; k++)
+    {
+        const DTYPE *coord0_k = coord0 + k * ld0;
+        jv  = vec_loadu_t(coord1 + k * ld1 + j);
+        d0  = vec_sub_t(vec_bcast_t(coord0_k + i0), jv);
+        d1  = vec_sub_t(vec_bcast_t(coord0_k + i1), jv);
+        r20 = vec_fmadd_t(d0, d0, r20);
+        r21 = vec_fmadd_t(d1, d1, r21);
+    }
+    *r20_ = r20;
+    *r21_ = r21;
+}
+
+// Squared distance between two points coord0(:, i) and coord1(:, j)
+static inline DTYPE ND_point_r2(
+    const int pt_dim, const DTYPE *coord0, const int ld0, const int i,
+    const DTYPE *coord1, const int ld1, const int j
+)
+{
+    DTYPE r2 = 0.0;
+    for (int k = 0; k < pt_dim; k++)
+    {
+        DTYPE d = coord0[k * ld0 + i] - coord1[k * ld1 + j];
+        r2 += d * d;
+    }
+    return r2;
+}
+
+// ============================================================ //
+// ====================   Gaussian Kernel   =================== //
+// ============================================================ //
+
+#define Gaussian_ND_krnl_bimv_flop(pt_dim) (3 * (pt_dim) + 5)
+
+static void Gaussian_ND_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l  = -param_[0];
+    const int   pt_dim = (int) param_[1];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t r20, r21;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i1, coord1, ld1, j, &r20, &r21);
+            r20 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            r21 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE r2 = ND_point_r2(pt_dim, coord0, ld0, ii, coord1, ld1, j);
+                mat_irow[j] = exp(neg_l * r2);
+            }
+        }
+    }
+}
+
+static void Gaussian_ND_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE neg_l  = -param_[0];
+    const int   pt_dim = (int) param_[1];
+    const vec_t neg_l_v = vec_set1_t(neg_l);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, r20, r21;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i + 1, coord1, ld1, j, &r20, &r21);
+
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+
+            r20 = vec_exp_t(vec_mul_t(neg_l_v, r20));
+            r21 = vec_exp_t(vec_mul_t(neg_l_v, r21));
+
+            sum_v0 = vec_fmadd_t(d0, r20, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r21, sum_v1);
+
+            d1 = vec_fmadd_t(x_in_1_i0v, r20, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r21, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ===================   Matern 3/2 Kernel   ================== //
+// ============================================================ //
+
+#define Matern32_ND_krnl_bimv_flop(pt_dim) (3 * (pt_dim) + 8)
+
+static void Matern32_ND_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const int   pt_dim   = (int) param_[1];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t r20, r21;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i1, coord1, ld1, j, &r20, &r21);
+            r20 = vec_mul_t(vec_sqrt_t(r20), nsqrt3_l_v);
+            r21 = vec_mul_t(vec_sqrt_t(r21), nsqrt3_l_v);
+            r20 = vec_mul_t(vec_sub_t(v_1, r20), vec_exp_t(r20));
+            r21 = vec_mul_t(vec_sub_t(v_1, r21), vec_exp_t(r21));
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE r = sqrt(ND_point_r2(pt_dim, coord0, ld0, ii, coord1, ld1, j));
+                r = r * nsqrt3_l;
+                r = (1.0 - r) * exp(r);
+                mat_irow[j] = r;
+            }
+        }
+    }
+}
+
+static void Matern32_ND_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt3_l = NSQRT3 * param_[0];
+    const int   pt_dim   = (int) param_[1];
+    const vec_t nsqrt3_l_v = vec_set1_t(nsqrt3_l);
+    const vec_t v_1 = vec_set1_t(1.0);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, r0, r1;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i + 1, coord1, ld1, j, &r0, &r1);
+
+            r0 = vec_sqrt_t(r0);
+            r1 = vec_sqrt_t(r1);
+
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+
+            r0 = vec_mul_t(r0, nsqrt3_l_v);
+            r1 = vec_mul_t(r1, nsqrt3_l_v);
+            r0 = vec_mul_t(vec_sub_t(v_1, r0), vec_exp_t(r0));
+            r1 = vec_mul_t(vec_sub_t(v_1, r1), vec_exp_t(r1));
+
+            sum_v0 = vec_fmadd_t(d0, r0, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, r1, sum_v1);
+
+            d1 = vec_fmadd_t(x_in_1_i0v, r0, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, r1, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+// ============================================================ //
+// ===================   Matern 5/2 Kernel   ================== //
+// ============================================================ //
+
+#define Matern52_ND_krnl_bimv_flop(pt_dim) (3 * (pt_dim) + 11)
+
+static void Matern52_ND_eval_intrin_t(KRNL_EVAL_PARAM)
+{
+    const int n1_vec = (n1 / SIMD_LEN) * SIMD_LEN;
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const int   pt_dim   = (int) param_[1];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t v_1   = vec_set1_t(1.0);
+    const vec_t v_1o3 = vec_set1_t(_1o3);
+    // Register blocking: two rows of coord0 share each SIMD strip of coord1.
+    // If n0 is odd, the last row is evaluated twice.
+    for (int i = 0; i < n0; i += 2)
+    {
+        const int i1 = (i + 1 < n0) ? (i + 1) : i;
+        DTYPE *mat_irow0 = mat + i  * ldm;
+        DTYPE *mat_irow1 = mat + i1 * ldm;
+        for (int j = 0; j < n1_vec; j += SIMD_LEN)
+        {
+            vec_t r20, r21;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i1, coord1, ld1, j, &r20, &r21);
+            r20 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r20));
+            r21 = vec_mul_t(nsqrt5_l_v, vec_sqrt_t(r21));
+            r20 = vec_mul_t(vec_fmadd_t(v_1o3, vec_mul_t(r20, r20), vec_sub_t(v_1, r20)), vec_exp_t(r20));
+            r21 = vec_mul_t(vec_fmadd_t(v_1o3, vec_mul_t(r21, r21), vec_sub_t(v_1, r21)), vec_exp_t(r21));
+            vec_storeu_t(mat_irow0 + j, r20);
+            vec_storeu_t(mat_irow1 + j, r21);
+        }
+
+        for (int ii = i; ii <= i1; ii++)
+        {
+            DTYPE *mat_irow = mat + ii * ldm;
+            for (int j = n1_vec; j < n1; j++)
+            {
+                DTYPE r   = sqrt(ND_point_r2(pt_dim, coord0, ld0, ii, coord1, ld1, j));
+                DTYPE lk  = nsqrt5_l * r;
+                DTYPE val = (1.0 - lk + _1o3 * lk * lk) * exp(lk);
+                mat_irow[j] = val;
+            }
+        }
+    }
+}
+
+static void Matern52_ND_krnl_bimv_intrin_t(KRNL_BIMV_PARAM)
+{
+    const DTYPE *param_ = (DTYPE*) param;
+    const DTYPE nsqrt5_l = NSQRT5 * param_[0];
+    const int   pt_dim   = (int) param_[1];
+    const vec_t nsqrt5_l_v = vec_set1_t(nsqrt5_l);
+    const vec_t v_1   = vec_set1_t(1.0);
+    const vec_t v_1o3 = vec_set1_t(_1o3);
+    for (int i = 0; i < n0; i += 2)
+    {
+        vec_t sum_v0 = vec_zero_t();
+        vec_t sum_v1 = vec_zero_t();
+        const vec_t x_in_1_i0v = vec_bcast_t(x_in_1 + i);
+        const vec_t x_in_1_i1v = vec_bcast_t(x_in_1 + i + 1);
+        for (int j = 0; j < n1; j += SIMD_LEN)
+        {
+            vec_t d0, d1, r0, r1, lk0, lk1, val0, val1;
+            ND_strip_r2_2rows(pt_dim, coord0, ld0, i, i + 1, coord1, ld1, j, &r0, &r1);
+
+            r0 = vec_sqrt_t(r0);
+            r1 = vec_sqrt_t(r1);
+
+            d0 = vec_load_t(x_in_0 + j);
+            d1 = vec_load_t(x_out_1 + j);
+
+            lk0  = vec_mul_t(nsqrt5_l_v, r0);
+            val0 = vec_fmadd_t(v_1o3, vec_mul_t(lk0, lk0), vec_sub_t(v_1, lk0));
+            val0 = vec_mul_t(val0, vec_exp_t(lk0));
+
+            lk1  = vec_mul_t(nsqrt5_l_v, r1);
+            val1 = vec_fmadd_t(v_1o3, vec_mul_t(lk1, lk1), vec_sub_t(v_1, lk1));
+            val1 = vec_mul_t(val1, vec_exp_t(lk1));
+
+            sum_v0 = vec_fmadd_t(d0, val0, sum_v0);
+            sum_v1 = vec_fmadd_t(d0, val1, sum_v1);
+
+            d1 = vec_fmadd_t(x_in_1_i0v, val0, d1);
+            d1 = vec_fmadd_t(x_in_1_i1v, val1, d1);
+            vec_store_t(x_out_1 + j, d1);
+        }
+        x_out_0[i]   += vec_reduce_add_t(sum_v0);
+        x_out_0[i+1] += vec_reduce_add_t(sum_v1);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,6 +14,7 @@
 #include "H2Pack_aux_structs.h"
 #include "H2Pack_utils.h"
 #include "H2Pack_SPDHSS_H2.h"
+#include "DAG_task_queue.h"
 #include "utils.h"
 
 // Build explicit U matrices from nested U matrices
@@ -154,63 +155,36 @@ int H2P_tree_common_ancestor_level(
     return level;
 }
 
-// Accumulate partial H2 matvec results for H2P_SPDHSS_H2_build()
+// Total allocated size (in DTYPE) of an array of dense matrices, NULL elements are skipped
+static size_t H2P_SPDHSS_H2_mats_msize(const int n_mat, H2P_dense_mat_p *mats)
+{
+    size_t msize = 0;
+    for (int i = 0; i < n_mat; i++)
+        if (mats[i] != NULL) msize += (size_t) mats[i]->size;
+    return msize;
+}
+
+// H2 matvec upward sweep with n_vec input vectors for H2P_SPDHSS_H2_build()
 // Input parameters:
 //   h2mat : Source H2 matrix structure
-//   n_vec : Use n_vec Gaussian random vectors
+//   n_vec : Number of input vectors
+//   vec   : Size h2mat->krnl_mat_size * n_vec, row-major input vectors
 // Output parameter:
-//   *Yk_ : Matrix, size h2mat->n_node * h2mat->max_level, each non-empty element is 
-//          a matrix of n_vec columns
-void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p **Yk_)
+//   y0 : Size h2mat->n_node, y0[i] = U_i^T * vec(idx_i, :) for nodes with U matrices
+static void H2P_SPDHSS_H2_upward_sweep(H2Pack_p h2mat, const int n_vec, const DTYPE *vec, H2P_dense_mat_p *y0)
 {
-    int n_node          = h2mat->n_node;
     int n_leaf_node     = h2mat->n_leaf_node;
     int n_thread        = h2mat->n_thread;
     int max_level       = h2mat->max_level;
     int max_child       = h2mat->max_child;
     int min_adm_level   = h2mat->min_adm_level;
-    int *parent         = h2mat->parent;
     int *n_child        = h2mat->n_child;
     int *children       = h2mat->children;
     int *level_nodes    = h2mat->level_nodes;
     int *level_n_node   = h2mat->level_n_node;
-    int *leaf_nodes     = h2mat->height_nodes;
-    int *node_level     = h2mat->node_level;
     int *mat_cluster    = h2mat->mat_cluster;
-    int *B_p2i_rowptr   = h2mat->B_p2i_rowptr;
-    int *B_p2i_colidx   = h2mat->B_p2i_colidx;
-    int *D_p2i_rowptr   = h2mat->D_p2i_rowptr;
-    int *D_p2i_colidx   = h2mat->D_p2i_colidx;
     H2P_dense_mat_p  *U = h2mat->U;
-    H2P_thread_buf_p *thread_buf = h2mat->tb;
-
-    // 1. Build explicit U matrix for each node
-    H2P_dense_mat_p *exU;
-    H2P_build_explicit_U(h2mat, &exU);
-
-    // 2. Prepare the Gaussian random matrix vec and Yk_mat
-    // Yk_mat(:, n_vec*(i-1) + 1:n_vec) stores the matvec results for nodes at the i-th level
-    const int kms = h2mat->krnl_mat_size;
-    const int Yk_mat_ld = n_vec * max_level;
-    size_t vec_msize = sizeof(DTYPE) * (size_t) kms * (size_t) n_vec;
-    DTYPE *vec    = (DTYPE*) malloc(vec_msize);
-    DTYPE *Yk_mat = (DTYPE*) malloc(vec_msize * max_level);  // Note: we have max_level+1 levels in total
-    ASSERT_PRINTF(vec != NULL && Yk_mat != NULL, "Failed to allocate space for accu_matvec\n");
-    #pragma omp parallel num_threads(n_thread)
-    {
-        int tid = omp_get_thread_num();
-        int s_row, n_row;
-        calc_block_spos_len(kms, n_thread, tid, &s_row, &n_row);
-        H2P_gen_normal_distribution(0.0, 1.0, (size_t) n_row * (size_t) n_vec, vec + (size_t) s_row * (size_t) n_vec);
-        size_t Yk_mat_offset = (size_t) s_row * (size_t) n_vec * (size_t) max_level;
-        size_t Yk_mat_nelem  = (size_t) n_row * (size_t) n_vec * (size_t) max_level;
-        memset(Yk_mat + Yk_mat_offset, 0, sizeof(DTYPE) * Yk_mat_nelem);
-    }
 
-    // 3. H2 matvec upward sweep
-    H2P_dense_mat_p *y0 = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
-    ASSERT_PRINTF(y0 != NULL, "Failed to allocate %d working matrices\n", n_node);
-    for (int i = 0; i < n_node; i++) y0[i] = NULL;
     for (int i = max_level; i >= min_adm_level; i--)
     {
         int *level_i_nodes = level_nodes + i * n_leaf_node;
@@ -233,7 +207,7 @@ void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p *
                     int s_row = mat_cluster[2 * node];
                     int e_row = mat_cluster[2 * node + 1];
                     int nrow = e_row - s_row + 1;
-                    DTYPE *vec_blk = vec + (size_t)s_row * (size_t)n_vec;
+                    const DTYPE *vec_blk = vec + (size_t)s_row * (size_t)n_vec;
                     CBLAS_GEMM(
                         CblasRowMajor, CblasTrans, CblasNoTrans, U_node->ncol, n_vec, nrow,
                         1.0, U_node->data, U_node->ld, vec_blk, n_vec, 0.0, y0[node]->data, y0[node]->ld
@@ -260,6 +234,63 @@ void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p *
             }  // End of j loop
         }  // End of "#pragma omp parallel"
     }  // End of i loop
+}
+
+// Accumulate partial H2 matvec results for H2P_SPDHSS_H2_build()
+// Input parameters:
+//   h2mat : Source H2 matrix structure
+//   n_vec : Use n_vec Gaussian random vectors
+// Output parameter:
+//   *Yk_         : Matrix, size h2mat->n_node * h2mat->max_level, each non-empty element is 
+//                  a matrix of n_vec columns
+//   *work_msize_ : Size (in DTYPE) of working arrays before the intermediate arrays are freed
+void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p **Yk_, size_t *work_msize_)
+{
+    int n_node          = h2mat->n_node;
+    int n_leaf_node     = h2mat->n_leaf_node;
+    int n_thread        = h2mat->n_thread;
+    int max_level       = h2mat->max_level;
+    int min_adm_level   = h2mat->min_adm_level;
+    int *parent         = h2mat->parent;
+    int *level_nodes    = h2mat->level_nodes;
+    int *level_n_node   = h2mat->level_n_node;
+    int *leaf_nodes     = h2mat->height_nodes;
+    int *node_level     = h2mat->node_level;
+    int *mat_cluster    = h2mat->mat_cluster;
+    int *B_p2i_rowptr   = h2mat->B_p2i_rowptr;
+    int *B_p2i_colidx   = h2mat->B_p2i_colidx;
+    int *D_p2i_rowptr   = h2mat->D_p2i_rowptr;
+    int *D_p2i_colidx   = h2mat->D_p2i_colidx;
+    H2P_thread_buf_p *thread_buf = h2mat->tb;
+
+    // 1. Build explicit U matrix for each node
+    H2P_dense_mat_p *exU;
+    H2P_build_explicit_U(h2mat, &exU);
+
+    // 2. Prepare the Gaussian random matrix vec and Yk_mat
+    // Yk_mat(:, n_vec*(i-1) + 1:n_vec) stores the matvec results for nodes at the i-th level
+    const int kms = h2mat->krnl_mat_size;
+    const int Yk_mat_ld = n_vec * max_level;
+    size_t vec_msize = sizeof(DTYPE) * (size_t) kms * (size_t) n_vec;
+    DTYPE *vec    = (DTYPE*) malloc(vec_msize);
+    DTYPE *Yk_mat = (DTYPE*) malloc(vec_msize * max_level);  // Note: we have max_level+1 levels in total
+    ASSERT_PRINTF(vec != NULL && Yk_mat != NULL, "Failed to allocate space for accu_matvec\n");
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        int s_row, n_row;
+        calc_block_spos_len(kms, n_thread, tid, &s_row, &n_row);
+        H2P_gen_normal_distribution(0.0, 1.0, (size_t) n_row * (size_t) n_vec, vec + (size_t) s_row * (size_t) n_vec);
+        size_t Yk_mat_offset = (size_t) s_row * (size_t) n_vec * (size_t) max_level;
+        size_t Yk_mat_nelem  = (size_t) n_row * (size_t) n_vec * (size_t) max_level;
+        memset(Yk_mat + Yk_mat_offset, 0, sizeof(DTYPE) * Yk_mat_nelem);
+    }
+
+    // 3. H2 matvec upward sweep
+    H2P_dense_mat_p *y0 = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    ASSERT_PRINTF(y0 != NULL, "Failed to allocate %d working matrices\n", n_node);
+    for (int i = 0; i < n_node; i++) y0[i] = NULL;
+    H2P_SPDHSS_H2_upward_sweep(h2mat, n_vec, vec, y0);
 
     // 4. For each pair of siblings (i, j), compute
     //    Yk{i} += Aij  * vec_j
@@ -510,6 +541,10 @@ void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p *
     }
 
     // 7. Free intermediate arrays 
+    size_t work_msize = (size_t) kms * (size_t) n_vec * (size_t) (max_level + 1);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, exU);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, y0);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node * max_level, Yk);
     for (int i = 0; i < n_node; i++)
     {
         H2P_dense_mat_destroy(&exU[i]);
@@ -520,6 +555,198 @@ void H2P_SPDHSS_H2_acc_matvec(H2Pack_p h2mat, const int n_vec, H2P_dense_mat_p *
     free(vec);
     free(Yk_mat);
     *Yk_ = Yk;
+    *work_msize_ = work_msize;
+}
+
+// Multiply the off-diagonal blocks of an H2 matrix with n_vec vectors without 
+// explicit U matrices for H2P_SPDHSS_H2_build_stream()
+// Input parameters:
+//   h2mat    : Source H2 matrix structure
+//   n_vec    : Number of input vectors
+//   vec      : Size h2mat->krnl_mat_size * n_vec, row-major input vectors
+//   y0       : Size h2mat->n_node, results of H2P_SPDHSS_H2_upward_sweep() on vec
+//   y1       : Size h2mat->n_node, work matrices of the same sizes as y0
+//   ca_level : Only the blocks A(idx_i, idx_j) with the lowest common ancestor of nodes 
+//              i and j on level ca_level are included, all blocks are included if < 0
+// Output parameter:
+//   out : Size h2mat->krnl_mat_size * n_vec, row-major, out = sum of A(idx_i, idx_j) * vec(idx_j, :)
+//         over all included pairs (i, j) of different nodes
+static void H2P_SPDHSS_H2_offdiag_matmul(
+    H2Pack_p h2mat, const int n_vec, const DTYPE *vec, H2P_dense_mat_p *y0,
+    H2P_dense_mat_p *y1, const int ca_level, DTYPE *out
+)
+{
+    int n_node          = h2mat->n_node;
+    int n_leaf_node     = h2mat->n_leaf_node;
+    int n_thread        = h2mat->n_thread;
+    int max_level       = h2mat->max_level;
+    int max_child       = h2mat->max_child;
+    int min_adm_level   = h2mat->min_adm_level;
+    int *parent         = h2mat->parent;
+    int *n_child        = h2mat->n_child;
+    int *children       = h2mat->children;
+    int *level_nodes    = h2mat->level_nodes;
+    int *level_n_node   = h2mat->level_n_node;
+    int *node_level     = h2mat->node_level;
+    int *mat_cluster    = h2mat->mat_cluster;
+    int *B_p2i_rowptr   = h2mat->B_p2i_rowptr;
+    int *B_p2i_colidx   = h2mat->B_p2i_colidx;
+    int *D_p2i_rowptr   = h2mat->D_p2i_rowptr;
+    int *D_p2i_colidx   = h2mat->D_p2i_colidx;
+    H2P_dense_mat_p  *U = h2mat->U;
+    H2P_thread_buf_p *thread_buf = h2mat->tb;
+
+    const int kms = h2mat->krnl_mat_size;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        int s_row, n_row;
+        calc_block_spos_len(kms, n_thread, tid, &s_row, &n_row);
+        memset(out + (size_t) s_row * (size_t) n_vec, 0, sizeof(DTYPE) * (size_t) n_row * (size_t) n_vec);
+
+        #pragma omp for schedule(static)
+        for (int node = 0; node < n_node; node++)
+        {
+            if (y1[node] == NULL) continue;
+            memset(y1[node]->data, 0, sizeof(DTYPE) * y1[node]->nrow * y1[node]->ncol);
+        }
+    }
+
+    // 1. For each pair of different nodes (i, j), compute
+    //    inadmissible pair : out(idx_i, :) += Dij * vec(idx_j, :)
+    //    admissible pair   : y1{i} += Bij * y0{j} or Bij * vec(idx_j, :) if node i is not a leaf node,
+    //                        out(idx_i, :) += Bij * y0{j} if node i is a leaf node
+    //    The symmetric operation is handled by double counting the node pairs.
+    //    Only node i's rows of out and y1{i} are updated, so node i can be processed in parallel.
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        H2P_int_vec_p   work = thread_buf[tid]->idx0;
+        H2P_dense_mat_p Dij  = thread_buf[tid]->mat0;
+        H2P_dense_mat_p Bij  = thread_buf[tid]->mat0;
+        H2P_int_vec_set_capacity(work, 2 * max_level + 4);
+
+        #pragma omp for schedule(dynamic)
+        for (int node0 = 0; node0 < n_node; node0++)
+        {
+            int s_row0 = mat_cluster[2 * node0];
+            int e_row0 = mat_cluster[2 * node0 + 1];
+            int n_row0 = e_row0 - s_row0 + 1;
+            int level0 = node_level[node0];
+            DTYPE *out_blk0 = out + (size_t) s_row0 * (size_t) n_vec;
+
+            for (int i = D_p2i_rowptr[node0]; i < D_p2i_rowptr[node0 + 1]; i++)
+            {
+                int node1 = D_p2i_colidx[i];
+                if (node0 == node1) continue;
+                if (ca_level >= 0)
+                {
+                    int level01 = H2P_tree_common_ancestor_level(parent, node_level, max_level+1, node0, node1, work->data);
+                    if (level01 != ca_level) continue;
+                }
+                int s_row1 = mat_cluster[2 * node1];
+                int e_row1 = mat_cluster[2 * node1 + 1];
+                int n_row1 = e_row1 - s_row1 + 1;
+                const DTYPE *vec_blk1 = vec + (size_t) s_row1 * (size_t) n_vec;
+                H2P_get_Dij_block(h2mat, node0, node1, Dij);
+                int Dij_ld = (Dij->ld > 0) ? Dij->ld : -Dij->ld;
+                CBLAS_TRANSPOSE Dij_trans_ = (Dij->ld > 0) ? CblasNoTrans : CblasTrans;
+                CBLAS_GEMM(
+                    CblasRowMajor, Dij_trans_, CblasNoTrans, n_row0, n_vec, n_row1,
+                    1.0, Dij->data, Dij_ld, vec_blk1, n_vec, 1.0, out_blk0, n_vec
+                );
+            }  // End of i loop
+
+            for (int i = B_p2i_rowptr[node0]; i < B_p2i_rowptr[node0 + 1]; i++)
+            {
+                int node1 = B_p2i_colidx[i];
+                if (node0 == node1) continue;
+                if (ca_level >= 0)
+                {
+                    int level01 = H2P_tree_common_ancestor_level(parent, node_level, max_level+1, node0, node1, work->data);
+                    if (level01 != ca_level) continue;
+                }
+                int s_row1 = mat_cluster[2 * node1];
+                int level1 = node_level[node1];
+                H2P_get_Bij_block(h2mat, node0, node1, Bij);
+                int Bij_nrow, Bij_ncol, Bij_ld;
+                CBLAS_TRANSPOSE Bij_trans_;
+                if (Bij->ld > 0)
+                {
+                    Bij_nrow   = Bij->nrow;
+                    Bij_ncol   = Bij->ncol;
+                    Bij_ld     = Bij->ld;
+                    Bij_trans_ = CblasNoTrans;
+                } else {
+                    Bij_nrow   = Bij->ncol;
+                    Bij_ncol   = Bij->nrow;
+                    Bij_ld     = -Bij->ld;
+                    Bij_trans_ = CblasTrans;
+                }
+                // A. Two nodes are of the same level, compress on both side
+                // B. node1 is a leaf node and its level is larger than node0, only compress on node0's side
+                // C. node0 is a leaf node and its level is larger than node1, only compress on node1's side
+                const DTYPE *x_blk1 = (level0 > level1) ? vec + (size_t) s_row1 * (size_t) n_vec : y0[node1]->data;
+                int x_ld1 = (level0 > level1) ? n_vec : y0[node1]->ld;
+                DTYPE *y_blk0 = (level0 < level1) ? out_blk0 : y1[node0]->data;
+                int y_ld0 = (level0 < level1) ? n_vec : y1[node0]->ld;
+                ASSERT_PRINTF(
+                    Bij_nrow == ((level0 < level1) ? n_row0 : y1[node0]->nrow),
+                    "Pair (%d, %d) B matrix has %d rows, mismatch the target block\n", node0, node1, Bij_nrow
+                );
+                CBLAS_GEMM(
+                    CblasRowMajor, Bij_trans_, CblasNoTrans, Bij_nrow, n_vec, Bij_ncol,
+                    1.0, Bij->data, Bij_ld, x_blk1, x_ld1, 1.0, y_blk0, y_ld0
+                );
+            }  // End of i loop
+        }  // End of node0 loop
+    }  // End of "#pragma omp parallel"
+
+    // 2. H2 matvec downward sweep, push y1 to the leaf nodes using nested U matrices
+    for (int i = min_adm_level; i <= max_level; i++)
+    {
+        int *level_i_nodes = level_nodes + i * n_leaf_node;
+        int level_i_n_node = level_n_node[i];
+        int n_thread_i = MIN(level_i_n_node, n_thread);
+
+        #pragma omp parallel num_threads(n_thread_i)
+        {
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < level_i_n_node; j++)
+            {
+                int node = level_i_nodes[j];
+                int n_child_node = n_child[node];
+                H2P_dense_mat_p U_node  = U[node];
+                H2P_dense_mat_p y1_node = y1[node];
+                if (y1_node == NULL || U_node->nrow == 0 || U_node->ncol == 0) continue;
+                if (n_child_node == 0)
+                {
+                    // Leaf node, out(idx_j, :) += U_j * y1{j}
+                    int s_row = mat_cluster[2 * node];
+                    DTYPE *out_blk = out + (size_t) s_row * (size_t) n_vec;
+                    CBLAS_GEMM(
+                        CblasRowMajor, CblasNoTrans, CblasNoTrans, U_node->nrow, n_vec, U_node->ncol,
+                        1.0, U_node->data, U_node->ld, y1_node->data, y1_node->ld, 1.0, out_blk, n_vec
+                    );
+                } else {
+                    // Non-leaf node, y1{child_k} += U_j(rows of child_k, :) * y1{j}
+                    int *node_children = children + node * max_child;
+                    int U_row_s = 0;
+                    for (int k = 0; k < n_child_node; k++)
+                    {
+                        int child_k = node_children[k];
+                        H2P_dense_mat_p y1_k = y1[child_k];
+                        DTYPE *U_node_k_row = U_node->data + U_row_s * U_node->ld;
+                        CBLAS_GEMM(
+                            CblasRowMajor, CblasNoTrans, CblasNoTrans, y1_k->nrow, n_vec, U_node->ncol,
+                            1.0, U_node_k_row, U_node->ld, y1_node->data, y1_node->ld, 1.0, y1_k->data, y1_k->ld
+                        );
+                        U_row_s += y1_k->nrow;
+                    }  // End of k loop
+                }  // End of "if (n_child_node == 0)"
+            }  // End of j loop
+        }  // End of "#pragma omp parallel"
+    }  // End of i loop
 }
 
 // Gather matrices in HSS_B into a large matrix tmpB s.t. the i-th row j-th column 
@@ -1367,7 +1594,7 @@ void H2P_SPDHSS_H2_wrap_new_HSS(
     hssmat->tb = (H2P_thread_buf_p*) malloc(sizeof(H2P_thread_buf_p) * hssmat->n_thread);
     ASSERT_PRINTF(hssmat->tb != NULL, "Failed to allocate %d thread buffers in SPDHSS\n", hssmat->n_thread);
     for (int i = 0; i < hssmat->n_thread; i++)
-        H2P_thread_buf_init(&hssmat->tb[i], hssmat->krnl_mat_size);
+        H2P_thread_buf_init(&hssmat->tb[i], 0);
 
     // 5. Set up kernel pointers and U/B/D info
     hssmat->BD_JIT          = 0;
@@ -1446,6 +1673,10 @@ void H2P_SPDHSS_H2_wrap_new_HSS(
         B_pair_j[B_pair_cnt] = node1;
         B_pair_v[B_pair_cnt] = i + 1;
         B_pair_cnt++;
+        B_pair_i[B_pair_cnt] = node1;
+        B_pair_j[B_pair_cnt] = node0;
+        B_pair_v[B_pair_cnt] = -(i + 1);
+        B_pair_cnt++;
         mat_size[MV_MID_SIZE_IDX] += B_nrow[i] * B_ncol[i];
         mat_size[MV_MID_SIZE_IDX] += 2 * (B_nrow[i] + B_ncol[i]);
     }
@@ -1618,52 +1849,779 @@ void H2P_SPDHSS_H2_wrap_new_HSS(
     *hssmat_ = hssmat;
 }
 
-// Build an SPD HSS matrix A_{HSS} from an H2 matrix s.t. A_{HSS} ~= A_{H2}
-void H2P_SPDHSS_H2_build(
-    const int max_rank, const DTYPE reltol, const DTYPE shift, 
-    H2Pack_p h2mat, H2Pack_p *hssmat_
+// Construct the SPDHSS basis of a leaf node for H2P_SPDHSS_H2_build()
+// Input parameters:
+//   h2mat    : Source H2 matrix structure
+//   node     : Target leaf node
+//   tid      : Thread ID, thread_buf[tid] of h2mat will be used
+//   max_rank : Maximum rank of the HSS matrix
+//   reltol   : Relative tolerance in column-pivoted QR
+//   shift    : Diagonal shifting
+//   HSS_Dij  : SPDHSS D matrix of the target leaf node
+//   node_Yk  : Size h2mat->max_level, Yk matrices of the target leaf node
+// Output parameters:
+//   node_Yk : node_Yk[k-1] = V{node}' * S{node}^{-1} * node_Yk[k] for each non-empty node_Yk[k], 
+//             the last non-empty node_Yk[k] is destroyed
+//   S, V, W, HSS_U : S, V, W, and HSS_U matrices of the target leaf node
+// Return value: 0 if the construction succeeded, otherwise HSS_Dij is not SPD
+static int H2P_SPDHSS_H2_build_leaf_basis(
+    H2Pack_p h2mat, const int node, const int tid, const int max_rank, const DTYPE reltol, 
+    const DTYPE shift, H2P_dense_mat_p HSS_Dij, H2P_dense_mat_p *node_Yk, 
+    H2P_dense_mat_p *S, H2P_dense_mat_p *V, H2P_dense_mat_p *W, H2P_dense_mat_p *HSS_U
 )
 {
-    if (h2mat == NULL || h2mat->U == NULL || h2mat->is_HSS)
+    int max_level = h2mat->max_level;
+    H2P_dense_mat_p  *H2_U = h2mat->U;
+    H2P_int_vec_p   idx0 = h2mat->tb[tid]->idx0;
+    H2P_dense_mat_p mat0 = h2mat->tb[tid]->mat0;
+
+    int info;
+    // [S{node}, chol_flag] = chol(HSS_D{HSS_D_idx}, 'lower');
+    H2P_dense_mat_init(&S[node], HSS_Dij->nrow, HSS_Dij->ncol);
+    copy_matrix_block(sizeof(DTYPE), HSS_Dij->nrow, HSS_Dij->ncol, HSS_Dij->data, HSS_Dij->ld, S[node]->data, S[node]->ld);
+    info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', S[node]->nrow, S[node]->data, S[node]->ld);
+    for (int k = 0; k < S[node]->nrow; k++)
     {
-        ERROR_PRINTF("Input h2mat is not constructed or configured as HSS\n");
-        return;
+        DTYPE *S_kk1 = S[node]->data + k * S[node]->nrow + (k + 1);
+        int n_zero_row = S[node]->nrow - (k + 1);
+        memset(S_kk1, 0, sizeof(DTYPE) * n_zero_row);
     }
-
-    if (h2mat->is_RPY_Ewald)
+    if (info != 0)
     {
-        ERROR_PRINTF("Cannot construct SPDHSS for RPY Ewald kernel\n");
-        return;
+        ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
+        return info;
     }
+    // tmpY = linsolve(S{node}, Yk{node}{1}, struct('LT', true));
+    H2P_dense_mat_p tmpY = mat0;
+    H2P_dense_mat_resize(tmpY, node_Yk[0]->nrow + 1, node_Yk[0]->ncol);
+    DTYPE *tau = tmpY->data + node_Yk[0]->nrow * node_Yk[0]->ncol;
+    tmpY->nrow--;
+    copy_matrix_block(sizeof(DTYPE), tmpY->nrow, tmpY->ncol, node_Yk[0]->data, node_Yk[0]->ld, tmpY->data, tmpY->ld);
+    ASSERT_PRINTF(
+        tmpY->nrow == S[node]->nrow, 
+        "Node %d: tmpY->nrow (%d) mismatch S->nrow (%d)\n",
+        node, tmpY->nrow, S[node]->nrow
+    );
+    CBLAS_TRSM(
+        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+        tmpY->nrow, tmpY->ncol, 1.0, S[node]->data, S[node]->ld, tmpY->data, tmpY->ld
+    );
+    // V_ncol = min([size(tmpY), max_rank]);
+    // [tmpQ, ~, ~] = qr(tmpY, 0);
+    // V{node} = tmpQ(:, 1 : V_ncol);
+    int tmpQ_ncol = MIN(tmpY->nrow, tmpY->ncol);
+    int V_ncol = MIN(tmpQ_ncol, max_rank);
+    H2P_dense_mat_p tmpQ = tmpY;
+    H2P_int_vec_p   jpvt = idx0;
+    H2P_int_vec_set_capacity(jpvt, tmpQ->ncol);
+    memset(jpvt->data, 0, sizeof(int) * tmpQ->ncol);
+    LAPACK_GEQPF(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ->ncol, tmpQ->data, tmpQ->ld, jpvt->data, tau);
+    int V_ncol1 = -1;
+    DTYPE stop_diag = DABS(tmpQ->data[0]) * reltol;
+    for (int k = 0; k < V_ncol; k++)
+    {
+        if (DABS(tmpQ->data[k * tmpQ->ld + k]) < stop_diag)
+        {
+            V_ncol1 = k - 1;
+            break;
+        }
+    }
+    if (V_ncol1 > 0) V_ncol = V_ncol1;
+    LAPACK_ORGQR(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ_ncol, tmpQ_ncol, tmpQ->data, tmpQ->ld, tau);
+    H2P_dense_mat_init(&V[node], tmpQ->nrow, V_ncol);
+    copy_matrix_block(sizeof(DTYPE), tmpQ->nrow, V_ncol, tmpQ->data, tmpQ->ld, V[node]->data, V[node]->ld);
+    // HSS_U{node} = S{node} * V{node};
+    H2P_dense_mat_init(&HSS_U[node], S[node]->nrow, V[node]->ncol);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, S[node]->nrow, V[node]->ncol, S[node]->ncol,
+        1.0, S[node]->data, S[node]->ld, V[node]->data, V[node]->ld, 0.0, HSS_U[node]->data, HSS_U[node]->ld
+    );
+    // Yk{node}(1) = [];
+    // for k = 1 : length(Yk{node})
+    //    Yk{node}{k} = V{node}' * linsolve(S{node}, Yk{node}{k}, struct('LT', true));
+    // end
+    int last_k = 0;
+    for (int k = 1; k < max_level; k++)
+    {
+        if (node_Yk[k]->ld == 0) break;  // Empty Yk{node}{k}
+        H2P_dense_mat_p node_Yk_k0 = node_Yk[k - 1];
+        H2P_dense_mat_p node_Yk_k  = node_Yk[k];
+        CBLAS_TRSM(
+            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, 
+            node_Yk_k->nrow, node_Yk_k->ncol, 1.0, S[node]->data, S[node]->ld, node_Yk_k->data, node_Yk_k->ld
+        );
+        H2P_dense_mat_resize(node_Yk_k0, V[node]->ncol, node_Yk_k->ncol);
+        CBLAS_GEMM(
+            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, node_Yk_k->ncol, V[node]->nrow,
+            1.0, V[node]->data, V[node]->ld, node_Yk_k->data, node_Yk_k->ld, 0.0, node_Yk_k0->data, node_Yk_k0->ld
+        );
+        last_k = k;
+    }  // End of k loop
+    H2P_dense_mat_destroy(&node_Yk[last_k]);
+    // if (~isempty(H2_U{node}))
+    //     W{node} = V{node}' * linsolve(S{node}, H2_U{node}, struct('LT', true));
+    // end
+    H2P_dense_mat_p H2_U_node = H2_U[node];
+    if (H2_U_node->ld > 0)
+    {
+        H2P_dense_mat_p tmpM = tmpQ;
+        H2P_dense_mat_resize(tmpM, H2_U_node->nrow, H2_U_node->ncol);
+        copy_matrix_block(sizeof(DTYPE), H2_U_node->nrow, H2_U_node->ncol, H2_U_node->data, H2_U_node->ld, tmpM->data, tmpM->ld);
+        ASSERT_PRINTF(
+            tmpM->nrow == S[node]->nrow, 
+            "Node %d: H2_U->nrow (%d) mismatch S->nrow (%d)\n",
+            node, tmpM->nrow, S[node]->nrow
+        );
+        CBLAS_TRSM(
+            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+            tmpM->nrow, tmpM->ncol, 1.0, S[node]->data, S[node]->ld, tmpM->data, tmpM->ld
+        );
+        H2P_dense_mat_init(&W[node], V[node]->ncol, tmpM->ncol);
+        CBLAS_GEMM(
+            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM->ncol, V[node]->nrow,
+            1.0, V[node]->data, V[node]->ld, tmpM->data, tmpM->ld, 0.0, W[node]->data, W[node]->ld
+        );
+    }  // End of "if (H2_U_node->ld > 0)"
+    return 0;
+}
 
-    #ifdef __linux__
-    // Any H2P_dense_mat_t->data allocation > 1KB will use mmap instead of sbrk and can be released later
-    mallopt(M_MMAP_THRESHOLD, 1024);
-    #endif
-
-    int n_node          = h2mat->n_node;
-    int n_thread        = h2mat->n_thread;
-    int n_leaf_node     = h2mat->n_leaf_node;
-    int max_child       = h2mat->max_child;
+// Construct the SPDHSS basis of a non-leaf node for H2P_SPDHSS_H2_build(), 
+// the bases of its children and the HSS Bij matrices of its children pairs 
+// should have been constructed
+// Input parameters:
+//   h2mat          : Source H2 matrix structure
+//   node           : Target non-leaf node
+//   tid            : Thread ID, thread_buf[tid] of h2mat will be used
+//   max_rank       : Maximum rank of the HSS matrix
+//   reltol         : Relative tolerance in column-pivoted QR
+//   shift          : Diagonal shifting
+//   HSS_B_p2i_{*}  : CSR matrix array triple, convert (i, j) pair to an index for HSS_B
+//   HSS_B          : HSS Bij matrices
+//   Yk             : Size h2mat->n_node * h2mat->max_level, Yk matrices of all nodes
+// Output parameters:
+//   Yk                : Yk{node} is constructed and projected, Yk{children} are destroyed
+//   V, W, Minv, HSS_U : V, W, Minv, and HSS_U matrices of the target node, W{children} are destroyed
+// Return value: 0 if the construction succeeded, otherwise the target matrix is not SPD
+static int H2P_SPDHSS_H2_build_nonleaf_basis(
+    H2Pack_p h2mat, const int node, const int tid, const int max_rank, const DTYPE reltol, 
+    const DTYPE shift, const int *HSS_B_p2i_rowptr, const int *HSS_B_p2i_colidx, 
+    const int *HSS_B_p2i_val, H2P_dense_mat_p *HSS_B, H2P_dense_mat_p *Yk, 
+    H2P_dense_mat_p *V, H2P_dense_mat_p *W, H2P_dense_mat_p *Minv, H2P_dense_mat_p *HSS_U
+)
+{
     int max_level       = h2mat->max_level;
-    int *children       = h2mat->children;
+    int max_child       = h2mat->max_child;
     int *n_child        = h2mat->n_child;
-    int *level_n_node   = h2mat->level_n_node;
-    int *level_nodes    = h2mat->level_nodes;
+    int *children       = h2mat->children;
     int *node_level     = h2mat->node_level;
-    int *leaf_nodes     = h2mat->height_nodes;
     H2P_dense_mat_p  *H2_U = h2mat->U;
-    H2P_thread_buf_p *thread_buf = h2mat->tb;
-
+    H2P_int_vec_p   idx0 = h2mat->tb[tid]->idx0;
+    H2P_dense_mat_p mat0 = h2mat->tb[tid]->mat0;
+    H2P_dense_mat_p mat1 = h2mat->tb[tid]->mat1;
+    H2P_dense_mat_p mat2 = h2mat->tb[tid]->mat2;
+    int n_child_node    = n_child[node];
+    int *node_children  = children + node * max_child;
+
+    int info;
+    // (1) Construct the intermediate blocks defined by its children nodes
+    H2P_int_vec_set_capacity(idx0, n_child_node + 1);
+    int *offset = idx0->data;
+    offset[0] = 0;
+    for (int k = 0; k < n_child_node; k++)
+    {
+        int child_k = node_children[k];
+        offset[k + 1] = offset[k] + HSS_U[child_k]->ncol;
+    }
+    int tmpB_nrow = offset[n_child_node];
+    H2P_dense_mat_p tmpB = mat0;
+    H2P_dense_mat_resize(tmpB, tmpB_nrow + 1, tmpB_nrow);
+    tmpB->nrow--;
+    for (int k = 0; k < n_child_node; k++)
+    {
+        int child_k = node_children[k];
+        // idx_k = offset(k) : offset(k+1)-1;
+        int idx_k_s = offset[k];
+        int idx_k_len = offset[k + 1] - idx_k_s;
+        for (int l = k + 1; l < n_child_node; l++)
+        {
+            int child_l = node_children[l];
+            // idx_l = offset(l) : offset(l+1)-1;
+            int idx_l_s = offset[l];
+            // B_idx = B_pair2idx(child_k, child_l);
+            int HSS_B_idx = H2P_get_int_CSR_elem(HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, child_k, child_l);
+            ASSERT_PRINTF(HSS_B_idx != 0, "SPDHSS_B{%d, %d} does not exist!\n", child_k, child_l);
+            HSS_B_idx--;
+            H2P_dense_mat_p HSS_B_kl = HSS_B[HSS_B_idx];
+            // tmpB(idx_k, idx_l) = HSS_B{B_idx};
+            DTYPE *tmpB_kl = tmpB->data + idx_k_s * tmpB->ld + idx_l_s;
+            copy_matrix_block(sizeof(DTYPE), HSS_B_kl->nrow, HSS_B_kl->ncol, HSS_B_kl->data, HSS_B_kl->ld, tmpB_kl, tmpB->ld);
+            // tmpB(idx_l, idx_k) = HSS_B{B_idx}';
+            // LAPACK_SYEVD only need uppertriangle, no need to fill the lower triangle part
+            //DTYPE *tmpB_lk = tmpB->data + idx_l_s * tmpB->ld + idx_k_s;
+            //H2P_transpose_dmat(1, HSS_B_kl->nrow, HSS_B_kl->ncol, HSS_B_kl->data, HSS_B_kl->ld, tmpB_lk, tmpB->ld);
+        }
+        // Set the diagonal block to zero
+        for (int l = idx_k_s; l < idx_k_s + idx_k_len; l++)
+        {
+            DTYPE *tmpB_l_ks = tmpB->data + l * tmpB->ld + idx_k_s;
+            memset(tmpB_l_ks, 0, sizeof(DTYPE) * idx_k_len);
+        }
+    }  // End of k loop
+
+    // (2) Decompose the diagonal matrix
+    H2P_dense_mat_p tmpQ = tmpB;
+    DTYPE *tmpE_diag = tmpB->data + tmpQ->nrow * tmpQ->nrow;
+    // [tmpQ, tmpE] = eig(tmpB);
+    // tmpE_diag = diag(tmpE);
+    info = LAPACK_SYEVD(LAPACK_ROW_MAJOR, 'V', 'U', tmpQ->nrow, tmpQ->data, tmpQ->ld, tmpE_diag);
+    if (info != 0)
+    {
+        ERROR_PRINTF("Node %d intermediate diagonal matrix cannot be diagonalized\n", node);
+        return -1;
+    }
+    DTYPE min_diag = 19241112.0;
+    for (int k = 0; k < tmpQ->nrow; k++) min_diag = MIN(min_diag, tmpE_diag[k]);
+    if (min_diag <= -1.0)
+    {
+        ERROR_PRINTF("Node %d intermediate diagonal matrix has eigenvalue %e < -1\n", node, min_diag);
+        ERROR_PRINTF("Source H2 matrix with shifting %.3lf is not SPD\n", shift);
+        return -1;
+    }
+    H2P_dense_mat_p tmpM  = mat1;  // tmpM need to be reused later!
+    H2P_dense_mat_p tmpQ1 = mat2;
+    // tmpM = tmpQ * diag((1 + tmpE_diag).^0.5) * tmpQ';
+    #pragma omp simd
+    for (int k = 0; k < tmpQ->nrow; k++)
+        tmpE_diag[k] = DSQRT(1.0 + tmpE_diag[k]);
+    H2P_dense_mat_resize(tmpQ1, tmpQ->nrow, tmpQ->ncol);
+    for (int k = 0; k < tmpQ->nrow; k++)
+    {
+        DTYPE *tmpQ_k  = tmpQ->data  + k * tmpQ->ncol;
+        DTYPE *tmpQ1_k = tmpQ1->data + k * tmpQ->ncol;
+        #pragma omp simd
+        for (int l = 0; l < tmpQ->ncol; l++)
+            tmpQ1_k[l] = tmpQ_k[l] * tmpE_diag[l];
+    }
+    H2P_dense_mat_resize(tmpM, tmpQ->nrow, tmpQ->nrow);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasTrans, tmpQ->nrow, tmpQ->nrow, tmpQ->nrow,
+        1.0, tmpQ1->data, tmpQ1->ld, tmpQ->data, tmpQ->ld, 0.0, tmpM->data, tmpM->ld
+    );
+    // Minv{node} = tmpQ * diag((1 + tmpE_diag).^-0.5) * tmpQ';
+    #pragma omp simd
+    for (int k = 0; k < tmpQ->nrow; k++)
+        tmpE_diag[k] = 1.0 / tmpE_diag[k];
+    H2P_dense_mat_resize(tmpQ1, tmpQ->nrow, tmpQ->ncol);
+    for (int k = 0; k < tmpQ->nrow; k++)
+    {
+        DTYPE *tmpQ_k  = tmpQ->data  + k * tmpQ->ncol;
+        DTYPE *tmpQ1_k = tmpQ1->data + k * tmpQ->ncol;
+        #pragma omp simd
+        for (int l = 0; l < tmpQ->ncol; l++)
+            tmpQ1_k[l] = tmpQ_k[l] * tmpE_diag[l];
+    }
+    H2P_dense_mat_init(&Minv[node], tmpQ->nrow, tmpQ->nrow);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasTrans, tmpQ->nrow, tmpQ->nrow, tmpQ->nrow,
+        1.0, tmpQ1->data, tmpQ1->ld, tmpQ->data, tmpQ->ld, 0.0, Minv[node]->data, Minv[node]->ld
+    );
+    // Now mat0 and mat2 can be reused
+
+    // (3) Construct basis matrix
+    H2P_dense_mat_p *node_Yk = Yk + node * max_level;
+    H2P_int_vec_p tmpYk_idx = idx0;
+    H2P_int_vec_set_capacity(tmpYk_idx, n_child_node);
+    tmpYk_idx->length = n_child_node;
+    for (int l = 0; l < node_level[node]; l++)
+    {
+        for (int k = 0; k < n_child_node; k++)
+        {
+            int child_k = node_children[k];
+            tmpYk_idx->data[k] = child_k * max_level + l;
+        }
+        H2P_dense_mat_p node_Yk_l = node_Yk[l];
+        H2P_dense_mat_vertcat(Yk, tmpYk_idx, node_Yk_l);
+        for (int k = 0; k < n_child_node; k++)
+        {
+            int child_k = node_children[k];
+            int Yk_idx = child_k * max_level + l;
+            H2P_dense_mat_destroy(&Yk[Yk_idx]);
+        }
+    }
+
+    // tmpY = Minv{node} * Yk{node}{1};
+    H2P_dense_mat_p tmpY = mat0;
+    H2P_dense_mat_resize(tmpY, Minv[node]->nrow + 1, node_Yk[0]->ncol);
+    DTYPE *tau = tmpY->data + Minv[node]->nrow * node_Yk[0]->ncol;
+    tmpY->nrow--;
+    ASSERT_PRINTF(
+        Minv[node]->ncol == node_Yk[0]->nrow,
+        "Node %d: Minv->ncol (%d) mismatch node_Yk[0]->nrow (%d)\n",
+        node, Minv[node]->ncol, node_Yk[0]->nrow
+    );
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, tmpY->ncol, Minv[node]->ncol,
+        1.0, Minv[node]->data, Minv[node]->ld, node_Yk[0]->data, node_Yk[0]->ld, 0.0, tmpY->data, tmpY->ld
+    );
+    // tmpQ_ncol = min([size(tmpY), max_rank]);
+    // [tmpQ, ~, ~] = qr(tmpY, 0);
+    // V{node} = tmpQ(:, 1 : tmpQ_ncol);
+    int tmpQ_ncol = MIN(tmpY->nrow, tmpY->ncol);
+    int V_ncol = MIN(tmpQ_ncol, max_rank);
+    tmpQ = tmpY;
+    H2P_int_vec_p jpvt = idx0;
+    H2P_int_vec_set_capacity(jpvt, tmpQ->ncol);
+    memset(jpvt->data, 0, sizeof(int) * tmpQ->ncol);
+    LAPACK_GEQPF(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ->ncol, tmpQ->data, tmpQ->ld, jpvt->data, tau);
+    int V_ncol1 = -1;
+    DTYPE stop_diag = DABS(tmpQ->data[0]) * reltol;
+    for (int k = 0; k < V_ncol; k++)
+    {
+        if (DABS(tmpQ->data[k * tmpQ->ld + k]) < stop_diag)
+        {
+            V_ncol1 = k - 1;
+            break;
+        }
+    }
+    if (V_ncol1 > 0) V_ncol = V_ncol1;
+    LAPACK_ORGQR(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ_ncol, tmpQ_ncol, tmpQ->data, tmpQ->ld, tau);
+    H2P_dense_mat_init(&V[node], tmpQ->nrow, V_ncol);
+    copy_matrix_block(sizeof(DTYPE), tmpQ->nrow, V_ncol, tmpQ->data, tmpQ->ld, V[node]->data, V[node]->ld);
+    // HSS_U{node} = tmpM * V{node};
+    H2P_dense_mat_init(&HSS_U[node], tmpM->nrow, V[node]->ncol);
+    CBLAS_GEMM(
+        CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpM->nrow, V[node]->ncol, tmpM->ncol,
+        1.0, tmpM->data, tmpM->ld, V[node]->data, V[node]->ld, 0.0, HSS_U[node]->data, HSS_U[node]->ld
+    );
+    // Now mat1 can be reused
+
+    // Yk{node}(1) = [];
+    // for k = 1 : length(Yk{node})
+    //     Yk{node}{k} = V{node}' * Minv{node} * Yk{node}{k};
+    // end
+    int last_k = 0;
+    for (int k = 1; k < max_level; k++)
+    {
+        if (node_Yk[k]->ld == 0) break;  // Empty Yk{node}{k}
+        H2P_dense_mat_p node_Yk_k0 = node_Yk[k - 1];
+        H2P_dense_mat_p node_Yk_k  = node_Yk[k];
+        H2P_dense_mat_resize(tmpM, Minv[node]->nrow, node_Yk_k->ncol);
+        ASSERT_PRINTF(
+            Minv[node]->ncol == node_Yk_k->nrow,
+            "Node %d: Minv->ncol (%d) mismatch node_Yk[%d]->nrow (%d)",
+            node, Minv[node]->ncol, k, node_Yk_k->nrow
+        );
+        CBLAS_GEMM(
+            CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, node_Yk_k->ncol, Minv[node]->ncol,
+            1.0, Minv[node]->data, Minv[node]->ld, node_Yk_k->data, node_Yk_k->ld, 0.0, tmpM->data, tmpM->ld
+        );
+        H2P_dense_mat_resize(node_Yk_k0, V[node]->ncol, tmpM->ncol);
+        ASSERT_PRINTF(
+            V[node]->nrow == Minv[node]->nrow,
+            "Node %d: V->nrow (%d) mismatch tmpM->ncol (%d)\n", 
+            node, V[node]->nrow, Minv[node]->nrow
+        );
+        CBLAS_GEMM(
+            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM->ncol, V[node]->nrow,
+            1.0, V[node]->data, V[node]->ld, tmpM->data, tmpM->ld, 0.0, node_Yk_k0->data, node_Yk_k0->ld
+        );
+        last_k = k;
+    }  // End of k loop
+    H2P_dense_mat_destroy(&node_Yk[last_k]);
+    // if (~isempty(H2_U{node}))
+    //     child_node = children(node, 1 : n_child_node);
+    //     tmpW = blkdiag(W{child_node});
+    //     W{node} = V{node}' * (Minv{node} * (tmpW * H2_U{node}));
+    // end
+    H2P_dense_mat_p H2_U_node = H2_U[node];
+    if (H2_U_node->ld > 0)
+    {
+        H2P_dense_mat_p tmpM0 = mat1;
+        H2P_dense_mat_p tmpM1 = mat2;
+        // Don't use blkdiag, directly multiple each child node's W with H2_U{node}
+        int tmpW_nrow = 0, tmpW_ncol = 0;
+        for (int k = 0; k < n_child_node; k++)
+        {
+            int child_k = node_children[k];
+            tmpW_nrow += W[child_k]->nrow;
+            tmpW_ncol += W[child_k]->ncol;
+        }
+        ASSERT_PRINTF(
+            tmpW_ncol == H2_U_node->nrow,
+            "Node %d: tmpW->ncol (%d) mismatch H2_U->nrow (%d)\n",
+            node, tmpW_ncol, H2_U_node->nrow
+        );
+        H2P_dense_mat_resize(tmpM0, tmpW_nrow, H2_U_node->ncol);
+        tmpW_nrow = 0;
+        tmpW_ncol = 0;
+        for (int k = 0; k < n_child_node; k++)
+        {
+            int child_k = node_children[k];
+            H2P_dense_mat_p W_k = W[child_k];
+            DTYPE *tmpM0_k_row = tmpM0->data + tmpW_nrow * tmpM0->ld;
+            DTYPE *H2_U_k_col  = H2_U_node->data + tmpW_ncol * H2_U_node->ld;
+            CBLAS_GEMM(
+                CblasRowMajor, CblasNoTrans, CblasNoTrans, W_k->nrow, H2_U_node->ncol, W_k->ncol,
+                1.0, W_k->data, W_k->ld, H2_U_k_col, H2_U_node->ld, 0.0, tmpM0_k_row, tmpM0->ld
+            );
+            tmpW_nrow += W_k->nrow;
+            tmpW_ncol += W_k->ncol;
+            H2P_dense_mat_destroy(&W[child_k]);
+        }
+        // The rest GEMM 
+        H2P_dense_mat_resize(tmpM1, Minv[node]->nrow, tmpM0->ncol);
+        ASSERT_PRINTF(
+            Minv[node]->ncol == tmpM0->nrow,
+            "Node %d: Minv->ncol (%d) mismatch tmpM0->nrow (%d)\n",
+            node, Minv[node]->ncol, tmpM0->nrow
+        );
+        CBLAS_GEMM(
+            CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, tmpM0->ncol, Minv[node]->ncol, 
+            1.0, Minv[node]->data, Minv[node]->ld, tmpM0->data, tmpM0->ld, 0.0, tmpM1->data, tmpM1->ld
+        );
+        H2P_dense_mat_init(&W[node], V[node]->ncol, tmpM1->ncol);
+        ASSERT_PRINTF(
+            V[node]->nrow == tmpM1->nrow,
+            "Node %d: V->nrow (%d) mismatch tmpM1->nrow (%d)\n",
+            node, V[node]->nrow, tmpM1->nrow
+        );
+        CBLAS_GEMM(
+            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM1->ncol, V[node]->nrow,
+            1.0, V[node]->data, V[node]->ld, tmpM1->data, tmpM1->ld, 0.0, W[node]->data, W[node]->ld
+        );
+    }  // End of "if (H2_U_node->ld > 0)"
+    return 0;
+}
+
+// Size (in DTYPE) of the SPDHSS intermediate matrices of a node and its children
+static size_t H2P_SPDHSS_H2_node_msize(
+    H2Pack_p h2mat, const int node, H2P_dense_mat_p *Yk, H2P_dense_mat_p *S, 
+    H2P_dense_mat_p *V, H2P_dense_mat_p *W, H2P_dense_mat_p *Minv, H2P_dense_mat_p *HSS_U
+)
+{
+    int max_level = h2mat->max_level;
+    int n_child_node = h2mat->n_child[node];
+    int *node_children = h2mat->children + node * h2mat->max_child;
+    size_t msize = 0;
+    for (int k = -1; k < n_child_node; k++)
+    {
+        int node_k = (k == -1) ? node : node_children[k];
+        msize += H2P_SPDHSS_H2_mats_msize(1, S + node_k);
+        msize += H2P_SPDHSS_H2_mats_msize(1, V + node_k);
+        msize += H2P_SPDHSS_H2_mats_msize(1, W + node_k);
+        msize += H2P_SPDHSS_H2_mats_msize(1, Minv + node_k);
+        msize += H2P_SPDHSS_H2_mats_msize(1, HSS_U + node_k);
+        msize += H2P_SPDHSS_H2_mats_msize(max_level, Yk + node_k * max_level);
+    }
+    return msize;
+}
+
+// Size (in DTYPE) of the HSS Bij matrices of a node pair and its children pairs
+static size_t H2P_SPDHSS_H2_pair_msize(
+    H2Pack_p h2mat, const int node0, const int node1, const int *HSS_B_p2i_rowptr, 
+    const int *HSS_B_p2i_colidx, const int *HSS_B_p2i_val, H2P_dense_mat_p *HSS_B
+)
+{
+    int max_child = h2mat->max_child;
+    int *n_child  = h2mat->n_child;
+    int *children = h2mat->children;
+    int n_blk0 = (n_child[node0] > 0) ? n_child[node0] : 1;
+    int n_blk1 = (n_child[node1] > 0) ? n_child[node1] : 1;
+    const int *blk0 = (n_child[node0] > 0) ? children + node0 * max_child : &node0;
+    const int *blk1 = (n_child[node1] > 0) ? children + node1 * max_child : &node1;
+    size_t msize = 0;
+    int HSS_B_idx = H2P_get_int_CSR_elem(HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, node0, node1);
+    if (HSS_B_idx > 0) msize += H2P_SPDHSS_H2_mats_msize(1, HSS_B + HSS_B_idx - 1);
+    for (int i = 0; i < n_blk0; i++)
+    {
+        for (int j = 0; j < n_blk1; j++)
+        {
+            if (blk0[i] == node0 && blk1[j] == node1) continue;
+            HSS_B_idx = H2P_get_int_CSR_elem(HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, blk0[i], blk1[j]);
+            if (HSS_B_idx > 0) msize += H2P_SPDHSS_H2_mats_msize(1, HSS_B + HSS_B_idx - 1);
+        }
+    }
+    return msize;
+}
+
+// Construct the DAG_task_queue for the SPDHSS U and B matrices construction. 
+// Task i (0 <= i < n_node) constructs the basis of node i, and task n_node + j
+// computes the j-th HSS Bij matrix. A node relies on its children and on the
+// HSS Bij matrices of the pairs that contain its children on its children's 
+// level, since it consumes these HSS Bij matrices and releases W and Yk of its 
+// children. An HSS Bij matrix relies on both nodes in its pair. Nodes on level 
+// 0 are not constructed and are marked as skipped.
+// Input parameters:
+//   h2mat        : Source H2 matrix structure
+//   n_pair       : Number of HSS Bij pairs
+//   B_pairs      : Size 2 * n_pair, HSS Bij node pairs
+//   B_pair_level : Size n_pair, level of each HSS Bij pair
+// Output parameter:
+//   *tq_ : DAG_task_queue with n_node + n_pair tasks
+static void H2P_SPDHSS_H2_build_task_queue(
+    H2Pack_p h2mat, const int n_pair, const int *B_pairs, 
+    const int *B_pair_level, DAG_task_queue_p *tq_
+)
+{
+    int n_node      = h2mat->n_node;
+    int *parent     = h2mat->parent;
+    int *node_level = h2mat->node_level;
+    int n_task      = n_node + n_pair;
+
+    // 1. Count the number of dependents of each task
+    int *DAG_src_ptr = (int*) malloc(sizeof(int) * (n_task + 1));
+    int *src_pos     = (int*) malloc(sizeof(int) * n_task);
+    ASSERT_PRINTF(
+        DAG_src_ptr != NULL && src_pos != NULL, 
+        "Failed to allocate working buffer for DAG task queue construction\n"
+    );
+    memset(DAG_src_ptr, 0, sizeof(int) * (n_task + 1));
+    for (int node = 0; node < n_node; node++) DAG_src_ptr[node + 1] = (node_level[node] == 1) ? 0 : 1;
+    for (int j = 0; j < n_pair; j++)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            int node = B_pairs[2 * j + k];
+            DAG_src_ptr[node + 1]++;
+            if (node_level[node] == B_pair_level[j] && B_pair_level[j] >= 2) DAG_src_ptr[n_node + j + 1]++;
+        }
+    }
+    for (int i = 0; i < n_task; i++) DAG_src_ptr[i + 1] += DAG_src_ptr[i];
+    int num_dep = DAG_src_ptr[n_task];
+    int *DAG_dst_idx = (int*) malloc(sizeof(int) * num_dep);
+    ASSERT_PRINTF(DAG_dst_idx != NULL, "Failed to allocate working buffer for DAG task queue construction\n");
+
+    // 2. Fill the dependents of each task
+    memcpy(src_pos, DAG_src_ptr, sizeof(int) * n_task);
+    for (int node = 0; node < n_node; node++)
+    {
+        // Nodes on level 0 are not DAG tasks, mark them as skipped
+        int level = node_level[node];
+        if (level == 0) DAG_dst_idx[src_pos[node]++] = node;
+        if (level >= 2) DAG_dst_idx[src_pos[node]++] = parent[node];
+    }
+    for (int j = 0; j < n_pair; j++)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            int node = B_pairs[2 * j + k];
+            DAG_dst_idx[src_pos[node]++] = n_node + j;
+            if (node_level[node] == B_pair_level[j] && B_pair_level[j] >= 2)
+                DAG_dst_idx[src_pos[n_node + j]++] = parent[node];
+        }
+    }
+    DAG_task_queue_init(n_task, num_dep, DAG_src_ptr, DAG_dst_idx, tq_);
+    free(DAG_src_ptr);
+    free(DAG_dst_idx);
+    free(src_pos);
+}
+
+// Streaming construction of the leaf node bases for H2P_SPDHSS_H2_build_stream().
+// Instead of keeping all partial matvec results for all levels, the off-diagonal 
+// blocks are multiplied with the random vectors twice using a single work matrix: 
+// all blocks first to construct the leaf node bases, then level by level for the 
+// blocks whose lowest common ancestor is on level c, and these results are projected 
+// onto the leaf node bases immediately.
+// Input parameters:
+//   h2mat          : Source H2 matrix structure
+//   n_vec          : Use n_vec Gaussian random vectors
+//   max_rank       : Maximum rank of the HSS matrix
+//   reltol         : Relative tolerance in column-pivoted QR
+//   shift          : Diagonal shifting
+//   HSS_D          : SPDHSS D matrices of all leaf nodes
+//   HSS_D_pair2idx : Size h2mat->n_node, index of each leaf node's SPDHSS D matrix
+//   Yk             : Size h2mat->n_node * h2mat->max_level, empty matrices
+// Output parameters:
+//   Yk, S, V, W, HSS_U : Same as after processing all leaf nodes in H2P_SPDHSS_H2_build()
+//   *is_SPD_           : 0 if any SPDHSS D matrix is not SPD, otherwise unchanged
+//   *work_msize_       : Size (in DTYPE) of working arrays before the intermediate arrays are freed
+static void H2P_SPDHSS_H2_stream_leaf(
+    H2Pack_p h2mat, const int n_vec, const int max_rank, const DTYPE reltol, const DTYPE shift,
+    H2P_dense_mat_p *HSS_D, const int *HSS_D_pair2idx, H2P_dense_mat_p *Yk, H2P_dense_mat_p *S, 
+    H2P_dense_mat_p *V, H2P_dense_mat_p *W, H2P_dense_mat_p *HSS_U, int *is_SPD_, size_t *work_msize_
+)
+{
+    int n_node          = h2mat->n_node;
+    int n_leaf_node     = h2mat->n_leaf_node;
+    int n_thread        = h2mat->n_thread;
+    int max_level       = h2mat->max_level;
+    int *leaf_nodes     = h2mat->height_nodes;
+    int *node_level     = h2mat->node_level;
+    int *mat_cluster    = h2mat->mat_cluster;
+
+    // All BLAS & LAPACK calls below are issued by OpenMP threads on different nodes
+    BLAS_SET_NUM_THREADS(1);
+
+    // 1. Prepare the Gaussian random matrix vec and H2 matvec upward sweep
+    const int kms = h2mat->krnl_mat_size;
+    size_t vec_msize = sizeof(DTYPE) * (size_t) kms * (size_t) n_vec;
+    DTYPE *vec = (DTYPE*) malloc(vec_msize);
+    DTYPE *out = (DTYPE*) malloc(vec_msize);
+    ASSERT_PRINTF(vec != NULL && out != NULL, "Failed to allocate space for SPDHSS streaming construction\n");
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        int s_row, n_row;
+        calc_block_spos_len(kms, n_thread, tid, &s_row, &n_row);
+        H2P_gen_normal_distribution(0.0, 1.0, (size_t) n_row * (size_t) n_vec, vec + (size_t) s_row * (size_t) n_vec);
+    }
+    H2P_dense_mat_p *y0 = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    H2P_dense_mat_p *y1 = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    ASSERT_PRINTF(y0 != NULL && y1 != NULL, "Failed to allocate %d working matrices\n", 2 * n_node);
+    for (int i = 0; i < n_node; i++)
+    {
+        y0[i] = NULL;
+        y1[i] = NULL;
+    }
+    H2P_SPDHSS_H2_upward_sweep(h2mat, n_vec, vec, y0);
+    for (int i = 0; i < n_node; i++)
+        if (y0[i] != NULL) H2P_dense_mat_init(&y1[i], y0[i]->nrow, n_vec);
+
+    // 2. Yk{node}{1} = A(idx_node, :) * vec - A(idx_node, idx_node) * vec, construct the leaf node bases
+    H2P_SPDHSS_H2_offdiag_matmul(h2mat, n_vec, vec, y0, y1, -1, out);
+    int is_SPD = 1;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < n_leaf_node; i++)
+        {
+            int node  = leaf_nodes[i];
+            int s_row = mat_cluster[2 * node];
+            int n_row = mat_cluster[2 * node + 1] - s_row + 1;
+            H2P_dense_mat_p *node_Yk = Yk + node * max_level;
+            H2P_dense_mat_resize(node_Yk[0], n_row, n_vec);
+            copy_matrix_block(sizeof(DTYPE), n_row, n_vec, out + (size_t) s_row * (size_t) n_vec, n_vec, node_Yk[0]->data, node_Yk[0]->ld);
+            int info = H2P_SPDHSS_H2_build_leaf_basis(
+                h2mat, node, tid, max_rank, reltol, shift, 
+                HSS_D[HSS_D_pair2idx[node]], node_Yk, S, V, W, HSS_U
+            );
+            if (info != 0) is_SPD = 0;
+        }  // End of i loop
+    }  // End of "#pragma omp parallel"
+
+    // 3. For a leaf node on level L, the projected partial matvec results are
+    //    Yk{node}{k} = V{node}' * S{node}^{-1} * sum_{c <= L-1-k} R_c(idx_node, :), k = 1, ..., L-1,
+    //    where R_c is the sum of off-diagonal blocks whose lowest common ancestor is on level c 
+    //    multiplied with vec. Compute R_c level by level and accumulate the projected results.
+    for (int c = 0; c <= max_level - 2; c++)
+    {
+        if (!is_SPD) break;
+        H2P_SPDHSS_H2_offdiag_matmul(h2mat, n_vec, vec, y0, y1, c, out);
+        #pragma omp parallel num_threads(n_thread)
+        {
+            #pragma omp for schedule(dynamic)
+            for (int i = 0; i < n_leaf_node; i++)
+            {
+                int node  = leaf_nodes[i];
+                int k     = node_level[node] - 2 - c;  // 0-based index of Yk{node}{L-1-c}
+                if (k < 0) continue;
+                int s_row = mat_cluster[2 * node];
+                DTYPE *out_blk = out + (size_t) s_row * (size_t) n_vec;
+                H2P_dense_mat_p *node_Yk = Yk + node * max_level;
+                H2P_dense_mat_p S_node = S[node];
+                H2P_dense_mat_p V_node = V[node];
+                // Yk{node}{k} = Yk{node}{k+1} + V{node}' * linsolve(S{node}, R_c(idx_node, :), struct('LT', true));
+                CBLAS_TRSM(
+                    CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
+                    S_node->nrow, n_vec, 1.0, S_node->data, S_node->ld, out_blk, n_vec
+                );
+                if (node_Yk[k] == NULL) H2P_dense_mat_init(&node_Yk[k], V_node->ncol, n_vec);
+                H2P_dense_mat_resize(node_Yk[k], V_node->ncol, n_vec);
+                DTYPE beta = 0.0;
+                if (c > 0)
+                {
+                    H2P_dense_mat_p Yk_k1 = node_Yk[k + 1];
+                    copy_matrix_block(sizeof(DTYPE), Yk_k1->nrow, Yk_k1->ncol, Yk_k1->data, Yk_k1->ld, node_Yk[k]->data, node_Yk[k]->ld);
+                    beta = 1.0;
+                }
+                CBLAS_GEMM(
+                    CblasRowMajor, CblasTrans, CblasNoTrans, V_node->ncol, n_vec, V_node->nrow,
+                    1.0, V_node->data, V_node->ld, out_blk, n_vec, beta, node_Yk[k]->data, node_Yk[k]->ld
+                );
+            }  // End of i loop
+        }  // End of "#pragma omp parallel"
+    }  // End of c loop
+
+    // 4. Free intermediate arrays
+    size_t work_msize = 2 * (size_t) kms * (size_t) n_vec;
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, y0);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, y1);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node * max_level, Yk);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, S);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, V);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, W);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, HSS_U);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_leaf_node, HSS_D);
+    for (int i = 0; i < n_node; i++)
+    {
+        H2P_dense_mat_destroy(&y0[i]);
+        H2P_dense_mat_destroy(&y1[i]);
+    }
+    free(y0);
+    free(y1);
+    free(vec);
+    free(out);
+    BLAS_SET_NUM_THREADS(n_thread);
+    if (!is_SPD) *is_SPD_ = 0;
+    *work_msize_ = work_msize;
+}
+
+// Build an SPD HSS matrix A_{HSS} from an H2 matrix s.t. A_{HSS} ~= A_{H2}
+// stream == 1 uses H2P_SPDHSS_H2_stream_leaf() instead of H2P_SPDHSS_H2_acc_matvec()
+static void H2P_SPDHSS_H2_build_with_mode(
+    const int max_rank, const DTYPE reltol, const DTYPE shift, 
+    H2Pack_p h2mat, const int stream, H2Pack_p *hssmat_
+)
+{
+    if (h2mat == NULL || h2mat->U == NULL || h2mat->is_HSS)
+    {
+        ERROR_PRINTF("Input h2mat is not constructed or configured as HSS\n");
+        return;
+    }
+
+    if (h2mat->is_RPY_Ewald)
+    {
+        ERROR_PRINTF("Cannot construct SPDHSS for RPY Ewald kernel\n");
+        return;
+    }
+
+    #ifdef __linux__
+    // Any H2P_dense_mat_t->data allocation > 1KB will use mmap instead of sbrk and can be released later
+    mallopt(M_MMAP_THRESHOLD, 1024);
+    #endif
+
+    int n_node          = h2mat->n_node;
+    int n_thread        = h2mat->n_thread;
+    int n_leaf_node     = h2mat->n_leaf_node;
+    int max_level       = h2mat->max_level;
+    int *n_child        = h2mat->n_child;
+    int *leaf_nodes     = h2mat->height_nodes;
+
     int n_level = max_level + 1;  // This is the total number of levels
 
     double st, et, build_U_t = 0.0, build_B_t = 0.0, build_D_t = 0.0;
 
-    // 1. Accumulate off-diagonal block row H2 matvec results
+    // 1. Accumulate off-diagonal block row H2 matvec results. The streaming mode 
+    //    only allocates empty Yk matrices here and fills them in step 5.5
     st = get_wtime_sec();
     int n_vec = max_rank + 10;
+    size_t work_msize = 0, peak_msize = 0;
     H2P_dense_mat_p *Yk;
-    H2P_SPDHSS_H2_acc_matvec(h2mat, n_vec, &Yk);
+    if (stream)
+    {
+        Yk = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node * max_level);
+        ASSERT_PRINTF(Yk != NULL, "Failed to allocate %d * %d Yk matrices\n", n_node, max_level);
+        for (int i = 0; i < n_node * max_level; i++)
+        {
+            H2P_dense_mat_init(&Yk[i], 8, 8);
+            Yk[i]->nrow = 0;
+            Yk[i]->ncol = 0;
+            Yk[i]->ld   = 0;
+        }
+    } else {
+        H2P_SPDHSS_H2_acc_matvec(h2mat, n_vec, &Yk, &peak_msize);
+    }
     et = get_wtime_sec();
     build_U_t += et - st;
     // printf("SPDHSS build: accumulative matvec finished %f.\n", et - st);
@@ -1792,450 +2750,137 @@ void H2P_SPDHSS_H2_build(
     et = get_wtime_sec();
     build_D_t += et - st;
 
-    // 6. Level by level hierarchical construction for U and B matrices
+    // 5.5 Streaming mode: construct leaf node bases and the projected Yk of leaf nodes
     int is_SPD = 1;
-    for (int i = max_level; i >= 1; i--)
+    if (stream)
     {
-        int *level_i_nodes = level_nodes + i * n_leaf_node;
-        int level_i_n_node = level_n_node[i];
-        int n_thread_i = MIN(level_i_n_node, n_thread);
-
-        if (!is_SPD) continue;
-
-        int level_i_HSS_Bij_n_pair = level_HSS_Bij_pairs[i]->length / 2;
-        int *level_i_HSS_Bij_pairs = level_HSS_Bij_pairs[i]->data;
-        
         st = get_wtime_sec();
-        // Build new U matrices
-        #pragma omp parallel num_threads(n_thread_i)
-        {
-            int tid = omp_get_thread_num();
-            H2P_int_vec_p   idx0 = thread_buf[tid]->idx0;
-            H2P_dense_mat_p mat0 = thread_buf[tid]->mat0;
-            H2P_dense_mat_p mat1 = thread_buf[tid]->mat1;
-            H2P_dense_mat_p mat2 = thread_buf[tid]->mat2;
+        H2P_SPDHSS_H2_stream_leaf(
+            h2mat, n_vec, max_rank, reltol, shift, HSS_D, HSS_D_pair2idx, 
+            Yk, S, V, W, HSS_U, &is_SPD, &work_msize
+        );
+        peak_msize = MAX(peak_msize, work_msize);
+        et = get_wtime_sec();
+        build_U_t += et - st;
+    }
 
-            #pragma omp for schedule(dynamic)
-            for (int j = 0; j < level_i_n_node; j++)
+    // 6. Hierarchical construction for U and B matrices with DAG scheduling. A node's 
+    //    basis is constructed as soon as its children's bases and the HSS Bij matrices 
+    //    of its children are ready, and an HSS Bij matrix is computed as soon as the 
+    //    bases of both nodes are ready, so different levels can overlap.
+    int *B_pairs      = (int*) malloc(sizeof(int) * 2 * HSS_B_n_pair);
+    int *B_pair_level = (int*) malloc(sizeof(int) * HSS_B_n_pair);
+    ASSERT_PRINTF(B_pairs != NULL && B_pair_level != NULL, "Failed to allocate work arrays for SPDHSS Bij pairs\n");
+    HSS_B_idx = 0;
+    for (int i = max_level; i >= 1; i--)
+    {
+        H2P_int_vec_p level_i_HSS_Bij_pairs = level_HSS_Bij_pairs[i];
+        for (int j = 0; j < level_i_HSS_Bij_pairs->length / 2; j++)
+        {
+            B_pairs[2 * HSS_B_idx]     = level_i_HSS_Bij_pairs->data[2 * j];
+            B_pairs[2 * HSS_B_idx + 1] = level_i_HSS_Bij_pairs->data[2 * j + 1];
+            B_pair_level[HSS_B_idx]    = i;
+            HSS_B_idx++;
+        }
+    }
+    DAG_task_queue_p SPDHSS_tq = NULL;
+    H2P_SPDHSS_H2_build_task_queue(h2mat, HSS_B_n_pair, B_pairs, B_pair_level, &SPDHSS_tq);
+
+    // Working arrays size is updated by each task, tasks only change the matrices of their own nodes
+    work_msize  = H2P_SPDHSS_H2_mats_msize(n_node * max_level, Yk);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, S);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, V);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, W);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, Minv);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_node, HSS_U);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_HSS_Bij_pair, HSS_B);
+    work_msize += H2P_SPDHSS_H2_mats_msize(n_leaf_node, HSS_D);
+    peak_msize = MAX(peak_msize, work_msize);
+
+    double U_task_t = 0.0, B_task_t = 0.0;
+    st = get_wtime_sec();
+    BLAS_SET_NUM_THREADS(1);
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        double U_t = 0.0, B_t = 0.0;
+        int task = DAG_task_queue_get_task(SPDHSS_tq);
+        while (task != -1)
+        {
+            if (!is_SPD)
             {
-                if (!is_SPD) continue;
-                int node = level_i_nodes[j];
-                int n_child_node = n_child[node];
-                int *node_children = children + node * max_child;
-
-                int info;
-                if (n_child_node == 0)
+                DAG_task_queue_finish_task(SPDHSS_tq, task);
+                task = DAG_task_queue_get_task(SPDHSS_tq);
+                continue;
+            }
+            double task_st = get_wtime_sec();
+            size_t msize0, msize1;
+            if (task < n_node)
+            {
+                // Build new U matrices
+                int node = task;
+                int info = 0;
+                msize0 = H2P_SPDHSS_H2_node_msize(h2mat, node, Yk, S, V, W, Minv, HSS_U);
+                if (n_child[node] == 0)
                 {
-                    // HSS_D_idx = HSS_D_pair2idx(node, node);
-                    int HSS_D_idx = HSS_D_pair2idx[node];
-                    H2P_dense_mat_p HSS_Dij = HSS_D[HSS_D_idx];
-                    // [S{node}, chol_flag] = chol(HSS_D{HSS_D_idx}, 'lower');
-                    H2P_dense_mat_init(&S[node], HSS_Dij->nrow, HSS_Dij->ncol);
-                    copy_matrix_block(sizeof(DTYPE), HSS_Dij->nrow, HSS_Dij->ncol, HSS_Dij->data, HSS_Dij->ld, S[node]->data, S[node]->ld);
-                    info = LAPACK_POTRF(LAPACK_ROW_MAJOR, 'L', S[node]->nrow, S[node]->data, S[node]->ld);
-                    for (int k = 0; k < S[node]->nrow; k++)
-                    {
-                        DTYPE *S_kk1 = S[node]->data + k * S[node]->nrow + (k + 1);
-                        int n_zero_row = S[node]->nrow - (k + 1);
-                        memset(S_kk1, 0, sizeof(DTYPE) * n_zero_row);
-                    }
-                    if (info != 0)
-                    {
-                        ERROR_PRINTF("Node %d potrf() returned %d, target matrix with shifting %.2lf is not SPD\n", node, info, shift);
-                        is_SPD = 0;
-                        continue;
-                    }
-                    // tmpY = linsolve(S{node}, Yk{node}{1}, struct('LT', true));
-                    H2P_dense_mat_p *node_Yk = Yk + node * max_level;
-                    H2P_dense_mat_p tmpY = mat0;
-                    H2P_dense_mat_resize(tmpY, node_Yk[0]->nrow + 1, node_Yk[0]->ncol);
-                    DTYPE *tau = tmpY->data + node_Yk[0]->nrow * node_Yk[0]->ncol;
-                    tmpY->nrow--;
-                    copy_matrix_block(sizeof(DTYPE), tmpY->nrow, tmpY->ncol, node_Yk[0]->data, node_Yk[0]->ld, tmpY->data, tmpY->ld);
-                    ASSERT_PRINTF(
-                        tmpY->nrow == S[node]->nrow, 
-                        "Node %d: tmpY->nrow (%d) mismatch S->nrow (%d)\n",
-                        node, tmpY->nrow, S[node]->nrow
-                    );
-                    CBLAS_TRSM(
-                        CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
-                        tmpY->nrow, tmpY->ncol, 1.0, S[node]->data, S[node]->ld, tmpY->data, tmpY->ld
-                    );
-                    // V_ncol = min([size(tmpY), max_rank]);
-                    // [tmpQ, ~, ~] = qr(tmpY, 0);
-                    // V{node} = tmpQ(:, 1 : V_ncol);
-                    int tmpQ_ncol = MIN(tmpY->nrow, tmpY->ncol);
-                    int V_ncol = MIN(tmpQ_ncol, max_rank);
-                    H2P_dense_mat_p tmpQ = tmpY;
-                    H2P_int_vec_p   jpvt = idx0;
-                    H2P_int_vec_set_capacity(jpvt, tmpQ->ncol);
-                    memset(jpvt->data, 0, sizeof(int) * tmpQ->ncol);
-                    LAPACK_GEQPF(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ->ncol, tmpQ->data, tmpQ->ld, jpvt->data, tau);
-                    int V_ncol1 = -1;
-                    DTYPE stop_diag = DABS(tmpQ->data[0]) * reltol;
-                    for (int k = 0; k < V_ncol; k++)
-                    {
-                        if (DABS(tmpQ->data[k * tmpQ->ld + k]) < stop_diag)
-                        {
-                            V_ncol1 = k - 1;
-                            break;
-                        }
-                    }
-                    if (V_ncol1 > 0) V_ncol = V_ncol1;
-                    LAPACK_ORGQR(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ_ncol, tmpQ_ncol, tmpQ->data, tmpQ->ld, tau);
-                    H2P_dense_mat_init(&V[node], tmpQ->nrow, V_ncol);
-                    copy_matrix_block(sizeof(DTYPE), tmpQ->nrow, V_ncol, tmpQ->data, tmpQ->ld, V[node]->data, V[node]->ld);
-                    // HSS_U{node} = S{node} * V{node};
-                    H2P_dense_mat_init(&HSS_U[node], S[node]->nrow, V[node]->ncol);
-                    CBLAS_GEMM(
-                        CblasRowMajor, CblasNoTrans, CblasNoTrans, S[node]->nrow, V[node]->ncol, S[node]->ncol,
-                        1.0, S[node]->data, S[node]->ld, V[node]->data, V[node]->ld, 0.0, HSS_U[node]->data, HSS_U[node]->ld
-                    );
-                    // Yk{node}(1) = [];
-                    // for k = 1 : length(Yk{node})
-                    //    Yk{node}{k} = V{node}' * linsolve(S{node}, Yk{node}{k}, struct('LT', true));
-                    // end
-                    int last_k = 0;
-                    for (int k = 1; k < max_level; k++)
-                    {
-                        if (node_Yk[k]->ld == 0) break;  // Empty Yk{node}{k}
-                        H2P_dense_mat_p node_Yk_k0 = node_Yk[k - 1];
-                        H2P_dense_mat_p node_Yk_k  = node_Yk[k];
-                        CBLAS_TRSM(
-                            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, 
-                            node_Yk_k->nrow, node_Yk_k->ncol, 1.0, S[node]->data, S[node]->ld, node_Yk_k->data, node_Yk_k->ld
-                        );
-                        H2P_dense_mat_resize(node_Yk_k0, V[node]->ncol, node_Yk_k->ncol);
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, node_Yk_k->ncol, V[node]->nrow,
-                            1.0, V[node]->data, V[node]->ld, node_Yk_k->data, node_Yk_k->ld, 0.0, node_Yk_k0->data, node_Yk_k0->ld
-                        );
-                        last_k = k;
-                    }  // End of k loop
-                    H2P_dense_mat_destroy(&node_Yk[last_k]);
-                    // if (~isempty(H2_U{node}))
-                    //     W{node} = V{node}' * linsolve(S{node}, H2_U{node}, struct('LT', true));
-                    // end
-                    H2P_dense_mat_p H2_U_node = H2_U[node];
-                    if (H2_U_node->ld > 0)
+                    // Leaf nodes have been processed in step 5.5 in the streaming mode
+                    if (!stream)
                     {
-                        H2P_dense_mat_p tmpM = tmpQ;
-                        H2P_dense_mat_resize(tmpM, H2_U_node->nrow, H2_U_node->ncol);
-                        copy_matrix_block(sizeof(DTYPE), H2_U_node->nrow, H2_U_node->ncol, H2_U_node->data, H2_U_node->ld, tmpM->data, tmpM->ld);
-                        ASSERT_PRINTF(
-                            tmpM->nrow == S[node]->nrow, 
-                            "Node %d: H2_U->nrow (%d) mismatch S->nrow (%d)\n",
-                            node, tmpM->nrow, S[node]->nrow
+                        info = H2P_SPDHSS_H2_build_leaf_basis(
+                            h2mat, node, tid, max_rank, reltol, shift, 
+                            HSS_D[HSS_D_pair2idx[node]], Yk + node * max_level, S, V, W, HSS_U
                         );
-                        CBLAS_TRSM(
-                            CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit,
-                            tmpM->nrow, tmpM->ncol, 1.0, S[node]->data, S[node]->ld, tmpM->data, tmpM->ld
-                        );
-                        H2P_dense_mat_init(&W[node], V[node]->ncol, tmpM->ncol);
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM->ncol, V[node]->nrow,
-                            1.0, V[node]->data, V[node]->ld, tmpM->data, tmpM->ld, 0.0, W[node]->data, W[node]->ld
-                        );
-                    }  // End of "if (H2_U_node->ld > 0)"
-                } else {  // Else of "if (n_child_node == 0)"
-                    // (1) Construct the intermediate blocks defined by its children nodes
-                    H2P_int_vec_set_capacity(idx0, n_child_node + 1);
-                    int *offset = idx0->data;
-                    offset[0] = 0;
-                    for (int k = 0; k < n_child_node; k++)
-                    {
-                        int child_k = node_children[k];
-                        offset[k + 1] = offset[k] + HSS_U[child_k]->ncol;
-                    }
-                    int tmpB_nrow = offset[n_child_node];
-                    H2P_dense_mat_p tmpB = mat0;
-                    H2P_dense_mat_resize(tmpB, tmpB_nrow + 1, tmpB_nrow);
-                    tmpB->nrow--;
-                    for (int k = 0; k < n_child_node; k++)
-                    {
-                        int child_k = node_children[k];
-                        // idx_k = offset(k) : offset(k+1)-1;
-                        int idx_k_s = offset[k];
-                        int idx_k_len = offset[k + 1] - idx_k_s;
-                        for (int l = k + 1; l < n_child_node; l++)
-                        {
-                            int child_l = node_children[l];
-                            // idx_l = offset(l) : offset(l+1)-1;
-                            int idx_l_s = offset[l];
-                            // B_idx = B_pair2idx(child_k, child_l);
-                            int HSS_B_idx = H2P_get_int_CSR_elem(HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, child_k, child_l);
-                            ASSERT_PRINTF(HSS_B_idx != 0, "SPDHSS_B{%d, %d} does not exist!\n", child_k, child_l);
-                            HSS_B_idx--;
-                            H2P_dense_mat_p HSS_B_kl = HSS_B[HSS_B_idx];
-                            // tmpB(idx_k, idx_l) = HSS_B{B_idx};
-                            DTYPE *tmpB_kl = tmpB->data + idx_k_s * tmpB->ld + idx_l_s;
-                            copy_matrix_block(sizeof(DTYPE), HSS_B_kl->nrow, HSS_B_kl->ncol, HSS_B_kl->data, HSS_B_kl->ld, tmpB_kl, tmpB->ld);
-                            // tmpB(idx_l, idx_k) = HSS_B{B_idx}';
-                            // LAPACK_SYEVD only need uppertriangle, no need to fill the lower triangle part
-                            //DTYPE *tmpB_lk = tmpB->data + idx_l_s * tmpB->ld + idx_k_s;
-                            //H2P_transpose_dmat(1, HSS_B_kl->nrow, HSS_B_kl->ncol, HSS_B_kl->data, HSS_B_kl->ld, tmpB_lk, tmpB->ld);
-                        }
-                        // Set the diagonal block to zero
-                        for (int l = idx_k_s; l < idx_k_s + idx_k_len; l++)
-                        {
-                            DTYPE *tmpB_l_ks = tmpB->data + l * tmpB->ld + idx_k_s;
-                            memset(tmpB_l_ks, 0, sizeof(DTYPE) * idx_k_len);
-                        }
-                    }  // End of k loop
-
-                    // (2) Decompose the diagonal matrix
-                    H2P_dense_mat_p tmpQ = tmpB;
-                    DTYPE *tmpE_diag = tmpB->data + tmpQ->nrow * tmpQ->nrow;
-                    // [tmpQ, tmpE] = eig(tmpB);
-                    // tmpE_diag = diag(tmpE);
-                    info = LAPACK_SYEVD(LAPACK_ROW_MAJOR, 'V', 'U', tmpQ->nrow, tmpQ->data, tmpQ->ld, tmpE_diag);
-                    if (info != 0)
-                    {
-                        ERROR_PRINTF("Node %d intermediate diagonal matrix cannot be diagonalized\n", node);
-                        is_SPD = 0;
-                        continue;
-                    }
-                    DTYPE min_diag = 19241112.0;
-                    for (int k = 0; k < tmpQ->nrow; k++) min_diag = MIN(min_diag, tmpE_diag[k]);
-                    if (min_diag <= -1.0)
-                    {
-                        ERROR_PRINTF("Node %d intermediate diagonal matrix has eigenvalue %e < -1\n", node, min_diag);
-                        ERROR_PRINTF("Source H2 matrix with shifting %.3lf is not SPD\n", shift);
-                        is_SPD = 0;
-                        continue;
                     }
-                    H2P_dense_mat_p tmpM  = mat1;  // tmpM need to be reused later!
-                    H2P_dense_mat_p tmpQ1 = mat2;
-                    // tmpM = tmpQ * diag((1 + tmpE_diag).^0.5) * tmpQ';
-                    #pragma omp simd
-                    for (int k = 0; k < tmpQ->nrow; k++)
-                        tmpE_diag[k] = DSQRT(1.0 + tmpE_diag[k]);
-                    H2P_dense_mat_resize(tmpQ1, tmpQ->nrow, tmpQ->ncol);
-                    for (int k = 0; k < tmpQ->nrow; k++)
-                    {
-                        DTYPE *tmpQ_k  = tmpQ->data  + k * tmpQ->ncol;
-                        DTYPE *tmpQ1_k = tmpQ1->data + k * tmpQ->ncol;
-                        #pragma omp simd
-                        for (int l = 0; l < tmpQ->ncol; l++)
-                            tmpQ1_k[l] = tmpQ_k[l] * tmpE_diag[l];
-                    }
-                    H2P_dense_mat_resize(tmpM, tmpQ->nrow, tmpQ->nrow);
-                    CBLAS_GEMM(
-                        CblasRowMajor, CblasNoTrans, CblasTrans, tmpQ->nrow, tmpQ->nrow, tmpQ->nrow,
-                        1.0, tmpQ1->data, tmpQ1->ld, tmpQ->data, tmpQ->ld, 0.0, tmpM->data, tmpM->ld
-                    );
-                    // Minv{node} = tmpQ * diag((1 + tmpE_diag).^-0.5) * tmpQ';
-                    #pragma omp simd
-                    for (int k = 0; k < tmpQ->nrow; k++)
-                        tmpE_diag[k] = 1.0 / tmpE_diag[k];
-                    H2P_dense_mat_resize(tmpQ1, tmpQ->nrow, tmpQ->ncol);
-                    for (int k = 0; k < tmpQ->nrow; k++)
-                    {
-                        DTYPE *tmpQ_k  = tmpQ->data  + k * tmpQ->ncol;
-                        DTYPE *tmpQ1_k = tmpQ1->data + k * tmpQ->ncol;
-                        #pragma omp simd
-                        for (int l = 0; l < tmpQ->ncol; l++)
-                            tmpQ1_k[l] = tmpQ_k[l] * tmpE_diag[l];
-                    }
-                    H2P_dense_mat_init(&Minv[node], tmpQ->nrow, tmpQ->nrow);
-                    CBLAS_GEMM(
-                        CblasRowMajor, CblasNoTrans, CblasTrans, tmpQ->nrow, tmpQ->nrow, tmpQ->nrow,
-                        1.0, tmpQ1->data, tmpQ1->ld, tmpQ->data, tmpQ->ld, 0.0, Minv[node]->data, Minv[node]->ld
-                    );
-                    // Now mat0 and mat2 can be reused
-
-                    // (3) Construct basis matrix
-                    H2P_dense_mat_p *node_Yk = Yk + node * max_level;
-                    H2P_int_vec_p tmpYk_idx = idx0;
-                    H2P_int_vec_set_capacity(tmpYk_idx, n_child_node);
-                    tmpYk_idx->length = n_child_node;
-                    for (int l = 0; l < node_level[node]; l++)
-                    {
-                        for (int k = 0; k < n_child_node; k++)
-                        {
-                            int child_k = node_children[k];
-                            tmpYk_idx->data[k] = child_k * max_level + l;
-                        }
-                        H2P_dense_mat_p node_Yk_l = node_Yk[l];
-                        H2P_dense_mat_vertcat(Yk, tmpYk_idx, node_Yk_l);
-                        for (int k = 0; k < n_child_node; k++)
-                        {
-                            int child_k = node_children[k];
-                            int Yk_idx = child_k * max_level + l;
-                            H2P_dense_mat_destroy(&Yk[Yk_idx]);
-                        }
-                    }
-
-                    // tmpY = Minv{node} * Yk{node}{1};
-                    H2P_dense_mat_p tmpY = mat0;
-                    H2P_dense_mat_resize(tmpY, Minv[node]->nrow + 1, node_Yk[0]->ncol);
-                    DTYPE *tau = tmpY->data + Minv[node]->nrow * node_Yk[0]->ncol;
-                    tmpY->nrow--;
-                    ASSERT_PRINTF(
-                        Minv[node]->ncol == node_Yk[0]->nrow,
-                        "Node %d: Minv->ncol (%d) mismatch node_Yk[0]->nrow (%d)\n",
-                        node, Minv[node]->ncol, node_Yk[0]->nrow
-                    );
-                    CBLAS_GEMM(
-                        CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, tmpY->ncol, Minv[node]->ncol,
-                        1.0, Minv[node]->data, Minv[node]->ld, node_Yk[0]->data, node_Yk[0]->ld, 0.0, tmpY->data, tmpY->ld
-                    );
-                    // tmpQ_ncol = min([size(tmpY), max_rank]);
-                    // [tmpQ, ~, ~] = qr(tmpY, 0);
-                    // V{node} = tmpQ(:, 1 : tmpQ_ncol);
-                    int tmpQ_ncol = MIN(tmpY->nrow, tmpY->ncol);
-                    int V_ncol = MIN(tmpQ_ncol, max_rank);
-                    tmpQ = tmpY;
-                    H2P_int_vec_p jpvt = idx0;
-                    H2P_int_vec_set_capacity(jpvt, tmpQ->ncol);
-                    memset(jpvt->data, 0, sizeof(int) * tmpQ->ncol);
-                    LAPACK_GEQPF(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ->ncol, tmpQ->data, tmpQ->ld, jpvt->data, tau);
-                    int V_ncol1 = -1;
-                    DTYPE stop_diag = DABS(tmpQ->data[0]) * reltol;
-                    for (int k = 0; k < V_ncol; k++)
-                    {
-                        if (DABS(tmpQ->data[k * tmpQ->ld + k]) < stop_diag)
-                        {
-                            V_ncol1 = k - 1;
-                            break;
-                        }
-                    }
-                    if (V_ncol1 > 0) V_ncol = V_ncol1;
-                    LAPACK_ORGQR(LAPACK_ROW_MAJOR, tmpQ->nrow, tmpQ_ncol, tmpQ_ncol, tmpQ->data, tmpQ->ld, tau);
-                    H2P_dense_mat_init(&V[node], tmpQ->nrow, V_ncol);
-                    copy_matrix_block(sizeof(DTYPE), tmpQ->nrow, V_ncol, tmpQ->data, tmpQ->ld, V[node]->data, V[node]->ld);
-                    // HSS_U{node} = tmpM * V{node};
-                    H2P_dense_mat_init(&HSS_U[node], tmpM->nrow, V[node]->ncol);
-                    CBLAS_GEMM(
-                        CblasRowMajor, CblasNoTrans, CblasNoTrans, tmpM->nrow, V[node]->ncol, tmpM->ncol,
-                        1.0, tmpM->data, tmpM->ld, V[node]->data, V[node]->ld, 0.0, HSS_U[node]->data, HSS_U[node]->ld
+                } else {
+                    info = H2P_SPDHSS_H2_build_nonleaf_basis(
+                        h2mat, node, tid, max_rank, reltol, shift, HSS_B_p2i_rowptr, 
+                        HSS_B_p2i_colidx, HSS_B_p2i_val, HSS_B, Yk, V, W, Minv, HSS_U
                     );
-                    // Now mat1 can be reused
-
-                    // Yk{node}(1) = [];
-                    // for k = 1 : length(Yk{node})
-                    //     Yk{node}{k} = V{node}' * Minv{node} * Yk{node}{k};
-                    // end
-                    int last_k = 0;
-                    for (int k = 1; k < max_level; k++)
-                    {
-                        if (node_Yk[k]->ld == 0) break;  // Empty Yk{node}{k}
-                        H2P_dense_mat_p node_Yk_k0 = node_Yk[k - 1];
-                        H2P_dense_mat_p node_Yk_k  = node_Yk[k];
-                        H2P_dense_mat_resize(tmpM, Minv[node]->nrow, node_Yk_k->ncol);
-                        ASSERT_PRINTF(
-                            Minv[node]->ncol == node_Yk_k->nrow,
-                            "Node %d: Minv->ncol (%d) mismatch node_Yk[%d]->nrow (%d)",
-                            node, Minv[node]->ncol, k, node_Yk_k->nrow
-                        );
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, node_Yk_k->ncol, Minv[node]->ncol,
-                            1.0, Minv[node]->data, Minv[node]->ld, node_Yk_k->data, node_Yk_k->ld, 0.0, tmpM->data, tmpM->ld
-                        );
-                        H2P_dense_mat_resize(node_Yk_k0, V[node]->ncol, tmpM->ncol);
-                        ASSERT_PRINTF(
-                            V[node]->nrow == Minv[node]->nrow,
-                            "Node %d: V->nrow (%d) mismatch tmpM->ncol (%d)\n", 
-                            node, V[node]->nrow, Minv[node]->nrow
-                        );
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM->ncol, V[node]->nrow,
-                            1.0, V[node]->data, V[node]->ld, tmpM->data, tmpM->ld, 0.0, node_Yk_k0->data, node_Yk_k0->ld
-                        );
-                        last_k = k;
-                    }  // End of k loop
-                    H2P_dense_mat_destroy(&node_Yk[last_k]);
-                    // if (~isempty(H2_U{node}))
-                    //     child_node = children(node, 1 : n_child_node);
-                    //     tmpW = blkdiag(W{child_node});
-                    //     W{node} = V{node}' * (Minv{node} * (tmpW * H2_U{node}));
-                    // end
-                    H2P_dense_mat_p H2_U_node = H2_U[node];
-                    if (H2_U_node->ld > 0)
-                    {
-                        H2P_dense_mat_p tmpM0 = mat1;
-                        H2P_dense_mat_p tmpM1 = mat2;
-                        // Don't use blkdiag, directly multiple each child node's W with H2_U{node}
-                        int tmpW_nrow = 0, tmpW_ncol = 0;
-                        for (int k = 0; k < n_child_node; k++)
-                        {
-                            int child_k = node_children[k];
-                            tmpW_nrow += W[child_k]->nrow;
-                            tmpW_ncol += W[child_k]->ncol;
-                        }
-                        ASSERT_PRINTF(
-                            tmpW_ncol == H2_U_node->nrow,
-                            "Node %d: tmpW->ncol (%d) mismatch H2_U->nrow (%d)\n",
-                            node, tmpW_ncol, H2_U_node->nrow
-                        );
-                        H2P_dense_mat_resize(tmpM0, tmpW_nrow, H2_U_node->ncol);
-                        tmpW_nrow = 0;
-                        tmpW_ncol = 0;
-                        for (int k = 0; k < n_child_node; k++)
-                        {
-                            int child_k = node_children[k];
-                            H2P_dense_mat_p W_k = W[child_k];
-                            DTYPE *tmpM0_k_row = tmpM0->data + tmpW_nrow * tmpM0->ld;
-                            DTYPE *H2_U_k_col  = H2_U_node->data + tmpW_ncol * H2_U_node->ld;
-                            CBLAS_GEMM(
-                                CblasRowMajor, CblasNoTrans, CblasNoTrans, W_k->nrow, H2_U_node->ncol, W_k->ncol,
-                                1.0, W_k->data, W_k->ld, H2_U_k_col, H2_U_node->ld, 0.0, tmpM0_k_row, tmpM0->ld
-                            );
-                            tmpW_nrow += W_k->nrow;
-                            tmpW_ncol += W_k->ncol;
-                            H2P_dense_mat_destroy(&W[child_k]);
-                        }
-                        // The rest GEMM 
-                        H2P_dense_mat_resize(tmpM1, Minv[node]->nrow, tmpM0->ncol);
-                        ASSERT_PRINTF(
-                            Minv[node]->ncol == tmpM0->nrow,
-                            "Node %d: Minv->ncol (%d) mismatch tmpM0->nrow (%d)\n",
-                            node, Minv[node]->ncol, tmpM0->nrow
-                        );
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasNoTrans, CblasNoTrans, Minv[node]->nrow, tmpM0->ncol, Minv[node]->ncol, 
-                            1.0, Minv[node]->data, Minv[node]->ld, tmpM0->data, tmpM0->ld, 0.0, tmpM1->data, tmpM1->ld
-                        );
-                        H2P_dense_mat_init(&W[node], V[node]->ncol, tmpM1->ncol);
-                        ASSERT_PRINTF(
-                            V[node]->nrow == tmpM1->nrow,
-                            "Node %d: V->nrow (%d) mismatch tmpM1->nrow (%d)\n",
-                            node, V[node]->nrow, tmpM1->nrow
-                        );
-                        CBLAS_GEMM(
-                            CblasRowMajor, CblasTrans, CblasNoTrans, V[node]->ncol, tmpM1->ncol, V[node]->nrow,
-                            1.0, V[node]->data, V[node]->ld, tmpM1->data, tmpM1->ld, 0.0, W[node]->data, W[node]->ld
-                        );
-                    }  // End of "if (H2_U_node->ld > 0)"
-                }  // End of "if (n_child_node == 0)"
-            }  // End of j loop
-        }  // End of "#pragma omp parallel"
-        et = get_wtime_sec();
-        build_U_t += et - st;
-        // printf("SPDHSS build at %d level: U build %f.\n", i, et - st);
-        fflush(stdout);
-
-        st = get_wtime_sec();
-        // Build new B matrices
-        #pragma omp parallel num_threads(n_thread_i)
-        {
-            int tid = omp_get_thread_num();
-            #pragma omp for schedule(dynamic)
-            for (int j = 0; j < level_i_HSS_Bij_n_pair; j++)
-            {
-                int node0 = level_i_HSS_Bij_pairs[2 * j];
-                int node1 = level_i_HSS_Bij_pairs[2 * j + 1];
+                }
+                if (info != 0) is_SPD = 0;
+                msize1 = H2P_SPDHSS_H2_node_msize(h2mat, node, Yk, S, V, W, Minv, HSS_U);
+                U_t += get_wtime_sec() - task_st;
+            } else {
+                // Build new B matrices
+                int node0 = B_pairs[2 * (task - n_node)];
+                int node1 = B_pairs[2 * (task - n_node) + 1];
+                msize0 = H2P_SPDHSS_H2_pair_msize(
+                    h2mat, node0, node1, HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, HSS_B
+                );
                 H2P_SPDHSS_H2_calc_HSS_Bij(
                     h2mat, node0, node1, tid, S, V, W, Minv, 
                     HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, HSS_B
                 );
-            }  // End of j loop
-        }  // End of "#pragma omp parallel"
-        et = get_wtime_sec();
-        build_B_t += et - st;
-        // printf("SPDHSS build at %d level: B build %f.\n", i, et - st);
-        fflush(stdout);
-    }  // End of i loop
+                msize1 = H2P_SPDHSS_H2_pair_msize(
+                    h2mat, node0, node1, HSS_B_p2i_rowptr, HSS_B_p2i_colidx, HSS_B_p2i_val, HSS_B
+                );
+                B_t += get_wtime_sec() - task_st;
+            }
+            #pragma omp critical(SPDHSS_work_msize)
+            {
+                work_msize = work_msize + msize1 - msize0;
+                peak_msize = MAX(peak_msize, work_msize);
+            }
+            DAG_task_queue_finish_task(SPDHSS_tq, task);
+            task = DAG_task_queue_get_task(SPDHSS_tq);
+        }  // End of "while (task != -1)"
+        #pragma omp atomic
+        U_task_t += U_t;
+        #pragma omp atomic
+        B_task_t += B_t;
+    }  // End of "#pragma omp parallel"
+    BLAS_SET_NUM_THREADS(n_thread);
+    et = get_wtime_sec();
+    // Split the wall time of the DAG by the accumulated run time of U and B tasks
+    double task_t = U_task_t + B_task_t;
+    if (task_t > 0.0)
+    {
+        build_U_t += (et - st) * U_task_t / task_t;
+        build_B_t += (et - st) * B_task_t / task_t;
+    }
+    DAG_task_queue_destroy(&SPDHSS_tq);
+    free(B_pairs);
+    free(B_pair_level);
 
     // 7. Wrap the new SPD HSS matrix
     H2P_SPDHSS_H2_wrap_new_HSS(
@@ -2246,6 +2891,10 @@ void H2P_SPDHSS_H2_build(
     (*hssmat_)->timers[B_BUILD_TIMER_IDX] = build_B_t;
     (*hssmat_)->timers[D_BUILD_TIMER_IDX] = build_D_t;
     (*hssmat_)->is_HSS_SPD = is_SPD; 
+    // HSS_{B, D} are copied into the new HSS matrix while the working arrays are still alive
+    work_msize += (*hssmat_)->mat_size[B_SIZE_IDX] + (*hssmat_)->mat_size[D_SIZE_IDX];
+    peak_msize = MAX(peak_msize, work_msize);
+    (*hssmat_)->mat_size[SPDHSS_PEAK_SIZE_IDX] = peak_msize;
 
     #ifdef __linux__
     // Restore default value
@@ -2280,3 +2929,21 @@ void H2P_SPDHSS_H2_build(
     free(HSS_B_p2i_colidx);
     free(HSS_B_p2i_val);
 }
+
+// Build an SPD HSS matrix A_{HSS} from an H2 matrix s.t. A_{HSS} ~= A_{H2}
+void H2P_SPDHSS_H2_build(
+    const int max_rank, const DTYPE reltol, const DTYPE shift, 
+    H2Pack_p h2mat, H2Pack_p *hssmat_
+)
+{
+    H2P_SPDHSS_H2_build_with_mode(max_rank, reltol, shift, h2mat, 0, hssmat_);
+}
+
+// Build an SPD HSS matrix A_{HSS} from an H2 matrix using the memory-lean streaming construction
+void H2P_SPDHSS_H2_build_stream(
+    const int max_rank, const DTYPE reltol, const DTYPE shift, 
+    H2Pack_p h2mat, H2Pack_p *hssmat_
+)
+{
+    H2P_SPDHSS_H2_build_with_mode(max_rank, reltol, shift, h2mat, 1, hssmat_);
+}
@@ -20,6 +20,45 @@ void H2P_SPDHSS_H2_build(
     H2Pack_p h2mat, H2Pack_p *hssmat_
 );
 
+// Construct an SPD HSS matrix from a H2 matrix using a memory-lean streaming construction.
+// H2P_SPDHSS_H2_build() keeps the partial H2 matvec results of all levels and the explicit
+// U matrices, which need O(krnl_mat_size * (max_rank + 10) * max_level) memory. This function
+// only keeps one krnl_mat_size * (max_rank + 10) work matrix for the partial H2 matvec results 
+// and projects them onto the leaf node bases level by level, at the cost of about twice 
+// the H2 matvec operations. The results are the same as H2P_SPDHSS_H2_build() up to 
+// the randomness of the Gaussian random vectors. The peak size of working arrays in both 
+// functions, including the copies of B and D matrices in the new HSS matrix, is stored in 
+// (*hssmat_)->mat_size[SPDHSS_PEAK_SIZE_IDX]. The non-leaf node basis and B matrix 
+// construction is the same in both functions. Its working arrays (mostly intermediate B 
+// matrices) often dominate the peak for small max_rank or shallow trees, and then both 
+// functions have the same peak memory. This function saves memory for deep trees and 
+// large max_rank, where the partial H2 matvec results dominate. For example, for the 2D 
+// Gaussian kernel with 20000 points and 5 tree levels, the peaks of the default and 
+// streaming construction are 281 and 281 MB for max_rank = 100, 462 and 389 MB for 
+// max_rank = 300, and 753 and 495 MB for max_rank = 500. With 40000 points and the same 
+// tree depth, the intermediate B matrices dominate again (891 and 876 MB, max_rank = 300).
+// Input and output parameters are the same as H2P_SPDHSS_H2_build().
+void H2P_SPDHSS_H2_build_stream(
+    const int max_rank, const DTYPE reltol, const DTYPE shift, 
+    H2Pack_p h2mat, H2Pack_p *hssmat_
+);
+
+// Wrap up a new HSS matrix with calculated HSS_{U, B, D} and the hierarchical tree 
+// information of h2mat, HSS_U is taken by the new HSS matrix and HSS_{B, D} are copied
+// Input parameters:
+//   h2mat          : Source H2 matrix or partitioned tree, HSS (in)admissible pairs and 
+//                    permutation indices should be available
+//   HSS_{U, B, D}  : New U/B/D matrices
+//   HSS_B_p2i_{*}  : CSR matrix array triple, convert (i, j) pair to an index for HSS_B
+//   HSS_D_pair2idx : Size h2mat->n_node, convert (i, i) pair to an index for HSS_D
+// Output parameter:
+//   *hssmat_ : New HSS matrix
+void H2P_SPDHSS_H2_wrap_new_HSS(
+    H2Pack_p h2mat, H2P_dense_mat_p *HSS_U, H2P_dense_mat_p *HSS_B, H2P_dense_mat_p *HSS_D, 
+    const int *HSS_B_p2i_rowptr, const int *HSS_B_p2i_colidx, const int *HSS_B_p2i_val, 
+    const int *HSS_D_pair2idx, H2Pack_p *hssmat_
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,7 +14,7 @@
 // Initialize an H2P_tree_node structure
 void H2P_tree_node_init(H2P_tree_node_p *node_, const int dim)
 {
-    const int max_child = 1 << dim;
+    const int max_child = H2P_MAX_CHILD(dim);
     H2P_tree_node_p node = (H2P_tree_node_p) malloc(sizeof(struct H2P_tree_node));
     ASSERT_PRINTF(node != NULL, "Failed to allocate H2P_tree_node structure\n");
     node->children = (void**) malloc(sizeof(H2P_tree_node_p) * max_child);
@@ -422,9 +422,16 @@ void H2P_thread_buf_init(H2P_thread_buf_p *thread_buf_, const int krnl_mat_size)
     H2P_dense_mat_init(&thread_buf->mat0, 1024, 1);
     H2P_dense_mat_init(&thread_buf->mat1, 1024, 1);
     H2P_dense_mat_init(&thread_buf->mat2, 1024, 1);
+    thread_buf->y = NULL;
+    if (krnl_mat_size > 0) H2P_thread_buf_alloc_y(thread_buf, krnl_mat_size);
+    *thread_buf_ = thread_buf;
+}
+
+void H2P_thread_buf_alloc_y(H2P_thread_buf_p thread_buf, const int krnl_mat_size)
+{
+    if (thread_buf->y != NULL) return;
     thread_buf->y = (DTYPE*) malloc_aligned(sizeof(DTYPE) * krnl_mat_size, 64);
     ASSERT_PRINTF(thread_buf->y != NULL, "Failed to allocate y of size %d in H2P_thread_buf\n", krnl_mat_size);
-    *thread_buf_ = thread_buf;
 }
 
 void H2P_thread_buf_destroy(H2P_thread_buf_p *thread_buf_)
@@ -17,7 +17,7 @@ struct H2P_tree_node
     int   level;          // Level of this node on the tree (root == 0)
     int   height;         // Height of this node on the tree (leaf node == 0)
     int   pt_cluster[2];  // The start and end indices of points belong to this node
-    void  **children;     // Size 2^dim, all children nodes of this node
+    void  **children;     // Size H2P_MAX_CHILD(dim), all children nodes of this node
     DTYPE *enbox;         // Size 2*dim, box that encloses all points of this node. 
                           // enbox[0 : dim-1] are the smallest corner coordinate,
                           // enbox[dim : 2*dim-1] are the size of this box.
@@ -288,18 +288,27 @@ struct H2P_thread_buf
     H2P_dense_mat_p mat0;   // H2P_build_H2_UJ_proxy, H2P_build_HSS_UJ_hybrid
     H2P_dense_mat_p mat1;   // H2P_build_H2_UJ_proxy, H2P_build_HSS_UJ_hybrid, H2P_matvec
     H2P_dense_mat_p mat2;   // H2P_build_HSS_UJ_hybrid
-    DTYPE  *y;              // Used in H2P_matvec
+    DTYPE  *y;              // Used in H2P_matvec, not allocated for HSS matrices until needed
     double timer;           // Used for profiling
 };
 typedef struct H2P_thread_buf* H2P_thread_buf_p;
 
 // Initialize an H2P_thread_buf structure
 // Input parameter:
-//   krnl_mat_size : Size of the kernel matrix
+//   krnl_mat_size : Size of the kernel matrix, if <= 0, thread_buf->y will 
+//                   not be allocated until H2P_thread_buf_alloc_y() is called
 // Output parameter:
 //   thread_buf_ : Initialized H2P_thread_buf structure
 void H2P_thread_buf_init(H2P_thread_buf_p *thread_buf_, const int krnl_mat_size);
 
+// Allocate thread_buf->y if it has not been allocated
+// Input parameters:
+//   thread_buf    : Initialized H2P_thread_buf structure
+//   krnl_mat_size : Size of the kernel matrix
+// Output parameter:
+//   thread_buf : H2P_thread_buf structure with allocated y
+void H2P_thread_buf_alloc_y(H2P_thread_buf_p thread_buf, const int krnl_mat_size);
+
 // Destroy an H2P_thread_buf structure
 // Input parameter:
 //   thread_buf : H2P_thread_buf structure to be destroyed 
@@ -826,10 +826,11 @@ void H2P_build_B_AOT(H2Pack_p h2pack)
                 // (1) Two nodes are of the same level, compress on both sides
                 if (level0 == level1)
                 {
-                    krnl_eval(
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
                         J_coord[node0]->data, J_coord[node0]->ncol, J_coord[node0]->ncol,
                         J_coord[node1]->data, J_coord[node1]->ncol, J_coord[node1]->ncol,
-                        krnl_param, Bi, J_coord[node1]->ncol * krnl_dim
+                        Bi, J_coord[node1]->ncol * krnl_dim
                     );
                 }
                 
@@ -840,10 +841,11 @@ void H2P_build_B_AOT(H2Pack_p h2pack)
                     int pt_s1 = pt_cluster[2 * node1];
                     int pt_e1 = pt_cluster[2 * node1 + 1];
                     int node1_npt = pt_e1 - pt_s1 + 1;
-                    krnl_eval(
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
                         J_coord[node0]->data, J_coord[node0]->ncol, J_coord[node0]->ncol,
-                        coord + pt_s1, n_point, node1_npt, 
-                        krnl_param, Bi, node1_npt * krnl_dim
+                        coord + pt_s1, n_point, node1_npt,
+                        Bi, node1_npt * krnl_dim
                     );
                 }
                 
@@ -854,10 +856,11 @@ void H2P_build_B_AOT(H2Pack_p h2pack)
                     int pt_s0 = pt_cluster[2 * node0];
                     int pt_e0 = pt_cluster[2 * node0 + 1];
                     int node0_npt = pt_e0 - pt_s0 + 1;
-                    krnl_eval(
-                        coord + pt_s0, n_point, node0_npt, 
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
+                        coord + pt_s0, n_point, node0_npt,
                         J_coord[node1]->data, J_coord[node1]->ncol, J_coord[node1]->ncol,
-                        krnl_param, Bi, J_coord[node1]->ncol * krnl_dim
+                        Bi, J_coord[node1]->ncol * krnl_dim
                     );
                 }
             }  // End of i loop
@@ -1074,10 +1077,11 @@ void H2P_build_D_AOT(H2Pack_p h2pack)
                 int pt_e = pt_cluster[2 * node + 1];
                 int node_npt = pt_e - pt_s + 1;
                 DTYPE *Di = D_data + D_ptr[i];
-                krnl_eval(
+                H2P_eval_kernel_matrix_tiled(
+                    krnl_param, krnl_eval, krnl_dim, 
                     coord + pt_s, n_point, node_npt,
                     coord + pt_s, n_point, node_npt,
-                    krnl_param, Di, node_npt * krnl_dim
+                    Di, node_npt * krnl_dim
                 );
             }
         }  // End of i_blk0 loop
@@ -1105,10 +1109,11 @@ void H2P_build_D_AOT(H2Pack_p h2pack)
                 int node0_npt = pt_e0 - pt_s0 + 1;
                 int node1_npt = pt_e1 - pt_s1 + 1;
                 DTYPE *Di = D_data + D_ptr[i + n_leaf_node];
-                krnl_eval(
+                H2P_eval_kernel_matrix_tiled(
+                    krnl_param, krnl_eval, krnl_dim, 
                     coord + pt_s0, n_point, node0_npt,
                     coord + pt_s1, n_point, node1_npt,
-                    krnl_param, Di, node1_npt * krnl_dim
+                    Di, node1_npt * krnl_dim
                 );
             }
         }  // End of i_blk1 loop
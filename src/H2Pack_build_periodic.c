@@ -10,6 +10,7 @@
 #include "H2Pack_typedef.h"
 #include "H2Pack_aux_structs.h"
 #include "H2Pack_build_periodic.h"
+#include "H2Pack_pkernel_tab.h"
 #include "H2Pack_utils.h"
 #include "utils.h"
 
@@ -21,13 +22,13 @@ void H2P_build_periodic_block(H2Pack_p h2pack)
     int krnl_dim  = h2pack->krnl_dim;
     int root_idx  = h2pack->root_idx;
     int n_lattice = h2pack->n_lattice;
+    int n_thread  = h2pack->n_thread;
     void  *krnl_param   = h2pack->krnl_param;
     void  *pkrnl_param  = h2pack->pkrnl_param;
     DTYPE *enbox0_width = h2pack->enbox + (root_idx * (2 * pt_dim) + pt_dim);
     DTYPE *per_lattices = h2pack->per_lattices;
-    H2P_dense_mat_p  root_J_coord   = h2pack->J_coord[root_idx];
-    H2P_dense_mat_p  root_J_coord_s = h2pack->tb[0]->mat0;
-    H2P_dense_mat_p  krnl_mat_blk   = h2pack->tb[0]->mat1;
+    H2P_dense_mat_p  root_J_coord = h2pack->J_coord[root_idx];
+    H2P_thread_buf_p *thread_buf  = h2pack->tb;
     kernel_eval_fptr krnl_eval  = h2pack->krnl_eval;
     kernel_eval_fptr pkrnl_eval = h2pack->pkrnl_eval;
 
@@ -36,43 +37,332 @@ void H2P_build_periodic_block(H2Pack_p h2pack)
     DTYPE *per_blk = (DTYPE*) malloc_aligned(sizeof(DTYPE) * per_blk_size * per_blk_size, 64);
     ASSERT_PRINTF(per_blk != NULL, "Failed to allocate periodic block of size %d^2\n", per_blk_size);
 
-    // O = pkernel({root_J_coord, root_J_coord});
-    pkrnl_eval(
-        root_J_coord->data, root_J_coord->ld, root_J_coord->ncol,
-        root_J_coord->data, root_J_coord->ld, root_J_coord->ncol,
-        pkrnl_param, per_blk, per_blk_size
-    );
-    DTYPE shift[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-    H2P_dense_mat_resize(krnl_mat_blk, per_blk_size, per_blk_size);
-    H2P_dense_mat_resize(root_J_coord_s, xpt_dim, n_point_root);
-    copy_matrix_block(
-        sizeof(DTYPE), xpt_dim, n_point_root, root_J_coord->data, root_J_coord->ld, 
-        root_J_coord_s->data, root_J_coord_s->ld
-    );
-    for (int l = 0; l < n_lattice; l++)
+    // A periodic kernel table already stores pkernel - sum_{lattice} kernel,
+    // use it directly if it is built with the same kernel, cell, and lattices
+    int use_tab = 0;
+    H2P_pkernel_tab_p pkrnl_tab = (H2P_pkernel_tab_p) pkrnl_param;
+    if (pkrnl_eval == H2P_pkernel_tab_eval)
     {
-        // shift = lattice(l, 1 : pt_dim) .* root_box(pt_dim+1 : 2 * pt_dim);
-        // shift = [shift, zeros(1, xpt_dim - pt_dim)];
-        DTYPE *lattice_l = per_lattices + l * pt_dim;
-        for (int j = 0; j < pt_dim; j++) shift[j] = enbox0_width[j] * lattice_l[j];
-        // root_J_coord_s = coord_shift(root_J_coord, shift, 1);
-        H2P_shift_coord(root_J_coord_s, shift,  1.0);
-        // O = O - kernel({root_J_coord, root_J_coord_s});
-        krnl_eval(
-            root_J_coord->data,   root_J_coord->ld,   root_J_coord->ncol,
-            root_J_coord_s->data, root_J_coord_s->ld, root_J_coord->ncol,
-            krnl_param, krnl_mat_blk->data, krnl_mat_blk->ld
-        );
-        #pragma omp simd
-        for (int i = 0; i < per_blk_size * per_blk_size; i++)
-            per_blk[i] -= krnl_mat_blk->data[i];
-        // Reset root_J_coord_s = root_J_coord
-        H2P_shift_coord(root_J_coord_s, shift, -1.0);
+        use_tab = (pkrnl_tab->pt_dim     == pt_dim)    && 
+                  (pkrnl_tab->xpt_dim    == xpt_dim)   && 
+                  (pkrnl_tab->krnl_dim   == krnl_dim)  && 
+                  (pkrnl_tab->n_lattice  == n_lattice) && 
+                  (pkrnl_tab->krnl_eval  == krnl_eval) && 
+                  (pkrnl_tab->krnl_param == krnl_param);
+        for (int j = 0; j < pt_dim; j++)
+        {
+            DTYPE width_diff = DABS(pkrnl_tab->cell_width[j] - enbox0_width[j]);
+            if (width_diff > 1e-10 * enbox0_width[j]) use_tab = 0;
+        }
+        if (use_tab) use_tab = H2P_pkernel_tab_match_xpt(pkrnl_tab, root_J_coord->data, root_J_coord->ld, n_point_root);
     }
 
+    // Each thread handles a row panel of the periodic block for all lattices, 
+    // so the periodic kernel and the n_lattice shifted blocks are evaluated in
+    // parallel without a reduction
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        H2P_dense_mat_p root_J_coord_s = thread_buf[tid]->mat0;
+        H2P_dense_mat_p krnl_mat_blk   = thread_buf[tid]->mat1;
+        DTYPE shift[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+        int s_row, n_row;
+        calc_block_spos_len(n_point_root, n_thread, tid, &s_row, &n_row);
+        const DTYPE *coord0 = root_J_coord->data + s_row;
+        DTYPE *per_blk_t = per_blk + s_row * krnl_dim * per_blk_size;
+        int blk_t_size = n_row * krnl_dim * per_blk_size;
+
+        if (n_row > 0 && use_tab)
+        {
+            H2P_pkernel_tab_eval_corr(
+                pkrnl_tab, coord0, root_J_coord->ld, n_row,
+                root_J_coord->data, root_J_coord->ld, root_J_coord->ncol,
+                per_blk_t, per_blk_size
+            );
+        }
+        if (n_row > 0 && !use_tab)
+        {
+            // O = pkernel({root_J_coord, root_J_coord});
+            pkrnl_eval(
+                coord0, root_J_coord->ld, n_row,
+                root_J_coord->data, root_J_coord->ld, root_J_coord->ncol,
+                pkrnl_param, per_blk_t, per_blk_size
+            );
+            H2P_dense_mat_resize(krnl_mat_blk, n_row * krnl_dim, per_blk_size);
+            H2P_dense_mat_resize(root_J_coord_s, xpt_dim, n_point_root);
+            copy_matrix_block(
+                sizeof(DTYPE), xpt_dim, n_point_root, root_J_coord->data, root_J_coord->ld, 
+                root_J_coord_s->data, root_J_coord_s->ld
+            );
+            for (int l = 0; l < n_lattice; l++)
+            {
+                // shift = lattice(l, 1 : pt_dim) .* root_box(pt_dim+1 : 2 * pt_dim);
+                // shift = [shift, zeros(1, xpt_dim - pt_dim)];
+                DTYPE *lattice_l = per_lattices + l * pt_dim;
+                for (int j = 0; j < pt_dim; j++) shift[j] = enbox0_width[j] * lattice_l[j];
+                // root_J_coord_s = coord_shift(root_J_coord, shift, 1);
+                H2P_shift_coord(root_J_coord_s, shift,  1.0);
+                // O = O - kernel({root_J_coord, root_J_coord_s});
+                krnl_eval(
+                    coord0,               root_J_coord->ld,   n_row,
+                    root_J_coord_s->data, root_J_coord_s->ld, root_J_coord->ncol,
+                    krnl_param, krnl_mat_blk->data, krnl_mat_blk->ld
+                );
+                #pragma omp simd
+                for (int i = 0; i < blk_t_size; i++)
+                    per_blk_t[i] -= krnl_mat_blk->data[i];
+                // Reset root_J_coord_s = root_J_coord
+                H2P_shift_coord(root_J_coord_s, shift, -1.0);
+            }
+        }  // End of "if (n_row > 0)"
+    }  // End of "#pragma omp parallel"
+
     h2pack->per_blk = per_blk;
 }
 
+// Build periodic H2 generator matrices for AOT mode
+// Input parameter:
+//   h2pack : H2Pack structure with H2 generator matrices metadata
+// Output parameter:
+//   h2pack : H2Pack structure with H2 generator matrices
+// Note:
+//   B{node0, node1} is evaluated with node1's points shifted by the 
+//   periodic image shift of the admissible pair, same as in JIT matvec.
+void H2P_build_periodic_B_AOT(H2Pack_p h2pack)
+{
+    int    pt_dim          = h2pack->pt_dim;
+    int    xpt_dim         = h2pack->xpt_dim;
+    int    krnl_dim        = h2pack->krnl_dim;
+    int    n_point         = h2pack->n_point;
+    int    n_thread        = h2pack->n_thread;
+    int    *node_level     = h2pack->node_level;
+    int    *pt_cluster     = h2pack->pt_cluster;
+    int    *r_adm_pairs    = h2pack->r_adm_pairs;
+    size_t *B_ptr          = h2pack->B_ptr;
+    DTYPE  *coord          = h2pack->coord;
+    DTYPE  *per_adm_shifts = h2pack->per_adm_shifts;
+    void   *krnl_param     = h2pack->krnl_param;
+    kernel_eval_fptr krnl_eval   = h2pack->krnl_eval;
+    H2P_int_vec_p    B_blk       = h2pack->B_blk;
+    H2P_dense_mat_p  *J_coord    = h2pack->J_coord;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    size_t B_total_size = h2pack->mat_size[B_SIZE_IDX];
+    h2pack->B_data = (DTYPE*) malloc_aligned(sizeof(DTYPE) * B_total_size, 64);
+    ASSERT_PRINTF(h2pack->B_data != NULL, "Failed to allocate space for storing all %zu B matrices elements\n", B_total_size);
+    DTYPE *B_data = h2pack->B_data;
+    const int n_B_blk = B_blk->length - 1;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        H2P_dense_mat_p coord1_s = thread_buf[tid]->mat1;
+        DTYPE shift[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+        thread_buf[tid]->timer = -get_wtime_sec();
+        // Use first-touch policy for better NUMA memory access performance. The team 
+        // can be smaller than n_thread (e.g., OMP_DYNAMIC), every block must be built
+        int n_thread_team = omp_get_num_threads();
+        for (int i_blk = tid; i_blk < n_B_blk; i_blk += n_thread_team)
+        {
+            int B_blk_s = B_blk->data[i_blk];
+            int B_blk_e = B_blk->data[i_blk + 1];
+            for (int i = B_blk_s; i < B_blk_e; i++)
+            {
+                int node0  = r_adm_pairs[2 * i];
+                int node1  = r_adm_pairs[2 * i + 1];
+                int level0 = node_level[node0];
+                int level1 = node_level[node1];
+                DTYPE *Bi  = B_data + B_ptr[i];
+
+                DTYPE *per_adm_shift_i = per_adm_shifts + i * pt_dim;
+                for (int k = 0; k < pt_dim; k++) shift[k] = per_adm_shift_i[k];
+
+                // (1) Two nodes are of the same level, compress on both sides
+                if (level0 == level1)
+                {
+                    H2P_dense_mat_copy(J_coord[node1], coord1_s);
+                    H2P_shift_coord(coord1_s, shift, 1.0);
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
+                        J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
+                        coord1_s->data,       coord1_s->ld,       coord1_s->ncol,
+                        Bi, coord1_s->ncol * krnl_dim
+                    );
+                }
+
+                // (2) node1 is a leaf node and its level is higher than node0's level, 
+                //     only compress on node0's side
+                if (level0 > level1)
+                {
+                    int pt_s1 = pt_cluster[2 * node1];
+                    int pt_e1 = pt_cluster[2 * node1 + 1];
+                    int node1_npt = pt_e1 - pt_s1 + 1;
+                    H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
+                    copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
+                    H2P_shift_coord(coord1_s, shift, 1.0);
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
+                        J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
+                        coord1_s->data,       coord1_s->ld,       node1_npt,
+                        Bi, node1_npt * krnl_dim
+                    );
+                }
+
+                // (3) node0 is a leaf node and its level is higher than node1's level, 
+                //     only compress on node1's side
+                if (level0 < level1)
+                {
+                    int pt_s0 = pt_cluster[2 * node0];
+                    int pt_e0 = pt_cluster[2 * node0 + 1];
+                    int node0_npt = pt_e0 - pt_s0 + 1;
+                    H2P_dense_mat_copy(J_coord[node1], coord1_s);
+                    H2P_shift_coord(coord1_s, shift, 1.0);
+                    H2P_eval_kernel_matrix_tiled(
+                        krnl_param, krnl_eval, krnl_dim, 
+                        coord + pt_s0,  n_point,      node0_npt,
+                        coord1_s->data, coord1_s->ld, coord1_s->ncol,
+                        Bi, coord1_s->ncol * krnl_dim
+                    );
+                }
+            }  // End of i loop
+        }  // End of i_blk loop
+        thread_buf[tid]->timer += get_wtime_sec();
+    }  // End of "pragma omp parallel"
+
+    if (h2pack->print_timers == 1)
+    {
+        double max_t = 0.0, avg_t = 0.0, min_t = 19241112.0;
+        for (int i = 0; i < n_thread; i++)
+        {
+            double thread_i_timer = thread_buf[i]->timer;
+            avg_t += thread_i_timer;
+            max_t = MAX(max_t, thread_i_timer);
+            min_t = MIN(min_t, thread_i_timer);
+        }
+        avg_t /= (double) n_thread;
+        INFO_PRINTF("Build B: min/avg/max thread wall-time = %.3lf, %.3lf, %.3lf (s)\n", min_t, avg_t, max_t);
+    }
+}
+
+// Build periodic H2 dense blocks for AOT mode
+// Input parameter:
+//   h2pack : H2Pack structure with H2 dense blocks metadata
+// Output parameter:
+//   h2pack : H2Pack structure with H2 dense blocks
+// Note:
+//   D{node0, node1} of an inadmissible pair is evaluated with node1's points
+//   shifted by the periodic image shift of the pair, same as in JIT matvec.
+void H2P_build_periodic_D_AOT(H2Pack_p h2pack)
+{
+    int    pt_dim            = h2pack->pt_dim;
+    int    xpt_dim           = h2pack->xpt_dim;
+    int    krnl_dim          = h2pack->krnl_dim;
+    int    n_thread          = h2pack->n_thread;
+    int    n_point           = h2pack->n_point;
+    int    n_leaf_node       = h2pack->n_leaf_node;
+    int    *leaf_nodes       = h2pack->height_nodes;
+    int    *pt_cluster       = h2pack->pt_cluster;
+    int    *r_inadm_pairs    = h2pack->r_inadm_pairs;
+    size_t *D_ptr            = h2pack->D_ptr;
+    DTYPE  *coord            = h2pack->coord;
+    DTYPE  *per_inadm_shifts = h2pack->per_inadm_shifts;
+    void   *krnl_param       = h2pack->krnl_param;
+    kernel_eval_fptr krnl_eval   = h2pack->krnl_eval;
+    H2P_int_vec_p    D_blk0      = h2pack->D_blk0;
+    H2P_int_vec_p    D_blk1      = h2pack->D_blk1;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    size_t D_total_size = h2pack->mat_size[D_SIZE_IDX];
+    h2pack->D_data = (DTYPE*) malloc_aligned(sizeof(DTYPE) * D_total_size, 64);
+    ASSERT_PRINTF(
+        h2pack->D_data != NULL, 
+        "Failed to allocate space for storing all %zu D matrices elements\n", D_total_size
+    );
+    DTYPE *D_data = h2pack->D_data;
+    const int n_D0_blk = D_blk0->length - 1;
+    const int n_D1_blk = D_blk1->length - 1;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        H2P_dense_mat_p coord1_s = thread_buf[tid]->mat1;
+        DTYPE shift[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+        thread_buf[tid]->timer = -get_wtime_sec();
+
+        // 1. Generate diagonal blocks (leaf node self interaction), no shift
+        // Use first-touch policy for better NUMA memory access performance. The team 
+        // can be smaller than n_thread (e.g., OMP_DYNAMIC), every block must be built
+        int n_thread_team = omp_get_num_threads();
+        for (int i_blk0 = tid; i_blk0 < n_D0_blk; i_blk0 += n_thread_team)
+        {
+            int D_blk0_s = D_blk0->data[i_blk0];
+            int D_blk0_e = D_blk0->data[i_blk0 + 1];
+            for (int i = D_blk0_s; i < D_blk0_e; i++)
+            {
+                int node = leaf_nodes[i];
+                int pt_s = pt_cluster[2 * node];
+                int pt_e = pt_cluster[2 * node + 1];
+                int node_npt = pt_e - pt_s + 1;
+                DTYPE *Di = D_data + D_ptr[i];
+                H2P_eval_kernel_matrix_tiled(
+                    krnl_param, krnl_eval, krnl_dim, 
+                    coord + pt_s, n_point, node_npt,
+                    coord + pt_s, n_point, node_npt,
+                    Di, node_npt * krnl_dim
+                );
+            }
+        }  // End of i_blk0 loop
+
+        // 2. Generate off-diagonal blocks from inadmissible pairs, need shifting
+        for (int i_blk1 = tid; i_blk1 < n_D1_blk; i_blk1 += n_thread_team)
+        {
+            int D_blk1_s = D_blk1->data[i_blk1];
+            int D_blk1_e = D_blk1->data[i_blk1 + 1];
+            for (int i = D_blk1_s; i < D_blk1_e; i++)
+            {
+                int node0 = r_inadm_pairs[2 * i];
+                int node1 = r_inadm_pairs[2 * i + 1];
+                int pt_s0 = pt_cluster[2 * node0];
+                int pt_s1 = pt_cluster[2 * node1];
+                int pt_e0 = pt_cluster[2 * node0 + 1];
+                int pt_e1 = pt_cluster[2 * node1 + 1];
+                int node0_npt = pt_e0 - pt_s0 + 1;
+                int node1_npt = pt_e1 - pt_s1 + 1;
+                DTYPE *Di = D_data + D_ptr[i + n_leaf_node];
+
+                DTYPE *per_inadm_shift_i = per_inadm_shifts + i * pt_dim;
+                for (int k = 0; k < pt_dim; k++) shift[k] = per_inadm_shift_i[k];
+                H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
+                copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
+                H2P_shift_coord(coord1_s, shift, 1.0);
+                H2P_eval_kernel_matrix_tiled(
+                    krnl_param, krnl_eval, krnl_dim, 
+                    coord + pt_s0,  n_point,      node0_npt,
+                    coord1_s->data, coord1_s->ld, node1_npt,
+                    Di, node1_npt * krnl_dim
+                );
+            }
+        }  // End of i_blk1 loop
+
+        thread_buf[tid]->timer += get_wtime_sec();
+    }  // End of "pragma omp parallel"
+
+    if (h2pack->print_timers == 1)
+    {
+        double max_t = 0.0, avg_t = 0.0, min_t = 19241112.0;
+        for (int i = 0; i < n_thread; i++)
+        {
+            double thread_i_timer = thread_buf[i]->timer;
+            avg_t += thread_i_timer;
+            max_t = MAX(max_t, thread_i_timer);
+            min_t = MIN(min_t, thread_i_timer);
+        }
+        avg_t /= (double) n_thread;
+        INFO_PRINTF("Build D: min/avg/max thread wall-time = %.3lf, %.3lf, %.3lf (s)\n", min_t, avg_t, max_t);
+    }
+}
+
 // Build H2 representation with a regular kernel function and
 // a periodic system kernel (Ewald summation) function
 void H2P_build_periodic(
@@ -97,9 +387,9 @@ void H2P_build_periodic(
         return;
     }
 
-    if (BD_JIT != 1)
+    if (pkrnl_eval == H2P_pkernel_tab_eval && pkrnl_param == NULL)
     {
-        ERROR_PRINTF("Only support BD_JIT=1 in this function for the moment.\n");
+        ERROR_PRINTF("H2P_pkernel_tab_init() failed, use the periodic kernel function instead of the table.\n");
         return;
     }
 
@@ -123,12 +413,14 @@ void H2P_build_periodic(
     // 2. Generate H2 generator matrices metadata
     st = get_wtime_sec();
     H2P_generate_B_metadata(h2pack);
+    if (BD_JIT == 0) H2P_build_periodic_B_AOT(h2pack);
     et = get_wtime_sec();
     timers[B_BUILD_TIMER_IDX] = et - st;
     
     // 3. Generate H2 dense blocks metadata
     st = get_wtime_sec();
     H2P_generate_D_metadata(h2pack);
+    if (BD_JIT == 0) H2P_build_periodic_D_AOT(h2pack);
     et = get_wtime_sec();
     timers[D_BUILD_TIMER_IDX] = et - st;
 
@@ -136,7 +428,7 @@ void H2P_build_periodic(
     st = get_wtime_sec();
     H2P_build_periodic_block(h2pack);
     et = get_wtime_sec();
-    timers[B_BUILD_TIMER_IDX] = et - st;
+    timers[B_BUILD_TIMER_IDX] += et - st;
 
     // 5. Set up forward and backward permutation indices
     int n_point    = h2pack->n_point;
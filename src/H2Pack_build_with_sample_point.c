@@ -277,9 +277,42 @@ void H2P_select_cluster_sample(
     H2P_dense_mat_destroy(&anchor_coord_);
 }
 
-int H2P_select_sample_point_r(
+// Pass the sample points of a node to all its children nodes
+// Input parameters:
+//   h2pack    : H2Pack structure with point partitioning info
+//   node      : Target node index
+//   sample_pt : Array of sample points for each node
+// Output parameter:
+//   sample_pt : sample_pt[child] = sample_pt[node] for all children of node
+static void H2P_pass_sample_point_to_children(H2Pack_p h2pack, const int node, H2P_dense_mat_p *sample_pt)
+{
+    int xpt_dim      = h2pack->xpt_dim;
+    int sample_npt   = sample_pt[node]->ncol;
+    int n_child_node = h2pack->n_child[node];
+    int *child_nodes = h2pack->children + node * h2pack->max_child;
+    for (int i_child = 0; i_child < n_child_node; i_child++)
+    {
+        int i_child_node = child_nodes[i_child];
+        H2P_dense_mat_resize(sample_pt[i_child_node], xpt_dim, sample_npt);
+        copy_matrix_block(sizeof(DTYPE), xpt_dim, sample_npt, sample_pt[node]->data, sample_npt, sample_pt[i_child_node]->data, sample_npt);
+    }
+}
+
+// Select the number of sample points per dimension r with a pair of point clusters
+// Input parameters:
+//   h2pack     : H2Pack structure with point partitioning info
+//   krnl_param : Pointer to kernel function parameter array
+//   krnl_eval  : Pointer to kernel matrix evaluation function
+//   tau        : Separation threshold, usually is 0.7
+//   reltol     : Target relative error of the compressed kernel block
+//   pair_node* : Use k points evenly strided over each node of the node pair 
+//                (pair_node0, pair_node1), or two random clusters in well-separated 
+//                cubes if pair_node0 == -1
+// Output parameter:
+//   <return> : Selected r value
+static int H2P_select_sample_point_r_pair(
     H2Pack_p h2pack, const void *krnl_param, kernel_eval_fptr krnl_eval, 
-    const DTYPE tau, const DTYPE reltol
+    const DTYPE tau, const DTYPE reltol, const int pair_node0, const int pair_node1
 )
 {
     ASSERT_PRINTF(h2pack->pt_dim == h2pack->xpt_dim, "Sample point algorithm does not support RPY with different radii yet\n");
@@ -294,6 +327,15 @@ int H2P_select_sample_point_r(
         L = (L > root_enbox[pt_dim + i]) ? root_enbox[pt_dim + i] : L;
     L /= 6.0;  // Don't know why we need this, just copy from the MATLAB code
 
+    if (pair_node0 >= 0)
+    {
+        int *pt_cluster = h2pack->pt_cluster;
+        int npt0 = pt_cluster[2 * pair_node0 + 1] - pt_cluster[2 * pair_node0] + 1;
+        int npt1 = pt_cluster[2 * pair_node1 + 1] - pt_cluster[2 * pair_node1] + 1;
+        if (npt0 < k) k = npt0;
+        if (npt1 < k) k = npt1;
+    }
+
     DTYPE *c1_enbox_size = (DTYPE *) malloc(sizeof(DTYPE) * pt_dim * 2);
     int *r_list = (int *) malloc(sizeof(int) * pt_dim);
     H2P_dense_mat_p coord0, coord1, coord1s, A0, A1, U, UA, QR_buff;
@@ -322,6 +364,26 @@ int H2P_select_sample_point_r(
         coord0->data[i] = L * (DTYPE) drand48();
         coord1->data[i] = L * (DTYPE) drand48() + coord1_shift;
     }
+    if (pair_node0 >= 0)
+    {
+        // Points of a node are sorted by its subtree, so take k points evenly 
+        // strided over each node instead of the first k points (a single child)
+        int n_point = h2pack->n_point;
+        int *pt_cluster = h2pack->pt_cluster;
+        int pt_s0 = pt_cluster[2 * pair_node0];
+        int pt_s1 = pt_cluster[2 * pair_node1];
+        int npt0  = pt_cluster[2 * pair_node0 + 1] - pt_s0 + 1;
+        int npt1  = pt_cluster[2 * pair_node1 + 1] - pt_s1 + 1;
+        for (int d = 0; d < pt_dim; d++)
+        {
+            const DTYPE *coord_d = h2pack->coord + d * n_point;
+            for (int i = 0; i < k; i++)
+            {
+                coord0->data[d * k + i] = coord_d[pt_s0 + (int) ((size_t) i * npt0 / k)];
+                coord1->data[d * k + i] = coord_d[pt_s1 + (int) ((size_t) i * npt1 / k)];
+            }
+        }
+    }
 
     // Find an r value by checking approximation error to A
     // The r initial guess formula is provided by Difeng
@@ -404,7 +466,11 @@ int H2P_select_sample_point_r(
         }
         err_fnorm = DSQRT(err_fnorm);
         relerr = err_fnorm / A0_fnorm;
-        if ( (relerr < reltol * 0.1) || ((k - n_sample) < (k / 10)) ) flag = 1;
+        // Two random clusters stop when almost all points are sampled. For a real node 
+        // pair, stopping early often leaves relerr 1000 times larger than reltol and the 
+        // nodes need all their points as samples, so only stop when all points are sampled
+        int max_sample = (pair_node0 >= 0) ? k : (k - k / 10 + 1);
+        if ( (relerr < reltol * 0.1) || (n_sample >= max_sample) || (r >= k) ) flag = 1;
         else r++;
     }  // End "while (flag == 0)"
 
@@ -423,6 +489,76 @@ int H2P_select_sample_point_r(
     return r;
 }
 
+// Select the number of sample points per dimension r
+// Input parameters:
+//   h2pack     : H2Pack structure with point partitioning info
+//   krnl_param : Pointer to kernel function parameter array
+//   krnl_eval  : Pointer to kernel matrix evaluation function
+//   tau        : Separation threshold, usually is 0.7
+//   reltol     : Target relative error of the compressed kernel blocks
+// Output parameter:
+//   <return> : Selected r value
+int H2P_select_sample_point_r(
+    H2Pack_p h2pack, const void *krnl_param, kernel_eval_fptr krnl_eval, 
+    const DTYPE tau, const DTYPE reltol
+)
+{
+    int pt_dim       = h2pack->pt_dim;
+    int max_level    = h2pack->max_level;
+    int n_r_adm_pair = (h2pack->is_HSS) ? h2pack->HSS_n_r_adm_pair : h2pack->n_r_adm_pair;
+    int *r_adm_pairs = (h2pack->is_HSS) ? h2pack->HSS_r_adm_pairs  : h2pack->r_adm_pairs;
+    int *node_level  = h2pack->node_level;
+    DTYPE *enbox     = h2pack->enbox;
+    if (pt_dim <= MAX_2N_TREE_DIM || n_r_adm_pair == 0)
+        return H2P_select_sample_point_r_pair(h2pack, krnl_param, krnl_eval, tau, reltol, -1, -1);
+
+    // The binary kd-tree boxes used for pt_dim > MAX_2N_TREE_DIM are elongated and 
+    // are only separated in one dimension, so admissible pairs are much closer relative 
+    // to their sizes than the two well-separated cubes used for pt_dim <= MAX_2N_TREE_DIM, 
+    // and an r selected with the cubes gives matvec errors 50 to 1000 times larger than 
+    // reltol. Use the real points of the closest admissible pair (smallest box gap / box 
+    // diameter) on each level instead and take the largest r of all levels.
+    int   *level_pair = (int *)   malloc(sizeof(int)   * (max_level + 1));
+    DTYPE *level_sep  = (DTYPE *) malloc(sizeof(DTYPE) * (max_level + 1));
+    ASSERT_PRINTF(level_pair != NULL && level_sep != NULL, "Failed to allocate work arrays for sample point selection\n");
+    for (int i = 0; i <= max_level; i++) level_pair[i] = -1;
+    for (int i = 0; i < n_r_adm_pair; i++)
+    {
+        int node0 = r_adm_pairs[2 * i];
+        int node1 = r_adm_pairs[2 * i + 1];
+        DTYPE *enbox0 = enbox + node0 * pt_dim * 2;
+        DTYPE *enbox1 = enbox + node1 * pt_dim * 2;
+        DTYPE gap2 = 0.0, diam0 = 0.0, diam1 = 0.0;
+        for (int j = 0; j < pt_dim; j++)
+        {
+            DTYPE r0 = enbox0[pt_dim + j], r1 = enbox1[pt_dim + j];
+            DTYPE gap_j = DABS((enbox0[j] + 0.5 * r0) - (enbox1[j] + 0.5 * r1)) - 0.5 * (r0 + r1);
+            if (gap_j > 0) gap2 += gap_j * gap_j;
+            diam0 += r0 * r0;
+            diam1 += r1 * r1;
+        }
+        DTYPE sep = DSQRT(gap2 / MAX(diam0, diam1));
+        int level = MAX(node_level[node0], node_level[node1]);
+        if (level_pair[level] == -1 || sep < level_sep[level])
+        {
+            level_pair[level] = i;
+            level_sep[level]  = sep;
+        }
+    }
+    int r = 0;
+    for (int level = 0; level <= max_level; level++)
+    {
+        if (level_pair[level] == -1) continue;
+        int node0 = r_adm_pairs[2 * level_pair[level]];
+        int node1 = r_adm_pairs[2 * level_pair[level] + 1];
+        int r_level = H2P_select_sample_point_r_pair(h2pack, krnl_param, krnl_eval, tau, reltol, node0, node1);
+        r = MAX(r, r_level);
+    }
+    free(level_pair);
+    free(level_sep);
+    return r;
+}
+
 // Select sample points for constructing H2 projection and skeleton matrices 
 void H2P_select_sample_point(
     H2Pack_p h2pack, const void *krnl_param, kernel_eval_fptr krnl_eval, 
@@ -568,7 +704,14 @@ void H2P_select_sample_point(
             for (int j = 0; j < level_i_n_node; j++)
             {
                 int node = level_i_nodes[j];
-                if (adm_list[node]->length == 0) continue;
+                // A node without admissible pairs still needs to pass the sample 
+                // points of its ancestors' far field to its children. This happens 
+                // quite often in binary trees used for high dimensional points.
+                if (adm_list[node]->length == 0)
+                {
+                    H2P_pass_sample_point_to_children(h2pack, node, sample_pt);
+                    continue;
+                }
 
                 // Stage 1 in Difeng's code
                 // (1) Calculate enclosing box of all far-field refined points
@@ -791,15 +934,7 @@ void H2P_select_sample_point(
                 }
 
                 // (3) Pass refined sample points to children
-                int sample_npt   = sample_idx->length;
-                int n_child_node = n_child[node];
-                int *child_nodes = children + node * max_child;
-                for (int i_child = 0; i_child < n_child_node; i_child++)
-                {
-                    int i_child_node = child_nodes[i_child];
-                    H2P_dense_mat_resize(sample_pt[i_child_node], xpt_dim, sample_pt[node]->ncol);
-                    copy_matrix_block(sizeof(DTYPE), xpt_dim, sample_npt, sample_pt[node]->data, sample_npt, sample_pt[i_child_node]->data, sample_npt);
-                }
+                H2P_pass_sample_point_to_children(h2pack, node, sample_pt);
             }  // End of j loop
             H2P_dense_mat_destroy(&workbuf_d);
             H2P_dense_mat_destroy(&yFi);
@@ -1039,10 +1174,6 @@ void H2P_build_H2_UJ_sample(H2Pack_p h2pack, H2P_dense_mat_p *sample_pt)
     BLAS_SET_NUM_THREADS(n_thread);
 }
 
-// These two functions are in H2Pack_build.c but not in H2Pack_utils.h
-void H2P_build_B_AOT(H2Pack_p h2pack);
-void H2P_build_D_AOT(H2Pack_p h2pack);
-
 // Build H2 representation with a kernel function and sample points
 void H2P_build_with_sample_point(
     H2Pack_p h2pack, H2P_dense_mat_p *sample_pt, const int BD_JIT, void *krnl_param, 
@@ -33,6 +33,8 @@
 #define CBLAS_GEMM      cblas_dgemm     // CBLAS matrix-matrix multiplication
 #define CBLAS_GER       cblas_dger      // CBLAS matrix rank-1 update
 #define CBLAS_TRSM      cblas_dtrsm     // CBLAS triangle solve
+#define CBLAS_TRMM      cblas_dtrmm     // CBLAS triangle matrix-matrix multiplication
+#define CBLAS_SYRK      cblas_dsyrk     // CBLAS symmetric rank-k update
 #define LAPACK_GETRF    LAPACKE_dgetrf  // LAPACK LU factorization
 #define LAPACK_GETRS    LAPACKE_dgetrs  // LAPACK linear system solve using LU factorization
 #define LAPACK_GETRI    LAPACKE_dgetri  // LAPACK LU inverse matrix
@@ -72,6 +74,8 @@
 #define CBLAS_GEMM      cblas_sgemm
 #define CBLAS_GER       cblas_sger
 #define CBLAS_TRSM      cblas_strsm
+#define CBLAS_TRMM      cblas_strmm
+#define CBLAS_SYRK      cblas_ssyrk
 #define LAPACK_GETRF    LAPACKE_sgetrf
 #define LAPACK_GETRS    LAPACKE_sgetrs
 #define LAPACK_GETRI    LAPACKE_sgetri
@@ -87,6 +91,12 @@
 #define ASTER_DTYPE_FLOAT
 #endif
 
+// Double and single precision H2Pack are built into the same library. 
+// Global symbols of the single precision build are renamed to H2P_s_*.
+#if DTYPE_SIZE == FLOAT_SIZE
+#include "H2Pack_float_symbols.h"
+#endif
+
 #define QR_RANK         0               // Partial QR stop criteria: maximum rank
 #define QR_REL_NRM      1               // Partial QR stop criteria: maximum relative column 2-norm
 #define QR_ABS_NRM      2               // Partial QR stop criteria: maximum absolute column 2-norm
@@ -96,6 +106,10 @@
 #define ALPHA_HSS       -0.000001       // Admissible coefficient for HSS, == 0 here
 
 #define BD_NTASK_THREAD 10              // Average number of tasks each thread has in B & D build
+#define KRNL_EVAL_TILE  512             // Maximum number of coord1 points in a kernel evaluation tile in B & D build
+
+#define MAX_2N_TREE_DIM 3               // Maximum point dimension using 2^pt_dim-way partitioning, higher dimensions use binary partitioning
+#define H2P_MAX_CHILD(pt_dim)   (((pt_dim) <= MAX_2N_TREE_DIM) ? (1 << (pt_dim)) : 2)   // Maximum number of children per node
 
 #include "linalg_lib_wrapper.h"
 #include "ASTER/include/aster.h"
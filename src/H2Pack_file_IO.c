@@ -3,6 +3,10 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <math.h>
 #include <omp.h>
 #include <inttypes.h>
@@ -12,6 +16,7 @@
 #include "H2Pack_utils.h"
 #include "H2Pack_typedef.h"
 #include "H2Pack_gen_proxy_point.h"
+#include "H2Pack_HSS_ULV.h"
 #include "H2Pack_file_IO.h"
 
 void H2P_store_to_file(
@@ -217,6 +222,267 @@ void H2P_store_to_file(
     }
 }
 
+// Set up the matvec metadata of a H2Pack structure loaded from files. The tree,
+// U, J, coordinates, B_nrow, B_ncol, D_nrow, D_ncol, and the reduced admissible /
+// inadmissible pairs should have been loaded. B_ptr[i + 1] and D_ptr[i + 1] should 
+// be the size of the i-th B / D matrix. Same as H2P_build(), the transpose of a B / D
+// matrix is not used for the symmetric pair in a periodic H2 matrix (h2pack->is_RPY_Ewald == 1).
+// Input parameters:
+//   h2pack          : H2Pack structure with loaded H2 representation
+//   B_total_size    : Total size of B matrices
+//   D0_total_size   : Total size of D matrices of leaf nodes
+//   D1_total_size   : Total size of D matrices of reduced inadmissible pairs
+//   krnl_bimv_flops : Number of flops required for each bi-matvec operation
+// Output parameter:
+//   h2pack : H2Pack structure ready for matvec
+static void H2P_read_setup_matvec(
+    H2Pack_p h2pack, const size_t B_total_size, const size_t D0_total_size, 
+    const size_t D1_total_size, const int krnl_bimv_flops
+)
+{
+    int pt_dim      = h2pack->pt_dim;
+    int krnl_dim    = h2pack->krnl_dim;
+    int n_node      = h2pack->n_node;
+    int n_point     = h2pack->n_point;
+    int n_leaf_node = h2pack->n_leaf_node;
+    int *leaf_nodes = h2pack->height_nodes;
+    int is_RPY_Ewald = h2pack->is_RPY_Ewald;
+    int input_n_r_inadm_pair, input_n_r_adm_pair;
+    int *input_r_inadm_pairs, *input_r_adm_pairs;
+    if (h2pack->is_HSS)
+    {
+        input_n_r_inadm_pair = h2pack->HSS_n_r_inadm_pair;
+        input_n_r_adm_pair   = h2pack->HSS_n_r_adm_pair;
+        input_r_inadm_pairs  = h2pack->HSS_r_inadm_pairs;
+        input_r_adm_pairs    = h2pack->HSS_r_adm_pairs;
+    } else {
+        input_n_r_inadm_pair = h2pack->n_r_inadm_pair;
+        input_n_r_adm_pair   = h2pack->n_r_adm_pair;
+        input_r_inadm_pairs  = h2pack->r_inadm_pairs;
+        input_r_adm_pairs    = h2pack->r_adm_pairs;
+    }
+    int    *B_nrow = h2pack->B_nrow;
+    int    *B_ncol = h2pack->B_ncol;
+    int    *D_nrow = h2pack->D_nrow;
+    int    *D_ncol = h2pack->D_ncol;
+    size_t *B_ptr  = h2pack->B_ptr;
+    size_t *D_ptr  = h2pack->D_ptr;
+    size_t *mat_size = h2pack->mat_size;
+    size_t D_total_size = D0_total_size + D1_total_size;
+    H2P_dense_mat_p *U = h2pack->U;
+    H2P_int_vec_p   *J = h2pack->J;
+
+    // 1. Post-processing of U matrices
+    for (int i = 0; i < h2pack->n_UJ; i++)
+    {
+        if (U[i] == NULL)
+        {
+            H2P_dense_mat_init(&U[i], 1, 1);
+            U[i]->nrow = 0;
+            U[i]->ncol = 0;
+            U[i]->ld   = 0;
+        } else {
+            mat_size[U_SIZE_IDX]      += U[i]->nrow * U[i]->ncol;
+            mat_size[MV_FWD_SIZE_IDX] += U[i]->nrow * U[i]->ncol;
+            mat_size[MV_FWD_SIZE_IDX] += U[i]->nrow + U[i]->ncol;
+            mat_size[MV_BWD_SIZE_IDX] += U[i]->nrow * U[i]->ncol;
+            mat_size[MV_BWD_SIZE_IDX] += U[i]->nrow + U[i]->ncol;
+        }
+    }
+
+    // 2. Post-processing of B matrices
+    int *B_pair_i = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
+    int *B_pair_j = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
+    int *B_pair_v = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
+    ASSERT_PRINTF(
+        B_pair_i != NULL && B_pair_j != NULL && B_pair_v != NULL,
+        "Failed to allocate working buffer for B matrices indexing\n"
+    );
+    double *JIT_flops = h2pack->JIT_flops;
+    int *node_level = h2pack->node_level;
+    int *pt_cluster = h2pack->pt_cluster;
+    h2pack->node_n_r_adm = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(
+        h2pack->node_n_r_adm != NULL, 
+        "Failed to allocate array of size %d for counting node admissible pairs\n", n_node
+    );
+    int *node_n_r_adm = h2pack->node_n_r_adm;
+    memset(node_n_r_adm, 0, sizeof(int) * n_node);
+    int B_pair_cnt = 0;
+    for (int i = 0; i < input_n_r_adm_pair; i++)
+    {
+        int node0 = input_r_adm_pairs[2 * i];
+        int node1 = input_r_adm_pairs[2 * i + 1];
+        B_pair_i[B_pair_cnt] = node0;
+        B_pair_j[B_pair_cnt] = node1;
+        B_pair_v[B_pair_cnt] = i + 1;
+        B_pair_cnt++;
+        if (is_RPY_Ewald == 0)
+        {
+            B_pair_i[B_pair_cnt] = node1;
+            B_pair_j[B_pair_cnt] = node0;
+            B_pair_v[B_pair_cnt] = -(i + 1);
+            B_pair_cnt++;
+        }
+        node_n_r_adm[node0]++;
+        if (is_RPY_Ewald == 0) node_n_r_adm[node1]++;
+        mat_size[MV_MID_SIZE_IDX] +=  B_nrow[i] * B_ncol[i];
+        mat_size[MV_MID_SIZE_IDX] += (B_nrow[i] + B_ncol[i]);
+        if (is_RPY_Ewald == 0) mat_size[MV_MID_SIZE_IDX] += (B_nrow[i] + B_ncol[i]);
+        if (h2pack->BD_JIT)
+        {
+            int level0 = node_level[node0];
+            int level1 = node_level[node1];
+            int node0_npt = 0, node1_npt = 0;
+            if (level0 == level1)
+            {
+                node0_npt = J[node0]->length;
+                node1_npt = J[node1]->length;
+            }
+            if (level0 > level1)
+            {
+                int pt_s1 = pt_cluster[2 * node1];
+                int pt_e1 = pt_cluster[2 * node1 + 1];
+                node0_npt = J[node0]->length;
+                node1_npt = pt_e1 - pt_s1 + 1;
+            }
+            if (level0 < level1)
+            {
+                int pt_s0 = pt_cluster[2 * node0];
+                int pt_e0 = pt_cluster[2 * node0 + 1];
+                node0_npt = pt_e0 - pt_s0 + 1;
+                node1_npt = J[node1]->length;
+            }
+            JIT_flops[JIT_B_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node0_npt * node1_npt);
+        }
+    }
+    
+    int BD_ntask_thread = (h2pack->BD_JIT == 1) ? BD_NTASK_THREAD : 1;
+    int n_B_blk = h2pack->n_thread * BD_ntask_thread;
+    H2P_partition_workload(input_n_r_adm_pair, B_ptr + 1, B_total_size, n_B_blk, h2pack->B_blk);
+    for (int i = 1; i <= input_n_r_adm_pair; i++) B_ptr[i] += B_ptr[i - 1];
+    mat_size[B_SIZE_IDX] = B_total_size;
+
+    h2pack->B_p2i_rowptr = (int*) malloc(sizeof(int) * (n_node + 1));
+    h2pack->B_p2i_colidx = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
+    h2pack->B_p2i_val    = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
+    ASSERT_PRINTF(h2pack->B_p2i_rowptr != NULL, "Failed to allocate arrays for B matrices indexing\n");
+    ASSERT_PRINTF(h2pack->B_p2i_colidx != NULL, "Failed to allocate arrays for B matrices indexing\n");
+    ASSERT_PRINTF(h2pack->B_p2i_val    != NULL, "Failed to allocate arrays for B matrices indexing\n");
+    H2P_int_COO_to_CSR(
+        n_node, B_pair_cnt, B_pair_i, B_pair_j, B_pair_v, 
+        h2pack->B_p2i_rowptr, h2pack->B_p2i_colidx, h2pack->B_p2i_val
+    );
+    free(B_pair_i);
+    free(B_pair_j);
+    free(B_pair_v);
+
+    // 3. Post-processing of D matrices
+    int D_pair_cnt = 0;
+    int n_Dij_pair = n_leaf_node + 2 * input_n_r_inadm_pair;
+    int *D_pair_i  = (int*) malloc(sizeof(int) * n_Dij_pair);
+    int *D_pair_j  = (int*) malloc(sizeof(int) * n_Dij_pair);
+    int *D_pair_v  = (int*) malloc(sizeof(int) * n_Dij_pair);
+    ASSERT_PRINTF(
+        D_pair_i != NULL && D_pair_j != NULL && D_pair_v != NULL,
+        "Failed to allocate working buffer for D matrices indexing\n"
+    );
+
+    for (int i = 0; i < n_leaf_node; i++)
+    {
+        int node = leaf_nodes[i];
+        int pt_s = pt_cluster[2 * node];
+        int pt_e = pt_cluster[2 * node + 1];
+        int node_npt = pt_e - pt_s + 1;
+        D_pair_i[D_pair_cnt] = node;
+        D_pair_j[D_pair_cnt] = node;
+        D_pair_v[D_pair_cnt] = i + 1;
+        D_pair_cnt++;
+        mat_size[MV_DEN_SIZE_IDX] += D_nrow[i] * D_ncol[i];
+        mat_size[MV_DEN_SIZE_IDX] += D_nrow[i] + D_ncol[i];
+        if (h2pack->BD_JIT) JIT_flops[JIT_D_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node_npt * node_npt);
+    }
+    for (int i = 0; i < input_n_r_inadm_pair; i++)
+    {
+        int ii = i + n_leaf_node;
+        int node0 = input_r_inadm_pairs[2 * i];
+        int node1 = input_r_inadm_pairs[2 * i + 1];
+        int pt_s0 = pt_cluster[2 * node0];
+        int pt_s1 = pt_cluster[2 * node1];
+        int pt_e0 = pt_cluster[2 * node0 + 1];
+        int pt_e1 = pt_cluster[2 * node1 + 1];
+        int node0_npt = pt_e0 - pt_s0 + 1;
+        int node1_npt = pt_e1 - pt_s1 + 1;
+        D_pair_i[D_pair_cnt] = node0;
+        D_pair_j[D_pair_cnt] = node1;
+        D_pair_v[D_pair_cnt] = ii + 1;
+        D_pair_cnt++;
+        if (is_RPY_Ewald == 0)
+        {
+            D_pair_i[D_pair_cnt] = node1;
+            D_pair_j[D_pair_cnt] = node0;
+            D_pair_v[D_pair_cnt] = -(ii + 1);
+            D_pair_cnt++;
+        }
+        mat_size[MV_DEN_SIZE_IDX] +=  D_nrow[ii] * D_ncol[ii];
+        mat_size[MV_DEN_SIZE_IDX] += (D_nrow[ii] + D_ncol[ii]);
+        if (is_RPY_Ewald == 0) mat_size[MV_DEN_SIZE_IDX] += (D_nrow[ii] + D_ncol[ii]);
+        if (h2pack->BD_JIT) JIT_flops[JIT_D_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node0_npt * node1_npt);
+    }
+
+    int D_n_blk = h2pack->n_thread * BD_ntask_thread;
+    H2P_partition_workload(n_leaf_node,          D_ptr + 1,               D0_total_size, D_n_blk, h2pack->D_blk0);
+    H2P_partition_workload(input_n_r_inadm_pair, D_ptr + n_leaf_node + 1, D1_total_size, D_n_blk, h2pack->D_blk1);
+    for (int i = 1; i <= n_leaf_node + input_n_r_inadm_pair; i++) D_ptr[i] += D_ptr[i - 1];
+    mat_size[D_SIZE_IDX] = D_total_size;
+
+    h2pack->D_p2i_rowptr = (int*) malloc(sizeof(int) * (n_node + 1));
+    h2pack->D_p2i_colidx = (int*) malloc(sizeof(int) * n_Dij_pair);
+    h2pack->D_p2i_val    = (int*) malloc(sizeof(int) * n_Dij_pair);
+    ASSERT_PRINTF(h2pack->D_p2i_rowptr != NULL, "Failed to allocate arrays for D matrices indexing\n");
+    ASSERT_PRINTF(h2pack->D_p2i_colidx != NULL, "Failed to allocate arrays for D matrices indexing\n");
+    ASSERT_PRINTF(h2pack->D_p2i_val    != NULL, "Failed to allocate arrays for D matrices indexing\n");
+    H2P_int_COO_to_CSR(
+        n_node, D_pair_cnt, D_pair_i, D_pair_j, D_pair_v, 
+        h2pack->D_p2i_rowptr, h2pack->D_p2i_colidx, h2pack->D_p2i_val
+    );
+    free(D_pair_i);
+    free(D_pair_j);
+    free(D_pair_v);
+
+    // 4. Set up permutation arrays
+    h2pack->xT    = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size);
+    h2pack->yT    = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size);
+    h2pack->pmt_x = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size * h2pack->mm_max_n_vec);
+    h2pack->pmt_y = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size * h2pack->mm_max_n_vec);
+    ASSERT_PRINTF(
+        h2pack->xT != NULL && h2pack->yT != NULL && h2pack->pmt_x != NULL && h2pack->pmt_y != NULL,
+        "Failed to allocate working arrays of size %d for matvec & matmul\n", 2 * h2pack->krnl_mat_size * (h2pack->mm_max_n_vec+1)
+    );
+    int *coord_idx = h2pack->coord_idx;
+    int *fwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+    int *bwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+    for (int i = 0; i < n_point; i++)
+    {
+        for (int j = 0; j < krnl_dim; j++)
+        {
+            fwd_pmt_idx[i * krnl_dim + j] = coord_idx[i] * krnl_dim + j;
+            bwd_pmt_idx[coord_idx[i] * krnl_dim + j] = i * krnl_dim + j;
+        }
+    }
+    h2pack->fwd_pmt_idx = fwd_pmt_idx;
+    h2pack->bwd_pmt_idx = bwd_pmt_idx;
+
+    // 5. Misc
+    if (h2pack->enbox == NULL) H2P_calc_enclosing_box(pt_dim, n_point, h2pack->coord, NULL, &h2pack->enbox);
+    H2P_calc_node_inadm_lists(h2pack);
+    h2pack->tb = (H2P_thread_buf_p*) malloc(sizeof(H2P_thread_buf_p) * h2pack->n_thread);
+    ASSERT_PRINTF(h2pack->tb != NULL, "Failed to allocate %d thread buffers\n", h2pack->n_thread);
+    for (int i = 0; i < h2pack->n_thread; i++)
+        H2P_thread_buf_init(&h2pack->tb[i], (h2pack->is_HSS == 1) ? 0 : h2pack->krnl_mat_size);
+
+}
+
 void H2P_read_from_file(
     H2Pack_p *h2pack_, const char *meta_json_fname, const char *aux_json_fname, 
     const char *binary_fname, const int BD_JIT, void *krnl_param, 
@@ -405,7 +671,6 @@ void H2P_read_from_file(
         B_ptr[i + 1] = Bi_size;
         B_total_size += Bi_size;
     }
-    size_t *mat_size = h2pack->mat_size;
 
     // 5. Metadata: A.18 D_matrices
     h2pack->n_D = n_leaf_node + input_n_r_inadm_pair;
@@ -445,7 +710,7 @@ void H2P_read_from_file(
     // 6. Other necessary information for H2Pack
     int has_skel;
     fscanf(meta_txt_file, "%d",  &h2pack->max_leaf_points); // C.6 max_leaf_points
-    fscanf(meta_txt_file, "%lf", &h2pack->QR_stop_tol);     // C.7 QR_stop_tol
+    fscanf(meta_txt_file, DTYPE_FMTSTR, &h2pack->QR_stop_tol);     // C.7 QR_stop_tol
     fscanf(meta_txt_file, "%d",  &has_skel);                // C.8 has_skeleton_points
     DTYPE *coord0     = (DTYPE*) malloc(sizeof(DTYPE) * n_point * pt_dim);
     h2pack->coord     = (DTYPE*) malloc(sizeof(DTYPE) * n_point * pt_dim);
@@ -545,211 +810,1864 @@ void H2P_read_from_file(
         }
     }
 
-    // 9. Post-processing of U matrices
-    for (int i = 0; i < h2pack->n_UJ; i++)
+    // 9. Set up matvec metadata
+    H2P_read_setup_matvec(h2pack, B_total_size, D0_total_size, D1_total_size, krnl_bimv_flops);
+
+    // Finally done...
+    fclose(meta_txt_file);
+    fclose(binary_file);
+    *h2pack_ = h2pack;
+}
+
+// ULV factorization file header, all integers are stored as int32_t
+#define H2P_ULV_FILE_MAGIC      "H2PULV\0\0"
+#define H2P_ULV_FILE_VERSION    1
+#define H2P_ULV_FILE_NHEADER    10
+
+// Compute a fingerprint of the partitioning tree and HSS bases sizes, used for
+// checking if a stored ULV factorization matches a H2Pack structure
+// Input parameter:
+//   h2pack : H2Pack structure with constructed HSS representation
+// Output parameter:
+//   <return> : 64-bit FNV-1a hash of tree structure and U matrix sizes
+static uint64_t H2P_HSS_ULV_tree_hash(H2Pack_p h2pack)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    #define HASH_INT(v) do { hash ^= (uint64_t) (uint32_t) (v); hash *= 1099511628211ULL; } while (0)
+    for (int i = 0; i < h2pack->n_node; i++)
     {
-        if (U[i] == NULL)
-        {
-            H2P_dense_mat_init(&U[i], 1, 1);
-            U[i]->nrow = 0;
-            U[i]->ncol = 0;
-            U[i]->ld   = 0;
-        } else {
-            mat_size[U_SIZE_IDX]      += U[i]->nrow * U[i]->ncol;
-            mat_size[MV_FWD_SIZE_IDX] += U[i]->nrow * U[i]->ncol;
-            mat_size[MV_FWD_SIZE_IDX] += U[i]->nrow + U[i]->ncol;
-            mat_size[MV_BWD_SIZE_IDX] += U[i]->nrow * U[i]->ncol;
-            mat_size[MV_BWD_SIZE_IDX] += U[i]->nrow + U[i]->ncol;
-        }
+        HASH_INT(h2pack->node_level[i]);
+        HASH_INT(h2pack->mat_cluster[2 * i]);
+        HASH_INT(h2pack->mat_cluster[2 * i + 1]);
+        HASH_INT(h2pack->n_child[i]);
+        int *node_i_childs = h2pack->children + i * h2pack->max_child;
+        for (int j = 0; j < h2pack->n_child[i]; j++) HASH_INT(node_i_childs[j]);
+        H2P_dense_mat_p Ui = h2pack->U[i];
+        HASH_INT(Ui == NULL ? 0 : Ui->nrow);
+        HASH_INT(Ui == NULL ? 0 : Ui->ncol);
     }
+    #undef HASH_INT
+    return hash;
+}
 
-    // 10. Post-processing of B matrices
-    int *B_pair_i = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
-    int *B_pair_j = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
-    int *B_pair_v = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
-    ASSERT_PRINTF(
-        B_pair_i != NULL && B_pair_j != NULL && B_pair_v != NULL,
-        "Failed to allocate working buffer for B matrices indexing\n"
-    );
-    double *JIT_flops = h2pack->JIT_flops;
-    int *node_level = h2pack->node_level;
-    int *pt_cluster = h2pack->pt_cluster;
-    h2pack->node_n_r_adm = (int*) malloc(sizeof(int) * n_node);
-    ASSERT_PRINTF(
-        h2pack->node_n_r_adm != NULL, 
-        "Failed to allocate array of size %d for counting node admissible pairs\n", n_node
+void H2P_HSS_ULV_store_to_file(H2Pack_p h2pack, const char *binary_fname)
+{
+    if (h2pack->ULV_idx == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_HSS_ULV_LU_factorize() or H2P_HSS_ULV_Cholesky_factorize() first!\n");
+        return;
+    }
+
+    FILE *binary_file = fopen(binary_fname, "wb");
+    if (binary_file == NULL)
+    {
+        ERROR_PRINTF("Cannot open binary data file %s\n", binary_fname);
+        return;
+    }
+
+    int n_node = h2pack->n_node;
+    int is_LU  = (h2pack->ULV_p != NULL);
+    int fp32   = (h2pack->ULV_Q_fp32 != NULL);
+    size_t val_size = fp32 ? sizeof(float) : sizeof(DTYPE);
+
+    // 1. Header: magic, sizes, tree fingerprint, and log-determinant
+    int32_t header[H2P_ULV_FILE_NHEADER];
+    header[0] = H2P_ULV_FILE_VERSION;
+    header[1] = (int32_t) sizeof(DTYPE);
+    header[2] = (int32_t) val_size;
+    header[3] = is_LU;
+    header[4] = h2pack->is_HSS_SPD;
+    header[5] = n_node;
+    header[6] = h2pack->krnl_mat_size;
+    header[7] = h2pack->max_level;
+    header[8] = h2pack->root_idx;
+    header[9] = h2pack->krnl_dim;
+    uint64_t tree_hash = H2P_HSS_ULV_tree_hash(h2pack);
+    double HSS_logdet = (double) h2pack->HSS_logdet;
+    size_t n_write = 0, n_expect = 0;
+    n_write += fwrite(H2P_ULV_FILE_MAGIC, 8, 1, binary_file);
+    n_write += fwrite(header, sizeof(int32_t), H2P_ULV_FILE_NHEADER, binary_file);
+    n_write += fwrite(&tree_hash,  sizeof(uint64_t), 1, binary_file);
+    n_write += fwrite(&HSS_logdet, sizeof(double),   1, binary_file);
+    n_expect += 1 + H2P_ULV_FILE_NHEADER + 1 + 1;
+
+    // 2. ULV_Ls
+    n_write  += fwrite(h2pack->ULV_Ls, sizeof(int), n_node, binary_file);
+    n_expect += n_node;
+
+    // 3. ULV_idx, ULV_p, ULV_Q, ULV_L of each node
+    for (int node = 0; node < n_node; node++)
+    {
+        H2P_int_vec_p   idx = h2pack->ULV_idx[node];
+        H2P_dense_mat_p Q   = h2pack->ULV_Q[node];
+        H2P_dense_mat_p L   = h2pack->ULV_L[node];
+        size_t Q_size = (size_t) Q->nrow * (size_t) Q->ncol;
+        size_t L_size = (size_t) L->nrow * (size_t) L->ld;
+        int32_t node_sizes[5] = {idx->length, Q->nrow, Q->ncol, L->nrow, L->ncol};
+        n_write  += fwrite(node_sizes, sizeof(int32_t), 5, binary_file);
+        n_write  += fwrite(idx->data,  sizeof(int), idx->length, binary_file);
+        n_expect += 5 + idx->length;
+        if (is_LU)
+        {
+            // ULV_p[node] stores the row permutation and the LAPACK pivots
+            H2P_int_vec_p p = h2pack->ULV_p[node];
+            int32_t p_length = p->length;
+            n_write  += fwrite(&p_length, sizeof(int32_t), 1, binary_file);
+            n_write  += fwrite(p->data, sizeof(int), 2 * p->length, binary_file);
+            n_expect += 1 + 2 * p->length;
+        }
+        const void *Q_data = fp32 ? (const void*) h2pack->ULV_Q_fp32[node] : (const void*) Q->data;
+        const void *L_data = fp32 ? (const void*) h2pack->ULV_L_fp32[node] : (const void*) L->data;
+        n_write  += fwrite(Q_data, val_size, Q_size, binary_file);
+        n_write  += fwrite(L_data, val_size, L_size, binary_file);
+        n_expect += Q_size + L_size;
+    }
+
+    fclose(binary_file);
+    if (n_write != n_expect) ERROR_PRINTF("Failed to write ULV factorization to file %s\n", binary_fname);
+}
+
+int H2P_HSS_ULV_read_from_file(H2Pack_p h2pack, const char *binary_fname)
+{
+    if (!h2pack->is_HSS)
+    {
+        ERROR_PRINTF("H2Pack is not running in HSS mode!\n");
+        return -1;
+    }
+
+    FILE *binary_file = fopen(binary_fname, "rb");
+    if (binary_file == NULL)
+    {
+        ERROR_PRINTF("Cannot open binary data file %s\n", binary_fname);
+        return -1;
+    }
+
+    // 1. Header, check if the stored factorization matches h2pack
+    char magic[8];
+    int32_t header[H2P_ULV_FILE_NHEADER];
+    uint64_t tree_hash;
+    double HSS_logdet;
+    size_t n_read = 0;
+    n_read += fread(magic, 8, 1, binary_file);
+    n_read += fread(header, sizeof(int32_t), H2P_ULV_FILE_NHEADER, binary_file);
+    n_read += fread(&tree_hash,  sizeof(uint64_t), 1, binary_file);
+    n_read += fread(&HSS_logdet, sizeof(double),   1, binary_file);
+    if (n_read != 1 + H2P_ULV_FILE_NHEADER + 1 + 1 || memcmp(magic, H2P_ULV_FILE_MAGIC, 8) != 0)
+    {
+        ERROR_PRINTF("%s is not a H2Pack ULV factorization file\n", binary_fname);
+        fclose(binary_file);
+        return -1;
+    }
+    int n_node  = h2pack->n_node;
+    int is_LU   = header[3];
+    size_t val_size = (size_t) header[2];
+    const char *mismatch = NULL;
+    if (header[0] != H2P_ULV_FILE_VERSION) mismatch = "file version";
+    if (header[1] != (int32_t) sizeof(DTYPE)) mismatch = "DTYPE size";
+    if (val_size  != sizeof(DTYPE) && val_size != sizeof(float)) mismatch = "factor data size";
+    if (header[5] != n_node)                mismatch = "number of nodes";
+    if (header[6] != h2pack->krnl_mat_size) mismatch = "kernel matrix size";
+    if (header[7] != h2pack->max_level)     mismatch = "number of levels";
+    if (header[8] != h2pack->root_idx)      mismatch = "root node index";
+    if (header[9] != h2pack->krnl_dim)      mismatch = "kernel dimension";
+    if (mismatch == NULL && tree_hash != H2P_HSS_ULV_tree_hash(h2pack)) mismatch = "partitioning tree or HSS basis sizes";
+    if (mismatch != NULL)
+    {
+        ERROR_PRINTF("ULV factorization file %s does not match H2Pack structure: %s\n", binary_fname, mismatch);
+        fclose(binary_file);
+        return -1;
+    }
+    int fp32 = (val_size == sizeof(float)) && (sizeof(float) != sizeof(DTYPE));
+
+    // 2. Allocate ULV arrays and read ULV_Ls
+    int *ULV_Ls;
+    H2P_int_vec_p   *ULV_idx, *ULV_p = NULL;
+    H2P_dense_mat_p *ULV_Q, *ULV_L;
+    float **ULV_Q_fp32 = NULL, **ULV_L_fp32 = NULL;
+    ULV_Ls  = (int*)             malloc(sizeof(int)             * n_node);
+    ULV_idx = (H2P_int_vec_p*)   calloc(n_node, sizeof(H2P_int_vec_p));
+    ULV_Q   = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    ULV_L   = (H2P_dense_mat_p*) calloc(n_node, sizeof(H2P_dense_mat_p));
+    if (is_LU) ULV_p = (H2P_int_vec_p*) calloc(n_node, sizeof(H2P_int_vec_p));
+    if (fp32)
+    {
+        ULV_Q_fp32 = (float**) calloc(n_node, sizeof(float*));
+        ULV_L_fp32 = (float**) calloc(n_node, sizeof(float*));
+    }
+    ASSERT_PRINTF(
+        ULV_Ls != NULL && ULV_idx != NULL && ULV_Q != NULL && ULV_L != NULL &&
+        (!is_LU || ULV_p != NULL) && (!fp32 || (ULV_Q_fp32 != NULL && ULV_L_fp32 != NULL)),
+        "Failed to allocate arrays for HSS ULV factorization\n"
     );
-    int *node_n_r_adm = h2pack->node_n_r_adm;
-    memset(node_n_r_adm, 0, sizeof(int) * n_node);
-    int B_pair_cnt = 0;
-    for (int i = 0; i < input_n_r_adm_pair; i++)
+    int is_valid = (fread(ULV_Ls, sizeof(int), n_node, binary_file) == (size_t) n_node);
+
+    // 3. ULV_idx, ULV_p, ULV_Q, ULV_L of each node
+    int krnl_mat_size = h2pack->krnl_mat_size;
+    size_t ULV_Q_size = 0, ULV_L_size = 0, ULV_I_size = n_node;
+    for (int node = 0; node < n_node && is_valid; node++)
     {
-        int node0 = input_r_adm_pairs[2 * i];
-        int node1 = input_r_adm_pairs[2 * i + 1];
-        B_pair_i[B_pair_cnt] = node0;
-        B_pair_j[B_pair_cnt] = node1;
-        B_pair_v[B_pair_cnt] = i + 1;
-        B_pair_cnt++;
-        B_pair_i[B_pair_cnt] = node1;
-        B_pair_j[B_pair_cnt] = node0;
-        B_pair_v[B_pair_cnt] = -(i + 1);
-        B_pair_cnt++;
-        node_n_r_adm[node0]++;
-        node_n_r_adm[node1]++;
-        mat_size[MV_MID_SIZE_IDX] +=  B_nrow[i] * B_ncol[i];
-        mat_size[MV_MID_SIZE_IDX] += (B_nrow[i] + B_ncol[i]);
-        mat_size[MV_MID_SIZE_IDX] += (B_nrow[i] + B_ncol[i]);
-        if (h2pack->BD_JIT)
+        int32_t node_sizes[5];
+        if (fread(node_sizes, sizeof(int32_t), 5, binary_file) != 5) { is_valid = 0; break; }
+        int idx_len = node_sizes[0], Q_nrow = node_sizes[1], Q_ncol = node_sizes[2];
+        int L_nrow  = node_sizes[3], L_ncol = node_sizes[4];
+        // Sizes must satisfy the layout produced by the ULV factorization
+        if (idx_len < 0 || idx_len > krnl_mat_size || L_nrow != idx_len || L_ncol != idx_len ||
+            ULV_Ls[node] < 0 || ULV_Ls[node] > L_nrow || Q_ncol < 0 || Q_nrow < 0)
         {
-            int level0 = node_level[node0];
-            int level1 = node_level[node1];
-            int node0_npt = 0, node1_npt = 0;
-            if (level0 == level1)
+            is_valid = 0;
+            break;
+        }
+        H2P_int_vec_init(&ULV_idx[node], MAX(idx_len, 1));
+        ULV_idx[node]->length = idx_len;
+        if (fread(ULV_idx[node]->data, sizeof(int), idx_len, binary_file) != (size_t) idx_len) { is_valid = 0; break; }
+        for (int k = 0; k < idx_len; k++)
+            if (ULV_idx[node]->data[k] < 0 || ULV_idx[node]->data[k] >= krnl_mat_size) is_valid = 0;
+        ULV_I_size += idx_len;
+        if (is_LU)
+        {
+            int32_t p_length;
+            if (fread(&p_length, sizeof(int32_t), 1, binary_file) != 1) { is_valid = 0; break; }
+            if (p_length != L_nrow - ULV_Ls[node]) { is_valid = 0; break; }
+            H2P_int_vec_init(&ULV_p[node], MAX(2 * p_length, 1));
+            ULV_p[node]->length = p_length;
+            if (fread(ULV_p[node]->data, sizeof(int), 2 * p_length, binary_file) != (size_t) (2 * p_length)) { is_valid = 0; break; }
+            for (int k = 0; k < p_length; k++)
+                if (ULV_p[node]->data[k] < 0 || ULV_p[node]->data[k] >= p_length) is_valid = 0;
+            ULV_I_size += p_length;
+        }
+        size_t Q_size = (size_t) Q_nrow * (size_t) Q_ncol;
+        size_t L_size = (size_t) L_nrow * (size_t) L_ncol;
+        if (fp32)
+        {
+            H2P_dense_mat_init(&ULV_Q[node], 0, 0);
+            H2P_dense_mat_init(&ULV_L[node], 0, 0);
+            ULV_Q_fp32[node] = (float*) malloc_aligned(sizeof(float) * MAX(Q_size, 1), 64);
+            ULV_L_fp32[node] = (float*) malloc_aligned(sizeof(float) * MAX(L_size, 1), 64);
+            ASSERT_PRINTF(
+                ULV_Q_fp32[node] != NULL && ULV_L_fp32[node] != NULL, 
+                "Failed to allocate float ULV factors of node %d\n", node
+            );
+            if (fread(ULV_Q_fp32[node], sizeof(float), Q_size, binary_file) != Q_size) is_valid = 0;
+            if (fread(ULV_L_fp32[node], sizeof(float), L_size, binary_file) != L_size) is_valid = 0;
+        } else {
+            H2P_dense_mat_init(&ULV_Q[node], Q_nrow, Q_ncol);
+            H2P_dense_mat_init(&ULV_L[node], L_nrow, L_ncol);
+            if (fread(ULV_Q[node]->data, sizeof(DTYPE), Q_size, binary_file) != Q_size) is_valid = 0;
+            if (fread(ULV_L[node]->data, sizeof(DTYPE), L_size, binary_file) != L_size) is_valid = 0;
+        }
+        // Keep the sizes of ULV_Q[node] and ULV_L[node] for float factors
+        ULV_Q[node]->nrow = Q_nrow;
+        ULV_Q[node]->ncol = Q_ncol;
+        ULV_Q[node]->ld   = Q_ncol;
+        ULV_L[node]->nrow = L_nrow;
+        ULV_L[node]->ncol = L_ncol;
+        ULV_L[node]->ld   = L_ncol;
+        ULV_Q_size += Q_size;
+        ULV_L_size += L_size;
+    }
+    // There should be nothing left in the file
+    char tail_byte;
+    if (is_valid && fread(&tail_byte, 1, 1, binary_file) != 0) is_valid = 0;
+    fclose(binary_file);
+
+    // 4. Replace the ULV factorization in h2pack if all data are valid
+    if (!is_valid)
+    {
+        ERROR_PRINTF("ULV factorization file %s is truncated or corrupted\n", binary_fname);
+        for (int node = 0; node < n_node; node++)
+        {
+            H2P_int_vec_destroy(&ULV_idx[node]);
+            if (is_LU) H2P_int_vec_destroy(&ULV_p[node]);
+            H2P_dense_mat_destroy(&ULV_Q[node]);
+            H2P_dense_mat_destroy(&ULV_L[node]);
+            if (fp32)
             {
-                node0_npt = J[node0]->length;
-                node1_npt = J[node1]->length;
+                free_aligned(ULV_Q_fp32[node]);
+                free_aligned(ULV_L_fp32[node]);
             }
-            if (level0 > level1)
+        }
+        free(ULV_Ls);
+        free(ULV_idx);
+        free(ULV_p);
+        free(ULV_Q);
+        free(ULV_L);
+        free(ULV_Q_fp32);
+        free(ULV_L_fp32);
+        return -1;
+    }
+    H2P_HSS_ULV_free(h2pack);
+    h2pack->ULV_Ls     = ULV_Ls;
+    h2pack->ULV_idx    = ULV_idx;
+    h2pack->ULV_p      = ULV_p;
+    h2pack->ULV_Q      = ULV_Q;
+    h2pack->ULV_L      = ULV_L;
+    h2pack->ULV_Q_fp32 = ULV_Q_fp32;
+    h2pack->ULV_L_fp32 = ULV_L_fp32;
+
+    double fp_ratio = (double) val_size / (double) sizeof(DTYPE);
+    h2pack->is_HSS_SPD = header[4];
+    h2pack->HSS_logdet = (DTYPE) HSS_logdet;
+    h2pack->mat_size[ULV_Q_SIZE_IDX] = (size_t) ((double) ULV_Q_size * fp_ratio);
+    h2pack->mat_size[ULV_L_SIZE_IDX] = (size_t) ((double) ULV_L_size * fp_ratio);
+    h2pack->mat_size[ULV_I_SIZE_IDX] = ULV_I_size;
+    h2pack->timers[ULV_FCT_TIMER_IDX] = 0.0;
+    return 0;
+}
+
+// Single-file binary H2 representation format. The file is a 64-byte header,
+// a section table, and sections whose payloads start at 64-byte aligned
+// offsets. All values are stored in the native byte order, endian_tag detects
+// files written on a host with another byte order. Unknown section IDs are
+// ignored by the loader, so new sections can be added without breaking old files.
+// Each section has a checksum of its payload, see H2P_bin_checksum(). U, B, and D
+// sections can be stored with an error-bounded encoding, see H2P_bin_quant_encode().
+// Version 4 adds the RPY / periodic metadata and sections after H2P_BIN_SEC_D_DATA, 
+// version 3 files are loaded with these sections empty. 
+#define H2P_BIN_FILE_MAGIC      "H2PBIN\0\0"
+#define H2P_BIN_FILE_VERSION    4
+#define H2P_BIN_MIN_VERSION     3       // Oldest file version the loader accepts
+#define H2P_BIN_ENDIAN_TAG      0x01020304
+#define H2P_BIN_ALIGN           64
+#define H2P_BIN_MAX_SECTION     1024
+#define H2P_BIN_IO_PIECE        (4 * 1024 * 1024)   // Large sections are read and written in pieces of this size
+#define H2P_BIN_QUANT_BLOCK     1024    // Number of values sharing a scale in H2P_BIN_ENC_QUANT, divides H2P_BIN_IO_PIECE / sizeof(DTYPE)
+#define H2P_BIN_ENC_RAW         0       // Payload is stored as is
+#define H2P_BIN_ENC_QUANT       1       // DTYPE payload is encoded by H2P_bin_quant_encode()
+#define H2P_BIN_LOAD_READ       0       // Read everything into memory
+#define H2P_BIN_LOAD_MMAP       1       // Map the file, U, B, and D point to the mapping
+#define H2P_BIN_LOAD_OOC        2       // Read U into memory, B and D stay in the file
+#define H2P_BIN_LOAD_SHM        3       // Same as H2P_BIN_LOAD_MMAP, but map a POSIX shared memory object
+
+struct H2P_bin_header
+{
+    char     magic[8];          // H2P_BIN_FILE_MAGIC
+    uint32_t version;           // H2P_BIN_FILE_VERSION
+    uint32_t endian_tag;        // H2P_BIN_ENDIAN_TAG
+    uint32_t dtype_size;        // sizeof(DTYPE) of the stored matrices
+    uint32_t n_section;         // Number of entries in the section table
+    uint64_t sec_table_offset;  // Offset of the section table
+    uint64_t file_size;         // Total file size in bytes
+    uint64_t reserved[3];       // Reserved, zeros
+};
+typedef struct H2P_bin_header H2P_bin_header_s;
+
+struct H2P_bin_section
+{
+    uint32_t id;                // Section ID, see H2P_bin_sec_t
+    uint32_t elem_size;         // Size of each element in bytes
+    uint64_t offset;            // Payload offset, multiple of H2P_BIN_ALIGN
+    uint64_t nbytes;            // Payload size in bytes
+    uint64_t checksum;          // Checksum of the payload
+    uint32_t encoding;          // H2P_BIN_ENC_RAW or H2P_BIN_ENC_QUANT
+    uint32_t enc_nbits;         // Bits of each quantized value if encoding == H2P_BIN_ENC_QUANT
+    uint64_t raw_nbytes;        // Payload size in bytes after decoding
+};
+typedef struct H2P_bin_section H2P_bin_section_s;
+
+typedef enum
+{
+    H2P_BIN_SEC_META = 0,   // int64_t, scalar metadata, see H2P_bin_meta_t
+    H2P_BIN_SEC_TREE,       // int,     node_level, pt_cluster, n_child, children
+    H2P_BIN_SEC_ENBOX,      // DTYPE,   enclosing box of each node
+    H2P_BIN_SEC_PAIRS,      // int,     reduced admissible pairs, reduced inadmissible pairs, leaf nodes
+    H2P_BIN_SEC_PERM,       // int,     coord_idx
+    H2P_BIN_SEC_COORD,      // DTYPE,   sorted point coordinates h2pack->coord
+    H2P_BIN_SEC_SKEL,       // int,     skeleton point set sizes of all nodes, then all skeleton point sets
+    H2P_BIN_SEC_U_SIZE,     // int,     (nrow, ncol) of all U matrices
+    H2P_BIN_SEC_U_DATA,     // DTYPE,   U matrices, each starts at a 64-byte aligned offset
+    H2P_BIN_SEC_B_SIZE,     // int,     (nrow, ncol) of all B matrices
+    H2P_BIN_SEC_B_DATA,     // DTYPE,   all B matrices, same layout as h2pack->B_data
+    H2P_BIN_SEC_D_SIZE,     // int,     (nrow, ncol) of all D matrices
+    H2P_BIN_SEC_D_DATA,     // DTYPE,   all D matrices, same layout as h2pack->D_data
+    H2P_BIN_SEC_PER_LAT,    // DTYPE,   periodic lattices h2pack->per_lattices
+    H2P_BIN_SEC_PER_ADM,    // DTYPE,   shifts of reduced admissible pairs h2pack->per_adm_shifts
+    H2P_BIN_SEC_PER_INADM,  // DTYPE,   shifts of reduced inadmissible pairs h2pack->per_inadm_shifts
+    H2P_BIN_SEC_PER_BLK,    // DTYPE,   periodic block h2pack->per_blk
+    H2P_BIN_SEC_KRNL_PARAM, // bytes,   kernel parameters h2pack->krnl_param, zero padded to a multiple of 4 bytes
+    H2P_BIN_N_SEC
+} H2P_bin_sec_t;
+
+typedef enum
+{
+    H2P_BIN_META_PT_DIM = 0,
+    H2P_BIN_META_XPT_DIM,
+    H2P_BIN_META_KRNL_DIM,
+    H2P_BIN_META_N_POINT,
+    H2P_BIN_META_KRNL_MAT_SIZE,
+    H2P_BIN_META_N_NODE,
+    H2P_BIN_META_ROOT_IDX,
+    H2P_BIN_META_MAX_LEVEL,
+    H2P_BIN_META_MAX_CHILD,
+    H2P_BIN_META_N_LEAF_NODE,
+    H2P_BIN_META_MAX_LEAF_POINTS,
+    H2P_BIN_META_IS_HSS,
+    H2P_BIN_META_MIN_ADM_LEVEL,
+    H2P_BIN_META_N_R_ADM_PAIR,
+    H2P_BIN_META_N_R_INADM_PAIR,
+    H2P_BIN_META_QR_STOP_TOL,   // double stored in an int64_t
+    H2P_BIN_META_IS_RPY,        // Metadata below are added in version 4
+    H2P_BIN_META_IS_PERIODIC,   // h2pack->is_RPY_Ewald, the matrix is built by H2P_build_periodic()
+    H2P_BIN_META_N_LATTICE,
+    H2P_BIN_META_PER_BLK_RANK,  // Always -1, per_blk is stored as a dense matrix
+    H2P_BIN_META_KRNL_PARAM_BYTES,
+    H2P_BIN_N_META
+} H2P_bin_meta_t;
+
+static inline size_t H2P_bin_align(const size_t nbytes)
+{
+    return (nbytes + H2P_BIN_ALIGN - 1) / H2P_BIN_ALIGN * H2P_BIN_ALIGN;
+}
+
+// Size in bytes of the U_DATA section, each U matrix starts at an aligned offset
+static size_t H2P_bin_U_data_nbytes(const int n_node, const int *U_size)
+{
+    size_t nbytes = 0;
+    for (int i = 0; i < n_node; i++)
+        nbytes += H2P_bin_align(sizeof(DTYPE) * (size_t) U_size[2 * i] * (size_t) U_size[2 * i + 1]);
+    return nbytes;
+}
+
+// Finalizer of SplitMix64, a bijection on 64-bit integers
+static inline uint64_t H2P_bin_mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Partial checksum of a piece of a section payload. Each 32-bit word is mixed with its 
+// word index in the section and the results are summed, so the checksum of a section 
+// is the sum (mod 2^64) of the partial checksums of any partition of its payload and 
+// pieces can be handled by different threads in any order. Changing any single word 
+// always changes the checksum. 
+// Input parameters:
+//   data   : Piece of the section payload
+//   nbytes : Size of the piece in bytes, multiple of 4
+//   spos   : Offset of the piece in the section in bytes, multiple of 4
+// Output parameter:
+//   <return> : Partial checksum of the piece
+static uint64_t H2P_bin_checksum(const void *data, const size_t nbytes, const size_t spos)
+{
+    const char *data_c = (const char*) data;
+    size_t   n_word = nbytes / 4;
+    uint64_t w_spos = spos / 4, sum = 0;
+    for (size_t i = 0; i < n_word; i++)
+    {
+        uint32_t w;
+        memcpy(&w, data_c + 4 * i, 4);
+        sum += H2P_bin_mix64((w_spos + i) * 0x9e3779b97f4a7c15ULL ^ w);
+    }
+    return sum;
+}
+
+// Write to a file at the given offset, retry until all bytes are written
+// Input parameters:
+//   fd     : File descriptor
+//   src    : Size >= nbytes, data to write
+//   nbytes : Number of bytes to write
+//   offset : Offset in the file
+// Output parameter:
+//   <return> : 0 if succeeded, -1 if failed
+static int H2P_bin_pwrite(const int fd, const void *src, size_t nbytes, off_t offset)
+{
+    const char *src_c = (const char*) src;
+    while (nbytes > 0)
+    {
+        ssize_t n_write = pwrite(fd, src_c, nbytes, offset);
+        if (n_write <= 0) return -1;
+        src_c  += n_write;
+        nbytes -= n_write;
+        offset += n_write;
+    }
+    return 0;
+}
+
+// Read from a file at the given offset, retry until all bytes are read
+// Input parameters:
+//   fd     : File descriptor
+//   nbytes : Number of bytes to read
+//   offset : Offset in the file
+// Output parameters:
+//   dst      : Size >= nbytes, data read from the file
+//   <return> : 0 if succeeded, -1 if failed
+static int H2P_bin_pread(const int fd, void *dst, size_t nbytes, off_t offset)
+{
+    char *dst_c = (char*) dst;
+    while (nbytes > 0)
+    {
+        ssize_t n_read = pread(fd, dst_c, nbytes, offset);
+        if (n_read <= 0) return -1;
+        dst_c  += n_read;
+        nbytes -= n_read;
+        offset += n_read;
+    }
+    return 0;
+}
+
+// Number of bits of each quantized value in H2P_bin_quant_encode() for an error bound
+// Input parameter:
+//   quant_reltol : Error bound relative to the max abs value of each block
+// Output parameter:
+//   <return> : Bits of each quantized value, in [2, 63]
+static int H2P_bin_quant_nbits(const double quant_reltol)
+{
+    int nbits = 2;
+    while (nbits < 63 && ldexp(1.0, nbits - 1) - 1.0 < 0.5 / quant_reltol) nbits++;
+    return nbits;
+}
+
+// Size in bytes of n_elem values encoded by H2P_bin_quant_encode()
+static size_t H2P_bin_quant_nbytes(const size_t n_elem, const int nbits)
+{
+    size_t n_full_blk = n_elem / H2P_BIN_QUANT_BLOCK;
+    size_t n_rem      = n_elem % H2P_BIN_QUANT_BLOCK;
+    size_t nbytes     = n_full_blk * 8 * (1 + ((size_t) H2P_BIN_QUANT_BLOCK * nbits + 63) / 64);
+    if (n_rem > 0) nbytes += 8 * (1 + (n_rem * nbits + 63) / 64);
+    return nbytes;
+}
+
+// Block-wise error-bounded quantization. Each block of H2P_BIN_QUANT_BLOCK values is 
+// stored as its max abs value M (a double) followed by the values rounded to integers 
+// in [-Q, Q] in units of M / Q, Q = 2^(nbits-1) - 1, packed with nbits bits each. The 
+// error of each value is at most M / (2 * Q). The encoded size only depends on n_elem
+// and nbits, so the offsets of encoded pieces are known before encoding. 
+// Input parameters:
+//   src    : Size n_elem, values to encode
+//   n_elem : Number of values
+//   nbits  : Bits of each quantized value, in [2, 63]
+// Output parameter:
+//   dst : Size H2P_bin_quant_nbytes(n_elem, nbits) / 8, encoded values
+static void H2P_bin_quant_encode(const DTYPE *src, const size_t n_elem, const int nbits, uint64_t *dst)
+{
+    const int64_t Q = ((int64_t) 1 << (nbits - 1)) - 1;
+    for (size_t blk_s = 0; blk_s < n_elem; blk_s += H2P_BIN_QUANT_BLOCK)
+    {
+        size_t n      = MIN(H2P_BIN_QUANT_BLOCK, n_elem - blk_s);
+        size_t n_word = (n * nbits + 63) / 64;
+        double max_abs = 0.0;
+        for (size_t i = 0; i < n; i++) max_abs = MAX(max_abs, fabs((double) src[blk_s + i]));
+        double scale = (max_abs > 0.0) ? (double) Q / max_abs : 0.0;
+        memcpy(dst, &max_abs, sizeof(double));
+        uint64_t *words = dst + 1;
+        memset(words, 0, sizeof(uint64_t) * n_word);
+        for (size_t i = 0; i < n; i++)
+        {
+            int64_t q = (int64_t) llround((double) src[blk_s + i] * scale);
+            q = MAX(-Q, MIN(q, Q));
+            uint64_t u   = (uint64_t) (q + Q);
+            size_t   bit = i * nbits, w = bit / 64, sft = bit % 64;
+            words[w] |= u << sft;
+            if (sft + nbits > 64) words[w + 1] |= u >> (64 - sft);
+        }
+        dst += 1 + n_word;
+    }
+}
+
+// Decode values encoded by H2P_bin_quant_encode()
+// Input parameters:
+//   src    : Size H2P_bin_quant_nbytes(n_elem, nbits) / 8, encoded values
+//   n_elem : Number of values
+//   nbits  : Bits of each quantized value, in [2, 63]
+// Output parameter:
+//   dst : Size n_elem, decoded values
+static void H2P_bin_quant_decode(const uint64_t *src, const size_t n_elem, const int nbits, DTYPE *dst)
+{
+    const int64_t  Q    = ((int64_t) 1 << (nbits - 1)) - 1;
+    const uint64_t mask = ((uint64_t) 1 << nbits) - 1;
+    for (size_t blk_s = 0; blk_s < n_elem; blk_s += H2P_BIN_QUANT_BLOCK)
+    {
+        size_t n      = MIN(H2P_BIN_QUANT_BLOCK, n_elem - blk_s);
+        size_t n_word = (n * nbits + 63) / 64;
+        double max_abs;
+        memcpy(&max_abs, src, sizeof(double));
+        double unit = max_abs / (double) Q;
+        const uint64_t *words = src + 1;
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t   bit = i * nbits, w = bit / 64, sft = bit % 64;
+            uint64_t u   = words[w] >> sft;
+            if (sft + nbits > 64) u |= words[w + 1] << (64 - sft);
+            dst[blk_s + i] = (DTYPE) ((double) ((int64_t) (u & mask) - Q) * unit);
+        }
+        src += 1 + n_word;
+    }
+}
+
+// Evaluate a B or D matrix of a periodic H2 matrix in JIT mode. Same as H2P_build_periodic(), 
+// the points of node1 are shifted by the periodic shift of the pair. 
+// Input parameters:
+//   h2pack   : H2Pack structure after calling H2P_build_periodic()
+//   is_D     : 0 for a B matrix, 1 for a D matrix
+//   k        : Index of the B or D matrix
+//   coord1_s : Work matrix for the shifted coordinates of node1
+// Output parameter:
+//   blk : The k-th B or D matrix
+static void H2P_bin_get_periodic_BD_blk(
+    H2Pack_p h2pack, const int is_D, const int k, H2P_dense_mat_p coord1_s, H2P_dense_mat_p blk
+)
+{
+    int   pt_dim      = h2pack->pt_dim;
+    int   xpt_dim     = h2pack->xpt_dim;
+    int   krnl_dim    = h2pack->krnl_dim;
+    int   n_point     = h2pack->n_point;
+    int   n_leaf_node = h2pack->n_leaf_node;
+    int   *pt_cluster = h2pack->pt_cluster;
+    int   *node_level = h2pack->node_level;
+    DTYPE *coord      = h2pack->coord;
+    H2P_dense_mat_p *J_coord = h2pack->J_coord;
+
+    int node0, node1;
+    DTYPE shift[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    if (is_D == 0)
+    {
+        node0 = h2pack->r_adm_pairs[2 * k];
+        node1 = h2pack->r_adm_pairs[2 * k + 1];
+        for (int j = 0; j < pt_dim; j++) shift[j] = h2pack->per_adm_shifts[k * pt_dim + j];
+    } else if (k < n_leaf_node) {
+        node0 = h2pack->height_nodes[k];
+        node1 = node0;
+    } else {
+        int i = k - n_leaf_node;
+        node0 = h2pack->r_inadm_pairs[2 * i];
+        node1 = h2pack->r_inadm_pairs[2 * i + 1];
+        for (int j = 0; j < pt_dim; j++) shift[j] = h2pack->per_inadm_shifts[i * pt_dim + j];
+    }
+
+    // A B matrix is compressed on the side of each node that is not a leaf node 
+    // on a higher level than the other node, a D matrix uses all points
+    int use_J0 = (is_D == 0) && (node_level[node0] >= node_level[node1]);
+    int use_J1 = (is_D == 0) && (node_level[node0] <= node_level[node1]);
+    int pt_s0  = pt_cluster[2 * node0];
+    int pt_s1  = pt_cluster[2 * node1];
+    int npt0   = use_J0 ? J_coord[node0]->ncol : (pt_cluster[2 * node0 + 1] - pt_s0 + 1);
+    int npt1   = use_J1 ? J_coord[node1]->ncol : (pt_cluster[2 * node1 + 1] - pt_s1 + 1);
+    int ld0    = use_J0 ? J_coord[node0]->ld   : n_point;
+    DTYPE *coord0 = use_J0 ? J_coord[node0]->data : (coord + pt_s0);
+    if (use_J1)
+    {
+        H2P_dense_mat_copy(J_coord[node1], coord1_s);
+    } else {
+        H2P_dense_mat_resize(coord1_s, xpt_dim, npt1);
+        copy_matrix_block(sizeof(DTYPE), xpt_dim, npt1, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
+    }
+    H2P_shift_coord(coord1_s, shift, 1.0);
+    H2P_dense_mat_resize(blk, npt0 * krnl_dim, npt1 * krnl_dim);
+    h2pack->krnl_eval(
+        coord0, ld0, npt0, coord1_s->data, coord1_s->ld, npt1, 
+        h2pack->krnl_param, blk->data, blk->ld
+    );
+}
+
+// Store a H2 representation to a binary file, shared by H2P_store_to_binary_file(), 
+// H2P_store_to_compressed_binary_file(), and H2P_store_to_shm(). U, B, and D are stored 
+// with H2P_BIN_ENC_QUANT using quant_nbits bits for each value if quant_nbits > 0. 
+// If is_shm == 1, binary_fname is the name of a POSIX shared memory object. 
+static void H2P_store_binary_file(H2Pack_p h2pack, const char *binary_fname, const int quant_nbits, const int is_shm)
+{
+    if (h2pack->is_H2ERI)
+    {
+        ERROR_PRINTF("Cannot store H2 matrix in H2ERI mode to file\n");
+        return;
+    }
+    if (h2pack->is_RPY_Ewald && h2pack->per_blk == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_build_periodic() first!\n");
+        return;
+    }
+    if (h2pack->U == NULL || h2pack->J == NULL)
+    {
+        ERROR_PRINTF("Need to call H2P_build() first!\n");
+        return;
+    }
+
+    int n_node      = h2pack->n_node;
+    int n_point     = h2pack->n_point;
+    int max_child   = h2pack->max_child;
+    int n_leaf_node = h2pack->n_leaf_node;
+    int n_B         = h2pack->n_B;
+    int n_D         = h2pack->n_D;
+    int min_adm_level  = h2pack->is_HSS ? h2pack->HSS_min_adm_level  : h2pack->min_adm_level;
+    int n_r_adm_pair   = h2pack->is_HSS ? h2pack->HSS_n_r_adm_pair   : h2pack->n_r_adm_pair;
+    int n_r_inadm_pair = h2pack->is_HSS ? h2pack->HSS_n_r_inadm_pair : h2pack->n_r_inadm_pair;
+    int *r_adm_pairs   = h2pack->is_HSS ? h2pack->HSS_r_adm_pairs    : h2pack->r_adm_pairs;
+    int *r_inadm_pairs = h2pack->is_HSS ? h2pack->HSS_r_inadm_pairs  : h2pack->r_inadm_pairs;
+    int is_periodic    = h2pack->is_RPY_Ewald;
+    size_t per_blk_size = 0;
+    if (is_periodic)
+    {
+        per_blk_size = (size_t) h2pack->J[h2pack->root_idx]->length * (size_t) h2pack->krnl_dim;
+        per_blk_size = per_blk_size * per_blk_size;
+    }
+    size_t krnl_param_bytes = (h2pack->krnl_param != NULL) ? h2pack->krnl_param_bytes : 0;
+
+    // 1. Pack metadata and index arrays
+    int64_t meta[H2P_BIN_N_META];
+    double QR_stop_tol = (double) h2pack->QR_stop_tol;
+    meta[H2P_BIN_META_PT_DIM]          = h2pack->pt_dim;
+    meta[H2P_BIN_META_XPT_DIM]         = h2pack->xpt_dim;
+    meta[H2P_BIN_META_KRNL_DIM]        = h2pack->krnl_dim;
+    meta[H2P_BIN_META_N_POINT]         = n_point;
+    meta[H2P_BIN_META_KRNL_MAT_SIZE]   = h2pack->krnl_mat_size;
+    meta[H2P_BIN_META_N_NODE]          = n_node;
+    meta[H2P_BIN_META_ROOT_IDX]        = h2pack->root_idx;
+    meta[H2P_BIN_META_MAX_LEVEL]       = h2pack->max_level;
+    meta[H2P_BIN_META_MAX_CHILD]       = max_child;
+    meta[H2P_BIN_META_N_LEAF_NODE]     = n_leaf_node;
+    meta[H2P_BIN_META_MAX_LEAF_POINTS] = h2pack->max_leaf_points;
+    meta[H2P_BIN_META_IS_HSS]          = h2pack->is_HSS;
+    meta[H2P_BIN_META_MIN_ADM_LEVEL]   = min_adm_level;
+    meta[H2P_BIN_META_N_R_ADM_PAIR]    = n_r_adm_pair;
+    meta[H2P_BIN_META_N_R_INADM_PAIR]  = n_r_inadm_pair;
+    memcpy(&meta[H2P_BIN_META_QR_STOP_TOL], &QR_stop_tol, sizeof(double));
+    meta[H2P_BIN_META_IS_RPY]           = h2pack->is_RPY;
+    meta[H2P_BIN_META_IS_PERIODIC]      = is_periodic;
+    meta[H2P_BIN_META_N_LATTICE]        = is_periodic ? h2pack->n_lattice : 0;
+    meta[H2P_BIN_META_PER_BLK_RANK]     = -1;
+    meta[H2P_BIN_META_KRNL_PARAM_BYTES] = (int64_t) krnl_param_bytes;
+
+    size_t tree_size  = (size_t) n_node * (4 + max_child);
+    size_t pairs_size = (size_t) 2 * (n_r_adm_pair + n_r_inadm_pair) + n_leaf_node;
+    size_t skel_size  = n_node;
+    for (int i = 0; i < n_node; i++) skel_size += h2pack->J[i]->length;
+    int *tree   = (int*) malloc(sizeof(int) * tree_size);
+    int *pairs  = (int*) malloc(sizeof(int) * pairs_size);
+    int *skel   = (int*) malloc(sizeof(int) * skel_size);
+    int *U_size = (int*) malloc(sizeof(int) * 2 * n_node);
+    int *B_size = (int*) malloc(sizeof(int) * 2 * (n_B + 1));
+    int *D_size = (int*) malloc(sizeof(int) * 2 * (n_D + 1));
+    char *krnl_param = (char*) calloc((krnl_param_bytes + 3) / 4 + 1, 4);
+    ASSERT_PRINTF(
+        tree != NULL && pairs != NULL && skel != NULL && U_size != NULL && B_size != NULL && D_size != NULL && krnl_param != NULL,
+        "Failed to allocate binary file index arrays\n"
+    );
+    if (krnl_param_bytes > 0) memcpy(krnl_param, h2pack->krnl_param, krnl_param_bytes);
+    memcpy(tree,               h2pack->node_level, sizeof(int) * n_node);
+    memcpy(tree + n_node,      h2pack->pt_cluster, sizeof(int) * n_node * 2);
+    memcpy(tree + n_node * 3,  h2pack->n_child,    sizeof(int) * n_node);
+    memcpy(tree + n_node * 4,  h2pack->children,   sizeof(int) * n_node * max_child);
+    memcpy(pairs, r_adm_pairs, sizeof(int) * 2 * n_r_adm_pair);
+    memcpy(pairs + 2 * n_r_adm_pair, r_inadm_pairs, sizeof(int) * 2 * n_r_inadm_pair);
+    memcpy(pairs + 2 * (n_r_adm_pair + n_r_inadm_pair), h2pack->height_nodes, sizeof(int) * n_leaf_node);
+    size_t skel_pos = n_node;
+    for (int i = 0; i < n_node; i++)
+    {
+        H2P_int_vec_p Ji = h2pack->J[i];
+        skel[i] = Ji->length;
+        memcpy(skel + skel_pos, Ji->data, sizeof(int) * Ji->length);
+        skel_pos += Ji->length;
+    }
+    size_t B_total_size = 0, D_total_size = 0;
+    for (int i = 0; i < n_node; i++)
+    {
+        U_size[2 * i]     = h2pack->U[i]->nrow;
+        U_size[2 * i + 1] = h2pack->U[i]->ncol;
+    }
+    for (int i = 0; i < n_B; i++)
+    {
+        B_size[2 * i]     = h2pack->B_nrow[i];
+        B_size[2 * i + 1] = h2pack->B_ncol[i];
+        B_total_size += (size_t) h2pack->B_nrow[i] * (size_t) h2pack->B_ncol[i];
+    }
+    for (int i = 0; i < n_D; i++)
+    {
+        D_size[2 * i]     = h2pack->D_nrow[i];
+        D_size[2 * i + 1] = h2pack->D_ncol[i];
+        D_total_size += (size_t) h2pack->D_nrow[i] * (size_t) h2pack->D_ncol[i];
+    }
+
+    // 2. Section table, payloads are placed in the order of section IDs
+    H2P_bin_section_s sec[H2P_BIN_N_SEC];
+    const void *sec_src[H2P_BIN_N_SEC];
+    memset(sec, 0, sizeof(sec));
+    sec[H2P_BIN_SEC_META  ].nbytes = sizeof(int64_t) * H2P_BIN_N_META;
+    sec[H2P_BIN_SEC_TREE  ].nbytes = sizeof(int) * tree_size;
+    sec[H2P_BIN_SEC_ENBOX ].nbytes = sizeof(DTYPE) * n_node * 2 * h2pack->pt_dim;
+    sec[H2P_BIN_SEC_PAIRS ].nbytes = sizeof(int) * pairs_size;
+    sec[H2P_BIN_SEC_PERM  ].nbytes = sizeof(int) * n_point;
+    sec[H2P_BIN_SEC_COORD ].nbytes = sizeof(DTYPE) * n_point * h2pack->xpt_dim;
+    sec[H2P_BIN_SEC_SKEL  ].nbytes = sizeof(int) * skel_size;
+    sec[H2P_BIN_SEC_U_SIZE].nbytes = sizeof(int) * 2 * n_node;
+    sec[H2P_BIN_SEC_U_DATA].nbytes = H2P_bin_U_data_nbytes(n_node, U_size);
+    sec[H2P_BIN_SEC_B_SIZE].nbytes = sizeof(int) * 2 * n_B;
+    sec[H2P_BIN_SEC_B_DATA].nbytes = sizeof(DTYPE) * B_total_size;
+    sec[H2P_BIN_SEC_D_SIZE].nbytes = sizeof(int) * 2 * n_D;
+    sec[H2P_BIN_SEC_D_DATA].nbytes = sizeof(DTYPE) * D_total_size;
+    sec[H2P_BIN_SEC_PER_LAT   ].nbytes = is_periodic ? sizeof(DTYPE) * h2pack->n_lattice * h2pack->pt_dim : 0;
+    sec[H2P_BIN_SEC_PER_ADM   ].nbytes = is_periodic ? sizeof(DTYPE) * n_r_adm_pair * h2pack->pt_dim : 0;
+    sec[H2P_BIN_SEC_PER_INADM ].nbytes = is_periodic ? sizeof(DTYPE) * n_r_inadm_pair * h2pack->pt_dim : 0;
+    sec[H2P_BIN_SEC_PER_BLK   ].nbytes = sizeof(DTYPE) * per_blk_size;
+    sec[H2P_BIN_SEC_KRNL_PARAM].nbytes = (krnl_param_bytes + 3) / 4 * 4;
+    sec_src[H2P_BIN_SEC_META  ] = meta;
+    sec_src[H2P_BIN_SEC_TREE  ] = tree;
+    sec_src[H2P_BIN_SEC_ENBOX ] = h2pack->enbox;
+    sec_src[H2P_BIN_SEC_PAIRS ] = pairs;
+    sec_src[H2P_BIN_SEC_PERM  ] = h2pack->coord_idx;
+    sec_src[H2P_BIN_SEC_COORD ] = h2pack->coord;
+    sec_src[H2P_BIN_SEC_SKEL  ] = skel;
+    sec_src[H2P_BIN_SEC_U_SIZE] = U_size;
+    sec_src[H2P_BIN_SEC_U_DATA] = NULL;
+    sec_src[H2P_BIN_SEC_B_SIZE] = B_size;
+    sec_src[H2P_BIN_SEC_B_DATA] = (h2pack->BD_JIT == 0) ? h2pack->B_data : NULL;
+    sec_src[H2P_BIN_SEC_D_SIZE] = D_size;
+    sec_src[H2P_BIN_SEC_D_DATA] = (h2pack->BD_JIT == 0) ? h2pack->D_data : NULL;
+    sec_src[H2P_BIN_SEC_PER_LAT   ] = h2pack->per_lattices;
+    sec_src[H2P_BIN_SEC_PER_ADM   ] = h2pack->per_adm_shifts;
+    sec_src[H2P_BIN_SEC_PER_INADM ] = h2pack->per_inadm_shifts;
+    sec_src[H2P_BIN_SEC_PER_BLK   ] = h2pack->per_blk;
+    sec_src[H2P_BIN_SEC_KRNL_PARAM] = krnl_param;
+    uint64_t offset = H2P_bin_align(sizeof(H2P_bin_header_s) + sizeof(sec));
+    for (int i = 0; i < H2P_BIN_N_SEC; i++)
+    {
+        int is_DTYPE = (i == H2P_BIN_SEC_ENBOX  || i == H2P_BIN_SEC_COORD  || 
+                        i == H2P_BIN_SEC_U_DATA || i == H2P_BIN_SEC_B_DATA || i == H2P_BIN_SEC_D_DATA || 
+                        (i >= H2P_BIN_SEC_PER_LAT && i <= H2P_BIN_SEC_PER_BLK));
+        int is_quant = (quant_nbits > 0) && 
+                       (i == H2P_BIN_SEC_U_DATA || i == H2P_BIN_SEC_B_DATA || i == H2P_BIN_SEC_D_DATA);
+        sec[i].id = i;
+        sec[i].elem_size = is_DTYPE ? sizeof(DTYPE) : sizeof(int);
+        if (i == H2P_BIN_SEC_META) sec[i].elem_size = sizeof(int64_t);
+        if (i == H2P_BIN_SEC_KRNL_PARAM) sec[i].elem_size = 1;
+        sec[i].encoding   = is_quant ? H2P_BIN_ENC_QUANT : H2P_BIN_ENC_RAW;
+        sec[i].enc_nbits  = is_quant ? quant_nbits : 0;
+        sec[i].raw_nbytes = sec[i].nbytes;
+        if (is_quant) sec[i].nbytes = H2P_bin_quant_nbytes(sec[i].raw_nbytes / sizeof(DTYPE), quant_nbits);
+        sec[i].offset = offset;
+        offset += H2P_bin_align(sec[i].nbytes);
+    }
+    H2P_bin_header_s header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, H2P_BIN_FILE_MAGIC, 8);
+    header.version    = H2P_BIN_FILE_VERSION;
+    header.endian_tag = H2P_BIN_ENDIAN_TAG;
+    header.dtype_size = sizeof(DTYPE);
+    header.n_section  = H2P_BIN_N_SEC;
+    header.sec_table_offset = sizeof(H2P_bin_header_s);
+    header.file_size  = offset;
+
+    // 3. Write all sections in parallel. The offset of each U, B, and D matrix is known, 
+    //    so threads write disjoint parts of the file with pwrite() and accumulate partial 
+    //    checksums. The header and the section table are written after all checksums are 
+    //    known. Gaps between sections are holes in the file and are read as zeros. 
+    //    Encoded sections are encoded piece by piece from contiguous arrays, so U matrices
+    //    and B and D matrices in JIT mode are first gathered into temporary arrays. 
+    //    A shared memory object is unlinked and created again instead of being truncated, 
+    //    so processes attached to the old object keep using it until they detach. 
+    int fd;
+    if (is_shm)
+    {
+        shm_unlink(binary_fname);
+        fd = shm_open(binary_fname, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0 && ftruncate(fd, (off_t) header.file_size) != 0)
+        {
+            close(fd);
+            shm_unlink(binary_fname);
+            fd = -1;
+        }
+    } else {
+        fd = open(binary_fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0)
+    {
+        ERROR_PRINTF("Cannot open binary data file %s\n", binary_fname);
+        free(tree);
+        free(pairs);
+        free(skel);
+        free(U_size);
+        free(B_size);
+        free(D_size);
+        free(krnl_param);
+        return;
+    }
+    size_t *U_spos = (size_t*) malloc(sizeof(size_t) * (n_node + 1));
+    size_t *B_spos = (size_t*) malloc(sizeof(size_t) * (n_B + 1));
+    size_t *D_spos = (size_t*) malloc(sizeof(size_t) * (n_D + 1));
+    ASSERT_PRINTF(U_spos != NULL && B_spos != NULL && D_spos != NULL, "Failed to allocate matrix offset arrays\n");
+    U_spos[0] = 0;
+    B_spos[0] = 0;
+    D_spos[0] = 0;
+    for (int i = 0; i < n_node; i++)
+        U_spos[i + 1] = U_spos[i] + H2P_bin_align(sizeof(DTYPE) * (size_t) U_size[2 * i] * (size_t) U_size[2 * i + 1]);
+    for (int i = 0; i < n_B; i++)
+        B_spos[i + 1] = B_spos[i] + sizeof(DTYPE) * (size_t) B_size[2 * i] * (size_t) B_size[2 * i + 1];
+    for (int i = 0; i < n_D; i++)
+        D_spos[i + 1] = D_spos[i] + sizeof(DTYPE) * (size_t) D_size[2 * i] * (size_t) D_size[2 * i + 1];
+    char *raw_buf[H2P_BIN_N_SEC];
+    memset(raw_buf, 0, sizeof(raw_buf));
+    for (int i = H2P_BIN_SEC_U_DATA; quant_nbits > 0 && i <= H2P_BIN_SEC_D_DATA; i++)
+    {
+        if (sec[i].encoding != H2P_BIN_ENC_QUANT || sec_src[i] != NULL) continue;
+        raw_buf[i] = (char*) malloc(sec[i].raw_nbytes + 1);
+        ASSERT_PRINTF(raw_buf[i] != NULL, "Failed to allocate %" PRIu64 " bytes for encoding\n", sec[i].raw_nbytes);
+    }
+    int n_fail = 0;
+    uint64_t checksum[H2P_BIN_N_SEC];
+    memset(checksum, 0, sizeof(checksum));
+    #pragma omp parallel num_threads(h2pack->n_thread)
+    {
+        int thread_fail = 0;
+        uint64_t thread_checksum[H2P_BIN_N_SEC];
+        memset(thread_checksum, 0, sizeof(thread_checksum));
+        H2P_dense_mat_p tmpM, coord1_s;
+        H2P_dense_mat_init(&tmpM, 64, 64);
+        H2P_dense_mat_init(&coord1_s, h2pack->xpt_dim, 64);
+        uint64_t *enc_buf = NULL;
+        if (quant_nbits > 0)
+        {
+            enc_buf = (uint64_t*) malloc(H2P_bin_quant_nbytes(H2P_BIN_IO_PIECE / sizeof(DTYPE), quant_nbits));
+            ASSERT_PRINTF(enc_buf != NULL, "Failed to allocate encoding buffer\n");
+        }
+
+        // (1) U matrices, each is padded with zeros to an aligned size
+        #pragma omp for schedule(dynamic) nowait
+        for (int node = 0; node < n_node; node++)
+        {
+            H2P_dense_mat_p Ui = h2pack->U[node];
+            size_t nbytes = U_spos[node + 1] - U_spos[node];
+            if (nbytes == 0) continue;
+            H2P_dense_mat_resize(tmpM, 1, (int) (nbytes / sizeof(DTYPE)));
+            memset(tmpM->data, 0, nbytes);
+            copy_matrix_block(sizeof(DTYPE), Ui->nrow, Ui->ncol, Ui->data, Ui->ld, tmpM->data, Ui->ncol);
+            if (raw_buf[H2P_BIN_SEC_U_DATA] != NULL)
             {
-                int pt_s1 = pt_cluster[2 * node1];
-                int pt_e1 = pt_cluster[2 * node1 + 1];
-                node0_npt = J[node0]->length;
-                node1_npt = pt_e1 - pt_s1 + 1;
+                memcpy(raw_buf[H2P_BIN_SEC_U_DATA] + U_spos[node], tmpM->data, nbytes);
+                continue;
             }
-            if (level0 < level1)
+            thread_checksum[H2P_BIN_SEC_U_DATA] += H2P_bin_checksum(tmpM->data, nbytes, U_spos[node]);
+            off_t offset = (off_t) (sec[H2P_BIN_SEC_U_DATA].offset + U_spos[node]);
+            if (H2P_bin_pwrite(fd, tmpM->data, nbytes, offset) != 0) thread_fail++;
+        }
+
+        // (2) B and D matrices are not stored in JIT mode, evaluate them here
+        if (h2pack->BD_JIT == 1)
+        {
+            #pragma omp for schedule(dynamic) nowait
+            for (int k = 0; k < n_B + n_D; k++)
+            {
+                int sec_id;
+                size_t spos, nbytes;
+                if (k < n_B)
+                {
+                    if (is_periodic) H2P_bin_get_periodic_BD_blk(h2pack, 0, k, coord1_s, tmpM);
+                    else H2P_get_Bij_block(h2pack, r_adm_pairs[2 * k], r_adm_pairs[2 * k + 1], tmpM);
+                    sec_id = H2P_BIN_SEC_B_DATA;
+                    spos   = B_spos[k];
+                    nbytes = B_spos[k + 1] - B_spos[k];
+                } else {
+                    int i = k - n_B;
+                    int node0 = (i < n_leaf_node) ? h2pack->height_nodes[i] : r_inadm_pairs[2 * (i - n_leaf_node)];
+                    int node1 = (i < n_leaf_node) ? h2pack->height_nodes[i] : r_inadm_pairs[2 * (i - n_leaf_node) + 1];
+                    if (is_periodic) H2P_bin_get_periodic_BD_blk(h2pack, 1, i, coord1_s, tmpM);
+                    else H2P_get_Dij_block(h2pack, node0, node1, tmpM);
+                    sec_id = H2P_BIN_SEC_D_DATA;
+                    spos   = D_spos[i];
+                    nbytes = D_spos[i + 1] - D_spos[i];
+                }
+                if (sizeof(DTYPE) * (size_t) tmpM->nrow * (size_t) tmpM->ncol != nbytes)
+                {
+                    thread_fail++;
+                    continue;
+                }
+                if (raw_buf[sec_id] != NULL)
+                {
+                    memcpy(raw_buf[sec_id] + spos, tmpM->data, nbytes);
+                    continue;
+                }
+                thread_checksum[sec_id] += H2P_bin_checksum(tmpM->data, nbytes, spos);
+                if (H2P_bin_pwrite(fd, tmpM->data, nbytes, (off_t) (sec[sec_id].offset + spos)) != 0) thread_fail++;
+            }
+        }
+
+        // (3) Sections in memory and gathered sections, written in pieces. Pieces of an 
+        //     encoded section are encoded by each thread before writing. 
+        #pragma omp barrier
+        for (int i = 0; i < H2P_BIN_N_SEC; i++)
+        {
+            const char *src = (raw_buf[i] != NULL) ? raw_buf[i] : (const char*) sec_src[i];
+            if (src == NULL) continue;
+            size_t n_piece = (sec[i].raw_nbytes + H2P_BIN_IO_PIECE - 1) / H2P_BIN_IO_PIECE;
+            #pragma omp for schedule(dynamic) nowait
+            for (size_t j = 0; j < n_piece; j++)
+            {
+                size_t spos   = j * H2P_BIN_IO_PIECE;
+                size_t nbytes = MIN(H2P_BIN_IO_PIECE, sec[i].raw_nbytes - spos);
+                const char *piece = src + spos;
+                if (sec[i].encoding == H2P_BIN_ENC_QUANT)
+                {
+                    H2P_bin_quant_encode((const DTYPE*) piece, nbytes / sizeof(DTYPE), quant_nbits, enc_buf);
+                    spos   = H2P_bin_quant_nbytes(spos   / sizeof(DTYPE), quant_nbits);
+                    nbytes = H2P_bin_quant_nbytes(nbytes / sizeof(DTYPE), quant_nbits);
+                    piece  = (const char*) enc_buf;
+                }
+                thread_checksum[i] += H2P_bin_checksum(piece, nbytes, spos);
+                if (H2P_bin_pwrite(fd, piece, nbytes, (off_t) (sec[i].offset + spos)) != 0) thread_fail++;
+            }
+        }
+
+        free(enc_buf);
+        H2P_dense_mat_destroy(&tmpM);
+        H2P_dense_mat_destroy(&coord1_s);
+        #pragma omp critical
+        {
+            for (int i = 0; i < H2P_BIN_N_SEC; i++) checksum[i] += thread_checksum[i];
+            n_fail += thread_fail;
+        }
+    }  // End of "#pragma omp parallel"
+
+    // 4. Write the header and the section table
+    for (int i = 0; i < H2P_BIN_N_SEC; i++) sec[i].checksum = checksum[i];
+    if (H2P_bin_pwrite(fd, &header, sizeof(header), 0) != 0) n_fail++;
+    if (H2P_bin_pwrite(fd, sec, sizeof(sec), (off_t) header.sec_table_offset) != 0) n_fail++;
+    if (ftruncate(fd, (off_t) header.file_size) != 0) n_fail++;
+    if (close(fd) != 0) n_fail++;
+    if (n_fail > 0) ERROR_PRINTF("Failed to write H2 representation to file %s\n", binary_fname);
+
+    for (int i = 0; i < H2P_BIN_N_SEC; i++) free(raw_buf[i]);
+    free(U_spos);
+    free(B_spos);
+    free(D_spos);
+    free(tree);
+    free(pairs);
+    free(skel);
+    free(U_size);
+    free(B_size);
+    free(D_size);
+    free(krnl_param);
+}
+
+void H2P_store_to_binary_file(H2Pack_p h2pack, const char *binary_fname)
+{
+    H2P_store_binary_file(h2pack, binary_fname, 0, 0);
+}
+
+void H2P_store_to_compressed_binary_file(H2Pack_p h2pack, const char *binary_fname, const DTYPE quant_reltol)
+{
+    double reltol = (double) quant_reltol;
+    // Quantization errors of U, B, and D add up in a matvec, an element-wise bound of 
+    // 0.1 * QR_stop_tol gives matvec errors up to about QR_stop_tol, 0.01 * QR_stop_tol 
+    // keeps them below 0.1 * QR_stop_tol for about 3.3 more bits per value
+    if (reltol <= 0.0 && h2pack->QR_stop_type == QR_REL_NRM) reltol = 0.01 * (double) h2pack->QR_stop_tol;
+    if (reltol <= 0.0)
+    {
+        ERROR_PRINTF("Need a positive quant_reltol if the QR stop type is not QR_REL_NRM\n");
+        return;
+    }
+    // Quantization does not save space if the bound needs as many bits as DTYPE
+    int quant_nbits = H2P_bin_quant_nbits(reltol);
+    if (quant_nbits >= (int) (8 * sizeof(DTYPE))) quant_nbits = 0;
+    H2P_store_binary_file(h2pack, binary_fname, quant_nbits, 0);
+}
+
+void H2P_store_to_shm(H2Pack_p h2pack, const char *shm_name)
+{
+    H2P_store_binary_file(h2pack, shm_name, 0, 1);
+}
+
+int H2P_unlink_shm(const char *shm_name)
+{
+    return (shm_unlink(shm_name) == 0) ? 0 : -1;
+}
+
+// Read and check the header of a binary H2 file
+// Input parameter:
+//   fd : File descriptor of the binary file
+// Output parameters:
+//   header   : File header
+//   <return> : NULL if succeeded, otherwise the error message
+static const char *H2P_bin_read_header(const int fd, H2P_bin_header_s *header)
+{
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || H2P_bin_pread(fd, header, sizeof(H2P_bin_header_s), 0) != 0 ||
+        memcmp(header->magic, H2P_BIN_FILE_MAGIC, 8) != 0) return "not a H2Pack binary file";
+    if (header->version < H2P_BIN_MIN_VERSION || header->version > H2P_BIN_FILE_VERSION) return "unsupported file version";
+    if (header->endian_tag != H2P_BIN_ENDIAN_TAG)   return "different byte order";
+    if (header->dtype_size != sizeof(DTYPE))        return "DTYPE size mismatch";
+    if (header->file_size  != (uint64_t) file_stat.st_size || header->n_section > H2P_BIN_MAX_SECTION)
+        return "truncated or corrupted";
+    return NULL;
+}
+
+// Read and check an entry of the section table of a binary H2 file
+// Input parameters:
+//   fd     : File descriptor of the binary file
+//   header : File header
+//   i      : Index of the entry in the section table
+// Output parameters:
+//   sec      : Section table entry
+//   <return> : 0 if succeeded, -1 if failed
+static int H2P_bin_read_section_entry(
+    const int fd, const H2P_bin_header_s *header, const uint32_t i, H2P_bin_section_s *sec
+)
+{
+    off_t entry_offset = (off_t) (header->sec_table_offset + i * sizeof(H2P_bin_section_s));
+    if (H2P_bin_pread(fd, sec, sizeof(H2P_bin_section_s), entry_offset) != 0) return -1;
+    if (sec->offset % H2P_BIN_ALIGN != 0 || sec->offset == 0 || sec->offset > header->file_size ||
+        sec->nbytes > header->file_size - sec->offset || sec->nbytes % 4 != 0) return -1;
+    if (sec->encoding == H2P_BIN_ENC_RAW && sec->raw_nbytes == sec->nbytes) return 0;
+    if (sec->encoding == H2P_BIN_ENC_QUANT && sec->elem_size == sizeof(DTYPE) && 
+        sec->enc_nbits >= 2 && sec->enc_nbits < 8 * sizeof(DTYPE) && sec->raw_nbytes % sizeof(DTYPE) == 0 &&
+        sec->nbytes == H2P_bin_quant_nbytes(sec->raw_nbytes / sizeof(DTYPE), sec->enc_nbits)) return 0;
+    return -1;
+}
+
+// Read a section of a binary H2 file, from the file mapping if map != NULL. 
+// The checksum is verified if the whole section is read. The section should 
+// not be encoded. 
+// Input parameters:
+//   fd     : File descriptor of the binary file
+//   map    : Mapping of the whole file, can be NULL
+//   sec    : Section table entry
+//   nbytes : Number of bytes to read from the start of the section
+// Output parameters:
+//   dst      : Size >= nbytes, section payload
+//   <return> : 0 if succeeded, -1 if failed or the checksum mismatches
+static int H2P_bin_read_section(
+    const int fd, const char *map, const H2P_bin_section_s *sec, const size_t nbytes, void *dst
+)
+{
+    if (nbytes > sec->nbytes || sec->encoding != H2P_BIN_ENC_RAW) return -1;
+    if (map != NULL) memcpy(dst, map + sec->offset, nbytes);
+    else if (H2P_bin_pread(fd, dst, nbytes, (off_t) sec->offset) != 0) return -1;
+    if (nbytes == sec->nbytes && H2P_bin_checksum(dst, nbytes, 0) != sec->checksum) return -1;
+    return 0;
+}
+
+// Read a whole section of a binary H2 file in pieces using multiple threads, 
+// verify its checksum, and decode it if it is encoded
+// Input parameters:
+//   fd       : File descriptor of the binary file
+//   sec      : Section table entry
+//   n_thread : Number of threads to use
+// Output parameters:
+//   dst      : Size >= sec->raw_nbytes, decoded section payload. If dst == NULL, 
+//              the section is only verified.
+//   <return> : 0 if succeeded, -1 if failed or the checksum mismatches
+static int H2P_bin_read_section_par(const int fd, const H2P_bin_section_s *sec, const int n_thread, void *dst)
+{
+    int    is_quant = (sec->encoding == H2P_BIN_ENC_QUANT);
+    int    nbits    = (int) sec->enc_nbits;
+    size_t n_piece  = (sec->raw_nbytes + H2P_BIN_IO_PIECE - 1) / H2P_BIN_IO_PIECE;
+    int n_fail = 0;
+    uint64_t checksum = 0;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int thread_fail = 0;
+        uint64_t thread_checksum = 0;
+        char *buf = NULL;
+        if (dst == NULL || is_quant)
+        {
+            buf = (char*) malloc(is_quant ? H2P_bin_quant_nbytes(H2P_BIN_IO_PIECE / sizeof(DTYPE), nbits) : H2P_BIN_IO_PIECE);
+            if (buf == NULL) thread_fail++;
+        }
+        #pragma omp for schedule(dynamic)
+        for (size_t j = 0; j < n_piece; j++)
+        {
+            if (thread_fail > 0) continue;
+            size_t raw_spos   = j * H2P_BIN_IO_PIECE;
+            size_t raw_nbytes = MIN(H2P_BIN_IO_PIECE, sec->raw_nbytes - raw_spos);
+            size_t spos   = is_quant ? H2P_bin_quant_nbytes(raw_spos   / sizeof(DTYPE), nbits) : raw_spos;
+            size_t nbytes = is_quant ? H2P_bin_quant_nbytes(raw_nbytes / sizeof(DTYPE), nbits) : raw_nbytes;
+            char   *piece = (buf != NULL) ? buf : (char*) dst + raw_spos;
+            if (H2P_bin_pread(fd, piece, nbytes, (off_t) (sec->offset + spos)) != 0)
+            {
+                thread_fail++;
+                continue;
+            }
+            thread_checksum += H2P_bin_checksum(piece, nbytes, spos);
+            if (is_quant && dst != NULL)
+                H2P_bin_quant_decode((const uint64_t*) piece, raw_nbytes / sizeof(DTYPE), nbits, (DTYPE*) ((char*) dst + raw_spos));
+        }
+        free(buf);
+        #pragma omp critical
+        {
+            checksum += thread_checksum;
+            n_fail   += thread_fail;
+        }
+    }
+    return (n_fail == 0 && checksum == sec->checksum) ? 0 : -1;
+}
+
+// Split out-of-core B and D matrices into task blocks and streaming chunks
+// Input parameters:
+//   h2pack        : H2Pack structure loaded by H2P_load_binary_file() in out-of-core mode
+//   ooc_buf_bytes : Memory budget (in bytes) of the two streaming buffers
+// Output parameter:
+//   h2pack : H2Pack structure with B_blk, D_blk0, D_blk1, ooc_B_chunk, ooc_D_chunk, and ooc_buf
+static void H2P_ooc_setup(H2Pack_p h2pack, const size_t ooc_buf_bytes)
+{
+    int    n_thread    = h2pack->n_thread;
+    int    n_B         = h2pack->n_B;
+    int    n_D         = h2pack->n_D;
+    int    n_leaf_node = h2pack->n_leaf_node;
+    size_t *B_ptr      = h2pack->B_ptr;
+    size_t *D_ptr      = h2pack->D_ptr;
+
+    // 1. Repartition task blocks, each chunk should have multiple task blocks for each thread
+    size_t *work_sizes = (size_t*) malloc(sizeof(size_t) * (MAX(n_B, n_D) + 1));
+    ASSERT_PRINTF(work_sizes != NULL, "Failed to allocate work buffer for out-of-core partitioning\n");
+    size_t buf_size = MAX(ooc_buf_bytes / (2 * sizeof(DTYPE)), 1);
+    size_t blk_size = MAX(buf_size / (size_t) (4 * n_thread), 1);
+    for (int i = 0; i < n_B; i++) work_sizes[i] = B_ptr[i + 1] - B_ptr[i];
+    int n_blk = (int) MIN(B_ptr[n_B] / blk_size + 1, (size_t) n_B + 1);
+    H2P_partition_workload(n_B, work_sizes, B_ptr[n_B], n_blk, h2pack->B_blk);
+    for (int i = 0; i < n_D; i++) work_sizes[i] = D_ptr[i + 1] - D_ptr[i];
+    n_blk = (int) MIN(D_ptr[n_leaf_node] / blk_size + 1, (size_t) n_leaf_node + 1);
+    H2P_partition_workload(n_leaf_node, work_sizes, D_ptr[n_leaf_node], n_blk, h2pack->D_blk0);
+    n_blk = (int) MIN((D_ptr[n_D] - D_ptr[n_leaf_node]) / blk_size + 1, (size_t) (n_D - n_leaf_node) + 1);
+    H2P_partition_workload(
+        n_D - n_leaf_node, work_sizes + n_leaf_node, D_ptr[n_D] - D_ptr[n_leaf_node], 
+        n_blk, h2pack->D_blk1
+    );
+    free(work_sizes);
+
+    // 2. Each buffer holds at least the largest task block
+    int n_B_blk  = h2pack->B_blk->length  - 1;
+    int n_D_blk  = h2pack->D_blk0->length + h2pack->D_blk1->length - 2;
+    for (int i_blk = 0; i_blk < n_B_blk; i_blk++)
+        buf_size = MAX(buf_size, H2P_ooc_blk_spos(h2pack, 0, i_blk + 1) - H2P_ooc_blk_spos(h2pack, 0, i_blk));
+    for (int i_blk = 0; i_blk < n_D_blk; i_blk++)
+        buf_size = MAX(buf_size, H2P_ooc_blk_spos(h2pack, 1, i_blk + 1) - H2P_ooc_blk_spos(h2pack, 1, i_blk));
+
+    // 3. Group consecutive task blocks into chunks that fit in a buffer. Task blocks are 
+    //    contiguous in the file, so each chunk is read with one request. 
+    H2P_int_vec_init(&h2pack->ooc_B_chunk, n_B_blk + 1);
+    H2P_int_vec_init(&h2pack->ooc_D_chunk, n_D_blk + 1);
+    for (int is_D = 0; is_D <= 1; is_D++)
+    {
+        H2P_int_vec_p chunk = is_D ? h2pack->ooc_D_chunk : h2pack->ooc_B_chunk;
+        int n_task_blk = is_D ? n_D_blk : n_B_blk;
+        int chunk_sblk = 0;
+        chunk->data[0] = 0;
+        chunk->length  = 1;
+        for (int i_blk = 1; i_blk <= n_task_blk; i_blk++)
+        {
+            size_t chunk_size = H2P_ooc_blk_spos(h2pack, is_D, i_blk) - H2P_ooc_blk_spos(h2pack, is_D, chunk_sblk);
+            if (chunk_size > buf_size)
             {
-                int pt_s0 = pt_cluster[2 * node0];
-                int pt_e0 = pt_cluster[2 * node0 + 1];
-                node0_npt = pt_e0 - pt_s0 + 1;
-                node1_npt = J[node1]->length;
+                chunk_sblk = i_blk - 1;
+                chunk->data[chunk->length++] = chunk_sblk;
             }
-            JIT_flops[JIT_B_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node0_npt * node1_npt);
         }
+        if (n_task_blk > 0) chunk->data[chunk->length++] = n_task_blk;
     }
-    
-    int BD_ntask_thread = (h2pack->BD_JIT == 1) ? BD_NTASK_THREAD : 1;
-    int n_B_blk = h2pack->n_thread * BD_ntask_thread;
-    H2P_partition_workload(input_n_r_adm_pair, B_ptr + 1, B_total_size, n_B_blk, h2pack->B_blk);
-    for (int i = 1; i <= input_n_r_adm_pair; i++) B_ptr[i] += B_ptr[i - 1];
-    mat_size[B_SIZE_IDX] = B_total_size;
 
-    h2pack->B_p2i_rowptr = (int*) malloc(sizeof(int) * (n_node + 1));
-    h2pack->B_p2i_colidx = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
-    h2pack->B_p2i_val    = (int*) malloc(sizeof(int) * input_n_r_adm_pair * 2);
-    ASSERT_PRINTF(h2pack->B_p2i_rowptr != NULL, "Failed to allocate arrays for B matrices indexing\n");
-    ASSERT_PRINTF(h2pack->B_p2i_colidx != NULL, "Failed to allocate arrays for B matrices indexing\n");
-    ASSERT_PRINTF(h2pack->B_p2i_val    != NULL, "Failed to allocate arrays for B matrices indexing\n");
-    H2P_int_COO_to_CSR(
-        n_node, B_pair_cnt, B_pair_i, B_pair_j, B_pair_v, 
-        h2pack->B_p2i_rowptr, h2pack->B_p2i_colidx, h2pack->B_p2i_val
-    );
-    free(B_pair_i);
-    free(B_pair_j);
-    free(B_pair_v);
+    h2pack->ooc_buf_size = buf_size;
+    h2pack->ooc_buf = (DTYPE*) malloc_aligned(sizeof(DTYPE) * 2 * buf_size, 64);
+    ASSERT_PRINTF(h2pack->ooc_buf != NULL, "Failed to allocate out-of-core buffers of size 2 * %zu\n", buf_size);
+}
 
-    // 11. Post-processing of D matrices
-    int D_pair_cnt = 0;
-    int n_Dij_pair = n_leaf_node + 2 * input_n_r_inadm_pair;
-    int *D_pair_i  = (int*) malloc(sizeof(int) * n_Dij_pair);
-    int *D_pair_j  = (int*) malloc(sizeof(int) * n_Dij_pair);
-    int *D_pair_v  = (int*) malloc(sizeof(int) * n_Dij_pair);
-    ASSERT_PRINTF(
-        D_pair_i != NULL && D_pair_j != NULL && D_pair_v != NULL,
-        "Failed to allocate working buffer for D matrices indexing\n"
-    );
+// Load a H2 representation from a binary file, shared by H2P_read_from_binary_file(),
+// H2P_load_mmap(), H2P_load_out_of_core(), and H2P_attach_shm(). Input and output 
+// parameters are the same as H2P_read_from_binary_file() and H2P_load_out_of_core(), 
+// load_mode is one of H2P_BIN_LOAD_READ, H2P_BIN_LOAD_MMAP, H2P_BIN_LOAD_OOC, and 
+// H2P_BIN_LOAD_SHM (binary_fname is a shared memory object name in this mode). krnl_mv 
+// is only used by a periodic H2 matrix, krnl_bimv_flops is the flops of krnl_mv in this case.
+static int H2P_load_binary_file(
+    H2Pack_p *h2pack_, const char *binary_fname, const int load_mode, const int BD_JIT, 
+    const size_t ooc_buf_bytes, void *krnl_param, kernel_eval_fptr krnl_eval, 
+    kernel_bimv_fptr krnl_bimv, kernel_mv_fptr krnl_mv, const int krnl_bimv_flops
+)
+{
+    *h2pack_ = NULL;
+    int fd = (load_mode == H2P_BIN_LOAD_SHM) ? shm_open(binary_fname, O_RDONLY, 0) : open(binary_fname, O_RDONLY);
+    if (fd < 0)
+    {
+        ERROR_PRINTF("Cannot open binary data file %s\n", binary_fname);
+        return -1;
+    }
 
-    for (int i = 0; i < n_leaf_node; i++)
+    // 1. Header and section table
+    H2P_bin_header_s header;
+    H2P_bin_section_s sec_tab_entry, sec[H2P_BIN_N_SEC];
+    memset(sec, 0, sizeof(sec));
+    const char *errmsg = H2P_bin_read_header(fd, &header);
+    for (uint32_t i = 0; errmsg == NULL && i < header.n_section; i++)
     {
-        int node = leaf_nodes[i];
-        int pt_s = pt_cluster[2 * node];
-        int pt_e = pt_cluster[2 * node + 1];
-        int node_npt = pt_e - pt_s + 1;
-        D_pair_i[D_pair_cnt] = node;
-        D_pair_j[D_pair_cnt] = node;
-        D_pair_v[D_pair_cnt] = i + 1;
-        D_pair_cnt++;
-        mat_size[MV_DEN_SIZE_IDX] += D_nrow[i] * D_ncol[i];
-        mat_size[MV_DEN_SIZE_IDX] += D_nrow[i] + D_ncol[i];
-        if (h2pack->BD_JIT) JIT_flops[JIT_D_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node_npt * node_npt);
+        if (H2P_bin_read_section_entry(fd, &header, i, &sec_tab_entry) != 0)
+        {
+            errmsg = "invalid section table";
+            break;
+        }
+        if (sec_tab_entry.id >= H2P_BIN_N_SEC) continue;
+        if (sec[sec_tab_entry.id].offset != 0)
+        {
+            errmsg = "invalid section table";
+            break;
+        }
+        sec[sec_tab_entry.id] = sec_tab_entry;
     }
-    for (int i = 0; i < input_n_r_inadm_pair; i++)
+    for (int i = 0; errmsg == NULL && i < H2P_BIN_SEC_PER_LAT; i++)
+        if (sec[i].offset == 0) errmsg = "missing section";
+    if (errmsg != NULL)
     {
-        int ii = i + n_leaf_node;
-        int node0 = input_r_inadm_pairs[2 * i];
-        int node1 = input_r_inadm_pairs[2 * i + 1];
-        int pt_s0 = pt_cluster[2 * node0];
-        int pt_s1 = pt_cluster[2 * node1];
-        int pt_e0 = pt_cluster[2 * node0 + 1];
-        int pt_e1 = pt_cluster[2 * node1 + 1];
-        int node0_npt = pt_e0 - pt_s0 + 1;
-        int node1_npt = pt_e1 - pt_s1 + 1;
-        D_pair_i[D_pair_cnt] = node0;
-        D_pair_j[D_pair_cnt] = node1;
-        D_pair_v[D_pair_cnt] = ii + 1;
-        D_pair_cnt++;
-        D_pair_i[D_pair_cnt] = node1;
-        D_pair_j[D_pair_cnt] = node0;
-        D_pair_v[D_pair_cnt] = -(ii + 1);
-        D_pair_cnt++;
-        mat_size[MV_DEN_SIZE_IDX] +=  D_nrow[ii] * D_ncol[ii];
-        mat_size[MV_DEN_SIZE_IDX] += (D_nrow[ii] + D_ncol[ii]);
-        mat_size[MV_DEN_SIZE_IDX] += (D_nrow[ii] + D_ncol[ii]);
-        if (h2pack->BD_JIT) JIT_flops[JIT_D_FLOPS_IDX] += (double)(krnl_bimv_flops) * (double)(node0_npt * node1_npt);
+        ERROR_PRINTF("Cannot load %s: %s\n", binary_fname, errmsg);
+        close(fd);
+        return -1;
     }
 
-    int D_n_blk = h2pack->n_thread * BD_ntask_thread;
-    H2P_partition_workload(n_leaf_node,          D_ptr + 1,               D0_total_size, D_n_blk, h2pack->D_blk0);
-    H2P_partition_workload(input_n_r_inadm_pair, D_ptr + n_leaf_node + 1, D1_total_size, D_n_blk, h2pack->D_blk1);
-    for (int i = 1; i <= n_leaf_node + input_n_r_inadm_pair; i++) D_ptr[i] += D_ptr[i - 1];
-    mat_size[D_SIZE_IDX] = D_total_size;
+    char *map = NULL;
+    if (load_mode == H2P_BIN_LOAD_MMAP || load_mode == H2P_BIN_LOAD_SHM)
+    {
+        map = (char*) mmap(NULL, header.file_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ERROR_PRINTF("Cannot map binary data file %s\n", binary_fname);
+            close(fd);
+            return -1;
+        }
+    }
 
-    h2pack->D_p2i_rowptr = (int*) malloc(sizeof(int) * (n_node + 1));
-    h2pack->D_p2i_colidx = (int*) malloc(sizeof(int) * n_Dij_pair);
-    h2pack->D_p2i_val    = (int*) malloc(sizeof(int) * n_Dij_pair);
-    ASSERT_PRINTF(h2pack->D_p2i_rowptr != NULL, "Failed to allocate arrays for D matrices indexing\n");
-    ASSERT_PRINTF(h2pack->D_p2i_colidx != NULL, "Failed to allocate arrays for D matrices indexing\n");
-    ASSERT_PRINTF(h2pack->D_p2i_val    != NULL, "Failed to allocate arrays for D matrices indexing\n");
-    H2P_int_COO_to_CSR(
-        n_node, D_pair_cnt, D_pair_i, D_pair_j, D_pair_v, 
-        h2pack->D_p2i_rowptr, h2pack->D_p2i_colidx, h2pack->D_p2i_val
+    // 2. Metadata and index arrays, metadata added after version 3 are 0 in older files
+    int64_t meta[H2P_BIN_N_META];
+    double QR_stop_tol = 0;
+    memset(meta, 0, sizeof(meta));
+    size_t meta_nbytes = MIN(sizeof(meta), sec[H2P_BIN_SEC_META].nbytes);
+    int is_valid = (meta_nbytes >= sizeof(int64_t) * H2P_BIN_META_IS_RPY) && 
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_META], meta_nbytes, meta) == 0);
+    memcpy(&QR_stop_tol, &meta[H2P_BIN_META_QR_STOP_TOL], sizeof(double));
+    int pt_dim         = (int) meta[H2P_BIN_META_PT_DIM];
+    int xpt_dim        = (int) meta[H2P_BIN_META_XPT_DIM];
+    int krnl_dim       = (int) meta[H2P_BIN_META_KRNL_DIM];
+    int n_point        = (int) meta[H2P_BIN_META_N_POINT];
+    int n_node         = (int) meta[H2P_BIN_META_N_NODE];
+    int max_level      = (int) meta[H2P_BIN_META_MAX_LEVEL];
+    int max_child      = (int) meta[H2P_BIN_META_MAX_CHILD];
+    int n_leaf_node    = (int) meta[H2P_BIN_META_N_LEAF_NODE];
+    int n_r_adm_pair   = (int) meta[H2P_BIN_META_N_R_ADM_PAIR];
+    int n_r_inadm_pair = (int) meta[H2P_BIN_META_N_R_INADM_PAIR];
+    int n_D            = n_leaf_node + n_r_inadm_pair;
+    int is_periodic    = (meta[H2P_BIN_META_IS_PERIODIC] == 1);
+    int n_lattice      = (int) meta[H2P_BIN_META_N_LATTICE];
+    int per_blk_rank   = (int) meta[H2P_BIN_META_PER_BLK_RANK];
+    size_t krnl_param_bytes = (size_t) meta[H2P_BIN_META_KRNL_PARAM_BYTES];
+    if (is_valid)
+    {
+        is_valid = (pt_dim >= 1) && (pt_dim <= 3) && (xpt_dim >= pt_dim) && (xpt_dim <= 8) && (krnl_dim >= 1) && (n_point >= 1) &&
+                   (meta[H2P_BIN_META_KRNL_MAT_SIZE] == (int64_t) n_point * krnl_dim) &&
+                   (n_node >= 1) && (meta[H2P_BIN_META_ROOT_IDX] == n_node - 1) && (max_level >= 0) &&
+                   (max_child == H2P_MAX_CHILD(pt_dim)) && (n_leaf_node >= 1) && (n_leaf_node <= n_node) &&
+                   (n_r_adm_pair >= 0) && (n_r_inadm_pair >= 0) && (meta[H2P_BIN_META_IS_PERIODIC] >= 0) &&
+                   (meta[H2P_BIN_META_IS_PERIODIC] <= 1) && (meta[H2P_BIN_META_KRNL_PARAM_BYTES] >= 0) &&
+                   (sec[H2P_BIN_SEC_KRNL_PARAM].nbytes == (krnl_param_bytes + 3) / 4 * 4);
+    }
+    size_t tree_size  = (size_t) n_node * (4 + max_child);
+    size_t pairs_size = (size_t) 2 * (n_r_adm_pair + n_r_inadm_pair) + n_leaf_node;
+    int *tree = NULL, *pairs = NULL, *perm = NULL, *skel = NULL, *U_size = NULL, *B_size = NULL, *D_size = NULL;
+    if (is_valid)
+    {
+        tree   = (int*) malloc(sizeof(int) * tree_size);
+        pairs  = (int*) malloc(sizeof(int) * pairs_size);
+        perm   = (int*) malloc(sizeof(int) * n_point);
+        skel   = (int*) malloc(sec[H2P_BIN_SEC_SKEL].nbytes + sizeof(int));
+        U_size = (int*) malloc(sizeof(int) * 2 * n_node);
+        B_size = (int*) malloc(sizeof(int) * 2 * (n_r_adm_pair + 1));
+        D_size = (int*) malloc(sizeof(int) * 2 * n_D);
+        ASSERT_PRINTF(
+            tree != NULL && pairs != NULL && perm != NULL && skel != NULL &&
+            U_size != NULL && B_size != NULL && D_size != NULL,
+            "Failed to allocate binary file index arrays\n"
+        );
+        is_valid = (sec[H2P_BIN_SEC_TREE  ].nbytes == sizeof(int) * tree_size) &&
+                   (sec[H2P_BIN_SEC_ENBOX ].nbytes == sizeof(DTYPE) * n_node * 2 * pt_dim) &&
+                   (sec[H2P_BIN_SEC_PAIRS ].nbytes == sizeof(int) * pairs_size) &&
+                   (sec[H2P_BIN_SEC_PERM  ].nbytes == sizeof(int) * n_point) &&
+                   (sec[H2P_BIN_SEC_COORD ].nbytes == sizeof(DTYPE) * n_point * xpt_dim) &&
+                   (sec[H2P_BIN_SEC_SKEL  ].nbytes >= sizeof(int) * n_node) &&
+                   (sec[H2P_BIN_SEC_U_SIZE].nbytes == sizeof(int) * 2 * n_node) &&
+                   (sec[H2P_BIN_SEC_B_SIZE].nbytes == sizeof(int) * 2 * n_r_adm_pair) &&
+                   (sec[H2P_BIN_SEC_D_SIZE].nbytes == sizeof(int) * 2 * n_D);
+    }
+    if (is_valid)
+    {
+        is_valid = (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_TREE  ], sec[H2P_BIN_SEC_TREE  ].nbytes, tree)   == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_PAIRS ], sec[H2P_BIN_SEC_PAIRS ].nbytes, pairs)  == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_PERM  ], sec[H2P_BIN_SEC_PERM  ].nbytes, perm)   == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_SKEL  ], sec[H2P_BIN_SEC_SKEL  ].nbytes, skel)   == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_U_SIZE], sec[H2P_BIN_SEC_U_SIZE].nbytes, U_size) == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_B_SIZE], sec[H2P_BIN_SEC_B_SIZE].nbytes, B_size) == 0) &&
+                   (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_D_SIZE], sec[H2P_BIN_SEC_D_SIZE].nbytes, D_size) == 0);
+    }
+
+    // 3. Check all indices and sizes, so a corrupted file cannot crash the program later
+    size_t B_total_size = 0, D0_total_size = 0, D1_total_size = 0, skel_total = n_node;
+    int *node_level = tree, *pt_cluster = tree + n_node, *n_child = tree + 3 * n_node, *children = tree + 4 * n_node;
+    for (int i = 0; is_valid && i < n_node; i++)
+    {
+        if (node_level[i] < 0 || node_level[i] > max_level || n_child[i] < 0 || n_child[i] > max_child ||
+            pt_cluster[2 * i] < 0 || pt_cluster[2 * i + 1] >= n_point || pt_cluster[2 * i] > pt_cluster[2 * i + 1] + 1) is_valid = 0;
+        for (int j = 0; is_valid && j < n_child[i]; j++)
+            if (children[i * max_child + j] < 0 || children[i * max_child + j] >= n_node) is_valid = 0;
+        if (U_size[2 * i] < 0 || U_size[2 * i + 1] < 0 || skel[i] < 0 || skel[i] > n_point) is_valid = 0;
+        skel_total += (size_t) MAX(skel[i], 0);
+    }
+    if (is_valid && sec[H2P_BIN_SEC_SKEL].nbytes != sizeof(int) * skel_total) is_valid = 0;
+    for (size_t i = n_node; is_valid && i < skel_total; i++)
+        if (skel[i] < 0 || skel[i] >= n_point) is_valid = 0;
+    for (size_t i = 0; is_valid && i < pairs_size; i++)
+        if (pairs[i] < 0 || pairs[i] >= n_node) is_valid = 0;
+    for (int i = 0; is_valid && i < n_point; i++)
+        if (perm[i] < 0 || perm[i] >= n_point) is_valid = 0;
+    for (int i = 0; is_valid && i < n_r_adm_pair; i++)
+    {
+        if (B_size[2 * i] < 0 || B_size[2 * i + 1] < 0) is_valid = 0;
+        B_total_size += (size_t) B_size[2 * i] * (size_t) B_size[2 * i + 1];
+    }
+    for (int i = 0; is_valid && i < n_D; i++)
+    {
+        if (D_size[2 * i] < 0 || D_size[2 * i + 1] < 0) is_valid = 0;
+        size_t Di_size = (size_t) D_size[2 * i] * (size_t) D_size[2 * i + 1];
+        if (i < n_leaf_node) D0_total_size += Di_size;
+        else D1_total_size += Di_size;
+    }
+    if (is_valid)
+    {
+        is_valid = (sec[H2P_BIN_SEC_U_DATA].raw_nbytes == H2P_bin_U_data_nbytes(n_node, U_size)) &&
+                   (sec[H2P_BIN_SEC_B_DATA].raw_nbytes == sizeof(DTYPE) * B_total_size) &&
+                   (sec[H2P_BIN_SEC_D_DATA].raw_nbytes == sizeof(DTYPE) * (D0_total_size + D1_total_size));
+    }
+    size_t per_blk_size = 0;
+    if (is_valid && is_periodic)
+    {
+        size_t root_size = (size_t) skel[n_node - 1] * (size_t) krnl_dim;
+        per_blk_size = root_size * root_size;
+        is_valid = (meta[H2P_BIN_META_IS_HSS] == 0) && (meta[H2P_BIN_META_IS_RPY] == 0) && 
+                   (n_lattice >= 1) && (per_blk_rank == -1) &&
+                   (sec[H2P_BIN_SEC_PER_LAT  ].nbytes == sizeof(DTYPE) * (size_t) n_lattice * pt_dim) &&
+                   (sec[H2P_BIN_SEC_PER_ADM  ].nbytes == sizeof(DTYPE) * (size_t) n_r_adm_pair * pt_dim) &&
+                   (sec[H2P_BIN_SEC_PER_INADM].nbytes == sizeof(DTYPE) * (size_t) n_r_inadm_pair * pt_dim) &&
+                   (sec[H2P_BIN_SEC_PER_BLK  ].nbytes == sizeof(DTYPE) * per_blk_size);
+    }
+    int BD_quant = (sec[H2P_BIN_SEC_B_DATA].encoding != H2P_BIN_ENC_RAW) || 
+                   (sec[H2P_BIN_SEC_D_DATA].encoding != H2P_BIN_ENC_RAW);
+    if (!is_valid) errmsg = "truncated or corrupted";
+    else if (load_mode == H2P_BIN_LOAD_OOC && BD_quant) errmsg = "B and D matrices are encoded, cannot load out-of-core";
+    else if (load_mode == H2P_BIN_LOAD_OOC && is_periodic) errmsg = "periodic H2 matrix cannot be loaded out-of-core";
+    if (errmsg != NULL)
+    {
+        ERROR_PRINTF("Cannot load %s: %s\n", binary_fname, errmsg);
+        free(tree);
+        free(pairs);
+        free(perm);
+        free(skel);
+        free(U_size);
+        free(B_size);
+        free(D_size);
+        if (map != NULL) munmap(map, header.file_size);
+        close(fd);
+        return -1;
+    }
+
+    // 4. Metadata and partitioning tree
+    H2Pack_p h2pack;
+    DTYPE reltol = (DTYPE) QR_stop_tol;
+    H2P_init(&h2pack, pt_dim, krnl_dim, QR_REL_NRM, &reltol);
+    h2pack->xpt_dim         = xpt_dim;
+    h2pack->n_point         = n_point;
+    h2pack->krnl_mat_size   = n_point * krnl_dim;
+    h2pack->n_node          = n_node;
+    h2pack->root_idx        = n_node - 1;
+    h2pack->max_level       = max_level;
+    h2pack->n_leaf_node     = n_leaf_node;
+    h2pack->max_leaf_points = (int) meta[H2P_BIN_META_MAX_LEAF_POINTS];
+    h2pack->is_HSS          = (int) meta[H2P_BIN_META_IS_HSS];
+    h2pack->is_RPY          = (int) meta[H2P_BIN_META_IS_RPY];
+    h2pack->is_RPY_Ewald    = is_periodic;
+    h2pack->krnl_param      = krnl_param;
+    h2pack->krnl_eval       = krnl_eval;
+    h2pack->krnl_bimv       = krnl_bimv;
+    h2pack->krnl_bimv_flops = krnl_bimv_flops;
+    h2pack->BD_JIT          = (BD_JIT == 1 && krnl_eval != NULL && krnl_bimv != NULL) ? 1 : 0;
+    if (is_periodic)
+    {
+        // Periodic matvec evaluates B and D with krnl_mv, or krnl_eval if krnl_mv == NULL
+        h2pack->krnl_bimv       = NULL;
+        h2pack->krnl_mv         = krnl_mv;
+        h2pack->krnl_bimv_flops = krnl_bimv_flops - 2;
+        h2pack->BD_JIT          = (BD_JIT == 1 && krnl_eval != NULL) ? 1 : 0;
+    }
+    if (load_mode == H2P_BIN_LOAD_OOC) h2pack->BD_JIT = 0;
+    int *r_adm_pairs   = (int*) malloc(sizeof(int) * (2 * n_r_adm_pair   + 1));
+    int *r_inadm_pairs = (int*) malloc(sizeof(int) * (2 * n_r_inadm_pair + 1));
+    ASSERT_PRINTF(r_adm_pairs != NULL && r_inadm_pairs != NULL, "Failed to allocate reduced pair arrays\n");
+    memcpy(r_adm_pairs,   pairs, sizeof(int) * 2 * n_r_adm_pair);
+    memcpy(r_inadm_pairs, pairs + 2 * n_r_adm_pair, sizeof(int) * 2 * n_r_inadm_pair);
+    if (h2pack->is_HSS)
+    {
+        h2pack->HSS_min_adm_level  = (int) meta[H2P_BIN_META_MIN_ADM_LEVEL];
+        h2pack->HSS_n_r_adm_pair   = n_r_adm_pair;
+        h2pack->HSS_n_r_inadm_pair = n_r_inadm_pair;
+        h2pack->HSS_r_adm_pairs    = r_adm_pairs;
+        h2pack->HSS_r_inadm_pairs  = r_inadm_pairs;
+    } else {
+        h2pack->min_adm_level  = (int) meta[H2P_BIN_META_MIN_ADM_LEVEL];
+        h2pack->n_r_adm_pair   = n_r_adm_pair;
+        h2pack->n_r_inadm_pair = n_r_inadm_pair;
+        h2pack->r_adm_pairs    = r_adm_pairs;
+        h2pack->r_inadm_pairs  = r_inadm_pairs;
+    }
+
+    h2pack->node_level    = (int*) malloc(sizeof(int) * n_node);
+    h2pack->pt_cluster    = (int*) malloc(sizeof(int) * n_node * 2);
+    h2pack->mat_cluster   = (int*) malloc(sizeof(int) * n_node * 2);
+    h2pack->n_child       = (int*) malloc(sizeof(int) * n_node);
+    h2pack->children      = (int*) malloc(sizeof(int) * n_node * max_child);
+    h2pack->parent        = (int*) malloc(sizeof(int) * n_node);
+    h2pack->level_n_node  = (int*) calloc(max_level + 1, sizeof(int));
+    h2pack->height_n_node = (int*) calloc(max_level + 1, sizeof(int));
+    h2pack->level_nodes   = (int*) malloc(sizeof(int) * n_leaf_node * (max_level + 1));
+    h2pack->height_nodes  = (int*) malloc(sizeof(int) * n_leaf_node * (max_level + 1));
+    ASSERT_PRINTF(
+        h2pack->node_level != NULL && h2pack->pt_cluster != NULL && h2pack->mat_cluster != NULL &&
+        h2pack->n_child != NULL && h2pack->children != NULL && h2pack->parent != NULL &&
+        h2pack->level_n_node != NULL && h2pack->height_n_node != NULL &&
+        h2pack->level_nodes != NULL && h2pack->height_nodes != NULL,
+        "Failed to allocate partitioning tree arrays\n"
     );
-    free(D_pair_i);
-    free(D_pair_j);
-    free(D_pair_v);
+    memcpy(h2pack->node_level, node_level, sizeof(int) * n_node);
+    memcpy(h2pack->pt_cluster, pt_cluster, sizeof(int) * n_node * 2);
+    memcpy(h2pack->n_child,    n_child,    sizeof(int) * n_node);
+    memcpy(h2pack->children,   children,   sizeof(int) * n_node * max_child);
+    memcpy(h2pack->height_nodes, pairs + 2 * (n_r_adm_pair + n_r_inadm_pair), sizeof(int) * n_leaf_node);
+    h2pack->height_n_node[0] = n_leaf_node;
+    h2pack->parent[n_node - 1] = -1;
+    for (int node = 0; node < n_node; node++)
+    {
+        h2pack->mat_cluster[2 * node]     = krnl_dim * pt_cluster[2 * node];
+        h2pack->mat_cluster[2 * node + 1] = krnl_dim * (pt_cluster[2 * node + 1] + 1) - 1;
+        for (int j = 0; j < n_child[node]; j++) h2pack->parent[children[node * max_child + j]] = node;
+        int level = node_level[node];
+        if (h2pack->level_n_node[level] < n_leaf_node)
+        {
+            h2pack->level_nodes[level * n_leaf_node + h2pack->level_n_node[level]] = node;
+            h2pack->level_n_node[level]++;
+        }
+    }
 
-    // 12. Set up permutation arrays
-    h2pack->xT    = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size);
-    h2pack->yT    = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size);
-    h2pack->pmt_x = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size * h2pack->mm_max_n_vec);
-    h2pack->pmt_y = (DTYPE*) malloc(sizeof(DTYPE) * h2pack->krnl_mat_size * h2pack->mm_max_n_vec);
+    // 5. Point coordinates, enclosing boxes, and skeleton points
+    h2pack->coord     = (DTYPE*) malloc(sizeof(DTYPE) * n_point * xpt_dim);
+    h2pack->coord0    = (DTYPE*) malloc(sizeof(DTYPE) * n_point * xpt_dim);
+    h2pack->coord_idx = perm;
+    ASSERT_PRINTF(h2pack->coord != NULL && h2pack->coord0 != NULL, "Failed to allocate point coordinate arrays\n");
+    h2pack->enbox     = (DTYPE*) malloc(sizeof(DTYPE) * n_node * 2 * pt_dim);
+    ASSERT_PRINTF(h2pack->enbox != NULL, "Failed to allocate enclosing box array\n");
+    is_valid = (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_COORD], sec[H2P_BIN_SEC_COORD].nbytes, h2pack->coord) == 0) &&
+               (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_ENBOX], sec[H2P_BIN_SEC_ENBOX].nbytes, h2pack->enbox) == 0);
+
+    // Kernel parameters are used if the caller does not provide them
+    if (krnl_param_bytes > 0)
+    {
+        h2pack->krnl_param_buf = malloc(sec[H2P_BIN_SEC_KRNL_PARAM].nbytes);
+        ASSERT_PRINTF(h2pack->krnl_param_buf != NULL, "Failed to allocate kernel parameter array\n");
+        if (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_KRNL_PARAM], sec[H2P_BIN_SEC_KRNL_PARAM].nbytes, h2pack->krnl_param_buf) != 0) is_valid = 0;
+        h2pack->krnl_param_bytes = krnl_param_bytes;
+        if (krnl_param == NULL) h2pack->krnl_param = h2pack->krnl_param_buf;
+    }
+
+    // Periodic lattices, shifts of reduced pairs, and the periodic block are copied 
+    if (is_periodic)
+    {
+        h2pack->n_lattice        = n_lattice;
+        h2pack->per_lattices     = (DTYPE*) malloc(sec[H2P_BIN_SEC_PER_LAT  ].nbytes + sizeof(DTYPE));
+        h2pack->per_adm_shifts   = (DTYPE*) malloc(sec[H2P_BIN_SEC_PER_ADM  ].nbytes + sizeof(DTYPE));
+        h2pack->per_inadm_shifts = (DTYPE*) malloc(sec[H2P_BIN_SEC_PER_INADM].nbytes + sizeof(DTYPE));
+        h2pack->per_blk          = (DTYPE*) malloc_aligned(sec[H2P_BIN_SEC_PER_BLK].nbytes + sizeof(DTYPE), 64);
+        ASSERT_PRINTF(
+            h2pack->per_lattices != NULL && h2pack->per_adm_shifts != NULL && 
+            h2pack->per_inadm_shifts != NULL && h2pack->per_blk != NULL,
+            "Failed to allocate periodic lattices, shifts, and periodic block\n"
+        );
+        if (H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_PER_LAT  ], sec[H2P_BIN_SEC_PER_LAT  ].nbytes, h2pack->per_lattices)     != 0 ||
+            H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_PER_ADM  ], sec[H2P_BIN_SEC_PER_ADM  ].nbytes, h2pack->per_adm_shifts)   != 0 ||
+            H2P_bin_read_section(fd, map, &sec[H2P_BIN_SEC_PER_INADM], sec[H2P_BIN_SEC_PER_INADM].nbytes, h2pack->per_inadm_shifts) != 0) is_valid = 0;
+        if (H2P_bin_read_section_par(fd, &sec[H2P_BIN_SEC_PER_BLK], h2pack->n_thread, h2pack->per_blk) != 0) is_valid = 0;
+    }
+    for (int j = 0; j < xpt_dim; j++)
+    {
+        DTYPE *coord_j  = h2pack->coord  + j * n_point;
+        DTYPE *coord0_j = h2pack->coord0 + j * n_point;
+        for (int i = 0; i < n_point; i++) coord0_j[perm[i]] = coord_j[i];
+    }
+    h2pack->n_UJ    = n_node;
+    h2pack->U       = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
+    h2pack->J       = (H2P_int_vec_p*)   malloc(sizeof(H2P_int_vec_p)   * n_node);
+    h2pack->J_coord = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * n_node);
     ASSERT_PRINTF(
-        h2pack->xT != NULL && h2pack->yT != NULL && h2pack->pmt_x != NULL && h2pack->pmt_y != NULL,
-        "Failed to allocate working arrays of size %d for matvec & matmul\n", 2 * h2pack->krnl_mat_size * (h2pack->mm_max_n_vec+1)
+        h2pack->U != NULL && h2pack->J != NULL && h2pack->J_coord != NULL,
+        "Failed to allocate U, J, and J_coord arrays\n"
     );
-    int *coord_idx = h2pack->coord_idx;
-    int *fwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
-    int *bwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
-    for (int i = 0; i < n_point; i++)
+    size_t skel_pos = n_node;
+    for (int node = 0; node < n_node; node++)
     {
-        for (int j = 0; j < krnl_dim; j++)
+        int length = skel[node];
+        H2P_int_vec_init(&h2pack->J[node], MAX(length, 1));
+        memcpy(h2pack->J[node]->data, skel + skel_pos, sizeof(int) * length);
+        h2pack->J[node]->length = length;
+        skel_pos += length;
+        H2P_dense_mat_init(&h2pack->J_coord[node], xpt_dim, MAX(length, 1));
+        if (length > 0)
         {
-            fwd_pmt_idx[i * krnl_dim + j] = coord_idx[i] * krnl_dim + j;
-            bwd_pmt_idx[coord_idx[i] * krnl_dim + j] = i * krnl_dim + j;
+            H2P_gather_matrix_columns(
+                h2pack->coord, n_point, h2pack->J_coord[node]->data, h2pack->J_coord[node]->ld,
+                xpt_dim, h2pack->J[node]->data, length
+            );
+        } else {
+            h2pack->J_coord[node]->nrow = 0;
+            h2pack->J_coord[node]->ncol = 0;
+            h2pack->J_coord[node]->ld   = 0;
         }
     }
-    h2pack->fwd_pmt_idx = fwd_pmt_idx;
-    h2pack->bwd_pmt_idx = bwd_pmt_idx;
 
-    // 13. Misc
-    H2P_calc_enclosing_box(pt_dim, n_point, h2pack->coord, NULL, &h2pack->enbox);
-    H2P_calc_node_inadm_lists(h2pack);
-    h2pack->tb = (H2P_thread_buf_p*) malloc(sizeof(H2P_thread_buf_p) * h2pack->n_thread);
-    ASSERT_PRINTF(h2pack->tb != NULL, "Failed to allocate %d thread buffers\n", h2pack->n_thread);
-    for (int i = 0; i < h2pack->n_thread; i++)
-        H2P_thread_buf_init(&h2pack->tb[i], h2pack->krnl_mat_size);
+    // 6. U matrices, point to the mapping in zero-copy mode, otherwise read in parallel. 
+    //    Each U is read with its padding so the checksum covers the whole section. 
+    //    An encoded section is decoded into a temporary array first. 
+    size_t *U_spos = (size_t*) malloc(sizeof(size_t) * (n_node + 1));
+    ASSERT_PRINTF(U_spos != NULL, "Failed to allocate U matrix offset array\n");
+    U_spos[0] = 0;
+    for (int node = 0; node < n_node; node++)
+        U_spos[node + 1] = U_spos[node] + H2P_bin_align(sizeof(DTYPE) * (size_t) U_size[2 * node] * (size_t) U_size[2 * node + 1]);
+    char *U_data = NULL;
+    if (sec[H2P_BIN_SEC_U_DATA].encoding != H2P_BIN_ENC_RAW)
+    {
+        U_data = (char*) malloc(sec[H2P_BIN_SEC_U_DATA].raw_nbytes + 1);
+        ASSERT_PRINTF(U_data != NULL, "Failed to allocate U matrices decoding buffer\n");
+        if (H2P_bin_read_section_par(fd, &sec[H2P_BIN_SEC_U_DATA], h2pack->n_thread, U_data) != 0) is_valid = 0;
+    }
+    if (map != NULL && U_data == NULL)
+    {
+        for (int node = 0; node < n_node; node++)
+        {
+            H2P_dense_mat_p Ui;
+            H2P_dense_mat_init(&Ui, 0, 0);
+            Ui->nrow = U_size[2 * node];
+            Ui->ncol = U_size[2 * node + 1];
+            Ui->ld   = Ui->ncol;
+            Ui->size = Ui->nrow * Ui->ncol;
+            Ui->data = (Ui->size > 0) ? (DTYPE*) (map + sec[H2P_BIN_SEC_U_DATA].offset + U_spos[node]) : NULL;
+            h2pack->U[node] = Ui;
+        }
+    } else {
+        int n_fail = 0;
+        uint64_t U_checksum = 0;
+        #pragma omp parallel for num_threads(h2pack->n_thread) schedule(dynamic) reduction(+:n_fail, U_checksum)
+        for (int node = 0; node < n_node; node++)
+        {
+            size_t nbytes = U_spos[node + 1] - U_spos[node];
+            H2P_dense_mat_p Ui;
+            H2P_dense_mat_init(&Ui, 1, (int) (nbytes / sizeof(DTYPE)));
+            H2P_dense_mat_resize(Ui, U_size[2 * node], U_size[2 * node + 1]);
+            if (nbytes > 0 && U_data != NULL)
+            {
+                memcpy(Ui->data, U_data + U_spos[node], nbytes);
+            } else if (nbytes > 0) {
+                off_t offset = (off_t) (sec[H2P_BIN_SEC_U_DATA].offset + U_spos[node]);
+                if (H2P_bin_pread(fd, Ui->data, nbytes, offset) != 0) n_fail++;
+                else U_checksum += H2P_bin_checksum(Ui->data, nbytes, U_spos[node]);
+            }
+            h2pack->U[node] = Ui;
+        }
+        if (U_data == NULL && (n_fail > 0 || U_checksum != sec[H2P_BIN_SEC_U_DATA].checksum)) is_valid = 0;
+    }
+    free(U_data);
+    free(U_spos);
 
-    // Finally done...
-    fclose(meta_txt_file);
-    fclose(binary_file);
+    // 7. B and D matrices, point to the mapping in zero-copy mode or stay in the file in out-of-core mode.
+    //    Encoded B and D matrices are always decoded into memory. 
+    h2pack->n_B    = n_r_adm_pair;
+    h2pack->n_D    = n_D;
+    h2pack->B_nrow = (int*)    malloc(sizeof(int)    * (n_r_adm_pair + 1));
+    h2pack->B_ncol = (int*)    malloc(sizeof(int)    * (n_r_adm_pair + 1));
+    h2pack->B_ptr  = (size_t*) malloc(sizeof(size_t) * (n_r_adm_pair + 1));
+    h2pack->D_nrow = (int*)    malloc(sizeof(int)    * n_D);
+    h2pack->D_ncol = (int*)    malloc(sizeof(int)    * n_D);
+    h2pack->D_ptr  = (size_t*) malloc(sizeof(size_t) * (n_D + 1));
+    ASSERT_PRINTF(
+        h2pack->B_nrow != NULL && h2pack->B_ncol != NULL && h2pack->B_ptr != NULL &&
+        h2pack->D_nrow != NULL && h2pack->D_ncol != NULL && h2pack->D_ptr != NULL,
+        "Failed to allocate B and D matrices metadata arrays\n"
+    );
+    h2pack->B_ptr[0] = 0;
+    h2pack->D_ptr[0] = 0;
+    for (int i = 0; i < n_r_adm_pair; i++)
+    {
+        h2pack->B_nrow[i] = B_size[2 * i];
+        h2pack->B_ncol[i] = B_size[2 * i + 1];
+        h2pack->B_ptr[i + 1] = (size_t) B_size[2 * i] * (size_t) B_size[2 * i + 1];
+    }
+    for (int i = 0; i < n_D; i++)
+    {
+        h2pack->D_nrow[i] = D_size[2 * i];
+        h2pack->D_ncol[i] = D_size[2 * i + 1];
+        h2pack->D_ptr[i + 1] = (size_t) D_size[2 * i] * (size_t) D_size[2 * i + 1];
+    }
+    if (h2pack->BD_JIT == 0)
+    {
+        size_t D_total_size = D0_total_size + D1_total_size;
+        if (load_mode == H2P_BIN_LOAD_OOC)
+        {
+            h2pack->ooc_fd       = fd;
+            h2pack->ooc_B_offset = sec[H2P_BIN_SEC_B_DATA].offset;
+            h2pack->ooc_D_offset = sec[H2P_BIN_SEC_D_DATA].offset;
+        } else if (map != NULL && !BD_quant) {
+            h2pack->B_data = (DTYPE*) (map + sec[H2P_BIN_SEC_B_DATA].offset);
+            h2pack->D_data = (DTYPE*) (map + sec[H2P_BIN_SEC_D_DATA].offset);
+        } else {
+            h2pack->B_data = (DTYPE*) malloc_aligned(sizeof(DTYPE) * (B_total_size + 1), 64);
+            h2pack->D_data = (DTYPE*) malloc_aligned(sizeof(DTYPE) * (D_total_size + 1), 64);
+            ASSERT_PRINTF(
+                h2pack->B_data != NULL && h2pack->D_data != NULL,
+                "Failed to allocate space for storing all B and D matrices elements\n"
+            );
+            if (H2P_bin_read_section_par(fd, &sec[H2P_BIN_SEC_B_DATA], h2pack->n_thread, h2pack->B_data) != 0) is_valid = 0;
+            if (H2P_bin_read_section_par(fd, &sec[H2P_BIN_SEC_D_DATA], h2pack->n_thread, h2pack->D_data) != 0) is_valid = 0;
+        }
+    }
+    if (map != NULL)
+    {
+        h2pack->mmap_addr = map;
+        h2pack->mmap_size = header.file_size;
+    }
+    if (h2pack->ooc_fd != fd) close(fd);
+    free(tree);
+    free(pairs);
+    free(skel);
+    free(U_size);
+    free(B_size);
+    free(D_size);
+    if (!is_valid)
+    {
+        ERROR_PRINTF("Cannot load %s: failed to read matrix data or checksum mismatch\n", binary_fname);
+        H2P_destroy(&h2pack);
+        return -1;
+    }
+
+    // 8. Set up matvec metadata
+    H2P_read_setup_matvec(h2pack, B_total_size, D0_total_size, D1_total_size, h2pack->krnl_bimv_flops);
+    if (load_mode == H2P_BIN_LOAD_OOC) H2P_ooc_setup(h2pack, ooc_buf_bytes);
     *h2pack_ = h2pack;
-}
\ No newline at end of file
+    return 0;
+}
+
+int H2P_read_from_binary_file(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param,
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+)
+{
+    return H2P_load_binary_file(
+        h2pack_, binary_fname, H2P_BIN_LOAD_READ, BD_JIT, 0, 
+        krnl_param, krnl_eval, krnl_bimv, NULL, krnl_bimv_flops
+    );
+}
+
+int H2P_load_mmap(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param,
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+)
+{
+    return H2P_load_binary_file(
+        h2pack_, binary_fname, H2P_BIN_LOAD_MMAP, BD_JIT, 0, 
+        krnl_param, krnl_eval, krnl_bimv, NULL, krnl_bimv_flops
+    );
+}
+
+int H2P_attach_shm(
+    H2Pack_p *h2pack_, const char *shm_name, const int BD_JIT, void *krnl_param,
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+)
+{
+    return H2P_load_binary_file(
+        h2pack_, shm_name, H2P_BIN_LOAD_SHM, BD_JIT, 0, 
+        krnl_param, krnl_eval, krnl_bimv, NULL, krnl_bimv_flops
+    );
+}
+
+int H2P_read_periodic_from_binary_file(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param,
+    kernel_eval_fptr krnl_eval, kernel_mv_fptr krnl_mv, const int krnl_mv_flops
+)
+{
+    return H2P_load_binary_file(
+        h2pack_, binary_fname, H2P_BIN_LOAD_READ, BD_JIT, 0, 
+        krnl_param, krnl_eval, NULL, krnl_mv, krnl_mv_flops
+    );
+}
+
+int H2P_load_out_of_core(
+    H2Pack_p *h2pack_, const char *binary_fname, const size_t ooc_buf_bytes, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+)
+{
+    return H2P_load_binary_file(
+        h2pack_, binary_fname, H2P_BIN_LOAD_OOC, 0, ooc_buf_bytes, 
+        krnl_param, krnl_eval, krnl_bimv, NULL, krnl_bimv_flops
+    );
+}
+
+int H2P_verify_binary_file(const char *binary_fname)
+{
+    int fd = open(binary_fname, O_RDONLY);
+    if (fd < 0)
+    {
+        ERROR_PRINTF("Cannot open binary data file %s\n", binary_fname);
+        return -1;
+    }
+    H2P_bin_header_s  header;
+    H2P_bin_section_s sec;
+    const char *errmsg = H2P_bin_read_header(fd, &header);
+    for (uint32_t i = 0; errmsg == NULL && i < header.n_section; i++)
+    {
+        if (H2P_bin_read_section_entry(fd, &header, i, &sec) != 0) errmsg = "invalid section table";
+        else if (H2P_bin_read_section_par(fd, &sec, omp_get_max_threads(), NULL) != 0) errmsg = "checksum mismatch";
+    }
+    close(fd);
+    if (errmsg != NULL)
+    {
+        ERROR_PRINTF("Cannot verify %s: %s\n", binary_fname, errmsg);
+        return -1;
+    }
+    return 0;
+}
+
+size_t H2P_ooc_blk_spos(H2Pack_p h2pack, const int is_D, const int i_blk)
+{
+    if (is_D == 0) return h2pack->B_ptr[h2pack->B_blk->data[i_blk]];
+    int n_D0_blk = h2pack->D_blk0->length - 1;
+    if (i_blk < n_D0_blk) return h2pack->D_ptr[h2pack->D_blk0->data[i_blk]];
+    return h2pack->D_ptr[h2pack->n_leaf_node + h2pack->D_blk1->data[i_blk - n_D0_blk]];
+}
+
+int H2P_ooc_read(H2Pack_p h2pack, const int is_D, const size_t elem_spos, const size_t n_elem, DTYPE *buf)
+{
+    size_t offset = (is_D ? h2pack->ooc_D_offset : h2pack->ooc_B_offset) + sizeof(DTYPE) * elem_spos;
+    return H2P_bin_pread(h2pack->ooc_fd, buf, sizeof(DTYPE) * n_elem, (off_t) offset);
+}
+
+// Release the file mapping and the out-of-core file and buffers of a H2Pack structure
+void H2P_close_binary_file(H2Pack_p h2pack)
+{
+    if (h2pack->ooc_fd >= 0)
+    {
+        close(h2pack->ooc_fd);
+        free_aligned(h2pack->ooc_buf);
+        H2P_int_vec_destroy(&h2pack->ooc_B_chunk);
+        H2P_int_vec_destroy(&h2pack->ooc_D_chunk);
+        h2pack->ooc_fd  = -1;
+        h2pack->ooc_buf = NULL;
+    }
+    if (h2pack->mmap_addr == NULL) return;
+    const char *map_s = (const char*) h2pack->mmap_addr;
+    const char *map_e = map_s + h2pack->mmap_size;
+    #define IN_MAPPING(ptr) ((const char*) (ptr) >= map_s && (const char*) (ptr) < map_e)
+    if (h2pack->U != NULL)
+    {
+        for (int i = 0; i < h2pack->n_UJ; i++)
+            if (h2pack->U[i] != NULL && IN_MAPPING(h2pack->U[i]->data)) h2pack->U[i]->data = NULL;
+    }
+    if (IN_MAPPING(h2pack->B_data)) h2pack->B_data = NULL;
+    if (IN_MAPPING(h2pack->D_data)) h2pack->D_data = NULL;
+    #undef IN_MAPPING
+    munmap(h2pack->mmap_addr, h2pack->mmap_size);
+    h2pack->mmap_addr = NULL;
+    h2pack->mmap_size = 0;
+}
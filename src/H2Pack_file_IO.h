@@ -40,6 +40,213 @@ void H2P_read_from_file(
     kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
 );
 
+// Store a constructed H2 representation to a single versioned binary file.
+// All sections start at 64-byte aligned offsets, so the file can be loaded 
+// by H2P_load_mmap() without copying the matrix data. U, B, and D matrices are 
+// written by h2pack->n_thread threads with pwrite(), each section has a checksum.
+// Input parameters:
+//   h2pack       : H2Pack structure after calling H2P_build() or H2P_build_periodic()
+//   binary_fname : Binary file name
+// Notes:
+//   1. Extended point coordinates (h2pack->xpt_dim > h2pack->pt_dim, e.g., the RPY kernel)
+//      are stored. For a periodic H2 matrix, the periodic lattices, the shifts of reduced 
+//      admissible and inadmissible pairs, and the periodic block are also stored. 
+//   2. If H2P_set_krnl_param_bytes() has been called, krnl_param is stored and used 
+//      by the loading functions if they are not given a krnl_param. Kernel functions 
+//      cannot be stored and should be given to the loading functions.
+void H2P_store_to_binary_file(H2Pack_p h2pack, const char *binary_fname);
+
+// Store a constructed H2 representation to a binary file like H2P_store_to_binary_file(), 
+// with U, B, and D matrices compressed by a lossy block-wise quantizer. Each block of 1024 
+// values keeps its max abs value M, other values are rounded to integers in units of 
+// M / (2^(nbits-1) - 1) and bit-packed, nbits is the smallest number of bits that keeps 
+// the error of each value below quant_reltol * M. 
+// Input parameters:
+//   h2pack       : H2Pack structure after calling H2P_build() or H2P_build_periodic()
+//   binary_fname : Binary file name
+//   quant_reltol : Error bound of each U, B, D element relative to the max abs value of 
+//                  its block. If <= 0, use 0.01 * QR_stop_tol when the QR stop type is 
+//                  QR_REL_NRM. If it needs as many bits as DTYPE, the matrices are not compressed.
+// Notes:
+//   1. Compressed files are loaded by H2P_read_from_binary_file() and H2P_load_mmap(), 
+//      which decode U, B, and D into memory with multiple threads. H2P_load_out_of_core() 
+//      does not support compressed B and D matrices.
+//   2. In JIT mode, B and D matrices are evaluated into temporary arrays before compression.
+//   3. The matvec error of the loaded matrix is not bounded by quant_reltol, since errors 
+//      of all U, B, and D elements add up. For 3D Coulomb kernel H2 matrices with 20000 
+//      points and QR_stop_tol = 1e-4, 1e-6, 1e-8, the default bound gives matvec results 
+//      within 0.03 - 0.06 * QR_stop_tol of the uncompressed matrix and files of 30% - 55% 
+//      of the uncompressed size. 0.1 * QR_stop_tol gives matvec errors up to about 
+//      QR_stop_tol, which doubles the H2 approximation error.
+void H2P_store_to_compressed_binary_file(H2Pack_p h2pack, const char *binary_fname, const DTYPE quant_reltol);
+
+// Load a H2 representation stored by H2P_store_to_binary_file()
+// Input parameters:
+//   binary_fname    : Binary file name
+//   BD_JIT          : If H2Pack should use just-in-time matvec mode, 0 or 1, 
+//                     only used if krnl_eval and krnl_bimv are not NULL
+//   krnl_param      : Pointer to the krnl_eval parameter buffer, NULL to use the stored one
+//   krnl_eval       : Pointer to the kernel matrix evaluation function, can be NULL
+//   krnl_bimv       : Pointer to the kernel matrix bi-matvec function, can be NULL
+//   krnl_bimv_flops : Number of flops required for each bi-matvec operation, for performance statistic only
+// Output parameters:
+//   *h2pack_ : H2Pack structure constructed from the file, NULL if failed
+//   <return> : 0 if succeeded, -1 if the file cannot be opened, is truncated or corrupted, 
+//              or was written with a different format version, byte order, or DTYPE
+// Notes:
+//   1. Same as H2P_read_from_file(), the loaded H2Pack matrix is meant for H2P_matvec() and 
+//      H2P_matmul(); H2P_HSS_ULV_* functions can be used if the stored matrix is a HSS matrix.
+//   2. U, B, and D matrices are read by h2pack->n_thread threads with pread(). The checksum 
+//      of every section read is verified. B and D matrices are not read in JIT mode.
+//   3. A periodic H2 matrix is loaded for H2P_matvec_periodic() and H2P_matmul_periodic(), 
+//      krnl_bimv is not used and krnl_eval is used in JIT mode. Use 
+//      H2P_read_periodic_from_binary_file() to provide a kernel matvec function. 
+int  H2P_read_from_binary_file(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+);
+
+// Load a periodic H2 representation stored by H2P_store_to_binary_file() after 
+// H2P_build_periodic(), same as H2P_read_from_binary_file() but with the kernel 
+// functions used by H2P_matvec_periodic() 
+// Input parameters:
+//   binary_fname  : Binary file name
+//   BD_JIT        : If H2Pack should use just-in-time matvec mode, 0 or 1, 
+//                   only used if krnl_eval is not NULL
+//   krnl_param    : Pointer to the krnl_eval parameter buffer, NULL to use the stored one
+//   krnl_eval     : Pointer to the kernel matrix evaluation function, can be NULL
+//   krnl_mv       : Pointer to the kernel matrix matvec function, can be NULL
+//   krnl_mv_flops : Number of flops required for each matvec operation, for performance statistic only
+// Output parameters:
+//   *h2pack_ : H2Pack structure constructed from the file, NULL if failed
+//   <return> : 0 if succeeded, -1 if failed, same as H2P_read_from_binary_file()
+// Note:
+//   The periodic system kernel is only used for building the periodic block, which is 
+//   stored, so pkrnl_eval and pkrnl_param are not needed. 
+int  H2P_read_periodic_from_binary_file(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_mv_fptr krnl_mv, const int krnl_mv_flops
+);
+
+// Load a H2 representation stored by H2P_store_to_binary_file() with a read-only 
+// shared file mapping. U, B, and D matrices are not copied but point to the mapping, 
+// so loading is O(metadata) and processes loading the same file share the page cache.
+// Input and output parameters are the same as H2P_read_from_binary_file().
+// Notes:
+//   1. The mapping is released by H2P_destroy(). The file should not be modified 
+//      or truncated while it is mapped.
+//   2. U, B, and D matrices are read-only. H2P_matvec(), H2P_matmul(), and HSS ULV 
+//      functions only read them and can be used as with H2P_read_from_binary_file().
+//   3. Checksums of U, B, and D matrices are not verified, since that would read the 
+//      whole file. Use H2P_verify_binary_file() to verify them.
+//   4. Compressed U, B, and D matrices are decoded into memory and their checksums are verified.
+//   5. Periodic lattices, shifts, and the periodic block of a periodic H2 matrix are copied.
+int  H2P_load_mmap(
+    H2Pack_p *h2pack_, const char *binary_fname, const int BD_JIT, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+);
+
+// Load a H2 representation stored by H2P_store_to_binary_file() in out-of-core mode. 
+// U matrices and metadata are read into memory, B and D matrices stay in the file 
+// and are streamed chunk by chunk in H2P_matvec() with double buffering, the next 
+// chunk is read by one thread while the other threads compute with the current chunk.
+// Input parameters:
+//   binary_fname    : Binary file name
+//   ooc_buf_bytes   : Memory budget (in bytes) of the two streaming buffers. Each buffer 
+//                     is enlarged to the largest B or D matrix task block if needed.
+//   krnl_param      : Pointer to the krnl_eval parameter buffer
+//   krnl_eval       : Pointer to the kernel matrix evaluation function, can be NULL
+//   krnl_bimv       : Pointer to the kernel matrix bi-matvec function, can be NULL
+//   krnl_bimv_flops : Number of flops required for each bi-matvec operation, for performance statistic only
+// Output parameters:
+//   *h2pack_ : H2Pack structure constructed from the file, NULL if failed
+//   <return> : 0 if succeeded, -1 if failed, same as H2P_read_from_binary_file()
+// Notes:
+//   1. The file is kept open until H2P_destroy() and should not be modified. 
+//   2. H2P_matmul() streams B and D once for each vector, use H2P_matvec() for the
+//      best performance. 
+//   3. Checksums of B and D matrices are not verified, use H2P_verify_binary_file().
+//   4. Files stored by H2P_store_to_compressed_binary_file() and periodic H2 matrices 
+//      cannot be loaded in this mode.
+int  H2P_load_out_of_core(
+    H2Pack_p *h2pack_, const char *binary_fname, const size_t ooc_buf_bytes, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+);
+
+// Store a constructed H2 representation to a POSIX shared memory object in the format of 
+// H2P_store_to_binary_file(). All sections are addressed by offsets from the start of the 
+// object, so other processes can attach it with H2P_attach_shm() at any address. 
+// Input parameters:
+//   h2pack   : H2Pack structure after calling H2P_build() or H2P_build_periodic()
+//   shm_name : Shared memory object name, "/name" without any other '/'
+// Notes:
+//   1. An existing object with the same name is unlinked first. Processes attached to it 
+//      keep using the old object, processes attaching later use the new object. 
+//   2. The header is written after all matrices, so H2P_attach_shm() fails instead of 
+//      reading incomplete data if it is called before this function returns. 
+//   3. The object stays in memory (/dev/shm on Linux) until H2P_unlink_shm() is called 
+//      and all processes attached to it have called H2P_destroy().
+void H2P_store_to_shm(H2Pack_p h2pack, const char *shm_name);
+
+// Attach a H2 representation stored by H2P_store_to_shm(). Same as H2P_load_mmap(), U, B, 
+// and D matrices point to a read-only mapping of the shared memory object and are shared 
+// by all attached processes. Metadata, index arrays, and point coordinates are copied. 
+// Input parameters:
+//   shm_name        : Shared memory object name used by H2P_store_to_shm()
+//   Other parameters are the same as H2P_load_mmap()
+// Output parameters:
+//   *h2pack_ : H2Pack structure attached to the shared memory object, NULL if failed
+//   <return> : 0 if succeeded, -1 if failed, same as H2P_load_mmap()
+// Notes:
+//   1. Each process has its own H2Pack structure and allocates its own matvec buffers 
+//      (permuted vectors, y0, y1, and thread buffers), so processes can call H2P_matvec() 
+//      and H2P_matmul() at the same time. The mapping is released by H2P_destroy(). 
+//   2. A periodic H2 matrix is attached for H2P_matvec_periodic() in the same way as 
+//      H2P_read_from_binary_file(). 
+int  H2P_attach_shm(
+    H2Pack_p *h2pack_, const char *shm_name, const int BD_JIT, void *krnl_param, 
+    kernel_eval_fptr krnl_eval, kernel_bimv_fptr krnl_bimv, const int krnl_bimv_flops
+);
+
+// Remove the name of a shared memory object created by H2P_store_to_shm(). The memory 
+// is released after all processes attached to it have called H2P_destroy().
+// Input parameter:
+//   shm_name : Shared memory object name used by H2P_store_to_shm()
+// Output parameter:
+//   <return> : 0 if succeeded, -1 if the object does not exist or cannot be removed
+int  H2P_unlink_shm(const char *shm_name);
+
+// Verify the checksums of all sections of a file stored by H2P_store_to_binary_file(), 
+// using omp_get_max_threads() threads to read the file
+// Input parameter:
+//   binary_fname : Binary file name
+// Output parameter:
+//   <return> : 0 if all checksums match, -1 if the file cannot be opened, is truncated 
+//              or corrupted, or was written with a different format version, byte order, or DTYPE
+int  H2P_verify_binary_file(const char *binary_fname);
+
+// Store the HSS ULV LU or Cholesky factorization of a H2Pack structure to a 
+// binary file. Float factors after H2P_HSS_ULV_to_float() are stored in float.
+// Input parameters:
+//   h2pack       : H2Pack structure after H2P_HSS_ULV_LU_factorize() or 
+//                  H2P_HSS_ULV_Cholesky_factorize()
+//   binary_fname : Binary data file name
+void H2P_HSS_ULV_store_to_file(H2Pack_p h2pack, const char *binary_fname);
+
+// Load a HSS ULV factorization stored by H2P_HSS_ULV_store_to_file()
+// Input parameters:
+//   h2pack       : H2Pack structure with the same HSS representation as the one used 
+//                  for computing the stored factorization, either from H2P_build() 
+//                  with the same settings or from H2P_read_from_file()
+//   binary_fname : Binary data file name
+// Output parameters:
+//   h2pack   : H2Pack structure with the loaded ULV factorization, ready for ULV solves.
+//              Its previous ULV factorization (if any) is released. 
+//   <return> : 0 if succeeded, -1 if the file does not match h2pack (tree structure, 
+//              HSS basis sizes, matrix size, or DTYPE) or is corrupted, h2pack is 
+//              not changed in this case
+int  H2P_HSS_ULV_read_from_file(H2Pack_p h2pack, const char *binary_fname);
+
 #ifdef __cplusplus
 }
 #endif
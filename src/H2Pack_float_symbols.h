@@ -0,0 +1,262 @@
+#ifndef __H2PACK_FLOAT_SYMBOLS_H__
+#define __H2PACK_FLOAT_SYMBOLS_H__
+
+// Single precision symbol renaming. H2Pack sources are compiled twice, once 
+// with DTYPE == double and once with DTYPE == float. All precision-dependent 
+// global symbols of the float build are renamed from H2P_* to H2P_s_* here, so 
+// both builds can live in the same library and the same program. Code compiled 
+// with DTYPE_SIZE == FLOAT_SIZE calls the float functions with the usual names.
+// New global functions in precision-dependent source files must be added here.
+
+// H2Pack_HSS_ULV.c
+#define H2P_HSS_ULV_Cholesky_bwd_node                      H2P_s_HSS_ULV_Cholesky_bwd_node
+#define H2P_HSS_ULV_Cholesky_factorize                     H2P_s_HSS_ULV_Cholesky_factorize
+#define H2P_HSS_ULV_Cholesky_fwd_node                      H2P_s_HSS_ULV_Cholesky_fwd_node
+#define H2P_HSS_ULV_Cholesky_matsolve                      H2P_s_HSS_ULV_Cholesky_matsolve
+#define H2P_HSS_ULV_Cholesky_solve                         H2P_s_HSS_ULV_Cholesky_solve
+#define H2P_HSS_ULV_LU_bwd_node                            H2P_s_HSS_ULV_LU_bwd_node
+#define H2P_HSS_ULV_LU_factorize                           H2P_s_HSS_ULV_LU_factorize
+#define H2P_HSS_ULV_LU_fwd_node                            H2P_s_HSS_ULV_LU_fwd_node
+#define H2P_HSS_ULV_LU_matsolve                            H2P_s_HSS_ULV_LU_matsolve
+#define H2P_HSS_ULV_LU_solve                               H2P_s_HSS_ULV_LU_solve
+#define H2P_HSS_ULV_free                                   H2P_s_HSS_ULV_free
+#define H2P_HSS_ULV_solve_refine                           H2P_s_HSS_ULV_solve_refine
+#define H2P_HSS_ULV_to_float                               H2P_s_HSS_ULV_to_float
+
+// H2Pack_HSS_ULV_mshift.c
+#define H2P_HSS_ULV_mshift_Cholesky_factorize              H2P_s_HSS_ULV_mshift_Cholesky_factorize
+#define H2P_HSS_ULV_mshift_destroy                         H2P_s_HSS_ULV_mshift_destroy
+#define H2P_HSS_ULV_mshift_init                            H2P_s_HSS_ULV_mshift_init
+#define H2P_HSS_ULV_mshift_logdet                          H2P_s_HSS_ULV_mshift_logdet
+
+// H2Pack_HSS_ULV_trace.c
+#define H2P_HSS_ULV_trace_Kinv_dK                          H2P_s_HSS_ULV_trace_Kinv_dK
+
+// H2Pack_HSS_blackbox.c
+#define H2P_HSS_blackbox_build                             H2P_s_HSS_blackbox_build
+
+// H2Pack_HSS_matvec.c
+#define H2P_HSS_matmul                                     H2P_s_HSS_matmul
+#define H2P_HSS_matvec                                     H2P_s_HSS_matvec
+#define H2P_HSS_matvec_init                                H2P_s_HSS_matvec_init
+
+// H2Pack_ID_compress.c
+#define H2P_ID_QR                                          H2P_s_ID_QR
+#define H2P_ID_compress                                    H2P_s_ID_compress
+#define H2P_partial_pivot_QR                               H2P_s_partial_pivot_QR
+#define H2P_partial_pivot_QR_kdim                          H2P_s_partial_pivot_QR_kdim
+
+// H2Pack_SPDHSS_H2.c
+#define H2P_SPDHSS_H2_acc_matvec                           H2P_s_SPDHSS_H2_acc_matvec
+#define H2P_SPDHSS_H2_build                                H2P_s_SPDHSS_H2_build
+#define H2P_SPDHSS_H2_build_stream                         H2P_s_SPDHSS_H2_build_stream
+#define H2P_SPDHSS_H2_calc_HSS_Bij                         H2P_s_SPDHSS_H2_calc_HSS_Bij
+#define H2P_SPDHSS_H2_clean_HSS_B                          H2P_s_SPDHSS_H2_clean_HSS_B
+#define H2P_SPDHSS_H2_gather_HSS_B                         H2P_s_SPDHSS_H2_gather_HSS_B
+#define H2P_SPDHSS_H2_get_level_HSS_Bij_pairs              H2P_s_SPDHSS_H2_get_level_HSS_Bij_pairs
+#define H2P_SPDHSS_H2_wrap_new_HSS                         H2P_s_SPDHSS_H2_wrap_new_HSS
+#define H2P_build_explicit_U                               H2P_s_build_explicit_U
+#define H2P_tree_common_ancestor_level                     H2P_s_tree_common_ancestor_level
+
+// H2Pack_aux_structs.c
+#define H2P_dense_mat_blkdiag                              H2P_s_dense_mat_blkdiag
+#define H2P_dense_mat_copy                                 H2P_s_dense_mat_copy
+#define H2P_dense_mat_destroy                              H2P_s_dense_mat_destroy
+#define H2P_dense_mat_gemm                                 H2P_s_dense_mat_gemm
+#define H2P_dense_mat_horzcat                              H2P_s_dense_mat_horzcat
+#define H2P_dense_mat_init                                 H2P_s_dense_mat_init
+#define H2P_dense_mat_normalize_columns                    H2P_s_dense_mat_normalize_columns
+#define H2P_dense_mat_permute_rows                         H2P_s_dense_mat_permute_rows
+#define H2P_dense_mat_print                                H2P_s_dense_mat_print
+#define H2P_dense_mat_reset                                H2P_s_dense_mat_reset
+#define H2P_dense_mat_select_columns                       H2P_s_dense_mat_select_columns
+#define H2P_dense_mat_select_rows                          H2P_s_dense_mat_select_rows
+#define H2P_dense_mat_vertcat                              H2P_s_dense_mat_vertcat
+#define H2P_int_vec_concatenate                            H2P_s_int_vec_concatenate
+#define H2P_int_vec_destroy                                H2P_s_int_vec_destroy
+#define H2P_int_vec_gather                                 H2P_s_int_vec_gather
+#define H2P_int_vec_init                                   H2P_s_int_vec_init
+#define H2P_int_vec_reset                                  H2P_s_int_vec_reset
+#define H2P_partition_vars_destroy                         H2P_s_partition_vars_destroy
+#define H2P_partition_vars_init                            H2P_s_partition_vars_init
+#define H2P_thread_buf_alloc_y                             H2P_s_thread_buf_alloc_y
+#define H2P_thread_buf_destroy                             H2P_s_thread_buf_destroy
+#define H2P_thread_buf_init                                H2P_s_thread_buf_init
+#define H2P_thread_buf_reset                               H2P_s_thread_buf_reset
+#define H2P_tree_node_destroy                              H2P_s_tree_node_destroy
+#define H2P_tree_node_init                                 H2P_s_tree_node_init
+
+// H2Pack_build.c
+#define H2P_build                                          H2P_s_build
+#define H2P_build_B_AOT                                    H2P_s_build_B_AOT
+#define H2P_build_D_AOT                                    H2P_s_build_D_AOT
+#define H2P_build_H2_UJ_proxy                              H2P_s_build_H2_UJ_proxy
+#define H2P_build_HSS_UJ_hybrid                            H2P_s_build_HSS_UJ_hybrid
+#define H2P_generate_B_metadata                            H2P_s_generate_B_metadata
+#define H2P_generate_D_metadata                            H2P_s_generate_D_metadata
+
+// H2Pack_build_periodic.c
+#define H2P_build_periodic                                 H2P_s_build_periodic
+#define H2P_build_periodic_B_AOT                           H2P_s_build_periodic_B_AOT
+#define H2P_build_periodic_D_AOT                           H2P_s_build_periodic_D_AOT
+#define H2P_build_periodic_block                           H2P_s_build_periodic_block
+
+// H2Pack_build_with_sample_point.c
+#define H2P_build_H2_UJ_sample                             H2P_s_build_H2_UJ_sample
+#define H2P_build_with_sample_point                        H2P_s_build_with_sample_point
+#define H2P_calc_enclosing_box_size                        H2P_s_calc_enclosing_box_size
+#define H2P_calc_pdist2                                    H2P_s_calc_pdist2
+#define H2P_proportional_int_decompose                     H2P_s_proportional_int_decompose
+#define H2P_select_anchor_grid                             H2P_s_select_anchor_grid
+#define H2P_select_cluster_sample                          H2P_s_select_cluster_sample
+#define H2P_select_sample_point                            H2P_s_select_sample_point
+#define H2P_select_sample_point_r                          H2P_s_select_sample_point_r
+
+// H2Pack_file_IO.c
+#define H2P_HSS_ULV_read_from_file                         H2P_s_HSS_ULV_read_from_file
+#define H2P_HSS_ULV_store_to_file                          H2P_s_HSS_ULV_store_to_file
+#define H2P_attach_shm                                     H2P_s_attach_shm
+#define H2P_close_binary_file                              H2P_s_close_binary_file
+#define H2P_load_mmap                                      H2P_s_load_mmap
+#define H2P_load_out_of_core                               H2P_s_load_out_of_core
+#define H2P_ooc_blk_spos                                   H2P_s_ooc_blk_spos
+#define H2P_ooc_read                                       H2P_s_ooc_read
+#define H2P_read_from_binary_file                          H2P_s_read_from_binary_file
+#define H2P_read_from_file                                 H2P_s_read_from_file
+#define H2P_read_periodic_from_binary_file                 H2P_s_read_periodic_from_binary_file
+#define H2P_store_to_binary_file                           H2P_s_store_to_binary_file
+#define H2P_store_to_compressed_binary_file                H2P_s_store_to_compressed_binary_file
+#define H2P_store_to_file                                  H2P_s_store_to_file
+#define H2P_store_to_shm                                   H2P_s_store_to_shm
+#define H2P_unlink_shm                                     H2P_s_unlink_shm
+#define H2P_verify_binary_file                             H2P_s_verify_binary_file
+
+// H2Pack_gen_proxy_point.c
+#define H2P_calc_enclosing_box                             H2P_s_calc_enclosing_box
+#define H2P_generate_proxy_point_ID_file                   H2P_s_generate_proxy_point_ID_file
+#define H2P_generate_proxy_point_nlayer                    H2P_s_generate_proxy_point_nlayer
+#define H2P_generate_proxy_point_surface                   H2P_s_generate_proxy_point_surface
+#define H2P_write_proxy_point_file                         H2P_s_write_proxy_point_file
+
+// H2Pack_matmul.c
+#define H2P_matmul                                         H2P_s_matmul
+#define H2P_matmul_bwd_transform                           H2P_s_matmul_bwd_transform
+#define H2P_matmul_dense_mult                              H2P_s_matmul_dense_mult
+#define H2P_matmul_fwd_transform                           H2P_s_matmul_fwd_transform
+#define H2P_matmul_init_y0                                 H2P_s_matmul_init_y0
+#define H2P_matmul_init_y1                                 H2P_s_matmul_init_y1
+#define H2P_matmul_intmd_mult                              H2P_s_matmul_intmd_mult
+#define H2P_permute_matrix_row_backward                    H2P_s_permute_matrix_row_backward
+#define H2P_permute_matrix_row_forward                     H2P_s_permute_matrix_row_forward
+
+// H2Pack_matmul_periodic.c
+#define H2P_matmul_periodic                                H2P_s_matmul_periodic
+#define H2P_matmul_periodic_dense_mult                     H2P_s_matmul_periodic_dense_mult
+#define H2P_matmul_periodic_intmd_mult                     H2P_s_matmul_periodic_intmd_mult
+
+// H2Pack_matvec.c
+#define CBLAS_BI_GEMV                                      H2P_s_CBLAS_BI_GEMV
+#define H2P_ext_krnl_bimv                                  H2P_s_ext_krnl_bimv
+#define H2P_krnl_eval_bimv                                 H2P_s_krnl_eval_bimv
+#define H2P_matvec                                         H2P_s_matvec
+#define H2P_matvec_bwd_transform                           H2P_s_matvec_bwd_transform
+#define H2P_matvec_dense_mult0_AOT_task_block              H2P_s_matvec_dense_mult0_AOT_task_block
+#define H2P_matvec_dense_mult1_AOT_task_block              H2P_s_matvec_dense_mult1_AOT_task_block
+#define H2P_matvec_dense_mult_AOT                          H2P_s_matvec_dense_mult_AOT
+#define H2P_matvec_dense_mult_JIT                          H2P_s_matvec_dense_mult_JIT
+#define H2P_matvec_fwd_transform                           H2P_s_matvec_fwd_transform
+#define H2P_matvec_init_y0                                 H2P_s_matvec_init_y0
+#define H2P_matvec_init_y1                                 H2P_s_matvec_init_y1
+#define H2P_matvec_intmd_mult_AOT                          H2P_s_matvec_intmd_mult_AOT
+#define H2P_matvec_intmd_mult_AOT_task_block               H2P_s_matvec_intmd_mult_AOT_task_block
+#define H2P_matvec_intmd_mult_JIT                          H2P_s_matvec_intmd_mult_JIT
+#define H2P_matvec_sum_y1_thread                           H2P_s_matvec_sum_y1_thread
+#define H2P_permute_vector_backward                        H2P_s_permute_vector_backward
+#define H2P_permute_vector_forward                         H2P_s_permute_vector_forward
+#define H2P_transpose_y0_from_krnldim                      H2P_s_transpose_y0_from_krnldim
+#define H2P_transpose_y1_to_krnldim                        H2P_s_transpose_y1_to_krnldim
+
+// H2Pack_matvec_dkrnl.c
+#define H2P_dkrnl_build                                    H2P_s_dkrnl_build
+#define H2P_dkrnl_destroy                                  H2P_s_dkrnl_destroy
+#define H2P_matmul_dkrnl                                   H2P_s_matmul_dkrnl
+#define H2P_matvec_dkrnl                                   H2P_s_matvec_dkrnl
+
+// H2Pack_matvec_periodic.c
+#define H2P_ext_krnl_mv                                    H2P_s_ext_krnl_mv
+#define H2P_matvec_periodic                                H2P_s_matvec_periodic
+#define H2P_matvec_periodic_dense_mult_AOT                 H2P_s_matvec_periodic_dense_mult_AOT
+#define H2P_matvec_periodic_dense_mult_JIT                 H2P_s_matvec_periodic_dense_mult_JIT
+#define H2P_matvec_periodic_intmd_mult_AOT                 H2P_s_matvec_periodic_intmd_mult_AOT
+#define H2P_matvec_periodic_intmd_mult_JIT                 H2P_s_matvec_periodic_intmd_mult_JIT
+
+// H2Pack_matvec_ws.c
+#define H2P_matmul_periodic_with_ws                        H2P_s_matmul_periodic_with_ws
+#define H2P_matmul_with_ws                                 H2P_s_matmul_with_ws
+#define H2P_matvec_periodic_with_ws                        H2P_s_matvec_periodic_with_ws
+#define H2P_matvec_with_ws                                 H2P_s_matvec_with_ws
+#define H2P_matvec_ws_destroy                              H2P_s_matvec_ws_destroy
+#define H2P_matvec_ws_init                                 H2P_s_matvec_ws_init
+
+// H2Pack_partition.c
+#define H2P_HSS_calc_adm_inadm_pairs                       H2P_s_HSS_calc_adm_inadm_pairs
+#define H2P_bisection_partition_points                     H2P_s_bisection_partition_points
+#define H2P_build_upward_task_queue                        H2P_s_build_upward_task_queue
+#define H2P_calc_node_inadm_lists                          H2P_s_calc_node_inadm_lists
+#define H2P_calc_reduced_adm_pairs                         H2P_s_calc_reduced_adm_pairs
+#define H2P_partition_points                               H2P_s_partition_points
+#define H2P_tree_to_array                                  H2P_s_tree_to_array
+
+// H2Pack_partition_periodic.c
+#define H2P_calc_reduced_adm_pairs_per                     H2P_s_calc_reduced_adm_pairs_per
+#define H2P_partition_points_periodic                      H2P_s_partition_points_periodic
+
+// H2Pack_pkernel_tab.c
+#define H2P_pkernel_tab_destroy                            H2P_s_pkernel_tab_destroy
+#define H2P_pkernel_tab_eval                               H2P_s_pkernel_tab_eval
+#define H2P_pkernel_tab_eval_corr                          H2P_s_pkernel_tab_eval_corr
+#define H2P_pkernel_tab_init                               H2P_s_pkernel_tab_init
+#define H2P_pkernel_tab_match_xpt                          H2P_s_pkernel_tab_match_xpt
+
+// H2Pack_rect.c
+#define H2P_rect_build                                     H2P_s_rect_build
+#define H2P_rect_destroy                                   H2P_s_rect_destroy
+#define H2P_rect_generate_proxy_point_ID_file              H2P_s_rect_generate_proxy_point_ID_file
+#define H2P_rect_init                                      H2P_s_rect_init
+#define H2P_rect_matvec                                    H2P_s_rect_matvec
+#define H2P_rect_partition_points                          H2P_s_rect_partition_points
+
+// H2Pack_typedef.c
+#define H2P_destroy                                        H2P_s_destroy
+#define H2P_init                                           H2P_s_init
+#define H2P_print_statistic                                H2P_s_print_statistic
+#define H2P_reset_timers                                   H2P_s_reset_timers
+#define H2P_run_HSS                                        H2P_s_run_HSS
+#define H2P_run_RPY                                        H2P_s_run_RPY
+#define H2P_run_RPY_Ewald                                  H2P_s_run_RPY_Ewald
+#define H2P_set_krnl_param_bytes                           H2P_s_set_krnl_param_bytes
+#define per_lattices_2d                                    H2P_s_per_lattices_2d
+#define per_lattices_3d                                    H2P_s_per_lattices_3d
+
+// H2Pack_utils.c
+#define H2P_calc_sparse_mm_trans                           H2P_s_calc_sparse_mm_trans
+#define H2P_check_box_admissible                           H2P_s_check_box_admissible
+#define H2P_eval_kernel_matrix_OMP                         H2P_s_eval_kernel_matrix_OMP
+#define H2P_eval_kernel_matrix_tiled                       H2P_s_eval_kernel_matrix_tiled
+#define H2P_gather_matrix_columns                          H2P_s_gather_matrix_columns
+#define H2P_gen_coord_in_ring                              H2P_s_gen_coord_in_ring
+#define H2P_gen_normal_distribution                        H2P_s_gen_normal_distribution
+#define H2P_gen_normal_distribution_stream                 H2P_s_gen_normal_distribution_stream
+#define H2P_gen_rand_sparse_mat_trans                      H2P_s_gen_rand_sparse_mat_trans
+#define H2P_get_Bij_block                                  H2P_s_get_Bij_block
+#define H2P_get_Dij_block                                  H2P_s_get_Dij_block
+#define H2P_get_int_CSR_elem                               H2P_s_get_int_CSR_elem
+#define H2P_int_COO_to_CSR                                 H2P_s_int_COO_to_CSR
+#define H2P_partition_workload                             H2P_s_partition_workload
+#define H2P_point_in_box                                   H2P_s_point_in_box
+#define H2P_qsort_int_key_val                              H2P_s_qsort_int_key_val
+#define H2P_set_int_CSR_elem                               H2P_s_set_int_CSR_elem
+#define H2P_shift_coord                                    H2P_s_shift_coord
+#define H2P_transpose_dmat                                 H2P_s_transpose_dmat
+
+#endif
@@ -5,4 +5,6 @@
 
 #include "H2Pack_3D_kernels.h"
 
+#include "H2Pack_ND_kernels.h"
+
 #endif
@@ -9,6 +9,8 @@
 #include "H2Pack_typedef.h"
 #include "H2Pack_aux_structs.h"
 #include "H2Pack_matmul.h"
+#include "H2Pack_matvec.h"
+#include "H2Pack_HSS_matvec.h"
 #include "H2Pack_utils.h"
 #include "utils.h"
 
@@ -463,6 +465,35 @@ void H2P_matmul(
     double *timers       = h2pack->timers;
     size_t *mat_size     = h2pack->mat_size;
 
+    // HSS matrix with sibling couplings only, use the specialized HSS matmul
+    if (h2pack->is_HSS == 1 && H2P_HSS_matvec_init(h2pack) == 1)
+    {
+        H2P_HSS_matmul(h2pack, layout, n_vec, mat_x, ldx, mat_y, ldy);
+        return;
+    }
+
+    // Out-of-core B and D matrices are streamed by H2P_matvec(), one vector at a time
+    if (h2pack->ooc_fd >= 0)
+    {
+        DTYPE *vec_x = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+        DTYPE *vec_y = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+        ASSERT_PRINTF(vec_x != NULL && vec_y != NULL, "Failed to allocate out-of-core matmul vectors\n");
+        for (int i_vec = 0; i_vec < n_vec; i_vec++)
+        {
+            if (layout == CblasRowMajor)
+            {
+                for (int i = 0; i < krnl_mat_size; i++) vec_x[i] = mat_x[(size_t) i * (size_t) ldx + i_vec];
+                H2P_matvec(h2pack, vec_x, vec_y);
+                for (int i = 0; i < krnl_mat_size; i++) mat_y[(size_t) i * (size_t) ldy + i_vec] = vec_y[i];
+            } else {
+                H2P_matvec(h2pack, mat_x + (size_t) i_vec * (size_t) ldx, mat_y + (size_t) i_vec * (size_t) ldy);
+            }
+        }
+        free(vec_x);
+        free(vec_y);
+        return;
+    }
+
     size_t pmt_xy_size = (size_t) krnl_mat_size * (size_t) mm_max_n_vec;
     free(h2pack->pmt_x);
     free(h2pack->pmt_y);
@@ -512,14 +543,14 @@ void H2P_matmul(
         if (layout == CblasRowMajor)
         {
             size_t row_msize = sizeof(DTYPE) * curr_n_vec;
-            #pragma omp parallel for schedule(static)
+            #pragma omp parallel for schedule(static) num_threads(h2pack->n_thread)
             for (int i = 0; i < krnl_mat_size; i++)
             {
                 DTYPE *mat_y_i = pmt_y + i * ld_pmt;
                 memset(mat_y_i, 0, row_msize);
             }
         } else {
-            #pragma omp parallel
+            #pragma omp parallel num_threads(h2pack->n_thread)
             {
                 for (int i = 0; i < curr_n_vec; i++)
                 {
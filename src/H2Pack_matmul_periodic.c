@@ -14,6 +14,7 @@
 #include "utils.h"
 
 // H2 matmul intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
+// B_{ij} matrices are calculated just-in-time if h2pack->BD_JIT == 1
 void H2P_matmul_periodic_intmd_mult(
     H2Pack_p h2pack, const int n_vec, 
     const DTYPE *mat_x, const int ldx, const int x_row_stride, const CBLAS_TRANSPOSE x_trans,
@@ -25,6 +26,7 @@ void H2P_matmul_periodic_intmd_mult(
     int   n_point         = h2pack->n_point;
     int   n_node          = h2pack->n_node;
     int   n_thread        = h2pack->n_thread;
+    int   BD_JIT          = h2pack->BD_JIT;
     int   *node_level     = h2pack->node_level;
     int   *pt_cluster     = h2pack->pt_cluster;
     int   *mat_cluster    = h2pack->mat_cluster;
@@ -33,6 +35,8 @@ void H2P_matmul_periodic_intmd_mult(
     int   *B_p2i_rowptr   = h2pack->B_p2i_rowptr;
     int   *B_p2i_colidx   = h2pack->B_p2i_colidx;
     int   *B_p2i_val      = h2pack->B_p2i_val;
+    size_t *B_ptr         = h2pack->B_ptr;
+    DTYPE *B_data         = h2pack->B_data;
     DTYPE *coord          = h2pack->coord;
     DTYPE *per_adm_shifts = h2pack->per_adm_shifts;
     void  *krnl_param     = h2pack->krnl_param;
@@ -74,21 +78,35 @@ void H2P_matmul_periodic_intmd_mult(
 
                 int Bij_nrow = B_nrow[pair_idx];
                 int Bij_ncol = B_ncol[pair_idx];
-                H2P_dense_mat_resize(Bij, Bij_nrow, Bij_ncol);
+                // An empty skeleton set gives an empty B_{ij}, BLAS rejects its zero leading dimension
+                if (Bij_nrow == 0 || Bij_ncol == 0) continue;
+                DTYPE *Bij_data = NULL;
+                int   Bij_ld    = Bij_ncol;
+                if (BD_JIT == 1)
+                {
+                    H2P_dense_mat_resize(Bij, Bij_nrow, Bij_ncol);
+                    Bij_data = Bij->data;
+                    Bij_ld   = Bij->ld;
+                } else {
+                    Bij_data = B_data + B_ptr[pair_idx];
+                }
 
                 // (1) Two nodes are of the same level, compress on both sides
                 if (level0 == level1)
                 {
-                    H2P_dense_mat_copy(J_coord[node1], coord1_s);
-                    H2P_shift_coord(coord1_s, shift, 1.0);
-                    krnl_eval(
-                        J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
-                        coord1_s->data,       coord1_s->ld,       coord1_s->ncol,
-                        krnl_param, Bij->data, Bij->ld
-                    );
+                    if (BD_JIT == 1)
+                    {
+                        H2P_dense_mat_copy(J_coord[node1], coord1_s);
+                        H2P_shift_coord(coord1_s, shift, 1.0);
+                        krnl_eval(
+                            J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
+                            coord1_s->data,       coord1_s->ld,       coord1_s->ncol,
+                            krnl_param, Bij_data, Bij_ld
+                        );
+                    }
                     CBLAS_GEMM(
                         CblasRowMajor, CblasNoTrans, CblasNoTrans, Bij_nrow, n_vec, Bij_ncol,
-                        1.0, Bij->data, Bij->ld, y0_1->data, y0_1->ld, 1.0, y1_0->data, y1_0->ld
+                        1.0, Bij_data, Bij_ld, y0_1->data, y0_1->ld, 1.0, y1_0->data, y1_0->ld
                     );
                 }  // End of "if (level0 == level1)"
 
@@ -100,19 +118,22 @@ void H2P_matmul_periodic_intmd_mult(
                     int node1_npt = pt_cluster[node1 * 2 + 1] - pt_s1 + 1;
                     int vec_s1    = mat_cluster[node1 * 2];
                     
-                    H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
-                    copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
-                    H2P_shift_coord(coord1_s, shift, 1.0);
-
-                    krnl_eval(
-                        J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
-                        coord1_s->data,       coord1_s->ld,       coord1_s->ncol,
-                        krnl_param, Bij->data, Bij->ld
-                    );
+                    if (BD_JIT == 1)
+                    {
+                        H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
+                        copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
+                        H2P_shift_coord(coord1_s, shift, 1.0);
+
+                        krnl_eval(
+                            J_coord[node0]->data, J_coord[node0]->ld, J_coord[node0]->ncol,
+                            coord1_s->data,       coord1_s->ld,       coord1_s->ncol,
+                            krnl_param, Bij_data, Bij_ld
+                        );
+                    }
                     const DTYPE *mat_x_spos = mat_x + vec_s1 * x_row_stride;
                     CBLAS_GEMM(
                         CblasRowMajor, CblasNoTrans, x_trans, Bij_nrow, n_vec, Bij_ncol,
-                        1.0, Bij->data, Bij->ld, mat_x_spos, ldx, 1.0, y1_0->data, y1_0->ld
+                        1.0, Bij_data, Bij_ld, mat_x_spos, ldx, 1.0, y1_0->data, y1_0->ld
                     );
                 }  // End of "if (level0 > level1)"
 
@@ -124,25 +145,28 @@ void H2P_matmul_periodic_intmd_mult(
                     int node0_npt = pt_cluster[node0 * 2 + 1] - pt_s0 + 1;
                     int vec_s0    = mat_cluster[node0 * 2];
 
-                    H2P_dense_mat_copy(J_coord[node1], coord1_s);
-                    H2P_shift_coord(coord1_s, shift, 1.0);
+                    if (BD_JIT == 1)
+                    {
+                        H2P_dense_mat_copy(J_coord[node1], coord1_s);
+                        H2P_shift_coord(coord1_s, shift, 1.0);
 
-                    krnl_eval(
-                        coord + pt_s0,  n_point,      node0_npt,
-                        coord1_s->data, coord1_s->ld, coord1_s->ncol,
-                        krnl_param, Bij->data, Bij->ld
-                    );
+                        krnl_eval(
+                            coord + pt_s0,  n_point,      node0_npt,
+                            coord1_s->data, coord1_s->ld, coord1_s->ncol,
+                            krnl_param, Bij_data, Bij_ld
+                        );
+                    }
                     DTYPE *mat_y_spos = mat_y + vec_s0 * y_row_stride;
                     if (y_trans == CblasNoTrans)
                     {
                         CBLAS_GEMM(
                             CblasRowMajor, CblasNoTrans, CblasNoTrans, Bij_nrow, n_vec, Bij_ncol,
-                            1.0, Bij->data, Bij->ld, y0_1->data, y0_1->ld, 1.0, mat_y_spos, ldy
+                            1.0, Bij_data, Bij_ld, y0_1->data, y0_1->ld, 1.0, mat_y_spos, ldy
                         );
                     } else {
                         CBLAS_GEMM(
                             CblasRowMajor, CblasTrans, CblasTrans, n_vec, Bij_nrow, Bij_ncol,
-                            1.0, y0_1->data, y0_1->ld, Bij->data, Bij->ld, 1.0, mat_y_spos, ldy
+                            1.0, y0_1->data, y0_1->ld, Bij_data, Bij_ld, 1.0, mat_y_spos, ldy
                         );
                     }
                 }  // End of "if (level0 < level1)"
@@ -152,6 +176,7 @@ void H2P_matmul_periodic_intmd_mult(
 }
 
 // H2 matmul dense multiplication, calculate D_{ij} * x_j
+// D_{ij} matrices are calculated just-in-time if h2pack->BD_JIT == 1
 void H2P_matmul_periodic_dense_mult(
     H2Pack_p h2pack, const int n_vec, 
     const DTYPE *mat_x, const int ldx, const int x_row_stride, const CBLAS_TRANSPOSE x_trans,
@@ -164,6 +189,7 @@ void H2P_matmul_periodic_dense_mult(
     int   n_node            = h2pack->n_node;
     int   n_leaf_node       = h2pack->n_leaf_node;
     int   n_thread          = h2pack->n_thread;
+    int   BD_JIT            = h2pack->BD_JIT;
     int   *pt_cluster       = h2pack->pt_cluster;
     int   *mat_cluster      = h2pack->mat_cluster;
     int   *D_nrow           = h2pack->D_nrow;
@@ -171,6 +197,8 @@ void H2P_matmul_periodic_dense_mult(
     int   *D_p2i_rowptr     = h2pack->D_p2i_rowptr;
     int   *D_p2i_colidx     = h2pack->D_p2i_colidx;
     int   *D_p2i_val        = h2pack->D_p2i_val;
+    size_t *D_ptr           = h2pack->D_ptr;
+    DTYPE *D_data           = h2pack->D_data;
     DTYPE *coord            = h2pack->coord;
     DTYPE *per_inadm_shifts = h2pack->per_inadm_shifts;
     void  *krnl_param       = h2pack->krnl_param;
@@ -204,37 +232,47 @@ void H2P_matmul_periodic_dense_mult(
                 
                 int Dij_nrow = D_nrow[pair_idx];
                 int Dij_ncol = D_ncol[pair_idx];
-                H2P_dense_mat_resize(Dij, Dij_nrow, Dij_ncol);
+                DTYPE *Dij_data = NULL;
+                int   Dij_ld    = Dij_ncol;
 
-                if (pair_idx < n_leaf_node)
+                if (BD_JIT == 1)
                 {
-                    // (i, i) pair, no shift
-                    for (int k = 0; k < pt_dim; k++) shift[k] = 0.0;
+                    H2P_dense_mat_resize(Dij, Dij_nrow, Dij_ncol);
+                    Dij_data = Dij->data;
+                    Dij_ld   = Dij->ld;
+
+                    if (pair_idx < n_leaf_node)
+                    {
+                        // (i, i) pair, no shift
+                        for (int k = 0; k < pt_dim; k++) shift[k] = 0.0;
+                    } else {
+                        // The (pair_idx - n_leaf_node)-th inadmissible pair, need shifting
+                        DTYPE *per_inadm_shift_i = per_inadm_shifts + (pair_idx - n_leaf_node) * pt_dim;
+                        for (int k = 0; k < pt_dim; k++) shift[k] = per_inadm_shift_i[k];
+                    }
+
+                    H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
+                    copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
+                    H2P_shift_coord(coord1_s, shift, 1.0);
+                    krnl_eval(
+                        coord + pt_s0,  n_point,      node0_npt,
+                        coord1_s->data, coord1_s->ld, coord1_s->ncol,
+                        krnl_param, Dij_data, Dij_ld
+                    );
                 } else {
-                    // The (pair_idx - n_leaf_node)-th inadmissible pair, need shifting
-                    DTYPE *per_inadm_shift_i = per_inadm_shifts + (pair_idx - n_leaf_node) * pt_dim;
-                    for (int k = 0; k < pt_dim; k++) shift[k] = per_inadm_shift_i[k];
+                    Dij_data = D_data + D_ptr[pair_idx];
                 }
 
-                H2P_dense_mat_resize(coord1_s, xpt_dim, node1_npt);
-                copy_matrix_block(sizeof(DTYPE), xpt_dim, node1_npt, coord + pt_s1, n_point, coord1_s->data, coord1_s->ld);
-                H2P_shift_coord(coord1_s, shift, 1.0);
-                krnl_eval(
-                    coord + pt_s0,  n_point,      node0_npt,
-                    coord1_s->data, coord1_s->ld, coord1_s->ncol,
-                    krnl_param, Dij->data, Dij->ld
-                );
-
                 if (x_trans == CblasNoTrans)
                 {
                     CBLAS_GEMM(
                         CblasRowMajor, CblasNoTrans, CblasNoTrans, Dij_nrow, n_vec, Dij_ncol,
-                        1.0, Dij->data, Dij->ld, mat_x_spos, ldx, 1.0, mat_y_spos, ldy
+                        1.0, Dij_data, Dij_ld, mat_x_spos, ldx, 1.0, mat_y_spos, ldy
                     );
                 } else {
                     CBLAS_GEMM(
                         CblasRowMajor, CblasNoTrans, CblasTrans, n_vec, Dij_nrow, Dij_ncol,
-                        1.0, mat_x_spos, ldx, Dij->data, Dij->ld, 1.0, mat_y_spos, ldy
+                        1.0, mat_x_spos, ldx, Dij_data, Dij_ld, 1.0, mat_y_spos, ldy
                     );
                 }  // End of "if (x_trans == CblasNoTrans)"
             }  // End of i loop
@@ -303,14 +341,14 @@ void H2P_matmul_periodic(
         if (layout == CblasRowMajor)
         {
             size_t row_msize = sizeof(DTYPE) * curr_n_vec;
-            #pragma omp parallel for schedule(static)
+            #pragma omp parallel for schedule(static) num_threads(h2pack->n_thread)
             for (int i = 0; i < krnl_mat_size; i++)
             {
                 DTYPE *mat_y_i = pmt_y + i * ld_pmt;
                 memset(mat_y_i, 0, row_msize);
             }
         } else {
-            #pragma omp parallel
+            #pragma omp parallel num_threads(h2pack->n_thread)
             {
                 for (int i = 0; i < curr_n_vec; i++)
                 {
@@ -9,6 +9,7 @@
 #include "H2Pack_typedef.h"
 #include "H2Pack_aux_structs.h"
 #include "H2Pack_matvec.h"
+#include "H2Pack_HSS_matvec.h"
 #include "H2Pack_utils.h"
 #include "utils.h"
 
@@ -256,7 +257,7 @@ void H2P_matvec_init_y1(H2Pack_p h2pack)
         if (node_n_r_adm[i]) H2P_dense_mat_resize(y1[i], n_thread, U[i]->ncol);
     }
     // Each thread set its y1 buffer to 0 (NUMA first touch)
-    #pragma omp parallel
+    #pragma omp parallel num_threads(n_thread)
     {
         int tid = omp_get_thread_num();
         for (int i = 0; i < n_node; i++)
@@ -299,10 +300,11 @@ void H2P_matvec_sum_y1_thread(H2Pack_p h2pack)
     }
 }
 
-// Calculate H2 matvec intermediate multiplication task block on a thread
+// Calculate H2 matvec intermediate multiplication task block on a thread, 
+// B_blk_data holds the B matrices of this task block
 void H2P_matvec_intmd_mult_AOT_task_block(
-    H2Pack_p h2pack, const int tid, 
-    const int i_blk, const DTYPE *x, DTYPE *y
+    H2Pack_p h2pack, const int tid, const int i_blk, 
+    const DTYPE *B_blk_data, const DTYPE *x, DTYPE *y
 )
 {
     int    *r_adm_pairs = (h2pack->is_HSS) ? h2pack->HSS_r_adm_pairs : h2pack->r_adm_pairs;
@@ -311,7 +313,6 @@ void H2P_matvec_intmd_mult_AOT_task_block(
     int    *B_nrow      = h2pack->B_nrow;
     int    *B_ncol      = h2pack->B_ncol;
     size_t *B_ptr       = h2pack->B_ptr;
-    DTYPE  *B_data      = h2pack->B_data;
     H2P_int_vec_p B_blk = h2pack->B_blk;
     H2P_dense_mat_p *y0 = h2pack->y0;
     H2P_dense_mat_p *y1 = h2pack->y1;
@@ -325,7 +326,7 @@ void H2P_matvec_intmd_mult_AOT_task_block(
         int level0 = node_level[node0];
         int level1 = node_level[node1];
         
-        DTYPE *Bi = B_data + B_ptr[i];
+        const DTYPE *Bi = B_blk_data + (B_ptr[i] - B_ptr[B_blk_s]);
         int Bi_nrow = B_nrow[i];
         int Bi_ncol = B_ncol[i];
         
@@ -380,6 +381,8 @@ void H2P_matvec_intmd_mult_AOT_task_block(
     }  // End of i loop
 }
 
+static void H2P_matvec_ooc_stream(H2Pack_p h2pack, const int is_D, const DTYPE *x);
+
 // H2 matvec intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
 // All B_{ij} matrices have been calculated and stored
 void H2P_matvec_intmd_mult_AOT(H2Pack_p h2pack, const DTYPE *x)
@@ -396,27 +399,39 @@ void H2P_matvec_intmd_mult_AOT(H2Pack_p h2pack, const DTYPE *x)
     // partitioning and NUMA first-touch optimization, we also use the same static 
     // workload partitioning here for NUMA optimization. Otherwise, use OpenMP dynamic 
     // scheduler for load balance.
+    // If B matrices are out-of-core, stream them from the file chunk by chunk.
     const int n_B_blk = B_blk->length - 1;
-    #pragma omp parallel num_threads(n_thread)
+    if (h2pack->ooc_fd >= 0)
     {
-        int tid = omp_get_thread_num();
-        DTYPE *y = thread_buf[tid]->y;
-        
-        thread_buf[tid]->timer = -get_wtime_sec();
-
-        if (n_B_blk <= n_thread)
+        H2P_matvec_ooc_stream(h2pack, 0, x);
+    } else {
+        #pragma omp parallel num_threads(n_thread)
         {
-            int i_blk = tid;
-            if (i_blk < n_B_blk)
-                H2P_matvec_intmd_mult_AOT_task_block(h2pack, tid, i_blk, x, y);
-        } else {
-            #pragma omp for schedule(dynamic) nowait
-            for (int i_blk = 0; i_blk < n_B_blk; i_blk++)
-                H2P_matvec_intmd_mult_AOT_task_block(h2pack, tid, i_blk, x, y);
-        }
-        
-        thread_buf[tid]->timer += get_wtime_sec();
-    }  // End of "pragma omp parallel"
+            int tid = omp_get_thread_num();
+            DTYPE *y = thread_buf[tid]->y;
+            
+            thread_buf[tid]->timer = -get_wtime_sec();
+
+            if (n_B_blk <= n_thread)
+            {
+                int i_blk = tid;
+                if (i_blk < n_B_blk)
+                {
+                    const DTYPE *B_blk_data = h2pack->B_data + h2pack->B_ptr[B_blk->data[i_blk]];
+                    H2P_matvec_intmd_mult_AOT_task_block(h2pack, tid, i_blk, B_blk_data, x, y);
+                }
+            } else {
+                #pragma omp for schedule(dynamic) nowait
+                for (int i_blk = 0; i_blk < n_B_blk; i_blk++)
+                {
+                    const DTYPE *B_blk_data = h2pack->B_data + h2pack->B_ptr[B_blk->data[i_blk]];
+                    H2P_matvec_intmd_mult_AOT_task_block(h2pack, tid, i_blk, B_blk_data, x, y);
+                }
+            }
+            
+            thread_buf[tid]->timer += get_wtime_sec();
+        }  // End of "pragma omp parallel"
+    }  // End of "if (h2pack->ooc_fd >= 0)"
     
     // 3. Sum thread-local buffers in y1
     H2P_matvec_sum_y1_thread(h2pack);
@@ -860,10 +875,11 @@ void H2P_matvec_bwd_transform(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     }  // End of i loop
 }
 
-// Calculate H2 matvec dense multiplication part 0 task block on a thread
+// Calculate H2 matvec dense multiplication part 0 task block on a thread, 
+// D_blk_data holds the D matrices of this task block
 void H2P_matvec_dense_mult0_AOT_task_block(
-    H2Pack_p h2pack, const int tid, 
-    const int i_blk0, const DTYPE *x, DTYPE *y
+    H2Pack_p h2pack, const int tid, const int i_blk0, 
+    const DTYPE *D_blk_data, const DTYPE *x, DTYPE *y
 )
 {
     int    *leaf_nodes    = h2pack->height_nodes;
@@ -871,7 +887,6 @@ void H2P_matvec_dense_mult0_AOT_task_block(
     int    *D_nrow        = h2pack->D_nrow;
     int    *D_ncol        = h2pack->D_ncol;
     size_t *D_ptr         = h2pack->D_ptr;
-    DTYPE  *D_data        = h2pack->D_data;
     H2P_int_vec_p D_blk0  = h2pack->D_blk0;
     
     int D_blk0_s = D_blk0->data[i_blk0];
@@ -883,7 +898,7 @@ void H2P_matvec_dense_mult0_AOT_task_block(
         DTYPE       *y_spos = y + vec_s;
         const DTYPE *x_spos = x + vec_s;
         
-        DTYPE *Di = D_data + D_ptr[i];
+        const DTYPE *Di = D_blk_data + (D_ptr[i] - D_ptr[D_blk0_s]);
         int Di_nrow = D_nrow[i];
         int Di_ncol = D_ncol[i];
         
@@ -894,10 +909,11 @@ void H2P_matvec_dense_mult0_AOT_task_block(
     }
 }
 
-// Calculate H2 matvec dense multiplication part 1 task block on a thread
+// Calculate H2 matvec dense multiplication part 1 task block on a thread, 
+// D_blk_data holds the D matrices of this task block
 void H2P_matvec_dense_mult1_AOT_task_block(
-    H2Pack_p h2pack, const int tid, 
-    const int i_blk1, const DTYPE *x, DTYPE *y
+    H2Pack_p h2pack, const int tid, const int i_blk1, 
+    const DTYPE *D_blk_data, const DTYPE *x, DTYPE *y
 )
 {
     int    n_leaf_node    = h2pack->n_leaf_node;
@@ -906,7 +922,6 @@ void H2P_matvec_dense_mult1_AOT_task_block(
     int    *D_nrow        = h2pack->D_nrow;
     int    *D_ncol        = h2pack->D_ncol;
     size_t *D_ptr         = h2pack->D_ptr;
-    DTYPE  *D_data        = h2pack->D_data;
     H2P_int_vec_p D_blk1  = h2pack->D_blk1;
     
     int D_blk1_s = D_blk1->data[i_blk1];
@@ -922,7 +937,7 @@ void H2P_matvec_dense_mult1_AOT_task_block(
         const DTYPE *x_spos0 = x + vec_s0;
         const DTYPE *x_spos1 = x + vec_s1;
         
-        DTYPE *Di = D_data + D_ptr[n_leaf_node + i];
+        const DTYPE *Di = D_blk_data + (D_ptr[n_leaf_node + i] - D_ptr[n_leaf_node + D_blk1_s]);
         int Di_nrow = D_nrow[n_leaf_node + i];
         int Di_ncol = D_ncol[n_leaf_node + i];
         
@@ -933,6 +948,88 @@ void H2P_matvec_dense_mult1_AOT_task_block(
     }
 }
 
+// Stream out-of-core B or D matrices from the file and multiply them. Chunk i+1 is 
+// read into one half of h2pack->ooc_buf by one thread while the other threads 
+// compute the task blocks of chunk i in the other half, then the I/O thread joins 
+// the computation. The implicit barrier of the task block loop ends each step.
+// Input parameters:
+//   h2pack : H2Pack structure loaded by H2P_load_out_of_core()
+//   is_D   : 0 for intermediate multiplication, 1 for dense multiplication
+//   x      : Input vector, same as H2P_matvec_intmd_mult_AOT() or H2P_matvec_dense_mult_AOT()
+// Output parameter:
+//   h2pack : H2Pack structure with results accumulated to y1 and thread buffers
+static void H2P_matvec_ooc_stream(H2Pack_p h2pack, const int is_D, const DTYPE *x)
+{
+    int    n_thread     = h2pack->n_thread;
+    int    n_D0_blk     = h2pack->D_blk0->length - 1;
+    size_t ooc_buf_size = h2pack->ooc_buf_size;
+    DTYPE  *ooc_buf     = h2pack->ooc_buf;
+    H2P_int_vec_p    chunk      = is_D ? h2pack->ooc_D_chunk : h2pack->ooc_B_chunk;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    const int n_chunk = chunk->length - 1;
+    int io_err = 0;
+    double io_t = 0.0;
+    if (n_chunk > 0)
+    {
+        size_t spos = H2P_ooc_blk_spos(h2pack, is_D, chunk->data[0]);
+        size_t epos = H2P_ooc_blk_spos(h2pack, is_D, chunk->data[1]);
+        io_t -= get_wtime_sec();
+        io_err += H2P_ooc_read(h2pack, is_D, spos, epos - spos, ooc_buf);
+        io_t += get_wtime_sec();
+    }
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        DTYPE *y = thread_buf[tid]->y;
+        
+        thread_buf[tid]->timer = -get_wtime_sec();
+
+        for (int i_chunk = 0; i_chunk < n_chunk; i_chunk++)
+        {
+            DTYPE *chunk_buf  = ooc_buf + (size_t) (i_chunk % 2) * ooc_buf_size;
+            int   chunk_sblk  = chunk->data[i_chunk];
+            int   chunk_eblk  = chunk->data[i_chunk + 1];
+            size_t chunk_spos = H2P_ooc_blk_spos(h2pack, is_D, chunk_sblk);
+
+            // Prefetch the next chunk
+            #pragma omp single nowait
+            if (i_chunk + 1 < n_chunk)
+            {
+                size_t spos = H2P_ooc_blk_spos(h2pack, is_D, chunk->data[i_chunk + 1]);
+                size_t epos = H2P_ooc_blk_spos(h2pack, is_D, chunk->data[i_chunk + 2]);
+                DTYPE *next_buf = ooc_buf + (size_t) ((i_chunk + 1) % 2) * ooc_buf_size;
+                io_t -= get_wtime_sec();
+                io_err += H2P_ooc_read(h2pack, is_D, spos, epos - spos, next_buf);
+                io_t += get_wtime_sec();
+            }
+
+            #pragma omp for schedule(dynamic)
+            for (int i_blk = chunk_sblk; i_blk < chunk_eblk; i_blk++)
+            {
+                const DTYPE *blk_data = chunk_buf + (H2P_ooc_blk_spos(h2pack, is_D, i_blk) - chunk_spos);
+                if (is_D == 0)
+                    H2P_matvec_intmd_mult_AOT_task_block(h2pack, tid, i_blk, blk_data, x, y);
+                else if (i_blk < n_D0_blk)
+                    H2P_matvec_dense_mult0_AOT_task_block(h2pack, tid, i_blk, blk_data, x, y);
+                else
+                    H2P_matvec_dense_mult1_AOT_task_block(h2pack, tid, i_blk - n_D0_blk, blk_data, x, y);
+            }
+        }  // End of i_chunk loop
+
+        thread_buf[tid]->timer += get_wtime_sec();
+    }  // End of "pragma omp parallel"
+
+    if (io_err != 0) ERROR_PRINTF("Failed to read out-of-core %c matrices, matvec result is invalid\n", is_D ? 'D' : 'B');
+    if (h2pack->print_timers == 1)
+    {
+        INFO_PRINTF(
+            "Matvec out-of-core %c matrices: %d chunks, %.2lf (MB), read time %.3lf (s)\n", is_D ? 'D' : 'B', n_chunk, 
+            (double) sizeof(DTYPE) * (double) H2P_ooc_blk_spos(h2pack, is_D, chunk->data[n_chunk]) / 1048576.0, io_t
+        );
+    }
+}
+
 // H2 matvec dense multiplication, calculate D_{ij} * x_j
 // All D_{ij} matrices have been calculated and stored
 void H2P_matvec_dense_mult_AOT(H2Pack_p h2pack, const DTYPE *x)
@@ -946,41 +1043,62 @@ void H2P_matvec_dense_mult_AOT(H2Pack_p h2pack, const DTYPE *x)
     // H2Pack using a static workload partitioning and NUMA first-touch optimization,
     // we also use the same static workload partitioning here for NUMA optimization.
     // Otherwise, use OpenMP dynamic scheduler for load balance.
+    // If D matrices are out-of-core, stream them from the file chunk by chunk.
     const int n_D0_blk = D_blk0->length - 1;
     const int n_D1_blk = D_blk1->length - 1;
-    #pragma omp parallel num_threads(n_thread)
+    int    n_leaf_node = h2pack->n_leaf_node;
+    size_t *D_ptr      = h2pack->D_ptr;
+    DTYPE  *D_data     = h2pack->D_data;
+    if (h2pack->ooc_fd >= 0)
     {
-        int tid = omp_get_thread_num();
-        DTYPE *y = thread_buf[tid]->y;
-        
-        thread_buf[tid]->timer = -get_wtime_sec();
-        
-        // 1. Diagonal blocks matvec
-        if (n_D0_blk <= n_thread)
-        {
-            int i_blk0 = tid;
-            if (i_blk0 < n_D0_blk)
-                H2P_matvec_dense_mult0_AOT_task_block(h2pack, tid, i_blk0, x, y);
-        } else {
-            #pragma omp for schedule(dynamic) nowait
-            for (int i_blk0 = 0; i_blk0 < n_D0_blk; i_blk0++)
-                H2P_matvec_dense_mult0_AOT_task_block(h2pack, tid, i_blk0, x, y);
-        } // End of "if (n_D0_blk-1 <= n_thread)"
-        
-        // 2. Off-diagonal blocks from inadmissible pairs matvec
-        if (n_D1_blk <= n_thread)
+        H2P_matvec_ooc_stream(h2pack, 1, x);
+    } else {
+        #pragma omp parallel num_threads(n_thread)
         {
-            int i_blk1 = tid;
-            if (i_blk1 < n_D1_blk)
-                H2P_matvec_dense_mult1_AOT_task_block(h2pack, tid, i_blk1, x, y);
-        } else {
-            #pragma omp for schedule(dynamic) nowait
-            for (int i_blk1 = 0; i_blk1 < n_D1_blk; i_blk1++)
-                H2P_matvec_dense_mult1_AOT_task_block(h2pack, tid, i_blk1, x, y);
-        }  // End of "if (n_D1_blk-1 <= n_thread)"
-        
-        thread_buf[tid]->timer += get_wtime_sec();
-    }  // End of "pragma omp parallel"
+            int tid = omp_get_thread_num();
+            DTYPE *y = thread_buf[tid]->y;
+            
+            thread_buf[tid]->timer = -get_wtime_sec();
+            
+            // 1. Diagonal blocks matvec
+            if (n_D0_blk <= n_thread)
+            {
+                int i_blk0 = tid;
+                if (i_blk0 < n_D0_blk)
+                {
+                    const DTYPE *D_blk_data = D_data + D_ptr[D_blk0->data[i_blk0]];
+                    H2P_matvec_dense_mult0_AOT_task_block(h2pack, tid, i_blk0, D_blk_data, x, y);
+                }
+            } else {
+                #pragma omp for schedule(dynamic) nowait
+                for (int i_blk0 = 0; i_blk0 < n_D0_blk; i_blk0++)
+                {
+                    const DTYPE *D_blk_data = D_data + D_ptr[D_blk0->data[i_blk0]];
+                    H2P_matvec_dense_mult0_AOT_task_block(h2pack, tid, i_blk0, D_blk_data, x, y);
+                }
+            } // End of "if (n_D0_blk-1 <= n_thread)"
+            
+            // 2. Off-diagonal blocks from inadmissible pairs matvec
+            if (n_D1_blk <= n_thread)
+            {
+                int i_blk1 = tid;
+                if (i_blk1 < n_D1_blk)
+                {
+                    const DTYPE *D_blk_data = D_data + D_ptr[n_leaf_node + D_blk1->data[i_blk1]];
+                    H2P_matvec_dense_mult1_AOT_task_block(h2pack, tid, i_blk1, D_blk_data, x, y);
+                }
+            } else {
+                #pragma omp for schedule(dynamic) nowait
+                for (int i_blk1 = 0; i_blk1 < n_D1_blk; i_blk1++)
+                {
+                    const DTYPE *D_blk_data = D_data + D_ptr[n_leaf_node + D_blk1->data[i_blk1]];
+                    H2P_matvec_dense_mult1_AOT_task_block(h2pack, tid, i_blk1, D_blk_data, x, y);
+                }
+            }  // End of "if (n_D1_blk-1 <= n_thread)"
+            
+            thread_buf[tid]->timer += get_wtime_sec();
+        }  // End of "pragma omp parallel"
+    }  // End of "if (h2pack->ooc_fd >= 0)"
     
     if (h2pack->print_timers == 1)
     {
@@ -1179,6 +1297,13 @@ void H2P_matvec(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     DTYPE *x_ = need_trans ? xT : pmt_x;
     DTYPE *y_ = need_trans ? yT : pmt_y;
 
+    // HSS matrix with sibling couplings only, use the specialized HSS matvec
+    if (h2pack->is_HSS == 1 && H2P_HSS_matvec_init(h2pack) == 1)
+    {
+        H2P_HSS_matvec(h2pack, x, y);
+        return;
+    }
+
     // 1. Forward permute the input vector
     st = get_wtime_sec();
     H2P_permute_vector_forward(h2pack, x, pmt_x);
@@ -1191,6 +1316,7 @@ void H2P_matvec(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     #pragma omp parallel num_threads(n_thread)
     {
         int tid = omp_get_thread_num();
+        H2P_thread_buf_alloc_y(thread_buf[tid], krnl_mat_size);
         DTYPE *tid_y = thread_buf[tid]->y;
         memset(tid_y, 0, sizeof(DTYPE) * krnl_mat_size);
         
@@ -1266,7 +1392,7 @@ void H2P_matvec(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     if (need_trans)
     {
         H2P_transpose_dmat(n_thread, krnl_dim, n_point, yT, n_point, xT, krnl_dim);
-        #pragma omp parallel for simd
+        #pragma omp parallel for simd num_threads(n_thread)
         for (int i = 0; i < krnl_mat_size; i++) pmt_y[i] += xT[i];
         mat_size[MV_VOP_SIZE_IDX] += 4 * krnl_mat_size;
     }
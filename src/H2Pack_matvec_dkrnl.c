@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_matvec.h"
+#include "H2Pack_matmul.h"
+#include "H2Pack_HSS_matvec.h"
+#include "H2Pack_matvec_dkrnl.h"
+#include "H2Pack_utils.h"
+#include "utils.h"
+
+// Set the kernel functions and B & D matrices of exec to the k-th derivative 
+// kernel (the original kernel in h2pack if k == -1)
+static void H2P_dkrnl_exec_set(H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, H2Pack_p exec)
+{
+    if (k == -1)
+    {
+        exec->krnl_param      = h2pack->krnl_param;
+        exec->B_data          = h2pack->B_data;
+        exec->D_data          = h2pack->D_data;
+        exec->krnl_bimv_flops = h2pack->krnl_bimv_flops;
+        exec->krnl_eval       = h2pack->krnl_eval;
+        exec->krnl_bimv       = h2pack->krnl_bimv;
+    } else {
+        exec->krnl_param      = dkrnl->dkrnl_param[k];
+        exec->B_data          = dkrnl->B_data[k];
+        exec->D_data          = dkrnl->D_data[k];
+        exec->krnl_bimv_flops = dkrnl->dkrnl_bimv_flops[k];
+        exec->krnl_eval       = dkrnl->dkrnl_eval[k];
+        exec->krnl_bimv       = dkrnl->dkrnl_bimv[k];
+    }
+}
+
+// Initialize exec as a shallow copy of h2pack whose kernel functions and B & D
+// matrices are those of the k-th derivative kernel (the original kernel if k == -1). 
+// h2pack is not modified, so other callers (e.g., H2P_matvec_ws_init()) never see 
+// a derivative kernel in h2pack.
+static void H2P_dkrnl_exec_init(H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, H2Pack_p exec)
+{
+    memcpy(exec, h2pack, sizeof(H2Pack_s));
+    H2P_dkrnl_exec_set(h2pack, dkrnl, k, exec);
+}
+
+// Keep the matvec buffers allocated and the statistics accumulated in exec in h2pack
+static void H2P_dkrnl_exec_sync(H2Pack_p h2pack, H2Pack_p exec)
+{
+    h2pack->y0          = exec->y0;
+    h2pack->y1          = exec->y1;
+    h2pack->pmt_x       = exec->pmt_x;
+    h2pack->pmt_y       = exec->pmt_y;
+    h2pack->HSS_mv_buf  = exec->HSS_mv_buf;
+    h2pack->HSS_mv_nvec = exec->HSS_mv_nvec;
+    h2pack->n_matvec    = exec->n_matvec;
+    memcpy(h2pack->timers,   exec->timers,   sizeof(h2pack->timers));
+    memcpy(h2pack->mat_size, exec->mat_size, sizeof(h2pack->mat_size));
+}
+
+// Build the derivative kernel matrices of a H2 / HSS matrix
+void H2P_dkrnl_build(
+    H2Pack_p h2pack, const int n_dkrnl, void **dkrnl_param, kernel_eval_fptr *dkrnl_eval,
+    kernel_bimv_fptr *dkrnl_bimv, const int *dkrnl_bimv_flops, H2P_dkrnl_p *dkrnl_
+)
+{
+    *dkrnl_ = NULL;
+    if (h2pack->U == NULL)
+    {
+        ERROR_PRINTF("H2Pack matrix is not constructed yet.\n");
+        return;
+    }
+    if (h2pack->krnl_dim != 1)
+    {
+        ERROR_PRINTF("Only support krnl_dim == 1 for the moment.\n");
+        return;
+    }
+    if (n_dkrnl < 1 || dkrnl_param == NULL || dkrnl_eval == NULL)
+    {
+        ERROR_PRINTF("Invalid derivative kernel input.\n");
+        return;
+    }
+
+    H2P_dkrnl_p dkrnl = (H2P_dkrnl_p) malloc(sizeof(H2P_dkrnl_s));
+    ASSERT_PRINTF(dkrnl != NULL, "Failed to allocate H2P_dkrnl structure\n");
+    dkrnl->n_dkrnl          = n_dkrnl;
+    dkrnl->BD_JIT           = h2pack->BD_JIT;
+    dkrnl->dkrnl_bimv_flops = (int*)   malloc(sizeof(int)    * n_dkrnl);
+    dkrnl->dkrnl_param      = (void**) malloc(sizeof(void*)  * n_dkrnl);
+    dkrnl->B_data           = (DTYPE**) malloc(sizeof(DTYPE*) * n_dkrnl);
+    dkrnl->D_data           = (DTYPE**) malloc(sizeof(DTYPE*) * n_dkrnl);
+    dkrnl->dkrnl_eval       = (kernel_eval_fptr*) malloc(sizeof(kernel_eval_fptr) * n_dkrnl);
+    dkrnl->dkrnl_bimv       = (kernel_bimv_fptr*) malloc(sizeof(kernel_bimv_fptr) * n_dkrnl);
+    ASSERT_PRINTF(
+        dkrnl->dkrnl_bimv_flops != NULL && dkrnl->dkrnl_param != NULL && dkrnl->B_data != NULL &&
+        dkrnl->D_data != NULL && dkrnl->dkrnl_eval != NULL && dkrnl->dkrnl_bimv != NULL,
+        "Failed to allocate arrays for %d derivative kernels\n", n_dkrnl
+    );
+    for (int k = 0; k < n_dkrnl; k++)
+    {
+        dkrnl->dkrnl_param[k]      = dkrnl_param[k];
+        dkrnl->dkrnl_eval[k]       = dkrnl_eval[k];
+        dkrnl->dkrnl_bimv[k]       = (dkrnl_bimv == NULL) ? NULL : dkrnl_bimv[k];
+        dkrnl->dkrnl_bimv_flops[k] = (dkrnl_bimv_flops == NULL) ? 0 : dkrnl_bimv_flops[k];
+        dkrnl->B_data[k]           = NULL;
+        dkrnl->D_data[k]           = NULL;
+    }
+
+    // The B & D metadata (B_blk, B_ptr, D_blk0, D_blk1, D_ptr) only depend on the
+    // partitioning and the skeleton points, so all derivative kernels share them
+    if (dkrnl->BD_JIT == 0)
+    {
+        double st, et;
+        H2Pack_s exec;
+        for (int k = 0; k < n_dkrnl; k++)
+        {
+            H2P_dkrnl_exec_init(h2pack, dkrnl, k, &exec);
+            st = get_wtime_sec();
+            H2P_build_B_AOT(&exec);
+            et = get_wtime_sec();
+            h2pack->timers[B_BUILD_TIMER_IDX] += et - st;
+            st = get_wtime_sec();
+            H2P_build_D_AOT(&exec);
+            et = get_wtime_sec();
+            h2pack->timers[D_BUILD_TIMER_IDX] += et - st;
+            dkrnl->B_data[k] = exec.B_data;
+            dkrnl->D_data[k] = exec.D_data;
+        }
+    }
+
+    *dkrnl_ = dkrnl;
+}
+
+// Destroy a H2P_dkrnl structure
+void H2P_dkrnl_destroy(H2P_dkrnl_p *dkrnl_)
+{
+    H2P_dkrnl_p dkrnl = *dkrnl_;
+    if (dkrnl == NULL) return;
+    for (int k = 0; k < dkrnl->n_dkrnl; k++)
+    {
+        free_aligned(dkrnl->B_data[k]);
+        free_aligned(dkrnl->D_data[k]);
+    }
+    free(dkrnl->dkrnl_bimv_flops);
+    free(dkrnl->dkrnl_param);
+    free(dkrnl->B_data);
+    free(dkrnl->D_data);
+    free(dkrnl->dkrnl_eval);
+    free(dkrnl->dkrnl_bimv);
+    free(dkrnl);
+    *dkrnl_ = NULL;
+}
+
+// H2 / HSS representation and its derivative kernel matrices multiply a column vector
+void H2P_matvec_dkrnl(H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const DTYPE *x, DTYPE *y, DTYPE *dy, const int lddy)
+{
+    // All kernels are applied through exec, h2pack itself is never modified
+    H2Pack_s exec_s;
+    H2Pack_p exec = &exec_s;
+    H2P_dkrnl_exec_init(h2pack, dkrnl, -1, exec);
+
+    double st, et;
+    int    krnl_mat_size = exec->krnl_mat_size;
+    int    n_thread      = exec->n_thread;
+    int    BD_JIT        = dkrnl->BD_JIT;
+    int    n_dkrnl       = dkrnl->n_dkrnl;
+    DTYPE  *pmt_x        = exec->pmt_x;
+    DTYPE  *pmt_y        = exec->pmt_y;
+    double *timers       = exec->timers;
+    size_t *mat_size     = exec->mat_size;
+    H2P_thread_buf_p *thread_buf = exec->tb;
+
+    if (h2pack->krnl_dim != 1)
+    {
+        ERROR_PRINTF("Only support krnl_dim == 1 for the moment.\n");
+        return;
+    }
+    if (lddy < krnl_mat_size)
+    {
+        ERROR_PRINTF("lddy = %d < krnl_mat_size = %d\n", lddy, krnl_mat_size);
+        return;
+    }
+
+    // 1. Forward permute the input vector
+    st = get_wtime_sec();
+    H2P_permute_vector_forward(exec, x, pmt_x);
+    et = get_wtime_sec();
+    timers[MV_VOP_TIMER_IDX] += et - st;
+    mat_size[MV_VOP_SIZE_IDX] += 2 * krnl_mat_size;
+
+    // 2. Forward transformation, calculate U_j^T * x_j. y0 only depends on
+    //    U and x, so it is shared by the original kernel and all derivative kernels
+    st = get_wtime_sec();
+    H2P_matvec_fwd_transform(exec, pmt_x);
+    et = get_wtime_sec();
+    timers[MV_FWD_TIMER_IDX] += et - st;
+
+    // 3. Apply the original kernel (k == -1) and each derivative kernel
+    for (int k = (y == NULL) ? 0 : -1; k < n_dkrnl; k++)
+    {
+        DTYPE *y_k = (k == -1) ? y : (dy + (size_t) k * (size_t) lddy);
+        H2P_dkrnl_exec_set(h2pack, dkrnl, k, exec);
+
+        // (1) Reset partial y result in each thread-local buffer to 0
+        st = get_wtime_sec();
+        #pragma omp parallel num_threads(n_thread)
+        {
+            int tid = omp_get_thread_num();
+            H2P_thread_buf_alloc_y(thread_buf[tid], krnl_mat_size);
+            memset(thread_buf[tid]->y, 0, sizeof(DTYPE) * krnl_mat_size);
+
+            #pragma omp for
+            for (int i = 0; i < krnl_mat_size; i++) pmt_y[i] = 0;
+        }
+        mat_size[MV_VOP_SIZE_IDX] += (1 + n_thread) * krnl_mat_size;
+        et = get_wtime_sec();
+        timers[MV_VOP_TIMER_IDX] += et - st;
+
+        // (2) Intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
+        st = get_wtime_sec();
+        if (BD_JIT == 1) H2P_matvec_intmd_mult_JIT(exec, pmt_x);
+        else H2P_matvec_intmd_mult_AOT(exec, pmt_x);
+        et = get_wtime_sec();
+        timers[MV_MID_TIMER_IDX] += et - st;
+
+        // (3) Backward transformation, calculate U_i * (B_{ij} * (U_j^T * x_j))
+        st = get_wtime_sec();
+        H2P_matvec_bwd_transform(exec, pmt_x, pmt_y);
+        et = get_wtime_sec();
+        timers[MV_BWD_TIMER_IDX] += et - st;
+
+        // (4) Dense multiplication, calculate D_i * x_i
+        st = get_wtime_sec();
+        if (BD_JIT == 1) H2P_matvec_dense_mult_JIT(exec, pmt_x);
+        else H2P_matvec_dense_mult_AOT(exec, pmt_x);
+        et = get_wtime_sec();
+        timers[MV_DEN_TIMER_IDX] += et - st;
+
+        // (5) Reduce sum partial y results and backward permute the output vector
+        st = get_wtime_sec();
+        #pragma omp parallel num_threads(n_thread)
+        {
+            int tid = omp_get_thread_num();
+            int blk_spos, blk_len;
+            calc_block_spos_len(krnl_mat_size, n_thread, tid, &blk_spos, &blk_len);
+
+            for (int tid = 0; tid < n_thread; tid++)
+            {
+                DTYPE *y_src = thread_buf[tid]->y;
+                #pragma omp simd
+                for (int i = blk_spos; i < blk_spos + blk_len; i++) pmt_y[i] += y_src[i];
+            }
+        }
+        mat_size[MV_VOP_SIZE_IDX] += (2 * n_thread + 1) * krnl_mat_size;
+        H2P_permute_vector_backward(exec, pmt_y, y_k);
+        et = get_wtime_sec();
+        timers[MV_VOP_TIMER_IDX] += et - st;
+
+        exec->n_matvec++;
+    }
+
+    H2P_dkrnl_exec_sync(h2pack, exec);
+}
+
+// A derivative kernel matrix of a H2 / HSS matrix multiplies a dense general matrix
+void H2P_matmul_dkrnl(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, const CBLAS_LAYOUT layout, 
+    const int n_vec, const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+)
+{
+    if (k < 0 || k >= dkrnl->n_dkrnl)
+    {
+        ERROR_PRINTF("Invalid derivative kernel index %d, n_dkrnl = %d\n", k, dkrnl->n_dkrnl);
+        return;
+    }
+    // Prepare the HSS matvec metadata in h2pack so it is shared with exec instead 
+    // of being allocated in exec and lost
+    if (h2pack->is_HSS == 1)
+    {
+        #pragma omp critical(H2P_HSS_matvec_init)
+        H2P_HSS_matvec_init(h2pack);
+    }
+    H2Pack_s exec;
+    H2P_dkrnl_exec_init(h2pack, dkrnl, k, &exec);
+    H2P_matmul(&exec, layout, n_vec, mat_x, ldx, mat_y, ldy);
+    H2P_dkrnl_exec_sync(h2pack, &exec);
+}
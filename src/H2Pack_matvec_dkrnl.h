@@ -0,0 +1,102 @@
+#ifndef __H2PACK_MATVEC_DKRNL_H__
+#define __H2PACK_MATVEC_DKRNL_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Derivative kernels of a H2 / HSS matrix w.r.t. kernel hyperparameters.
+// Each derivative kernel dK/dp_k reuses the hierarchical partitioning, the
+// projection matrices U and the skeleton points J of the original H2 / HSS
+// matrix, only its generator matrices B and dense blocks D are different.
+// The U bases and skeleton points are selected for K, not for dK/dp_k, so the 
+// accuracy of dK/dp_k * x is NOT controlled by the QR stop tolerance of the 
+// H2 / HSS matrix. The relative error of dK/dp_k * x can be 10 to several 
+// thousand times larger than that of K * x, e.g., about 1e-4 to 3e-4 for a 3D 
+// Gaussian kernel HSS matrix built with QR_REL_NRM tolerance 1e-8 (test_dkrnl.c 
+// in extra/). 
+// If a higher accuracy is needed, build another H2Pack structure that uses 
+// the derivative kernel as its kernel with H2P_build() and use H2P_matvec().
+// The derivative kernel functions and B & D matrices are only used through a 
+// local copy of the H2Pack structure, the kernel and B & D matrices of h2pack 
+// are never modified. Like H2P_matvec(), H2P_matvec_dkrnl() and H2P_matmul_dkrnl() 
+// use the matvec buffers of h2pack, use H2P_matvec_ws_init() workspaces for 
+// concurrent multiplications with the original kernel.
+struct H2P_dkrnl
+{
+    int    n_dkrnl;             // Number of derivative kernels
+    int    BD_JIT;              // If B and D matrices are computed just-in-time in matvec
+    int    *dkrnl_bimv_flops;   // Size n_dkrnl, FLOPs needed in each derivative kernel bi-matvec
+    void   **dkrnl_param;       // Size n_dkrnl, pointer to each derivative kernel parameter array
+    DTYPE  **B_data;            // Size n_dkrnl, data of all B matrices of each derivative kernel, NULL if BD_JIT == 1
+    DTYPE  **D_data;            // Size n_dkrnl, data of all D matrices of each derivative kernel, NULL if BD_JIT == 1
+    kernel_eval_fptr *dkrnl_eval;   // Size n_dkrnl, each derivative kernel matrix evaluation function
+    kernel_bimv_fptr *dkrnl_bimv;   // Size n_dkrnl, each derivative kernel matrix bi-matvec function
+};
+typedef struct H2P_dkrnl  H2P_dkrnl_s;
+typedef struct H2P_dkrnl* H2P_dkrnl_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Build the derivative kernel matrices of a H2 / HSS matrix
+// Input parameters:
+//   h2pack           : H2Pack structure with H2 / HSS representation matrices
+//   n_dkrnl          : Number of derivative kernels
+//   dkrnl_param      : Size n_dkrnl, pointer to each derivative kernel parameter array
+//   dkrnl_eval       : Size n_dkrnl, pointer to each derivative kernel matrix evaluation function
+//   dkrnl_bimv       : Size n_dkrnl, pointer to each derivative kernel matrix bi-matvec function,
+//                      can be NULL or have NULL entries
+//   dkrnl_bimv_flops : Size n_dkrnl, FLOPs needed in each derivative kernel bi-matvec
+// Output parameter:
+//   dkrnl_ : Constructed H2P_dkrnl structure. If h2pack->BD_JIT == 0, the B and D
+//            matrices of all derivative kernels are computed and stored.
+// Note:
+//   1. Only kernels with krnl_dim == 1 are supported for the moment.
+//   2. dkrnl_param[k] should remain valid until H2P_dkrnl_destroy() is called.
+//   3. The U bases and skeleton points of h2pack are reused, see the accuracy 
+//      note of struct H2P_dkrnl above.
+void H2P_dkrnl_build(
+    H2Pack_p h2pack, const int n_dkrnl, void **dkrnl_param, kernel_eval_fptr *dkrnl_eval,
+    kernel_bimv_fptr *dkrnl_bimv, const int *dkrnl_bimv_flops, H2P_dkrnl_p *dkrnl_
+);
+
+// Destroy a H2P_dkrnl structure
+// Input parameter:
+//   dkrnl_ : Pointer to a H2P_dkrnl structure to be destroyed
+void H2P_dkrnl_destroy(H2P_dkrnl_p *dkrnl_);
+
+// H2 / HSS representation and its derivative kernel matrices multiply a column vector.
+// The forward transformation U^T * x is computed once and shared by all kernels.
+// Input parameters:
+//   h2pack : H2Pack structure with H2 / HSS representation matrices
+//   dkrnl  : H2P_dkrnl structure constructed by H2P_dkrnl_build() with h2pack
+//   x      : Input dense vector
+//   lddy   : Leading dimension of dy, >= h2pack->krnl_mat_size
+// Output parameters:
+//   y  : Output dense vector, y = K * x. Can be NULL if K * x is not needed.
+//   dy : Size >= dkrnl->n_dkrnl * lddy, the k-th column (stored in dy + k * lddy)
+//        is dK/dp_k * x
+void H2P_matvec_dkrnl(H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const DTYPE *x, DTYPE *y, DTYPE *dy, const int lddy);
+
+// The k-th derivative kernel matrix of a H2 / HSS matrix multiplies a dense general 
+// matrix, mat_y := dK/dp_k * mat_x, see H2P_matmul() for layout and leading dimensions
+// Input parameters:
+//   h2pack : H2Pack structure with H2 / HSS representation matrices
+//   dkrnl  : H2P_dkrnl structure constructed by H2P_dkrnl_build() with h2pack
+//   k      : Index of the derivative kernel, 0 <= k < dkrnl->n_dkrnl
+//   layout : CblasRowMajor/CblasColMajor if mat_x & mat_y are stored in row/column-major style
+//   n_vec  : Number of column vectors in mat_x
+//   mat_x  : Input dense matrix, leading dimension ldx
+// Output parameter:
+//   mat_y  : Output dense matrix, leading dimension ldy
+void H2P_matmul_dkrnl(
+    H2Pack_p h2pack, H2P_dkrnl_p dkrnl, const int k, const CBLAS_LAYOUT layout, 
+    const int n_vec, const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -390,6 +390,138 @@ void H2P_matvec_periodic_dense_mult_JIT(H2Pack_p h2pack, const DTYPE *x, DTYPE *
     }
 }
 
+// H2 matvec intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
+// All B_{ij} matrices have been calculated and stored
+void H2P_matvec_periodic_intmd_mult_AOT(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
+{
+    int    n_node        = h2pack->n_node;
+    int    n_thread      = h2pack->n_thread;
+    int    *node_level   = h2pack->node_level;
+    int    *mat_cluster  = h2pack->mat_cluster;
+    int    *B_nrow       = h2pack->B_nrow;
+    int    *B_ncol       = h2pack->B_ncol;
+    int    *B_p2i_rowptr = h2pack->B_p2i_rowptr;
+    int    *B_p2i_colidx = h2pack->B_p2i_colidx;
+    int    *B_p2i_val    = h2pack->B_p2i_val;
+    size_t *B_ptr        = h2pack->B_ptr;
+    DTYPE  *B_data       = h2pack->B_data;
+    H2P_dense_mat_p  *y0 = h2pack->y0;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    H2P_matvec_init_y1(h2pack);
+    H2P_dense_mat_p *y1 = h2pack->y1;
+
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+
+        thread_buf[tid]->timer = -get_wtime_sec();
+
+        // Each node0 only writes to y1[node0] or its own part of y (if node0 is 
+        // a leaf node), so no thread-local output buffer is needed
+        #pragma omp for schedule(dynamic)
+        for (int node0 = 0; node0 < n_node; node0++)
+        {
+            int level0 = node_level[node0];
+            
+            H2P_dense_mat_p y1_0 = y1[node0];
+            memset(y1_0->data, 0, sizeof(DTYPE) * y1_0->nrow * y1_0->ncol);
+
+            for (int i = B_p2i_rowptr[node0]; i < B_p2i_rowptr[node0 + 1]; i++)
+            {
+                int node1    = B_p2i_colidx[i];
+                int pair_idx = B_p2i_val[i] - 1;
+                int level1   = node_level[node1];
+                int Bij_nrow = B_nrow[pair_idx];
+                int Bij_ncol = B_ncol[pair_idx];
+                DTYPE *Bij   = B_data + B_ptr[pair_idx];
+                // An empty skeleton set gives an empty B_{ij}, BLAS rejects its zero leading dimension
+                if (Bij_nrow == 0 || Bij_ncol == 0) continue;
+
+                const DTYPE *x_spos = (level0 > level1) ? (x + mat_cluster[node1 * 2]) : y0[node1]->data;
+                DTYPE *y_spos = (level0 < level1) ? (y + mat_cluster[node0 * 2]) : y1_0->data;
+                CBLAS_GEMV(
+                    CblasRowMajor, CblasNoTrans, Bij_nrow, Bij_ncol, 
+                    1.0, Bij, Bij_ncol, x_spos, 1, 1.0, y_spos, 1
+                );
+            }  // End of node1 loop
+        }  // End of node0 loop
+        thread_buf[tid]->timer += get_wtime_sec();
+    }  // End of "#pragma omp parallel"
+    
+    if (h2pack->print_timers == 1)
+    {
+        double max_t = 0.0, avg_t = 0.0, min_t = 19241112.0;
+        for (int i = 0; i < n_thread; i++)
+        {
+            double thread_i_timer = thread_buf[i]->timer;
+            avg_t += thread_i_timer;
+            max_t = MAX(max_t, thread_i_timer);
+            min_t = MIN(min_t, thread_i_timer);
+        }
+        avg_t /= (double) n_thread;
+        INFO_PRINTF("Matvec intermediate multiplication: min/avg/max thread wall-time = %.3lf, %.3lf, %.3lf (s)\n", min_t, avg_t, max_t);
+    }
+}
+
+// H2 matvec dense multiplication, calculate D_{ij} * x_j
+// All D_{ij} matrices have been calculated and stored
+void H2P_matvec_periodic_dense_mult_AOT(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
+{
+    int    n_node        = h2pack->n_node;
+    int    n_thread      = h2pack->n_thread;
+    int    *mat_cluster  = h2pack->mat_cluster;
+    int    *D_nrow       = h2pack->D_nrow;
+    int    *D_ncol       = h2pack->D_ncol;
+    int    *D_p2i_rowptr = h2pack->D_p2i_rowptr;
+    int    *D_p2i_colidx = h2pack->D_p2i_colidx;
+    int    *D_p2i_val    = h2pack->D_p2i_val;
+    size_t *D_ptr        = h2pack->D_ptr;
+    DTYPE  *D_data       = h2pack->D_data;
+    H2P_thread_buf_p *thread_buf = h2pack->tb;
+
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        
+        thread_buf[tid]->timer = -get_wtime_sec();
+
+        #pragma omp for schedule(dynamic)
+        for (int node0 = 0; node0 < n_node; node0++)
+        {
+            DTYPE *y_spos = y + mat_cluster[node0 * 2];
+            for (int i = D_p2i_rowptr[node0]; i < D_p2i_rowptr[node0 + 1]; i++)
+            {
+                int node1    = D_p2i_colidx[i];
+                int pair_idx = D_p2i_val[i] - 1;
+                int Dij_nrow = D_nrow[pair_idx];
+                int Dij_ncol = D_ncol[pair_idx];
+                DTYPE *Dij   = D_data + D_ptr[pair_idx];
+                const DTYPE *x_spos = x + mat_cluster[node1 * 2];
+                CBLAS_GEMV(
+                    CblasRowMajor, CblasNoTrans, Dij_nrow, Dij_ncol, 
+                    1.0, Dij, Dij_ncol, x_spos, 1, 1.0, y_spos, 1
+                );
+            }  // End of i loop
+        }  // End of node0 loop
+        thread_buf[tid]->timer += get_wtime_sec();
+    }  // End of "pragma omp parallel"
+    
+    if (h2pack->print_timers == 1)
+    {
+        double max_t = 0.0, avg_t = 0.0, min_t = 19241112.0;
+        for (int i = 0; i < n_thread; i++)
+        {
+            double thread_i_timer = thread_buf[i]->timer;
+            avg_t += thread_i_timer;
+            max_t = MAX(max_t, thread_i_timer);
+            min_t = MIN(min_t, thread_i_timer);
+        }
+        avg_t /= (double) n_thread;
+        INFO_PRINTF("Matvec dense multiplication: min/avg/max thread wall-time = %.3lf, %.3lf, %.3lf (s)\n", min_t, avg_t, max_t);
+    }
+}
+
 // H2 representation multiplies a column vector
 void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
 {
@@ -411,12 +543,6 @@ void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     DTYPE *x_ = need_trans ? xT : pmt_x;
     DTYPE *y_ = need_trans ? yT : pmt_y;
 
-    if (BD_JIT != 1)
-    {
-        ERROR_PRINTF("Only support BD_JIT=1 in this function for the moment.\n");
-        return;
-    }
-
     // 1. Forward permute the input vector
     st = get_wtime_sec();
     H2P_permute_vector_forward(h2pack, x, pmt_x);
@@ -426,7 +552,7 @@ void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
 
     // 2. Reset y result to 0 and transpose x if necessary
     st = get_wtime_sec();
-    #pragma omp parallel for simd
+    #pragma omp parallel for simd num_threads(n_thread)
     for (int i = 0; i < krnl_mat_size; i++)
     {
         pmt_y[i] = 0.0;
@@ -455,9 +581,7 @@ void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
         H2P_matvec_periodic_intmd_mult_JIT(h2pack, x_, y_);
         if (need_trans) H2P_transpose_y1_to_krnldim(h2pack);
     } else {
-        // "Lost butterfly"
-        ERROR_PRINTF("Only support BD_JIT=1 in this function for the moment.\n");
-        return;
+        H2P_matvec_periodic_intmd_mult_AOT(h2pack, x_, y_);
     }
     // Multiply the periodic block for root node
     // y1{root} = y1{root} + O * y0{root};  % y1{root} should be empty
@@ -493,9 +617,7 @@ void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     {
         H2P_matvec_periodic_dense_mult_JIT(h2pack, x_, y_);
     } else {
-        // "Lost butterfly"
-        ERROR_PRINTF("Only support BD_JIT=1 in this function for the moment.\n");
-        return;
+        H2P_matvec_periodic_dense_mult_AOT(h2pack, x_, y_);
     }
     et = get_wtime_sec();
     timers[MV_DEN_TIMER_IDX] += et - st;
@@ -506,7 +628,7 @@ void H2P_matvec_periodic(H2Pack_p h2pack, const DTYPE *x, DTYPE *y)
     if (need_trans)
     {
         H2P_transpose_dmat(n_thread, krnl_dim, n_point, yT, n_point, xT, krnl_dim);
-        #pragma omp parallel for simd
+        #pragma omp parallel for simd num_threads(n_thread)
         for (int i = 0; i < krnl_mat_size; i++) pmt_y[i] += xT[i];
         mat_size[MV_VOP_SIZE_IDX] += 4 * krnl_mat_size;
     }
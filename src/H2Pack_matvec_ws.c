@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_matvec.h"
+#include "H2Pack_matmul.h"
+#include "H2Pack_matvec_periodic.h"
+#include "H2Pack_matmul_periodic.h"
+#include "H2Pack_HSS_matvec.h"
+#include "H2Pack_matvec_ws.h"
+#include "H2Pack_utils.h"
+#include "utils.h"
+
+// Create a matvec workspace for a constructed H2Pack structure
+void H2P_matvec_ws_init(H2P_matvec_ws_p *ws_, H2Pack_p h2pack, const int n_thread)
+{
+    H2P_matvec_ws_p ws = (H2P_matvec_ws_p) malloc(sizeof(H2P_matvec_ws_s));
+    ASSERT_PRINTF(ws != NULL, "Failed to allocate H2P_matvec_ws structure\n");
+
+    // The HSS matvec metadata is shared, prepare it before copying h2pack
+    // so that HSS_mv_mode != 0 in exec and multiplications with this workspace 
+    // only read the HSS_mv_* metadata
+    if (h2pack->is_HSS == 1) 
+    {
+        #pragma omp critical(H2P_HSS_matvec_init)
+        H2P_HSS_matvec_init(h2pack);
+    }
+
+    // All pointers in exec refer to the shared H2 representation, then 
+    // replace the buffers written by matvec and matmul with private ones
+    ws->h2pack = h2pack;
+    H2Pack_p exec = &ws->exec;
+    memcpy(exec, h2pack, sizeof(H2Pack_s));
+    if (n_thread > 0) exec->n_thread = n_thread;
+    int krnl_mat_size = exec->krnl_mat_size;
+    size_t pmt_xy_size = (size_t) krnl_mat_size * (size_t) exec->mm_max_n_vec;
+    exec->xT    = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+    exec->yT    = (DTYPE*) malloc(sizeof(DTYPE) * krnl_mat_size);
+    exec->pmt_x = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    exec->pmt_y = (DTYPE*) malloc(sizeof(DTYPE) * pmt_xy_size);
+    ASSERT_PRINTF(
+        exec->xT != NULL && exec->yT != NULL && exec->pmt_x != NULL && exec->pmt_y != NULL,
+        "Failed to allocate working arrays of size %zu for matvec & matmul\n", 2 * (pmt_xy_size + krnl_mat_size)
+    );
+    exec->y0 = NULL;
+    exec->y1 = NULL;
+    exec->HSS_mv_buf  = NULL;
+    exec->HSS_mv_nvec = 0;
+    exec->tb = (H2P_thread_buf_p*) malloc(sizeof(H2P_thread_buf_p) * exec->n_thread);
+    ASSERT_PRINTF(exec->tb != NULL, "Failed to allocate %d thread buffers\n", exec->n_thread);
+    for (int i = 0; i < exec->n_thread; i++)
+        H2P_thread_buf_init(&exec->tb[i], (exec->is_HSS == 1) ? 0 : krnl_mat_size);
+    // Out-of-core B and D are read with pread(), only the streaming buffers are private
+    if (exec->ooc_fd >= 0)
+    {
+        exec->ooc_buf = (DTYPE*) malloc_aligned(sizeof(DTYPE) * 2 * exec->ooc_buf_size, 64);
+        ASSERT_PRINTF(exec->ooc_buf != NULL, "Failed to allocate out-of-core buffers of size 2 * %zu\n", exec->ooc_buf_size);
+    }
+    H2P_reset_timers(exec);
+    *ws_ = ws;
+}
+
+// Destroy a H2P_matvec_ws structure
+void H2P_matvec_ws_destroy(H2P_matvec_ws_p *ws_)
+{
+    H2P_matvec_ws_p ws = *ws_;
+    if (ws == NULL) return;
+    H2Pack_p exec = &ws->exec;
+    free(exec->xT);
+    free(exec->yT);
+    free(exec->pmt_x);
+    free(exec->pmt_y);
+    free_aligned(exec->HSS_mv_buf);
+    if (exec->ooc_fd >= 0) free_aligned(exec->ooc_buf);
+    if (exec->y0 != NULL)
+    {
+        for (int i = 0; i < exec->n_node; i++)
+            H2P_dense_mat_destroy(&exec->y0[i]);
+        free(exec->y0);
+    }
+    if (exec->y1 != NULL)
+    {
+        for (int i = 0; i < exec->n_node; i++)
+            H2P_dense_mat_destroy(&exec->y1[i]);
+        free(exec->y1);
+    }
+    for (int i = 0; i < exec->n_thread; i++)
+        H2P_thread_buf_destroy(&exec->tb[i]);
+    free(exec->tb);
+    free(ws);
+    *ws_ = NULL;
+}
+
+// H2 representation multiplies a column vector using a workspace
+void H2P_matvec_with_ws(H2P_matvec_ws_p ws, const DTYPE *x, DTYPE *y)
+{
+    H2P_matvec(&ws->exec, x, y);
+}
+
+// H2 representation multiplies a dense general matrix using a workspace
+void H2P_matmul_with_ws(
+    H2P_matvec_ws_p ws, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+)
+{
+    H2P_matmul(&ws->exec, layout, n_vec, mat_x, ldx, mat_y, ldy);
+}
+
+// Periodic H2 representation multiplies a column vector using a workspace
+void H2P_matvec_periodic_with_ws(H2P_matvec_ws_p ws, const DTYPE *x, DTYPE *y)
+{
+    H2P_matvec_periodic(&ws->exec, x, y);
+}
+
+// Periodic H2 representation multiplies a dense general matrix using a workspace
+void H2P_matmul_periodic_with_ws(
+    H2P_matvec_ws_p ws, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+)
+{
+    H2P_matmul_periodic(&ws->exec, layout, n_vec, mat_x, ldx, mat_y, ldy);
+}
@@ -0,0 +1,82 @@
+#ifndef __H2PACK_MATVEC_WS_H__
+#define __H2PACK_MATVEC_WS_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Execution context of H2 matvec / matmul on a shared H2Pack structure.
+// H2P_matvec() and H2P_matmul() write permuted vectors, y0, y1, thread-local
+// buffers, timers, and counters in the H2Pack structure, so two callers cannot
+// multiply with the same H2Pack structure at the same time. A workspace owns
+// its own copy of all these buffers and statistics. The H2 representation 
+// (tree, U, J, B, D, and index arrays) is shared with the H2Pack structure 
+// and only read, so callers with different workspaces can multiply concurrently.
+struct H2P_matvec_ws
+{
+    H2Pack_p h2pack;    // Shared H2Pack structure, not modified by multiplications with this workspace
+    H2Pack_s exec;      // Copy of *h2pack whose matvec buffers and statistics are private to this workspace
+};
+typedef struct H2P_matvec_ws  H2P_matvec_ws_s;
+typedef struct H2P_matvec_ws* H2P_matvec_ws_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Create a matvec workspace for a constructed H2Pack structure
+// Input parameters:
+//   h2pack   : H2Pack structure after H2P_build(), H2P_build_periodic(), or loaded from a file
+//   n_thread : Number of threads used by each multiplication with this workspace, 
+//              <= 0 to use h2pack->n_thread
+// Output parameter:
+//   ws_ : Initialized H2P_matvec_ws structure
+// Notes:
+//   1. The workspace only refers to h2pack, which should not be modified or destroyed 
+//      before H2P_matvec_ws_destroy() is called.
+//   2. Workspaces should be created before concurrent multiplications start, since 
+//      the HSS matvec metadata of h2pack is prepared here if it has not been prepared.
+//   3. Matvec statistics of multiplications with a workspace are accumulated in ws->exec,
+//      use H2P_print_statistic(&ws->exec) and H2P_reset_timers(&ws->exec) to report and 
+//      reset them. Statistics in h2pack are not changed.
+void H2P_matvec_ws_init(H2P_matvec_ws_p *ws_, H2Pack_p h2pack, const int n_thread);
+
+// Destroy a H2P_matvec_ws structure, the shared H2Pack structure is not destroyed
+// Input parameter:
+//   ws_ : Pointer to a H2P_matvec_ws structure to be destroyed
+void H2P_matvec_ws_destroy(H2P_matvec_ws_p *ws_);
+
+// H2 representation multiplies a column vector using a workspace, see H2P_matvec()
+// Input parameters:
+//   ws : H2P_matvec_ws structure, should not be used by another caller at the same time
+//   x  : Input dense vector
+// Output parameter:
+//   y : Output dense vector
+void H2P_matvec_with_ws(H2P_matvec_ws_p ws, const DTYPE *x, DTYPE *y);
+
+// H2 representation multiplies a dense general matrix using a workspace
+// Input parameters:
+//   ws : H2P_matvec_ws structure, should not be used by another caller at the same time
+//   Other parameters are the same as H2P_matmul()
+// Output parameter:
+//   mat_y : Output dense matrix, the same as H2P_matmul()
+void H2P_matmul_with_ws(
+    H2P_matvec_ws_p ws, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+);
+
+// Periodic H2 representation multiplies a column vector using a workspace, see H2P_matvec_periodic()
+// Input and output parameters are the same as H2P_matvec_with_ws()
+void H2P_matvec_periodic_with_ws(H2P_matvec_ws_p ws, const DTYPE *x, DTYPE *y);
+
+// Periodic H2 representation multiplies a dense general matrix using a workspace, see H2P_matmul_periodic()
+// Input and output parameters are the same as H2P_matmul_with_ws()
+void H2P_matmul_periodic_with_ws(
+    H2P_matvec_ws_p ws, const CBLAS_LAYOUT layout, const int n_vec, 
+    const DTYPE *mat_x, const int ldx, DTYPE *mat_y, const int ldy
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -43,7 +43,7 @@ H2P_tree_node_p H2P_bisection_partition_points(
 )
 {
     int node_npts = coord_e - coord_s + 1;
-    int max_child = 1 << pt_dim;
+    int max_child = H2P_MAX_CHILD(pt_dim);
     if (level > part_vars->max_level) part_vars->max_level = level;
     
     // 1. Check the enclosing box
@@ -52,6 +52,7 @@ H2P_tree_node_p H2P_bisection_partition_points(
     {
         alloc_enbox = 1;
         enbox = (DTYPE*) malloc(sizeof(DTYPE) * pt_dim * 2);
+        memset(enbox, 0, sizeof(DTYPE) * pt_dim * 2);
         DTYPE *center = (DTYPE*) malloc(sizeof(DTYPE) * pt_dim);
         memset(center, 0, sizeof(DTYPE) * pt_dim);
         // Calculate the center of points in this box
@@ -107,6 +108,18 @@ H2P_tree_node_p H2P_bisection_partition_points(
     }  // End of "if (enbox == NULL)"
     DTYPE box_size = enbox[pt_dim];
     
+    // For pt_dim > MAX_2N_TREE_DIM, 2^pt_dim-way partitioning gives too many
+    // children per node. Only bisect the longest dimension of the box instead
+    // (binary kd-tree partitioning) and use the longest dimension as box size.
+    int split_dim = -1;
+    if (pt_dim > MAX_2N_TREE_DIM)
+    {
+        split_dim = 0;
+        for (int j = 1; j < pt_dim; j++)
+            if (enbox[pt_dim + j] > enbox[pt_dim + split_dim]) split_dim = j;
+        box_size = enbox[pt_dim + split_dim];
+    }
+    
     // 2. If the size of current box or the number of points in current box
     //    is smaller than the threshold, set current box as a leaf node
     if ((node_npts <= max_leaf_points) || (box_size <= max_leaf_size))
@@ -142,11 +155,18 @@ H2P_tree_node_p H2P_bisection_partition_points(
         DTYPE enbox_width_j  = enbox[pt_dim + j];
         DTYPE *coord_dim_j_s = coord   + j * n_point + coord_s;
         int   *rel_idx_dim_j = rel_idx + j * node_npts;
+        if (split_dim >= 0 && j != split_dim)
+        {
+            memset(rel_idx_dim_j, 0, sizeof(int) * node_npts);
+            continue;
+        }
         for (int i = 0; i < node_npts; i++)
         {
             DTYPE rel_coord  = coord_dim_j_s[i] - enbox_corner_j;
             rel_idx_dim_j[i] = DFLOOR(2.0 * rel_coord / enbox_width_j);
-            if (rel_idx_dim_j[i] == 2) rel_idx_dim_j[i] = 1;
+            // Points on or slightly outside the box surface due to rounding errors
+            if (rel_idx_dim_j[i] >= 2) rel_idx_dim_j[i] = 1;
+            if (rel_idx_dim_j[i] <  0) rel_idx_dim_j[i] = 0;
             child_idx[i] += rel_idx_dim_j[i] * pow2;
         }
         pow2 *= 2;
@@ -215,6 +235,12 @@ H2P_tree_node_p H2P_bisection_partition_points(
         int *sub_rel_idx_i = sub_rel_idx + i;
         for (int j = 0; j < pt_dim; j++)
         {
+            if (split_dim >= 0 && j != split_dim)
+            {
+                sub_box_child[j] = enbox[j];
+                sub_box_child[pt_dim + j] = enbox[pt_dim + j];
+                continue;
+            }
             sub_box_child[j] = enbox[j] + 0.5 * enbox[pt_dim + j] * sub_rel_idx_i[j * max_child] - 1e-12;
             sub_box_child[pt_dim + j] = 0.5 * enbox[pt_dim + j] + 2e-12;
         }
@@ -275,7 +301,7 @@ void H2P_tree_to_array(H2P_tree_node_p node, H2Pack_p h2pack)
 {
     int pt_dim    = h2pack->pt_dim;
     int pt_dim2   = pt_dim * 2;
-    int max_child = 1 << pt_dim;
+    int max_child = h2pack->max_child;
     int node_idx  = node->po_idx;
     int n_child   = node->n_child;
     int level     = node->level;
@@ -312,6 +338,38 @@ void H2P_tree_to_array(H2P_tree_node_p node, H2Pack_p h2pack)
     h2pack->height_n_node[height]++;
 }
 
+// Construct the upward sweep DAG_task_queue used by H2P_build_H2_UJ_proxy
+// Input parameter:
+//   h2pack : H2Pack structure with H2 tree partitioning in arrays and min_adm_level
+// Output parameter:
+//   h2pack : H2Pack structure with h2pack->upward_tq
+void H2P_build_upward_task_queue(H2Pack_p h2pack)
+{
+    int n_node         = h2pack->n_node;
+    int min_adm_level  = h2pack->min_adm_level;
+    int *node_level    = h2pack->node_level;
+    int *parent        = h2pack->parent;
+    int *DAG_src_ptr   = (int*) malloc(sizeof(int) * (n_node + 1));
+    int *DAG_dst_idx   = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(
+        DAG_src_ptr != NULL && DAG_dst_idx != NULL, 
+        "Failed to allocate working buffer for DAG task queue construction\n"
+    );
+    for (int node = 0; node < n_node; node++)
+    {
+        DAG_src_ptr[node] = node;
+        // The root node never needs a projection matrix. If the root node is also 
+        // the only leaf node, min_adm_level == 0 but it has no admissible pair.
+        if (node_level[node] < min_adm_level || parent[node] == -1) DAG_dst_idx[node] = node;
+        else DAG_dst_idx[node] = parent[node];
+    }
+    DAG_src_ptr[n_node] = n_node;
+    DAG_task_queue_destroy(&h2pack->upward_tq);
+    DAG_task_queue_init(n_node, n_node, DAG_src_ptr, DAG_dst_idx, &h2pack->upward_tq);
+    free(DAG_src_ptr);
+    free(DAG_dst_idx);
+}
+
 // Calculate reduced (in)admissible pairs of a H2 tree
 // Input parameters:
 //   h2pack    : H2Pack structure with H2 tree partitioning in arrays
@@ -589,7 +647,7 @@ void H2P_partition_points(
     
     // 3. Convert linked list H2 tree partition to arrays
     int n_node    = root->n_node;
-    int max_child = 1 << pt_dim;
+    int max_child = H2P_MAX_CHILD(pt_dim);
     int max_level = part_vars->max_level;
     h2pack->n_node        = n_node;
     h2pack->root_idx      = n_node - 1;
@@ -628,6 +686,13 @@ void H2P_partition_points(
     H2P_tree_to_array(root, h2pack);
     h2pack->parent[h2pack->root_idx] = -1;  // Root node doesn't have parent
     H2P_tree_node_destroy(&root);  // We don't need the linked list H2 tree anymore
+    // The sample point algorithm needs the root box, keep it if it is not provided
+    if (h2pack->root_enbox == NULL)
+    {
+        h2pack->root_enbox = (DTYPE*) malloc(sizeof(DTYPE) * 2 * pt_dim);
+        ASSERT_PRINTF(h2pack->root_enbox != NULL, "Failed to allocate root_enbox\n");
+        memcpy(h2pack->root_enbox, h2pack->enbox + h2pack->root_idx * 2 * pt_dim, sizeof(DTYPE) * 2 * pt_dim);
+    }
     
     // In H2ERI, mat_cluster and krnl_mat_size will be set outside and we don't need xT, yT
     if (h2pack->is_H2ERI == 0)
@@ -677,28 +742,10 @@ void H2P_partition_points(
     h2pack->tb = (H2P_thread_buf_p*) malloc(sizeof(H2P_thread_buf_p) * h2pack->n_thread);
     ASSERT_PRINTF(h2pack->tb != NULL, "Failed to allocate %d thread buffers\n", h2pack->n_thread);
     for (int i = 0; i < h2pack->n_thread; i++)
-        H2P_thread_buf_init(&h2pack->tb[i], h2pack->krnl_mat_size);
+        H2P_thread_buf_init(&h2pack->tb[i], (h2pack->is_HSS == 1) ? 0 : h2pack->krnl_mat_size);
     
     // 7. Construct a DAG_task_queue for H2P_build_H2_UJ_proxy 
-    int min_adm_level  = h2pack->min_adm_level;
-    int *node_level    = h2pack->node_level;
-    int *parent        = h2pack->parent;
-    int *DAG_src_ptr   = (int*) malloc(sizeof(int) * (n_node + 1));
-    int *DAG_dst_idx   = (int*) malloc(sizeof(int) * n_node);
-    ASSERT_PRINTF(
-        DAG_src_ptr != NULL && DAG_dst_idx != NULL, 
-        "Failed to allocate working buffer for DAG task queue construction\n"
-    );
-    for (int node = 0; node < n_node; node++)
-    {
-        DAG_src_ptr[node] = node;
-        if (node_level[node] < min_adm_level) DAG_dst_idx[node] = node;
-        else DAG_dst_idx[node] = parent[node];
-    }
-    DAG_src_ptr[n_node] = n_node;
-    DAG_task_queue_init(n_node, n_node, DAG_src_ptr, DAG_dst_idx, &h2pack->upward_tq);
-    free(DAG_src_ptr);
-    free(DAG_dst_idx);
+    H2P_build_upward_task_queue(h2pack);
 
     // 8: Optional: calculate reduced (in)admissible pairs for HSS
     if (h2pack->is_HSS == 1) H2P_HSS_calc_adm_inadm_pairs(h2pack);
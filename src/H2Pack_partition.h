@@ -8,7 +8,9 @@
 extern "C" {
 #endif
 
-// Hierarchical point partitioning for H2 / HSS construction
+// Hierarchical point partitioning for H2 / HSS construction. For pt_dim <= MAX_2N_TREE_DIM,
+// each box is split into 2^pt_dim sub-boxes; for higher dimensions, each box is bisected
+// along its longest dimension (binary kd-tree).
 // Input parameters:
 //   h2pack          : H2Pack structure initialized using H2P_init()
 //   n_point         : Number of points for the kernel matrix
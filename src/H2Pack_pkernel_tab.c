@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "utils.h"
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_pkernel_tab.h"
+
+// Max number of Chebyshev nodes in the table
+#define PKRNL_TAB_MAX_NODE (1 << 20)
+
+// Number of pseudo-random points in each box for checking the interpolation error
+#define PKRNL_TAB_N_RAND_CHECK 8
+
+// Evaluate the Lagrange basis polynomials of Chebyshev nodes at t
+// Input parameters:
+//   n_cheb    : Number of Chebyshev nodes
+//   cheb_node : Size n_cheb, Chebyshev nodes on [-1, 1]
+//   cheb_bw   : Size n_cheb, barycentric weights of cheb_node
+//   t         : Target point in [-1, 1]
+// Output parameter:
+//   l : Size n_cheb, values of the Lagrange basis polynomials at t
+static void H2P_pkernel_tab_lagrange(
+    const int n_cheb, const DTYPE *cheb_node, const DTYPE *cheb_bw, const DTYPE t, DTYPE *l
+)
+{
+    DTYPE sum = 0.0;
+    for (int m = 0; m < n_cheb; m++)
+    {
+        DTYPE diff = t - cheb_node[m];
+        if (diff == 0.0)
+        {
+            memset(l, 0, sizeof(DTYPE) * n_cheb);
+            l[m] = 1.0;
+            return;
+        }
+        l[m] = cheb_bw[m] / diff;
+        sum += l[m];
+    }
+    DTYPE inv_sum = 1.0 / sum;
+    for (int m = 0; m < n_cheb; m++) l[m] *= inv_sum;
+}
+
+// Compute the exact correction corr(d) = pkernel(d, 0) - sum_{l} kernel(d, shift_l)
+// Input parameters:
+//   tab      : H2P_pkernel_tab structure with kernel functions and lattices
+//   n_pt     : Number of points
+//   d_coord  : Size tab->xpt_dim * n_pt, coordinate differences, extended coordinates
+//              should be tab->xpt_ref
+//   krnl_mat : Size >= (n_pt * krnl_dim) * (n_lattice * krnl_dim), work buffer
+// Output parameter:
+//   corr : Size (n_pt * krnl_dim) * krnl_dim, corr(d)
+static void H2P_pkernel_tab_exact_corr(
+    H2P_pkernel_tab_p tab, const int n_pt, const DTYPE *d_coord, DTYPE *krnl_mat, DTYPE *corr
+)
+{
+    int pt_dim    = tab->pt_dim;
+    int xpt_dim   = tab->xpt_dim;
+    int krnl_dim  = tab->krnl_dim;
+    int n_lattice = tab->n_lattice;
+
+    // origin / shift_coord : the origin and the lattice shifts with extended coordinates xpt_ref
+    DTYPE origin[8];
+    DTYPE *shift_coord = (DTYPE*) malloc(sizeof(DTYPE) * xpt_dim * n_lattice);
+    ASSERT_PRINTF(shift_coord != NULL, "Failed to allocate lattice shift buffer\n");
+    for (int k = 0; k < xpt_dim; k++)
+    {
+        DTYPE xpt_k = (k < pt_dim) ? 0.0 : tab->xpt_ref[k - pt_dim];
+        origin[k] = xpt_k;
+        for (int l = 0; l < n_lattice; l++)
+        {
+            if (k < pt_dim) xpt_k = tab->lattices[l * pt_dim + k] * tab->cell_width[k];
+            shift_coord[k * n_lattice + l] = xpt_k;
+        }
+    }
+
+    int ldc = krnl_dim;
+    int ldk = n_lattice * krnl_dim;
+    tab->pkrnl_eval(d_coord, n_pt, n_pt, origin, 1, 1, tab->pkrnl_param, corr, ldc);
+    tab->krnl_eval(d_coord, n_pt, n_pt, shift_coord, n_lattice, n_lattice, tab->krnl_param, krnl_mat, ldk);
+    for (int i = 0; i < n_pt * krnl_dim; i++)
+    {
+        DTYPE *corr_i = corr + i * ldc;
+        DTYPE *krnl_i = krnl_mat + i * ldk;
+        for (int l = 0; l < n_lattice; l++)
+            for (int c = 0; c < krnl_dim; c++) corr_i[c] -= krnl_i[l * krnl_dim + c];
+    }
+    free(shift_coord);
+}
+
+// Fill the table with the current n_cheb and n_box, and measure its
+// max relative interpolation error on points between Chebyshev nodes
+// Input parameter:
+//   tab : H2P_pkernel_tab structure with kernel functions, lattices, n_cheb, and n_box
+// Output parameter:
+//   tab : H2P_pkernel_tab structure with vals and max_relerr
+static void H2P_pkernel_tab_fill(H2P_pkernel_tab_p tab)
+{
+    int pt_dim   = tab->pt_dim;
+    int xpt_dim  = tab->xpt_dim;
+    int krnl_dim = tab->krnl_dim;
+    int n_cheb   = tab->n_cheb;
+    int n_box    = tab->n_box;
+    int krnl_dim2 = krnl_dim * krnl_dim;
+    int box_size  = 1, n_box_all = 1;
+    for (int k = 0; k < pt_dim; k++)
+    {
+        box_size  *= n_cheb;
+        n_box_all *= n_box;
+    }
+
+    free_aligned(tab->vals);
+    tab->mem_size = (size_t) n_box_all * (size_t) (krnl_dim2 * box_size);
+    tab->vals = (DTYPE*) malloc_aligned(sizeof(DTYPE) * tab->mem_size, 64);
+    ASSERT_PRINTF(tab->vals != NULL, "Failed to allocate periodic kernel table of size %zu\n", tab->mem_size);
+
+    // The interpolation error is checked on the box center, 2^pt_dim points next 
+    // to the box corners where the Chebyshev interpolation error is usually the 
+    // largest, and PKRNL_TAB_N_RAND_CHECK pseudo-random points in the box. 
+    const int n_corner = 1 << pt_dim;
+    const int n_check  = 1 + n_corner + PKRNL_TAB_N_RAND_CHECK;
+    DTYPE max_corr = 0.0, max_err = 0.0;
+    #pragma omp parallel
+    {
+        int n_pt = box_size;
+        DTYPE *d_coord  = (DTYPE*) malloc(sizeof(DTYPE) * xpt_dim * n_pt);
+        DTYPE *corr     = (DTYPE*) malloc(sizeof(DTYPE) * n_pt * krnl_dim2);
+        DTYPE *krnl_mat = (DTYPE*) malloc(sizeof(DTYPE) * n_pt * krnl_dim2 * tab->n_lattice);
+        DTYPE *icorr    = (DTYPE*) malloc(sizeof(DTYPE) * n_check * krnl_dim2);
+        ASSERT_PRINTF(
+            d_coord != NULL && corr != NULL && krnl_mat != NULL && icorr != NULL,
+            "Failed to allocate periodic kernel table work buffers\n"
+        );
+        DTYPE max_corr_t = 0.0, max_err_t = 0.0;
+
+        #pragma omp for schedule(dynamic)
+        for (int b = 0; b < n_box_all; b++)
+        {
+            // 1. Coordinates of the Chebyshev nodes in box b
+            for (int k = 0; k < pt_dim; k++)
+            {
+                int bk = b;
+                for (int k1 = 0; k1 < k; k1++) bk /= n_box;
+                bk %= n_box;
+                DTYPE h_k  = 2.0 * tab->cell_width[k] / (DTYPE) n_box;
+                DTYPE c_k  = -tab->cell_width[k] + h_k * ((DTYPE) bk + 0.5);
+                DTYPE *d_k = d_coord + k * n_pt;
+                int stride = 1;
+                for (int k1 = 0; k1 < k; k1++) stride *= n_cheb;
+                for (int q = 0; q < box_size; q++)
+                    d_k[q] = c_k + 0.5 * h_k * tab->cheb_node[(q / stride) % n_cheb];
+            }
+            for (int k = pt_dim; k < xpt_dim; k++)
+                for (int q = 0; q < n_pt; q++) d_coord[k * n_pt + q] = tab->xpt_ref[k - pt_dim];
+
+            // 2. Exact correction values, reorder the Chebyshev node values to
+            //    vals(b, comp, q) so the interpolation is a contiguous dot product
+            H2P_pkernel_tab_exact_corr(tab, n_pt, d_coord, krnl_mat, corr);
+            DTYPE *vals_b = tab->vals + (size_t) b * (size_t) (krnl_dim2 * box_size);
+            for (int q = 0; q < box_size; q++)
+            {
+                for (int r = 0; r < krnl_dim; r++)
+                {
+                    for (int c = 0; c < krnl_dim; c++)
+                    {
+                        DTYPE val = corr[(q * krnl_dim + r) * krnl_dim + c];
+                        vals_b[(r * krnl_dim + c) * box_size + q] = val;
+                        max_corr_t = MAX(max_corr_t, DABS(val));
+                    }
+                }
+            }
+        }  // End of b loop
+
+        // 3. Interpolation error on the check points. The table is complete
+        //    after the implicit barrier of the omp for above.
+        #pragma omp for schedule(dynamic)
+        for (int b = 0; b < n_box_all; b++)
+        {
+            for (int k = 0; k < pt_dim; k++)
+            {
+                int bk = b;
+                for (int k1 = 0; k1 < k; k1++) bk /= n_box;
+                bk %= n_box;
+                DTYPE h_k = 2.0 * tab->cell_width[k] / (DTYPE) n_box;
+                DTYPE c_k = -tab->cell_width[k] + h_k * ((DTYPE) bk + 0.5);
+                d_coord[k * n_check] = c_k;
+                for (int q = 1; q <= n_corner; q++)
+                    d_coord[k * n_check + q] = c_k + 0.499 * h_k * ((((q - 1) >> k) & 1) ? -1.0 : 1.0);
+                // Deterministic LCG seeded by the box index, so the estimate does not change between runs
+                unsigned int seed = 2654435761u * (unsigned int) (b + 1) + 40503u * (unsigned int) k;
+                for (int q = n_corner + 1; q < n_check; q++)
+                {
+                    seed = 1664525u * seed + 1013904223u;
+                    DTYPE u = (DTYPE) (seed >> 8) / (DTYPE) (1u << 24);
+                    d_coord[k * n_check + q] = c_k + h_k * (u - 0.5);
+                }
+            }
+            for (int k = pt_dim; k < xpt_dim; k++)
+                for (int q = 0; q < n_check; q++) d_coord[k * n_check + q] = tab->xpt_ref[k - pt_dim];
+            DTYPE origin[8];
+            for (int k = 0; k < xpt_dim; k++) origin[k] = (k < pt_dim) ? 0.0 : tab->xpt_ref[k - pt_dim];
+            H2P_pkernel_tab_eval_corr(tab, d_coord, n_check, n_check, origin, 1, 1, icorr, krnl_dim);
+            H2P_pkernel_tab_exact_corr(tab, n_check, d_coord, krnl_mat, corr);
+            for (int i = 0; i < n_check * krnl_dim2; i++)
+                max_err_t = MAX(max_err_t, DABS(icorr[i] - corr[i]));
+        }
+
+        #pragma omp critical
+        {
+            max_corr = MAX(max_corr, max_corr_t);
+            max_err  = MAX(max_err,  max_err_t);
+        }
+        free(d_coord);
+        free(corr);
+        free(krnl_mat);
+        free(icorr);
+    }  // End of "#pragma omp parallel"
+    tab->max_relerr = (max_corr > 0.0) ? (max_err / max_corr) : 0.0;
+}
+
+// Tabulate the correction between a periodic system kernel and the kernel
+// sum over the nearest lattices
+void H2P_pkernel_tab_init(
+    const int pt_dim, const int xpt_dim, const int krnl_dim,
+    const DTYPE *cell_width, const DTYPE *xpt_ref,
+    void *krnl_param,  kernel_eval_fptr krnl_eval,
+    void *pkrnl_param, kernel_eval_fptr pkrnl_eval,
+    const DTYPE reltol, H2P_pkernel_tab_p *tab_
+)
+{
+    ASSERT_PRINTF(pt_dim >= 1 && pt_dim <= 3, "Periodic kernel table only supports 1 <= pt_dim <= 3\n");
+    ASSERT_PRINTF(xpt_dim >= pt_dim && xpt_dim <= 8, "Periodic kernel table only supports pt_dim <= xpt_dim <= 8\n");
+    ASSERT_PRINTF(xpt_dim == pt_dim || xpt_ref != NULL, "xpt_ref is required when xpt_dim > pt_dim\n");
+
+    H2P_pkernel_tab_p tab = (H2P_pkernel_tab_p) malloc(sizeof(H2P_pkernel_tab_s));
+    ASSERT_PRINTF(tab != NULL, "Failed to allocate H2P_pkernel_tab structure\n");
+    memset(tab, 0, sizeof(H2P_pkernel_tab_s));
+    tab->pt_dim      = pt_dim;
+    tab->xpt_dim     = xpt_dim;
+    tab->krnl_dim    = krnl_dim;
+    tab->krnl_param  = krnl_param;
+    tab->krnl_eval   = krnl_eval;
+    tab->pkrnl_param = pkrnl_param;
+    tab->pkrnl_eval  = pkrnl_eval;
+    for (int k = 0; k < pt_dim; k++) tab->cell_width[k] = cell_width[k];
+    tab->xpt_ref = (DTYPE*) malloc(sizeof(DTYPE) * (xpt_dim - pt_dim + 1));
+    ASSERT_PRINTF(tab->xpt_ref != NULL, "Failed to allocate H2P_pkernel_tab structure\n");
+    for (int k = 0; k < xpt_dim - pt_dim; k++) tab->xpt_ref[k] = xpt_ref[k];
+
+    // 1. The 3^pt_dim nearest lattices {-1, 0, 1}^pt_dim
+    tab->n_lattice = 1;
+    for (int k = 0; k < pt_dim; k++) tab->n_lattice *= 3;
+    tab->lattices = (DTYPE*) malloc(sizeof(DTYPE) * tab->n_lattice * pt_dim);
+    ASSERT_PRINTF(tab->lattices != NULL, "Failed to allocate H2P_pkernel_tab structure\n");
+    for (int l = 0; l < tab->n_lattice; l++)
+    {
+        int l_k = l;
+        for (int k = 0; k < pt_dim; k++)
+        {
+            tab->lattices[l * pt_dim + k] = (DTYPE) (l_k % 3 - 1);
+            l_k /= 3;
+        }
+    }
+
+    // 2. Chebyshev nodes of the first kind and their barycentric weights,
+    //    n_cheb grows with the number of requested digits
+    DTYPE eps = (sizeof(DTYPE) == 8) ? 1e-15 : 1e-7;
+    DTYPE tol = MAX(reltol, eps);
+    int n_cheb = (int) DCEIL(-DLOG(tol) / DLOG(10.0)) + 1;
+    n_cheb = MAX(n_cheb, 4);
+    n_cheb = MIN(n_cheb, 12);
+    tab->n_cheb    = n_cheb;
+    tab->cheb_node = (DTYPE*) malloc(sizeof(DTYPE) * n_cheb);
+    tab->cheb_bw   = (DTYPE*) malloc(sizeof(DTYPE) * n_cheb);
+    ASSERT_PRINTF(tab->cheb_node != NULL && tab->cheb_bw != NULL, "Failed to allocate H2P_pkernel_tab structure\n");
+    for (int m = 0; m < n_cheb; m++)
+    {
+        DTYPE theta = M_PI * (2.0 * m + 1.0) / (2.0 * n_cheb);
+        tab->cheb_node[m] = DCOS(theta);
+        tab->cheb_bw[m]   = ((m % 2) ? -1.0 : 1.0) * DSIN(theta);
+    }
+
+    // 3. Refine the boxes until the interpolation error is small enough. A table
+    //    less accurate than reltol would silently spoil the periodic block, so 
+    //    return NULL and let the caller use the exact periodic kernel instead
+    int box_size = 1;
+    for (int k = 0; k < pt_dim; k++) box_size *= n_cheb;
+    tab->n_box = 2;
+    while (1)
+    {
+        H2P_pkernel_tab_fill(tab);
+        if (tab->max_relerr <= tol) break;
+        int n_node_next = box_size;
+        for (int k = 0; k < pt_dim; k++) n_node_next *= 2 * tab->n_box;
+        if (n_node_next > PKRNL_TAB_MAX_NODE)
+        {
+            WARNING_PRINTF(
+                "Periodic kernel table reaches max size, relative error %.2e > reltol %.2e, use the periodic kernel directly\n",
+                tab->max_relerr, tol
+            );
+            H2P_pkernel_tab_destroy(&tab);
+            break;
+        }
+        tab->n_box *= 2;
+    }
+
+    *tab_ = tab;
+}
+
+// Destroy a H2P_pkernel_tab structure
+void H2P_pkernel_tab_destroy(H2P_pkernel_tab_p *tab_)
+{
+    H2P_pkernel_tab_p tab = *tab_;
+    if (tab == NULL) return;
+    free(tab->xpt_ref);
+    free(tab->lattices);
+    free(tab->cheb_node);
+    free(tab->cheb_bw);
+    free_aligned(tab->vals);
+    free(tab);
+    *tab_ = NULL;
+}
+
+// Interpolate the correction matrix corr(coord0, coord1) from the table
+void H2P_pkernel_tab_eval_corr(
+    H2P_pkernel_tab_p tab, const DTYPE *coord0, const int ld0, const int n0,
+    const DTYPE *coord1, const int ld1, const int n1, DTYPE *mat, const int ldm
+)
+{
+    int pt_dim   = tab->pt_dim;
+    int krnl_dim = tab->krnl_dim;
+    int n_cheb   = tab->n_cheb;
+    int n_box    = tab->n_box;
+    int krnl_dim2 = krnl_dim * krnl_dim;
+    int box_size  = 1;
+    for (int k = 0; k < pt_dim; k++) box_size *= n_cheb;
+
+    DTYPE *workbuf = (DTYPE*) malloc(sizeof(DTYPE) * (box_size + pt_dim * n_cheb));
+    ASSERT_PRINTF(workbuf != NULL, "Failed to allocate periodic kernel table work buffer\n");
+    DTYPE *W = workbuf;
+    DTYPE *l = workbuf + box_size;
+
+    for (int i = 0; i < n0; i++)
+    {
+        for (int j = 0; j < n1; j++)
+        {
+            // 1. Locate the box of d = coord0(:, i) - coord1(:, j) and
+            //    evaluate the Lagrange basis in each dimension
+            int b = 0, b_stride = 1;
+            for (int k = 0; k < pt_dim; k++)
+            {
+                DTYPE L_k = tab->cell_width[k];
+                DTYPE h_k = 2.0 * L_k / (DTYPE) n_box;
+                DTYPE s_k = (coord0[k * ld0 + i] - coord1[k * ld1 + j] + L_k) / h_k;
+                int b_k = (int) DFLOOR(s_k);
+                b_k = MAX(b_k, 0);
+                b_k = MIN(b_k, n_box - 1);
+                DTYPE t_k = 2.0 * (s_k - (DTYPE) b_k) - 1.0;
+                t_k = MAX(t_k, -1.0);
+                t_k = MIN(t_k,  1.0);
+                H2P_pkernel_tab_lagrange(n_cheb, tab->cheb_node, tab->cheb_bw, t_k, l + k * n_cheb);
+                b += b_k * b_stride;
+                b_stride *= n_box;
+            }
+
+            // 2. Tensor-product weights W(q) = prod_k l_k(m_k), q = sum_k m_k * n_cheb^k
+            int W_size = 1;
+            W[0] = 1.0;
+            for (int k = 0; k < pt_dim; k++)
+            {
+                const DTYPE *l_k = l + k * n_cheb;
+                for (int m = n_cheb - 1; m >= 0; m--)
+                {
+                    DTYPE *W_m = W + m * W_size;
+                    for (int q = 0; q < W_size; q++) W_m[q] = W[q] * l_k[m];
+                }
+                W_size *= n_cheb;
+            }
+
+            // 3. corr(comp) = dot(W, vals(b, comp, :))
+            const DTYPE *vals_b = tab->vals + (size_t) b * (size_t) (krnl_dim2 * box_size);
+            for (int r = 0; r < krnl_dim; r++)
+            {
+                DTYPE *mat_ir = mat + (i * krnl_dim + r) * ldm + j * krnl_dim;
+                for (int c = 0; c < krnl_dim; c++)
+                {
+                    const DTYPE *vals_bc = vals_b + (r * krnl_dim + c) * box_size;
+                    DTYPE res = 0.0;
+                    #pragma omp simd reduction(+:res)
+                    for (int q = 0; q < box_size; q++) res += W[q] * vals_bc[q];
+                    mat_ir[c] = res;
+                }
+            }
+        }  // End of j loop
+    }  // End of i loop
+
+    free(workbuf);
+}
+
+// Check if the extended coordinates of a point set match tab->xpt_ref
+int H2P_pkernel_tab_match_xpt(H2P_pkernel_tab_p tab, const DTYPE *coord, const int ld, const int n)
+{
+    for (int k = tab->pt_dim; k < tab->xpt_dim; k++)
+    {
+        const DTYPE *coord_k = coord + k * ld;
+        DTYPE xpt_k = tab->xpt_ref[k - tab->pt_dim];
+        for (int i = 0; i < n; i++)
+            if (coord_k[i] != xpt_k) return 0;
+    }
+    return 1;
+}
+
+// Periodic system kernel matrix evaluation using the table
+void H2P_pkernel_tab_eval(
+    const DTYPE *coord0, const int ld0, const int n0,
+    const DTYPE *coord1, const int ld1, const int n1,
+    const void *param, DTYPE * __restrict mat, const int ldm
+)
+{
+    H2P_pkernel_tab_p tab = (H2P_pkernel_tab_p) param;
+    if (H2P_pkernel_tab_match_xpt(tab, coord0, ld0, n0) == 0 ||
+        H2P_pkernel_tab_match_xpt(tab, coord1, ld1, n1) == 0)
+    {
+        tab->pkrnl_eval(coord0, ld0, n0, coord1, ld1, n1, tab->pkrnl_param, mat, ldm);
+        return;
+    }
+
+    int pt_dim   = tab->pt_dim;
+    int xpt_dim  = tab->xpt_dim;
+    int krnl_dim = tab->krnl_dim;
+    int ldk      = n1 * krnl_dim;
+    DTYPE *c0 = (DTYPE*) malloc(sizeof(DTYPE) * (xpt_dim * (n0 + n1) + n0 * krnl_dim * ldk));
+    ASSERT_PRINTF(c0 != NULL, "Failed to allocate periodic kernel table work buffer\n");
+    DTYPE *c1 = c0 + xpt_dim * n0;
+    DTYPE *krnl_mat = c1 + xpt_dim * n1;
+
+    // 1. Wrap all points into [0, L)^pt_dim, pkernel is periodic and the
+    //    coordinate differences are in (-L, L)^pt_dim
+    for (int k = 0; k < xpt_dim; k++)
+    {
+        DTYPE L_k = (k < pt_dim) ? tab->cell_width[k] : 0.0;
+        for (int i = 0; i < n0; i++)
+        {
+            DTYPE x = coord0[k * ld0 + i];
+            c0[k * n0 + i] = (k < pt_dim) ? (x - L_k * DFLOOR(x / L_k)) : x;
+        }
+        for (int j = 0; j < n1; j++)
+        {
+            DTYPE x = coord1[k * ld1 + j];
+            c1[k * n1 + j] = (k < pt_dim) ? (x - L_k * DFLOOR(x / L_k)) : x;
+        }
+    }
+
+    // 2. pkernel = corr + sum_{l} kernel(c0, c1 + shift_l)
+    H2P_pkernel_tab_eval_corr(tab, c0, n0, n0, c1, n1, n1, mat, ldm);
+    for (int l = 0; l < tab->n_lattice; l++)
+    {
+        const DTYPE *lattice_l = tab->lattices + l * pt_dim;
+        for (int k = 0; k < pt_dim; k++)
+        {
+            DTYPE shift_k = lattice_l[k] * tab->cell_width[k];
+            for (int j = 0; j < n1; j++) c1[k * n1 + j] += shift_k;
+        }
+        tab->krnl_eval(c0, n0, n0, c1, n1, n1, tab->krnl_param, krnl_mat, ldk);
+        for (int i = 0; i < n0 * krnl_dim; i++)
+        {
+            DTYPE *mat_i  = mat + i * ldm;
+            DTYPE *krnl_i = krnl_mat + i * ldk;
+            #pragma omp simd
+            for (int j = 0; j < ldk; j++) mat_i[j] += krnl_i[j];
+        }
+        for (int k = 0; k < pt_dim; k++)
+        {
+            DTYPE shift_k = lattice_l[k] * tab->cell_width[k];
+            for (int j = 0; j < n1; j++) c1[k * n1 + j] -= shift_k;
+        }
+    }
+
+    free(c0);
+}
@@ -0,0 +1,124 @@
+#ifndef __H2PACK_PKERNEL_TAB_H__
+#define __H2PACK_PKERNEL_TAB_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Tabulated smooth correction of a periodic system kernel (Ewald summation).
+// For two points in the unit cell, d = x - y is in [-L, L]^pt_dim and
+//   corr(d) = pkernel(x, y) - sum_{l} kernel(x, y + shift_l),
+// where shift_l runs over the 3^pt_dim nearest lattices (same as h2pack->per_lattices).
+// All singularities in [-L, L]^pt_dim cancel, so corr is smooth and is stored
+// as its values on tensor-product Chebyshev nodes in n_box^pt_dim boxes.
+struct H2P_pkernel_tab
+{
+    int    pt_dim;              // Dimension of point coordinate
+    int    xpt_dim;             // Dimension of extended point coordinate
+    int    krnl_dim;            // Dimension of kernel's return
+    int    n_cheb;              // Number of Chebyshev nodes in each dimension of each box
+    int    n_box;               // Number of boxes in each dimension
+    int    n_lattice;           // Number of lattices, == 3^pt_dim
+    DTYPE  cell_width[3];       // Size pt_dim, unit cell width in each dimension
+    DTYPE  *xpt_ref;            // Size xpt_dim - pt_dim, extended coordinates of all tabulated points
+    DTYPE  *lattices;           // Size n_lattice * pt_dim, each row is a lattice
+    DTYPE  *cheb_node;          // Size n_cheb, Chebyshev nodes on [-1, 1]
+    DTYPE  *cheb_bw;            // Size n_cheb, barycentric weights of cheb_node
+    DTYPE  *vals;               // Size n_box^pt_dim * krnl_dim^2 * n_cheb^pt_dim, corr values
+    DTYPE  max_relerr;          // Max interpolation error of corr on check points in each box, relative to max |corr|
+    void   *krnl_param;         // Pointer to kernel function parameter array
+    void   *pkrnl_param;        // Pointer to periodic system kernel function parameter array
+    kernel_eval_fptr krnl_eval;     // Pointer to kernel matrix evaluation function
+    kernel_eval_fptr pkrnl_eval;    // Pointer to periodic system kernel matrix evaluation function
+    size_t mem_size;            // Size (in DTYPE) of vals
+};
+typedef struct H2P_pkernel_tab  H2P_pkernel_tab_s;
+typedef struct H2P_pkernel_tab* H2P_pkernel_tab_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tabulate the correction between a periodic system kernel and the kernel
+// sum over the nearest lattices. The table depends only on the cell size and
+// the kernel parameters, so it can be reused by all H2P_build_periodic() calls
+// with the same (L, xi, tolerance).
+// Input parameters:
+//   pt_dim      : Dimension of point coordinate, 1 <= pt_dim <= 3
+//   xpt_dim     : Dimension of extended point coordinate
+//   krnl_dim    : Dimension of kernel's return
+//   cell_width  : Size pt_dim, unit cell width in each dimension
+//   xpt_ref     : Size xpt_dim - pt_dim, extended coordinates (e.g. RPY radius) of
+//                 all points, can be NULL if xpt_dim == pt_dim
+//   krnl_param  : Pointer to kernel function parameter array
+//   krnl_eval   : Pointer to kernel matrix evaluation function
+//   pkrnl_param : Pointer to periodic system kernel function parameter array
+//   pkrnl_eval  : Pointer to periodic system kernel matrix evaluation function
+//   reltol      : Relative interpolation error tolerance of the correction
+// Output parameter:
+//   tab_ : Constructed H2P_pkernel_tab structure, NULL if reltol cannot be reached 
+//          with the maximum table size. In this case, use pkrnl_eval and pkrnl_param 
+//          directly in H2P_build_periodic().
+// Note:
+//   The kernel and periodic system kernel parameter arrays are referenced by
+//   tab_ and should not be freed before tab_ is destroyed.
+void H2P_pkernel_tab_init(
+    const int pt_dim, const int xpt_dim, const int krnl_dim,
+    const DTYPE *cell_width, const DTYPE *xpt_ref,
+    void *krnl_param,  kernel_eval_fptr krnl_eval,
+    void *pkrnl_param, kernel_eval_fptr pkrnl_eval,
+    const DTYPE reltol, H2P_pkernel_tab_p *tab_
+);
+
+// Destroy a H2P_pkernel_tab structure
+// Input parameter:
+//   tab_ : Pointer to a H2P_pkernel_tab structure to be destroyed
+void H2P_pkernel_tab_destroy(H2P_pkernel_tab_p *tab_);
+
+// Interpolate the correction matrix corr(coord0, coord1) from the table
+// Input parameters:
+//   tab    : Constructed H2P_pkernel_tab structure
+//   coord0 : Matrix, size tab->xpt_dim-by-ld0, coordinates of the 1st point set
+//   ld0    : Leading dimension of coord0, should be >= n0
+//   n0     : Number of points in coord0 (each column in coord0 is a coordinate)
+//   coord1 : Matrix, size tab->xpt_dim-by-ld1, coordinates of the 2nd point set
+//   ld1    : Leading dimension of coord1, should be >= n1
+//   n1     : Number of points in coord1 (each column in coord1 is a coordinate)
+//   ldm    : Leading dimension of mat
+// Output parameter:
+//   mat : Size (n0 * krnl_dim)-by-ldm, interpolated correction matrix
+// Note:
+//   All points should be in the same unit cell and have the same extended
+//   coordinates as tab->xpt_ref, coordinate differences outside [-L, L] are clamped.
+void H2P_pkernel_tab_eval_corr(
+    H2P_pkernel_tab_p tab, const DTYPE *coord0, const int ld0, const int n0,
+    const DTYPE *coord1, const int ld1, const int n1, DTYPE *mat, const int ldm
+);
+
+// Check if the extended coordinates of a point set match tab->xpt_ref
+// Input parameters:
+//   tab   : Constructed H2P_pkernel_tab structure
+//   coord : Matrix, size tab->xpt_dim-by-ld, coordinates of the point set
+//   ld    : Leading dimension of coord, should be >= n
+//   n     : Number of points in coord
+// Output parameter:
+//   <ret> : 1 if all points' extended coordinates equal tab->xpt_ref, otherwise 0
+int H2P_pkernel_tab_match_xpt(H2P_pkernel_tab_p tab, const DTYPE *coord, const int ld, const int n);
+
+// Periodic system kernel matrix evaluation using the table, can be used as
+// pkrnl_eval in H2P_build_periodic() with pkrnl_param = a H2P_pkernel_tab_p.
+// Points are wrapped into the unit cell, then pkernel = corr + sum_{l} kernel.
+// Blocks with points not matching tab->xpt_ref are evaluated with tab->pkrnl_eval.
+// H2P_build_periodic() uses the correction directly and skips the lattice sum.
+// Input parameters: the same as kernel_eval_fptr, param is a H2P_pkernel_tab_p
+// Output parameter: the same as kernel_eval_fptr
+void H2P_pkernel_tab_eval(
+    const DTYPE *coord0, const int ld0, const int n0,
+    const DTYPE *coord1, const int ld1, const int n1,
+    const void *param, DTYPE * __restrict mat, const int ldm
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,577 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <omp.h>
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+#include "H2Pack_aux_structs.h"
+#include "H2Pack_partition.h"
+#include "H2Pack_gen_proxy_point.h"
+#include "H2Pack_matvec.h"
+#include "H2Pack_rect.h"
+#include "H2Pack_utils.h"
+#include "linalg_lib_wrapper.h"
+#include "utils.h"
+
+// Root box and level 1 box do not have proxy points, see H2P_generate_proxy_point_ID_file()
+#define RECT_MIN_ADM_LEVEL 2
+
+// Initialize a H2P_rect structure
+void H2P_rect_init(
+    H2P_rect_p *rect_, const int pt_dim, const int krnl_dim,
+    const int QR_stop_type, void *QR_stop_param
+)
+{
+    H2P_rect_p rect = (H2P_rect_p) malloc(sizeof(H2P_rect_s));
+    ASSERT_PRINTF(rect != NULL, "Failed to allocate H2P_rect structure\n");
+    memset(rect, 0, sizeof(H2P_rect_s));
+    H2P_init(&rect->row_h2, pt_dim, krnl_dim, QR_stop_type, QR_stop_param);
+    H2P_init(&rect->col_h2, pt_dim, krnl_dim, QR_stop_type, QR_stop_param);
+    rect->pt_dim   = pt_dim;
+    rect->krnl_dim = krnl_dim;
+    rect->n_thread = rect->row_h2->n_thread;
+    rect->BD_JIT   = 0;
+    *rect_ = rect;
+}
+
+// Destroy a H2P_rect structure
+void H2P_rect_destroy(H2P_rect_p *rect_)
+{
+    H2P_rect_p rect = *rect_;
+    if (rect == NULL) return;
+    free(rect->r_adm_pairs);
+    free(rect->r_inadm_pairs);
+    free(rect->adm_row_ptr);
+    free(rect->inadm_row_ptr);
+    free(rect->B_nrow);
+    free(rect->B_ncol);
+    free(rect->D_nrow);
+    free(rect->D_ncol);
+    free(rect->B_ptr);
+    free(rect->D_ptr);
+    free_aligned(rect->B_data);
+    free_aligned(rect->D_data);
+    free(rect->root_enbox);
+    H2P_destroy(&rect->row_h2);
+    H2P_destroy(&rect->col_h2);
+    free(rect);
+    *rect_ = NULL;
+}
+
+// Calculate reduced (in)admissible pairs between the row tree and the column tree
+// Input parameters:
+//   rect : H2P_rect structure with two H2 trees
+//   n0   : Row tree node
+//   n1   : Column tree node
+// Output parameters:
+//   adm_pairs     : Reduced admissible pairs
+//   inadm_pairs   : Reduced inadmissible pairs
+//   min_adm_level : Minimum level of reduced admissible pair
+static void H2P_rect_calc_reduced_adm_pairs(
+    H2P_rect_p rect, const int n0, const int n1,
+    H2P_int_vec_p adm_pairs, H2P_int_vec_p inadm_pairs, int *min_adm_level
+)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    int pt_dim     = rect->pt_dim;
+    int n_child_n0 = row_h2->n_child[n0];
+    int n_child_n1 = col_h2->n_child[n1];
+    int level_n0   = row_h2->node_level[n0];
+    int level_n1   = col_h2->node_level[n1];
+
+    // 1. Admissible pair and the level of both node is not smaller than
+    //    the minimum level that has proxy points
+    DTYPE *enbox_n0 = row_h2->enbox + n0 * pt_dim * 2;
+    DTYPE *enbox_n1 = col_h2->enbox + n1 * pt_dim * 2;
+    if (H2P_check_box_admissible(enbox_n0, enbox_n1, pt_dim, ALPHA_H2) &&
+        (level_n0 >= RECT_MIN_ADM_LEVEL) && (level_n1 >= RECT_MIN_ADM_LEVEL))
+    {
+        H2P_int_vec_push_back(adm_pairs, n0);
+        H2P_int_vec_push_back(adm_pairs, n1);
+        int max_level_n01 = MAX(level_n0, level_n1);
+        *min_adm_level = MIN(*min_adm_level, max_level_n01);
+        return;
+    }
+
+    // 2. Two inadmissible leaf node
+    if ((n_child_n0 == 0) && (n_child_n1 == 0))
+    {
+        H2P_int_vec_push_back(inadm_pairs, n0);
+        H2P_int_vec_push_back(inadm_pairs, n1);
+        return;
+    }
+
+    // 3. Check the leaf node with the children of the non-leaf node,
+    //    or check the children of both nodes
+    int *child_n0 = row_h2->children + n0 * row_h2->max_child;
+    int *child_n1 = col_h2->children + n1 * col_h2->max_child;
+    if (n_child_n0 == 0)
+    {
+        for (int j = 0; j < n_child_n1; j++)
+            H2P_rect_calc_reduced_adm_pairs(rect, n0, child_n1[j], adm_pairs, inadm_pairs, min_adm_level);
+        return;
+    }
+    if (n_child_n1 == 0)
+    {
+        for (int i = 0; i < n_child_n0; i++)
+            H2P_rect_calc_reduced_adm_pairs(rect, child_n0[i], n1, adm_pairs, inadm_pairs, min_adm_level);
+        return;
+    }
+    for (int i = 0; i < n_child_n0; i++)
+        for (int j = 0; j < n_child_n1; j++)
+            H2P_rect_calc_reduced_adm_pairs(rect, child_n0[i], child_n1[j], adm_pairs, inadm_pairs, min_adm_level);
+}
+
+// Sort node pairs by their row nodes using counting sort
+// Input parameters:
+//   n_node : Number of nodes in the row tree
+//   n_pair : Number of node pairs
+//   pairs  : Size 2 * n_pair, node pairs
+// Output parameters:
+//   sorted_pairs : Size 2 * n_pair, node pairs sorted by row node
+//   row_ptr      : Size n_node + 1, pairs of row node i are pairs row_ptr[i] : row_ptr[i+1]-1
+static void H2P_rect_sort_pairs_by_row(
+    const int n_node, const int n_pair, const int *pairs, int *sorted_pairs, int *row_ptr
+)
+{
+    memset(row_ptr, 0, sizeof(int) * (n_node + 1));
+    for (int i = 0; i < n_pair; i++) row_ptr[pairs[2 * i] + 1]++;
+    for (int i = 1; i <= n_node; i++) row_ptr[i] += row_ptr[i - 1];
+    int *pos = (int*) malloc(sizeof(int) * n_node);
+    ASSERT_PRINTF(pos != NULL, "Failed to allocate work buffer of size %d\n", n_node);
+    memcpy(pos, row_ptr, sizeof(int) * n_node);
+    for (int i = 0; i < n_pair; i++)
+    {
+        int idx = pos[pairs[2 * i]]++;
+        sorted_pairs[2 * idx]     = pairs[2 * i];
+        sorted_pairs[2 * idx + 1] = pairs[2 * i + 1];
+    }
+    free(pos);
+}
+
+// Partition the row and column points and find the (row node, column node)
+// admissible and inadmissible pairs using a dual tree traversal
+void H2P_rect_partition_points(
+    H2P_rect_p rect, const int n_row_point, const DTYPE *row_coord,
+    const int n_col_point, const DTYPE *col_coord,
+    int max_leaf_points, DTYPE max_leaf_size
+)
+{
+    int pt_dim = rect->pt_dim;
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    double st, et;
+
+    st = get_wtime_sec();
+
+    // 1. Both trees use the enclosing box of all points as the root box, so
+    //    boxes on the same level of two trees have the same size
+    if (rect->root_enbox == NULL)
+    {
+        int n_point = n_row_point + n_col_point;
+        DTYPE *coord = (DTYPE*) malloc(sizeof(DTYPE) * pt_dim * n_point);
+        ASSERT_PRINTF(coord != NULL, "Failed to allocate matrix of size %d * %d\n", pt_dim, n_point);
+        for (int j = 0; j < pt_dim; j++)
+        {
+            memcpy(coord + j * n_point, row_coord + j * n_row_point, sizeof(DTYPE) * n_row_point);
+            memcpy(coord + j * n_point + n_row_point, col_coord + j * n_col_point, sizeof(DTYPE) * n_col_point);
+        }
+        H2P_calc_enclosing_box(pt_dim, n_point, coord, NULL, &rect->root_enbox);
+        // Enlarge the box a little bit so that all points are strictly inside it
+        for (int j = 0; j < pt_dim; j++)
+        {
+            rect->root_enbox[j] -= 1e-8;
+            rect->root_enbox[pt_dim + j] += 2e-8;
+        }
+        free(coord);
+    }
+    row_h2->root_enbox = (DTYPE*) malloc(sizeof(DTYPE) * pt_dim * 2);
+    col_h2->root_enbox = (DTYPE*) malloc(sizeof(DTYPE) * pt_dim * 2);
+    ASSERT_PRINTF(
+        row_h2->root_enbox != NULL && col_h2->root_enbox != NULL,
+        "Failed to allocate root enclosing boxes\n"
+    );
+    memcpy(row_h2->root_enbox, rect->root_enbox, sizeof(DTYPE) * pt_dim * 2);
+    memcpy(col_h2->root_enbox, rect->root_enbox, sizeof(DTYPE) * pt_dim * 2);
+
+    // 2. Hierarchical partitioning of row points and column points
+    H2P_partition_points(row_h2, n_row_point, row_coord, max_leaf_points, max_leaf_size);
+    H2P_partition_points(col_h2, n_col_point, col_coord, max_leaf_points, max_leaf_size);
+
+    // 3. Calculate reduced (in)admissible pairs between two trees
+    H2P_int_vec_p adm_pairs, inadm_pairs;
+    H2P_int_vec_init(&adm_pairs,   1024);
+    H2P_int_vec_init(&inadm_pairs, 1024);
+    int min_adm_level = MAX(row_h2->max_level, col_h2->max_level) + 1;
+    H2P_rect_calc_reduced_adm_pairs(rect, row_h2->root_idx, col_h2->root_idx, adm_pairs, inadm_pairs, &min_adm_level);
+    rect->min_adm_level  = min_adm_level;
+    rect->n_r_adm_pair   = adm_pairs->length   / 2;
+    rect->n_r_inadm_pair = inadm_pairs->length / 2;
+    int row_n_node = row_h2->n_node;
+    rect->r_adm_pairs   = (int*) malloc(sizeof(int) * (2 * rect->n_r_adm_pair   + 1));
+    rect->r_inadm_pairs = (int*) malloc(sizeof(int) * (2 * rect->n_r_inadm_pair + 1));
+    rect->adm_row_ptr   = (int*) malloc(sizeof(int) * (row_n_node + 1));
+    rect->inadm_row_ptr = (int*) malloc(sizeof(int) * (row_n_node + 1));
+    ASSERT_PRINTF(
+        rect->r_adm_pairs != NULL && rect->r_inadm_pairs != NULL &&
+        rect->adm_row_ptr != NULL && rect->inadm_row_ptr != NULL,
+        "Failed to allocate arrays of sizes %d and %d for storing (in)admissible pairs\n",
+        rect->n_r_adm_pair * 2, rect->n_r_inadm_pair * 2
+    );
+    H2P_rect_sort_pairs_by_row(row_n_node, rect->n_r_adm_pair,   adm_pairs->data,   rect->r_adm_pairs,   rect->adm_row_ptr);
+    H2P_rect_sort_pairs_by_row(row_n_node, rect->n_r_inadm_pair, inadm_pairs->data, rect->r_inadm_pairs, rect->inadm_row_ptr);
+    H2P_int_vec_destroy(&adm_pairs);
+    H2P_int_vec_destroy(&inadm_pairs);
+
+    // 4. Both trees need projection matrices on levels [min_adm_level, max_level]
+    row_h2->min_adm_level = min_adm_level;
+    col_h2->min_adm_level = min_adm_level;
+    H2P_build_upward_task_queue(row_h2);
+    H2P_build_upward_task_queue(col_h2);
+
+    et = get_wtime_sec();
+    row_h2->timers[PT_TIMER_IDX] = et - st;
+}
+
+// Generate proxy points for a rectangular H2 matrix
+void H2P_rect_generate_proxy_point_ID_file(
+    H2P_rect_p rect, const void *krnl_param, kernel_eval_fptr krnl_eval,
+    const char *fname, H2P_dense_mat_p **pp_
+)
+{
+    // Two trees have the same root box, the deeper tree needs proxy points on more levels
+    H2Pack_p h2pack = rect->row_h2;
+    if (rect->col_h2->max_level > h2pack->max_level) h2pack = rect->col_h2;
+    H2P_generate_proxy_point_ID_file(h2pack, krnl_param, krnl_eval, fname, pp_);
+}
+
+// Set up forward and backward permutation indices of a H2 tree
+static void H2P_rect_set_pmt_idx(H2Pack_p h2pack)
+{
+    int n_point    = h2pack->n_point;
+    int krnl_dim   = h2pack->krnl_dim;
+    int *coord_idx = h2pack->coord_idx;
+    int *fwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+    int *bwd_pmt_idx = (int*) malloc(sizeof(int) * n_point * krnl_dim);
+    ASSERT_PRINTF(
+        fwd_pmt_idx != NULL && bwd_pmt_idx != NULL,
+        "Failed to allocate permutation index arrays of size %d\n", n_point * krnl_dim
+    );
+    for (int i = 0; i < n_point; i++)
+    {
+        for (int j = 0; j < krnl_dim; j++)
+        {
+            fwd_pmt_idx[i * krnl_dim + j] = coord_idx[i] * krnl_dim + j;
+            bwd_pmt_idx[coord_idx[i] * krnl_dim + j] = i * krnl_dim + j;
+        }
+    }
+    h2pack->fwd_pmt_idx = fwd_pmt_idx;
+    h2pack->bwd_pmt_idx = bwd_pmt_idx;
+}
+
+// Get the coordinates used by the row (column) side of an admissible pair. If the
+// node on the other side is on a higher level (a larger leaf box), use the skeleton
+// points of this node, otherwise this node is a leaf node and use all its points.
+// Input parameters:
+//   h2pack      : H2Pack structure of the row (column) tree
+//   node        : Row (column) node
+//   use_skel    : If use the skeleton points of this node
+// Output parameters:
+//   coord_, ld_ : Coordinate matrix and its leading dimension
+//   npt_        : Number of points
+static void H2P_rect_node_coord(
+    H2Pack_p h2pack, const int node, const int use_skel,
+    DTYPE **coord_, int *ld_, int *npt_
+)
+{
+    if (use_skel)
+    {
+        H2P_dense_mat_p J_coord = h2pack->J_coord[node];
+        *coord_ = J_coord->data;
+        *ld_    = J_coord->ld;
+        *npt_   = J_coord->ncol;
+    } else {
+        int pt_s = h2pack->pt_cluster[2 * node];
+        int pt_e = h2pack->pt_cluster[2 * node + 1];
+        *coord_ = h2pack->coord + pt_s;
+        *ld_    = h2pack->n_point;
+        *npt_   = pt_e - pt_s + 1;
+    }
+}
+
+// Evaluate the i-th B or D matrix of a rectangular H2 matrix
+static void H2P_rect_eval_BD(H2P_rect_p rect, const int is_B, const int i, DTYPE *mat, const int ldm)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    int *pairs  = is_B ? rect->r_adm_pairs : rect->r_inadm_pairs;
+    int node0   = pairs[2 * i];
+    int node1   = pairs[2 * i + 1];
+    int level0  = row_h2->node_level[node0];
+    int level1  = col_h2->node_level[node1];
+    int ld0, ld1, npt0, npt1;
+    DTYPE *coord0, *coord1;
+    H2P_rect_node_coord(row_h2, node0, is_B && (level0 >= level1), &coord0, &ld0, &npt0);
+    H2P_rect_node_coord(col_h2, node1, is_B && (level1 >= level0), &coord1, &ld1, &npt1);
+    H2P_eval_kernel_matrix_tiled(
+        rect->krnl_param, rect->krnl_eval, rect->krnl_dim,
+        coord0, ld0, npt0, coord1, ld1, npt1, mat, ldm
+    );
+}
+
+// Calculate the sizes of all B or D matrices and build them if BD_JIT == 0
+static void H2P_rect_build_BD(H2P_rect_p rect, const int is_B)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    int krnl_dim = rect->krnl_dim;
+    int n_pair   = is_B ? rect->n_r_adm_pair : rect->n_r_inadm_pair;
+    int *pairs   = is_B ? rect->r_adm_pairs  : rect->r_inadm_pairs;
+    int *nrow    = (int*)    malloc(sizeof(int)    * (n_pair + 1));
+    int *ncol    = (int*)    malloc(sizeof(int)    * (n_pair + 1));
+    size_t *ptr  = (size_t*) malloc(sizeof(size_t) * (n_pair + 1));
+    ASSERT_PRINTF(
+        nrow != NULL && ncol != NULL && ptr != NULL,
+        "Failed to allocate B / D matrices metadata arrays of size %d\n", n_pair + 1
+    );
+    ptr[0] = 0;
+    for (int i = 0; i < n_pair; i++)
+    {
+        int node0  = pairs[2 * i];
+        int node1  = pairs[2 * i + 1];
+        int level0 = row_h2->node_level[node0];
+        int level1 = col_h2->node_level[node1];
+        nrow[i] = krnl_dim * (row_h2->pt_cluster[2 * node0 + 1] - row_h2->pt_cluster[2 * node0] + 1);
+        ncol[i] = krnl_dim * (col_h2->pt_cluster[2 * node1 + 1] - col_h2->pt_cluster[2 * node1] + 1);
+        if (is_B && level0 >= level1) nrow[i] = row_h2->U[node0]->ncol;
+        if (is_B && level1 >= level0) ncol[i] = col_h2->U[node1]->ncol;
+        ptr[i + 1] = ptr[i] + (size_t) nrow[i] * (size_t) ncol[i];
+    }
+    size_t total_size = ptr[n_pair];
+    row_h2->mat_size[is_B ? B_SIZE_IDX : D_SIZE_IDX] = total_size;
+    if (is_B)
+    {
+        rect->B_nrow = nrow;
+        rect->B_ncol = ncol;
+        rect->B_ptr  = ptr;
+    } else {
+        rect->D_nrow = nrow;
+        rect->D_ncol = ncol;
+        rect->D_ptr  = ptr;
+    }
+    if (rect->BD_JIT == 1) return;
+
+    DTYPE *data = (DTYPE*) malloc_aligned(sizeof(DTYPE) * (total_size + 1), 64);
+    ASSERT_PRINTF(data != NULL, "Failed to allocate space for storing all %zu B / D matrices elements\n", total_size);
+    #pragma omp parallel for schedule(dynamic) num_threads(rect->n_thread)
+    for (int i = 0; i < n_pair; i++)
+        H2P_rect_eval_BD(rect, is_B, i, data + ptr[i], ncol[i]);
+    if (is_B) rect->B_data = data;
+    else rect->D_data = data;
+}
+
+// Build a rectangular H2 matrix representation with a kernel function
+void H2P_rect_build(
+    H2P_rect_p rect, H2P_dense_mat_p *pp, const int BD_JIT,
+    void *krnl_param, kernel_eval_fptr krnl_eval
+)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    double st, et;
+
+    if (pp == NULL)
+    {
+        ERROR_PRINTF("You need to provide a set of proxy points.\n");
+        return;
+    }
+    if (krnl_eval == NULL)
+    {
+        ERROR_PRINTF("You need to provide a valid krnl_eval().\n");
+        return;
+    }
+
+    rect->BD_JIT     = BD_JIT;
+    rect->krnl_param = krnl_param;
+    rect->krnl_eval  = krnl_eval;
+    H2Pack_p h2_list[2] = {row_h2, col_h2};
+    for (int k = 0; k < 2; k++)
+    {
+        H2Pack_p h2pack = h2_list[k];
+        h2pack->pp         = pp;
+        h2pack->BD_JIT     = BD_JIT;
+        h2pack->krnl_param = krnl_param;
+        h2pack->krnl_eval  = krnl_eval;
+
+        // 1. Build row projection matrices U and column projection matrices V.
+        //    For a symmetric kernel, K(X_far, X_j) ~= K(X_far, J_j) * V_j^T can be
+        //    obtained in the same way as K(X_i, X_far) ~= U_i * K(J_i, X_far).
+        st = get_wtime_sec();
+        H2P_build_H2_UJ_proxy(h2pack);
+        et = get_wtime_sec();
+        h2pack->timers[U_BUILD_TIMER_IDX] = et - st;
+
+        H2P_rect_set_pmt_idx(h2pack);
+    }
+
+    // 2. Build generator matrices
+    st = get_wtime_sec();
+    H2P_rect_build_BD(rect, 1);
+    et = get_wtime_sec();
+    row_h2->timers[B_BUILD_TIMER_IDX] = et - st;
+
+    // 3. Build dense blocks
+    st = get_wtime_sec();
+    H2P_rect_build_BD(rect, 0);
+    et = get_wtime_sec();
+    row_h2->timers[D_BUILD_TIMER_IDX] = et - st;
+}
+
+// Multiply the B or D matrices of all pairs of a row node with the input vector
+// Input parameters:
+//   rect   : H2P_rect structure with rectangular H2 matrix representation
+//   is_B   : 1 for B matrices, 0 for D matrices
+//   node0  : Row tree node
+//   tid    : Thread ID
+//   pmt_x  : Permuted input vector in the column tree ordering
+// Output parameter:
+//   pmt_y  : Permuted output vector in the row tree ordering
+static void H2P_rect_matvec_row_node(
+    H2P_rect_p rect, const int is_B, const int node0, const int tid,
+    const DTYPE *pmt_x, DTYPE *pmt_y
+)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    int    *row_ptr  = is_B ? rect->adm_row_ptr : rect->inadm_row_ptr;
+    int    *pairs    = is_B ? rect->r_adm_pairs : rect->r_inadm_pairs;
+    int    *nrow     = is_B ? rect->B_nrow      : rect->D_nrow;
+    int    *ncol     = is_B ? rect->B_ncol      : rect->D_ncol;
+    size_t *BD_ptr   = is_B ? rect->B_ptr       : rect->D_ptr;
+    DTYPE  *BD_data  = is_B ? rect->B_data      : rect->D_data;
+    int    level0    = row_h2->node_level[node0];
+    H2P_dense_mat_p workbuf = row_h2->tb[tid]->mat0;
+    for (int i = row_ptr[node0]; i < row_ptr[node0 + 1]; i++)
+    {
+        int node1  = pairs[2 * i + 1];
+        int level1 = col_h2->node_level[node1];
+
+        // (1) Get the input and the output vectors
+        const DTYPE *x_in;
+        DTYPE *y_out;
+        if (is_B && level1 >= level0) x_in = col_h2->y0[node1]->data;
+        else x_in = pmt_x + col_h2->mat_cluster[2 * node1];
+        if (is_B && level0 >= level1) y_out = row_h2->y1[node0]->data;
+        else y_out = pmt_y + row_h2->mat_cluster[2 * node0];
+
+        // (2) Get the B or D matrix and multiply it with the input vector.
+        //     Each row node is handled by one thread, no need to transpose.
+        DTYPE *mat;
+        if (rect->BD_JIT == 1)
+        {
+            H2P_dense_mat_resize(workbuf, nrow[i], ncol[i]);
+            H2P_rect_eval_BD(rect, is_B, i, workbuf->data, workbuf->ld);
+            mat = workbuf->data;
+        } else {
+            mat = BD_data + BD_ptr[i];
+        }
+        CBLAS_GEMV(
+            CblasRowMajor, CblasNoTrans, nrow[i], ncol[i],
+            1.0, mat, ncol[i], x_in, 1, 1.0, y_out, 1
+        );
+    }
+}
+
+// Rectangular H2 matrix multiplies a column vector
+void H2P_rect_matvec(H2P_rect_p rect, const DTYPE *x, DTYPE *y)
+{
+    H2Pack_p row_h2 = rect->row_h2;
+    H2Pack_p col_h2 = rect->col_h2;
+    int    n_thread      = rect->n_thread;
+    int    row_n_node    = row_h2->n_node;
+    int    row_mat_size  = row_h2->krnl_mat_size;
+    int    *adm_row_ptr  = rect->adm_row_ptr;
+    int    *pairs        = rect->r_adm_pairs;
+    DTYPE  *pmt_x        = col_h2->pmt_x;
+    DTYPE  *pmt_y        = row_h2->pmt_y;
+    double *timers       = row_h2->timers;
+    double st, et;
+
+    // 1. Forward permute the input vector and reset the output vector
+    st = get_wtime_sec();
+    H2P_permute_vector_forward(col_h2, x, pmt_x);
+    #pragma omp parallel for simd num_threads(n_thread)
+    for (int i = 0; i < row_mat_size; i++) pmt_y[i] = 0;
+    et = get_wtime_sec();
+    timers[MV_VOP_TIMER_IDX] += et - st;
+
+    // 2. Forward transformation on the column tree, calculate V_j^T * x_j
+    st = get_wtime_sec();
+    H2P_matvec_fwd_transform(col_h2, pmt_x);
+    et = get_wtime_sec();
+    timers[MV_FWD_TIMER_IDX] += et - st;
+
+    // 3. Intermediate multiplication, calculate B_{ij} * (V_j^T * x_j). 
+    //    y1[i] is used in the backward transformation only if it has ld > 0.
+    st = get_wtime_sec();
+    if (row_h2->y1 == NULL)
+    {
+        row_h2->y1 = (H2P_dense_mat_p*) malloc(sizeof(H2P_dense_mat_p) * row_n_node);
+        ASSERT_PRINTF(row_h2->y1 != NULL, "Failed to allocate %d H2P_dense_mat_t for H2 matvec buffer\n", row_n_node);
+        for (int i = 0; i < row_n_node; i++) 
+            H2P_dense_mat_init(&row_h2->y1[i], 0, 0);
+    }
+    H2P_dense_mat_p *y1 = row_h2->y1;
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        #pragma omp for schedule(dynamic)
+        for (int node0 = 0; node0 < row_n_node; node0++)
+        {
+            int level0 = row_h2->node_level[node0];
+            int need_y1 = 0;
+            for (int i = adm_row_ptr[node0]; i < adm_row_ptr[node0 + 1]; i++)
+                if (level0 >= col_h2->node_level[pairs[2 * i + 1]]) need_y1 = 1;
+            y1[node0]->ld = 0;
+            if (need_y1)
+            {
+                int ncol = row_h2->U[node0]->ncol;
+                H2P_dense_mat_resize(y1[node0], 1, ncol);
+                memset(y1[node0]->data, 0, sizeof(DTYPE) * ncol);
+            }
+            H2P_rect_matvec_row_node(rect, 1, node0, tid, pmt_x, pmt_y);
+        }
+    }
+    et = get_wtime_sec();
+    timers[MV_MID_TIMER_IDX] += et - st;
+
+    // 4. Backward transformation on the row tree, calculate U_i * (B_{ij} * (V_j^T * x_j))
+    st = get_wtime_sec();
+    H2P_matvec_bwd_transform(row_h2, pmt_x, pmt_y);
+    et = get_wtime_sec();
+    timers[MV_BWD_TIMER_IDX] += et - st;
+
+    // 5. Dense multiplication, calculate D_{ij} * x_j
+    st = get_wtime_sec();
+    #pragma omp parallel num_threads(n_thread)
+    {
+        int tid = omp_get_thread_num();
+        #pragma omp for schedule(dynamic)
+        for (int node0 = 0; node0 < row_n_node; node0++)
+            H2P_rect_matvec_row_node(rect, 0, node0, tid, pmt_x, pmt_y);
+    }
+    et = get_wtime_sec();
+    timers[MV_DEN_TIMER_IDX] += et - st;
+
+    // 6. Backward permute the output vector
+    st = get_wtime_sec();
+    H2P_permute_vector_backward(row_h2, pmt_y, y);
+    et = get_wtime_sec();
+    timers[MV_VOP_TIMER_IDX] += et - st;
+
+    row_h2->n_matvec++;
+}
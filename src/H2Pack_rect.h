@@ -0,0 +1,126 @@
+#ifndef __H2PACK_RECT_H__
+#define __H2PACK_RECT_H__
+
+#include "H2Pack_config.h"
+#include "H2Pack_typedef.h"
+
+// Rectangular H2 matrix K(X_row, X_col) defined by two point sets. Two H2 trees
+// are built over the row (target) points and the column (source) points using
+// the same root enclosing box, so boxes on the same level have the same size and
+// share the same proxy points. row_h2->U are the row bases U, col_h2->U are the
+// column bases V, and K(X_row_i, X_col_j) ~= U_i * B_{ij} * V_j^T for each
+// admissible (row node i, column node j) pair.
+struct H2P_rect
+{
+    int    pt_dim;              // Dimension of point coordinate
+    int    krnl_dim;            // Dimension of tensor kernel's return
+    int    n_thread;            // Number of threads
+    int    BD_JIT;              // If B and D matrices are computed just-in-time in matvec
+    int    min_adm_level;       // Minimum level of reduced admissible pair
+    int    n_r_adm_pair;        // Number of reduced admissible pairs
+    int    n_r_inadm_pair;      // Number of reduced inadmissible pairs
+    int    *r_adm_pairs;        // Size 2 * n_r_adm_pair, (row node, column node) admissible pairs, sorted by row node
+    int    *r_inadm_pairs;      // Size 2 * n_r_inadm_pair, (row leaf node, column leaf node) inadmissible pairs, sorted by row node
+    int    *adm_row_ptr;        // Size row_h2->n_node + 1, admissible pairs of row node i are pairs adm_row_ptr[i] : adm_row_ptr[i+1]-1
+    int    *inadm_row_ptr;      // Size row_h2->n_node + 1, inadmissible pairs of row node i are pairs inadm_row_ptr[i] : inadm_row_ptr[i+1]-1
+    int    *B_nrow;             // Size n_r_adm_pair, numbers of rows of B matrices
+    int    *B_ncol;             // Size n_r_adm_pair, numbers of columns of B matrices
+    int    *D_nrow;             // Size n_r_inadm_pair, numbers of rows of D matrices
+    int    *D_ncol;             // Size n_r_inadm_pair, numbers of columns of D matrices
+    size_t *B_ptr;              // Size n_r_adm_pair + 1, offset of each B matrix in B_data
+    size_t *D_ptr;              // Size n_r_inadm_pair + 1, offset of each D matrix in D_data
+    DTYPE  *B_data;             // Data of all B matrices, NULL if BD_JIT == 1
+    DTYPE  *D_data;             // Data of all D matrices, NULL if BD_JIT == 1
+    DTYPE  *root_enbox;         // Size 2 * pt_dim, enclosing box of all row and column points
+    void   *krnl_param;         // Pointer to kernel function parameter array
+    kernel_eval_fptr krnl_eval; // Pointer to kernel matrix evaluation function
+    H2Pack_p row_h2;            // H2Pack structure of the row (target) point tree
+    H2Pack_p col_h2;            // H2Pack structure of the column (source) point tree
+};
+typedef struct H2P_rect  H2P_rect_s;
+typedef struct H2P_rect* H2P_rect_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Initialize a H2P_rect structure
+// Input parameters:
+//   pt_dim        : Dimension of point coordinate
+//   krnl_dim      : Dimension of tensor kernel's return
+//   QR_stop_type  : Partial QR stop criteria: QR_RANK, QR_REL_NRM, or QR_ABS_NRM
+//   QR_stop_param : Pointer to partial QR stop parameter
+// Output parameter:
+//   rect_ : Initialized H2P_rect structure
+void H2P_rect_init(
+    H2P_rect_p *rect_, const int pt_dim, const int krnl_dim,
+    const int QR_stop_type, void *QR_stop_param
+);
+
+// Destroy a H2P_rect structure
+// Input parameter:
+//   rect_ : Pointer to a H2P_rect structure to be destroyed
+void H2P_rect_destroy(H2P_rect_p *rect_);
+
+// Partition the row and column points and find the (row node, column node)
+// admissible and inadmissible pairs using a dual tree traversal
+// Input parameters:
+//   rect            : Initialized H2P_rect structure. If rect->root_enbox == NULL,
+//                     the enclosing box of all row and column points will be used
+//   n_row_point     : Number of row (target) points
+//   row_coord       : Matrix, size pt_dim-by-n_row_point, row point coordinates
+//   n_col_point     : Number of column (source) points
+//   col_coord       : Matrix, size pt_dim-by-n_col_point, column point coordinates
+//   max_leaf_points : Maximum point in a leaf node's box. If <= 0, will use default value
+//   max_leaf_size   : Maximum size of a leaf node's box. If <= 0, will use default value
+// Output parameter:
+//   rect : H2P_rect structure with two H2 trees and their (in)admissible pairs
+void H2P_rect_partition_points(
+    H2P_rect_p rect, const int n_row_point, const DTYPE *row_coord,
+    const int n_col_point, const DTYPE *col_coord,
+    int max_leaf_points, DTYPE max_leaf_size
+);
+
+// Generate proxy points for a rectangular H2 matrix, see H2P_generate_proxy_point_ID_file()
+// Input parameters:
+//   rect       : H2P_rect structure with point partitioning info
+//   krnl_param : Pointer to kernel function parameter array
+//   krnl_eval  : Pointer to kernel matrix evaluation function
+//   fname      : Proxy point file name, if == NULL or cannot find that file, compute all proxy points
+// Output parameter:
+//   pp_  : Array of proxy points for each level of both trees
+void H2P_rect_generate_proxy_point_ID_file(
+    H2P_rect_p rect, const void *krnl_param, kernel_eval_fptr krnl_eval,
+    const char *fname, H2P_dense_mat_p **pp_
+);
+
+// Build a rectangular H2 matrix representation with a kernel function
+// Input parameters:
+//   rect       : H2P_rect structure with point partitioning info
+//   pp         : Array of proxy points for each level
+//   BD_JIT     : 0 or 1, if B and D matrices are computed just-in-time in matvec
+//   krnl_param : Pointer to kernel function parameter array
+//   krnl_eval  : Pointer to kernel matrix evaluation function
+// Output parameter:
+//   rect : H2P_rect structure with rectangular H2 matrix representation
+// Note:
+//   The kernel function should be symmetric, i.e., k(x, y) == k(y, x),
+//   since the column bases are built in the same way as the row bases.
+void H2P_rect_build(
+    H2P_rect_p rect, H2P_dense_mat_p *pp, const int BD_JIT,
+    void *krnl_param, kernel_eval_fptr krnl_eval
+);
+
+// Rectangular H2 matrix multiplies a column vector, y := K(X_row, X_col) * x
+// Input parameters:
+//   rect : H2P_rect structure with rectangular H2 matrix representation
+//   x    : Size >= krnl_dim * n_col_point, input dense vector
+// Output parameter:
+//   y : Size >= krnl_dim * n_row_point, output dense vector
+void H2P_rect_matvec(H2P_rect_p rect, const DTYPE *x, DTYPE *y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,6 +8,7 @@
 #include "H2Pack_config.h"
 #include "H2Pack_typedef.h"
 #include "H2Pack_aux_structs.h"
+#include "H2Pack_utils.h"
 #include "DAG_task_queue.h"
 
 // Initialize an H2Pack structure
@@ -24,13 +25,13 @@ void H2P_init(
     h2pack->pt_dim       = pt_dim;
     h2pack->xpt_dim      = pt_dim;  // By default, we don't have any extended information
     h2pack->krnl_dim     = krnl_dim;
-    h2pack->max_child    = 1 << pt_dim;
+    h2pack->max_child    = H2P_MAX_CHILD(pt_dim);
     h2pack->n_matvec     = 0;
     h2pack->n_ULV_solve  = 0;
     h2pack->is_H2ERI     = 0;
     h2pack->is_HSS       = 0;
     h2pack->is_RPY_Ewald = 0;
-    memset(h2pack->mat_size,  0, sizeof(size_t) * 11);
+    memset(h2pack->mat_size,  0, sizeof(size_t) * 12);
     memset(h2pack->timers,    0, sizeof(double) * 11);
     memset(h2pack->JIT_flops, 0, sizeof(double) * 2);
     
@@ -72,6 +73,10 @@ void H2P_init(
     h2pack->D_p2i_colidx        = NULL;
     h2pack->D_p2i_val           = NULL;
     h2pack->ULV_Ls              = NULL;
+    h2pack->HSS_mv_spos         = NULL;
+    h2pack->HSS_mv_D_idx        = NULL;
+    h2pack->HSS_mv_pair_ptr     = NULL;
+    h2pack->HSS_mv_pairs        = NULL;
     h2pack->ULV_p               = NULL;
     h2pack->B_nrow              = NULL;
     h2pack->B_ncol              = NULL;
@@ -79,6 +84,17 @@ void H2P_init(
     h2pack->D_ncol              = NULL;
     h2pack->B_ptr               = NULL;
     h2pack->D_ptr               = NULL;
+    h2pack->mmap_addr           = NULL;
+    h2pack->mmap_size           = 0;
+    h2pack->ooc_fd              = -1;
+    h2pack->ooc_B_offset        = 0;
+    h2pack->ooc_D_offset        = 0;
+    h2pack->ooc_buf_size        = 0;
+    h2pack->krnl_param_bytes    = 0;
+    h2pack->krnl_param_buf      = NULL;
+    h2pack->ooc_buf             = NULL;
+    h2pack->ooc_B_chunk         = NULL;
+    h2pack->ooc_D_chunk         = NULL;
     h2pack->coord               = NULL;
     h2pack->coord0              = NULL;
     h2pack->enbox               = NULL;
@@ -91,8 +107,13 @@ void H2P_init(
     h2pack->per_blk             = NULL;
     h2pack->xT                  = NULL;
     h2pack->yT                  = NULL;
+    h2pack->ULV_Q_fp32          = NULL;
+    h2pack->ULV_L_fp32          = NULL;
     h2pack->pmt_x               = NULL;
     h2pack->pmt_y               = NULL;
+    h2pack->HSS_mv_buf          = NULL;
+    h2pack->HSS_mv_mode         = 0;
+    h2pack->HSS_mv_nvec         = 0;
     h2pack->J                   = NULL;
     h2pack->ULV_idx             = NULL;
     h2pack->J_coord             = NULL;
@@ -206,6 +227,13 @@ void H2P_run_RPY_Ewald(H2Pack_p h2pack)
     }
 }
 
+// Set the size of the kernel function parameter array
+void H2P_set_krnl_param_bytes(H2Pack_p h2pack, const size_t krnl_param_bytes)
+{
+    if (h2pack == NULL) return;
+    h2pack->krnl_param_bytes = krnl_param_bytes;
+}
+
 // Destroy an H2Pack structure
 void H2P_destroy(H2Pack_p *h2pack_)
 {
@@ -213,6 +241,7 @@ void H2P_destroy(H2Pack_p *h2pack_)
 
     if (h2pack == NULL) return;
     
+    H2P_close_binary_file(h2pack);
     free(h2pack->parent);
     free(h2pack->children);
     free(h2pack->pt_cluster);
@@ -241,6 +270,10 @@ void H2P_destroy(H2Pack_p *h2pack_)
     free(h2pack->D_p2i_colidx);
     free(h2pack->D_p2i_val);
     free(h2pack->ULV_Ls);
+    free(h2pack->HSS_mv_spos);
+    free(h2pack->HSS_mv_D_idx);
+    free(h2pack->HSS_mv_pair_ptr);
+    free(h2pack->HSS_mv_pairs);
     free(h2pack->B_nrow);
     free(h2pack->B_ncol);
     free(h2pack->D_nrow);
@@ -254,6 +287,7 @@ void H2P_destroy(H2Pack_p *h2pack_)
     free(h2pack->per_lattices);
     free(h2pack->per_adm_shifts);
     free(h2pack->per_inadm_shifts);
+    free(h2pack->krnl_param_buf);
     free_aligned(h2pack->B_data);
     free_aligned(h2pack->D_data);
     free_aligned(h2pack->per_blk);
@@ -261,6 +295,7 @@ void H2P_destroy(H2Pack_p *h2pack_)
     free(h2pack->yT);
     free(h2pack->pmt_x);
     free(h2pack->pmt_y);
+    free_aligned(h2pack->HSS_mv_buf);
     DAG_task_queue_destroy(&h2pack->upward_tq);
     
     if (h2pack->B_blk  != NULL) H2P_int_vec_destroy(&h2pack->B_blk);
@@ -317,16 +352,30 @@ void H2P_destroy(H2Pack_p *h2pack_)
         free(h2pack->ULV_Q);
         free(h2pack->ULV_L);
     }
+
+    if (h2pack->ULV_Q_fp32 != NULL)
+    {
+        for (int i = 0; i < h2pack->n_node; i++)
+        {
+            free_aligned(h2pack->ULV_Q_fp32[i]);
+            free_aligned(h2pack->ULV_L_fp32[i]);
+        }
+        free(h2pack->ULV_Q_fp32);
+        free(h2pack->ULV_L_fp32);
+    }
     
     // If we don't run H2P_matvec, h2pack->y0 == h2pack->y1 == NULL
-    if (h2pack->y0 != NULL && h2pack->y1 != NULL)
+    // In a rectangular H2 matrix, only y0 or y1 is used in each H2Pack structure
+    if (h2pack->y0 != NULL)
     {
         for (int i = 0; i < h2pack->n_node; i++)
-        {
             H2P_dense_mat_destroy(&h2pack->y0[i]);
-            H2P_dense_mat_destroy(&h2pack->y1[i]);
-        }
         free(h2pack->y0);
+    }
+    if (h2pack->y1 != NULL)
+    {
+        for (int i = 0; i < h2pack->n_node; i++)
+            H2P_dense_mat_destroy(&h2pack->y1[i]);
         free(h2pack->y1);
     }
     
@@ -408,7 +457,13 @@ void H2P_print_statistic(H2Pack_p h2pack)
         double msize0 = (double) tbi->mat0->size     + (double) tbi->mat1->size;
         double msize1 = (double) tbi->idx0->capacity + (double) tbi->idx1->capacity;
         matvec_MB += DTYPE_MB * msize0 + int_MB * msize1;
-        matvec_MB += DTYPE_MB * (double) h2pack->krnl_mat_size;
+        if (tbi->y != NULL) matvec_MB += DTYPE_MB * (double) h2pack->krnl_mat_size;
+    }
+    if (h2pack->HSS_mv_buf != NULL)
+    {
+        double buf_size = 2.0 * (double) h2pack->HSS_mv_spos[h2pack->n_node] * (double) h2pack->HSS_mv_nvec;
+        matvec_MB += DTYPE_MB * buf_size;
+        matvec_MB += int_MB * (double) (3 * h2pack->n_node + 3 * h2pack->HSS_n_r_adm_pair + 2);
     }
     if (h2pack->y0 != NULL && h2pack->y1 != NULL)
     {
@@ -420,8 +475,16 @@ void H2P_print_statistic(H2Pack_p h2pack)
         }
     }
     printf("  * Just-In-Time B & D build      : %s\n", h2pack->BD_JIT ? "Yes (B & D not allocated)" : "No");
+    if (h2pack->ooc_fd >= 0)
+        printf("  * Out-of-core B & D buffers     : 2 * %.2lf (MB) \n", DTYPE_MB * (double) h2pack->ooc_buf_size);
     printf("  * H2 representation U, B, D     : %.2lf, %.2lf, %.2lf (MB) \n", U_MB, B_MB, D_MB);
     printf("  * Matvec auxiliary arrays       : %.2lf (MB) \n", matvec_MB);
+    if (h2pack->per_blk != NULL)
+    {
+        int    per_blk_size = h2pack->J[h2pack->root_idx]->length * h2pack->krnl_dim;
+        double per_blk_MB   = DTYPE_MB * (double) per_blk_size * (double) per_blk_size;
+        printf("  * Periodic block                : %.2lf (MB), size %d\n", per_blk_MB, per_blk_size);
+    }
     int max_node_rank = 0;
     double sum_node_rank = 0.0, non_empty_node = 0.0;
     for (int i = 0; i < h2pack->n_UJ; i++)
@@ -443,6 +506,11 @@ void H2P_print_statistic(H2Pack_p h2pack)
         double ULV_I_MB = (double) mat_size[ULV_I_SIZE_IDX] * DTYPE_MB;
         printf("  * HSS ULV factorization Q, L, I : %.2lf, %.2lf, %.2lf (MB) \n", ULV_Q_MB, ULV_L_MB, ULV_I_MB);
     }
+    if (mat_size[SPDHSS_PEAK_SIZE_IDX] > 0)
+    {
+        double SPDHSS_MB = (double) mat_size[SPDHSS_PEAK_SIZE_IDX] * DTYPE_MB;
+        printf("  * SPDHSS construction peak work : %.2lf (MB) \n", SPDHSS_MB);
+    }
     
     printf("==================== H2Pack timing info =====================\n");
     double *timers = h2pack->timers;
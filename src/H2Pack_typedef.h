@@ -101,7 +101,7 @@ struct H2Pack
     int    n_node;                  // Number of nodes in this H2 tree
     int    root_idx;                // Index of the root node (== n_node - 1, save it for convenience)
     int    n_leaf_node;             // Number of leaf nodes in this H2 tree
-    int    max_child;               // Maximum number of children per node, == 2^pt_dim
+    int    max_child;               // Maximum number of children per node, == H2P_MAX_CHILD(pt_dim)
     int    max_neighbor;            // Maximum number of neighbor nodes per node, == 2^pt_dim
     int    max_level;               // Maximum level of this H2 tree, (root = 0, total max_level + 1 levels)
     int    min_adm_level;           // Minimum level of reduced admissible pair
@@ -120,7 +120,10 @@ struct H2Pack
     int    is_RPY;                  // If H2Pack is running RPY kernel
     int    is_RPY_Ewald;            // If H2Pack is running RPY Ewald summation kernel
     int    is_HSS_SPD;              // If H2Pack in HSS mode is SPD 
+    int    HSS_mv_mode;             // HSS matvec engine status, 0: not checked, 1: used, -1: use H2 matvec instead
+    int    HSS_mv_nvec;             // Maximum number of vectors HSS_mv_buf can hold
     int    n_lattice;               // Number of periodic lattices, == 3^pt_dim
+    int    ooc_fd;                  // File descriptor of out-of-core B and D matrices, -1 if B and D are in memory
     int    print_timers;            // If H2Pack prints internal timers for performance analysis
     int    print_dbginfo;           // If H2Pack prints debug information
     int    *parent;                 // Size n_node, parent index of each node
@@ -151,14 +154,25 @@ struct H2Pack
     int    *D_p2i_colidx;           // Size n_D, col_idx array of the CSR matrix for mapping D{i, j} to a D block index
     int    *D_p2i_val;              // Size n_D, val array of the CSR matrix for mapping D{i, j} to a D block index
     int    *ULV_Ls;                 // Size n_node, splitting point of each ULV_L[i], (1 : ULV_Ls[i], 1 : ULV_Ls[i]) are I
+    int    *HSS_mv_spos;            // Size n_node+1, start row of each node in HSS matvec y0 / y1, [n_node] is the total rank
+    int    *HSS_mv_D_idx;           // Size n_node, index of each leaf node's D matrix in HSS matvec, -1 for non-leaf nodes
+    int    *HSS_mv_pair_ptr;        // Size n_node+1, sibling pairs of node i are HSS_mv_pairs[3 * (HSS_mv_pair_ptr[i] : HSS_mv_pair_ptr[i+1]-1)]
+    int    *HSS_mv_pairs;           // Size 3 * HSS_n_r_adm_pair, (node0, node1, B index) of each sibling pair grouped by parent node
     int    *B_nrow;                 // Size n_B, numbers of rows of generator matrices
     int    *B_ncol;                 // Size n_B, numbers of columns of generator matrices
     int    *D_nrow;                 // Size n_D, numbers of rows of dense blocks in the original matrix
     int    *D_ncol;                 // Size n_D, numbers of columns of dense blocks in the original matrix
     size_t *B_ptr;                  // Size n_B, offset of each generator matrix's data in B_data
     size_t *D_ptr;                  // Size n_D, offset of each dense block's data in D_data
+    size_t mmap_size;               // Size of the binary file mapping used by H2P_load_mmap()
+    size_t ooc_B_offset;            // File offset of out-of-core B matrices data
+    size_t ooc_D_offset;            // File offset of out-of-core D matrices data
+    size_t ooc_buf_size;            // Size (in DTYPE) of each out-of-core streaming buffer
+    size_t krnl_param_bytes;        // Size of krnl_param in bytes, krnl_param is stored in binary files if > 0
     void   *krnl_param;             // Pointer to kernel function parameter array
+    void   *krnl_param_buf;         // Size krnl_param_bytes, kernel function parameters loaded from a binary file
     void   *pkrnl_param;            // Pointer to periodic system kernel function parameter array
+    void   *mmap_addr;              // Address of the binary file mapping used by H2P_load_mmap()
     DTYPE  max_leaf_size;           // Maximum size of a leaf node's box
     DTYPE  QR_stop_tol;             // Partial QR stop column norm tolerance
     DTYPE  HSS_logdet;              // log(abs(det(H2/HSS representation of the kernel matrix)))
@@ -174,11 +188,17 @@ struct H2Pack
     DTYPE  *per_blk;                // Size unknown, periodic system matvec periodic block 
     DTYPE  *xT;                     // Size krnl_mat_size, for transposing matvec input  "matrix" when krnl_dim > 1
     DTYPE  *yT;                     // Size krnl_mat_size, for transposing matvec output "matrix" when krnl_dim > 1
+    float  **ULV_Q_fp32;            // Size n_node, float ULV_Q[i]->data after H2P_HSS_ULV_to_float(), NULL otherwise
+    float  **ULV_L_fp32;            // Size n_node, float ULV_L[i]->data after H2P_HSS_ULV_to_float(), NULL otherwise
     DTYPE  *pmt_x;                  // Size krnl_mat_size( * mm_max_n_vec), storing the permuted input vector/matrix (the input need to be permuted)
     DTYPE  *pmt_y;                  // Size krnl_mat_size( * mm_max_n_vec), storing the permuted output vector/matrix (the final output need to be revered)
+    DTYPE  *HSS_mv_buf;             // Size 2 * HSS_mv_spos[n_node] * HSS_mv_nvec, y0 and y1 of all nodes in HSS matvec
+    DTYPE  *ooc_buf;                // Size 2 * ooc_buf_size, out-of-core B and D streaming double buffer
     H2P_int_vec_p     B_blk;        // Size BD_NTASK_THREAD * n_thread, B matrices task partitioning
     H2P_int_vec_p     D_blk0;       // Size BD_NTASK_THREAD * n_thread, diagonal blocks in D matrices task partitioning
     H2P_int_vec_p     D_blk1;       // Size BD_NTASK_THREAD * n_thread, inadmissible blocks in D matrices task partitioning
+    H2P_int_vec_p     ooc_B_chunk;  // Out-of-core B streaming chunks, chunk i has B task blocks [ooc_B_chunk[i], ooc_B_chunk[i+1])
+    H2P_int_vec_p     ooc_D_chunk;  // Out-of-core D streaming chunks, in units of D_blk0 task blocks followed by D_blk1 task blocks
     H2P_int_vec_p     *J;           // Size n_node, skeleton row sets
     H2P_int_vec_p     *ULV_idx;     // Size n_node, indices of the sub-matrix which ULV_Q and ULV_L performs on for each node in global sense
     H2P_int_vec_p     *ULV_p;       // Size n_node, HSS ULV LU pivot indices of each node
@@ -199,7 +219,7 @@ struct H2Pack
     // Statistic data
     int    n_matvec;                // Number of performed matvec
     int    n_ULV_solve;             // Number of performed ULV solve
-    size_t mat_size[11];            // See below macros
+    size_t mat_size[12];            // See below macros
     double timers[11];              // See below macros
     double JIT_flops[2];            // See below macros
 };
@@ -219,7 +239,8 @@ typedef enum
     MV_VOP_SIZE_IDX,    // Total memory footprint of H2 matvec OpenMP vector operations
     ULV_Q_SIZE_IDX,     // Total size of ULV Q matrices
     ULV_L_SIZE_IDX,     // Total size of ULV L matrices
-    ULV_I_SIZE_IDX      // Total size of ULV integer arrays
+    ULV_I_SIZE_IDX,     // Total size of ULV integer arrays
+    SPDHSS_PEAK_SIZE_IDX    // Peak size of working arrays in SPDHSS construction
 } size_idx_t;
 
 // For H2Pack_t->timers
@@ -278,6 +299,14 @@ void H2P_run_RPY(H2Pack_p h2pack);
 //   h2pack : H2Pack structure to be configured (h2pack->is_RPY_Ewald = 1)
 void H2P_run_RPY_Ewald(H2Pack_p h2pack);
 
+// Set the size of the kernel function parameter array krnl_param, so that 
+// H2P_store_to_binary_file() stores the kernel parameters with the H2 representation.
+// krnl_param should be a flat array without pointers. 
+// Input parameters:
+//   h2pack           : H2Pack structure to be configured
+//   krnl_param_bytes : Size of krnl_param in bytes, 0 to not store the kernel parameters
+void H2P_set_krnl_param_bytes(H2Pack_p h2pack, const size_t krnl_param_bytes);
+
 // Destroy an H2Pack structure
 // Input parameter:
 //   *h2pack : H2Pack structure to be destroyed
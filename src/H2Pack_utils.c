@@ -72,6 +72,27 @@ void H2P_eval_kernel_matrix_OMP(
     }
 }
 
+// Evaluate a kernel matrix block tile by tile
+void H2P_eval_kernel_matrix_tiled(
+    const void *krnl_param, kernel_eval_fptr krnl_eval, const int krnl_dim, 
+    const DTYPE *coord0, const int ld0, const int n0, 
+    const DTYPE *coord1, const int ld1, const int n1, 
+    DTYPE *mat, const int ldm
+)
+{
+    // Each tile is a sub-block of the kernel matrix, krnl_eval() handles it with
+    // ld0, ld1, and ldm, so any user provided kernel function can be tiled
+    for (int j = 0; j < n1; j += KRNL_EVAL_TILE)
+    {
+        int tile_n1 = MIN(KRNL_EVAL_TILE, n1 - j);
+        krnl_eval(
+            coord0,     ld0, n0,
+            coord1 + j, ld1, tile_n1,
+            krnl_param, mat + j * krnl_dim, ldm
+        );
+    }
+}
+
 // Check if a coordinate is in box [-L/2, L/2]^pt_dim
 int H2P_point_in_box(const int pt_dim, DTYPE *coord, DTYPE L)
 {
@@ -215,6 +236,40 @@ void H2P_gen_normal_distribution(const DTYPE mu, const DTYPE sigma, const size_t
     }
 }
 
+// Generate a uniformly distributed random number in [0, 1) with a splitmix64 generator
+static inline double H2P_splitmix64_uniform(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (double) (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Generate normal distribution random number from a random stream, Marsaglia polar method
+void H2P_gen_normal_distribution_stream(
+    const unsigned long long seed, const DTYPE mu, const DTYPE sigma, 
+    const size_t nelem, DTYPE *x
+)
+{
+    // Scramble the seed first so consecutive seeds give uncorrelated streams
+    unsigned long long state = seed;
+    state = (unsigned long long) (H2P_splitmix64_uniform(&state) * 9007199254740992.0);
+    double u1, u2, w, mult;
+    for (size_t i = 0; i < nelem; i += 2)
+    {
+        do 
+        {
+            u1 = H2P_splitmix64_uniform(&state) * 2.0 - 1.0;
+            u2 = H2P_splitmix64_uniform(&state) * 2.0 - 1.0;
+            w  = u1 * u1 + u2 * u2;
+        } while (w >= 1.0 || w <= 1e-15);
+        mult = sqrt((-2.0 * log(w)) / w);
+        x[i] = mu + sigma * (DTYPE) (u1 * mult);
+        if (i + 1 < nelem) x[i+1] = mu + sigma * (DTYPE) (u2 * mult);
+    }
+}
+
 // Quick sorting an integer key-value pair array by key
 void H2P_qsort_int_key_val(int *key, int *val, int l, int r)
 {
@@ -324,8 +379,11 @@ void H2P_get_Bij_block(H2Pack_p h2pack, const int node0, const int node1, H2P_de
     int B_nrow = h2pack->B_nrow[B_idx];
     int B_ncol = h2pack->B_ncol[B_idx];
     H2P_dense_mat_resize(Bij, B_nrow, B_ncol);
-    if (h2pack->BD_JIT == 0)
+    if (h2pack->ooc_fd >= 0)
     {
+        if (H2P_ooc_read(h2pack, 0, h2pack->B_ptr[B_idx], (size_t) B_nrow * (size_t) B_ncol, Bij->data) != 0)
+            ERROR_PRINTF("Failed to read out-of-core B{%d, %d}\n", node0, node1);
+    } else if (h2pack->BD_JIT == 0) {
         copy_matrix_block(sizeof(DTYPE), B_nrow, B_ncol, h2pack->B_data + h2pack->B_ptr[B_idx], B_ncol, Bij->data, B_ncol);
     } else {
         int   n_point     = h2pack->n_point;
@@ -401,8 +459,11 @@ void H2P_get_Dij_block(H2Pack_p h2pack, const int node0, const int node1, H2P_de
     int D_nrow = h2pack->D_nrow[D_idx];
     int D_ncol = h2pack->D_ncol[D_idx];
     H2P_dense_mat_resize(Dij, D_nrow, D_ncol);
-    if (h2pack->BD_JIT == 0)
+    if (h2pack->ooc_fd >= 0)
     {
+        if (H2P_ooc_read(h2pack, 1, h2pack->D_ptr[D_idx], (size_t) D_nrow * (size_t) D_ncol, Dij->data) != 0)
+            ERROR_PRINTF("Failed to read out-of-core D{%d, %d}\n", node0, node1);
+    } else if (h2pack->BD_JIT == 0) {
         copy_matrix_block(sizeof(DTYPE), D_nrow, D_ncol, h2pack->D_data + h2pack->D_ptr[D_idx], D_ncol, Dij->data, D_ncol);
     } else {
         int   n_point     = h2pack->n_point;
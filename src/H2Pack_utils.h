@@ -52,6 +52,29 @@ void H2P_eval_kernel_matrix_OMP(
     H2P_dense_mat_p x_coord, H2P_dense_mat_p y_coord, H2P_dense_mat_p kernel_mat
 );
 
+// Evaluate a kernel matrix block tile by tile. Each tile has all n0 rows and at most
+// KRNL_EVAL_TILE points of coord1, so krnl_eval() reuses a cache-resident coord1 strip 
+// for all rows of coord0 instead of streaming the whole coord1 for each row.
+// Input parameters:
+//   krnl_param : Pointer to kernel function parameter array
+//   krnl_eval  : Kernel matrix evaluation function
+//   krnl_dim   : Dimension of tensor kernel's return
+//   coord0     : Matrix, size pt_dim-by-ld0, coordinates of the 1st point set
+//   ld0        : Leading dimension of coord0, should be >= n0
+//   n0         : Number of points in coord0
+//   coord1     : Matrix, size pt_dim-by-ld1, coordinates of the 2nd point set
+//   ld1        : Leading dimension of coord1, should be >= n1
+//   n1         : Number of points in coord1
+//   ldm        : Leading dimension of the kernel matrix
+// Output parameter:
+//   mat : Obtained kernel matrix, size (n0 * krnl_dim)-by-ldm
+void H2P_eval_kernel_matrix_tiled(
+    const void *krnl_param, kernel_eval_fptr krnl_eval, const int krnl_dim, 
+    const DTYPE *coord0, const int ld0, const int n0, 
+    const DTYPE *coord1, const int ld1, const int n1, 
+    DTYPE *mat, const int ldm
+);
+
 // Check if a coordinate is in box [-L/2, L/2]^pt_dim
 // Input parameters:
 //   pt_dim : Dimension of point coordinate
@@ -118,6 +141,20 @@ void H2P_calc_sparse_mm_trans(
 //   x : Array, size nelem, generated random numbers
 void H2P_gen_normal_distribution(const DTYPE mu, const DTYPE sigma, const size_t nelem, DTYPE *x);
 
+// Generate normal distribution random number from a random stream, Marsaglia polar method.
+// Unlike H2P_gen_normal_distribution(), this function does not use drand48(), so it is 
+// thread-safe and the same seed always generates the same random numbers. 
+// Input parameters:
+//   seed      : Random stream seed, different seeds give uncorrelated streams
+//   mu, sigma : Normal distribution parameters
+//   nelem     : Number of random numbers to be generated
+// Output parameter:
+//   x : Array, size nelem, generated random numbers
+void H2P_gen_normal_distribution_stream(
+    const unsigned long long seed, const DTYPE mu, const DTYPE sigma, 
+    const size_t nelem, DTYPE *x
+);
+
 // Quick sorting an integer key-value pair array by key
 // Input parameters:
 //   key, val : Array, size >= r+1, key-value pairs
@@ -234,6 +271,10 @@ H2P_tree_node_p H2P_bisection_partition_points(
 // Convert a linked list H2 tree to arrays
 void H2P_tree_to_array(H2P_tree_node_p node, H2Pack_p h2pack);
 
+// This function is used by H2Pack_rect.c
+// Construct the upward sweep DAG_task_queue used by H2P_build_H2_UJ_proxy
+void H2P_build_upward_task_queue(H2Pack_p h2pack);
+
 // This function is used by H2Pack_file_IO.c
 // Calculate the inadmissible node list for each node, required by HSS construction
 void H2P_calc_node_inadm_lists(H2Pack_p h2pack);
@@ -255,6 +296,18 @@ void H2P_generate_D_metadata(H2Pack_p h2pack);
 // ================================================================================
 
 
+// ================================================================================
+// The following 2 functions are implemented in H2Pack_build.c and used by 
+// H2Pack_build.c, H2Pack_build_with_sample_point.c, and H2Pack_matvec_dkrnl.c
+
+// Build H2 generator matrices for AOT mode
+void H2P_build_B_AOT(H2Pack_p h2pack);
+
+// Build H2 dense blocks for AOT mode
+void H2P_build_D_AOT(H2Pack_p h2pack);
+// ================================================================================
+
+
 // ================================================================================
 // The following 6 functions are implemented in H2Pack_matvec.c and used by 
 // both H2Pack_matvec.c, H2Pack_matvec_periodic.c, and H2ERI_matvec.c
@@ -290,6 +343,28 @@ void H2P_matvec_bwd_transform(H2Pack_p h2pack, const DTYPE *x, DTYPE *y);
 // ================================================================================
 
 
+// ================================================================================
+// The following 4 functions are implemented in H2Pack_matvec.c and used by 
+// both H2Pack_matvec.c and H2Pack_matvec_dkrnl.c
+
+// H2 matvec intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
+// All B_{ij} matrices have been calculated and stored
+void H2P_matvec_intmd_mult_AOT(H2Pack_p h2pack, const DTYPE *x);
+
+// H2 matvec intermediate multiplication, calculate B_{ij} * (U_j^T * x_j)
+// Need to calculate all B_{ij} matrices before using it
+void H2P_matvec_intmd_mult_JIT(H2Pack_p h2pack, const DTYPE *x);
+
+// H2 matvec dense multiplication, calculate D_{ij} * x_j
+// All D_{ij} matrices have been calculated and stored
+void H2P_matvec_dense_mult_AOT(H2Pack_p h2pack, const DTYPE *x);
+
+// H2 matvec dense multiplication, calculate D_{ij} * x_j
+// Need to calculate all D_{ij} matrices before using it
+void H2P_matvec_dense_mult_JIT(H2Pack_p h2pack, const DTYPE *x);
+// ================================================================================
+
+
 // ================================================================================
 // The following 4 functions are implemented in H2Pack_matmul.c and used by 
 // both H2Pack_matmul.c and H2Pack_matmul_periodic.c
@@ -313,6 +388,38 @@ void H2P_matmul_bwd_transform(
 );
 // ================================================================================
 
+
+
+// ================================================================================
+// The following functions are implemented in H2Pack_file_IO.c and used by 
+// H2Pack_typedef.c, H2Pack_matvec.c, and H2Pack_utils.c
+
+// Release the file mapping of a H2Pack structure loaded by H2P_load_mmap() and the
+// out-of-core file and buffers of a H2Pack structure loaded by H2P_load_out_of_core(). 
+// U, B, and D matrices in the mapping are detached so H2P_destroy() will not free them.
+void H2P_close_binary_file(H2Pack_p h2pack);
+
+// Read out-of-core B or D matrices elements from the binary file
+// Input parameters:
+//   h2pack    : H2Pack structure loaded by H2P_load_out_of_core()
+//   is_D      : 0 for B matrices, 1 for D matrices
+//   elem_spos : Index of the first element to read in B_data or D_data
+//   n_elem    : Number of elements to read
+// Output parameters:
+//   buf      : Size >= n_elem, elements read from the file
+//   <return> : 0 if succeeded, -1 if failed
+int  H2P_ooc_read(H2Pack_p h2pack, const int is_D, const size_t elem_spos, const size_t n_elem, DTYPE *buf);
+
+// Get the index of the first B or D matrices element of an out-of-core task block
+// Input parameters:
+//   h2pack : H2Pack structure loaded by H2P_load_out_of_core()
+//   is_D   : 0 for B task blocks (B_blk), 1 for D task blocks (D_blk0 blocks followed by D_blk1 blocks)
+//   i_blk  : Task block index, can be the number of task blocks for the end position
+// Output parameter:
+//   <return> : Index of the first element of the task block in B_data or D_data
+size_t H2P_ooc_blk_spos(H2Pack_p h2pack, const int is_D, const int i_blk);
+// ================================================================================
+
 #ifdef __cplusplus
 }
 #endif